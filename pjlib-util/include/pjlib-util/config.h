@@ -53,6 +53,20 @@
 #endif
 
 
+/**
+ * The time to wait for the DNS AAAA answer of a host once its DNS A
+ * answer has arrived, in milliseconds. This is the "Resolution Delay" of
+ * RFC 8305 section 3: when it elapses, the resolution completes with the
+ * IPv4 addresses only, instead of waiting for a slow or lost AAAA answer
+ * until the query times out. Set to zero to always wait for both answers.
+ *
+ * Default: 50
+ */
+#ifndef PJ_DNS_RESOLUTION_DELAY
+#   define PJ_DNS_RESOLUTION_DELAY  50
+#endif
+
+
 /**
  * This constant specifies the maximum names to keep in the temporary name
  * table when performing name compression scheme when duplicating DNS packet
@@ -132,6 +146,61 @@
 #   define PJ_DNS_RESOLVER_INVALID_TTL		    60
 #endif
 
+/**
+ * Maximum life-time of negative DNS response (NXDOMAIN or NODATA) in the
+ * resolver response cache, in seconds. The TTL of a negative response is
+ * taken from the SOA record in the authority section of the response as
+ * described in RFC 2308, and it is capped by this value. Negative 
+ * responses without SOA record use PJ_DNS_RESOLVER_INVALID_TTL instead.
+ *
+ * Default: 300 (five minutes)
+ *
+ * @see PJ_DNS_RESOLVER_INVALID_TTL
+ */
+#ifndef PJ_DNS_RESOLVER_MAX_NEG_TTL
+#   define PJ_DNS_RESOLVER_MAX_NEG_TTL		    (5*60)
+#endif
+
+/**
+ * Maximum number of responses in the resolver response cache. When the
+ * cache is full, the least recently used response is evicted to make
+ * room for the new one. If the value is zero, the cache size is not
+ * bounded.
+ *
+ * Default: 512
+ */
+#ifndef PJ_DNS_RESOLVER_MAX_CACHE_ENTRIES
+#   define PJ_DNS_RESOLVER_MAX_CACHE_ENTRIES	    512
+#endif
+
+/**
+ * Cached responses that are being used frequently are refreshed in the
+ * background before they expire, so that queries to popular names keep
+ * being answered from the cache instead of all waiting for a fresh query
+ * at the same time when the TTL expires. This setting specifies, in 
+ * percent of the response's TTL, how long before the expiration the 
+ * refresh may be started. If the value is zero, prefetching is disabled.
+ *
+ * Default: 10
+ *
+ * @see PJ_DNS_RESOLVER_PREFETCH_MIN_HITS
+ */
+#ifndef PJ_DNS_RESOLVER_PREFETCH_PCT
+#   define PJ_DNS_RESOLVER_PREFETCH_PCT		    10
+#endif
+
+/**
+ * Minimum number of cache hits before a cached response is considered
+ * popular enough to be prefetched.
+ *
+ * Default: 2
+ *
+ * @see PJ_DNS_RESOLVER_PREFETCH_PCT
+ */
+#ifndef PJ_DNS_RESOLVER_PREFETCH_MIN_HITS
+#   define PJ_DNS_RESOLVER_PREFETCH_MIN_HITS	    2
+#endif
+
 /**
  * The interval on which nameservers which are known to be good to be 
  * probed again to determine whether they are still good. Note that
@@ -254,6 +323,41 @@
 #   define PJ_CRC32_HAS_TABLES			    1
 #endif
 
+/**
+ * Specifies whether the table based CRC32 should process eight bytes at
+ * a time (slicing-by-8) on little-endian targets, at the expense of
+ * additional 7KB of tables. This is only effective when
+ * PJ_CRC32_HAS_TABLES is enabled.
+ *
+ * Default: 1
+ */
+#ifndef PJ_CRC32_HAS_SLICE8
+#   define PJ_CRC32_HAS_SLICE8			    1
+#endif
+
+/**
+ * Specifies whether SHA1 (and hence HMAC-SHA1) may use the SHA instruction
+ * set extensions of the CPU (Intel SHA extensions) when they are detected
+ * at run-time. The portable implementation is used otherwise.
+ *
+ * Default: 1
+ */
+#ifndef PJ_SHA1_HAS_HW_ACCEL
+#   define PJ_SHA1_HAS_HW_ACCEL			    1
+#endif
+
+/**
+ * Specifies whether OpenSSL's libcrypto is available as SHA1 block
+ * implementation (see #pj_sha1_set_impl()). This is only effective when
+ * PJLIB is built with OpenSSL (PJ_HAS_SSL_SOCK), and the application
+ * must be linked with libcrypto.
+ *
+ * Default: 0
+ */
+#ifndef PJ_SHA1_HAS_OPENSSL
+#   define PJ_SHA1_HAS_OPENSSL			    0
+#endif
+
 
 /* **************************************************************************
  * HTTP Client configuration
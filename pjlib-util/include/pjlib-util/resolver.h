@@ -69,6 +69,24 @@ PJ_BEGIN_DECL
  * Response caching can be  disabled by setting the maximum TTL value of the 
  * resolver to zero.
  *
+ * Negative responses (NXDOMAIN and NODATA) are cached too, with the TTL
+ * taken from the SOA record in the authority section as described in 
+ * RFC 2308.
+ *
+ * The number of cached responses is bounded (see 
+ * #PJ_DNS_RESOLVER_MAX_CACHE_ENTRIES); when the cache is full, the least
+ * recently used response is evicted.
+ *
+ * Cached responses which are queried frequently are refreshed in the
+ * background shortly before they expire (see #PJ_DNS_RESOLVER_PREFETCH_PCT),
+ * while the existing response keeps being returned to application. This
+ * avoids having all queries for a popular name stall on a fresh query 
+ * when its TTL expires.
+ *
+ * The response cache (#pj_dns_cache) may be shared by several resolver
+ * instances, for example resolvers belonging to different SIP endpoints,
+ * with #pj_dns_resolver_set_cache().
+ *
  * \subsection PJ_DNS_RESOLVER_FEATURES_PARALLEL Parallel and Backup Name Servers
  *
  * When the resolver is configured with multiple nameservers, initially the
@@ -125,25 +143,11 @@ PJ_BEGIN_DECL
  *
  * \section PJ_DNS_RESOLVER_LIMITATIONS Resolver Limitations
  *
- * Current implementation mainly suffers from a growing memory problem,
- * which mainly is caused by the response caching. Although there is only
- * one cache entry per {query, name} combination, these cache entry will
- * never get deleted since there is no timer is created to invalidate these
- * entries. So the more unique names being queried by application, there more
- * enties will be created in the response cache.
- *
  * Note that a single response entry will occupy about 600-700 bytes of 
  * pool memory (the PJ_DNS_RESOLVER_RES_BUF_SIZE value plus internal
- * structure). 
- *
- * Application can work around this problem by doing one of these:
- *  - disable caching by setting PJ_DNS_RESOLVER_MAX_TTL and 
- *    PJ_DNS_RESOLVER_INVALID_TTL to zero.
- *  - periodically query #pj_dns_resolver_get_cached_count() and destroy-
- *    recreate the resolver to recycle the memory used by the resolver.
- *
- * Note that future improvement may solve this problem by introducing 
- * expiration timer to the cached entries.
+ * structure), so the memory used by the response cache may grow up to
+ * #PJ_DNS_RESOLVER_MAX_CACHE_ENTRIES times that value. Expired entries
+ * are only removed when they are queried again or evicted.
  *
  *
  * \section PJ_DNS_RESOLVER_REFERENCE Reference
@@ -169,6 +173,12 @@ typedef struct pj_dns_resolver pj_dns_resolver;
  */
 typedef struct pj_dns_async_query pj_dns_async_query;
 
+/**
+ * Opaque data type for DNS response cache. A response cache may be shared
+ * by several resolver instances.
+ */
+typedef struct pj_dns_cache pj_dns_cache;
+
 /**
  * Type of asynchronous callback which will be called when the asynchronous
  * query completes.
@@ -196,6 +206,13 @@ typedef struct pj_dns_settings
 				     value is zero, caching is disabled.    */
     unsigned	good_ns_ttl;	/**< See #PJ_DNS_RESOLVER_GOOD_NS_TTL	    */
     unsigned	bad_ns_ttl;	/**< See #PJ_DNS_RESOLVER_BAD_NS_TTL	    */
+    unsigned	cache_max_neg_ttl;  /**< See #PJ_DNS_RESOLVER_MAX_NEG_TTL   */
+    unsigned	cache_max_entries;  /**< Maximum number of entries in the
+					 resolver's response cache. See 
+					 #PJ_DNS_RESOLVER_MAX_CACHE_ENTRIES */
+    unsigned	prefetch_pct;	/**< See #PJ_DNS_RESOLVER_PREFETCH_PCT	    */
+    unsigned	prefetch_min_hits;  /**< See 
+					 #PJ_DNS_RESOLVER_PREFETCH_MIN_HITS */
 } pj_dns_settings;
 
 
@@ -225,6 +242,44 @@ typedef struct pj_dns_a_record
 } pj_dns_a_record;
 
 
+/**
+ * This structure represents DNS address record, containing IPv4 and/or
+ * IPv6 addresses, as the result of parsing DNS response packet using
+ * #pj_dns_parse_addr_response().
+ */
+typedef struct pj_dns_addr_record
+{
+    /** The target name being queried.   */
+    pj_str_t		name;
+
+    /** If target name corresponds to a CNAME entry, the alias contains
+     *  the value of the CNAME entry, otherwise it will be empty.
+     */
+    pj_str_t		alias;
+
+    /** Number of IP addresses. */
+    unsigned		addr_count;
+
+    /** IP addresses of the host found in the response */
+    struct {
+
+	/** IP address family, pj_AF_INET() or pj_AF_INET6(). */
+	int		af;
+
+	/** The IP address, according to the address family. */
+	union {
+	    pj_in_addr	v4;	/**< IPv4 address.  */
+	    pj_in6_addr	v6;	/**< IPv6 address.  */
+	} ip;
+
+    } addr[PJ_DNS_MAX_IP_IN_A_REC];
+
+    /** Internal buffer for hostname and alias. */
+    char		buf_[128];
+
+} pj_dns_addr_record;
+
+
 /**
  * Set default values to the DNS settings.
  *
@@ -407,6 +462,22 @@ PJ_DECL(pj_status_t) pj_dns_parse_a_response(const pj_dns_parsed_packet *pkt,
 					     pj_dns_a_record *rec);
 
 
+/**
+ * A utility function to parse a DNS response containing A and/or AAAA
+ * records into DNS address record. The addresses are returned in the
+ * order they appear in the answer section.
+ *
+ * @param pkt	    The DNS response packet.
+ * @param rec	    The structure to be initialized with the parsed
+ *		    DNS address record from the packet.
+ *
+ * @return	    PJ_SUCCESS if response can be parsed successfully.
+ */
+PJ_DECL(pj_status_t) pj_dns_parse_addr_response(
+					    const pj_dns_parsed_packet *pkt,
+					    pj_dns_addr_record *rec);
+
+
 /**
  * Put the specified DNS packet into DNS cache. This function is mainly used
  * for testing the resolver, however it can also be used to inject entries
@@ -439,6 +510,89 @@ PJ_DECL(pj_status_t) pj_dns_resolver_add_entry(pj_dns_resolver *resolver,
 PJ_DECL(unsigned) pj_dns_resolver_get_cached_count(pj_dns_resolver *resolver);
 
 
+/**
+ * Create a DNS response cache which can be shared by several resolver
+ * instances with #pj_dns_resolver_set_cache(). Each resolver creates its
+ * own response cache, so application only needs to create one when it
+ * wants to share a cache. The cache is reference counted; it is created
+ * with a reference count of one and destroyed when the counter reaches
+ * zero.
+ *
+ * @param pf	     Pool factory where the memory pool will be created from.
+ * @param name	     Optional name to identify the cache in the log.
+ * @param max_entries Maximum number of responses in the cache, or zero
+ *		     for unbounded cache.
+ * @param p_cache    Pointer to receive the cache instance.
+ *
+ * @return	     PJ_SUCCESS on success, or the appropriate error code.
+ */
+PJ_DECL(pj_status_t) pj_dns_cache_create(pj_pool_factory *pf,
+					 const char *name,
+					 unsigned max_entries,
+					 pj_dns_cache **p_cache);
+
+/**
+ * Add reference counter of the response cache.
+ *
+ * @param cache	    The response cache.
+ *
+ * @return	    PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t) pj_dns_cache_add_ref(pj_dns_cache *cache);
+
+/**
+ * Decrement reference counter of the response cache. The cache will be
+ * destroyed when the reference counter reaches zero.
+ *
+ * @param cache	    The response cache.
+ *
+ * @return	    PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t) pj_dns_cache_dec_ref(pj_dns_cache *cache);
+
+/**
+ * Replace the response cache used by the resolver. The resolver adds a
+ * reference to the new cache and releases its reference to the previous
+ * cache. Responses already cached in the previous cache are not moved.
+ *
+ * For example, to make two SIP endpoints share the same response cache:
+ *
+ * \code
+    pj_dns_resolver *resv1 = pjsip_endpt_get_resolver(endpt1);
+    pj_dns_resolver *resv2 = pjsip_endpt_get_resolver(endpt2);
+
+    pj_dns_resolver_set_cache(resv2, pj_dns_resolver_get_cache(resv1));
+   \endcode
+ *
+ * @param resolver  The resolver instance.
+ * @param cache	    The response cache.
+ *
+ * @return	    PJ_SUCCESS on success, or the appropriate error code.
+ */
+PJ_DECL(pj_status_t) pj_dns_resolver_set_cache(pj_dns_resolver *resolver,
+					       pj_dns_cache *cache);
+
+/**
+ * Get the response cache currently used by the resolver. The reference
+ * counter of the cache is not incremented.
+ *
+ * @param resolver  The resolver instance.
+ *
+ * @return	    The response cache.
+ */
+PJ_DECL(pj_dns_cache*) pj_dns_resolver_get_cache(pj_dns_resolver *resolver);
+
+/**
+ * Get the timer heap used by the resolver, either the one specified when
+ * the resolver was created or its internal timer heap.
+ *
+ * @param resolver  The resolver instance.
+ *
+ * @return	    The timer heap.
+ */
+PJ_DECL(pj_timer_heap_t*) pj_dns_resolver_get_timer(pj_dns_resolver *resolver);
+
+
 /**
  * Dump resolver state to the log.
  *
@@ -46,6 +46,42 @@ typedef struct pj_sha1_context
 /** SHA1 digest size is 20 bytes */
 #define PJ_SHA1_DIGEST_SIZE	20
 
+/**
+ * SHA1 implementations which can be used to process the message blocks.
+ */
+typedef enum pj_sha1_impl
+{
+    /** Select the fastest implementation available at run-time. */
+    PJ_SHA1_IMPL_AUTO,
+
+    /** Portable C implementation. */
+    PJ_SHA1_IMPL_GENERIC,
+
+    /** CPU SHA instruction set extensions. See #PJ_SHA1_HAS_HW_ACCEL. */
+    PJ_SHA1_IMPL_HW,
+
+    /** OpenSSL libcrypto. See #PJ_SHA1_HAS_OPENSSL. */
+    PJ_SHA1_IMPL_OPENSSL
+
+} pj_sha1_impl;
+
+
+/** Select the SHA1 implementation to be used by all subsequent SHA1 and
+ *  HMAC-SHA1 calculations. This is mostly useful for testing and
+ *  benchmarking, since pjlib_util_init() already selects the fastest
+ *  implementation (until then, the portable one is used). It must not be
+ *  called while other threads are calculating SHA1.
+ *  @param impl		The implementation.
+ *  @return		PJ_SUCCESS, or PJ_ENOTSUP if the implementation
+ *			is not available in this build or on this CPU.
+ */
+PJ_DECL(pj_status_t) pj_sha1_set_impl(pj_sha1_impl impl);
+
+/** Get the SHA1 implementation that is currently used.
+ *  @return		The implementation, never PJ_SHA1_IMPL_AUTO.
+ */
+PJ_DECL(pj_sha1_impl) pj_sha1_get_impl(void);
+
 
 /** Initialize the algorithm. 
  *  @param ctx		SHA1 context.
@@ -51,6 +51,20 @@ PJ_BEGIN_DECL
  * the resolver will fallback to using DNS A record resolution to resolve
  * the name.
  *
+ * \subsection PJ_DNS_SRV_RESOLVER_PARALLEL Parallel Queries
+ *
+ * All queries that do not depend on each other are run concurrently:
+ *  - the DNS A and AAAA queries of all SRV targets are started together
+ *    as soon as the SRV response is received (see #PJ_DNS_SRV_RESOLVE_AAAA),
+ *  - with #PJ_DNS_SRV_FALLBACK_PARALLEL, the fallback DNS A and/or AAAA
+ *    queries of the domain name are started together with the SRV query,
+ *    so that SRV failure does not cost another round of DNS timeouts.
+ *    The fallback answer is discarded if the SRV query is successful.
+ *
+ * Once the DNS A answer of a host has arrived, its DNS AAAA answer is only
+ * waited for #PJ_DNS_RESOLUTION_DELAY msec (RFC 8305 section 3), after
+ * which the resolution completes with the IPv4 addresses.
+ *
  * \subsection PJ_DNS_SRV_RESOLVER_FAILOVER_LOADBALANCE Load-Balancing and Fail-Over
  *
  * When multiple targets are returned in the DNS SRV response, server entries
@@ -84,8 +98,8 @@ typedef enum pj_dns_srv_option
      * Specify if the resolver should fallback with DNS A
      * resolution when the SRV resolution fails. This option may
      * be specified together with PJ_DNS_SRV_FALLBACK_AAAA to
-     * make the resolver fallback to AAAA if SRV resolution fails,
-     * and then to DNS A resolution if the AAAA resolution fails.
+     * make the resolver fallback to both A and AAAA resolution,
+     * in which case both queries are run concurrently.
      */
     PJ_DNS_SRV_FALLBACK_A	= 1,
 
@@ -93,18 +107,35 @@ typedef enum pj_dns_srv_option
      * Specify if the resolver should fallback with DNS AAAA
      * resolution when the SRV resolution fails. This option may
      * be specified together with PJ_DNS_SRV_FALLBACK_A to
-     * make the resolver fallback to AAAA if SRV resolution fails,
-     * and then to DNS A resolution if the AAAA resolution fails.
+     * make the resolver fallback to both A and AAAA resolution,
+     * in which case both queries are run concurrently.
      */
     PJ_DNS_SRV_FALLBACK_AAAA	= 2,
 
     /**
-     * Specify if the resolver should try to resolve with DNS AAAA
-     * resolution first of each targets in the DNS SRV record. If
-     * this option is not specified, the SRV resolver will query
-     * the DNS A record for the target instead.
+     * Specify if the resolver should also resolve the DNS AAAA record
+     * of each target in the DNS SRV record. The DNS A and AAAA queries
+     * are run concurrently, and the IPv6 addresses are returned in
+     * \a addr6 of the #pj_dns_srv_record entry. If this option is not
+     * specified, the SRV resolver will only query the DNS A record for
+     * the target.
+     */
+    PJ_DNS_SRV_RESOLVE_AAAA	= 4,
+
+    /**
+     * Specify if the resolver should only resolve the DNS AAAA record
+     * (and not the DNS A record) of each target in the DNS SRV record.
      */
-    PJ_DNS_SRV_RESOLVE_AAAA	= 4
+    PJ_DNS_SRV_RESOLVE_AAAA_ONLY = 8,
+
+    /**
+     * Specify if the fallback DNS A and/or AAAA resolution (see
+     * PJ_DNS_SRV_FALLBACK_A and PJ_DNS_SRV_FALLBACK_AAAA) should be
+     * started together with the SRV query, instead of after the SRV
+     * query has failed. This removes the fallback latency at the cost
+     * of an extra DNS query when the SRV resolution succeeds.
+     */
+    PJ_DNS_SRV_FALLBACK_PARALLEL = 16
 
 } pj_dns_srv_option;
 
@@ -130,9 +161,21 @@ typedef struct pj_dns_srv_record
 	/** Port number. */
 	pj_uint16_t		port;
 
-	/** The host address. */
+	/** The host address. Note that when #PJ_DNS_SRV_RESOLVE_AAAA
+	 *  option is specified, the host may only have IPv6 addresses,
+	 *  in which case the address count here is zero.
+	 */
 	pj_dns_a_record		server;
 
+	/** Number of IPv6 addresses of the host. */
+	unsigned		addr6_count;
+
+	/** IPv6 addresses of the host, only resolved when
+	 *  #PJ_DNS_SRV_RESOLVE_AAAA or #PJ_DNS_SRV_RESOLVE_AAAA_ONLY
+	 *  option is specified.
+	 */
+	pj_in6_addr		addr6[PJ_DNS_MAX_IP_IN_A_REC];
+
     } entry[PJ_DNS_SRV_MAX_ADDR];
 
 } pj_dns_srv_record;
@@ -491,6 +491,39 @@ static int crc32_test(void)
 	}
 
     }
+
+    /* testing bulk update on unaligned buffers of various lengths against
+     * byte-by-byte update.
+     */
+    {
+	pj_uint8_t buf[300];
+
+	for (i=0; i<sizeof(buf); ++i)
+	    buf[i] = (pj_uint8_t)(i * 7 + 3);
+
+	for (i=0; i<8; ++i) {
+	    unsigned len;
+
+	    for (len=0; len < sizeof(buf) - 8; len += 13) {
+		pj_crc32_context ctx;
+		pj_uint32_t crc0, crc1;
+		unsigned k;
+
+		crc0 = pj_crc32_calc(buf + i, len);
+
+		pj_crc32_init(&ctx);
+		for (k=0; k<len; ++k)
+		    pj_crc32_update(&ctx, buf + i + k, 1);
+		crc1 = pj_crc32_final(&ctx);
+
+		if (crc0 != crc1) {
+		    PJ_LOG(3,(THIS_FILE, "    error: crc mismatch on "
+			      "offset %d length %d", i, len));
+		    return -87;
+		}
+	    }
+	}
+    }
     return 0;
 }
 
@@ -627,6 +660,54 @@ static int base64_test(void)
 }
 
 
+static const struct sha1_impl_t
+{
+    pj_sha1_impl impl;
+    const char  *name;
+} sha1_impls[] = 
+{
+    { PJ_SHA1_IMPL_GENERIC, "generic" },
+    { PJ_SHA1_IMPL_HW,	    "hw" },
+    { PJ_SHA1_IMPL_OPENSSL, "openssl" }
+};
+
+/*
+ * Run the SHA1 and HMAC-SHA1 test vectors against every SHA1 block
+ * implementation available in this build/CPU.
+ */
+static int sha1_impl_test(void)
+{
+    unsigned i;
+    int rc = 0;
+
+    for (i=0; i<PJ_ARRAY_SIZE(sha1_impls); ++i) {
+	if (pj_sha1_set_impl(sha1_impls[i].impl) != PJ_SUCCESS) {
+	    PJ_LOG(3, (THIS_FILE, "  SHA1 %s implementation not available",
+		       sha1_impls[i].name));
+	    continue;
+	}
+
+	PJ_LOG(3, (THIS_FILE, "  SHA1 %s implementation:",
+		   sha1_impls[i].name));
+
+	rc = sha1_test1();
+	if (rc != 0)
+	    break;
+
+	rc = sha1_test2();
+	if (rc != 0)
+	    break;
+
+	rc = rfc2202_test();
+	if (rc != 0)
+	    break;
+    }
+
+    pj_sha1_set_impl(PJ_SHA1_IMPL_AUTO);
+    return rc;
+}
+
+
 int encryption_test()
 {
     int rc;
@@ -635,15 +716,7 @@ int encryption_test()
     if (rc != 0)
 	return rc;
 
-    rc = sha1_test1();
-    if (rc != 0)
-	return rc;
-
-    rc = sha1_test2();
-    if (rc != 0)
-	return rc;
-
-    rc = rfc2202_test();
+    rc = sha1_impl_test();
     if (rc != 0)
 	return rc;
 
@@ -757,6 +830,51 @@ int encryption_benchmark()
 		   ((unsigned)(bytes) % (1024 * 1024)) / 1024));
     }
 
+    /* SHA1 and HMAC-SHA1 on each available implementation. The HMAC
+     * run uses STUN sized messages with a 16 bytes (long term) key.
+     */
+    for (i=0; i<PJ_ARRAY_SIZE(sha1_impls); ++i) {
+	enum { STUN_MSG_LEN = 120 };
+	pj_uint8_t key[16];
+	pj_timestamp t1, t2;
+	pj_uint32_t t_sha1, t_hmac;
+	unsigned hmac_loop, j;
+	double bytes;
+
+	if (pj_sha1_set_impl(sha1_impls[i].impl) != PJ_SUCCESS)
+	    continue;
+
+	pj_get_timestamp(&t1);
+	pj_sha1_init(&context.sha1_context);
+	for (j=0; j<LOOP; ++j) {
+	    pj_sha1_update(&context.sha1_context, input, input_len);
+	}
+	pj_sha1_final(&context.sha1_context, digest);
+	pj_get_timestamp(&t2);
+	t_sha1 = pj_elapsed_usec(&t1, &t2);
+	if (t_sha1 == 0) t_sha1 = 1;
+
+	pj_memset(key, 'k', sizeof(key));
+	hmac_loop = (unsigned)(total_len / STUN_MSG_LEN);
+	pj_get_timestamp(&t1);
+	for (j=0; j<hmac_loop; ++j) {
+	    pj_hmac_sha1(input, STUN_MSG_LEN, key, sizeof(key), digest);
+	}
+	pj_get_timestamp(&t2);
+	t_hmac = pj_elapsed_usec(&t1, &t2);
+	if (t_hmac == 0) t_hmac = 1;
+
+	bytes = (total_len * 1000000 / t_sha1);
+	PJ_LOG(3, (THIS_FILE, "    SHA1 %-8s:%8d usec (%3d.%03d Mbytes/sec)",
+		   sha1_impls[i].name, t_sha1,
+		   (unsigned)(bytes / 1024 / 1024),
+		   ((unsigned)(bytes) % (1024 * 1024)) / 1024));
+	PJ_LOG(3, (THIS_FILE, "    HMAC-SHA1 %-8s:%8d usec (%d msg/sec)",
+		   sha1_impls[i].name, t_hmac,
+		   (unsigned)((double)hmac_loop * 1000000 / t_hmac)));
+    }
+    pj_sha1_set_impl(PJ_SHA1_IMPL_AUTO);
+
     return 0;
 }
 
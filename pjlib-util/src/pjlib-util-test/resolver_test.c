@@ -191,6 +191,20 @@ static int print_rr(pj_uint8_t *pkt, int size, pj_uint8_t *pos,
 	p += 6;
 	size -= 6;
 
+    } else if (rr->type == PJ_DNS_TYPE_AAAA) {
+
+	if (size < 18)
+	    return -1;
+
+	/* RDLEN is 16 */
+	write16(p, 16);
+
+	/* Address */
+	pj_memcpy(p+2, &rr->rdata.aaaa.ip_addr, 16);
+
+	p += 18;
+	size -= 18;
+
     } else if (rr->type == PJ_DNS_TYPE_CNAME ||
 	       rr->type == PJ_DNS_TYPE_NS ||
 	       rr->type == PJ_DNS_TYPE_PTR) {
@@ -227,6 +241,18 @@ static int print_rr(pj_uint8_t *pkt, int size, pj_uint8_t *pos,
 	p += (len + 8);
 	size -= (len + 8);
 
+    } else if (rr->data) {
+
+	if (size < rr->rdlength + 2)
+	    return -1;
+
+	/* Raw rdata */
+	write16(p, rr->rdlength);
+	pj_memcpy(p+2, rr->data, rr->rdlength);
+
+	p += (rr->rdlength + 2);
+	size -= (rr->rdlength + 2);
+
     } else {
 	pj_assert(!"Not supported");
 	return -1;
@@ -377,6 +403,8 @@ static int server_thread(void *p)
 	} else if (srv->action == ACTION_CB) {
 	    pj_dns_parsed_packet *resp;
 	    (*srv->action_cb)(req, &resp);
+	    if (resp == NULL)
+		continue;
 	    resp->hdr.id = req->hdr.id;
 	    pkt_len = print_packet(resp, (pj_uint8_t*)pkt, sizeof(pkt));
 	    pj_sock_sendto(srv->sock, pkt, &pkt_len, 0, &src_addr, src_len);
@@ -1218,6 +1246,9 @@ static int srv_resolver_fallback_test(void)
 
     pj_sem_wait(sem);
 
+    /* The resolver updates the cache after calling the callback */
+    pj_thread_sleep(100);
+
     /* Subsequent query should just get the response from the cache */
     PJ_LOG(3,(THIS_FILE, "  srv_resolve(): cache test"));
     g_server[0].pkt_count = 0;
@@ -1367,6 +1398,545 @@ static int srv_resolver_many_test(void)
 }
 
 
+////////////////////////////////////////////////////////////////////////////
+/* Concurrent A and AAAA resolution of SRV targets and fallback */
+#define DOMAIN4	    "d4.com"
+#define PORT4	    50064
+#define IP_ADDR4    0x04040404
+#define IP6_ADDR4   "2001:db8::4"
+
+static pj_status_t srv4_status;
+static pj_dns_srv_record srv4_rec;
+
+static void action4_1(const pj_dns_parsed_packet *pkt,
+		      pj_dns_parsed_packet **p_res)
+{
+    pj_dns_parsed_packet *res;
+
+    res = PJ_POOL_ZALLOC_T(pool, pj_dns_parsed_packet);
+    res->q = PJ_POOL_ZALLOC_T(pool, pj_dns_parsed_query);
+    res->ans = PJ_POOL_ZALLOC_T(pool, pj_dns_parsed_rr);
+
+    res->hdr.qdcount = 1;
+    res->q[0].type = pkt->q[0].type;
+    res->q[0].dnsclass = pkt->q[0].dnsclass;
+    res->q[0].name = pkt->q[0].name;
+
+    res->ans[0].type = pkt->q[0].type;
+    res->ans[0].dnsclass = 1;
+    res->ans[0].name = res->q[0].name;
+    res->ans[0].ttl = 1;
+
+    if (pkt->q[0].type == PJ_DNS_TYPE_SRV) {
+	/* Only UDP has SRV record, TCP will fallback */
+	if (pj_strcmp2(&pkt->q[0].name, "_sip._udp." DOMAIN4)==0) {
+	    res->hdr.anscount = 1;
+	    res->ans[0].rdata.srv.prio = 1;
+	    res->ans[0].rdata.srv.weight = 2;
+	    res->ans[0].rdata.srv.port = PORT4;
+	    res->ans[0].rdata.srv.target = pj_str("sip." DOMAIN4);
+	}
+
+    } else if (pkt->q[0].type == PJ_DNS_TYPE_A) {
+	res->hdr.anscount = 1;
+	res->ans[0].rdata.a.ip_addr.s_addr = IP_ADDR4;
+
+    } else if (pkt->q[0].type == PJ_DNS_TYPE_AAAA) {
+	pj_str_t ip6 = pj_str(IP6_ADDR4);
+
+	res->hdr.anscount = 1;
+	pj_inet_pton(pj_AF_INET6(), &ip6, &res->ans[0].rdata.aaaa.ip_addr);
+    }
+
+    *p_res = res;
+}
+
+/* Same as action4_1, but DNS AAAA queries are not answered */
+static void action4_2(const pj_dns_parsed_packet *pkt,
+		      pj_dns_parsed_packet **p_res)
+{
+    if (pkt->q[0].type == PJ_DNS_TYPE_AAAA)
+	*p_res = NULL;
+    else
+	action4_1(pkt, p_res);
+}
+
+static void srv_cb_4(void *user_data,
+		     pj_status_t status,
+		     const pj_dns_srv_record *rec)
+{
+    PJ_UNUSED_ARG(user_data);
+
+    srv4_status = status;
+    if (status == PJ_SUCCESS)
+	pj_memcpy(&srv4_rec, rec, sizeof(*rec));
+
+    pj_sem_post(sem);
+}
+
+static int check_srv4_rec(unsigned port)
+{
+    pj_in6_addr ip6;
+    pj_str_t tmp = pj_str(IP6_ADDR4);
+
+    if (srv4_status != PJ_SUCCESS)
+	return -10;
+    if (srv4_rec.count != 1 || srv4_rec.entry[0].port != port)
+	return -20;
+    if (srv4_rec.entry[0].server.addr_count != 1 ||
+	srv4_rec.entry[0].server.addr[0].s_addr != IP_ADDR4)
+    {
+	return -30;
+    }
+
+    pj_inet_pton(pj_AF_INET6(), &tmp, &ip6);
+    if (srv4_rec.entry[0].addr6_count != 1 ||
+	pj_memcmp(&srv4_rec.entry[0].addr6[0], &ip6, sizeof(ip6)) != 0)
+    {
+	return -40;
+    }
+
+    return 0;
+}
+
+static int srv_resolver_aaaa_test(void)
+{
+    pj_status_t status;
+    pj_str_t domain = pj_str(DOMAIN4);
+    pj_str_t res_name;
+    int rc;
+
+    PJ_LOG(3,(THIS_FILE, "  srv_resolve(): A and AAAA test"));
+
+    g_server[0].action = ACTION_CB;
+    g_server[0].action_cb = &action4_1;
+    g_server[1].action = ACTION_CB;
+    g_server[1].action_cb = &action4_1;
+
+    /* SRV target is resolved with DNS A and AAAA concurrently */
+    g_server[0].pkt_count = 0;
+    g_server[1].pkt_count = 0;
+
+    res_name = pj_str("_sip._udp.");
+    status = pj_dns_srv_resolve(&domain, &res_name, 1, pool, resolver,
+				PJ_DNS_SRV_FALLBACK_A |
+				PJ_DNS_SRV_RESOLVE_AAAA,
+				NULL, &srv_cb_4, NULL);
+    if (status != PJ_SUCCESS)
+	return -1400;
+
+    pj_sem_wait(sem);
+
+    rc = check_srv4_rec(PORT4);
+    if (rc != 0)
+	return -1410 + rc;
+
+    /* SRV, A, and AAAA */
+    if (g_server[0].pkt_count + g_server[1].pkt_count != 3)
+	return -1460;
+
+    /* SRV fails, A and AAAA fallback queries are sent together with
+     * the SRV query.
+     */
+    PJ_LOG(3,(THIS_FILE, "  srv_resolve(): parallel A and AAAA fallback"));
+    g_server[0].pkt_count = 0;
+    g_server[1].pkt_count = 0;
+
+    res_name = pj_str("_sip._tcp.");
+    status = pj_dns_srv_resolve(&domain, &res_name, PORT4+1, pool, resolver,
+				PJ_DNS_SRV_FALLBACK_A |
+				PJ_DNS_SRV_FALLBACK_AAAA |
+				PJ_DNS_SRV_FALLBACK_PARALLEL,
+				NULL, &srv_cb_4, NULL);
+    if (status != PJ_SUCCESS)
+	return -1470;
+
+    pj_sem_wait(sem);
+
+    rc = check_srv4_rec(PORT4+1);
+    if (rc != 0)
+	return -1480 + rc;
+
+    /* SRV, A, and AAAA of the domain */
+    if (g_server[0].pkt_count + g_server[1].pkt_count != 3)
+	return -1530;
+
+    /* The AAAA answer is lost, the resolution completes with the IPv4
+     * address once the resolution delay elapses, instead of waiting for
+     * the AAAA query to time out.
+     */
+    if (PJ_DNS_RESOLUTION_DELAY > 0) {
+	pj_dns_settings set;
+	pj_time_val t1, t2;
+
+	PJ_LOG(3,(THIS_FILE, "  srv_resolve(): resolution delay"));
+
+	g_server[0].action_cb = &action4_2;
+	g_server[1].action_cb = &action4_2;
+	pj_dns_resolver_get_settings(resolver, &set);
+
+	domain = pj_str("d5.com");
+	res_name = pj_str("_sip._udp.");
+	pj_gettickcount(&t1);
+	status = pj_dns_srv_resolve(&domain, &res_name, PORT4, pool, resolver,
+				    PJ_DNS_SRV_FALLBACK_A |
+				    PJ_DNS_SRV_FALLBACK_AAAA,
+				    NULL, &srv_cb_4, NULL);
+	if (status != PJ_SUCCESS)
+	    return -1540;
+
+	pj_sem_wait(sem);
+	pj_gettickcount(&t2);
+	PJ_TIME_VAL_SUB(t2, t1);
+
+	if (srv4_status != PJ_SUCCESS)
+	    return -1550;
+	if (srv4_rec.count != 1 ||
+	    srv4_rec.entry[0].server.addr_count != 1 ||
+	    srv4_rec.entry[0].addr6_count != 0)
+	{
+	    return -1560;
+	}
+	if (PJ_TIME_VAL_MSEC(t2) >= set.qretr_delay)
+	    return -1570;
+
+	/* Let the retransmission of the cancelled AAAA query be answered,
+	 * so that it doesn't reach the next tests.
+	 */
+	g_server[0].action_cb = &action4_1;
+	g_server[1].action_cb = &action4_1;
+	pj_thread_sleep(set.qretr_delay + 500);
+    }
+
+    return 0;
+}
+
+
+////////////////////////////////////////////////////////////////////////////
+/* Response cache tests: LRU eviction, negative caching, prefetching, and
+ * sharing the cache between resolvers.
+ */
+#define NEG_NAME    "neg.cachetest.com"
+#define CACHE_TTL   4
+
+static unsigned cache_cb_cnt;
+static pj_status_t cache_cb_status;
+static pj_bool_t cache_servfail;
+
+static void cache_cb(void *user_data,
+		     pj_status_t status,
+		     pj_dns_parsed_packet *resp)
+{
+    PJ_UNUSED_ARG(user_data);
+    PJ_UNUSED_ARG(resp);
+
+    ++cache_cb_cnt;
+    cache_cb_status = status;
+    pj_sem_post(sem);
+}
+
+static void action_cache(const pj_dns_parsed_packet *pkt,
+			 pj_dns_parsed_packet **p_res)
+{
+    pj_dns_parsed_packet *res;
+
+    res = PJ_POOL_ZALLOC_T(pool, pj_dns_parsed_packet);
+    res->hdr.flags = PJ_DNS_SET_QR(1);
+    res->hdr.qdcount = 1;
+    res->q = PJ_POOL_ZALLOC_T(pool, pj_dns_parsed_query);
+    res->q[0] = pkt->q[0];
+
+    if (cache_servfail) {
+	res->hdr.flags |= PJ_DNS_SET_RCODE(PJ_DNS_RCODE_SERVFAIL);
+    } else if (pj_strcmp2(&pkt->q[0].name, NEG_NAME)==0) {
+	/* NXDOMAIN with SOA: TTL 60, MINIMUM 1 */
+	pj_uint8_t *soa;
+
+	soa = (pj_uint8_t*) pj_pool_zalloc(pool, 22);
+	soa[21] = 1;
+
+	res->hdr.flags |= PJ_DNS_SET_RCODE(PJ_DNS_RCODE_NXDOMAIN);
+	res->hdr.nscount = 1;
+	res->ns = PJ_POOL_ZALLOC_T(pool, pj_dns_parsed_rr);
+	res->ns[0].type = PJ_DNS_TYPE_SOA;
+	res->ns[0].dnsclass = 1;
+	res->ns[0].ttl = 60;
+	res->ns[0].name = pj_str("cachetest.com");
+	res->ns[0].rdlength = 22;
+	res->ns[0].data = soa;
+    } else {
+	res->hdr.anscount = 1;
+	res->ans = PJ_POOL_ZALLOC_T(pool, pj_dns_parsed_rr);
+	res->ans[0].type = PJ_DNS_TYPE_A;
+	res->ans[0].dnsclass = 1;
+	res->ans[0].ttl = CACHE_TTL;
+	res->ans[0].name = pkt->q[0].name;
+	res->ans[0].rdata.a.ip_addr.s_addr = IP_ADDR0;
+    }
+
+    *p_res = res;
+}
+
+/* Query name with resolver and return 1 if it's answered from the cache,
+ * 0 if it needs to be queried to server, or negative on error.
+ */
+static int cache_query(pj_dns_resolver *resv, const char *name)
+{
+    pj_str_t n = pj_str((char*)name);
+    unsigned cnt = cache_cb_cnt;
+    pj_status_t status;
+    int hit;
+
+    status = pj_dns_resolver_start_query(resv, &n, PJ_DNS_TYPE_A, 0,
+					 &cache_cb, NULL, NULL);
+    if (status != PJ_SUCCESS)
+	return -1;
+
+    hit = (cache_cb_cnt != cnt);
+    pj_sem_wait(sem);
+
+    /* The resolver updates the cache after calling the callback */
+    if (!hit)
+	pj_thread_sleep(100);
+
+    return hit;
+}
+
+static void add_cache_entry(pj_dns_resolver *resv, const char *name)
+{
+    pj_dns_parsed_packet pkt;
+    pj_dns_parsed_rr ans;
+
+    pj_bzero(&pkt, sizeof(pkt));
+    pj_bzero(&ans, sizeof(ans));
+    pkt.hdr.flags = PJ_DNS_SET_QR(1);
+    pkt.hdr.anscount = 1;
+    pkt.ans = &ans;
+    ans.type = PJ_DNS_TYPE_A;
+    ans.dnsclass = 1;
+    ans.name = pj_str((char*)name);
+    ans.rdata.a.ip_addr.s_addr = IP_ADDR0;
+
+    pj_dns_resolver_add_entry(resv, &pkt, PJ_FALSE);
+}
+
+static int cache_lru_test(void)
+{
+    pj_dns_settings st;
+    int rc = 0;
+
+    PJ_LOG(3,(THIS_FILE, "  response cache LRU test"));
+
+    pj_dns_resolver_get_settings(resolver, &st);
+    st.cache_max_entries = 3;
+    pj_dns_resolver_set_settings(resolver, &st);
+
+    /* Older entries from previous tests are evicted first */
+
+    add_cache_entry(resolver, "lru0.cachetest.com");
+    add_cache_entry(resolver, "lru1.cachetest.com");
+    add_cache_entry(resolver, "lru2.cachetest.com");
+
+    /* Touch lru0 so lru1 becomes the least recently used */
+    if (cache_query(resolver, "lru0.cachetest.com") != 1) {
+	rc = -1200;
+	goto on_return;
+    }
+
+    add_cache_entry(resolver, "lru3.cachetest.com");
+    if (pj_dns_resolver_get_cached_count(resolver) != 3) {
+	rc = -1210;
+	goto on_return;
+    }
+
+    g_server[0].action = ACTION_CB;
+    g_server[0].action_cb = &action_cache;
+    g_server[1].action = ACTION_CB;
+    g_server[1].action_cb = &action_cache;
+
+    if (cache_query(resolver, "lru0.cachetest.com") != 1 ||
+	cache_query(resolver, "lru3.cachetest.com") != 1)
+    {
+	rc = -1220;
+	goto on_return;
+    }
+    if (cache_query(resolver, "lru1.cachetest.com") != 0) {
+	rc = -1230;
+	goto on_return;
+    }
+
+on_return:
+    pj_dns_resolver_get_settings(resolver, &st);
+    st.cache_max_entries = PJ_DNS_RESOLVER_MAX_CACHE_ENTRIES;
+    pj_dns_resolver_set_settings(resolver, &st);
+    return rc;
+}
+
+static int cache_negative_test(void)
+{
+    PJ_LOG(3,(THIS_FILE, "  negative response caching test"));
+
+    g_server[0].action = ACTION_CB;
+    g_server[0].action_cb = &action_cache;
+    g_server[1].action = ACTION_CB;
+    g_server[1].action_cb = &action_cache;
+
+    if (cache_query(resolver, NEG_NAME) != 0)
+	return -1300;
+    if (cache_cb_status != PJ_STATUS_FROM_DNS_RCODE(PJ_DNS_RCODE_NXDOMAIN))
+	return -1310;
+
+    /* Negative response must be cached.. */
+    if (cache_query(resolver, NEG_NAME) != 1)
+	return -1320;
+    if (cache_cb_status != PJ_STATUS_FROM_DNS_RCODE(PJ_DNS_RCODE_NXDOMAIN))
+	return -1330;
+
+    /* ..for the SOA MINIMUM value (one second) */
+    pj_thread_sleep(1500);
+    if (cache_query(resolver, NEG_NAME) != 0)
+	return -1340;
+
+    return 0;
+}
+
+static int cache_prefetch_test(void)
+{
+    pj_dns_settings st;
+    unsigned pkt_count;
+    int rc = 0;
+
+    PJ_LOG(3,(THIS_FILE, "  response cache prefetch test"));
+
+    pj_dns_resolver_get_settings(resolver, &st);
+    st.prefetch_pct = 50;
+    st.prefetch_min_hits = 2;
+    pj_dns_resolver_set_settings(resolver, &st);
+
+    g_server[0].action = ACTION_CB;
+    g_server[0].action_cb = &action_cache;
+    g_server[1].action = ACTION_CB;
+    g_server[1].action_cb = &action_cache;
+
+    if (cache_query(resolver, "prefetch.cachetest.com") != 0) {
+	rc = -1400;
+	goto on_return;
+    }
+
+    /* Popular, but not near expiration yet */
+    if (cache_query(resolver, "prefetch.cachetest.com") != 1 ||
+	cache_query(resolver, "prefetch.cachetest.com") != 1)
+    {
+	rc = -1410;
+	goto on_return;
+    }
+
+    /* Within the last half of TTL the cached response is still returned
+     * and the response is refreshed in the background.
+     */
+    pj_thread_sleep(CACHE_TTL * 1000 / 2 + 500);
+    pkt_count = g_server[0].pkt_count + g_server[1].pkt_count;
+    if (cache_query(resolver, "prefetch.cachetest.com") != 1) {
+	rc = -1420;
+	goto on_return;
+    }
+
+    pj_thread_sleep(500);
+    if (g_server[0].pkt_count + g_server[1].pkt_count == pkt_count) {
+	rc = -1430;
+	goto on_return;
+    }
+
+    /* The original response has expired by now, but the refreshed one
+     * should still be there.
+     */
+    pj_thread_sleep(CACHE_TTL * 1000 / 2);
+    if (cache_query(resolver, "prefetch.cachetest.com") != 1) {
+	rc = -1440;
+	goto on_return;
+    }
+
+    /* That hit refreshes the entry again. A failed refresh must keep the
+     * entry, and must not prevent refreshing it on the next hit.
+     */
+    pj_thread_sleep(500);
+    cache_servfail = PJ_TRUE;
+    pj_thread_sleep(CACHE_TTL * 1000 / 2 + 500);
+    pkt_count = g_server[0].pkt_count + g_server[1].pkt_count;
+    if (cache_query(resolver, "prefetch.cachetest.com") != 1) {
+	rc = -1450;
+	goto on_return;
+    }
+
+    pj_thread_sleep(500);
+    if (g_server[0].pkt_count + g_server[1].pkt_count == pkt_count) {
+	rc = -1460;
+	goto on_return;
+    }
+
+    pkt_count = g_server[0].pkt_count + g_server[1].pkt_count;
+    if (cache_query(resolver, "prefetch.cachetest.com") != 1) {
+	rc = -1470;
+	goto on_return;
+    }
+
+    pj_thread_sleep(500);
+    if (g_server[0].pkt_count + g_server[1].pkt_count == pkt_count) {
+	rc = -1480;
+	goto on_return;
+    }
+
+on_return:
+    cache_servfail = PJ_FALSE;
+    pj_dns_resolver_get_settings(resolver, &st);
+    st.prefetch_pct = PJ_DNS_RESOLVER_PREFETCH_PCT;
+    st.prefetch_min_hits = PJ_DNS_RESOLVER_PREFETCH_MIN_HITS;
+    pj_dns_resolver_set_settings(resolver, &st);
+    return rc;
+}
+
+static int cache_shared_test(void)
+{
+    pj_dns_resolver *resolver2;
+    pj_status_t status;
+    int rc = 0;
+
+    PJ_LOG(3,(THIS_FILE, "  shared response cache test"));
+
+    status = pj_dns_resolver_create(mem, "resolver2", 0, timer_heap, ioqueue,
+				    &resolver2);
+    if (status != PJ_SUCCESS)
+	return -1500;
+
+    status = pj_dns_resolver_set_cache(resolver2,
+				       pj_dns_resolver_get_cache(resolver));
+    if (status != PJ_SUCCESS) {
+	rc = -1510;
+	goto on_return;
+    }
+
+    add_cache_entry(resolver, "shared.cachetest.com");
+    if (cache_query(resolver2, "shared.cachetest.com") != 1) {
+	rc = -1520;
+	goto on_return;
+    }
+
+    /* Entry added by the second resolver is visible to the first one, and
+     * survives destruction of the second resolver.
+     */
+    add_cache_entry(resolver2, "shared2.cachetest.com");
+    pj_dns_resolver_destroy(resolver2, PJ_FALSE);
+    resolver2 = NULL;
+
+    if (cache_query(resolver, "shared2.cachetest.com") != 1)
+	rc = -1530;
+
+on_return:
+    if (resolver2)
+	pj_dns_resolver_destroy(resolver2, PJ_FALSE);
+    return rc;
+}
+
 ////////////////////////////////////////////////////////////////////////////
 
 
@@ -1394,6 +1964,26 @@ int resolver_test(void)
     srv_resolver_fallback_test();
     srv_resolver_many_test();
 
+    rc = srv_resolver_aaaa_test();
+    if (rc != 0)
+	goto on_error;
+
+    rc = cache_lru_test();
+    if (rc != 0)
+	goto on_error;
+
+    rc = cache_negative_test();
+    if (rc != 0)
+	goto on_error;
+
+    rc = cache_prefetch_test();
+    if (rc != 0)
+	goto on_error;
+
+    rc = cache_shared_test();
+    if (rc != 0)
+	goto on_error;
+
     destroy();
     return 0;
 
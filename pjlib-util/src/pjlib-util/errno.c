@@ -18,6 +18,7 @@
  * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA 
  */
 #include <pjlib-util/errno.h>
+#include <pjlib-util/sha1.h>
 #include <pjlib-util/types.h>
 #include <pj/assert.h>
 #include <pj/string.h>
@@ -184,5 +185,8 @@ PJ_DEF(pj_status_t) pjlib_util_init(void)
 				  &pjlib_util_strerror);
     pj_assert(status == PJ_SUCCESS);
 
+    /* Select the SHA1 implementation once, before other threads use it */
+    pj_sha1_set_impl(PJ_SHA1_IMPL_AUTO);
+
     return PJ_SUCCESS;
 }
@@ -158,6 +158,33 @@ struct cached_res
     pj_time_val		     expiry_time;   /**< Expiration time.	    */
     pj_dns_parsed_packet    *pkt;	    /**< The response packet.	    */
     unsigned		     ref_cnt;	    /**< Reference counter.	    */
+    pj_uint32_t		     ttl;	    /**< TTL, zero if not expiring. */
+    unsigned		     hit_cnt;	    /**< Number of cache hits.	    */
+    pj_bool_t		     prefetching;   /**< Being refreshed?	    */
+};
+
+
+/* Cached response list head */
+struct cache_head
+{
+    PJ_DECL_LIST_MEMBER(struct cached_res);
+};
+
+
+/* The response cache. It may be shared by several resolver instances, so
+ * it has its own mutex and reference counter. When both the resolver's and
+ * the cache's mutex are needed, the resolver's mutex must be acquired 
+ * first.
+ */
+struct pj_dns_cache
+{
+    pj_pool_t		*pool;		/**< Cache's pool.		    */
+    pj_mutex_t		*mutex;		/**< Mutex protection.		    */
+    unsigned		 ref_cnt;	/**< Reference counter.		    */
+    unsigned		 max_count;	/**< Maximum nb of entries, 0=inf.  */
+    pj_hash_table_t	*hrescache;	/**< Cached response in hash table  */
+    struct cache_head	 lru;		/**< Entries, most recently used
+					     first.			    */
 };
 
 
@@ -196,8 +223,8 @@ struct pj_dns_resolver
     /* Last DNS transaction ID used. */
     pj_uint16_t		 last_id;
 
-    /* Hash table for cached response */
-    pj_hash_table_t	*hrescache;	/**< Cached response in hash table  */
+    /* Response cache */
+    pj_dns_cache	*cache;		/**< The (possibly shared) cache.   */
 
     /* Pending asynchronous query, hashed by transaction ID. */
     pj_hash_table_t	*hquerybyid;
@@ -291,6 +318,10 @@ PJ_DEF(void) pj_dns_settings_default(pj_dns_settings *s)
     s->cache_max_ttl = PJ_DNS_RESOLVER_MAX_TTL;
     s->good_ns_ttl = PJ_DNS_RESOLVER_GOOD_NS_TTL;
     s->bad_ns_ttl = PJ_DNS_RESOLVER_BAD_NS_TTL;
+    s->cache_max_neg_ttl = PJ_DNS_RESOLVER_MAX_NEG_TTL;
+    s->cache_max_entries = PJ_DNS_RESOLVER_MAX_CACHE_ENTRIES;
+    s->prefetch_pct = PJ_DNS_RESOLVER_PREFETCH_PCT;
+    s->prefetch_min_hits = PJ_DNS_RESOLVER_PREFETCH_MIN_HITS;
 }
 
 
@@ -352,8 +383,11 @@ PJ_DEF(pj_status_t) pj_dns_resolver_create( pj_pool_factory *pf,
 	    goto on_error;
     }
 
-    /* Response cache hash table */
-    resv->hrescache = pj_hash_create(pool, RES_HASH_TABLE_SIZE);
+    /* Response cache */
+    status = pj_dns_cache_create(pf, name, resv->settings.cache_max_entries,
+				 &resv->cache);
+    if (status != PJ_SUCCESS)
+	goto on_error;
 
     /* Query hash table and free list. */
     resv->hquerybyid = pj_hash_create(pool, Q_HASH_TABLE_SIZE);
@@ -406,17 +440,10 @@ PJ_DEF(pj_status_t) pj_dns_resolver_destroy( pj_dns_resolver *resolver,
 	}
     }
 
-    /* Destroy cached entries */
-    it = pj_hash_first(resolver->hrescache, &it_buf);
-    while (it) {
-	struct cached_res *cache;
-
-	cache = (struct cached_res*) pj_hash_this(resolver->hrescache, it);
-	pj_hash_set(NULL, resolver->hrescache, &cache->key, 
-		    sizeof(cache->key), 0, NULL);
-	pj_pool_release(cache->pool);
-
-	it = pj_hash_first(resolver->hrescache, &it_buf);
+    /* Release the response cache */
+    if (resolver->cache) {
+	pj_dns_cache_dec_ref(resolver->cache);
+	resolver->cache = NULL;
     }
 
     if (resolver->own_timer && resolver->timer) {
@@ -504,6 +531,11 @@ PJ_DEF(pj_status_t) pj_dns_resolver_set_settings(pj_dns_resolver *resolver,
 
     pj_mutex_lock(resolver->mutex);
     pj_memcpy(&resolver->settings, st, sizeof(*st));
+
+    pj_mutex_lock(resolver->cache->mutex);
+    resolver->cache->max_count = st->cache_max_entries;
+    pj_mutex_unlock(resolver->cache->mutex);
+
     pj_mutex_unlock(resolver->mutex);
     return PJ_SUCCESS;
 }
@@ -731,6 +763,233 @@ static void free_entry(pj_dns_resolver *resolver, struct cached_res *cache)
     pj_pool_release(cache->pool);
 }
 
+/* Remove entry from the cache's hash table and LRU list. The entry itself
+ * is not freed.
+ */
+static void unlink_entry(pj_dns_cache *rc, struct cached_res *cache,
+			 pj_uint32_t hval)
+{
+    pj_hash_set(NULL, rc->hrescache, &cache->key, sizeof(cache->key),
+		hval, NULL);
+    pj_list_erase(cache);
+}
+
+/* Add entry to the cache as the most recently used one, evicting the
+ * least recently used entries if the cache is full.
+ */
+static void link_entry(pj_dns_resolver *resolver, pj_dns_cache *rc,
+		       struct cached_res *cache, pj_uint32_t hval)
+{
+    while (rc->max_count && pj_hash_count(rc->hrescache) >= rc->max_count &&
+	   !pj_list_empty(&rc->lru))
+    {
+	struct cached_res *lru = rc->lru.prev;
+
+	PJ_LOG(5,(resolver->name.ptr, "Evicting DNS %s record for %s from "
+		  "cache", pj_dns_get_type_name(lru->key.qtype),
+		  lru->key.name));
+
+	unlink_entry(rc, lru, 0);
+	if (--lru->ref_cnt <= 0)
+	    free_entry(resolver, lru);
+    }
+
+    pj_hash_set_np(rc->hrescache, &cache->key, sizeof(cache->key), hval,
+		   cache->hbuf, cache);
+    pj_list_push_front(&rc->lru, cache);
+}
+
+
+/*
+ * Create response cache.
+ */
+PJ_DEF(pj_status_t) pj_dns_cache_create(pj_pool_factory *pf,
+					const char *name,
+					unsigned max_entries,
+					pj_dns_cache **p_cache)
+{
+    pj_pool_t *pool;
+    pj_dns_cache *rc;
+    pj_status_t status;
+
+    PJ_ASSERT_RETURN(pf && p_cache, PJ_EINVAL);
+
+    if (name == NULL)
+	name = "dnscache%p";
+
+    pool = pj_pool_create(pf, name, 512, 512, NULL);
+    if (!pool)
+	return PJ_ENOMEM;
+
+    rc = PJ_POOL_ZALLOC_T(pool, pj_dns_cache);
+    rc->pool = pool;
+    rc->ref_cnt = 1;
+    rc->max_count = max_entries;
+    pj_list_init(&rc->lru);
+
+    status = pj_mutex_create_simple(pool, name, &rc->mutex);
+    if (status != PJ_SUCCESS) {
+	pj_pool_release(pool);
+	return status;
+    }
+
+    rc->hrescache = pj_hash_create(pool, RES_HASH_TABLE_SIZE);
+
+    *p_cache = rc;
+    return PJ_SUCCESS;
+}
+
+
+/*
+ * Add reference counter of the response cache.
+ */
+PJ_DEF(pj_status_t) pj_dns_cache_add_ref(pj_dns_cache *rc)
+{
+    PJ_ASSERT_RETURN(rc, PJ_EINVAL);
+
+    pj_mutex_lock(rc->mutex);
+    ++rc->ref_cnt;
+    pj_mutex_unlock(rc->mutex);
+
+    return PJ_SUCCESS;
+}
+
+
+/*
+ * Decrement reference counter of the response cache, and destroy it when
+ * the counter reaches zero.
+ */
+PJ_DEF(pj_status_t) pj_dns_cache_dec_ref(pj_dns_cache *rc)
+{
+    unsigned ref_cnt;
+
+    PJ_ASSERT_RETURN(rc, PJ_EINVAL);
+
+    pj_mutex_lock(rc->mutex);
+    ref_cnt = --rc->ref_cnt;
+    pj_mutex_unlock(rc->mutex);
+
+    if (ref_cnt > 0)
+	return PJ_SUCCESS;
+
+    /* Destroy cached entries */
+    while (!pj_list_empty(&rc->lru)) {
+	struct cached_res *cache = rc->lru.next;
+
+	unlink_entry(rc, cache, 0);
+	pj_pool_release(cache->pool);
+    }
+
+    pj_mutex_destroy(rc->mutex);
+    pj_pool_release(rc->pool);
+
+    return PJ_SUCCESS;
+}
+
+
+/*
+ * Replace the response cache used by the resolver.
+ */
+PJ_DEF(pj_status_t) pj_dns_resolver_set_cache(pj_dns_resolver *resolver,
+					      pj_dns_cache *cache)
+{
+    pj_dns_cache *old_cache;
+
+    PJ_ASSERT_RETURN(resolver && cache, PJ_EINVAL);
+
+    pj_dns_cache_add_ref(cache);
+
+    pj_mutex_lock(resolver->mutex);
+    old_cache = resolver->cache;
+    resolver->cache = cache;
+    pj_mutex_unlock(resolver->mutex);
+
+    pj_dns_cache_dec_ref(old_cache);
+
+    return PJ_SUCCESS;
+}
+
+
+/*
+ * Get the response cache currently used by the resolver.
+ */
+PJ_DEF(pj_dns_cache*) pj_dns_resolver_get_cache(pj_dns_resolver *resolver)
+{
+    PJ_ASSERT_RETURN(resolver, NULL);
+    return resolver->cache;
+}
+
+
+/*
+ * Get the timer heap used by the resolver.
+ */
+PJ_DEF(pj_timer_heap_t*) pj_dns_resolver_get_timer(pj_dns_resolver *resolver)
+{
+    PJ_ASSERT_RETURN(resolver, NULL);
+    return resolver->timer;
+}
+
+
+/* Check whether a cache hit should trigger refreshing the entry in the
+ * background: the entry must be popular and about to expire.
+ */
+static pj_bool_t need_prefetch(const pj_dns_resolver *resolver,
+			       const struct cached_res *cache,
+			       const pj_time_val *now)
+{
+    pj_time_val remaining;
+    unsigned window;
+
+    if (resolver->settings.prefetch_pct == 0 || cache->ttl == 0 ||
+	cache->prefetching ||
+	cache->hit_cnt < resolver->settings.prefetch_min_hits)
+    {
+	return PJ_FALSE;
+    }
+
+    window = cache->ttl * resolver->settings.prefetch_pct / 100;
+    if (window == 0)
+	return PJ_FALSE;
+
+    remaining = cache->expiry_time;
+    PJ_TIME_VAL_SUB(remaining, *now);
+
+    return PJ_TIME_VAL_MSEC(remaining) <= (long)window * 1000;
+}
+
+
+/* Assign transaction ID to a new query, transmit it, and register it in
+ * the pending query hash tables. On failure the query node is recycled.
+ */
+static pj_status_t send_new_query(pj_dns_resolver *resolver,
+				  pj_dns_async_query *q,
+				  const struct res_key *key)
+{
+    pj_status_t status;
+
+    /* Save the ID and key */
+    /* TODO: dnsext-forgery-resilient: randomize id for security */
+    q->id = resolver->last_id++;
+    if (resolver->last_id == 0)
+	resolver->last_id = 1;
+    pj_memcpy(&q->key, key, sizeof(struct res_key));
+
+    /* Send the query */
+    status = transmit_query(resolver, q);
+    if (status != PJ_SUCCESS) {
+	pj_list_push_back(&resolver->query_free_nodes, q);
+	return status;
+    }
+
+    /* Add query entry to the hash tables */
+    pj_hash_set_np(resolver->hquerybyid, &q->id, sizeof(q->id), 
+		   0, q->hbufid, q);
+    pj_hash_set_np(resolver->hquerybyres, &q->key, sizeof(q->key),
+		   0, q->hbufkey, q);
+
+    return PJ_SUCCESS;
+}
+
 
 /*
  * Create and start asynchronous DNS query for a single resource.
@@ -745,6 +1004,7 @@ PJ_DEF(pj_status_t) pj_dns_resolver_start_query( pj_dns_resolver *resolver,
 {
     pj_time_val now;
     struct res_key key;
+    pj_dns_cache *rc;
     struct cached_res *cache;
     pj_dns_async_query *q;
     pj_uint32_t hval;
@@ -775,15 +1035,17 @@ PJ_DEF(pj_status_t) pj_dns_resolver_start_query( pj_dns_resolver *resolver,
     /* First, check if we have cached response for the specified name/type,
      * and the cached entry has not expired.
      */
+    rc = resolver->cache;
+    pj_mutex_lock(rc->mutex);
+
     hval = 0;
-    cache = (struct cached_res *) pj_hash_get(resolver->hrescache, &key, 
+    cache = (struct cached_res *) pj_hash_get(rc->hrescache, &key, 
     					      sizeof(key), &hval);
     if (cache) {
 	/* We've found a cached entry. */
 
 	/* Check for expiration */
 	if (PJ_TIME_VAL_GT(cache->expiry_time, now)) {
-
 	    /* Log */
 	    PJ_LOG(5,(resolver->name.ptr, 
 		      "Picked up DNS %s record for %.*s from cache, ttl=%d",
@@ -795,11 +1057,39 @@ PJ_DEF(pj_status_t) pj_dns_resolver_start_query( pj_dns_resolver *resolver,
 	    status = PJ_DNS_GET_RCODE(cache->pkt->hdr.flags);
 	    status = PJ_STATUS_FROM_DNS_RCODE(status);
 
+	    /* Move the entry to the front of the LRU list */
+	    pj_list_erase(cache);
+	    pj_list_push_front(&rc->lru, cache);
+
+	    /* Refresh popular entries before they expire. The background
+	     * query is started now, unless there is already a pending query
+	     * for the name. The query has no callback, its response will just
+	     * update the cache.
+	     */
+	    ++cache->hit_cnt;
+	    if (need_prefetch(resolver, cache, &now) &&
+		pj_hash_get(resolver->hquerybyres, &key, sizeof(key), NULL) ==
+		    NULL)
+	    {
+		PJ_LOG(5,(resolver->name.ptr, 
+			  "Prefetching DNS %s record for %.*s",
+			  pj_dns_get_type_name(type),
+			  (int)name->slen, name->ptr));
+
+		q = alloc_qnode(resolver, 0, NULL, NULL);
+		if (send_new_query(resolver, q, &key) == PJ_SUCCESS)
+		    cache->prefetching = PJ_TRUE;
+	    }
+
 	    /* Workaround for deadlock problem. Need to increment the cache's
 	     * ref counter first before releasing mutex, so the cache won't be
-	     * destroyed by other thread while in callback.
+	     * destroyed by other thread while in callback. The response cache
+	     * itself is referenced too, since the resolver may switch to
+	     * another cache in the meantime.
 	     */
 	    cache->ref_cnt++;
+	    rc->ref_cnt++;
+	    pj_mutex_unlock(rc->mutex);
 	    pj_mutex_unlock(resolver->mutex);
 
 	    /* This cached response is still valid. Just return this
@@ -809,26 +1099,28 @@ PJ_DEF(pj_status_t) pj_dns_resolver_start_query( pj_dns_resolver *resolver,
 		(*cb)(user_data, status, cache->pkt);
 	    }
 
-	    /* Done. No host resolution is necessary */
-	    pj_mutex_lock(resolver->mutex);
-
-	    /* Decrement the ref counter. Also check if it is time to free
-	     * the cache (as it has been expired).
+	    /* Done. No host resolution is necessary. Decrement the ref
+	     * counter, and free the entry if it has been removed from the
+	     * cache in the meantime.
 	     */
+	    pj_mutex_lock(rc->mutex);
 	    cache->ref_cnt--;
 	    if (cache->ref_cnt <= 0)
 		free_entry(resolver, cache);
+	    pj_mutex_unlock(rc->mutex);
 
-	    /* Must return PJ_SUCCESS */
-	    status = PJ_SUCCESS;
+	    pj_dns_cache_dec_ref(rc);
 
-	    goto on_return;
+	    /* Must return PJ_SUCCESS. The resolver's mutex has been
+	     * released already.
+	     */
+	    return PJ_SUCCESS;
 	}
 
 	/* At this point, we have a cached entry, but this entry has expired.
 	 * Remove this entry from the cached list.
 	 */
-	pj_hash_set(NULL, resolver->hrescache, &key, sizeof(key), 0, NULL);
+	unlink_entry(rc, cache, hval);
 
 	/* Also free the cache, if it is not being used (by callback). */
 	cache->ref_cnt--;
@@ -838,6 +1130,8 @@ PJ_DEF(pj_status_t) pj_dns_resolver_start_query( pj_dns_resolver *resolver,
 	/* Must continue with creating a query now */
     }
 
+    pj_mutex_unlock(rc->mutex);
+
     /* Next, check if we have pending query on the same resource */
     q = (pj_dns_async_query *) pj_hash_get(resolver->hquerybyres, &key, 
     					   sizeof(key), NULL);
@@ -851,6 +1145,10 @@ PJ_DEF(pj_status_t) pj_dns_resolver_start_query( pj_dns_resolver *resolver,
 	nq = alloc_qnode(resolver, options, user_data, cb);
 	pj_list_push_back(&q->child_head, nq);
 
+	/* Return the child query so that it can be cancelled */
+	if (p_query)
+	    *p_query = nq;
+
 	/* Done. This child query will be notified once the "parent"
 	 * query completes.
 	 */
@@ -861,25 +1159,9 @@ PJ_DEF(pj_status_t) pj_dns_resolver_start_query( pj_dns_resolver *resolver,
     /* There's no pending query to the same key, initiate a new one. */
     q = alloc_qnode(resolver, options, user_data, cb);
 
-    /* Save the ID and key */
-    /* TODO: dnsext-forgery-resilient: randomize id for security */
-    q->id = resolver->last_id++;
-    if (resolver->last_id == 0)
-	resolver->last_id = 1;
-    pj_memcpy(&q->key, &key, sizeof(struct res_key));
-
-    /* Send the query */
-    status = transmit_query(resolver, q);
-    if (status != PJ_SUCCESS) {
-	pj_list_push_back(&resolver->query_free_nodes, q);
+    status = send_new_query(resolver, q, &key);
+    if (status != PJ_SUCCESS)
 	goto on_return;
-    }
-
-    /* Add query entry to the hash tables */
-    pj_hash_set_np(resolver->hquerybyid, &q->id, sizeof(q->id), 
-		   0, q->hbufid, q);
-    pj_hash_set_np(resolver->hquerybyres, &q->key, sizeof(q->key),
-		   0, q->hbufkey, q);
 
     if (p_query)
 	*p_query = q;
@@ -913,23 +1195,24 @@ PJ_DEF(pj_status_t) pj_dns_resolver_cancel_query(pj_dns_async_query *query,
 }
 
 
-/* 
- * DNS response containing A packet. 
+/*
+ * Find the name owning the address records in the DNS response, following
+ * CNAME chain if necessary. The query name and the first CNAME alias are
+ * copied to the record buffer.
  */
-PJ_DEF(pj_status_t) pj_dns_parse_a_response(const pj_dns_parsed_packet *pkt,
-					    pj_dns_a_record *rec)
+static pj_status_t parse_addr_names(const pj_dns_parsed_packet *pkt,
+				    char *buf, pj_size_t bufsize,
+				    pj_str_t *name, pj_str_t *alias,
+				    const pj_str_t **p_resname,
+				    pj_dns_type *p_type)
 {
     enum { MAX_SEARCH = 20 };
-    pj_str_t hostname, alias = {NULL, 0}, *resname;
+    pj_str_t hostname, cname = {NULL, 0};
+    const pj_str_t *resname;
     pj_size_t bufstart = 0;
-    pj_size_t bufleft = sizeof(rec->buf_);
+    pj_size_t bufleft = bufsize;
     unsigned i, ansidx, search_cnt=0;
 
-    PJ_ASSERT_RETURN(pkt && rec, PJ_EINVAL);
-
-    /* Init the record */
-    pj_bzero(rec, sizeof(pj_dns_a_record));
-
     /* Return error if there's error in the packet. */
     if (PJ_DNS_GET_RCODE(pkt->hdr.flags))
 	return PJ_STATUS_FROM_DNS_RCODE(PJ_DNS_GET_RCODE(pkt->hdr.flags));
@@ -950,9 +1233,9 @@ PJ_DEF(pj_status_t) pj_dns_parse_a_response(const pj_dns_parsed_packet *pkt,
 	return PJ_ENAMETOOLONG;
     }
 
-    pj_memcpy(&rec->buf_[bufstart], hostname.ptr, hostname.slen);
-    rec->name.ptr = &rec->buf_[bufstart];
-    rec->name.slen = hostname.slen;
+    pj_memcpy(&buf[bufstart], hostname.ptr, hostname.slen);
+    name->ptr = &buf[bufstart];
+    name->slen = hostname.slen;
 
     bufstart += hostname.slen;
     bufleft -= hostname.slen;
@@ -966,7 +1249,7 @@ PJ_DEF(pj_status_t) pj_dns_parse_a_response(const pj_dns_parsed_packet *pkt,
     if (ansidx == pkt->hdr.anscount)
 	return PJLIB_UTIL_EDNSNOANSWERREC;
 
-    resname = &hostname;
+    resname = &pkt->q[0].name;
 
     /* Keep following CNAME records. */
     while (pkt->ans[ansidx].type == PJ_DNS_TYPE_CNAME &&
@@ -974,8 +1257,8 @@ PJ_DEF(pj_status_t) pj_dns_parse_a_response(const pj_dns_parsed_packet *pkt,
     {
 	resname = &pkt->ans[ansidx].rdata.cname.name;
 
-	if (!alias.slen)
-	    alias = *resname;
+	if (!cname.slen)
+	    cname = *resname;
 
 	for (i=0; i < pkt->hdr.anscount; ++i) {
 	    if (pj_stricmp(resname, &pkt->ans[i].name)==0) {
@@ -992,22 +1275,47 @@ PJ_DEF(pj_status_t) pj_dns_parse_a_response(const pj_dns_parsed_packet *pkt,
     if (search_cnt >= MAX_SEARCH)
 	return PJLIB_UTIL_EDNSINANSWER;
 
-    if (pkt->ans[ansidx].type != PJ_DNS_TYPE_A)
-	return PJLIB_UTIL_EDNSINANSWER;
-
     /* Copy alias to the record, if present. */
-    if (alias.slen) {
-	if (alias.slen > (int)bufleft)
+    if (cname.slen) {
+	if (cname.slen > (int)bufleft)
 	    return PJ_ENAMETOOLONG;
 
-	pj_memcpy(&rec->buf_[bufstart], alias.ptr, alias.slen);
-	rec->alias.ptr = &rec->buf_[bufstart];
-	rec->alias.slen = alias.slen;
-
-	bufstart += alias.slen;
-	bufleft -= alias.slen;
+	pj_memcpy(&buf[bufstart], cname.ptr, cname.slen);
+	alias->ptr = &buf[bufstart];
+	alias->slen = cname.slen;
     }
 
+    *p_resname = resname;
+    *p_type = pkt->ans[ansidx].type;
+
+    return PJ_SUCCESS;
+}
+
+
+/* 
+ * DNS response containing A packet. 
+ */
+PJ_DEF(pj_status_t) pj_dns_parse_a_response(const pj_dns_parsed_packet *pkt,
+					    pj_dns_a_record *rec)
+{
+    const pj_str_t *resname;
+    pj_dns_type type;
+    unsigned i;
+    pj_status_t status;
+
+    PJ_ASSERT_RETURN(pkt && rec, PJ_EINVAL);
+
+    /* Init the record */
+    pj_bzero(rec, sizeof(pj_dns_a_record));
+
+    status = parse_addr_names(pkt, rec->buf_, sizeof(rec->buf_),
+			      &rec->name, &rec->alias, &resname, &type);
+    if (status != PJ_SUCCESS)
+	return status;
+
+    if (type != PJ_DNS_TYPE_A)
+	return PJLIB_UTIL_EDNSINANSWER;
+
     /* Get the IP addresses. */
     for (i=0; i < pkt->hdr.anscount; ++i) {
 	if (pkt->ans[i].type == PJ_DNS_TYPE_A &&
@@ -1026,6 +1334,56 @@ PJ_DEF(pj_status_t) pj_dns_parse_a_response(const pj_dns_parsed_packet *pkt,
 }
 
 
+/* 
+ * DNS response containing A and/or AAAA packet. 
+ */
+PJ_DEF(pj_status_t) pj_dns_parse_addr_response(
+					    const pj_dns_parsed_packet *pkt,
+					    pj_dns_addr_record *rec)
+{
+    const pj_str_t *resname;
+    pj_dns_type type;
+    unsigned i;
+    pj_status_t status;
+
+    PJ_ASSERT_RETURN(pkt && rec, PJ_EINVAL);
+
+    /* Init the record */
+    pj_bzero(rec, sizeof(pj_dns_addr_record));
+
+    status = parse_addr_names(pkt, rec->buf_, sizeof(rec->buf_),
+			      &rec->name, &rec->alias, &resname, &type);
+    if (status != PJ_SUCCESS)
+	return status;
+
+    if (type != PJ_DNS_TYPE_A && type != PJ_DNS_TYPE_AAAA)
+	return PJLIB_UTIL_EDNSINANSWER;
+
+    /* Get the IP addresses of both families. */
+    for (i=0; i < pkt->hdr.anscount &&
+	      rec->addr_count < PJ_DNS_MAX_IP_IN_A_REC; ++i)
+    {
+	if (pj_stricmp(&pkt->ans[i].name, resname) != 0)
+	    continue;
+
+	if (pkt->ans[i].type == PJ_DNS_TYPE_A) {
+	    rec->addr[rec->addr_count].af = pj_AF_INET();
+	    rec->addr[rec->addr_count].ip.v4 = pkt->ans[i].rdata.a.ip_addr;
+	    ++rec->addr_count;
+	} else if (pkt->ans[i].type == PJ_DNS_TYPE_AAAA) {
+	    rec->addr[rec->addr_count].af = pj_AF_INET6();
+	    rec->addr[rec->addr_count].ip.v6 = pkt->ans[i].rdata.aaaa.ip_addr;
+	    ++rec->addr_count;
+	}
+    }
+
+    if (rec->addr_count == 0)
+	return PJLIB_UTIL_EDNSNOANSWERREC;
+
+    return PJ_SUCCESS;
+}
+
+
 /* Set nameserver state */
 static void set_nameserver_state(pj_dns_resolver *resolver,
 				 unsigned index,
@@ -1183,6 +1541,56 @@ static void report_nameserver_status(pj_dns_resolver *resolver,
 }
 
 
+/* Get the TTL of a negative response (NXDOMAIN or NODATA), which is the
+ * minimum of the SOA record's TTL and its MINIMUM field (RFC 2308 section
+ * 5). The SOA record in the authority section is not parsed by the DNS
+ * parser, but MINIMUM is simply the last four octets of its rdata.
+ */
+static pj_uint32_t get_neg_ttl(const pj_dns_parsed_packet *pkt)
+{
+    unsigned i;
+
+    for (i=0; i<pkt->hdr.nscount; ++i) {
+	const pj_dns_parsed_rr *rr = &pkt->ns[i];
+	pj_uint32_t minimum;
+
+	/* SOA rdata is two names (at least one octet each) followed by
+	 * five 32bit fields.
+	 */
+	if (rr->type != PJ_DNS_TYPE_SOA || rr->data == NULL ||
+	    rr->rdlength < 22)
+	{
+	    continue;
+	}
+
+	pj_memcpy(&minimum, (const pj_uint8_t*)rr->data + rr->rdlength - 4, 4);
+	minimum = pj_ntohl(minimum);
+
+	return (rr->ttl < minimum) ? rr->ttl : minimum;
+    }
+
+    return PJ_DNS_RESOLVER_INVALID_TTL;
+}
+
+
+/* Allow a cached entry to be prefetched again after its background query
+ * has completed without a usable response.
+ */
+static void clear_prefetching(pj_dns_resolver *resolver,
+			      const struct res_key *key)
+{
+    pj_dns_cache *rc = resolver->cache;
+    struct cached_res *cache;
+
+    pj_mutex_lock(rc->mutex);
+    cache = (struct cached_res *) pj_hash_get(rc->hrescache, key,
+					      sizeof(*key), NULL);
+    if (cache)
+	cache->prefetching = PJ_FALSE;
+    pj_mutex_unlock(rc->mutex);
+}
+
+
 /* Update response cache */
 static void update_res_cache(pj_dns_resolver *resolver,
 			     const struct res_key *key,
@@ -1190,28 +1598,59 @@ static void update_res_cache(pj_dns_resolver *resolver,
 			     pj_bool_t set_expiry,
 			     const pj_dns_parsed_packet *pkt)
 {
+    pj_dns_cache *rc = resolver->cache;
     struct cached_res *cache;
     pj_uint32_t hval=0, ttl;
+    unsigned hit_cnt = 0;
+
+    pj_mutex_lock(rc->mutex);
 
-    /* If status is unsuccessful, clear the same entry from the cache */
+    /* If status is unsuccessful, clear the same entry from the cache. An
+     * entry which has not expired yet (i.e. the response is for a prefetch
+     * query) is kept though, unless the name does not exist anymore, as
+     * the error (e.g. SERVFAIL) is most likely temporary.
+     */
     if (status != PJ_SUCCESS) {
-	cache = (struct cached_res *) pj_hash_get(resolver->hrescache, key, 
+	cache = (struct cached_res *) pj_hash_get(rc->hrescache, key, 
 						  sizeof(*key), &hval);
-	/* Remove the entry before releasing its pool (see ticket #1710) */
-	pj_hash_set(NULL, resolver->hrescache, key, sizeof(*key), hval, NULL);
+	if (cache && status != PJ_STATUS_FROM_DNS_RCODE(PJ_DNS_RCODE_NXDOMAIN))
+	{
+	    pj_time_val now;
+
+	    pj_gettimeofday(&now);
+	    if (PJ_TIME_VAL_GT(cache->expiry_time, now)) {
+		cache->prefetching = PJ_FALSE;
+		pj_mutex_unlock(rc->mutex);
+		return;
+	    }
+	}
+	if (cache) {
+	    /* Remove the entry before releasing its pool (see ticket #1710) */
+	    unlink_entry(rc, cache, hval);
 	
-	/* Free the entry */
-	if (cache && --cache->ref_cnt <= 0)
-	    free_entry(resolver, cache);
+	    /* Free the entry */
+	    if (--cache->ref_cnt <= 0)
+		free_entry(resolver, cache);
+	}
     }
 
 
     /* Calculate expiration time. */
     if (set_expiry) {
-	if (pkt->hdr.anscount == 0 || status != PJ_SUCCESS) {
-	    /* If we don't have answers for the name, then give a different
-	     * ttl value (note: PJ_DNS_RESOLVER_INVALID_TTL may be zero, 
-	     * which means that invalid names won't be kept in the cache)
+	if (status == PJ_STATUS_FROM_DNS_RCODE(PJ_DNS_RCODE_NXDOMAIN) ||
+	    (status == PJ_SUCCESS && pkt->hdr.anscount == 0))
+	{
+	    /* Negative response, the TTL is taken from the SOA record
+	     * if there is one (see RFC 2308).
+	     */
+	    ttl = get_neg_ttl(pkt);
+	    if (ttl > resolver->settings.cache_max_neg_ttl)
+		ttl = resolver->settings.cache_max_neg_ttl;
+
+	} else if (status != PJ_SUCCESS) {
+	    /* For other errors, give a different ttl value (note: 
+	     * PJ_DNS_RESOLVER_INVALID_TTL may be zero, which means that 
+	     * invalid names won't be kept in the cache)
 	     */
 	    ttl = PJ_DNS_RESOLVER_INVALID_TTL;
 
@@ -1234,35 +1673,43 @@ static void update_res_cache(pj_dns_resolver *resolver,
 
     /* If TTL is zero, clear the same entry in the hash table */
     if (ttl == 0) {
-	cache = (struct cached_res *) pj_hash_get(resolver->hrescache, key, 
+	cache = (struct cached_res *) pj_hash_get(rc->hrescache, key, 
 						  sizeof(*key), &hval);
-	/* Remove the entry before releasing its pool (see ticket #1710) */
-	pj_hash_set(NULL, resolver->hrescache, key, sizeof(*key), hval, NULL);
+	if (cache) {
+	    /* Remove the entry before releasing its pool (see ticket #1710) */
+	    unlink_entry(rc, cache, hval);
 
-	/* Free the entry */
-	if (cache && --cache->ref_cnt <= 0)
-	    free_entry(resolver, cache);
+	    /* Free the entry */
+	    if (--cache->ref_cnt <= 0)
+		free_entry(resolver, cache);
+	}
+	pj_mutex_unlock(rc->mutex);
 	return;
     }
 
     /* Get a cache response entry */
-    cache = (struct cached_res *) pj_hash_get(resolver->hrescache, key, 
+    cache = (struct cached_res *) pj_hash_get(rc->hrescache, key, 
     					      sizeof(*key), &hval);
     if (cache == NULL) {
 	cache = alloc_entry(resolver);
-    } else if (cache->ref_cnt > 1) {
-	/* When cache entry is being used by callback (to app), just decrement
-	 * ref_cnt so it will be freed after the callback returns and allocate
-	 * new entry.
-	 */
-	cache->ref_cnt--;
-	cache = alloc_entry(resolver);
     } else {
+	/* Keep the popularity of the name across refreshes */
+	hit_cnt = cache->hit_cnt;
+
 	/* Remove the entry before resetting its pool (see ticket #1710) */
-	pj_hash_set(NULL, resolver->hrescache, key, sizeof(*key), hval, NULL);
+	unlink_entry(rc, cache, hval);
 
-	/* Reset cache to avoid bloated cache pool */
-	reset_entry(&cache);
+	if (cache->ref_cnt > 1) {
+	    /* When cache entry is being used by callback (to app), just 
+	     * decrement ref_cnt so it will be freed after the callback 
+	     * returns and allocate new entry.
+	     */
+	    cache->ref_cnt--;
+	    cache = alloc_entry(resolver);
+	} else {
+	    /* Reset cache to avoid bloated cache pool */
+	    reset_entry(&cache);
+	}
     }
 
     /* Duplicate the packet.
@@ -1279,18 +1726,20 @@ static void update_res_cache(pj_dns_resolver *resolver,
     if (set_expiry) {
 	pj_gettimeofday(&cache->expiry_time);
 	cache->expiry_time.sec += ttl;
+	cache->ttl = ttl;
     } else {
 	cache->expiry_time.sec = 0x7FFFFFFFL;
 	cache->expiry_time.msec = 0;
     }
+    cache->hit_cnt = hit_cnt;
 
     /* Copy key to the cached response */
     pj_memcpy(&cache->key, key, sizeof(*key));
 
-    /* Update the hash table */
-    pj_hash_set_np(resolver->hrescache, &cache->key, sizeof(*key), hval,
-		   cache->hbuf, cache);
+    /* Update the hash table and LRU list */
+    link_entry(resolver, rc, cache, hval);
 
+    pj_mutex_unlock(rc->mutex);
 }
 
 
@@ -1344,6 +1793,11 @@ static void on_timeout( pj_timer_heap_t *timer_heap,
     pj_hash_set(NULL, resolver->hquerybyid, &q->id, sizeof(q->id), 0, NULL);
     pj_hash_set(NULL, resolver->hquerybyres, &q->key, sizeof(q->key), 0, NULL);
 
+    /* If this was a prefetch query, the cached entry may be refreshed
+     * again on its next hit.
+     */
+    clear_prefetching(resolver, &q->key);
+
     /* Workaround for deadlock problem in #1565 (similar to #1108) */
     pj_mutex_unlock(resolver->mutex);
 
@@ -1608,7 +2062,9 @@ PJ_DEF(unsigned) pj_dns_resolver_get_cached_count(pj_dns_resolver *resolver)
     PJ_ASSERT_RETURN(resolver, 0);
 
     pj_mutex_lock(resolver->mutex);
-    count = pj_hash_count(resolver->hrescache);
+    pj_mutex_lock(resolver->cache->mutex);
+    count = pj_hash_count(resolver->cache->hrescache);
+    pj_mutex_unlock(resolver->cache->mutex);
     pj_mutex_unlock(resolver->mutex);
 
     return count;
@@ -1644,21 +2100,23 @@ PJ_DEF(void) pj_dns_resolver_dump(pj_dns_resolver *resolver,
 		  PJ_TIME_VAL_MSEC(ns->rt_delay)));
     }
 
-    PJ_LOG(3,(resolver->name.ptr, "  Nb. of cached responses: %u",
-	      pj_hash_count(resolver->hrescache)));
+    pj_mutex_lock(resolver->cache->mutex);
+    PJ_LOG(3,(resolver->name.ptr, "  Nb. of cached responses: %u (max %u)",
+	      pj_hash_count(resolver->cache->hrescache),
+	      resolver->cache->max_count));
     if (detail) {
-	pj_hash_iterator_t itbuf, *it;
-	it = pj_hash_first(resolver->hrescache, &itbuf);
-	while (it) {
-	    struct cached_res *cache;
-	    cache = (struct cached_res*)pj_hash_this(resolver->hrescache, it);
+	struct cached_res *cache = resolver->cache->lru.next;
+	while (cache != (struct cached_res*)&resolver->cache->lru) {
 	    PJ_LOG(3,(resolver->name.ptr, 
-		      "   Type %s: %s",
+		      "   Type %s: %s (ttl=%ds, hits=%u)",
 		      pj_dns_get_type_name(cache->key.qtype), 
-		      cache->key.name));
-	    it = pj_hash_next(resolver->hrescache, it);
+		      cache->key.name,
+		      (int)(cache->expiry_time.sec - now.sec),
+		      cache->hit_cnt));
+	    cache = cache->next;
 	}
     }
+    pj_mutex_unlock(resolver->cache->mutex);
     PJ_LOG(3,(resolver->name.ptr, "  Nb. of pending queries: %u (%u)",
 	      pj_hash_count(resolver->hquerybyid),
 	      pj_hash_count(resolver->hquerybyres)));
@@ -100,12 +100,36 @@ A million repetitions of "a"
 #include "sha1.h"
 */
 #include <pjlib-util/sha1.h>
+#include <pjlib-util/config.h>
+#include <pj/errno.h>
 #include <pj/string.h>
 
 #undef SHA1HANDSOFF
 
+/* Intel SHA extensions, with run-time detection */
+#if defined(PJ_SHA1_HAS_HW_ACCEL) && PJ_SHA1_HAS_HW_ACCEL!=0 && \
+    (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+#   define SHA1_HAS_SHANI   1
+#   include <cpuid.h>
+#   include <immintrin.h>
+#else
+#   define SHA1_HAS_SHANI   0
+#endif
 
-static void SHA1_Transform(pj_uint32_t state[5], pj_uint8_t buffer[64]);
+/* OpenSSL libcrypto */
+#if defined(PJ_SHA1_HAS_OPENSSL) && PJ_SHA1_HAS_OPENSSL!=0 && \
+    defined(PJ_HAS_SSL_SOCK) && PJ_HAS_SSL_SOCK!=0
+#   define SHA1_HAS_OPENSSL 1
+    /* SHA1_Transform() is deprecated in OpenSSL 3.0 but still provided */
+#   define OPENSSL_SUPPRESS_DEPRECATED
+#   include <openssl/sha.h>
+#else
+#   define SHA1_HAS_OPENSSL 0
+#endif
+
+
+static void sha1_transform(pj_uint32_t state[5], pj_uint8_t buffer[64]);
 
 #define rol(value, bits) (((value) << (bits)) | ((value) >> (32 - (bits))))
 
@@ -131,7 +155,7 @@ static void SHA1_Transform(pj_uint32_t state[5], pj_uint8_t buffer[64]);
 
 
 /* Hash a single 512-bit block. This is the core of the algorithm. */
-static void SHA1_Transform(pj_uint32_t state[5], pj_uint8_t buffer[64])
+static void sha1_transform(pj_uint32_t state[5], pj_uint8_t buffer[64])
 {
     pj_uint32_t a, b, c, d, e;
     typedef union {
@@ -189,6 +213,191 @@ static void SHA1_Transform(pj_uint32_t state[5], pj_uint8_t buffer[64])
 }
 
 
+/*
+ * Block functions. Each processes nblocks of 64 bytes from data, which
+ * must not be modified.
+ */
+typedef void (*sha1_blocks_func)(pj_uint32_t state[5], 
+				 const pj_uint8_t *data,
+				 pj_size_t nblocks);
+
+static void sha1_blocks_generic(pj_uint32_t state[5], 
+				const pj_uint8_t *data,
+				pj_size_t nblocks)
+{
+    /* sha1_transform() modifies the block, so work on a copy */
+    pj_uint8_t tmp[64];
+
+    for ( ; nblocks; --nblocks, data += 64) {
+	pj_memcpy(tmp, data, 64);
+	sha1_transform(state, tmp);
+    }
+}
+
+
+#if SHA1_HAS_SHANI
+/* Four rounds of SHA1 with the SHA extensions. The message schedule of
+ * the following blocks is computed in parallel with the rounds, hence the
+ * conditions, which are all evaluated at compile time.
+ */
+#define SHANI_ROUNDS4(k, E, E_NEXT) \
+    if ((k) == 0) \
+	E = _mm_add_epi32(E, M[0]); \
+    else \
+	E = _mm_sha1nexte_epu32(E, M[(k)&3]); \
+    E_NEXT = ABCD; \
+    if ((k) >= 3 && (k) <= 18) \
+	M[((k)+1)&3] = _mm_sha1msg2_epu32(M[((k)+1)&3], M[(k)&3]); \
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E, (k)/5); \
+    if ((k) >= 1 && (k) <= 16) \
+	M[((k)+3)&3] = _mm_sha1msg1_epu32(M[((k)+3)&3], M[(k)&3]); \
+    if ((k) >= 2 && (k) <= 17) \
+	M[((k)+2)&3] = _mm_xor_si128(M[((k)+2)&3], M[(k)&3])
+
+__attribute__((target("sha,ssse3,sse4.1")))
+static void sha1_blocks_shani(pj_uint32_t state[5], 
+			      const pj_uint8_t *data,
+			      pj_size_t nblocks)
+{
+    const __m128i MASK = _mm_set_epi64x(0x0001020304050607ULL,
+					0x08090a0b0c0d0e0fULL);
+    __m128i ABCD, ABCD_SAVE, E0, E0_SAVE, E1;
+    __m128i M[4];
+    unsigned i;
+
+    ABCD = _mm_loadu_si128((const __m128i*)state);
+    ABCD = _mm_shuffle_epi32(ABCD, 0x1B);
+    E0 = _mm_set_epi32((int)state[4], 0, 0, 0);
+
+    for ( ; nblocks; --nblocks, data += 64) {
+	ABCD_SAVE = ABCD;
+	E0_SAVE = E0;
+
+	for (i=0; i<4; ++i) {
+	    M[i] = _mm_loadu_si128((const __m128i*)(data + i*16));
+	    M[i] = _mm_shuffle_epi8(M[i], MASK);
+	}
+
+	SHANI_ROUNDS4( 0, E0, E1); SHANI_ROUNDS4( 1, E1, E0);
+	SHANI_ROUNDS4( 2, E0, E1); SHANI_ROUNDS4( 3, E1, E0);
+	SHANI_ROUNDS4( 4, E0, E1); SHANI_ROUNDS4( 5, E1, E0);
+	SHANI_ROUNDS4( 6, E0, E1); SHANI_ROUNDS4( 7, E1, E0);
+	SHANI_ROUNDS4( 8, E0, E1); SHANI_ROUNDS4( 9, E1, E0);
+	SHANI_ROUNDS4(10, E0, E1); SHANI_ROUNDS4(11, E1, E0);
+	SHANI_ROUNDS4(12, E0, E1); SHANI_ROUNDS4(13, E1, E0);
+	SHANI_ROUNDS4(14, E0, E1); SHANI_ROUNDS4(15, E1, E0);
+	SHANI_ROUNDS4(16, E0, E1); SHANI_ROUNDS4(17, E1, E0);
+	SHANI_ROUNDS4(18, E0, E1); SHANI_ROUNDS4(19, E1, E0);
+
+	E0 = _mm_sha1nexte_epu32(E0, E0_SAVE);
+	ABCD = _mm_add_epi32(ABCD, ABCD_SAVE);
+    }
+
+    ABCD = _mm_shuffle_epi32(ABCD, 0x1B);
+    _mm_storeu_si128((__m128i*)state, ABCD);
+    state[4] = (pj_uint32_t)_mm_extract_epi32(E0, 3);
+}
+
+#undef SHANI_ROUNDS4
+
+static pj_bool_t sha1_shani_supported(void)
+{
+    unsigned eax, ebx, ecx, edx;
+
+    if (__get_cpuid_max(0, NULL) < 7)
+	return PJ_FALSE;
+
+    /* SSSE3 and SSE4.1 */
+    __cpuid(1, eax, ebx, ecx, edx);
+    if ((ecx & (1 << 9)) == 0 || (ecx & (1 << 19)) == 0)
+	return PJ_FALSE;
+
+    /* SHA */
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    return (ebx & (1 << 29)) != 0;
+}
+#endif	/* SHA1_HAS_SHANI */
+
+
+#if SHA1_HAS_OPENSSL
+static void sha1_blocks_openssl(pj_uint32_t state[5], 
+				const pj_uint8_t *data,
+				pj_size_t nblocks)
+{
+    SHA_CTX c;
+
+    c.h0 = state[0];
+    c.h1 = state[1];
+    c.h2 = state[2];
+    c.h3 = state[3];
+    c.h4 = state[4];
+
+    for ( ; nblocks; --nblocks, data += 64)
+	SHA1_Transform(&c, data);
+
+    state[0] = c.h0;
+    state[1] = c.h1;
+    state[2] = c.h2;
+    state[3] = c.h3;
+    state[4] = c.h4;
+}
+#endif	/* SHA1_HAS_OPENSSL */
+
+
+/* The active block function. It starts with the portable implementation,
+ * pjlib_util_init() selects the best one before any thread can use it.
+ */
+static sha1_blocks_func sha1_blocks = &sha1_blocks_generic;
+static pj_sha1_impl sha1_impl = PJ_SHA1_IMPL_GENERIC;
+
+static pj_status_t sha1_select_impl(pj_sha1_impl impl)
+{
+    switch (impl) {
+    case PJ_SHA1_IMPL_AUTO:
+#if SHA1_HAS_SHANI
+	if (sha1_shani_supported())
+	    return sha1_select_impl(PJ_SHA1_IMPL_HW);
+#endif
+	return sha1_select_impl(PJ_SHA1_IMPL_GENERIC);
+
+    case PJ_SHA1_IMPL_GENERIC:
+	sha1_blocks = &sha1_blocks_generic;
+	break;
+
+#if SHA1_HAS_SHANI
+    case PJ_SHA1_IMPL_HW:
+	if (!sha1_shani_supported())
+	    return PJ_ENOTSUP;
+	sha1_blocks = &sha1_blocks_shani;
+	break;
+#endif
+
+#if SHA1_HAS_OPENSSL
+    case PJ_SHA1_IMPL_OPENSSL:
+	sha1_blocks = &sha1_blocks_openssl;
+	break;
+#endif
+
+    default:
+	return PJ_ENOTSUP;
+    }
+
+    sha1_impl = impl;
+    return PJ_SUCCESS;
+}
+
+PJ_DEF(pj_status_t) pj_sha1_set_impl(pj_sha1_impl impl)
+{
+    return sha1_select_impl(impl);
+}
+
+
+PJ_DEF(pj_sha1_impl) pj_sha1_get_impl(void)
+{
+    return sha1_impl;
+}
+
+
 /* SHA1Init - Initialize new context */
 PJ_DEF(void) pj_sha1_init(pj_sha1_context* context)
 {
@@ -206,7 +415,7 @@ PJ_DEF(void) pj_sha1_init(pj_sha1_context* context)
 PJ_DEF(void) pj_sha1_update(pj_sha1_context* context, 
 			    const pj_uint8_t* data, const pj_size_t len)
 {
-    pj_size_t i, j;
+    pj_size_t i, j, nblocks;
 
     j = (context->count[0] >> 3) & 63;
     if ((context->count[0] += (pj_uint32_t)len << 3) < (len << 3)) 
@@ -214,12 +423,14 @@ PJ_DEF(void) pj_sha1_update(pj_sha1_context* context,
     context->count[1] += ((pj_uint32_t)len >> 29);
     if ((j + len) > 63) {
         pj_memcpy(&context->buffer[j], data, (i = 64-j));
-        SHA1_Transform(context->state, context->buffer);
-        for ( ; i + 63 < len; i += 64) {
-	    pj_uint8_t tmp[64];
-	    pj_memcpy(tmp, data + i, 64);
-            SHA1_Transform(context->state, tmp);
-        }
+        (*sha1_blocks)(context->state, context->buffer, 1);
+
+	/* Process the whole blocks directly from the input */
+	nblocks = (len - i) / 64;
+	if (nblocks) {
+	    (*sha1_blocks)(context->state, data + i, nblocks);
+	    i += nblocks * 64;
+	}
         j = 0;
     }
     else i = 0;
@@ -232,18 +443,19 @@ PJ_DEF(void) pj_sha1_update(pj_sha1_context* context,
 PJ_DEF(void) pj_sha1_final(pj_sha1_context* context, 
 			   pj_uint8_t digest[PJ_SHA1_DIGEST_SIZE])
 {
-    pj_uint32_t i;
+    static const pj_uint8_t padding[64] = { 0x80 };
+    pj_uint32_t i, idx;
     pj_uint8_t  finalcount[8];
 
     for (i = 0; i < 8; i++) {
         finalcount[i] = (unsigned char)((context->count[(i >= 4 ? 0 : 1)]
          >> ((3-(i & 3)) * 8) ) & 255);  /* Endian independent */
     }
-    pj_sha1_update(context, (pj_uint8_t *)"\200", 1);
-    while ((context->count[0] & 504) != 448) {
-        pj_sha1_update(context, (pj_uint8_t *)"\0", 1);
-    }
-    pj_sha1_update(context, finalcount, 8);  /* Should cause a SHA1_Transform() */
+
+    /* Pad to 56 mod 64 in a single update */
+    idx = (context->count[0] >> 3) & 63;
+    pj_sha1_update(context, padding, (idx < 56) ? (56 - idx) : (120 - idx));
+    pj_sha1_update(context, finalcount, 8);  /* Should cause a sha1_transform() */
     for (i = 0; i < PJ_SHA1_DIGEST_SIZE; i++) {
         digest[i] = (pj_uint8_t)
          ((context->state[i>>2] >> ((3-(i & 3)) * 8) ) & 255);
@@ -257,7 +469,6 @@ PJ_DEF(void) pj_sha1_final(pj_sha1_context* context,
     pj_memset(finalcount, 0, 8);	/* SWR */
 
 #ifdef SHA1HANDSOFF  /* make SHA1Transform overwrite its own static vars */
-    SHA1_Transform(context->state, context->buffer);
+    sha1_transform(context->state, context->buffer);
 #endif
 }
-
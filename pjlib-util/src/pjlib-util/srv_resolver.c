@@ -26,6 +26,7 @@
 #include <pj/pool.h>
 #include <pj/rand.h>
 #include <pj/string.h>
+#include <pj/timer.h>
 
 
 #define THIS_FILE   "srv_resolver.c"
@@ -37,12 +38,21 @@ struct common
     pj_dns_type		     type;	    /**< Type of this structure.*/
 };
 
+/* User data of DNS A or AAAA query of a target */
+struct host_query
+{
+    struct common	    common;	    /**< A or AAAA.		    */
+    struct srv_target	   *target;	    /**< The target.		    */
+    pj_dns_async_query	   *q;		    /**< Pending query, if any.	    */
+};
+
 struct srv_target
 {
-    struct common	    common;
     pj_dns_srv_async_query *parent;
     pj_str_t		    target_name;
-    pj_dns_async_query	   *q_a;
+    struct host_query	    a_query;
+    struct host_query	    aaaa_query;
+    unsigned		    pending;	    /**< Outstanding host queries.  */
     char		    target_buf[PJ_MAX_HOSTNAME];
     pj_str_t		    cname;
     char		    cname_buf[PJ_MAX_HOSTNAME];
@@ -52,6 +62,8 @@ struct srv_target
     unsigned		    sum;
     unsigned		    addr_cnt;
     pj_in_addr		    addr[ADDR_MAX_COUNT];
+    unsigned		    addr6_cnt;
+    pj_in6_addr		    addr6[ADDR_MAX_COUNT];
 };
 
 struct pj_dns_srv_async_query
@@ -79,6 +91,21 @@ struct pj_dns_srv_async_query
     /* Number of hosts in SRV records that the IP address has been resolved */
     unsigned		     host_resolved;
 
+    /* Set while host queries are being started, to defer completion */
+    pj_bool_t		     starting;
+
+    /* The domain name target, used when the SRV resolution fails. It is
+     * resolved concurrently with the SRV query with
+     * PJ_DNS_SRV_FALLBACK_PARALLEL option.
+     */
+    struct srv_target	     fallback;
+    pj_bool_t		     use_fallback;
+
+    /* Resolution delay timer, to stop waiting for the DNS AAAA answers
+     * once the DNS A answers have arrived.
+     */
+    pj_timer_entry	     timer;
+
 };
 
 
@@ -87,6 +114,15 @@ static void dns_callback(void *user_data,
 			 pj_status_t status,
 			 pj_dns_parsed_packet *pkt);
 
+static void resolve_target(pj_dns_srv_async_query *query_job,
+			   struct srv_target *srv,
+			   pj_bool_t want_a,
+			   pj_bool_t want_aaaa);
+static void cancel_target(struct srv_target *srv);
+static void start_fallback(pj_dns_srv_async_query *query_job);
+static void cancel_timer(pj_dns_srv_async_query *query_job);
+static void check_complete(pj_dns_srv_async_query *query_job);
+
 
 
 /*
@@ -139,6 +175,18 @@ PJ_DEF(pj_status_t) pj_dns_srv_resolve( const pj_str_t *domain_name,
 
     query_job->dns_state = PJ_DNS_TYPE_SRV;
 
+    /* Resolve the domain name concurrently with the SRV query if requested,
+     * so that SRV failure doesn't delay the resolution by another round of
+     * DNS queries. This must be started before the SRV query, since the
+     * SRV query may complete synchronously when the answer is available
+     * in the cache.
+     */
+    if ((option & PJ_DNS_SRV_FALLBACK_PARALLEL) &&
+	(option & (PJ_DNS_SRV_FALLBACK_A | PJ_DNS_SRV_FALLBACK_AAAA)))
+    {
+	start_fallback(query_job);
+    }
+
     PJ_LOG(5, (query_job->objname, 
 	       "Starting async DNS %s query_job: target=%.*s:%d",
 	       pj_dns_get_type_name(query_job->dns_state),
@@ -149,7 +197,12 @@ PJ_DEF(pj_status_t) pj_dns_srv_resolve( const pj_str_t *domain_name,
 				         query_job->dns_state, 0, 
 					 &dns_callback,
     					 query_job, &query_job->q_srv);
-    if (status==PJ_SUCCESS && p_query)
+    if (status != PJ_SUCCESS) {
+	cancel_target(&query_job->fallback);
+	return status;
+    }
+
+    if (p_query)
 	*p_query = query_job;
 
     return status;
@@ -172,14 +225,19 @@ PJ_DEF(pj_status_t) pj_dns_srv_cancel_query(pj_dns_srv_async_query *query,
     }
 
     for (i=0; i<query->srv_cnt; ++i) {
-	struct srv_target *srv = &query->srv[i];
-	if (srv->q_a) {
-	    pj_dns_resolver_cancel_query(srv->q_a, PJ_FALSE);
-	    srv->q_a = NULL;
+	if (query->srv[i].pending) {
+	    cancel_target(&query->srv[i]);
 	    has_pending = PJ_TRUE;
 	}
     }
 
+    if (query->fallback.pending) {
+	cancel_target(&query->fallback);
+	has_pending = PJ_TRUE;
+    }
+
+    cancel_timer(query);
+
     if (has_pending && notify && query->cb) {
 	(*query->cb)(query->token, PJ_ECANCELLED, NULL);
     }
@@ -314,32 +372,47 @@ static void build_server_entries(pj_dns_srv_async_query *query_job,
 	query_job->srv[i].target_name.ptr = query_job->srv[i].target_buf;
     }
 
-    /* Check for Additional Info section if A records are available, and
-     * fill in the IP address (so that we won't need to resolve the A 
-     * record with another DNS query_job). 
+    /* Check for Additional Info section if A (or AAAA) records are
+     * available, and fill in the IP address (so that we won't need to
+     * resolve the A record with another DNS query_job). 
      */
     for (i=0; i<response->hdr.arcount; ++i) {
 	pj_dns_parsed_rr *rr = &response->arr[i];
 	unsigned j;
 
-	if (rr->type != PJ_DNS_TYPE_A)
+	if (rr->type == PJ_DNS_TYPE_A) {
+	    if (query_job->option & PJ_DNS_SRV_RESOLVE_AAAA_ONLY)
+		continue;
+	} else if (rr->type == PJ_DNS_TYPE_AAAA) {
+	    if ((query_job->option & (PJ_DNS_SRV_RESOLVE_AAAA |
+				      PJ_DNS_SRV_RESOLVE_AAAA_ONLY)) == 0)
+		continue;
+	} else {
 	    continue;
+	}
 
 	/* Yippeaiyee!! There is an "A" record! 
 	 * Update the IP address of the corresponding SRV record.
 	 */
 	for (j=0; j<query_job->srv_cnt; ++j) {
-            if (pj_stricmp(&rr->name, &query_job->srv[j].target_name)==0 &&
-                query_job->srv[j].addr_cnt < ADDR_MAX_COUNT)
-            {
-		unsigned cnt = query_job->srv[j].addr_cnt;
-		query_job->srv[j].addr[cnt].s_addr = rr->rdata.a.ip_addr.s_addr;
-		/* Only increment host_resolved once per SRV record */
-		if (query_job->srv[j].addr_cnt == 0)
-		    ++query_job->host_resolved;
-		++query_job->srv[j].addr_cnt;
-		break;
+	    struct srv_target *srv = &query_job->srv[j];
+	    unsigned cnt = srv->addr_cnt + srv->addr6_cnt;
+
+	    if (pj_stricmp(&rr->name, &srv->target_name) != 0)
+		continue;
+
+	    if (rr->type == PJ_DNS_TYPE_A && srv->addr_cnt < ADDR_MAX_COUNT) {
+		srv->addr[srv->addr_cnt++].s_addr = rr->rdata.a.ip_addr.s_addr;
+	    } else if (rr->type == PJ_DNS_TYPE_AAAA &&
+		       srv->addr6_cnt < ADDR_MAX_COUNT)
+	    {
+		srv->addr6[srv->addr6_cnt++] = rr->rdata.aaaa.ip_addr;
 	    }
+
+	    /* Only increment host_resolved once per SRV record */
+	    if (cnt == 0 && srv->addr_cnt + srv->addr6_cnt != 0)
+		++query_job->host_resolved;
+	    break;
 	}
 
 	/* Not valid message; SRV entry might have been deleted in
@@ -361,15 +434,22 @@ static void build_server_entries(pj_dns_srv_async_query *query_job,
      * knows..).
      */
     for (i=0; i<query_job->srv_cnt; ++i) {
+	struct srv_target *srv = &query_job->srv[i];
 	pj_in_addr addr;
+	pj_in6_addr addr6;
 
-	if (query_job->srv[i].addr_cnt != 0) {
+	if (srv->addr_cnt != 0 || srv->addr6_cnt != 0) {
 	    /* IP address already resolved */
 	    continue;
 	}
 
-	if (pj_inet_aton(&query_job->srv[i].target_name, &addr) != 0) {
-	    query_job->srv[i].addr[query_job->srv[i].addr_cnt++] = addr;
+	if (pj_inet_aton(&srv->target_name, &addr) != 0) {
+	    srv->addr[srv->addr_cnt++] = addr;
+	    ++query_job->host_resolved;
+	} else if (pj_inet_pton(pj_AF_INET6(), &srv->target_name,
+				&addr6) == PJ_SUCCESS)
+	{
+	    srv->addr6[srv->addr6_cnt++] = addr6;
 	    ++query_job->host_resolved;
 	}
     }
@@ -404,261 +484,479 @@ static void build_server_entries(pj_dns_srv_async_query *query_job,
 }
 
 
-/* Start DNS A record queries for all SRV records in the query_job structure */
-static pj_status_t resolve_hostnames(pj_dns_srv_async_query *query_job)
+/* Cancel pending DNS A and AAAA queries of a target */
+static void cancel_target(struct srv_target *srv)
 {
-    unsigned i, err_cnt = 0;
-    pj_status_t err=PJ_SUCCESS, status;
+    if (srv->a_query.q) {
+	pj_dns_resolver_cancel_query(srv->a_query.q, PJ_FALSE);
+	srv->a_query.q = NULL;
+    }
+    if (srv->aaaa_query.q) {
+	pj_dns_resolver_cancel_query(srv->aaaa_query.q, PJ_FALSE);
+	srv->aaaa_query.q = NULL;
+    }
+    srv->pending = 0;
+}
 
-    query_job->dns_state = PJ_DNS_TYPE_A;
-    for (i=0; i<query_job->srv_cnt; ++i) {
-	struct srv_target *srv = &query_job->srv[i];
 
-	PJ_LOG(5, (query_job->objname, 
-		   "Starting async DNS A query_job for %.*s",
-		   (int)srv->target_name.slen, 
-		   srv->target_name.ptr));
+/* Account a completed (or failed to start) host query of a target */
+static void host_query_done(struct srv_target *srv)
+{
+    pj_dns_srv_async_query *query_job = srv->parent;
 
-	srv->common.type = PJ_DNS_TYPE_A;
-	srv->parent = query_job;
+    pj_assert(srv->pending > 0);
+    if (--srv->pending == 0 && srv != &query_job->fallback)
+	++query_job->host_resolved;
+}
 
-	/* See also #1809: dns_callback() will be invoked synchronously when response
-	 * is available in the cache, and var 'query_job->host_resolved' will get
-	 * incremented within the dns_callback(), which will cause this function
-	 * returning false error, so don't use that variable for counting errors.
-	 */
+
+/* Cancel the resolution delay timer, if it is running */
+static void cancel_timer(pj_dns_srv_async_query *query_job)
+{
+    if (query_job->timer.id) {
+	pj_timer_heap_cancel(pj_dns_resolver_get_timer(query_job->resolver),
+			     &query_job->timer);
+	query_job->timer.id = 0;
+    }
+}
+
+
+/* Resolution delay has elapsed, complete without the DNS AAAA answers
+ * which are still pending.
+ */
+static void on_resolution_delay(pj_timer_heap_t *timer_heap,
+				pj_timer_entry *entry)
+{
+    pj_dns_srv_async_query *query_job;
+    struct srv_target *targets;
+    unsigned i, target_cnt;
+
+    PJ_UNUSED_ARG(timer_heap);
+
+    query_job = (pj_dns_srv_async_query*) entry->user_data;
+    entry->id = 0;
+
+    if (query_job->use_fallback) {
+	targets = &query_job->fallback;
+	target_cnt = 1;
+    } else {
+	targets = query_job->srv;
+	target_cnt = query_job->srv_cnt;
+    }
+
+    PJ_LOG(5,(query_job->objname, 
+	      "Resolution delay elapsed, not waiting for DNS AAAA answer"));
+
+    for (i=0; i<target_cnt; ++i) {
+	struct srv_target *srv = &targets[i];
+
+	if (srv->aaaa_query.q) {
+	    pj_dns_resolver_cancel_query(srv->aaaa_query.q, PJ_FALSE);
+	    srv->aaaa_query.q = NULL;
+	    host_query_done(srv);
+	}
+    }
+
+    check_complete(query_job);
+}
+
+
+/* Start the resolution delay timer (RFC 8305 section 3) when the targets
+ * only wait for their DNS AAAA answers, and each of them already has its
+ * IPv4 addresses. The AAAA answer that arrives first is not handled the
+ * same way, since the addresses are reported once and the A answer would
+ * be lost.
+ */
+static void start_resolution_delay(pj_dns_srv_async_query *query_job,
+				   struct srv_target targets[],
+				   unsigned target_cnt)
+{
+    pj_time_val delay;
+    unsigned i;
+
+    if (PJ_DNS_RESOLUTION_DELAY <= 0 || query_job->timer.id)
+	return;
+
+    for (i=0; i<target_cnt; ++i) {
+	struct srv_target *srv = &targets[i];
+
+	if (srv->pending == 0)
+	    continue;
+	if (srv->pending > 1 || srv->aaaa_query.q == NULL ||
+	    srv->addr_cnt == 0)
+	{
+	    return;
+	}
+    }
+
+    delay.sec = 0;
+    delay.msec = PJ_DNS_RESOLUTION_DELAY;
+    pj_time_val_normalize(&delay);
+
+    pj_timer_entry_init(&query_job->timer, 1, query_job,
+			&on_resolution_delay);
+    if (pj_timer_heap_schedule(pj_dns_resolver_get_timer(query_job->resolver),
+			       &query_job->timer, &delay) != PJ_SUCCESS)
+    {
+	query_job->timer.id = 0;
+    }
+}
+
+
+/* Start DNS A and/or AAAA queries for a target. Both queries run
+ * concurrently, and the target is done when both have completed.
+ * Note that completion is never reported from this function.
+ */
+static void resolve_target(pj_dns_srv_async_query *query_job,
+			   struct srv_target *srv,
+			   pj_bool_t want_a,
+			   pj_bool_t want_aaaa)
+{
+    struct host_query *hq[2];
+    unsigned i, cnt = 0;
+    pj_status_t status;
+
+    srv->parent = query_job;
+    srv->a_query.common.type = PJ_DNS_TYPE_A;
+    srv->a_query.target = srv;
+    srv->aaaa_query.common.type = PJ_DNS_TYPE_AAAA;
+    srv->aaaa_query.target = srv;
+
+    if (want_aaaa)
+	hq[cnt++] = &srv->aaaa_query;
+    if (want_a)
+	hq[cnt++] = &srv->a_query;
+
+    /* Account all queries first, since dns_callback() will be invoked
+     * synchronously when response is available in the cache (see also
+     * #1809).
+     */
+    srv->pending = cnt;
+
+    for (i=0; i<cnt; ++i) {
 	status = pj_dns_resolver_start_query(query_job->resolver,
 					     &srv->target_name,
-					     PJ_DNS_TYPE_A, 0,
+					     hq[i]->common.type, 0,
 					     &dns_callback,
-					     srv, &srv->q_a);
+					     hq[i], &hq[i]->q);
 	if (status != PJ_SUCCESS) {
-	    query_job->host_resolved++;
-	    err_cnt++;
-	    err = status;
+	    query_job->last_error = status;
+	    host_query_done(srv);
 	}
     }
-    
-    return (err_cnt == query_job->srv_cnt) ? err : PJ_SUCCESS;
 }
 
-/* 
- * This callback is called by PJLIB-UTIL DNS resolver when asynchronous
- * query_job has completed (successfully or with error).
+
+/* Start DNS A and/or AAAA queries of the domain name, to be used when
+ * the SRV resolution fails.
  */
-static void dns_callback(void *user_data,
-			 pj_status_t status,
-			 pj_dns_parsed_packet *pkt)
+static void start_fallback(pj_dns_srv_async_query *query_job)
 {
-    struct common *common = (struct common*) user_data;
-    pj_dns_srv_async_query *query_job;
-    struct srv_target *srv = NULL;
-    unsigned i;
+    struct srv_target *fb = &query_job->fallback;
+    pj_bool_t want_a, want_aaaa;
 
-    if (common->type == PJ_DNS_TYPE_SRV) {
-	query_job = (pj_dns_srv_async_query*) common;
-	srv = NULL;
-    } else if (common->type == PJ_DNS_TYPE_A) {
-	srv = (struct srv_target*) common;
-	query_job = srv->parent;
+    if (query_job->option & (PJ_DNS_SRV_FALLBACK_A |
+			     PJ_DNS_SRV_FALLBACK_AAAA))
+    {
+	want_a = (query_job->option & PJ_DNS_SRV_FALLBACK_A) != 0;
+	want_aaaa = (query_job->option & PJ_DNS_SRV_FALLBACK_AAAA) != 0;
     } else {
-	pj_assert(!"Unexpected user data!");
-	return;
+	/* Fallback is not enabled, but the SRV response was empty. */
+	want_a = (query_job->option & PJ_DNS_SRV_RESOLVE_AAAA_ONLY) == 0;
+	want_aaaa = (query_job->option & (PJ_DNS_SRV_RESOLVE_AAAA |
+					  PJ_DNS_SRV_RESOLVE_AAAA_ONLY)) != 0;
     }
 
-    /* Proceed to next stage */
-    if (query_job->dns_state == PJ_DNS_TYPE_SRV) {
+    fb->target_name = query_job->domain_part;
+    fb->port = query_job->def_port;
 
-	/* We are getting SRV response */
+    PJ_LOG(5, (query_job->objname, 
+	       "Starting async DNS%s%s fallback query_job: target=%.*s",
+	       want_a ? " A" : "", want_aaaa ? " AAAA" : "",
+	       (int)fb->target_name.slen, fb->target_name.ptr));
 
-	query_job->q_srv = NULL;
+    resolve_target(query_job, fb, want_a, want_aaaa);
+}
 
-	if (status == PJ_SUCCESS && pkt->hdr.anscount != 0) {
-	    /* Got SRV response, build server entry. If A records are available
-	     * in additional records section of the DNS response, save them too.
-	     */
-	    build_server_entries(query_job, pkt);
 
-	} else if (status != PJ_SUCCESS) {
-	    char errmsg[PJ_ERR_MSG_SIZE];
+/* Start DNS A/AAAA record queries for all SRV records in the query_job
+ * structure which don't have IP address yet.
+ */
+static void resolve_hostnames(pj_dns_srv_async_query *query_job)
+{
+    pj_bool_t want_a, want_aaaa;
+    unsigned i;
 
-	    /* Update query_job last error */
-	    query_job->last_error = status;
+    want_a = (query_job->option & PJ_DNS_SRV_RESOLVE_AAAA_ONLY) == 0;
+    want_aaaa = (query_job->option & (PJ_DNS_SRV_RESOLVE_AAAA |
+				      PJ_DNS_SRV_RESOLVE_AAAA_ONLY)) != 0;
 
-	    pj_strerror(status, errmsg, sizeof(errmsg));
-	    PJ_LOG(4,(query_job->objname, 
-		      "DNS SRV resolution failed for %.*s: %s", 
-		      (int)query_job->full_name.slen, 
-		      query_job->full_name.ptr,
-		      errmsg));
-
-	    /* Trigger error when fallback is disabled */
-	    if ((query_job->option &
-		 (PJ_DNS_SRV_FALLBACK_A | PJ_DNS_SRV_FALLBACK_AAAA)) == 0) 
-	    {
-		goto on_error;
-	    }
-	}
+    query_job->dns_state = PJ_DNS_TYPE_A;
+    for (i=0; i<query_job->srv_cnt; ++i) {
+	struct srv_target *srv = &query_job->srv[i];
 
-	/* If we can't build SRV record, assume the original target is
-	 * an A record and resolve with DNS A resolution.
-	 */
-	if (query_job->srv_cnt == 0) {
-	    /* Looks like we aren't getting any SRV responses.
-	     * Resolve the original target as A record by creating a 
-	     * single "dummy" srv record and start the hostname resolution.
-	     */
-	    PJ_LOG(4, (query_job->objname, 
-		       "DNS SRV resolution failed for %.*s, trying "
-		       "resolving A record for %.*s",
-		       (int)query_job->full_name.slen, 
-		       query_job->full_name.ptr,
-		       (int)query_job->domain_part.slen,
-		       query_job->domain_part.ptr));
-
-	    /* Create a "dummy" srv record using the original target */
-	    i = query_job->srv_cnt++;
-	    pj_bzero(&query_job->srv[i], sizeof(query_job->srv[i]));
-	    query_job->srv[i].target_name = query_job->domain_part;
-	    query_job->srv[i].priority = 0;
-	    query_job->srv[i].weight = 0;
-	    query_job->srv[i].port = query_job->def_port;
-	} 
-	
+	if (srv->addr_cnt != 0 || srv->addr6_cnt != 0)
+	    continue;
 
-	/* Resolve server hostnames (DNS A record) for hosts which don't have
-	 * A record yet.
-	 */
-	if (query_job->host_resolved != query_job->srv_cnt) {
-	    status = resolve_hostnames(query_job);
-	    if (status != PJ_SUCCESS)
-		goto on_error;
+	PJ_LOG(5, (query_job->objname, 
+		   "Starting async DNS%s%s query_job for %.*s",
+		   want_a ? " A" : "", want_aaaa ? " AAAA" : "",
+		   (int)srv->target_name.slen, 
+		   srv->target_name.ptr));
 
-	    /* Must return now. Callback may have been called and query_job
-	     * may have been destroyed.
-	     */
+	resolve_target(query_job, srv, want_a, want_aaaa);
+    }
+}
+
+
+/* Report the result to application once all the targets are done */
+static void check_complete(pj_dns_srv_async_query *query_job)
+{
+    pj_dns_srv_record srv_rec;
+    struct srv_target *targets;
+    unsigned i, target_cnt;
+    pj_status_t status;
+
+    if (query_job->dns_state == PJ_DNS_TYPE_SRV || query_job->starting)
+	return;
+
+    if (query_job->use_fallback) {
+	targets = &query_job->fallback;
+	target_cnt = 1;
+	if (query_job->fallback.pending) {
+	    start_resolution_delay(query_job, targets, target_cnt);
 	    return;
 	}
+    } else {
+	targets = query_job->srv;
+	target_cnt = query_job->srv_cnt;
+	if (query_job->host_resolved != query_job->srv_cnt) {
+	    start_resolution_delay(query_job, targets, target_cnt);
+	    return;
+	}
+    }
 
-    } else if (query_job->dns_state == PJ_DNS_TYPE_A) {
+    cancel_timer(query_job);
 
-	/* Clear the outstanding job */
-	srv->q_a = NULL;
+    /* Got all answers, build server addresses */
+    srv_rec.count = 0;
+    for (i=0; i<target_cnt; ++i) {
+	unsigned j;
+	struct srv_target *srv2 = &targets[i];
 
-	/* Check that we really have answer */
-	if (status==PJ_SUCCESS && pkt->hdr.anscount != 0) {
-	    pj_dns_a_record rec;
+	srv_rec.entry[srv_rec.count].priority = srv2->priority;
+	srv_rec.entry[srv_rec.count].weight = srv2->weight;
+	srv_rec.entry[srv_rec.count].port = (pj_uint16_t)srv2->port ;
 
-	    /* Parse response */
-	    status = pj_dns_parse_a_response(pkt, &rec);
-	    if (status != PJ_SUCCESS)
-		goto on_error;
+	srv_rec.entry[srv_rec.count].server.name = srv2->target_name;
+	srv_rec.entry[srv_rec.count].server.alias = srv2->cname;
+	srv_rec.entry[srv_rec.count].server.addr_count = 0;
+	srv_rec.entry[srv_rec.count].addr6_count = 0;
 
-	    pj_assert(rec.addr_count != 0);
+	pj_assert(srv2->addr_cnt <= PJ_DNS_MAX_IP_IN_A_REC);
+	pj_assert(srv2->addr6_cnt <= PJ_DNS_MAX_IP_IN_A_REC);
 
-	    /* Update CNAME alias, if present. */
-	    if (rec.alias.slen) {
-		pj_assert(rec.alias.slen <= (int)sizeof(srv->cname_buf));
-		srv->cname.ptr = srv->cname_buf;
-		pj_strcpy(&srv->cname, &rec.alias);
-	    } else {
-		srv->cname.slen = 0;
-	    }
+	for (j=0; j<srv2->addr_cnt; ++j) {
+	    srv_rec.entry[srv_rec.count].server.addr[j].s_addr = 
+		srv2->addr[j].s_addr;
+	    ++srv_rec.entry[srv_rec.count].server.addr_count;
+	}
 
-	    /* Update IP address of the corresponding hostname or CNAME */
-	    if (srv->addr_cnt < ADDR_MAX_COUNT) {
-		srv->addr[srv->addr_cnt++].s_addr = rec.addr[0].s_addr;
+	for (j=0; j<srv2->addr6_cnt; ++j) {
+	    srv_rec.entry[srv_rec.count].addr6[j] = srv2->addr6[j];
+	    ++srv_rec.entry[srv_rec.count].addr6_count;
+	}
 
-		PJ_LOG(5,(query_job->objname, 
-			  "DNS A for %.*s: %s",
-			  (int)srv->target_name.slen, 
-			  srv->target_name.ptr,
-			  pj_inet_ntoa(rec.addr[0])));
-	    }
+	if (srv2->addr_cnt > 0 || srv2->addr6_cnt > 0) {
+	    ++srv_rec.count;
+	    if (srv_rec.count == PJ_DNS_SRV_MAX_ADDR)
+		break;
+	}
+    }
 
-	    /* Check for multiple IP addresses */
-	    for (i=1; i<rec.addr_count && srv->addr_cnt < ADDR_MAX_COUNT; ++i)
-	    {
-		srv->addr[srv->addr_cnt++].s_addr = rec.addr[i].s_addr;
+    PJ_LOG(5,(query_job->objname, 
+	      "Server resolution complete, %d server entry(s) found",
+	      srv_rec.count));
 
-		PJ_LOG(5,(query_job->objname, 
-			  "Additional DNS A for %.*s: %s",
-			  (int)srv->target_name.slen, 
-			  srv->target_name.ptr,
-			  pj_inet_ntoa(rec.addr[i])));
-	    }
 
-	} else if (status != PJ_SUCCESS) {
-	    char errmsg[PJ_ERR_MSG_SIZE];
+    if (srv_rec.count > 0)
+	status = PJ_SUCCESS;
+    else {
+	status = query_job->last_error;
+	if (status == PJ_SUCCESS)
+	    status = PJLIB_UTIL_EDNSNOANSWERREC;
+    }
 
-	    /* Update last error */
-	    query_job->last_error = status;
+    /* Call the callback */
+    (*query_job->cb)(query_job->token, status, &srv_rec);
+}
 
-	    /* Log error */
-	    pj_strerror(status, errmsg, sizeof(errmsg));
-	    PJ_LOG(4,(query_job->objname, "DNS A record resolution failed: %s", 
-		      errmsg));
-	}
 
-	++query_job->host_resolved;
+/* Process the DNS A or AAAA response of a target */
+static void on_host_response(struct host_query *hq,
+			     pj_status_t status,
+			     pj_dns_parsed_packet *pkt)
+{
+    struct srv_target *srv = hq->target;
+    pj_dns_srv_async_query *query_job = srv->parent;
+    const char *type_name = pj_dns_get_type_name(hq->common.type);
+    unsigned i;
 
-    } else {
-	pj_assert(!"Unexpected state!");
-	query_job->last_error = status = PJ_EINVALIDOP;
-	goto on_error;
-    }
+    /* Clear the outstanding job */
+    hq->q = NULL;
 
-    /* Check if all hosts have been resolved */
-    if (query_job->host_resolved == query_job->srv_cnt) {
-	/* Got all answers, build server addresses */
-	pj_dns_srv_record srv_rec;
+    /* Check that we really have answer */
+    if (status==PJ_SUCCESS && pkt->hdr.anscount != 0) {
+	pj_dns_addr_record rec;
 
-	srv_rec.count = 0;
-	for (i=0; i<query_job->srv_cnt; ++i) {
-	    unsigned j;
-	    struct srv_target *srv2 = &query_job->srv[i];
+	/* Parse response */
+	status = pj_dns_parse_addr_response(pkt, &rec);
+	if (status != PJ_SUCCESS)
+	    goto on_error;
 
-	    srv_rec.entry[srv_rec.count].priority = srv2->priority;
-	    srv_rec.entry[srv_rec.count].weight = srv2->weight;
-	    srv_rec.entry[srv_rec.count].port = (pj_uint16_t)srv2->port ;
+	pj_assert(rec.addr_count != 0);
 
-	    srv_rec.entry[srv_rec.count].server.name = srv2->target_name;
-	    srv_rec.entry[srv_rec.count].server.alias = srv2->cname;
-	    srv_rec.entry[srv_rec.count].server.addr_count = 0;
+	/* Update CNAME alias, if present. */
+	if (rec.alias.slen) {
+	    pj_assert(rec.alias.slen <= (int)sizeof(srv->cname_buf));
+	    srv->cname.ptr = srv->cname_buf;
+	    pj_strcpy(&srv->cname, &rec.alias);
+	}
 
-	    pj_assert(srv2->addr_cnt <= PJ_DNS_MAX_IP_IN_A_REC);
+	/* Update IP address of the corresponding hostname or CNAME */
+	for (i=0; i<rec.addr_count; ++i) {
+	    char addr[PJ_INET6_ADDRSTRLEN];
 
-	    for (j=0; j<srv2->addr_cnt; ++j) {
-		srv_rec.entry[srv_rec.count].server.addr[j].s_addr = 
-		    srv2->addr[j].s_addr;
-		++srv_rec.entry[srv_rec.count].server.addr_count;
+	    if (rec.addr[i].af == pj_AF_INET()) {
+		if (srv->addr_cnt == ADDR_MAX_COUNT)
+		    continue;
+		srv->addr[srv->addr_cnt++] = rec.addr[i].ip.v4;
+	    } else {
+		if (srv->addr6_cnt == ADDR_MAX_COUNT)
+		    continue;
+		srv->addr6[srv->addr6_cnt++] = rec.addr[i].ip.v6;
 	    }
 
-	    if (srv2->addr_cnt > 0) {
-		++srv_rec.count;
-		if (srv_rec.count == PJ_DNS_SRV_MAX_ADDR)
-		    break;
-	    }
+	    PJ_LOG(5,(query_job->objname, 
+		      "%sDNS %s for %.*s: %s",
+		      (i ? "Additional " : ""),
+		      (rec.addr[i].af == pj_AF_INET() ? "A" : "AAAA"),
+		      (int)srv->target_name.slen, 
+		      srv->target_name.ptr,
+		      pj_inet_ntop2(rec.addr[i].af, &rec.addr[i].ip,
+				    addr, sizeof(addr))));
 	}
 
-	PJ_LOG(5,(query_job->objname, 
-		  "Server resolution complete, %d server entry(s) found",
-		  srv_rec.count));
+    }
+
+on_error:
+    if (status != PJ_SUCCESS) {
+	char errmsg[PJ_ERR_MSG_SIZE];
+
+	/* Update last error */
+	query_job->last_error = status;
+
+	/* Log error */
+	pj_strerror(status, errmsg, sizeof(errmsg));
+	PJ_LOG(4,(query_job->objname, "DNS %s record resolution failed: %s", 
+		  type_name, errmsg));
+    }
 
+    host_query_done(srv);
+    check_complete(query_job);
+}
+
+
+/* 
+ * This callback is called by PJLIB-UTIL DNS resolver when asynchronous
+ * query_job has completed (successfully or with error).
+ */
+static void dns_callback(void *user_data,
+			 pj_status_t status,
+			 pj_dns_parsed_packet *pkt)
+{
+    struct common *common = (struct common*) user_data;
+    pj_dns_srv_async_query *query_job;
 
-	if (srv_rec.count > 0)
-	    status = PJ_SUCCESS;
-	else {
-	    status = query_job->last_error;
-	    if (status == PJ_SUCCESS)
-		status = PJLIB_UTIL_EDNSNOANSWERREC;
+    if (common->type == PJ_DNS_TYPE_A || common->type == PJ_DNS_TYPE_AAAA) {
+	on_host_response((struct host_query*) common, status, pkt);
+	return;
+    } else if (common->type != PJ_DNS_TYPE_SRV) {
+	pj_assert(!"Unexpected user data!");
+	return;
+    }
+
+    query_job = (pj_dns_srv_async_query*) common;
+
+    /* We are getting SRV response */
+    pj_assert(query_job->dns_state == PJ_DNS_TYPE_SRV);
+    query_job->q_srv = NULL;
+
+    if (status == PJ_SUCCESS && pkt->hdr.anscount != 0) {
+	/* Got SRV response, build server entry. If A records are available
+	 * in additional records section of the DNS response, save them too.
+	 */
+	build_server_entries(query_job, pkt);
+
+    } else if (status != PJ_SUCCESS) {
+	char errmsg[PJ_ERR_MSG_SIZE];
+
+	/* Update query_job last error */
+	query_job->last_error = status;
+
+	pj_strerror(status, errmsg, sizeof(errmsg));
+	PJ_LOG(4,(query_job->objname, 
+		  "DNS SRV resolution failed for %.*s: %s", 
+		  (int)query_job->full_name.slen, 
+		  query_job->full_name.ptr,
+		  errmsg));
+
+	/* Trigger error when fallback is disabled */
+	if ((query_job->option &
+	     (PJ_DNS_SRV_FALLBACK_A | PJ_DNS_SRV_FALLBACK_AAAA)) == 0) 
+	{
+	    goto on_error;
 	}
+    }
 
-	/* Call the callback */
-	(*query_job->cb)(query_job->token, status, &srv_rec);
+    query_job->dns_state = PJ_DNS_TYPE_A;
+    query_job->starting = PJ_TRUE;
+
+    if (query_job->srv_cnt == 0) {
+	/* Looks like we aren't getting any SRV responses.
+	 * Use the resolution of the original target as A (and/or AAAA)
+	 * record, which has been started together with the SRV query.
+	 */
+	PJ_LOG(4, (query_job->objname, 
+		   "DNS SRV resolution failed for %.*s, %s "
+		   "address record for %.*s",
+		   (int)query_job->full_name.slen, 
+		   query_job->full_name.ptr,
+		   (query_job->fallback.parent ? "using" : "resolving"),
+		   (int)query_job->domain_part.slen,
+		   query_job->domain_part.ptr));
+
+	query_job->use_fallback = PJ_TRUE;
+
+	if (query_job->fallback.parent == NULL)
+	    start_fallback(query_job);
+
+    } else {
+	/* SRV resolution is successful, the fallback is not needed */
+	cancel_target(&query_job->fallback);
+
+	/* Resolve server hostnames (DNS A/AAAA record) for hosts which
+	 * don't have the address yet.
+	 */
+	resolve_hostnames(query_job);
     }
 
+    query_job->starting = PJ_FALSE;
 
+    /* Callback may be called here, and query_job may have been destroyed
+     * after this.
+     */
+    check_complete(query_job);
     return;
 
 on_error:
@@ -678,5 +976,3 @@ on_error:
 	return;
     }
 }
-
-
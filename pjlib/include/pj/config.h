@@ -887,6 +887,62 @@
 #endif
 
 
+/**
+ * Specify the maximum number of TLS sessions kept by the OpenSSL backend
+ * for client connections, so reconnecting to the same server resumes
+ * the previous session instead of doing a full handshake. The sessions
+ * are keyed by the server name (or the remote address, if the server
+ * name is not set) and the port, and they are only resumed by sockets
+ * with the same protocols, verification settings, and credentials. Set
+ * this to zero to disable client session resumption.
+ *
+ * Default: 32
+ */
+#ifndef PJ_SSL_SOCK_OSSL_SESS_CACHE_SIZE
+#  define PJ_SSL_SOCK_OSSL_SESS_CACHE_SIZE   32
+#endif
+
+
+/**
+ * Specify the maximum number of SSL contexts shared by the OpenSSL backend.
+ * Secure sockets with the same role (client or server), protocols,
+ * verification settings, and credential files use the same context, so
+ * the credentials are not loaded again for every connection, and the
+ * sessions issued by a TLS listener (by session ID or session ticket) can
+ * be resumed on any connection it accepts. The context is recreated when
+ * a credential file is modified.
+ * Set this to zero to create a context for every secure socket.
+ *
+ * Default: 8
+ */
+#ifndef PJ_SSL_SOCK_OSSL_CTX_CACHE_SIZE
+#  define PJ_SSL_SOCK_OSSL_CTX_CACHE_SIZE    8
+#endif
+
+
+/**
+ * Enable kernel TLS (kTLS) offload in the OpenSSL backend on Linux. When
+ * enabled, the keys negotiated by the handshake of a TLS connection are
+ * passed to the kernel, which then encrypts and decrypts the records, so
+ * the application data is sent and received with plain socket calls. The
+ * connection silently keeps using OpenSSL record processing when the
+ * kernel (the "tls" module), the OpenSSL library (version 3.0 or later,
+ * built with kTLS support), or the negotiated cipher does not support it.
+ *
+ * Once the kernel decrypts the received records, it only delivers
+ * application data: a close_notify alert from the peer closes the
+ * connection as usual, but a connection fails when the peer sends any
+ * other non application data record, e.g: a TLS 1.2 renegotiation
+ * request (HelloRequest) or a TLS 1.3 KeyUpdate. Only enable this when
+ * the peers are not expected to do so.
+ *
+ * Default: 0
+ */
+#ifndef PJ_SSL_SOCK_OSSL_USE_KTLS
+#  define PJ_SSL_SOCK_OSSL_USE_KTLS	0
+#endif
+
+
 /**
  * Disable WSAECONNRESET error for UDP sockets on Win32 platforms. See
  * https://trac.pjsip.org/repos/ticket/1197.
@@ -271,6 +271,30 @@ PJ_DECL(int) pj_thread_get_prio_min(pj_thread_t *thread);
 PJ_DECL(int) pj_thread_get_prio_max(pj_thread_t *thread);
 
 
+/**
+ * Bind the thread to one CPU, so that the scheduler only runs the thread
+ * on that CPU. This keeps the data which the thread works on in the cache
+ * of that CPU.
+ *
+ * @param thread	Thread handle.
+ * @param cpu		Zero based CPU index, less than the value returned
+ *			by #pj_get_cpu_count().
+ *
+ * @return		PJ_SUCCESS on success, PJ_ENOTSUP if the platform
+ *			doesn't support thread affinity, or the error code.
+ */
+PJ_DECL(pj_status_t) pj_thread_set_cpu_affinity(pj_thread_t *thread,
+						unsigned cpu);
+
+
+/**
+ * Get the number of CPUs which are currently online.
+ *
+ * @return		Number of CPUs, at least one.
+ */
+PJ_DECL(unsigned) pj_get_cpu_count(void);
+
+
 /**
  * Return native handle from pj_thread_t for manipulation using native
  * OS APIs.
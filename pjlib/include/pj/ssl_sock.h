@@ -1156,6 +1156,50 @@ PJ_DECL(pj_status_t) pj_ssl_sock_start_connect(pj_ssl_sock_t *ssock,
 PJ_DECL(pj_status_t) pj_ssl_sock_renegotiate(pj_ssl_sock_t *ssock);
 
 
+/**
+ * TLS session resumption statistics of all secure sockets, see
+ * #pj_ssl_sock_get_sess_stat().
+ */
+typedef struct pj_ssl_sock_sess_stat
+{
+    /**
+     * Number of client handshakes that resumed a previous session.
+     */
+    unsigned	client_hits;
+
+    /**
+     * Number of client handshakes that established a new session.
+     */
+    unsigned	client_misses;
+
+    /**
+     * Number of server handshakes that resumed a previous session, by
+     * session ID or session ticket.
+     */
+    unsigned	server_hits;
+
+    /**
+     * Number of server handshakes that established a new session.
+     */
+    unsigned	server_misses;
+
+} pj_ssl_sock_sess_stat;
+
+
+/**
+ * Get the TLS session resumption statistics, i.e: the number of
+ * successful handshakes that resumed a previous session (hits) and that
+ * established a new session (misses), counted since the application
+ * started.
+ *
+ * @param stat		The statistics to be filled.
+ *
+ * @return		PJ_SUCCESS when successful, or PJ_ENOTSUP if the
+ *			backend does not support session resumption.
+ */
+PJ_DECL(pj_status_t) pj_ssl_sock_get_sess_stat(pj_ssl_sock_sess_stat *stat);
+
+
 /**
  * @}
  */
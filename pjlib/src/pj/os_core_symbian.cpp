@@ -563,6 +563,27 @@ PJ_DEF(int) pj_thread_get_prio_max(pj_thread_t *thread)
 }
 
 
+/*
+ * Bind thread to a CPU, not supported.
+ */
+PJ_DEF(pj_status_t) pj_thread_set_cpu_affinity(pj_thread_t *thread,
+					       unsigned cpu)
+{
+    PJ_UNUSED_ARG(thread);
+    PJ_UNUSED_ARG(cpu);
+    return PJ_ENOTSUP;
+}
+
+
+/*
+ * Get the number of CPUs.
+ */
+PJ_DEF(unsigned) pj_get_cpu_count(void)
+{
+    return 1;
+}
+
+
 /*
  * pj_thread_get_os_handle()
  */
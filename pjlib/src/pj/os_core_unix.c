@@ -43,6 +43,7 @@
 #include <errno.h>	    // errno
 
 #include <pthread.h>
+#include <sched.h>
 
 #define THIS_FILE   "os_core_unix.c"
 
@@ -397,6 +398,50 @@ PJ_DEF(int) pj_thread_get_prio_max(pj_thread_t *thread)
 }
 
 
+/*
+ * Bind thread to a CPU.
+ */
+PJ_DEF(pj_status_t) pj_thread_set_cpu_affinity(pj_thread_t *thread,
+					       unsigned cpu)
+{
+#if PJ_HAS_THREADS && defined(__GLIBC__)
+    cpu_set_t set;
+    int rc;
+
+    PJ_ASSERT_RETURN(thread, PJ_EINVAL);
+    PJ_ASSERT_RETURN(cpu < CPU_SETSIZE, PJ_EINVAL);
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+
+    rc = pthread_setaffinity_np(thread->thread, sizeof(set), &set);
+    if (rc != 0)
+	return PJ_RETURN_OS_ERROR(rc);
+
+    return PJ_SUCCESS;
+#else
+    PJ_UNUSED_ARG(thread);
+    PJ_UNUSED_ARG(cpu);
+    return PJ_ENOTSUP;
+#endif
+}
+
+
+/*
+ * Get the number of CPUs.
+ */
+PJ_DEF(unsigned) pj_get_cpu_count(void)
+{
+#if defined(_SC_NPROCESSORS_ONLN)
+    long cnt = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return (cnt > 0) ? (unsigned)cnt : 1;
+#else
+    return 1;
+#endif
+}
+
+
 /*
  * Get native thread handle
  */
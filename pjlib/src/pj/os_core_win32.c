@@ -346,6 +346,40 @@ PJ_DEF(int) pj_thread_get_prio_max(pj_thread_t *thread)
 }
 
 
+/*
+ * Bind thread to a CPU.
+ */
+PJ_DEF(pj_status_t) pj_thread_set_cpu_affinity(pj_thread_t *thread,
+					       unsigned cpu)
+{
+#if PJ_HAS_THREADS
+    PJ_ASSERT_RETURN(thread, PJ_EINVAL);
+    PJ_ASSERT_RETURN(cpu < sizeof(DWORD_PTR) * 8, PJ_EINVAL);
+
+    if (SetThreadAffinityMask(thread->hthread, ((DWORD_PTR)1) << cpu) == 0)
+	return PJ_RETURN_OS_ERROR(GetLastError());
+
+    return PJ_SUCCESS;
+#else
+    PJ_UNUSED_ARG(thread);
+    PJ_UNUSED_ARG(cpu);
+    return PJ_ENOTSUP;
+#endif
+}
+
+
+/*
+ * Get the number of CPUs.
+ */
+PJ_DEF(unsigned) pj_get_cpu_count(void)
+{
+    SYSTEM_INFO info;
+
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors ? info.dwNumberOfProcessors : 1;
+}
+
+
 /*
  * Get native thread handle
  */
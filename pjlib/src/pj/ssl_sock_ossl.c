@@ -40,12 +40,19 @@
 /* Workaround for ticket #985 */
 #define DELAYED_CLOSE_TIMEOUT	200
 
+/* Length of SSL context ID (SHA-256), which is also used as the session
+ * ID context, see get_ctx_id().
+ */
+#define CTX_ID_LEN		32
+
 /* 
  * Include OpenSSL headers 
  */
 #include <openssl/bio.h>
 #include <openssl/ssl.h>
 #include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
 #include <openssl/x509v3.h>
 
 
@@ -55,6 +62,49 @@
 #endif
 
 
+/* BIO and SSL_CIPHER have been opaque since OpenSSL 1.1.0 */
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+#  define BIO_get_data(b)		((b)->ptr)
+#  define BIO_set_data(b, p)		((b)->ptr = (p))
+#  define BIO_set_init(b, v)		((b)->init = (v))
+#  define SSL_CIPHER_get_id(c)		((c)->id)
+#  define SSL_CTX_up_ref(c)		CRYPTO_add(&(c)->references, 1, \
+					   CRYPTO_LOCK_SSL_CTX)
+#endif
+
+
+/* Kernel TLS needs Linux and OpenSSL 3.0 built with kTLS support, which
+ * passes the negotiated keys to the SSL socket BIO, see ktls_start().
+ */
+#if defined(PJ_SSL_SOCK_OSSL_USE_KTLS) && PJ_SSL_SOCK_OSSL_USE_KTLS!=0 && \
+    defined(PJ_LINUX) && PJ_LINUX!=0 && \
+    OPENSSL_VERSION_NUMBER >= 0x30000000L && !defined(OPENSSL_NO_KTLS)
+#  define SSL_SOCK_USE_KTLS		1
+#  include <errno.h>
+#  include <sys/socket.h>
+#  include <netinet/tcp.h>
+#  include <linux/tls.h>
+#  ifndef TCP_ULP
+#    define TCP_ULP			31
+#  endif
+#  ifndef SOL_TLS
+#    define SOL_TLS			282
+#  endif
+   /* These BIO controls are not exported by OpenSSL */
+#  ifndef BIO_CTRL_SET_KTLS
+#    define BIO_CTRL_SET_KTLS			72
+#  endif
+#  ifndef BIO_CTRL_SET_KTLS_TX_SEND_CTRL_MSG
+#    define BIO_CTRL_SET_KTLS_TX_SEND_CTRL_MSG	74
+#  endif
+#  ifndef BIO_CTRL_CLEAR_KTLS_TX_CTRL_MSG
+#    define BIO_CTRL_CLEAR_KTLS_TX_CTRL_MSG	75
+#  endif
+#else
+#  define SSL_SOCK_USE_KTLS		0
+#endif
+
+
 /* Suppress compile warning of OpenSSL deprecation (OpenSSL is deprecated
  * since MacOSX 10.7).
  */
@@ -176,8 +226,22 @@ struct pj_ssl_sock_t
 
     SSL_CTX		 *ossl_ctx;
     SSL			 *ossl_ssl;
-    BIO			 *ossl_rbio;
-    BIO			 *ossl_wbio;
+    unsigned char	  ctx_id[CTX_ID_LEN]; /* see get_ctx_id()	    */
+    pj_bool_t		  has_ctx_id;	/* ctx_id identifies the settings   */
+    BIO			 *ossl_rbio;	/* network data not consumed by SSL */
+    BIO			 *ossl_wbio;	/* secured data not in a send slot  */
+
+    const char		 *bio_rdata;	/* network data being read by SSL   */
+    pj_size_t		  bio_rlen;	/* length of bio_rdata		    */
+    write_data_t	 *bio_wdata;	/* send_buf slot written by SSL	    */
+    pj_size_t		  bio_wmax;	/* capacity of bio_wdata	    */
+
+#if SSL_SOCK_USE_KTLS
+    pj_bool_t		  ktls_ulp;	/* TLS ULP is set on the socket	    */
+    pj_bool_t		  ktls_tx;	/* kernel encrypts sent data	    */
+    pj_bool_t		  ktls_rx;	/* kernel decrypts received data    */
+    int			  ktls_ctrl_msg;/* record type of the next write    */
+#endif
 };
 
 
@@ -286,6 +350,364 @@ static pj_str_t ssl_strerror(pj_status_t status,
 }
 
 
+#if SSL_SOCK_USE_KTLS
+/*
+ * Kernel TLS. OpenSSL offers the keys of each direction to the SSL socket
+ * BIO once the handshake has derived them. After the keys are accepted
+ * by the kernel, OpenSSL passes plaintext to ssl_bio_write() and the
+ * received data is read from the socket already decrypted, so it bypasses
+ * SSL_read(), see ssl_on_network_data(). Declining the keys (returning 0)
+ * simply keeps the OpenSSL record processing for that direction.
+ */
+static int ktls_start(pj_ssl_sock_t *ssock,
+		      const struct tls_crypto_info *ci,
+		      pj_bool_t is_tx)
+{
+    int len;
+    pj_status_t status;
+
+    if (!ci || ssock->param.sock_type != pj_SOCK_STREAM())
+	return 0;
+
+    switch (ci->cipher_type) {
+    case TLS_CIPHER_AES_GCM_128:
+	len = sizeof(struct tls12_crypto_info_aes_gcm_128);
+	break;
+#ifdef TLS_CIPHER_AES_GCM_256
+    case TLS_CIPHER_AES_GCM_256:
+	len = sizeof(struct tls12_crypto_info_aes_gcm_256);
+	break;
+#endif
+#ifdef TLS_CIPHER_AES_CCM_128
+    case TLS_CIPHER_AES_CCM_128:
+	len = sizeof(struct tls12_crypto_info_aes_ccm_128);
+	break;
+#endif
+#ifdef TLS_CIPHER_CHACHA20_POLY1305
+    case TLS_CIPHER_CHACHA20_POLY1305:
+	len = sizeof(struct tls12_crypto_info_chacha20_poly1305);
+	break;
+#endif
+    default:
+	return 0;
+    }
+
+    if (is_tx) {
+	/* The secured data generated so far (e.g: the Finished message)
+	 * must reach the socket before the kernel starts encrypting, it
+	 * can only be sent directly if nothing else is queued before it.
+	 */
+	if (!pj_list_empty(&ssock->send_pending) ||
+	    (ssock->bio_wdata && ssock->bio_wdata->data_len))
+	{
+	    return 0;
+	}
+    } else {
+	/* The socket must not have been read beyond the last record
+	 * protected by the old keys, and there must be only one read in
+	 * progress, so no data is read before the kernel has the keys.
+	 * TLS 1.3 clients keep decrypting in OpenSSL, as the session
+	 * tickets sent by the server after the handshake would make the
+	 * kernel fail the socket read.
+	 */
+	if (ssock->bio_rlen || BIO_pending(ssock->ossl_rbio) ||
+	    ssock->param.async_cnt != 1 ||
+	    (!ssock->is_server &&
+	     SSL_version(ssock->ossl_ssl) >= TLS1_3_VERSION))
+	{
+	    return 0;
+	}
+    }
+
+    if (!ssock->ktls_ulp) {
+	/* Fails when the kernel has no TLS support */
+	status = pj_sock_setsockopt(ssock->sock, pj_SOL_TCP(), TCP_ULP,
+				    "tls", sizeof("tls"));
+	if (status != PJ_SUCCESS)
+	    return 0;
+	ssock->ktls_ulp = PJ_TRUE;
+    }
+
+    if (is_tx && BIO_pending(ssock->ossl_wbio)) {
+	char *data;
+	pj_ssize_t sent;
+
+	sent = BIO_get_mem_data(ssock->ossl_wbio, &data);
+	status = pj_sock_send(ssock->sock, data, &sent, 0);
+	if (status != PJ_SUCCESS)
+	    return 0;
+
+	/* Discard what has been sent, the rest is sent as usual */
+	while (sent > 0) {
+	    char tmp[256];
+	    int n = BIO_read(ssock->ossl_wbio, tmp,
+			     (int)PJ_MIN(sent, (pj_ssize_t)sizeof(tmp)));
+	    if (n <= 0)
+		break;
+	    sent -= n;
+	}
+	if (BIO_pending(ssock->ossl_wbio))
+	    return 0;
+    }
+
+    status = pj_sock_setsockopt(ssock->sock, SOL_TLS,
+				(pj_uint16_t)(is_tx? TLS_TX : TLS_RX),
+				ci, len);
+    if (status != PJ_SUCCESS)
+	return 0;
+
+    if (is_tx)
+	ssock->ktls_tx = PJ_TRUE;
+    else
+	ssock->ktls_rx = PJ_TRUE;
+
+    PJ_LOG(4,(ssock->pool->obj_name, "Kernel TLS %s offload enabled",
+	      (is_tx? "send" : "receive")));
+
+    return 1;
+}
+
+/* Send a non application data record, e.g: alert or TLS 1.3 session
+ * ticket, when the kernel encrypts the sent data.
+ */
+static int ktls_send_ctrl_msg(pj_ssl_sock_t *ssock, const char *in, int inl)
+{
+    char cbuf[CMSG_SPACE(sizeof(unsigned char))];
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+    struct iovec iov;
+    ssize_t sent;
+
+    /* The record type only applies to this write */
+    unsigned char record_type = (unsigned char)ssock->ktls_ctrl_msg;
+    ssock->ktls_ctrl_msg = 0;
+
+    /* Sending the record now would reorder it with the data still queued
+     * for sending. The records sent after the handshake are not needed
+     * by the peer to go on, so just drop it.
+     */
+    if (!pj_list_empty(&ssock->send_pending) ||
+	BIO_pending(ssock->ossl_wbio) ||
+	(ssock->bio_wdata && ssock->bio_wdata->data_len))
+    {
+	PJ_LOG(4,(ssock->pool->obj_name, "Dropped TLS record type %d while "
+		  "sending data", record_type));
+	return inl;
+    }
+
+    pj_bzero(&msg, sizeof(msg));
+    msg.msg_control = cbuf;
+    msg.msg_controllen = sizeof(cbuf);
+    cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_TLS;
+    cmsg->cmsg_type = TLS_SET_RECORD_TYPE;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(record_type));
+    *((unsigned char*)CMSG_DATA(cmsg)) = record_type;
+    msg.msg_controllen = cmsg->cmsg_len;
+
+    iov.iov_base = (void*)in;
+    iov.iov_len = inl;
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    sent = sendmsg(ssock->sock, &msg, MSG_DONTWAIT);
+    if (sent != inl) {
+	PJ_PERROR(4,(ssock->pool->obj_name,
+		     (sent < 0? pj_get_netos_error() : PJ_ETOOSMALL),
+		     "Failed sending TLS record type %d", record_type));
+	return (sent > 0? (int)sent : -1);
+    }
+
+    return inl;
+}
+
+/* When the kernel decrypts the received data, a socket read fails with
+ * EIO if the next record is not application data. Read that record to
+ * see if it is the close_notify alert of the peer, which just closes the
+ * connection. Other records, e.g: TLS 1.2 HelloRequest or TLS 1.3
+ * KeyUpdate, can't be processed as OpenSSL no longer gets the records,
+ * so the connection fails.
+ */
+static pj_status_t ktls_recv_ctrl_msg(pj_ssl_sock_t *ssock)
+{
+    char cbuf[CMSG_SPACE(sizeof(unsigned char))];
+    unsigned char alert[2];
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+    struct iovec iov;
+    unsigned char record_type = 0;
+    ssize_t len;
+
+    pj_bzero(&msg, sizeof(msg));
+    msg.msg_control = cbuf;
+    msg.msg_controllen = sizeof(cbuf);
+    iov.iov_base = alert;
+    iov.iov_len = sizeof(alert);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    len = recvmsg(ssock->sock, &msg, MSG_DONTWAIT);
+    cmsg = (len > 0? CMSG_FIRSTHDR(&msg) : NULL);
+    if (cmsg && cmsg->cmsg_level == SOL_TLS &&
+	cmsg->cmsg_type == TLS_GET_RECORD_TYPE)
+    {
+	record_type = *((unsigned char*)CMSG_DATA(cmsg));
+    }
+
+    if (record_type == SSL3_RT_ALERT && len == sizeof(alert) &&
+	alert[1] == SSL_AD_CLOSE_NOTIFY)
+    {
+	return PJ_EEOF;
+    }
+
+    PJ_LOG(2,(ssock->pool->obj_name, "Received TLS record type %d, which "
+	      "is not supported with kernel TLS receive offload",
+	      record_type));
+    return PJ_STATUS_FROM_OS(EIO);
+}
+#endif	/* SSL_SOCK_USE_KTLS */
+
+
+/*
+ * SSL socket BIO. SSL reads the network data directly from the active
+ * socket read buffer (bio_rdata), and writes the secured data directly
+ * into a slot of the send buffer prepared by ssl_write() (bio_wdata).
+ * The memory BIOs only hold the data that cannot be passed in place:
+ * network data left unconsumed when the read callback returns, and
+ * secured data generated outside ssl_write(), e.g: handshake messages.
+ */
+static int ssl_bio_write(BIO *b, const char *in, int inl)
+{
+    pj_ssl_sock_t *ssock = (pj_ssl_sock_t*) BIO_get_data(b);
+    write_data_t *wdata = ssock->bio_wdata;
+
+    BIO_clear_retry_flags(b);
+
+#if SSL_SOCK_USE_KTLS
+    if (ssock->ktls_ctrl_msg)
+	return ktls_send_ctrl_msg(ssock, in, inl);
+#endif
+
+    if (wdata) {
+	if (wdata->data_len + inl <= ssock->bio_wmax) {
+	    pj_memcpy(wdata->data.content + wdata->data_len, in, inl);
+	    wdata->data_len += inl;
+	    return inl;
+	}
+
+	/* The slot is full, move its content to the write BIO so the
+	 * whole secured data is flushed in order by flush_write_bio().
+	 */
+	if (wdata->data_len) {
+	    BIO_write(ssock->ossl_wbio, wdata->data.content,
+		      (int)wdata->data_len);
+	    wdata->data_len = 0;
+	}
+	ssock->bio_wdata = NULL;
+    }
+
+    return BIO_write(ssock->ossl_wbio, in, inl);
+}
+
+static int ssl_bio_read(BIO *b, char *out, int outl)
+{
+    pj_ssl_sock_t *ssock = (pj_ssl_sock_t*) BIO_get_data(b);
+    int len;
+
+    BIO_clear_retry_flags(b);
+
+    /* Data left from the previous read callback goes first */
+    if (BIO_pending(ssock->ossl_rbio))
+	return BIO_read(ssock->ossl_rbio, out, outl);
+
+    if (ssock->bio_rlen == 0) {
+	BIO_set_retry_read(b);
+	return -1;
+    }
+
+    len = (int)PJ_MIN((pj_size_t)outl, ssock->bio_rlen);
+    pj_memcpy(out, ssock->bio_rdata, len);
+    ssock->bio_rdata += len;
+    ssock->bio_rlen -= len;
+
+    return len;
+}
+
+static long ssl_bio_ctrl(BIO *b, int cmd, long num, void *ptr)
+{
+    pj_ssl_sock_t *ssock = (pj_ssl_sock_t*) BIO_get_data(b);
+
+    PJ_UNUSED_ARG(num);
+    PJ_UNUSED_ARG(ptr);
+
+    if (!ssock)
+	return 0;
+
+    switch (cmd) {
+    case BIO_CTRL_PENDING:
+	return (long)(BIO_pending(ssock->ossl_rbio) + ssock->bio_rlen);
+    case BIO_CTRL_WPENDING:
+	return (long)(BIO_pending(ssock->ossl_wbio) +
+		      (ssock->bio_wdata? ssock->bio_wdata->data_len : 0));
+    case BIO_CTRL_FLUSH:
+	/* Secured data is sent by ssl_write() and flush_write_bio() */
+	return 1;
+#if SSL_SOCK_USE_KTLS
+    case BIO_CTRL_SET_KTLS:
+	return ktls_start(ssock, (const struct tls_crypto_info*)ptr,
+			  num != 0);
+    case BIO_CTRL_GET_KTLS_SEND:
+	return ssock->ktls_tx;
+    case BIO_CTRL_GET_KTLS_RECV:
+	return ssock->ktls_rx;
+    case BIO_CTRL_SET_KTLS_TX_SEND_CTRL_MSG:
+	ssock->ktls_ctrl_msg = (int)num;
+	return 0;
+    case BIO_CTRL_CLEAR_KTLS_TX_CTRL_MSG:
+	ssock->ktls_ctrl_msg = 0;
+	return 0;
+#endif
+    default:
+	return 0;
+    }
+}
+
+static int ssl_bio_create(BIO *b)
+{
+    BIO_set_data(b, NULL);
+    BIO_set_init(b, 1);
+    return 1;
+}
+
+static int ssl_bio_destroy(BIO *b)
+{
+    if (!b)
+	return 0;
+
+    BIO_set_data(b, NULL);
+    BIO_set_init(b, 0);
+    return 1;
+}
+
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+static BIO_METHOD ssl_bio_method_ = {
+    BIO_TYPE_SOURCE_SINK,
+    "pj_ssl_sock",
+    &ssl_bio_write,
+    &ssl_bio_read,
+    NULL,
+    NULL,
+    &ssl_bio_ctrl,
+    &ssl_bio_create,
+    &ssl_bio_destroy,
+    NULL
+};
+#endif
+
+/* SSL socket BIO method, created by init_openssl() */
+static BIO_METHOD *ssl_bio_method;
+
+
 /* OpenSSL library initialization counter */
 static int openssl_init_count;
 
@@ -299,6 +721,9 @@ static struct openssl_ciphers_t {
 /* OpenSSL application data index */
 static int sslsock_idx;
 
+/* TLS session resumption statistics, protected by the critical section */
+static pj_ssl_sock_sess_stat sess_stat;
+
 
 /* Initialize OpenSSL */
 static pj_status_t init_openssl(void)
@@ -359,7 +784,7 @@ static pj_status_t init_openssl(void)
 	    const SSL_CIPHER *c;
 	    c = sk_SSL_CIPHER_value(sk_cipher,i);
 	    openssl_ciphers[i].id = (pj_ssl_cipher)
-				    (pj_uint32_t)c->id & 0x00FFFFFF;
+				    (pj_uint32_t)SSL_CIPHER_get_id(c) & 0x00FFFFFF;
 	    openssl_ciphers[i].name = SSL_CIPHER_get_name(c);
 	}
 
@@ -372,6 +797,21 @@ static pj_status_t init_openssl(void)
     /* Create OpenSSL application data index for SSL socket */
     sslsock_idx = SSL_get_ex_new_index(0, "SSL socket", NULL, NULL, NULL);
 
+    /* Create SSL socket BIO method */
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+    ssl_bio_method = &ssl_bio_method_;
+#else
+    ssl_bio_method = BIO_meth_new(BIO_get_new_index() | BIO_TYPE_SOURCE_SINK,
+				  "pj_ssl_sock");
+    if (ssl_bio_method) {
+	BIO_meth_set_write(ssl_bio_method, &ssl_bio_write);
+	BIO_meth_set_read(ssl_bio_method, &ssl_bio_read);
+	BIO_meth_set_ctrl(ssl_bio_method, &ssl_bio_ctrl);
+	BIO_meth_set_create(ssl_bio_method, &ssl_bio_create);
+	BIO_meth_set_destroy(ssl_bio_method, &ssl_bio_destroy);
+    }
+#endif
+
     return PJ_SUCCESS;
 }
 
@@ -493,12 +933,198 @@ static int verify_cb(int preverify_ok, X509_STORE_CTX *x509_ctx)
     return preverify_ok;
 }
 
+
+/* Get the settings of a socket which go to its SSL context, i.e: the
+ * role, protocols, verification settings, and the credential files along
+ * with their modification time, so the context is recreated when a file
+ * is updated. Returns PJ_FALSE if the key does not fit.
+ */
+static pj_bool_t get_ctx_key(pj_ssl_sock_t *ssock, char *key, unsigned size)
+{
+    const pj_ssl_cert_t *cert = ssock->cert;
+    const pj_str_t *files[4];
+    unsigned i, len;
+    int n;
+
+    n = pj_ansi_snprintf(key, size, "%c:%x:%d:%d:%d",
+			 (ssock->is_server? 's' : 'c'),
+			 ssock->param.proto, ssock->param.sock_type,
+			 ssock->param.verify_peer,
+			 ssock->param.require_client_cert);
+    if (n < 0 || (unsigned)n >= size)
+	return PJ_FALSE;
+    len = n;
+
+    if (!cert)
+	return PJ_TRUE;
+
+    files[0] = &cert->CA_file;
+    files[1] = &cert->CA_path;
+    files[2] = &cert->cert_file;
+    files[3] = &cert->privkey_file;
+
+    for (i = 0; i < PJ_ARRAY_SIZE(files); ++i) {
+	pj_file_stat st;
+
+	if (files[i]->slen == 0 ||
+	    pj_file_getstat(files[i]->ptr, &st) != PJ_SUCCESS)
+	{
+	    st.mtime.sec = 0;
+	}
+
+	n = pj_ansi_snprintf(key + len, size - len, "|%.*s:%ld",
+			     (int)files[i]->slen, files[i]->ptr,
+			     (long)st.mtime.sec);
+	if (n < 0 || (unsigned)n >= size - len)
+	    return PJ_FALSE;
+	len += n;
+    }
+
+    return PJ_TRUE;
+}
+
+/* Get the ID of the socket settings, i.e: the hash of the context key.
+ * Sockets with the same ID share the SSL context and resume the sessions
+ * of each other. If the key does not fit, the ID is random and PJ_FALSE
+ * is returned.
+ */
+static pj_bool_t get_ctx_id(pj_ssl_sock_t *ssock, unsigned char *id)
+{
+    char key[PJ_MAXPATH * 2 + 64];
+
+    if (!get_ctx_key(ssock, key, sizeof(key)) ||
+	EVP_Digest(key, pj_ansi_strlen(key), id, NULL, EVP_sha256(),
+		   NULL) != 1)
+    {
+	RAND_bytes(id, CTX_ID_LEN);
+	return PJ_FALSE;
+    }
+
+    return PJ_TRUE;
+}
+
+
+#if defined(PJ_SSL_SOCK_OSSL_SESS_CACHE_SIZE) && \
+    PJ_SSL_SOCK_OSSL_SESS_CACHE_SIZE > 0
+
+/* Client session cache, protected by the critical section. A session is
+ * only resumed by a socket with the same settings (see get_ctx_id()), so
+ * it is not resumed with other credentials or protocols.
+ */
+static struct sess_cache_entry {
+    unsigned char	 ctx_id[CTX_ID_LEN];
+    char		 key[PJ_MAX_HOSTNAME + 8];
+    SSL_SESSION		*sess;
+} sess_cache[PJ_SSL_SOCK_OSSL_SESS_CACHE_SIZE];
+static unsigned sess_cache_next;
+
+/* Get session cache key of a client socket, i.e: the server name and
+ * port, or the remote address and port if server name is not set.
+ */
+static void get_sess_cache_key(pj_ssl_sock_t *ssock, char *key,
+			       unsigned size)
+{
+    if (ssock->param.server_name.slen) {
+	pj_ansi_snprintf(key, size, "%.*s:%d",
+			 (int)ssock->param.server_name.slen,
+			 ssock->param.server_name.ptr,
+			 pj_sockaddr_get_port(&ssock->rem_addr));
+    } else {
+	pj_sockaddr_print(&ssock->rem_addr, key, size, 3);
+    }
+}
+
+/* OpenSSL callback when the server has issued a new session (or session
+ * ticket) to a client socket.
+ */
+static int new_session_cb(SSL *ossl_ssl, SSL_SESSION *sess)
+{
+    pj_ssl_sock_t *ssock;
+    struct sess_cache_entry *entry = NULL;
+    char key[sizeof(sess_cache[0].key)];
+    unsigned i;
+
+    ssock = (pj_ssl_sock_t*) SSL_get_ex_data(ossl_ssl, sslsock_idx);
+    if (!ssock)
+	return 0;
+
+    /* Resuming a session skips the certificate verification, so only
+     * keep the session of a verified server.
+     */
+    if (ssock->verify_status != PJ_SSL_CERT_ESUCCESS || !ssock->has_ctx_id)
+	return 0;
+
+    get_sess_cache_key(ssock, key, sizeof(key));
+
+    pj_enter_critical_section();
+
+    /* Replace the session of the same server and settings, or use an
+     * empty entry, or recycle the entries in round robin.
+     */
+    for (i = 0; i < PJ_ARRAY_SIZE(sess_cache); ++i) {
+	if (sess_cache[i].sess == NULL) {
+	    if (!entry)
+		entry = &sess_cache[i];
+	} else if (pj_ansi_strcmp(sess_cache[i].key, key) == 0 &&
+		   pj_memcmp(sess_cache[i].ctx_id, ssock->ctx_id,
+			     CTX_ID_LEN) == 0)
+	{
+	    entry = &sess_cache[i];
+	    break;
+	}
+    }
+    if (!entry) {
+	entry = &sess_cache[sess_cache_next];
+	sess_cache_next = (sess_cache_next + 1) % PJ_ARRAY_SIZE(sess_cache);
+    }
+
+    if (entry->sess)
+	SSL_SESSION_free(entry->sess);
+    pj_memcpy(entry->ctx_id, ssock->ctx_id, CTX_ID_LEN);
+    pj_ansi_strcpy(entry->key, key);
+    entry->sess = sess;
+
+    pj_leave_critical_section();
+
+    /* Keep the session reference */
+    return 1;
+}
+
+/* Set the cached session of the server, if any, to be resumed by
+ * a client socket with the same settings.
+ */
+static void set_cached_session(pj_ssl_sock_t *ssock)
+{
+    char key[sizeof(sess_cache[0].key)];
+    unsigned i;
+
+    if (!ssock->has_ctx_id)
+	return;
+
+    get_sess_cache_key(ssock, key, sizeof(key));
+
+    pj_enter_critical_section();
+    for (i = 0; i < PJ_ARRAY_SIZE(sess_cache); ++i) {
+	if (sess_cache[i].sess &&
+	    pj_ansi_strcmp(sess_cache[i].key, key) == 0 &&
+	    pj_memcmp(sess_cache[i].ctx_id, ssock->ctx_id, CTX_ID_LEN) == 0)
+	{
+	    SSL_set_session(ssock->ossl_ssl, sess_cache[i].sess);
+	    break;
+	}
+    }
+    pj_leave_critical_section();
+}
+
+#endif	/* PJ_SSL_SOCK_OSSL_SESS_CACHE_SIZE */
+
+
 /* Setting SSL sock cipher list */
 static pj_status_t set_cipher_list(pj_ssl_sock_t *ssock);
 
 
-/* Create and initialize new SSL context and instance */
-static pj_status_t create_ssl(pj_ssl_sock_t *ssock)
+/* Create and initialize new SSL context */
+static pj_status_t create_ssl_ctx(pj_ssl_sock_t *ssock, SSL_CTX **p_ctx)
 {
     BIO *bio;
     DH *dh;
@@ -510,19 +1136,11 @@ static pj_status_t create_ssl(pj_ssl_sock_t *ssock)
     SSL_CTX *ctx;
     pj_uint32_t ssl_opt = 0;
     pj_ssl_cert_t *cert;
-    int mode, rc;
+    int rc;
     pj_status_t status;
-        
-    pj_assert(ssock);
 
     cert = ssock->cert;
 
-    /* Make sure OpenSSL library has been initialized */
-    init_openssl();
-
-    if (ssock->param.proto == PJ_SSL_SOCK_PROTO_DEFAULT)
-	ssock->param.proto = PJ_SSL_SOCK_PROTO_SSL23;
-
     /* Determine SSL method to use */
     switch (ssock->param.proto) {
     case PJ_SSL_SOCK_PROTO_TLS1:
@@ -581,6 +1199,11 @@ static pj_status_t create_ssl(pj_ssl_sock_t *ssock)
     if (ctx == NULL) {
 	return GET_SSL_STATUS(ssock);
     }
+#if SSL_SOCK_USE_KTLS
+    if (ssock->param.sock_type == pj_SOCK_STREAM())
+	ssl_opt |= SSL_OP_ENABLE_KTLS;
+#endif
+
     if (ssl_opt)
 	SSL_CTX_set_options(ctx, ssl_opt);
 
@@ -736,6 +1359,16 @@ static pj_status_t create_ssl(pj_ssl_sock_t *ssock)
 	    }
     #endif
 	}
+
+	/* Session IDs and session tickets issued by the context can only
+	 * be resumed by the same context, which is shared by the sockets
+	 * accepted with the same settings (see get_ssl_ctx()). OpenSSL
+	 * enables tickets by default, the session ID context is needed to
+	 * resume sessions of verified clients, and it is the ID of the
+	 * settings so that a session is not resumed with other verification
+	 * settings.
+	 */
+	SSL_CTX_set_session_id_context(ctx, ssock->ctx_id, CTX_ID_LEN);
     } else {
 	X509_STORE *pkix_validation_store = SSL_CTX_get_cert_store(ctx);
 	if (NULL != pkix_validation_store) {
@@ -748,10 +1381,139 @@ static pj_status_t create_ssl(pj_ssl_sock_t *ssock)
 				 X509_V_FLAG_PARTIAL_CHAIN);
 #endif
 	}
+
+#if defined(PJ_SSL_SOCK_OSSL_SESS_CACHE_SIZE) && \
+    PJ_SSL_SOCK_OSSL_SESS_CACHE_SIZE > 0
+	/* Keep client sessions in our own cache, which is looked up by
+	 * the server name or address and the socket settings, see
+	 * set_cached_session().
+	 */
+	SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT |
+					    SSL_SESS_CACHE_NO_INTERNAL_STORE);
+	SSL_CTX_sess_set_new_cb(ctx, &new_session_cb);
+#endif
+    }
+
+    *p_ctx = ctx;
+    return PJ_SUCCESS;
+}
+
+
+#if defined(PJ_SSL_SOCK_OSSL_CTX_CACHE_SIZE) && \
+    PJ_SSL_SOCK_OSSL_CTX_CACHE_SIZE > 0
+
+/* Shared SSL contexts, protected by the critical section */
+static struct ctx_cache_entry {
+    unsigned char	 id[CTX_ID_LEN];
+    SSL_CTX		*ctx;
+} ctx_cache[PJ_SSL_SOCK_OSSL_CTX_CACHE_SIZE];
+static unsigned ctx_cache_next;
+
+/* Get SSL context for the socket. Sockets with the same settings (see
+ * get_ctx_id()) share the context, so client connections do not reload
+ * the credentials, and accepted connections can resume the sessions
+ * issued by each other.
+ */
+static pj_status_t get_ssl_ctx(pj_ssl_sock_t *ssock, SSL_CTX **p_ctx)
+{
+    struct ctx_cache_entry *entry = NULL;
+    SSL_CTX *ctx = NULL, *old_ctx = NULL;
+    unsigned i;
+    pj_status_t status;
+
+    if (!ssock->has_ctx_id)
+	return create_ssl_ctx(ssock, p_ctx);
+
+    pj_enter_critical_section();
+    for (i = 0; i < PJ_ARRAY_SIZE(ctx_cache); ++i) {
+	if (ctx_cache[i].ctx &&
+	    pj_memcmp(ctx_cache[i].id, ssock->ctx_id, CTX_ID_LEN) == 0)
+	{
+	    ctx = ctx_cache[i].ctx;
+	    SSL_CTX_up_ref(ctx);
+	    break;
+	}
+    }
+    pj_leave_critical_section();
+
+    if (ctx) {
+	*p_ctx = ctx;
+	return PJ_SUCCESS;
+    }
+
+    status = create_ssl_ctx(ssock, &ctx);
+    if (status != PJ_SUCCESS)
+	return status;
+
+    pj_enter_critical_section();
+
+    /* Use an empty entry, or recycle the entries in round robin, unless
+     * another socket has just added the same context.
+     */
+    for (i = 0; i < PJ_ARRAY_SIZE(ctx_cache); ++i) {
+	if (ctx_cache[i].ctx == NULL) {
+	    if (!entry)
+		entry = &ctx_cache[i];
+	} else if (pj_memcmp(ctx_cache[i].id, ssock->ctx_id,
+			     CTX_ID_LEN) == 0)
+	{
+	    entry = NULL;
+	    break;
+	}
     }
+    if (i == PJ_ARRAY_SIZE(ctx_cache)) {
+	if (!entry) {
+	    entry = &ctx_cache[ctx_cache_next];
+	    ctx_cache_next = (ctx_cache_next + 1) % PJ_ARRAY_SIZE(ctx_cache);
+	}
+
+	old_ctx = entry->ctx;
+	pj_memcpy(entry->id, ssock->ctx_id, CTX_ID_LEN);
+	entry->ctx = ctx;
+	SSL_CTX_up_ref(ctx);
+    }
+
+    pj_leave_critical_section();
+
+    /* The sockets using the recycled context keep their references */
+    if (old_ctx)
+	SSL_CTX_free(old_ctx);
+
+    *p_ctx = ctx;
+    return PJ_SUCCESS;
+}
+
+#else
+
+#  define get_ssl_ctx	create_ssl_ctx
+
+#endif	/* PJ_SSL_SOCK_OSSL_CTX_CACHE_SIZE */
+
+
+/* Create and initialize new SSL context and instance */
+static pj_status_t create_ssl(pj_ssl_sock_t *ssock)
+{
+    BIO *bio;
+    int mode;
+    pj_status_t status;
+
+    pj_assert(ssock);
+
+    /* Make sure OpenSSL library has been initialized */
+    init_openssl();
+
+    if (ssock->param.proto == PJ_SSL_SOCK_PROTO_DEFAULT)
+	ssock->param.proto = PJ_SSL_SOCK_PROTO_SSL23;
+
+    /* Identify the settings of the SSL context */
+    ssock->has_ctx_id = get_ctx_id(ssock, ssock->ctx_id);
+
+    /* Get SSL context */
+    status = get_ssl_ctx(ssock, &ssock->ossl_ctx);
+    if (status != PJ_SUCCESS)
+	return status;
 
     /* Create SSL instance */
-    ssock->ossl_ctx = ctx;
     ssock->ossl_ssl = SSL_new(ssock->ossl_ctx);
     if (ssock->ossl_ssl == NULL) {
 	return GET_SSL_STATUS(ssock);
@@ -772,12 +1534,24 @@ static pj_status_t create_ssl(pj_ssl_sock_t *ssock)
     if (status != PJ_SUCCESS)
 	return status;
 
-    /* Setup SSL BIOs */
+    /* Setup SSL BIOs, see ssl_bio_read() and ssl_bio_write() */
     ssock->ossl_rbio = BIO_new(BIO_s_mem());
     ssock->ossl_wbio = BIO_new(BIO_s_mem());
-    (void)BIO_set_close(ssock->ossl_rbio, BIO_CLOSE);
-    (void)BIO_set_close(ssock->ossl_wbio, BIO_CLOSE);
-    SSL_set_bio(ssock->ossl_ssl, ssock->ossl_rbio, ssock->ossl_wbio);
+    if (!ssock->ossl_rbio || !ssock->ossl_wbio || !ssl_bio_method)
+	return PJ_ENOMEM;
+
+    bio = BIO_new(ssl_bio_method);
+    if (bio == NULL)
+	return PJ_ENOMEM;
+    BIO_set_data(bio, ssock);
+    SSL_set_bio(ssock->ossl_ssl, bio, bio);
+
+#if defined(PJ_SSL_SOCK_OSSL_SESS_CACHE_SIZE) && \
+    PJ_SSL_SOCK_OSSL_SESS_CACHE_SIZE > 0
+    /* Try to resume the previous session with the server */
+    if (!ssock->is_server)
+	set_cached_session(ssock);
+#endif
 
     return PJ_SUCCESS;
 }
@@ -789,10 +1563,23 @@ static void destroy_ssl(pj_ssl_sock_t *ssock)
     /* Destroy SSL instance */
     if (ssock->ossl_ssl) {
 	SSL_shutdown(ssock->ossl_ssl);
-	SSL_free(ssock->ossl_ssl); /* this will also close BIOs */
+	SSL_free(ssock->ossl_ssl); /* this will also close SSL socket BIO */
 	ssock->ossl_ssl = NULL;
     }
 
+    /* Destroy memory BIOs, after SSL_shutdown() is done with them */
+    if (ssock->ossl_rbio) {
+	BIO_free(ssock->ossl_rbio);
+	ssock->ossl_rbio = NULL;
+    }
+    if (ssock->ossl_wbio) {
+	BIO_free(ssock->ossl_wbio);
+	ssock->ossl_wbio = NULL;
+    }
+    ssock->bio_rdata = NULL;
+    ssock->bio_rlen = 0;
+    ssock->bio_wdata = NULL;
+
     /* Destroy SSL context */
     if (ssock->ossl_ctx) {
 	SSL_CTX_free(ssock->ossl_ctx);
@@ -863,7 +1650,7 @@ static pj_status_t set_cipher_list(pj_ssl_sock_t *ssock)
 	    const SSL_CIPHER *c;
 	    c = sk_SSL_CIPHER_value(sk_cipher, j);
 	    if (ssock->param.ciphers[i] == (pj_ssl_cipher)
-					   ((pj_uint32_t)c->id & 0x00FFFFFF))
+				((pj_uint32_t)SSL_CIPHER_get_id(c) & 0x00FFFFFF))
 	    {
 		const char *c_name;
 
@@ -1142,10 +1929,29 @@ static pj_bool_t on_handshake_complete(pj_ssl_sock_t *ssock,
 	ssock->timer.id = TIMER_NONE;
     }
 
-    /* Update certificates info on successful handshake */
-    if (status == PJ_SUCCESS)
+    /* Update certificates info and session resumption statistics on
+     * successful handshake.
+     */
+    if (status == PJ_SUCCESS) {
+	pj_bool_t reused = SSL_session_reused(ssock->ossl_ssl);
+
 	update_certs_info(ssock);
 
+	pj_enter_critical_section();
+	if (ssock->is_server) {
+	    if (reused)
+		++sess_stat.server_hits;
+	    else
+		++sess_stat.server_misses;
+	} else {
+	    if (reused)
+		++sess_stat.client_hits;
+	    else
+		++sess_stat.client_misses;
+	}
+	pj_leave_critical_section();
+    }
+
     /* Accepting */
     if (ssock->is_server) {
 	if (status != PJ_SUCCESS) {
@@ -1392,6 +2198,39 @@ pj_status_t pj_ssl_sock_ossl_test_send_buf(pj_pool_t *pool)
 #endif
 
 
+/* Send the secured data in a send buffer slot to network socket, the slot
+ * is released unless the sending is pending.
+ */
+static pj_status_t send_write_data(pj_ssl_sock_t *ssock,
+				   write_data_t *wdata)
+{
+    pj_ssize_t len = wdata->data_len;
+    pj_status_t status;
+
+    if (ssock->param.sock_type == pj_SOCK_STREAM()) {
+	status = pj_activesock_send(ssock->asock, &wdata->key, 
+				    wdata->data.content, &len,
+				    wdata->flags);
+    } else {
+	status = pj_activesock_sendto(ssock->asock, &wdata->key, 
+				      wdata->data.content, &len,
+				      wdata->flags,
+				      (pj_sockaddr_t*)&ssock->rem_addr,
+				      ssock->addr_len);
+    }
+
+    if (status != PJ_EPENDING) {
+	/* When the sending is not pending, remove the wdata from send
+	 * pending list.
+	 */
+	pj_lock_acquire(ssock->write_mutex);
+	free_send_data(ssock, wdata);
+	pj_lock_release(ssock->write_mutex);
+    }
+
+    return status;
+}
+
 /* Flush write BIO to network socket. Note that any access to write BIO
  * MUST be serialized, so mutex protection must cover any call to OpenSSL
  * API (that possibly generate data for write BIO) along with the call to
@@ -1407,7 +2246,6 @@ static pj_status_t flush_write_bio(pj_ssl_sock_t *ssock,
     pj_ssize_t len;
     write_data_t *wdata;
     pj_size_t needed_len;
-    pj_status_t status;
 
     pj_lock_acquire(ssock->write_mutex);
 
@@ -1452,28 +2290,90 @@ static pj_status_t flush_write_bio(pj_ssl_sock_t *ssock,
     pj_lock_release(ssock->write_mutex);
 
     /* Send it */
-    if (ssock->param.sock_type == pj_SOCK_STREAM()) {
-	status = pj_activesock_send(ssock->asock, &wdata->key, 
-				    wdata->data.content, &len,
-				    flags);
-    } else {
-	status = pj_activesock_sendto(ssock->asock, &wdata->key, 
-				      wdata->data.content, &len,
-				      flags,
-				      (pj_sockaddr_t*)&ssock->rem_addr,
-				      ssock->addr_len);
+    return send_write_data(ssock, wdata);
+}
+
+
+/* Maximum expansion of a TLS record over its plain data: the record
+ * header, explicit IV, MAC, and padding of CBC cipher suites.
+ */
+#define SSL_RECORD_MAX_OVERHEAD	(5 + 16 + 64 + 256)
+#define SSL_RECORD_MAX_PLAIN	16384
+
+/* Prepare a send buffer slot for SSL_write() of the specified plain data
+ * length, so SSL writes the secured data directly into the slot (see
+ * ssl_bio_write()). The slot is sized for the worst case and shrunk by
+ * end_write_slot(). This must be called with write mutex held.
+ */
+static write_data_t* begin_write_slot(pj_ssl_sock_t *ssock,
+				      pj_ioqueue_op_key_t *send_key,
+				      pj_size_t orig_len,
+				      unsigned flags)
+{
+    write_data_t *wdata;
+    pj_size_t max_len, needed_len;
+
+    /* The secured data must be sent after anything in write BIO */
+    if (BIO_pending(ssock->ossl_wbio))
+	return NULL;
+
+    /* Count one more record for the empty fragment that OpenSSL may
+     * insert before the data in CBC mode.
+     */
+    max_len = orig_len + (orig_len / SSL_RECORD_MAX_PLAIN + 2) *
+			 SSL_RECORD_MAX_OVERHEAD;
+    needed_len = max_len + sizeof(write_data_t);
+    needed_len = ((needed_len + 7) >> 3) << 3;
+
+    wdata = alloc_send_data(ssock, needed_len);
+    if (wdata == NULL)
+	return NULL;
+
+    pj_ioqueue_op_key_init(&wdata->key, sizeof(pj_ioqueue_op_key_t));
+    wdata->key.user_data = wdata;
+    wdata->app_key = send_key;
+    wdata->record_len = needed_len;
+    wdata->data_len = 0;
+    wdata->plain_data_len = orig_len;
+    wdata->flags = flags;
+
+    ssock->bio_wdata = wdata;
+    ssock->bio_wmax = max_len;
+
+    return wdata;
+}
+
+/* Detach the send buffer slot from SSL after SSL_write(), and give its
+ * unused space back to the send buffer. If the slot is not going to be
+ * sent, its content is moved to write BIO. Returns NULL when the slot has
+ * been released. This must be called with write mutex held.
+ */
+static write_data_t* end_write_slot(pj_ssl_sock_t *ssock,
+				    write_data_t *wdata,
+				    pj_bool_t send_it)
+{
+    pj_size_t record_len;
+
+    ssock->bio_wdata = NULL;
+
+    if (!send_it && wdata->data_len) {
+	BIO_write(ssock->ossl_wbio, wdata->data.content,
+		  (int)wdata->data_len);
+	wdata->data_len = 0;
     }
 
-    if (status != PJ_EPENDING) {
-	/* When the sending is not pending, remove the wdata from send
-	 * pending list.
-	 */
-	pj_lock_acquire(ssock->write_mutex);
+    if (wdata->data_len == 0) {
 	free_send_data(ssock, wdata);
-	pj_lock_release(ssock->write_mutex);
+	return NULL;
     }
 
-    return status;
+    /* The slot is the last data in the send buffer, see alloc_send_data() */
+    record_len = wdata->data_len + sizeof(write_data_t);
+    record_len = ((record_len + 7) >> 3) << 3;
+    ssock->send_buf.len -= (wdata->record_len - record_len);
+    wdata->record_len = record_len;
+
+    return wdata;
 }
 
 
@@ -1548,26 +2448,14 @@ static pj_status_t do_handshake(pj_ssl_sock_t *ssock)
  *******************************************************************
  */
 
-static pj_bool_t asock_on_data_read (pj_activesock_t *asock,
+/* Process network data, which has been set as the input of SSL socket BIO
+ * by asock_on_data_read().
+ */
+static pj_bool_t ssl_on_network_data(pj_ssl_sock_t *ssock,
 				     void *data,
-				     pj_size_t size,
 				     pj_status_t status,
 				     pj_size_t *remainder)
 {
-    pj_ssl_sock_t *ssock = (pj_ssl_sock_t*)
-			   pj_activesock_get_user_data(asock);
-    pj_size_t nwritten;
-
-    /* Socket error or closed */
-    if (data && size > 0) {
-	/* Consume the whole data */
-	nwritten = BIO_write(ssock->ossl_rbio, data, (int)size);
-	if (nwritten < size) {
-	    status = GET_SSL_STATUS(ssock);
-	    goto on_error;
-	}
-    }
-
     /* Check if SSL handshake hasn't finished yet */
     if (ssock->ssl_state == SSL_STATE_HANDSHAKING) {
 	pj_bool_t ret = PJ_TRUE;
@@ -1582,6 +2470,12 @@ static pj_bool_t asock_on_data_read (pj_activesock_t *asock,
 	return ret;
     }
 
+#if SSL_SOCK_USE_KTLS
+    /* The kernel has received a record which is not application data */
+    if (ssock->ktls_rx && status == PJ_STATUS_FROM_OS(EIO))
+	status = ktls_recv_ctrl_msg(ssock);
+#endif
+
     /* See if there is any decrypted data for the application */
     if (ssock->read_started) {
 	do {
@@ -1589,12 +2483,33 @@ static pj_bool_t asock_on_data_read (pj_activesock_t *asock,
 	    void *data_ = (pj_int8_t*)buf->data + buf->len;
 	    int size_ = (int)(ssock->read_size - buf->len);
 
-	    /* SSL_read() may write some data to BIO write when re-negotiation
-	     * is on progress, so let's protect it with write mutex.
-	     */
-	    pj_lock_acquire(ssock->write_mutex);
-	    size_ = SSL_read(ssock->ossl_ssl, data_, size_);
-	    pj_lock_release(ssock->write_mutex);
+#if SSL_SOCK_USE_KTLS
+	    if (ssock->ktls_rx) {
+		/* The kernel has decrypted the data, the read BIO only keeps
+		 * the data not delivered by the previous read callback.
+		 */
+		if (BIO_pending(ssock->ossl_rbio)) {
+		    size_ = BIO_read(ssock->ossl_rbio, data_, size_);
+		} else {
+		    size_ = (int)PJ_MIN((pj_size_t)size_, ssock->bio_rlen);
+		    pj_memcpy(data_, ssock->bio_rdata, size_);
+		    ssock->bio_rdata += size_;
+		    ssock->bio_rlen -= size_;
+		}
+
+		if (size_ <= 0 && status == PJ_SUCCESS)
+		    break;
+	    } else
+#endif
+	    {
+		/* SSL_read() may write some data to BIO write when
+		 * re-negotiation is on progress, so let's protect it with
+		 * write mutex.
+		 */
+		pj_lock_acquire(ssock->write_mutex);
+		size_ = SSL_read(ssock->ossl_ssl, data_, size_);
+		pj_lock_release(ssock->write_mutex);
+	    }
 
 	    if (size_ > 0 || status != PJ_SUCCESS) {
 		if (ssock->param.cb.on_data_read) {
@@ -1695,6 +2610,42 @@ on_error:
     return PJ_FALSE;
 }
 
+static pj_bool_t asock_on_data_read (pj_activesock_t *asock,
+				     void *data,
+				     pj_size_t size,
+				     pj_status_t status,
+				     pj_size_t *remainder)
+{
+    pj_ssl_sock_t *ssock = (pj_ssl_sock_t*)
+			   pj_activesock_get_user_data(asock);
+    pj_bool_t ret;
+
+    /* Let SSL read the data in place, from the active socket read buffer */
+    if (data && size > 0) {
+	ssock->bio_rdata = (const char*)data;
+	ssock->bio_rlen = size;
+    }
+
+    ret = ssl_on_network_data(ssock, data, status, remainder);
+
+    /* The active socket is going to reuse its read buffer, so keep the
+     * data that SSL has not consumed yet (e.g: application data received
+     * along with the last handshake message) in read BIO.
+     */
+    if (ret && ssock->bio_rlen) {
+	int len = (int)ssock->bio_rlen;
+
+	if (BIO_write(ssock->ossl_rbio, ssock->bio_rdata, len) < len) {
+	    PJ_PERROR(1,(ssock->pool->obj_name, GET_SSL_STATUS(ssock),
+			 "Failed to keep unread data"));
+	}
+	ssock->bio_rdata = NULL;
+	ssock->bio_rlen = 0;
+    }
+
+    return ret;
+}
+
 
 static pj_bool_t asock_on_data_sent (pj_activesock_t *asock,
 				     pj_ioqueue_op_key_t *send_key,
@@ -2282,7 +3233,7 @@ PJ_DEF(pj_status_t) pj_ssl_sock_get_info (pj_ssl_sock_t *ssock,
 
 	/* Current cipher */
 	cipher = SSL_get_current_cipher(ssock->ossl_ssl);
-	info->cipher = (cipher->id & 0x00FFFFFF);
+	info->cipher = (SSL_CIPHER_get_id(cipher) & 0x00FFFFFF);
 
 	/* Remote address */
 	pj_sockaddr_cp(&info->remote_addr, &ssock->rem_addr);
@@ -2421,21 +3372,31 @@ static pj_status_t ssl_write(pj_ssl_sock_t *ssock,
 			     pj_ssize_t size,
 			     unsigned flags)
 {
+    write_data_t *wdata;
     pj_status_t status;
     int nwritten;
 
-    /* Write the plain data to SSL, after SSL encrypts it, write BIO will
-     * contain the secured data to be sent via socket. Note that re-
-     * negotitation may be on progress, so sending data should be delayed
-     * until re-negotiation is completed.
+    /* Write the plain data to SSL, after SSL encrypts it, the send buffer
+     * slot (or write BIO, when the slot cannot be used) will contain the
+     * secured data to be sent via socket. Note that re-negotitation may
+     * be on progress, so sending data should be delayed until
+     * re-negotiation is completed.
      */
     pj_lock_acquire(ssock->write_mutex);
+    wdata = begin_write_slot(ssock, send_key, size, flags);
     nwritten = SSL_write(ssock->ossl_ssl, data, (int)size);
+    if (wdata)
+	wdata = end_write_slot(ssock, wdata, (nwritten == size));
     pj_lock_release(ssock->write_mutex);
-    
+
     if (nwritten == size) {
-	/* All data written, flush write BIO to network socket */
-	status = flush_write_bio(ssock, send_key, size, flags);
+	/* All data written, send the slot or flush write BIO to network
+	 * socket.
+	 */
+	if (wdata)
+	    status = send_write_data(ssock, wdata);
+	else
+	    status = flush_write_bio(ssock, send_key, size, flags);
     } else if (nwritten <= 0) {
 	/* SSL failed to process the data, it may just that re-negotiation
 	 * is on progress.
@@ -2850,6 +3811,21 @@ PJ_DEF(pj_status_t) pj_ssl_sock_renegotiate(pj_ssl_sock_t *ssock)
 }
 
 
+/*
+ * Get the TLS session resumption statistics.
+ */
+PJ_DEF(pj_status_t) pj_ssl_sock_get_sess_stat(pj_ssl_sock_sess_stat *stat)
+{
+    PJ_ASSERT_RETURN(stat, PJ_EINVAL);
+
+    pj_enter_critical_section();
+    pj_memcpy(stat, &sess_stat, sizeof(*stat));
+    pj_leave_critical_section();
+
+    return PJ_SUCCESS;
+}
+
+
 /* Put back deprecation warning setting */
 #if defined(PJ_DARWINOS) && PJ_DARWINOS==1
 #  pragma GCC diagnostic pop
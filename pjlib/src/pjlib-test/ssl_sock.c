@@ -1330,6 +1330,182 @@ on_return:
     return status;
 }
 
+/* Connect to the same server twice, the second connection should resume
+ * the session of the first one. Then connect with a client certificate,
+ * which should not resume the session of the other credentials.
+ */
+static int sess_resume_test(void)
+{
+    pj_pool_t *pool = NULL;
+    pj_ioqueue_t *ioqueue = NULL;
+    pj_ssl_sock_t *ssock_serv = NULL;
+    pj_ssl_sock_param param;
+    struct test_state state_serv = { 0 };
+    pj_sockaddr addr, listen_addr;
+    pj_ssl_cert_t *cert = NULL;
+    pj_ssl_sock_sess_stat stat0, stat1;
+    pj_str_t tmp1, tmp2, tmp3, tmp4;
+    unsigned i;
+    pj_status_t status;
+
+    status = pj_ssl_sock_get_sess_stat(&stat0);
+    if (status == PJ_ENOTSUP)
+	return 0;
+
+    pool = pj_pool_create(mem, "ssl_resume", 256, 256, NULL);
+
+    status = pj_ioqueue_create(pool, 8, &ioqueue);
+    if (status != PJ_SUCCESS) {
+	goto on_return;
+    }
+
+    pj_ssl_sock_param_default(&param);
+    param.cb.on_accept_complete = &ssl_on_accept_complete;
+    param.cb.on_connect_complete = &ssl_on_connect_complete;
+    param.cb.on_data_read = &ssl_on_data_read;
+    param.cb.on_data_sent = &ssl_on_data_sent;
+    param.ioqueue = ioqueue;
+
+    pj_sockaddr_init(PJ_AF_INET, &addr, pj_strset2(&tmp1, "127.0.0.1"), 0);
+
+    /* === SERVER === */
+    param.user_data = &state_serv;
+
+    state_serv.pool = pool;
+    state_serv.echo = PJ_TRUE;
+    state_serv.is_server = PJ_TRUE;
+
+    status = pj_ssl_sock_create(pool, &param, &ssock_serv);
+    if (status != PJ_SUCCESS) {
+	goto on_return;
+    }
+
+    status = pj_ssl_cert_load_from_files(pool, 
+					 pj_strset2(&tmp1, (char*)CERT_CA_FILE), 
+					 pj_strset2(&tmp2, (char*)CERT_FILE), 
+					 pj_strset2(&tmp3, (char*)CERT_PRIVKEY_FILE), 
+					 pj_strset2(&tmp4, (char*)CERT_PRIVKEY_PASS), 
+					 &cert);
+    if (status != PJ_SUCCESS) {
+	goto on_return;
+    }
+
+    status = pj_ssl_sock_set_certificate(ssock_serv, pool, cert);
+    if (status != PJ_SUCCESS) {
+	goto on_return;
+    }
+
+    status = pj_ssl_sock_start_accept(ssock_serv, pool, &addr, pj_sockaddr_get_len(&addr));
+    if (status != PJ_SUCCESS) {
+	goto on_return;
+    }
+
+    /* Get listener address */
+    {
+	pj_ssl_sock_info info;
+
+	pj_ssl_sock_get_info(ssock_serv, &info);
+	pj_sockaddr_cp(&listen_addr, &info.local_addr);
+    }
+
+    /* Client only verifies the server */
+    pj_strset2(&tmp2, NULL);
+    status = pj_ssl_cert_load_from_files(pool, &tmp1, &tmp2, &tmp2, &tmp2,
+					 &cert);
+    if (status != PJ_SUCCESS) {
+	goto on_return;
+    }
+
+    /* === CLIENTS === */
+    for (i = 0; i < 3; ++i) {
+	struct test_state state_cli = { 0 };
+	pj_ssl_sock_t *ssock_cli = NULL;
+
+	/* Last client also authenticates itself */
+	if (i == 2) {
+	    status = pj_ssl_cert_load_from_files(pool, &tmp1,
+				pj_strset2(&tmp2, (char*)CERT_FILE),
+				pj_strset2(&tmp3, (char*)CERT_PRIVKEY_FILE),
+				pj_strset2(&tmp4, (char*)CERT_PRIVKEY_PASS),
+				&cert);
+	    if (status != PJ_SUCCESS) {
+		goto on_return;
+	    }
+	}
+
+	param.user_data = &state_cli;
+
+	state_cli.pool = pool;
+	state_cli.check_echo = PJ_TRUE;
+	state_cli.send_str = (char*)"session resumption test";
+	state_cli.send_str_len = pj_ansi_strlen(state_cli.send_str);
+
+	status = pj_ssl_sock_create(pool, &param, &ssock_cli);
+	if (status != PJ_SUCCESS) {
+	    goto on_return;
+	}
+
+	status = pj_ssl_sock_set_certificate(ssock_cli, pool, cert);
+	if (status != PJ_SUCCESS) {
+	    pj_ssl_sock_close(ssock_cli);
+	    goto on_return;
+	}
+
+	status = pj_ssl_sock_start_connect(ssock_cli, pool, &addr, &listen_addr, pj_sockaddr_get_len(&addr));
+	if (status == PJ_SUCCESS) {
+	    ssl_on_connect_complete(ssock_cli, PJ_SUCCESS);
+	} else if (status == PJ_EPENDING) {
+	    status = PJ_SUCCESS;
+	} else {
+	    pj_ssl_sock_close(ssock_cli);
+	    goto on_return;
+	}
+
+	/* Wait until the echo has been received or error */
+	while (!state_cli.err && !state_cli.done) {
+	    pj_time_val delay = {0, 100};
+	    pj_ioqueue_poll(ioqueue, &delay);
+	}
+
+	/* Clean up sockets */
+	{
+	    pj_time_val delay = {0, 100};
+	    while (pj_ioqueue_poll(ioqueue, &delay) > 0);
+	}
+
+	if (state_cli.err) {
+	    status = state_cli.err;
+	    goto on_return;
+	}
+    }
+
+    pj_ssl_sock_get_sess_stat(&stat1);
+    PJ_LOG(3, ("", ".....Client hits/misses: %u/%u, server hits/misses: %u/%u",
+	       stat1.client_hits - stat0.client_hits,
+	       stat1.client_misses - stat0.client_misses,
+	       stat1.server_hits - stat0.server_hits,
+	       stat1.server_misses - stat0.server_misses));
+
+#if PJ_SSL_SOCK_OSSL_SESS_CACHE_SIZE > 0 && PJ_SSL_SOCK_OSSL_CTX_CACHE_SIZE > 0
+    if (stat1.client_hits - stat0.client_hits != 1 ||
+	stat1.client_misses - stat0.client_misses != 2 ||
+	stat1.server_hits - stat0.server_hits != 1)
+    {
+	status = PJ_EBUG;
+    }
+#endif
+
+on_return:
+    if (ssock_serv)
+	pj_ssl_sock_close(ssock_serv);
+    if (ioqueue)
+	pj_ioqueue_destroy(ioqueue);
+    if (pool)
+	pj_pool_release(pool);
+
+    return status;
+}
+
 #if 0 && (!defined(PJ_SYMBIAN) || PJ_SYMBIAN==0)
 pj_status_t pj_ssl_sock_ossl_test_send_buf(pj_pool_t *pool);
 static int ossl_test_send_buf()
@@ -1418,6 +1594,11 @@ int ssl_sock_test(void)
     if (ret != 0)
 	return ret;
 
+    PJ_LOG(3,("", "..session resumption test"));
+    ret = sess_resume_test();
+    if (ret != 0)
+	return ret;
+
     PJ_LOG(3,("", "..performance test"));
     ret = perf_test(PJ_IOQUEUE_MAX_HANDLES/2 - 1, 0);
     if (ret != 0)
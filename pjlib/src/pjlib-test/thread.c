@@ -38,6 +38,7 @@
  *  - pj_thread_get_name()
  *  - pj_thread_destroy()
  *  - pj_thread_resume()
+ *  - pj_thread_set_cpu_affinity()
  *  - pj_thread_sleep()
  *  - pj_thread_join()
  *  - pj_thread_destroy()
@@ -142,6 +143,13 @@ static int simple_thread(const char *title, unsigned flags)
 	return -1010;
     }
 
+    /* Pin the thread to the last CPU, where supported */
+    rc = pj_thread_set_cpu_affinity(thread, pj_get_cpu_count() - 1);
+    if (rc != PJ_SUCCESS && rc != PJ_ENOTSUP) {
+	app_perror("...error: unable to set thread affinity", rc);
+	return -1012;
+    }
+
     TRACE__((THIS_FILE, "    Main thread waiting.."));
     pj_thread_sleep(1500);
     TRACE__((THIS_FILE, "    Main thread resuming.."));
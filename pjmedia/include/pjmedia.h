@@ -45,15 +45,18 @@
 #include <pjmedia/master_port.h>
 #include <pjmedia/mem_port.h>
 #include <pjmedia/null_port.h>
+#include <pjmedia/pkt_pool.h>
 #include <pjmedia/plc.h>
 #include <pjmedia/port.h>
 #include <pjmedia/resample.h>
+#include <pjmedia/ring_port.h>
 #include <pjmedia/rtcp.h>
 #include <pjmedia/rtcp_xr.h>
 #include <pjmedia/rtp.h>
 #include <pjmedia/sdp.h>
 #include <pjmedia/sdp_neg.h>
 //#include <pjmedia/session.h>
+#include <pjmedia/signal_ops.h>
 #include <pjmedia/silencedet.h>
 #include <pjmedia/sound.h>
 #include <pjmedia/sound_port.h>
@@ -70,8 +73,10 @@
 #include <pjmedia/transport_udp.h>
 #include <pjmedia/vid_port.h>
 #include <pjmedia/vid_codec.h>
+#include <pjmedia/vid_frame_pool.h>
 #include <pjmedia/vid_stream.h>
 #include <pjmedia/vid_tee.h>
+#include <pjmedia/wav_cache.h>
 #include <pjmedia/wav_playlist.h>
 #include <pjmedia/wav_port.h>
 #include <pjmedia/wave.h>
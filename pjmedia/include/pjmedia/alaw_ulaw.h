@@ -207,6 +207,65 @@ PJ_INLINE(void) pjmedia_alaw_decode(pj_int16_t *dst, const pj_uint8_t *src,
     }
 }
 
+/**
+ * Select the fastest implementation of the block conversion functions
+ * for this CPU. This is called by #pjmedia_endpt_create(). Applications
+ * which use the block functions without a media endpoint may call it
+ * during their initialization, otherwise the portable implementation is
+ * used. It must not be called while other threads are converting.
+ */
+PJ_DECL(void) pjmedia_alaw_ulaw_block_init(void);
+
+/**
+ * Encode a block of 16-bit linear PCM data to 8-bit U-Law data. This
+ * produces the same output as #pjmedia_ulaw_encode(), but uses SIMD
+ * instructions when they are supported by the CPU (see
+ * #PJMEDIA_HAS_G711_SIMD), which is faster for frame sized blocks.
+ *
+ * @param dst	    Destination buffer for 8-bit U-Law data.
+ * @param src	    Source, 16-bit linear PCM data.
+ * @param count	    Number of samples.
+ */
+PJ_DECL(void) pjmedia_ulaw_encode_block(pj_uint8_t *dst,
+					const pj_int16_t *src,
+					pj_size_t count);
+
+/**
+ * Encode a block of 16-bit linear PCM data to 8-bit A-Law data, with
+ * SIMD instructions when available. See #pjmedia_ulaw_encode_block().
+ *
+ * @param dst	    Destination buffer for 8-bit A-Law data.
+ * @param src	    Source, 16-bit linear PCM data.
+ * @param count	    Number of samples.
+ */
+PJ_DECL(void) pjmedia_alaw_encode_block(pj_uint8_t *dst,
+					const pj_int16_t *src,
+					pj_size_t count);
+
+/**
+ * Decode a block of 8-bit U-Law data to 16-bit linear PCM data, with
+ * SIMD instructions when available. See #pjmedia_ulaw_encode_block().
+ *
+ * @param dst	    Destination buffer for 16-bit PCM data.
+ * @param src	    Source, 8-bit U-Law data.
+ * @param len	    Encoded frame/source length in bytes.
+ */
+PJ_DECL(void) pjmedia_ulaw_decode_block(pj_int16_t *dst,
+					const pj_uint8_t *src,
+					pj_size_t len);
+
+/**
+ * Decode a block of 8-bit A-Law data to 16-bit linear PCM data, with
+ * SIMD instructions when available. See #pjmedia_ulaw_encode_block().
+ *
+ * @param dst	    Destination buffer for 16-bit PCM data.
+ * @param src	    Source, 8-bit A-Law data.
+ * @param len	    Encoded frame/source length in bytes.
+ */
+PJ_DECL(void) pjmedia_alaw_decode_block(pj_int16_t *dst,
+					const pj_uint8_t *src,
+					pj_size_t len);
+
 PJ_END_DECL
 
 #endif	/* __PJMEDIA_ALAW_ULAW_H__ */
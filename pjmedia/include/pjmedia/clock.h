@@ -162,6 +162,12 @@ pjmedia_clock_src_get_time_msec( const pjmedia_clock_src *clocksrc );
 typedef struct pjmedia_clock pjmedia_clock;
 
 
+/**
+ * Opaque declaration for media clock scheduler.
+ */
+typedef struct pjmedia_clock_sched pjmedia_clock_sched;
+
+
 /**
  * Options when creating the clock.
  */
@@ -273,7 +279,9 @@ PJ_DECL(pj_status_t) pjmedia_clock_start(pjmedia_clock *clock);
 
 
 /**
- * Stop the clock.
+ * Stop the clock. When the clock is driven by a clock scheduler and its
+ * callback is being called, this waits until the callback returns, unless
+ * it is called from a clock callback of the same scheduler.
  *
  * @param clock		    The media clock.
  *
@@ -323,6 +331,79 @@ PJ_DECL(pj_bool_t) pjmedia_clock_wait(pjmedia_clock *clock,
 PJ_DECL(pj_status_t) pjmedia_clock_destroy(pjmedia_clock *clock);
 
 
+/**
+ * Attach the clock to a clock scheduler, or detach it from its scheduler
+ * when \a sched is NULL. A clock attached to a scheduler does not create
+ * its own thread when it is started, instead its callback is called by
+ * one of the scheduler threads. This can only be done while the clock is
+ * not running, and is not valid for clock created with
+ * PJMEDIA_CLOCK_NO_ASYNC option.
+ *
+ * @param clock		    The media clock.
+ * @param sched		    The clock scheduler, or NULL.
+ *
+ * @return		    PJ_SUCCES on success.
+ */
+PJ_DECL(pj_status_t) pjmedia_clock_set_sched(pjmedia_clock *clock,
+					     pjmedia_clock_sched *sched);
+
+
+/**
+ * Create a clock scheduler. A clock scheduler drives any number of media
+ * clocks (see #pjmedia_clock_set_sched()) from a small, fixed number of
+ * threads, which is useful when an application runs many clocks at the
+ * same time, for example one master port per call. Each clock is given
+ * to the least loaded thread when it is started, and its first tick is
+ * placed in the least used time slot within one clock interval, so that
+ * the clocks are spread evenly across the frame interval instead of all
+ * ticking at the same moment.
+ *
+ * Each thread wakes up once every #PJMEDIA_CLOCK_SCHED_SLOT_USEC and calls
+ * the callbacks of the clocks which ticks have elapsed, so the timing
+ * resolution of the clocks is one slot. The callbacks of the clocks that
+ * share a thread are called one after another, so they should not block.
+ *
+ * @param pool		    Pool to allocate memory.
+ * @param thread_cnt	    Number of scheduler threads. If zero, one thread
+ *			    per CPU will be created.
+ * @param options	    Bitmask of pjmedia_clock_options. Only
+ *			    PJMEDIA_CLOCK_NO_HIGHEST_PRIO is used.
+ * @param p_sched	    Pointer to receive the clock scheduler.
+ *
+ * @return		    PJ_SUCCESS on success, or the appropriate error
+ *			    code.
+ */
+PJ_DECL(pj_status_t) pjmedia_clock_sched_create(pj_pool_t *pool,
+						unsigned thread_cnt,
+						unsigned options,
+						pjmedia_clock_sched **p_sched);
+
+
+/**
+ * Get the number of clocks which are currently running in the scheduler.
+ *
+ * @param sched		    The clock scheduler.
+ *
+ * @return		    Number of running clocks.
+ */
+PJ_DECL(unsigned) pjmedia_clock_sched_get_clock_count(
+					    pjmedia_clock_sched *sched);
+
+
+/**
+ * Destroy the clock scheduler. Clocks which are still running in the
+ * scheduler are stopped and detached from it, so they run on their own
+ * thread if they are started again. Clocks which are attached to the
+ * scheduler but not running must be attached to another scheduler or
+ * detached with #pjmedia_clock_set_sched() before they are started again.
+ *
+ * @param sched		    The clock scheduler.
+ *
+ * @return		    PJ_SUCCES on success.
+ */
+PJ_DECL(pj_status_t) pjmedia_clock_sched_destroy(pjmedia_clock_sched *sched);
+
+
 
 PJ_END_DECL
 
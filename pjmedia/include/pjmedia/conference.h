@@ -91,8 +91,17 @@ enum pjmedia_conf_option
 				     microphone device.			    */
     PJMEDIA_CONF_NO_DEVICE = 2,	/**< Do not create sound device.	    */
     PJMEDIA_CONF_SMALL_FILTER=4,/**< Use small filter table when resampling */
-    PJMEDIA_CONF_USE_LINEAR=8	/**< Use linear resampling instead of filter
+    PJMEDIA_CONF_USE_LINEAR=8,	/**< Use linear resampling instead of filter
 				     based.				    */
+    PJMEDIA_CONF_VAD=16		/**< Run adaptive silence detection on the
+				     audio received from each port. Silent
+				     ports are not mixed, and a port that
+				     receives no signal from any transmitter
+				     is given NULL frames after a short
+				     while, so its resampling and encoding
+				     can be skipped. Note that recorders
+				     will not record such periods. This is
+				     not supported by the switchboard.	    */
 };
 
 
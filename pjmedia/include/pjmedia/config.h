@@ -248,6 +248,22 @@
 #endif
 
 
+/**
+ * Let the stream use the jitter buffer as lookahead for packet loss
+ * concealment. When a frame is lost but the frame following it is already
+ * in the jitter buffer, the stream decodes that frame early and
+ * interpolates the concealed frame towards it (see
+ * #pjmedia_plc_interpolate()), instead of only extrapolating from the
+ * past. Codecs without their own PLC are concealed with the generic
+ * PJMEDIA PLC.
+ *
+ * Default: 1
+ */
+#ifndef PJMEDIA_STREAM_PLC_LOOKAHEAD
+#   define PJMEDIA_STREAM_PLC_LOOKAHEAD	    1
+#endif
+
+
 /**
  * Specify number of sound buffers. Larger number is better for sound
  * stability and to accommodate sound devices that are unable to send frames
@@ -265,6 +281,20 @@
 #endif
 
 
+/**
+ * Specify the capacity, in frames, of each of the lock-free rings used by
+ * the sound device port when it is created with the
+ * PJMEDIA_SND_PORT_DECOUPLED option. The rings try to keep half of this
+ * number of frames buffered, so this adds (value/2) frames of latency in
+ * each direction.
+ *
+ * Default: 4
+ */
+#ifndef PJMEDIA_SND_PORT_RING_FRAMES
+#   define PJMEDIA_SND_PORT_RING_FRAMES	    4
+#endif
+
+
 /**
  * Specify which A-law/U-law conversion algorithm to use.
  * By default the conversion algorithm uses A-law/U-law table which gives
@@ -276,6 +306,34 @@
 #endif
 
 
+/**
+ * Enable SIMD implementation of the block A-law/U-law conversion
+ * functions (such as #pjmedia_ulaw_encode_block()), which are used by
+ * the G.711 codec. The implementation is selected at run-time based on
+ * the CPU capabilities, and currently covers x86 with SSSE3. The SIMD
+ * output is identical to the conversion tables.
+ *
+ * Default: 1
+ */
+#ifndef PJMEDIA_HAS_G711_SIMD
+#   define PJMEDIA_HAS_G711_SIMD	    1
+#endif
+
+
+/**
+ * Enable SIMD implementation of the signal level and gain functions
+ * (such as #pjmedia_signal_sum_abs()), which are used by the silence
+ * detector, the echo suppressor and the conference bridge. It is
+ * selected at compile time, and currently covers x86 with SSE2 and ARM
+ * with NEON. The result is identical to the portable implementation.
+ *
+ * Default: 1
+ */
+#ifndef PJMEDIA_HAS_SIGNAL_SIMD
+#   define PJMEDIA_HAS_SIGNAL_SIMD	    1
+#endif
+
+
 /**
  * Unless specified otherwise, G711 codec is included by default.
  */
@@ -341,6 +399,9 @@
 						     using libsamplerate 
 						     (a.k.a Secret Rabbit Code)
 						 */
+#define PJMEDIA_RESAMPLE_POLYPHASE	    5	/**< Built-in fixed-point
+						     polyphase resampler with
+						     SSE2/NEON inner loops. */
 
 /**
  * Select which resample implementation to use. Currently pjmedia supports:
@@ -350,6 +411,10 @@
  *    (a.k.a. Secret Rabbit Code).
  *  - #PJMEDIA_RESAMPLE_SPEEX, to use experimental sample rate conversion in
  *    Speex library.
+ *  - #PJMEDIA_RESAMPLE_POLYPHASE, to use the built-in fixed-point polyphase
+ *    resampler, which needs no third party library. It only supports
+ *    frame sizes which map to a whole number of output samples, which is
+ *    the case for the usual 8/16/32/48 KHz rates and 10 ms multiples.
  *  - #PJMEDIA_RESAMPLE_NONE, to disable sample rate conversion. Any calls to
  *    resample function will return error.
  *
@@ -375,6 +440,49 @@
 #endif
 
 
+/**
+ * Specify whether the WAV cache maps the WAV files into memory with
+ * mmap() instead of reading them into memory buffers. See
+ * #pjmedia_wav_cache_create().
+ *
+ * Default: 1 on platforms which have unistd.h (except Windows), 0 otherwise
+ */
+#ifndef PJMEDIA_WAV_CACHE_USE_MMAP
+#   if defined(PJ_HAS_UNISTD_H) && PJ_HAS_UNISTD_H!=0 && \
+       (!defined(PJ_WIN32) || PJ_WIN32==0)
+#	define PJMEDIA_WAV_CACHE_USE_MMAP	1
+#   else
+#	define PJMEDIA_WAV_CACHE_USE_MMAP	0
+#   endif
+#endif
+
+
+/**
+ * Alignment, in bytes, of the buffers of asynchronous WAV writers. The
+ * buffer size is rounded up to a multiple of this value too, so that the
+ * writes of the WAV writer I/O thread are aligned to the file system
+ * block size. See #pjmedia_wav_writer_port_create_async().
+ *
+ * Default: 4096
+ */
+#ifndef PJMEDIA_WAV_WRITER_IO_ALIGN
+#   define PJMEDIA_WAV_WRITER_IO_ALIGN		4096
+#endif
+
+
+/**
+ * Number of buffers of each asynchronous WAV writer. This determines how
+ * long the disk may stall before the writer has to drop audio: with the
+ * default buffer size and 8KHz 16-bit PCM, each buffer holds 256 ms.
+ * The value must be a power of two.
+ *
+ * Default: 8
+ */
+#ifndef PJMEDIA_WAV_WRITER_IO_BUF_CNT
+#   define PJMEDIA_WAV_WRITER_IO_BUF_CNT	8
+#endif
+
+
 /**
  * Maximum frame duration (in msec) to be supported.
  * This (among other thing) will affect the size of buffers to be allocated
@@ -401,6 +509,53 @@
 #endif
 
 
+/**
+ * Maximum number of media workers of the media endpoint, see
+ * #pjmedia_endpt_create_workers().
+ *
+ * Default: 64
+ */
+#ifndef PJMEDIA_ENDPT_MAX_WORKERS
+#  define PJMEDIA_ENDPT_MAX_WORKERS		64
+#endif
+
+
+/**
+ * Number of buffers in the packet buffer pool of the media endpoint (see
+ * @ref PJMED_PKT_POOL). Each buffer is #PJMEDIA_MAX_MRU bytes. The UDP
+ * media transport receives RTP into these buffers, and the stream's
+ * jitter buffer keeps the received packets in them instead of copying
+ * each frame. Each UDP transport holds one buffer for its pending read,
+ * and a jitter buffer holds one buffer per packet it keeps. When fewer
+ * than #PJMEDIA_PKT_POOL_RESERVE buffers are free, transports receive
+ * into their private buffer and jitter buffers fall back to copying (and
+ * the stream logs it), so the pool should be sized for the number of
+ * transports plus the number of streams times their typical jitter
+ * buffer level.
+ *
+ * Set this to zero to disable the pool.
+ *
+ * Default: 128
+ */
+#ifndef PJMEDIA_PKT_POOL_SIZE
+#  define PJMEDIA_PKT_POOL_SIZE			128
+#endif
+
+
+/**
+ * Number of free buffers the packet buffer pool keeps in reserve. Below
+ * this, UDP transports stop receiving into the pool and the stream's
+ * jitter buffer copies incoming frames instead of keeping references to
+ * the packet buffers, so that streams holding many packets cannot starve
+ * the others.
+ *
+ * Default: 16
+ */
+#ifndef PJMEDIA_PKT_POOL_RESERVE
+#  define PJMEDIA_PKT_POOL_RESERVE		16
+#endif
+
+
 /**
  * DTMF/telephone-event duration, in timestamp.
  */
@@ -965,6 +1120,23 @@
 #endif
 
 
+/**
+ * Use OpenSSL EVP for the AES counter mode cipher and the HMAC-SHA1
+ * authentication of the bundled libsrtp, instead of its portable
+ * table-based implementation. OpenSSL uses the AES-NI instructions when
+ * the CPU supports them, which makes SRTP protect and unprotect several
+ * times faster. This requires linking with libcrypto.
+ *
+ * This setting is read by the libsrtp build (third_party/build/srtp/
+ * srtp_config.h), so it must be set in config_site.h.
+ *
+ * Default: enabled when pjlib is built with OpenSSL (PJ_HAS_SSL_SOCK).
+ */
+#ifndef PJMEDIA_SRTP_HAS_OPENSSL
+#   define PJMEDIA_SRTP_HAS_OPENSSL		    PJ_HAS_SSL_SOCK
+#endif
+
+
 /**
  * Enable support to handle codecs with inconsistent clock rate
  * between clock rate in SDP/RTP & the clock rate that is actually used.
@@ -1178,6 +1350,48 @@
 #   define PJMEDIA_CLOCK_SYNC_MAX_SYNC_MSEC         20000
 #endif
 
+/**
+ * Time slot of the media clock scheduler, in microseconds. The scheduler
+ * threads wake up once every slot, and the clocks which run in the
+ * scheduler are spread across the slots of their interval. See
+ * #pjmedia_clock_sched_create().
+ *
+ * Default: 1000
+ */
+#ifndef PJMEDIA_CLOCK_SCHED_SLOT_USEC
+#   define PJMEDIA_CLOCK_SCHED_SLOT_USEC	    1000
+#endif
+
+
+/**
+ * Number of slots in the timing wheel of each media clock scheduler
+ * thread. Clocks with interval longer than the wheel still work, but the
+ * scheduler has to check them on every turn of the wheel.
+ *
+ * Default: 128
+ */
+#ifndef PJMEDIA_CLOCK_SCHED_WHEEL_SIZE
+#   define PJMEDIA_CLOCK_SCHED_WHEEL_SIZE	    128
+#endif
+
+
+/**
+ * Specify whether the media clock scheduler threads use Linux timerfd to
+ * wake up. A periodic timerfd wakes the thread at each slot boundary
+ * without drift, otherwise the thread sleeps with pj_thread_sleep(),
+ * which has millisecond resolution.
+ *
+ * Default: 1 on Linux, 0 otherwise
+ */
+#ifndef PJMEDIA_CLOCK_SCHED_USE_TIMERFD
+#   if defined(PJ_LINUX) && PJ_LINUX!=0
+#	define PJMEDIA_CLOCK_SCHED_USE_TIMERFD	    1
+#   else
+#	define PJMEDIA_CLOCK_SCHED_USE_TIMERFD	    0
+#   endif
+#endif
+
+
 /**
  * Maximum video frame size.
  * Default: 128kB
@@ -1259,6 +1473,31 @@
 #endif
 
 
+/**
+ * Percentile of the relative frame delay that the percentile jitter
+ * buffer engine (#PJMEDIA_JB_ENGINE_PERCENTILE) sets its target delay
+ * to, i.e. the percentage of frames expected to arrive in time.
+ *
+ * Default: 95
+ */
+#ifndef PJMEDIA_JBUF_PCT_PERCENTILE
+#   define PJMEDIA_JBUF_PCT_PERCENTILE		    95
+#endif
+
+
+/**
+ * Memory of the relative delay histogram of the percentile jitter buffer
+ * engine, in number of frames. Each new frame has a weight of
+ * 1/PJMEDIA_JBUF_PCT_MEMORY in the histogram, so older frames are
+ * gradually forgotten.
+ *
+ * Default: 500
+ */
+#ifndef PJMEDIA_JBUF_PCT_MEMORY
+#   define PJMEDIA_JBUF_PCT_MEMORY		    500
+#endif
+
+
 /**
  * Video stream will discard old picture from the jitter buffer as soon as
  * new picture is received, to reduce latency.
@@ -1270,6 +1509,20 @@
 #endif
 
 
+/**
+ * Maximum number of released picture buffers the video frame pool (see
+ * @ref PJMEDIA_VID_FRAME_POOL) keeps for reuse. The video stream, video
+ * port and video tee pass pictures to each other in buffers of this pool
+ * instead of copying them. Buffers above this number are freed when they
+ * are released.
+ *
+ * Default: 16
+ */
+#ifndef PJMEDIA_VID_FRAME_POOL_MAX_IDLE
+#   define PJMEDIA_VID_FRAME_POOL_MAX_IDLE	16
+#endif
+
+
 /**
  * Maximum video payload size. Note that this must not be greater than
  * PJMEDIA_MAX_MTU.
@@ -1329,6 +1582,35 @@
 #   define PJMEDIA_HAS_LIBYUV				0
 #endif
 
+/**
+ * Number of worker threads of the libyuv converter. When non-zero, large
+ * pictures are converted in horizontal slices, by the worker threads and
+ * the calling thread in parallel, which shortens the time spent by the
+ * video port clock thread on high resolution conversions. Packed (BGRA)
+ * scaling is sliced in bands of destination rows too, while planar (I420)
+ * scaling is split into its three planes.
+ * Set this to zero to do all conversions in the calling thread, e.g: on
+ * servers handling many video streams at once.
+ *
+ * Default: 2
+ */
+#ifndef PJMEDIA_LIBYUV_THREAD_CNT
+#   define PJMEDIA_LIBYUV_THREAD_CNT			2
+#endif
+
+/**
+ * Maximum number of destroyed libyuv converters which are kept for reuse.
+ * Converters are recreated whenever a video port or a video tee changes
+ * format or size, so keeping a few of them saves the setup of their
+ * intermediate buffers. The cached converter is looked up by its source
+ * and destination format and size.
+ *
+ * Default: 8
+ */
+#ifndef PJMEDIA_LIBYUV_CACHE_SIZE
+#   define PJMEDIA_LIBYUV_CACHE_SIZE			8
+#endif
+
 /**
  * @}
  */
@@ -38,6 +38,7 @@
  */
 
 #include <pjmedia/codec.h>
+#include <pjmedia/pkt_pool.h>
 #include <pjmedia/sdp.h>
 #include <pjmedia/transport.h>
 
@@ -131,6 +132,19 @@ PJ_DECL(pj_status_t) pjmedia_endpt_get_flag(pjmedia_endpt *endpt,
 PJ_DECL(pj_ioqueue_t*) pjmedia_endpt_get_ioqueue(pjmedia_endpt *endpt);
 
 
+/**
+ * Get the packet buffer pool of the media endpoint, which media
+ * transports and streams use to pass received packets without copying.
+ * See @ref PJMED_PKT_POOL.
+ *
+ * @param endpt		The media endpoint instance.
+ *
+ * @return		The packet buffer pool, or NULL if it is disabled
+ *			with #PJMEDIA_PKT_POOL_SIZE.
+ */
+PJ_DECL(pjmedia_pkt_pool*) pjmedia_endpt_get_pkt_pool(pjmedia_endpt *endpt);
+
+
 /**
  * Get the number of worker threads on the media endpoint
  *
@@ -160,6 +174,72 @@ PJ_DECL(pj_thread_t*) pjmedia_endpt_get_thread(pjmedia_endpt *endpt,
 PJ_DECL(pj_status_t) pjmedia_endpt_stop_threads(pjmedia_endpt *endpt);
 
 
+/**
+ * Create media workers. A media worker is an ioqueue and a timer heap with
+ * its own polling thread. Media transports created after this call are
+ * each assigned to the least loaded worker (see
+ * #pjmedia_endpt_acquire_worker()), so all network I/O of a stream is
+ * handled by one thread and its state stays in that thread's CPU cache,
+ * instead of being picked up by whichever of the endpoint's worker
+ * threads polls the shared ioqueue first.
+ *
+ * The workers are stopped by #pjmedia_endpt_stop_threads() and destroyed
+ * with the media endpoint, which must be after all media transports
+ * using them have been closed.
+ *
+ * @param endpt		The media endpoint instance.
+ * @param count		Number of media workers, at most
+ *			#PJMEDIA_ENDPT_MAX_WORKERS.
+ * @param pin_cpu	Bind the thread of worker N to CPU N modulo the
+ *			number of CPUs. Failure to bind is only logged.
+ *
+ * @return		PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t) pjmedia_endpt_create_workers(pjmedia_endpt *endpt,
+						  unsigned count,
+						  pj_bool_t pin_cpu);
+
+/**
+ * Get the number of media workers of the media endpoint.
+ *
+ * @param endpt		The media endpoint instance.
+ *
+ * @return		The number of media workers, zero if none was
+ *			created.
+ */
+PJ_DECL(unsigned) pjmedia_endpt_get_worker_count(pjmedia_endpt *endpt);
+
+/**
+ * Assign the least loaded media worker to the caller, typically a media
+ * transport, which should then register its sockets to the worker's
+ * ioqueue. The assignment must be released with
+ * #pjmedia_endpt_release_worker().
+ *
+ * @param endpt		The media endpoint instance.
+ * @param p_index	Pointer to receive the worker index.
+ * @param p_ioqueue	Optional pointer to receive the worker ioqueue.
+ * @param p_timer_heap	Optional pointer to receive the worker timer heap.
+ *
+ * @return		PJ_SUCCESS on success, or PJ_ENOTFOUND if the
+ *			media endpoint has no media workers, in which case
+ *			the endpoint's ioqueue should be used.
+ */
+PJ_DECL(pj_status_t) pjmedia_endpt_acquire_worker(pjmedia_endpt *endpt,
+						  unsigned *p_index,
+						  pj_ioqueue_t **p_ioqueue,
+						  pj_timer_heap_t **p_timer_heap);
+
+/**
+ * Release a media worker assignment made by
+ * #pjmedia_endpt_acquire_worker().
+ *
+ * @param endpt		The media endpoint instance.
+ * @param index		The worker index.
+ */
+PJ_DECL(void) pjmedia_endpt_release_worker(pjmedia_endpt *endpt,
+					   unsigned index);
+
+
 /**
  * Request the media endpoint to create pool.
  *
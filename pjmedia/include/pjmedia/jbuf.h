@@ -28,6 +28,7 @@
  * @file jbuf.h
  * @brief Adaptive jitter buffer implementation.
  */
+#include <pjmedia/pkt_pool.h>
 #include <pjmedia/types.h>
 
 /**
@@ -93,6 +94,36 @@ typedef enum pjmedia_jb_discard_algo
 } pjmedia_jb_discard_algo;
 
 
+/**
+ * Enumeration of jitter buffer delay estimation engines. The engine
+ * decides how much delay the jitter buffer should apply to absorb the
+ * network jitter.
+ */
+typedef enum pjmedia_jb_engine
+{
+    /**
+     * Estimate the delay from the burst level of PUT and GET operations,
+     * and reduce excess delay with the configured discard algorithm (see
+     * #pjmedia_jb_discard_algo). This is the default engine.
+     */
+    PJMEDIA_JB_ENGINE_BURST	   = 0,
+
+    /**
+     * Track the delay of incoming frames, relative to the fastest recent
+     * frame, in a histogram with exponential forgetting, and set the
+     * target delay to the #PJMEDIA_JBUF_PCT_PERCENTILE percentile of it.
+     * The caller is expected to time-stretch the playout towards the
+     * target, as suggested by #pjmedia_jbuf_get_playout_adj(), and report
+     * it with #pjmedia_jbuf_set_playout_stretch(); the audio stream does
+     * this with WSOLA. Instead of the discard algorithm, frames are only
+     * discarded as a safety net, when the average delay stays above twice
+     * the target. Setting #PJMEDIA_JB_DISCARD_NONE disables this too.
+     */
+    PJMEDIA_JB_ENGINE_PERCENTILE   = 1
+
+} pjmedia_jb_engine;
+
+
 /**
  * This structure describes jitter buffer state.
  */
@@ -104,7 +135,9 @@ typedef struct pjmedia_jb_state
     unsigned	max_prefetch;	    /**< Maximum allowed prefetch, in frms. */
 
     /* Status */
-    unsigned	burst;		    /**< Current burst level, in frames	    */
+    unsigned	burst;		    /**< Current burst level, in frames. For
+					 the percentile engine, this is the
+					 target delay, in frames.	    */
     unsigned	prefetch;	    /**< Current prefetch value, in frames  */
     unsigned	size;		    /**< Current buffer size, in frames.    */
 
@@ -216,6 +249,53 @@ PJ_DECL(pj_status_t) pjmedia_jbuf_set_discard(pjmedia_jbuf *jb,
 					      pjmedia_jb_discard_algo algo);
 
 
+/**
+ * Set the jitter buffer delay estimation engine. The default engine, set
+ * in jitter buffer creation, is PJMEDIA_JB_ENGINE_BURST. The jitter
+ * buffer is reset.
+ *
+ * @param jb		The jitter buffer.
+ * @param engine	The engine to be used.
+ *
+ * @return		PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t) pjmedia_jbuf_set_engine(pjmedia_jbuf *jb,
+					     pjmedia_jb_engine engine);
+
+
+/**
+ * Get the playout adjustment suggested by the percentile engine, i.e. the
+ * difference between the average playout delay and the target delay. A
+ * positive value means the playout should be compressed (frames retrieved
+ * faster than real-time), a negative value means the playout should be
+ * expanded. The engine applies some hysteresis, so a non-zero value is only
+ * returned when the difference exceeds one and a half frames.
+ *
+ * @param jb		The jitter buffer.
+ *
+ * @return		The adjustment in whole frames, rounded towards zero,
+ *			so it is at least one frame when non-zero. Zero when
+ *			no adjustment is needed or the engine is not the
+ *			percentile one.
+ */
+PJ_DECL(int) pjmedia_jbuf_get_playout_adj(const pjmedia_jbuf *jb);
+
+
+/**
+ * Report playout time-stretching to the percentile engine. The engine
+ * measures time in GET operations, which no longer matches the playout
+ * time once the caller gets extra frames to compress the playout, or
+ * skips getting frames to expand it.
+ *
+ * @param jb		The jitter buffer.
+ * @param stretch	The playout time added (positive, when expanding) or
+ *			removed (negative, when compressing), in 1/256 of
+ *			a frame.
+ */
+PJ_DECL(void) pjmedia_jbuf_set_playout_stretch(pjmedia_jbuf *jb,
+					       int stretch);
+
+
 /**
  * Destroy jitter buffer instance.
  *
@@ -306,6 +386,33 @@ PJ_DECL(void) pjmedia_jbuf_put_frame3( pjmedia_jbuf *jb,
 				       int frame_seq,
 				       pj_uint32_t frame_ts,
 				       pj_bool_t *discarded);
+
+/**
+ * Put a frame which lies in a packet buffer of the packet buffer pool
+ * (see @ref PJMED_PKT_POOL) to the jitter buffer. Instead of copying the
+ * frame, the jitter buffer keeps a reference to the packet buffer until
+ * the frame is retrieved or removed. If the frame is not inside the
+ * packet buffer, or \a pkt is NULL, the frame is copied as with
+ * #pjmedia_jbuf_put_frame3().
+ *
+ * @param jb		The jitter buffer.
+ * @param pkt		The packet buffer containing the frame, or NULL.
+ * @param frame		Pointer to the frame in the packet buffer.
+ * @param size		The frame size.
+ * @param bit_info	Bit precise info of the frame.
+ * @param frame_seq	The frame sequence number.
+ * @param frame_ts	The frame timestamp.
+ * @param discarded	Flag whether the frame is discarded by jitter buffer.
+ */
+PJ_DECL(void) pjmedia_jbuf_put_pkt( pjmedia_jbuf *jb,
+				    pjmedia_pkt_buf *pkt,
+				    const void *frame,
+				    pj_size_t size,
+				    pj_uint32_t bit_info,
+				    int frame_seq,
+				    pj_uint32_t frame_ts,
+				    pj_bool_t *discarded);
+
 /**
  * Get a frame from the jitter buffer. The jitter buffer will return the
  * oldest frame from it's buffer, when it is available.
@@ -381,6 +488,33 @@ PJ_DECL(void) pjmedia_jbuf_get_frame3(pjmedia_jbuf *jb,
 				      int *seq);
 
 
+/**
+ * Get a frame from the jitter buffer without copying it. This works like
+ * #pjmedia_jbuf_get_frame3(), except that a pointer to the frame inside
+ * the jitter buffer (or inside the packet buffer it references) is
+ * returned. The frame stays valid until the next operation on the jitter
+ * buffer, so the application must keep its jitter buffer lock while
+ * using the frame.
+ *
+ * @param jb		The jitter buffer.
+ * @param frame		Pointer to receive the frame, or NULL when the
+ *			frame type is not PJMEDIA_JB_NORMAL_FRAME.
+ * @param size		Pointer to receive frame size.
+ * @param p_frm_type	Pointer to receive frame type.
+ *			@see pjmedia_jbuf_get_frame().
+ * @param bit_info	Bit precise info of the frame.
+ * @param ts		Frame timestamp.
+ * @param seq		Frame sequence number.
+ */
+PJ_DECL(void) pjmedia_jbuf_get_frame_ptr(pjmedia_jbuf *jb,
+					 const void **frame,
+					 pj_size_t *size,
+					 char *p_frm_type,
+					 pj_uint32_t *bit_info,
+					 pj_uint32_t *ts,
+					 int *seq);
+
+
 /**
  * Peek a frame from the jitter buffer. The jitter buffer state will not be
  * modified.
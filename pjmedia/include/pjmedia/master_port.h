@@ -25,6 +25,7 @@
  * @file master_port.h
  * @brief Master port.
  */
+#include <pjmedia/clock.h>
 #include <pjmedia/port.h>
 
 /**
@@ -173,6 +174,23 @@ PJ_DECL(pj_status_t) pjmedia_master_port_set_dport(pjmedia_master_port *m,
 PJ_DECL(pjmedia_port*) pjmedia_master_port_get_dport(pjmedia_master_port*m);
 
 
+/**
+ * Let the master port's clock be driven by a clock scheduler instead of
+ * its own thread, see #pjmedia_clock_sched_create(). This is useful when
+ * the application runs many master ports at the same time. The master
+ * port must be stopped when this function is called.
+ *
+ * @param m		The master port.
+ * @param sched		The clock scheduler, or NULL to make the master
+ *			port use its own clock thread again.
+ *
+ * @return		PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t) pjmedia_master_port_set_clock_sched(
+					    pjmedia_master_port *m,
+					    pjmedia_clock_sched *sched);
+
+
 /**
  * Destroy the master port, and optionally destroy the upstream and 
  * downstream ports.
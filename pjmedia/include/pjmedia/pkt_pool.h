@@ -0,0 +1,177 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2011 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef __PJMEDIA_PKT_POOL_H__
+#define __PJMEDIA_PKT_POOL_H__
+
+/**
+ * @file pkt_pool.h
+ * @brief Reference counted packet buffer pool.
+ */
+#include <pjmedia/types.h>
+
+
+/**
+ * @defgroup PJMED_PKT_POOL Packet Buffer Pool
+ * @ingroup PJMEDIA_FRAME_OP
+ * @brief Share received packets between media layers without copying.
+ * @{
+ *
+ * The packet buffer pool is a set of fixed size, reference counted
+ * buffers. A layer which keeps a received packet (for example the
+ * stream's jitter buffer) adds a reference to its buffer instead of
+ * copying the payload, and the buffer goes back to the pool when the last
+ * reference is released.
+ *
+ * A layer that is given a bare packet pointer can find out whether the
+ * packet lives in the pool with #pjmedia_pkt_pool_find(). The UDP media
+ * transport receives packets directly into pool buffers, one buffer per
+ * transport. For other transports (or when the pool is low), the stream
+ * moves a packet to a pool buffer only when its jitter buffer keeps it.
+ *
+ * The media endpoint owns a pool which size is configured with
+ * #PJMEDIA_PKT_POOL_SIZE, see #pjmedia_endpt_get_pkt_pool().
+ */
+
+
+PJ_BEGIN_DECL
+
+
+/**
+ * Opaque declaration of packet buffer pool.
+ */
+typedef struct pjmedia_pkt_pool pjmedia_pkt_pool;
+
+
+/**
+ * A packet buffer of the pool.
+ */
+typedef struct pjmedia_pkt_buf
+{
+    /** The pool owning this buffer. */
+    pjmedia_pkt_pool	    *pool;
+
+    /** The buffer. */
+    void		    *buf;
+
+    /** Size of the buffer, in bytes. */
+    unsigned		     size;
+
+    /** Reference counter, internal, protected by the pool lock. */
+    unsigned		     ref_cnt;
+
+    /** Next free buffer, internal. */
+    struct pjmedia_pkt_buf  *next;
+
+} pjmedia_pkt_buf;
+
+
+/**
+ * Create a packet buffer pool. All buffers are allocated up front from
+ * the specified memory pool.
+ *
+ * @param pool		Pool to allocate the buffers and the pool lock.
+ * @param name		Name of the pool, for logging purpose. May be NULL.
+ * @param buf_size	Size of each buffer, in bytes.
+ * @param count		Number of buffers.
+ * @param p_pkt_pool	Pointer to receive the packet buffer pool.
+ *
+ * @return		PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t) pjmedia_pkt_pool_create(pj_pool_t *pool,
+					     const char *name,
+					     unsigned buf_size,
+					     unsigned count,
+					     pjmedia_pkt_pool **p_pkt_pool);
+
+
+/**
+ * Destroy the packet buffer pool. Buffers must not be used after the pool
+ * is destroyed.
+ *
+ * @param pkt_pool	The packet buffer pool.
+ *
+ * @return		PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t) pjmedia_pkt_pool_destroy(pjmedia_pkt_pool *pkt_pool);
+
+
+/**
+ * Take a buffer from the pool. The buffer is returned with one reference,
+ * owned by the caller.
+ *
+ * @param pkt_pool	The packet buffer pool.
+ *
+ * @return		The buffer, or NULL if all buffers are in use.
+ */
+PJ_DECL(pjmedia_pkt_buf*) pjmedia_pkt_pool_alloc(pjmedia_pkt_pool *pkt_pool);
+
+
+/**
+ * Find the pool buffer which contains the specified memory location. The
+ * reference counter of the buffer is not changed, so the caller must
+ * already be sure that the buffer is alive, e.g. because it is processing
+ * a packet received into the buffer.
+ *
+ * @param pkt_pool	The packet buffer pool.
+ * @param ptr		Pointer to any byte of a packet.
+ *
+ * @return		The buffer, or NULL if the location is not in the
+ *			pool.
+ */
+PJ_DECL(pjmedia_pkt_buf*) pjmedia_pkt_pool_find(pjmedia_pkt_pool *pkt_pool,
+						const void *ptr);
+
+
+/**
+ * Get the number of buffers which are currently not in use. The value is
+ * read without locking, so it is only a hint.
+ *
+ * @param pkt_pool	The packet buffer pool.
+ *
+ * @return		Number of free buffers.
+ */
+PJ_DECL(unsigned) pjmedia_pkt_pool_get_free_cnt(pjmedia_pkt_pool *pkt_pool);
+
+
+/**
+ * Add a reference to the buffer.
+ *
+ * @param pkt		The buffer.
+ */
+PJ_DECL(void) pjmedia_pkt_buf_add_ref(pjmedia_pkt_buf *pkt);
+
+
+/**
+ * Release a reference to the buffer. The buffer is returned to its pool
+ * when the last reference is released.
+ *
+ * @param pkt		The buffer.
+ */
+PJ_DECL(void) pjmedia_pkt_buf_dec_ref(pjmedia_pkt_buf *pkt);
+
+
+PJ_END_DECL
+
+/**
+ * @}
+ */
+
+
+#endif	/* __PJMEDIA_PKT_POOL_H__ */
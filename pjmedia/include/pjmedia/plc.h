@@ -103,6 +103,38 @@ PJ_DECL(pj_status_t) pjmedia_plc_generate( pjmedia_plc *plc,
 					   pj_int16_t *frame );
 
 
+/**
+ * Turn a replacement for a lost frame into an interpolation between the
+ * surrounding frames, when the frame following the lost one is already
+ * available (for example, it is already in the jitter buffer). The start
+ * of the next frame is extended backwards by whole pitch periods, and the
+ * replacement frame is crossfaded from its extrapolated content at the
+ * beginning into this extension at the end, so that playback continues
+ * into the next frame without discontinuity.
+ *
+ * The replacement frame may come from #pjmedia_plc_generate() or from
+ * the codec's own PLC. In both cases the next frame must be given exactly
+ * as it will be played, i.e: after #pjmedia_plc_save() when the PLC
+ * session is used.
+ *
+ * @param clock_rate	    Media sampling rate.
+ * @param frame		    The replacement frame, which will be modified.
+ * @param next		    The frame following the lost frame.
+ * @param count		    Number of samples in each frame. Only mono
+ *			    frames are supported.
+ *
+ * @return		    PJ_SUCCESS on success, or PJ_ETOOBIG when the
+ *			    frames are longer than 960 samples, or
+ *			    PJ_ETOOSMALL when they are too short to find
+ *			    a pitch period. The frame is not modified on
+ *			    error.
+ */
+PJ_DECL(pj_status_t) pjmedia_plc_interpolate( unsigned clock_rate,
+					      pj_int16_t frame[],
+					      const pj_int16_t next[],
+					      unsigned count);
+
+
 
 
 PJ_END_DECL
@@ -0,0 +1,177 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2011 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef __PJMEDIA_RING_PORT_H__
+#define __PJMEDIA_RING_PORT_H__
+
+/**
+ * @file ring_port.h
+ * @brief Lock-free single producer/single consumer audio ring port.
+ */
+#include <pjmedia/port.h>
+
+
+/**
+ * @defgroup PJMEDIA_RING_PORT Lock-free Ring Port
+ * @ingroup PJMEDIA_PORT
+ * @brief Pass audio frames between two clock domains without locking.
+ * @{
+ *
+ * The ring port is a media port which carries audio frames from one
+ * thread to another. Frames written with #pjmedia_port_put_frame() by
+ * one thread (the producer) are returned by #pjmedia_port_get_frame()
+ * called by another thread (the consumer). Exactly one thread may put
+ * frames and exactly one thread may get frames at any time; with this
+ * restriction, neither side ever takes a lock or blocks, which makes the
+ * port suitable for use inside sound device callbacks.
+ *
+ * When the producer and consumer run from different clocks (for example
+ * a sound device and a #pjmedia_clock), the number of frames in the ring
+ * will slowly drift. Unless #PJMEDIA_RING_PORT_NO_DRIFT_COMP is specified,
+ * the consumer compensates for this drift using WSOLA (see @ref
+ * PJMED_WSOLA): it shrinks the audio when the ring has stayed above its
+ * target level for a while, and synthesizes audio when the ring runs
+ * empty. The producer side never touches the WSOLA state. When the ring
+ * is full, frames put by the producer are dropped.
+ */
+
+
+PJ_BEGIN_DECL
+
+
+/**
+ * Ring port options.
+ */
+typedef enum pjmedia_ring_port_option
+{
+    /**
+     * Disable drift compensation. With this option, the consumer gets
+     * silence when the ring is empty and the ring level is not adjusted,
+     * other than by dropping frames when it is full.
+     */
+    PJMEDIA_RING_PORT_NO_DRIFT_COMP = 1
+
+} pjmedia_ring_port_option;
+
+
+/**
+ * Ring port statistics. The counters are updated by the producer and
+ * consumer threads without locking, so a snapshot read from another
+ * thread may be slightly out of date.
+ */
+typedef struct pjmedia_ring_port_stat
+{
+    /** Current number of frames in the ring. */
+    unsigned	level;
+
+    /** Number of frames put to the ring. */
+    unsigned	put_cnt;
+
+    /** Number of frames got from the ring. */
+    unsigned	get_cnt;
+
+    /** Number of frames dropped by the producer because the ring was
+     *  full. */
+    unsigned	overflow_cnt;
+
+    /** Number of times the consumer found the ring empty. */
+    unsigned	underflow_cnt;
+
+    /** Number of samples removed by drift compensation. */
+    unsigned	shrink_samples;
+
+    /** Number of frames synthesized by drift compensation. */
+    unsigned	expand_frames;
+
+} pjmedia_ring_port_stat;
+
+
+/**
+ * Create a ring port. The port only accepts 16 bit linear PCM frames
+ * with the specified frame size.
+ *
+ * @param pool			Pool to allocate memory.
+ * @param name			Optional name for the port.
+ * @param clock_rate		Sampling rate of the port.
+ * @param channel_count		Number of channels.
+ * @param samples_per_frame	Number of samples per frame.
+ * @param bits_per_sample	Number of bits per sample, must be 16.
+ * @param max_frames		Capacity of the ring, in frames. The ring
+ *				tries to keep about half of this number of
+ *				frames buffered, so this also determines
+ *				the latency added by the port.
+ * @param options		Bitmask of #pjmedia_ring_port_option.
+ * @param p_port		Pointer to receive the port instance.
+ *
+ * @return			PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t) pjmedia_ring_port_create(pj_pool_t *pool,
+					      const char *name,
+					      unsigned clock_rate,
+					      unsigned channel_count,
+					      unsigned samples_per_frame,
+					      unsigned bits_per_sample,
+					      unsigned max_frames,
+					      unsigned options,
+					      pjmedia_port **p_port);
+
+
+/**
+ * Get the number of frames currently in the ring. This may be called
+ * from any thread.
+ *
+ * @param port			The ring port.
+ *
+ * @return			Number of frames in the ring.
+ */
+PJ_DECL(unsigned) pjmedia_ring_port_get_level(pjmedia_port *port);
+
+
+/**
+ * Get the ring port statistics.
+ *
+ * @param port			The ring port.
+ * @param stat			Structure to receive the statistics.
+ *
+ * @return			PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t) pjmedia_ring_port_get_stat(pjmedia_port *port,
+					        pjmedia_ring_port_stat *stat);
+
+
+/**
+ * Discard all frames in the ring. This must only be called by the
+ * consumer thread, or when neither side is active.
+ *
+ * @param port			The ring port.
+ *
+ * @return			PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t) pjmedia_ring_port_reset(pjmedia_port *port);
+
+
+
+PJ_END_DECL
+
+/**
+ * @}
+ */
+
+
+#endif	/* __PJMEDIA_RING_PORT_H__ */
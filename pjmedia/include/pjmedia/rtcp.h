@@ -206,6 +206,20 @@ typedef struct pjmedia_rtcp_stat
     pj_uint32_t		     rtp_tx_last_ts; /**< Last TX RTP timestamp.    */
     pj_uint16_t		     rtp_tx_last_seq;/**< Last TX RTP sequence.	    */
 
+    /**
+     * Packet loss concealment statistics of the decoding direction. These
+     * are updated by the stream, not by the RTCP session.
+     */
+    struct {
+	pj_uint32_t	     frames; /**< Total number of concealed frames.  */
+	pj_uint32_t	     interp; /**< Number of concealed frames that
+					  were interpolated with the next
+					  frame from the jitter buffer.	    */
+	pj_uint32_t	     events; /**< Number of concealment events, i.e:
+					  runs of consecutive concealed
+					  frames.			    */
+    } rx_plc;
+
 #if defined(PJMEDIA_RTCP_STAT_HAS_IPDV) && PJMEDIA_RTCP_STAT_HAS_IPDV!=0
     pj_math_stat	     rx_ipdv;/**< Statistics of IP packet delay
 				          variation in receiving direction
@@ -0,0 +1,116 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2011 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef __PJMEDIA_SIGNAL_OPS_H__
+#define __PJMEDIA_SIGNAL_OPS_H__
+
+
+/**
+ * @file signal_ops.h
+ * @brief Signal level and gain operations on PCM blocks.
+ */
+#include <pjmedia/types.h>
+
+
+/**
+ * @defgroup PJMEDIA_SIGNAL_OPS Signal Level and Gain
+ * @ingroup PJMEDIA_FRAME_OP
+ * @brief Block operations to measure the level and apply gain to PCM samples
+ * @{
+ *
+ * These functions implement the per-sample loops of the silence detector,
+ * the echo suppressor and the conference bridge level adjustment. They use
+ * SIMD instructions when they are available (see #PJMEDIA_HAS_SIGNAL_SIMD),
+ * and always produce the same result as the portable implementation.
+ */
+
+
+PJ_BEGIN_DECL
+
+
+/**
+ * Unity gain for #pjmedia_signal_apply_gain(). The gain is a fixed point
+ * value with 12 fractional bits.
+ */
+#define PJMEDIA_SIGNAL_GAIN_UNITY	4096
+
+
+/**
+ * Calculate the sum of the absolute values of the samples. The sum is
+ * calculated modulo 2^32, which does not overflow for blocks shorter than
+ * 131072 samples.
+ *
+ * @param samples	Pointer to 16-bit PCM samples.
+ * @param count		Number of samples.
+ *
+ * @return		The sum of the absolute sample values.
+ */
+PJ_DECL(pj_uint32_t) pjmedia_signal_sum_abs(const pj_int16_t samples[],
+					    pj_size_t count);
+
+
+/**
+ * Multiply the samples by the gain, in place, and clip the result to the
+ * 16-bit range. Each sample becomes (sample * gain) >> 12.
+ *
+ * @param samples	Pointer to 16-bit PCM samples.
+ * @param count		Number of samples.
+ * @param gain		The gain, where #PJMEDIA_SIGNAL_GAIN_UNITY
+ *			leaves the signal unchanged.
+ *
+ * @return		The sum of the absolute values of the resulting
+ *			samples, as #pjmedia_signal_sum_abs() would
+ *			calculate it.
+ */
+PJ_DECL(pj_uint32_t) pjmedia_signal_apply_gain(pj_int16_t samples[],
+					       pj_size_t count,
+					       unsigned gain);
+
+
+/**
+ * Multiply 32-bit samples, such as the sum of several mixed signals, by
+ * the gain and store them as clipped 16-bit samples. This is the same
+ * as #pjmedia_signal_apply_gain(), except for the source format.
+ *
+ * @param dst		Destination 16-bit PCM buffer. It may point to the
+ *			start of the source buffer, to convert the samples
+ *			in place.
+ * @param src		Source 32-bit samples. The magnitude of the values
+ *			must be less than 2^27.
+ * @param count		Number of samples.
+ * @param gain		The gain, where #PJMEDIA_SIGNAL_GAIN_UNITY
+ *			leaves the signal unchanged.
+ *
+ * @return		The sum of the absolute values of the resulting
+ *			16-bit samples.
+ */
+PJ_DECL(pj_uint32_t) pjmedia_signal_apply_gain32(pj_int16_t dst[],
+						 const pj_int32_t src[],
+						 pj_size_t count,
+						 unsigned gain);
+
+
+PJ_END_DECL
+
+/**
+ * @}
+ */
+
+
+#endif	/* __PJMEDIA_SIGNAL_OPS_H__ */
@@ -71,7 +71,21 @@ enum pjmedia_snd_port_option
     /** 
      * Don't start the audio device when creating a sound port.
      */    
-    PJMEDIA_SND_PORT_NO_AUTO_START = 1
+    PJMEDIA_SND_PORT_NO_AUTO_START = 1,
+
+    /**
+     * Decouple the sound device from the downstream port. With this
+     * option, the sound device callbacks only exchange frames with
+     * lock-free rings (see @ref PJMEDIA_RING_PORT), and a separate
+     * #pjmedia_clock thread calls the downstream port's
+     * <tt>get_frame()</tt> and <tt>put_frame()</tt> and runs the software
+     * echo canceller. This keeps mutexes and lengthy processing out of
+     * the sound device thread, at the cost of additional latency (see
+     * PJMEDIA_SND_PORT_RING_FRAMES). Clock drift between the sound device
+     * and the media clock is compensated by the rings. The option is
+     * ignored when the sound device uses a non-PCM format.
+     */
+    PJMEDIA_SND_PORT_DECOUPLED = 2
 };
 
 /**
@@ -129,6 +129,10 @@ typedef struct pjmedia_stream_info
     int			jb_max_pre; /**< Jitter buffer maximum prefetch
 					 delay in msec (-1 for default).    */
     int			jb_max;	    /**< Jitter buffer max delay in msec.   */
+    pjmedia_jb_engine	jb_engine;  /**< Jitter buffer delay estimation
+					 engine. With the percentile engine,
+					 the stream time-stretches the
+					 playout of linear PCM ports.	    */
 
 #if defined(PJMEDIA_STREAM_ENABLE_KA) && PJMEDIA_STREAM_ENABLE_KA!=0
     pj_bool_t		use_ka;	    /**< Stream keep-alive and NAT hole punch
@@ -429,6 +433,42 @@ pjmedia_stream_send_rtcp_sdes( pjmedia_stream *stream );
 PJ_DECL(pj_status_t)
 pjmedia_stream_send_rtcp_bye( pjmedia_stream *stream );
 
+/**
+ * Forward RTP packets received by a stream directly to another stream
+ * (media relay), without decoding and re-encoding them. Each relayed
+ * packet is sent through the peer's transport with its SSRC, sequence
+ * number and timestamp rewritten to continue the peer's outgoing RTP
+ * session, and its payload type mapped to the peer's. RFC 2833 events
+ * are relayed when the peer has a telephone-event payload type, and are
+ * still reported to the DTMF callback of the receiving stream.
+ *
+ * While relaying, the jitter buffer and codec of the receiving stream
+ * are bypassed and its port returns no frames, and frames given to the
+ * peer's port are ignored. Each stream keeps sending its own RTCP
+ * reports, translated for the relay: the SR of the peer follows the
+ * relayed RTP timestamps, and the report block sent by the receiving
+ * stream also includes the loss and jitter reported by the peer's remote.
+ *
+ * The relay is unidirectional; call this function for both streams to
+ * relay in both directions. A stream can be fed by one relay only.
+ * Destroying either stream stops the relay.
+ *
+ * @param stream	The media stream receiving the RTP packets. The
+ *			stream must have decoding direction.
+ * @param peer		The media stream to send the packets, which must
+ *			have encoding direction and use the same codec
+ *			as \a stream, with the same format parameters
+ *			(fmtp) as the decoder of \a stream. Specify NULL
+ *			to stop relaying.
+ *
+ * @return		PJ_SUCCESS on success, PJMEDIA_ENOTCOMPATIBLE
+ *			if the streams use different codecs or codec
+ *			format parameters, or PJ_EBUSY if the peer is
+ *			already fed by the relay of another stream.
+ */
+PJ_DECL(pj_status_t) pjmedia_stream_set_relay( pjmedia_stream *stream,
+					       pjmedia_stream *peer );
+
 /**
  * @}
  */
@@ -297,6 +297,92 @@ PJ_DECL(pj_status_t) pjmedia_transport_srtp_decrypt_pkt(pjmedia_transport *tp,
 							int *pkt_len);
 
 
+/**
+ * Maximum number of bytes added to a packet by SRTP protection, i.e. the
+ * authentication tag, and for SRTCP, the SRTCP index.
+ */
+#define PJMEDIA_SRTP_MAX_TRAILER_LEN	16
+
+
+/**
+ * This structure describes a packet to be protected or unprotected by
+ * #pjmedia_transport_srtp_protect_pkts() and
+ * #pjmedia_transport_srtp_unprotect_pkts().
+ */
+typedef struct pjmedia_srtp_pkt
+{
+    /**
+     * The SRTP transport whose session protects or unprotects the packet.
+     */
+    pjmedia_transport	*tp;
+
+    /**
+     * Non-zero if the packet is RTP, or zero if it is RTCP.
+     */
+    pj_bool_t		 is_rtp;
+
+    /**
+     * The packet buffer, which must be 32bit aligned. The packet is
+     * protected or unprotected in place, so for protection the buffer
+     * must have room for #PJMEDIA_SRTP_MAX_TRAILER_LEN more bytes.
+     */
+    void		*pkt;
+
+    /**
+     * On input, the packet length. On output, the length of the protected
+     * or unprotected packet.
+     */
+    int			 pkt_len;
+
+    /**
+     * On output, the result of the operation for this packet.
+     */
+    pj_status_t		 status;
+
+} pjmedia_srtp_pkt;
+
+
+/**
+ * Protect a vector of RTP and RTCP packets in place, for example to send
+ * them with one batched socket operation. The packets may belong to
+ * different SRTP transports. The transport lock is taken once for each
+ * run of consecutive packets of the same transport, so application should
+ * keep the packets of a transport together. Packets of one transport are
+ * protected in the order given.
+ *
+ * Packets of a transport whose SRTP is bypassed are left unchanged.
+ *
+ * @param pkts		The packets. The result of each packet is returned
+ *			in its \a pkt_len and \a status fields.
+ * @param count		Number of packets.
+ *
+ * @return		PJ_SUCCESS if all packets are protected, or the
+ *			status of the first packet that failed.
+ */
+PJ_DECL(pj_status_t) pjmedia_transport_srtp_protect_pkts(
+					    pjmedia_srtp_pkt pkts[],
+					    unsigned count);
+
+
+/**
+ * Unprotect a vector of received SRTP and SRTCP packets in place. This is
+ * the receive counterpart of #pjmedia_transport_srtp_protect_pkts(), with
+ * the same rules on the order of the packets. Unlike packets received by
+ * the transport, the unprotected packets are not passed to the attached
+ * stream, application handles them itself.
+ *
+ * @param pkts		The packets. The result of each packet is returned
+ *			in its \a pkt_len and \a status fields.
+ * @param count		Number of packets.
+ *
+ * @return		PJ_SUCCESS if all packets are unprotected, or the
+ *			status of the first packet that failed.
+ */
+PJ_DECL(pj_status_t) pjmedia_transport_srtp_unprotect_pkts(
+					    pjmedia_srtp_pkt pkts[],
+					    unsigned count);
+
+
 /**
  * Query member transport of SRTP.
  *
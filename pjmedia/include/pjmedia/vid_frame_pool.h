@@ -0,0 +1,274 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2010-2011 Teluu Inc. (http://www.teluu.com)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef __PJMEDIA_VID_FRAME_POOL_H__
+#define __PJMEDIA_VID_FRAME_POOL_H__
+
+/**
+ * @file vid_frame_pool.h
+ * @brief Reference counted video frame buffer pool.
+ */
+#include <pjmedia/frame.h>
+#include <pj/pool.h>
+
+
+/**
+ * @defgroup PJMEDIA_VID_FRAME_POOL Video Frame Buffer Pool
+ * @ingroup PJMEDIA_FRAME_OP
+ * @brief Pass video pictures between media components by reference
+ * @{
+ *
+ * The video frame pool hands out reference counted picture buffers, so
+ * that the video stream, the video port and the video tee can pass
+ * decoded and captured pictures to each other without copying them. A
+ * component only copies (or converts) a picture when it needs it in a
+ * different format.
+ *
+ * The rules for a component which takes a picture buffer from the pool
+ * are:
+ *  - the buffer may be given to other components, which keep it by
+ *    adding a reference (see #pjmedia_vid_frame_pool_share()),
+ *  - a buffer with more than one reference is read only. Before writing
+ *    a new picture, the owner calls #pjmedia_vid_frame_pool_make_writable(),
+ *    which replaces a shared buffer with a new one,
+ *  - the buffer of a frame given to a \a get_frame() call may be
+ *    exchanged for another pool buffer of at least the same size (see
+ *    #pjmedia_vid_frame_pool_exchange()), so the owner must not keep the
+ *    buffer address anywhere else than in its #pjmedia_frame.
+ *
+ * Buffers which do not come from the pool are handled as before, i.e.
+ * they are copied. All functions accept NULL as the pool, to use the
+ * singleton instance, and simply fall back to copying when there is no
+ * pool.
+ */
+
+
+PJ_BEGIN_DECL
+
+
+/**
+ * Opaque declaration of video frame pool.
+ */
+typedef struct pjmedia_vid_frame_pool pjmedia_vid_frame_pool;
+
+
+/**
+ * A picture buffer of the pool.
+ */
+typedef struct pjmedia_vid_frame_buf
+{
+    /** The pool owning this buffer. */
+    pjmedia_vid_frame_pool	 *pool;
+
+    /** The buffer. */
+    void			 *buf;
+
+    /** Size of the buffer, in bytes. */
+    pj_size_t			  size;
+
+    /** Reference counter, internal, protected by the pool lock. */
+    unsigned			  ref_cnt;
+
+    /** Next idle buffer, internal. */
+    struct pjmedia_vid_frame_buf *next;
+
+} pjmedia_vid_frame_buf;
+
+
+/**
+ * Create a video frame pool. Buffers are allocated on demand, each from
+ * its own memory pool, so that the memory of a released buffer can be
+ * given back when it is not needed anymore. This will also set the
+ * pointer to the singleton instance if the value is still NULL.
+ *
+ * @param pf		Pool factory to allocate the memory from.
+ * @param name		Name of the pool, for logging purpose. May be NULL.
+ * @param max_idle	Maximum number of released buffers to keep for
+ *			reuse, see #PJMEDIA_VID_FRAME_POOL_MAX_IDLE.
+ * @param p_fp		Pointer to receive the video frame pool. May be
+ *			NULL.
+ *
+ * @return		PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t) pjmedia_vid_frame_pool_create(pj_pool_factory *pf,
+						   const char *name,
+						   unsigned max_idle,
+						   pjmedia_vid_frame_pool **p_fp);
+
+
+/**
+ * Get the singleton instance of the video frame pool.
+ *
+ * @return		The instance, or NULL if no pool has been created.
+ */
+PJ_DECL(pjmedia_vid_frame_pool*) pjmedia_vid_frame_pool_instance(void);
+
+
+/**
+ * Manually assign a specific video frame pool as the singleton instance.
+ *
+ * @param fp		The pool to be used as the singleton instance.
+ *			Application may specify NULL to clear the singleton
+ *			instance, which disables the zero copy paths.
+ */
+PJ_DECL(void) pjmedia_vid_frame_pool_set_instance(pjmedia_vid_frame_pool *fp);
+
+
+/**
+ * Destroy the video frame pool. Buffers must not be used after the pool
+ * is destroyed. If the pool happens to be the singleton instance, the
+ * singleton instance will be set to NULL.
+ *
+ * @param fp		The video frame pool. Specify NULL to use the
+ *			singleton instance.
+ */
+PJ_DECL(void) pjmedia_vid_frame_pool_destroy(pjmedia_vid_frame_pool *fp);
+
+
+/**
+ * Take a buffer of at least the specified size from the pool. The buffer
+ * is returned with one reference, owned by the caller.
+ *
+ * @param fp		The video frame pool, or NULL to use the singleton
+ *			instance.
+ * @param size		Minimum size of the buffer, in bytes.
+ *
+ * @return		The buffer, or NULL if there is no pool or no memory.
+ */
+PJ_DECL(pjmedia_vid_frame_buf*)
+pjmedia_vid_frame_pool_alloc(pjmedia_vid_frame_pool *fp, pj_size_t size);
+
+
+/**
+ * Find the pool buffer which starts at the specified address. The
+ * reference counter of the buffer is not changed, so the caller must
+ * already be sure that the buffer is alive.
+ *
+ * @param fp		The video frame pool, or NULL to use the singleton
+ *			instance.
+ * @param buf		Buffer address, i.e. the \a buf of a frame.
+ *
+ * @return		The buffer, or NULL if the address is not a buffer
+ *			of the pool.
+ */
+PJ_DECL(pjmedia_vid_frame_buf*)
+pjmedia_vid_frame_pool_find(pjmedia_vid_frame_pool *fp, const void *buf);
+
+
+/**
+ * Add a reference to the buffer.
+ *
+ * @param fb		The buffer.
+ */
+PJ_DECL(void) pjmedia_vid_frame_buf_add_ref(pjmedia_vid_frame_buf *fb);
+
+
+/**
+ * Release a reference to the buffer. The buffer is returned to its pool
+ * when the last reference is released.
+ *
+ * @param fb		The buffer.
+ */
+PJ_DECL(void) pjmedia_vid_frame_buf_dec_ref(pjmedia_vid_frame_buf *fb);
+
+
+/**
+ * Make the destination frame refer to the picture of the source frame,
+ * by adding a reference to the source buffer, instead of copying it. The
+ * previous buffer of the destination frame is released if it belongs to
+ * the pool, other buffers are left alone. The shared buffer is read only
+ * for both frames.
+ *
+ * @param fp		The video frame pool, or NULL to use the singleton
+ *			instance.
+ * @param dst		The destination frame.
+ * @param src		The source frame.
+ *
+ * @return		PJ_SUCCESS if the picture is shared, or
+ *			PJ_ENOTFOUND if the source buffer does not belong
+ *			to the pool, in which case the caller should copy
+ *			the picture.
+ */
+PJ_DECL(pj_status_t) pjmedia_vid_frame_pool_share(pjmedia_vid_frame_pool *fp,
+						  pjmedia_frame *dst,
+						  const pjmedia_frame *src);
+
+
+/**
+ * Move the picture of the source frame to the destination frame by
+ * exchanging their buffers. This only succeeds when both buffers belong
+ * to the pool, neither is shared, and the source buffer is at least as
+ * large as the destination buffer. The source frame receives the former
+ * buffer of the destination frame, or a new buffer if that one is smaller
+ * than its own, and its size is set to zero.
+ *
+ * @param fp		The video frame pool, or NULL to use the singleton
+ *			instance.
+ * @param dst		The destination frame.
+ * @param src		The source frame.
+ *
+ * @return		PJ_SUCCESS if the buffers have been exchanged, or
+ *			the appropriate error code, in which case the caller
+ *			should copy the picture.
+ */
+PJ_DECL(pj_status_t)
+pjmedia_vid_frame_pool_exchange(pjmedia_vid_frame_pool *fp,
+				pjmedia_frame *dst,
+				pjmedia_frame *src);
+
+
+/**
+ * Make sure that the buffer of the frame may be written, before storing
+ * a new picture in it. If the buffer belongs to the pool and is shared,
+ * or is smaller than the specified size, it is replaced with a new buffer
+ * (the content is not copied). Buffers which do not belong to the pool
+ * are assumed to be owned by the caller and are left alone.
+ *
+ * @param fp		The video frame pool, or NULL to use the singleton
+ *			instance.
+ * @param frame		The frame.
+ * @param size		Minimum size of the buffer, in bytes.
+ *
+ * @return		PJ_SUCCESS if the frame buffer may be written.
+ */
+PJ_DECL(pj_status_t)
+pjmedia_vid_frame_pool_make_writable(pjmedia_vid_frame_pool *fp,
+				     pjmedia_frame *frame,
+				     pj_size_t size);
+
+
+/**
+ * Release the buffer of the frame if it belongs to the pool, and clear
+ * the frame buffer pointer. Other buffers are left alone.
+ *
+ * @param fp		The video frame pool, or NULL to use the singleton
+ *			instance.
+ * @param frame		The frame.
+ */
+PJ_DECL(void) pjmedia_vid_frame_pool_release(pjmedia_vid_frame_pool *fp,
+					     pjmedia_frame *frame);
+
+
+PJ_END_DECL
+
+/**
+ * @}
+ */
+
+
+#endif	/* __PJMEDIA_VID_FRAME_POOL_H__ */
@@ -0,0 +1,206 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2011 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef __PJMEDIA_WAV_CACHE_H__
+#define __PJMEDIA_WAV_CACHE_H__
+
+/**
+ * @file wav_cache.h
+ * @brief Shared WAV file cache.
+ */
+#include <pjmedia/format.h>
+
+
+PJ_BEGIN_DECL
+
+
+/**
+ * @defgroup PJMEDIA_WAV_CACHE Shared WAV File Cache
+ * @ingroup PJMEDIA_PORT
+ * @brief Share the contents of WAV files between players
+ * @{
+ *
+ * The WAV cache keeps the audio data of WAV files in memory, one copy per
+ * file, so that many players playing the same file (for example the same
+ * IVR prompt in many calls) do not each need their own buffer and their
+ * own file reads. Players created with
+ * #pjmedia_wav_player_port_create_cached() and
+ * #pjmedia_wav_playlist_create_cached() only keep a play position over
+ * the shared data.
+ *
+ * When #PJMEDIA_WAV_CACHE_USE_MMAP is enabled, the file is mapped into
+ * memory read-only instead of being read, so the data is shared with the
+ * operating system's page cache. Other formats of the data (16-bit PCM in
+ * host byte order, G.711 U-Law and A-Law) are converted once on demand
+ * and shared too, see #pjmedia_wav_cache_entry_get_data().
+ *
+ * Cache entries are reference counted. An entry which is no longer used
+ * stays in the cache until #pjmedia_wav_cache_flush() is called or the
+ * cache is destroyed, so a prompt which is played again later does not
+ * need to be loaded again.
+ */
+
+
+/**
+ * Opaque declaration of WAV cache.
+ */
+typedef struct pjmedia_wav_cache pjmedia_wav_cache;
+
+
+/**
+ * Opaque declaration of a WAV cache entry, i.e. a cached WAV file.
+ */
+typedef struct pjmedia_wav_cache_entry pjmedia_wav_cache_entry;
+
+
+/**
+ * Information about a cached WAV file.
+ */
+typedef struct pjmedia_wav_cache_info
+{
+    /**
+     * Format ID of the file payload, i.e. PJMEDIA_FORMAT_PCM,
+     * PJMEDIA_FORMAT_ULAW, or PJMEDIA_FORMAT_ALAW.
+     */
+    pjmedia_format_id	fmt_id;
+
+    /**
+     * Sampling rate.
+     */
+    unsigned		clock_rate;
+
+    /**
+     * Number of channels.
+     */
+    unsigned		channel_count;
+
+    /**
+     * Length of the audio, in samples (of all channels).
+     */
+    pj_uint32_t		size_samples;
+
+} pjmedia_wav_cache_info;
+
+
+/**
+ * Create a WAV cache.
+ *
+ * @param pf		Pool factory, used to allocate the cache and the
+ *			cache entries.
+ * @param p_cache	Pointer to receive the cache.
+ *
+ * @return		PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t) pjmedia_wav_cache_create(pj_pool_factory *pf,
+					      pjmedia_wav_cache **p_cache);
+
+
+/**
+ * Get a WAV file from the cache, loading the file if it is not in the
+ * cache yet. The entry is returned with one reference, which must be
+ * released with #pjmedia_wav_cache_release().
+ *
+ * The file must be a 16-bit PCM, G.711 U-Law, or G.711 A-Law WAV file.
+ *
+ * @param cache		The WAV cache.
+ * @param filename	The file name, which is used as the cache key.
+ * @param p_entry	Pointer to receive the entry.
+ *
+ * @return		PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t) pjmedia_wav_cache_get(pjmedia_wav_cache *cache,
+					   const char *filename,
+					   pjmedia_wav_cache_entry **p_entry);
+
+
+/**
+ * Release a reference to a cache entry.
+ *
+ * @param entry		The cache entry.
+ */
+PJ_DECL(void) pjmedia_wav_cache_release(pjmedia_wav_cache_entry *entry);
+
+
+/**
+ * Get information about a cached WAV file.
+ *
+ * @param entry		The cache entry.
+ * @param info		Pointer to receive the information.
+ *
+ * @return		PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t)
+pjmedia_wav_cache_entry_get_info(const pjmedia_wav_cache_entry *entry,
+				 pjmedia_wav_cache_info *info);
+
+
+/**
+ * Get the audio data of a cached WAV file in the specified format. If the
+ * file is stored in a different format, the data is converted the first
+ * time it is requested, and the converted data is kept in the entry for
+ * all users. The data is read-only, and it stays valid as long as the
+ * caller holds a reference to the entry.
+ *
+ * @param entry		The cache entry.
+ * @param fmt_id	The format: PJMEDIA_FORMAT_PCM (16-bit samples in
+ *			host byte order), PJMEDIA_FORMAT_ULAW, or
+ *			PJMEDIA_FORMAT_ALAW.
+ * @param p_data	Pointer to receive the data.
+ * @param p_size	Pointer to receive the data size, in bytes.
+ *
+ * @return		PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t)
+pjmedia_wav_cache_entry_get_data(pjmedia_wav_cache_entry *entry,
+				 pjmedia_format_id fmt_id,
+				 const void **p_data,
+				 pj_size_t *p_size);
+
+
+/**
+ * Remove the entries which are not used from the cache, for example
+ * after the prompt files have been updated.
+ *
+ * @param cache		The WAV cache.
+ *
+ * @return		Number of entries removed.
+ */
+PJ_DECL(unsigned) pjmedia_wav_cache_flush(pjmedia_wav_cache *cache);
+
+
+/**
+ * Destroy the WAV cache. All players using the cache must have been
+ * destroyed.
+ *
+ * @param cache		The WAV cache.
+ *
+ * @return		PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t) pjmedia_wav_cache_destroy(pjmedia_wav_cache *cache);
+
+
+/**
+ * @}
+ */
+
+
+PJ_END_DECL
+
+
+#endif	/* __PJMEDIA_WAV_CACHE_H__ */
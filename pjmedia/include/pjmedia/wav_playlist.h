@@ -72,6 +72,37 @@ PJ_DECL(pj_status_t) pjmedia_wav_playlist_create(pj_pool_t *pool,
 						 pjmedia_port **p_port);
 
 
+/**
+ * Create a WAV playlist which plays the files from a WAV cache, see
+ * #pjmedia_wav_player_port_create_cached(). Unlike
+ * #pjmedia_wav_playlist_create(), the files may also be G.711 WAV files,
+ * but they must still have the same clock rate and number of channels.
+ *
+ * @param pool		Pool to allocate the port.
+ * @param cache		The WAV cache.
+ * @param port_label	Optional label to set as the port name.
+ * @param file_list	Array of WAV file names.
+ * @param file_count	Number of files in the array.
+ * @param ptime		The duration (in miliseconds) of each frame read
+ *			from this port. If the value is zero, the default
+ *			duration (20ms) will be used.
+ * @param options	Optional options. Application may specify 
+ *			PJMEDIA_FILE_NO_LOOP to prevent play back loop.
+ * @param p_port	Pointer to receive the file port instance.
+ *
+ * @return		PJ_SUCCESS on success, or the appropriate error code.
+ */
+PJ_DECL(pj_status_t) pjmedia_wav_playlist_create_cached(
+						 pj_pool_t *pool,
+						 pjmedia_wav_cache *cache,
+						 const pj_str_t *port_label,
+						 const pj_str_t file_list[],
+						 int file_count,
+						 unsigned ptime,
+						 unsigned options,
+						 pjmedia_port **p_port);
+
+
 /**
  * Register a callback to be called when the file reading has reached the
  * end of file of the last file. If the file is set to play repeatedly, 
@@ -25,6 +25,7 @@
  * @brief WAV file player and writer.
  */
 #include <pjmedia/port.h>
+#include <pjmedia/wav_cache.h>
 
 
 
@@ -105,6 +106,75 @@ PJ_DECL(pj_status_t) pjmedia_wav_player_port_create( pj_pool_t *pool,
 						     pj_ssize_t buff_size,
 						     pjmedia_port **p_port );
 
+/**
+ * Create a media port to play a WAV file from a WAV cache. The file is
+ * loaded into the cache if it is not there yet, and the player only keeps
+ * a play position over the cached data, so any number of players can play
+ * the same file with one copy of the data in memory. G.711 files are
+ * decoded once, in the cache. See @ref PJMEDIA_WAV_CACHE.
+ *
+ * The player supports the same operations as players created with
+ * #pjmedia_wav_player_port_create().
+ *
+ * @param pool		Pool to allocate the port.
+ * @param cache		The WAV cache.
+ * @param filename	File name to play.
+ * @param ptime		The duration (in miliseconds) of each frame read
+ *			from this port. If the value is zero, the default
+ *			duration (20ms) will be used.
+ * @param flags		Port creation flags.
+ * @param p_port	Pointer to receive the file port instance.
+ *
+ * @return		PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t)
+pjmedia_wav_player_port_create_cached(pj_pool_t *pool,
+				      pjmedia_wav_cache *cache,
+				      const char *filename,
+				      unsigned ptime,
+				      unsigned flags,
+				      pjmedia_port **p_port);
+
+/**
+ * Create a media port to play a WAV file from a WAV cache as frames which
+ * are already encoded with G.711, so that a stream using the same codec
+ * can send them without encoding. The port returns
+ * #PJMEDIA_FRAME_TYPE_EXTENDED frames (see #pjmedia_frame_ext) containing
+ * the U-Law or A-Law payload, which the cache converts once per file and
+ * shares between all players. The port format ID is \a fmt_id.
+ *
+ * When the port is connected to a stream whose codec takes PCM input
+ * (for example with #pjmedia_master_port_create()), the stream puts the
+ * payload in the RTP packets as is, without invoking its encoder.
+ * The frames carry \a fmt_id in their \a bit_info field, and the stream
+ * drops them with #PJMEDIA_EINVALIDPT unless its codec is the G.711
+ * codec of the same law. The stream's packet duration is then \a ptime.
+ *
+ * The player supports the same operations as players created with
+ * #pjmedia_wav_player_port_create().
+ *
+ * @param pool		Pool to allocate the port.
+ * @param cache		The WAV cache.
+ * @param filename	File name to play.
+ * @param fmt_id	PJMEDIA_FORMAT_PCMU or PJMEDIA_FORMAT_PCMA.
+ * @param ptime		The duration (in miliseconds) of each frame read
+ *			from this port. If the value is zero, the default
+ *			duration (20ms) will be used.
+ * @param flags		Port creation flags.
+ * @param p_port	Pointer to receive the file port instance.
+ *
+ * @return		PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t)
+pjmedia_wav_player_port_create_encoded(pj_pool_t *pool,
+				       pjmedia_wav_cache *cache,
+				       const char *filename,
+				       pjmedia_format_id fmt_id,
+				       unsigned ptime,
+				       unsigned flags,
+				       pjmedia_port **p_port);
+
+
 /**
  * Get additional info about the file player.
  *
@@ -279,6 +349,131 @@ pjmedia_wav_writer_port_set_cb( pjmedia_port *port,
 						  void *usr_data));
 
 
+/**
+ * Opaque declaration of WAV writer I/O thread. The I/O thread writes the
+ * recordings of asynchronous WAV writers to disk, so that the threads
+ * which put frames to the writers (such as the conference bridge clock)
+ * never wait for the disk. See #pjmedia_wav_writer_port_create_async().
+ */
+typedef struct pjmedia_wav_writer_io pjmedia_wav_writer_io;
+
+
+/**
+ * Statistics of WAV writer I/O thread.
+ */
+typedef struct pjmedia_wav_writer_io_stat
+{
+    /**
+     * Number of writers currently using the I/O thread.
+     */
+    unsigned	    writer_cnt;
+
+    /**
+     * Number of file writes done by the I/O thread. Each write may contain
+     * several buffers.
+     */
+    unsigned	    write_cnt;
+
+    /**
+     * Number of bytes written to the files.
+     */
+    pj_size_t	    bytes_written;
+
+    /**
+     * Number of frames which were (partly) dropped because all buffers of
+     * the writer were waiting to be written, i.e. because the disk could
+     * not keep up.
+     */
+    unsigned	    drop_cnt;
+
+} pjmedia_wav_writer_io_stat;
+
+
+/**
+ * Create WAV writer I/O thread, which can be shared by any number of
+ * asynchronous WAV writers.
+ *
+ * @param pf		Pool factory.
+ * @param p_io		Pointer to receive the I/O thread instance.
+ *
+ * @return		PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t) pjmedia_wav_writer_io_create(pj_pool_factory *pf,
+						  pjmedia_wav_writer_io **p_io);
+
+
+/**
+ * Get the statistics of WAV writer I/O thread.
+ *
+ * @param io		The I/O thread.
+ * @param stat		Pointer to receive the statistics.
+ *
+ * @return		PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t)
+pjmedia_wav_writer_io_get_stat(pjmedia_wav_writer_io *io,
+			       pjmedia_wav_writer_io_stat *stat);
+
+
+/**
+ * Destroy WAV writer I/O thread. All writers using the I/O thread must
+ * have been destroyed.
+ *
+ * @param io		The I/O thread.
+ *
+ * @return		PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t) pjmedia_wav_writer_io_destroy(pjmedia_wav_writer_io *io);
+
+
+/**
+ * Create an asynchronous WAV writer port. The port behaves like a writer
+ * created with #pjmedia_wav_writer_port_create(), but the audio is
+ * collected in a ring of #PJMEDIA_WAV_WRITER_IO_BUF_CNT buffers which are
+ * written to disk by the I/O thread, so #pjmedia_port_put_frame() only
+ * copies (or G.711 encodes) the frame. The buffers are aligned to, and a
+ * multiple of, #PJMEDIA_WAV_WRITER_IO_ALIGN bytes, and the WAV header is
+ * stored in the first buffer, so every write except the last one is a
+ * full aligned block at an aligned file offset. Several buffers of the
+ * writer which are ready are written with one write.
+ *
+ * If the disk cannot keep up and all buffers are waiting to be written,
+ * the frames are dropped instead of blocking the caller, see
+ * #pjmedia_wav_writer_io_stat.
+ *
+ * Destroying the port waits until the I/O thread has written all buffers
+ * of the port, then updates the WAV header in the calling thread.
+ *
+ * @param pool		    Pool to create memory buffers for this port.
+ * @param io		    The I/O thread.
+ * @param filename	    File name.
+ * @param clock_rate	    The sampling rate.
+ * @param channel_count	    Number of channels.
+ * @param samples_per_frame Number of samples per frame.
+ * @param bits_per_sample   Number of bits per sample (eg 16).
+ * @param flags		    Port creation flags, see
+ *			    #pjmedia_file_writer_option.
+ * @param buff_size	    Size of each buffer. It is rounded up to a
+ *			    multiple of #PJMEDIA_WAV_WRITER_IO_ALIGN. If the
+ *			    value is zero or negative, the port will use
+ *			    #PJMEDIA_FILE_PORT_BUFSIZE.
+ * @param p_port	    Pointer to receive the file port instance.
+ *
+ * @return		    PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t)
+pjmedia_wav_writer_port_create_async(pj_pool_t *pool,
+				     pjmedia_wav_writer_io *io,
+				     const char *filename,
+				     unsigned clock_rate,
+				     unsigned channel_count,
+				     unsigned samples_per_frame,
+				     unsigned bits_per_sample,
+				     unsigned flags,
+				     pj_ssize_t buff_size,
+				     pjmedia_port **p_port);
+
+
 /**
  * @}
  */
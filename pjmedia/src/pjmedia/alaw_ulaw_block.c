@@ -0,0 +1,353 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2011 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include <pjmedia/alaw_ulaw.h>
+
+/*
+ * Block A-law/U-law conversion.
+ *
+ * The SIMD kernels compute the G.711 segment and quantization bits
+ * arithmetically, sixteen samples at a time, and produce exactly the
+ * same values as the conversion tables in alaw_ulaw_table.c. The
+ * segment number is found with PSHUFB nibble lookups, and the variable
+ * shifts by segment number are done as 16-bit multiplications by powers
+ * of two, which are looked up with PSHUFB as well.
+ */
+#if defined(PJMEDIA_HAS_G711_SIMD) && PJMEDIA_HAS_G711_SIMD!=0 && \
+    (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+#   define G711_HAS_SSSE3   1
+#   include <cpuid.h>
+#   include <tmmintrin.h>
+#   define SSSE3_FUNC	    __attribute__((target("ssse3")))
+#else
+#   define G711_HAS_SSSE3   0
+#endif
+
+
+typedef void (*encode_func)(pj_uint8_t *dst, const pj_int16_t *src,
+			    pj_size_t count);
+typedef void (*decode_func)(pj_int16_t *dst, const pj_uint8_t *src,
+			    pj_size_t len);
+
+
+#if G711_HAS_SSSE3
+
+/* Segment number of sixteen magnitudes in 0..0x7FFF, given their high
+ * bytes: the bit length of the high byte.
+ */
+SSSE3_FUNC static __m128i segment16(__m128i hb)
+{
+    const __m128i lo_tab = _mm_setr_epi8(0, 1, 2, 2, 3, 3, 3, 3,
+					 4, 4, 4, 4, 4, 4, 4, 4);
+    const __m128i hi_tab = _mm_setr_epi8(0, 5, 6, 6, 7, 7, 7, 7,
+					 7, 7, 7, 7, 7, 7, 7, 7);
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+
+    return _mm_max_epu8(
+		_mm_shuffle_epi8(lo_tab, _mm_and_si128(hb, nibble)),
+		_mm_shuffle_epi8(hi_tab, _mm_and_si128(_mm_srli_epi16(hb, 4),
+						       nibble)));
+}
+
+/* Encode sixteen PCM samples. The magnitudes are shifted right by the
+ * segment dependent amount with a multiplication by mul_tab[seg] (low
+ * bytes of the multipliers in the first eight entries, high bytes in the
+ * last eight), then combined with the segment and the sign mask.
+ */
+SSSE3_FUNC static __m128i encode16(__m128i mag0, __m128i mag1,
+				   __m128i neg0, __m128i neg1,
+				   __m128i mul_tab, __m128i pos_mask,
+				   __m128i neg_mask)
+{
+    const __m128i eight = _mm_set1_epi8(8);
+    const __m128i quant = _mm_set1_epi16(0x0F);
+    __m128i seg, seg0, seg1, mul0, mul1, code0, code1;
+
+    seg = segment16(_mm_packus_epi16(_mm_srli_epi16(mag0, 8),
+				     _mm_srli_epi16(mag1, 8)));
+    mul0 = _mm_shuffle_epi8(mul_tab, _mm_unpacklo_epi8(seg,
+						_mm_add_epi8(seg, eight)));
+    mul1 = _mm_shuffle_epi8(mul_tab, _mm_unpackhi_epi8(seg,
+						_mm_add_epi8(seg, eight)));
+    seg0 = _mm_unpacklo_epi8(seg, _mm_setzero_si128());
+    seg1 = _mm_unpackhi_epi8(seg, _mm_setzero_si128());
+
+    code0 = _mm_or_si128(_mm_and_si128(_mm_mulhi_epu16(mag0, mul0), quant),
+			 _mm_slli_epi16(seg0, 4));
+    code1 = _mm_or_si128(_mm_and_si128(_mm_mulhi_epu16(mag1, mul1), quant),
+			 _mm_slli_epi16(seg1, 4));
+
+    code0 = _mm_xor_si128(code0, _mm_or_si128(_mm_and_si128(neg0, neg_mask),
+					_mm_andnot_si128(neg0, pos_mask)));
+    code1 = _mm_xor_si128(code1, _mm_or_si128(_mm_and_si128(neg1, neg_mask),
+					_mm_andnot_si128(neg1, pos_mask)));
+
+    return _mm_packus_epi16(code0, code1);
+}
+
+/* U-law: magnitude plus bias, clipped to 0x7FFF */
+SSSE3_FUNC static __m128i ulaw_mag(__m128i pcm)
+{
+    const __m128i max = _mm_set1_epi16(0x7FFF);
+    __m128i mag;
+
+    mag = _mm_adds_epu16(_mm_abs_epi16(pcm), _mm_set1_epi16(0x84));
+    return _mm_subs_epu16(mag, _mm_subs_epu16(mag, max));
+}
+
+SSSE3_FUNC static void ulaw_encode_ssse3(pj_uint8_t *dst,
+					 const pj_int16_t *src,
+					 pj_size_t count)
+{
+    /* Shift right by seg+3, i.e. multiply by 2^(13-seg) */
+    const __m128i mul_tab = _mm_setr_epi8(0, 0, 0, 0, 0, 0,
+					  (char)0x80, 0x40,
+					  0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+					  0, 0);
+    const __m128i q = _mm_set1_epi16(~3);
+    pj_size_t i;
+
+    for (i = 0; i + 16 <= count; i += 16) {
+	/* The tables quantize the input to 14 bits first */
+	__m128i p0 = _mm_and_si128(_mm_loadu_si128((const __m128i*)(src+i)),
+				   q);
+	__m128i p1 = _mm_and_si128(_mm_loadu_si128((const __m128i*)(src+i+8)),
+				   q);
+
+	_mm_storeu_si128((__m128i*)(dst + i),
+			 encode16(ulaw_mag(p0), ulaw_mag(p1),
+				  _mm_srai_epi16(p0, 15),
+				  _mm_srai_epi16(p1, 15),
+				  mul_tab, _mm_set1_epi16(0xFF),
+				  _mm_set1_epi16(0x7F)));
+    }
+    pjmedia_ulaw_encode(dst + i, src + i, count - i);
+}
+
+/* A-law: saturated magnitude. After quantization this matches the
+ * tables, which do not apply the -8 offset to negative samples.
+ */
+SSSE3_FUNC static __m128i alaw_mag(__m128i pcm)
+{
+    return _mm_abs_epi16(_mm_max_epi16(pcm, _mm_set1_epi16(-32767)));
+}
+
+SSSE3_FUNC static void alaw_encode_ssse3(pj_uint8_t *dst,
+					 const pj_int16_t *src,
+					 pj_size_t count)
+{
+    /* Shift right by 4 for segments 0 and 1, and by seg+3 otherwise */
+    const __m128i mul_tab = _mm_setr_epi8(0, 0, 0, 0, 0, 0,
+					  (char)0x80, 0x40,
+					  0x10, 0x10, 0x08, 0x04, 0x02, 0x01,
+					  0, 0);
+    const __m128i q = _mm_set1_epi16(~3);
+    pj_size_t i;
+
+    for (i = 0; i + 16 <= count; i += 16) {
+	__m128i p0 = _mm_and_si128(_mm_loadu_si128((const __m128i*)(src+i)),
+				   q);
+	__m128i p1 = _mm_and_si128(_mm_loadu_si128((const __m128i*)(src+i+8)),
+				   q);
+
+	_mm_storeu_si128((__m128i*)(dst + i),
+			 encode16(alaw_mag(p0), alaw_mag(p1),
+				  _mm_srai_epi16(p0, 15),
+				  _mm_srai_epi16(p1, 15),
+				  mul_tab, _mm_set1_epi16(0xD5),
+				  _mm_set1_epi16(0x55)));
+    }
+    pjmedia_alaw_encode(dst + i, src + i, count - i);
+}
+
+/* Decode sixteen codes, given the base value t (up to 9 bits, as low
+ * byte t8 and high byte t9), the power of two multiplier pow, and the
+ * negative sign mask neg, all as bytes.
+ */
+SSSE3_FUNC static void decode16(pj_int16_t *dst, __m128i t8, __m128i t9,
+				__m128i pow, __m128i neg, __m128i bias)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i t0, t1, n0, n1;
+
+    t0 = _mm_mullo_epi16(_mm_unpacklo_epi8(t8, t9),
+			 _mm_unpacklo_epi8(pow, zero));
+    t1 = _mm_mullo_epi16(_mm_unpackhi_epi8(t8, t9),
+			 _mm_unpackhi_epi8(pow, zero));
+    t0 = _mm_sub_epi16(t0, bias);
+    t1 = _mm_sub_epi16(t1, bias);
+
+    n0 = _mm_unpacklo_epi8(neg, neg);
+    n1 = _mm_unpackhi_epi8(neg, neg);
+    _mm_storeu_si128((__m128i*)dst,
+		     _mm_sub_epi16(_mm_xor_si128(t0, n0), n0));
+    _mm_storeu_si128((__m128i*)(dst + 8),
+		     _mm_sub_epi16(_mm_xor_si128(t1, n1), n1));
+}
+
+SSSE3_FUNC static void ulaw_decode_ssse3(pj_int16_t *dst,
+					 const pj_uint8_t *src,
+					 pj_size_t len)
+{
+    const __m128i pow_tab = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64,
+					  (char)128, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i bias = _mm_set1_epi16(0x84);
+    pj_size_t i;
+
+    for (i = 0; i + 16 <= len; i += 16) {
+	__m128i u, t, exp;
+
+	u = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(src + i)),
+			  _mm_set1_epi8((char)0xFF));
+
+	/* ((quant << 3) + 0x84) << exp, minus 0x84 */
+	t = _mm_add_epi8(_mm_slli_epi16(_mm_and_si128(u, _mm_set1_epi8(0x0F)),
+					3),
+			 _mm_set1_epi8((char)0x84));
+	exp = _mm_and_si128(_mm_srli_epi16(u, 4), _mm_set1_epi8(0x07));
+
+	decode16(dst + i, t, _mm_setzero_si128(),
+		 _mm_shuffle_epi8(pow_tab, exp),
+		 _mm_cmplt_epi8(u, _mm_setzero_si128()), bias);
+    }
+    pjmedia_ulaw_decode(dst + i, src + i, len - i);
+}
+
+SSSE3_FUNC static void alaw_decode_ssse3(pj_int16_t *dst,
+					 const pj_uint8_t *src,
+					 pj_size_t len)
+{
+    const __m128i pow_tab = _mm_setr_epi8(1, 1, 2, 4, 8, 16, 32, 64,
+					  0, 0, 0, 0, 0, 0, 0, 0);
+    pj_size_t i;
+
+    for (i = 0; i + 16 <= len; i += 16) {
+	__m128i a, t, seg;
+
+	a = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(src + i)),
+			  _mm_set1_epi8(0x55));
+
+	/* (quant << 4) + 8, plus 0x100 for segments above zero, shifted
+	 * left by seg-1. Unlike U-law, a cleared sign bit means negative.
+	 */
+	t = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(a, _mm_set1_epi8(0x0F)),
+					4),
+			 _mm_set1_epi8(8));
+	seg = _mm_and_si128(_mm_srli_epi16(a, 4), _mm_set1_epi8(0x07));
+
+	decode16(dst + i, t, _mm_min_epu8(seg, _mm_set1_epi8(1)),
+		 _mm_shuffle_epi8(pow_tab, seg),
+		 _mm_cmpgt_epi8(a, _mm_set1_epi8(-1)), _mm_setzero_si128());
+    }
+    pjmedia_alaw_decode(dst + i, src + i, len - i);
+}
+
+static pj_bool_t ssse3_supported(void)
+{
+    unsigned eax, ebx, ecx, edx;
+
+    if (__get_cpuid_max(0, NULL) < 1)
+	return PJ_FALSE;
+
+    __cpuid(1, eax, ebx, ecx, edx);
+    return (ecx & (1 << 9)) != 0;
+}
+
+#endif	/* G711_HAS_SSSE3 */
+
+
+static void ulaw_encode_generic(pj_uint8_t *dst, const pj_int16_t *src,
+				pj_size_t count)
+{
+    pjmedia_ulaw_encode(dst, src, count);
+}
+
+static void alaw_encode_generic(pj_uint8_t *dst, const pj_int16_t *src,
+				pj_size_t count)
+{
+    pjmedia_alaw_encode(dst, src, count);
+}
+
+static void ulaw_decode_generic(pj_int16_t *dst, const pj_uint8_t *src,
+				pj_size_t len)
+{
+    pjmedia_ulaw_decode(dst, src, len);
+}
+
+static void alaw_decode_generic(pj_int16_t *dst, const pj_uint8_t *src,
+				pj_size_t len)
+{
+    pjmedia_alaw_decode(dst, src, len);
+}
+
+
+/* The active kernels. They start with the portable implementation, and
+ * pjmedia_alaw_ulaw_block_init() selects the best one once, before other
+ * threads can use them.
+ */
+static encode_func ulaw_encode_impl = &ulaw_encode_generic;
+static encode_func alaw_encode_impl = &alaw_encode_generic;
+static decode_func ulaw_decode_impl = &ulaw_decode_generic;
+static decode_func alaw_decode_impl = &alaw_decode_generic;
+
+PJ_DEF(void) pjmedia_alaw_ulaw_block_init(void)
+{
+#if G711_HAS_SSSE3
+    if (ssse3_supported()) {
+	ulaw_encode_impl = &ulaw_encode_ssse3;
+	alaw_encode_impl = &alaw_encode_ssse3;
+	ulaw_decode_impl = &ulaw_decode_ssse3;
+	alaw_decode_impl = &alaw_decode_ssse3;
+	return;
+    }
+#endif
+    ulaw_encode_impl = &ulaw_encode_generic;
+    alaw_encode_impl = &alaw_encode_generic;
+    ulaw_decode_impl = &ulaw_decode_generic;
+    alaw_decode_impl = &alaw_decode_generic;
+}
+
+PJ_DEF(void) pjmedia_ulaw_encode_block(pj_uint8_t *dst,
+				       const pj_int16_t *src,
+				       pj_size_t count)
+{
+    (*ulaw_encode_impl)(dst, src, count);
+}
+
+PJ_DEF(void) pjmedia_alaw_encode_block(pj_uint8_t *dst,
+				       const pj_int16_t *src,
+				       pj_size_t count)
+{
+    (*alaw_encode_impl)(dst, src, count);
+}
+
+PJ_DEF(void) pjmedia_ulaw_decode_block(pj_int16_t *dst,
+				       const pj_uint8_t *src,
+				       pj_size_t len)
+{
+    (*ulaw_decode_impl)(dst, src, len);
+}
+
+PJ_DEF(void) pjmedia_alaw_decode_block(pj_int16_t *dst,
+				       const pj_uint8_t *src,
+				       pj_size_t len)
+{
+    (*alaw_decode_impl)(dst, src, len);
+}
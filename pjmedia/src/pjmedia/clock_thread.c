@@ -20,12 +20,18 @@
 #include <pjmedia/clock.h>
 #include <pjmedia/errno.h>
 #include <pj/assert.h>
+#include <pj/list.h>
 #include <pj/lock.h>
 #include <pj/os.h>
 #include <pj/pool.h>
 #include <pj/string.h>
 #include <pj/compat/high_precision.h>
 
+#if PJMEDIA_CLOCK_SCHED_USE_TIMERFD
+#   include <sys/timerfd.h>
+#   include <unistd.h>
+#endif
+
 /* API: Init clock source */
 PJ_DEF(pj_status_t) pjmedia_clock_src_init( pjmedia_clock_src *clocksrc,
                                             pjmedia_type media_type,
@@ -107,8 +113,11 @@ pjmedia_clock_src_get_time_msec( const pjmedia_clock_src *clocksrc )
  * Implementation of media clock with OS thread.
  */
 
+typedef struct sched_thread sched_thread;
+
 struct pjmedia_clock
 {
+    PJ_DECL_LIST_MEMBER(struct pjmedia_clock);
     pj_pool_t		    *pool;
     pj_timestamp	     freq;
     pj_timestamp	     interval;
@@ -123,10 +132,71 @@ struct pjmedia_clock
     pj_bool_t		     running;
     pj_bool_t		     quitting;
     pj_lock_t		    *lock;
+
+    /* Scheduler, if the clock is driven by a clock scheduler */
+    pjmedia_clock_sched	    *sched;
+    sched_thread	    *sched_thread;
+    pj_uint64_t		     sched_slot;
+    int			     sched_state;
+};
+
+
+/* Where a scheduled clock currently is */
+enum sched_state
+{
+    SCHED_NONE,		/* Not queued */
+    SCHED_IN_WHEEL,	/* Waiting in the timing wheel */
+    SCHED_IN_DUE,	/* In the list of clocks to be called in this slot */
+    SCHED_IN_CB		/* Its callback is being called */
+};
+
+/* Timing wheel slot, a list of clocks */
+typedef struct sched_slot
+{
+    PJ_DECL_LIST_MEMBER(struct pjmedia_clock);
+} sched_slot;
+
+/* Clock scheduler thread */
+struct sched_thread
+{
+    pjmedia_clock_sched	    *sched;
+    pj_thread_t		    *thread;
+    pj_mutex_t		    *mutex;
+    pj_bool_t		     quitting;
+    unsigned		     clock_cnt;
+
+    /* Threads waiting for the running callback to return */
+    pj_sem_t		    *cb_sem;
+    unsigned		     cb_waiters;
+
+    /* Next slot to be processed, counted from the scheduler's base time */
+    pj_uint64_t		     cur_slot;
+
+    /* The wheel, and number of clocks in each slot of the wheel */
+    sched_slot		     wheel[PJMEDIA_CLOCK_SCHED_WHEEL_SIZE];
+    unsigned		     slot_cnt[PJMEDIA_CLOCK_SCHED_WHEEL_SIZE];
+
+#if PJMEDIA_CLOCK_SCHED_USE_TIMERFD
+    int			     tfd;
+#endif
+};
+
+struct pjmedia_clock_sched
+{
+    pj_pool_t		    *pool;
+    unsigned		     options;
+    pj_timestamp	     freq;
+    pj_timestamp	     base;
+    pj_uint64_t		     slot_ticks;
+    unsigned		     thread_cnt;
+    sched_thread	    *threads;
 };
 
 
 static int clock_thread(void *arg);
+static pj_status_t sched_add_clock(pjmedia_clock_sched *sched,
+				   pjmedia_clock *clock);
+static void sched_remove_clock(pjmedia_clock *clock);
 
 #define MAX_JUMP_MSEC	500
 #define USEC_IN_SEC	(pj_uint64_t)1000000
@@ -186,6 +256,9 @@ PJ_DEF(pj_status_t) pjmedia_clock_create2(pj_pool_t *pool,
     clock->thread = NULL;
     clock->running = PJ_FALSE;
     clock->quitting = PJ_FALSE;
+    clock->sched = NULL;
+    clock->sched_thread = NULL;
+    clock->sched_state = SCHED_NONE;
     
     /* I don't think we need a mutex, so we'll use null. */
     status = pj_lock_create_null_mutex(pool, "clock", &clock->lock);
@@ -219,6 +292,13 @@ PJ_DEF(pj_status_t) pjmedia_clock_start(pjmedia_clock *clock)
     clock->running = PJ_TRUE;
     clock->quitting = PJ_FALSE;
 
+    if (clock->sched) {
+	status = sched_add_clock(clock->sched, clock);
+	if (status != PJ_SUCCESS)
+	    clock->running = PJ_FALSE;
+	return status;
+    }
+
     if ((clock->options & PJMEDIA_CLOCK_NO_ASYNC) == 0 && !clock->thread) {
 	status = pj_thread_create(clock->pool, "clock", &clock_thread, clock,
 				  0, 0, &clock->thread);
@@ -242,6 +322,9 @@ PJ_DEF(pj_status_t) pjmedia_clock_stop(pjmedia_clock *clock)
     clock->running = PJ_FALSE;
     clock->quitting = PJ_TRUE;
 
+    if (clock->sched_thread)
+	sched_remove_clock(clock);
+
     if (clock->thread) {
 	if (pj_thread_join(clock->thread) == PJ_SUCCESS) {
 	    pj_thread_destroy(clock->thread);
@@ -404,6 +487,9 @@ PJ_DEF(pj_status_t) pjmedia_clock_destroy(pjmedia_clock *clock)
     clock->running = PJ_FALSE;
     clock->quitting = PJ_TRUE;
 
+    if (clock->sched_thread)
+	sched_remove_clock(clock);
+
     if (clock->thread) {
 	pj_thread_join(clock->thread);
 	pj_thread_destroy(clock->thread);
@@ -424,3 +510,469 @@ PJ_DEF(pj_status_t) pjmedia_clock_destroy(pjmedia_clock *clock)
 }
 
 
+/*
+ * Attach the clock to a scheduler.
+ */
+PJ_DEF(pj_status_t) pjmedia_clock_set_sched(pjmedia_clock *clock,
+					    pjmedia_clock_sched *sched)
+{
+    PJ_ASSERT_RETURN(clock, PJ_EINVAL);
+    PJ_ASSERT_RETURN((clock->options & PJMEDIA_CLOCK_NO_ASYNC) == 0,
+		     PJ_EINVALIDOP);
+    PJ_ASSERT_RETURN(!clock->running, PJ_EINVALIDOP);
+
+    clock->sched = sched;
+    return PJ_SUCCESS;
+}
+
+
+/*
+ * Implementation of media clock scheduler.
+ *
+ * Each scheduler thread keeps its clocks in a timing wheel, where a clock
+ * waits in the slot of its next tick. The thread wakes up at every slot
+ * boundary and calls the clocks of the slots which have just ended.
+ */
+
+/* Get the slot of the specified time */
+PJ_INLINE(pj_uint64_t) sched_slot_of(const pjmedia_clock_sched *sched,
+				     const pj_timestamp *ts)
+{
+    if (ts->u64 <= sched->base.u64)
+	return 0;
+    return (ts->u64 - sched->base.u64) / sched->slot_ticks;
+}
+
+/* Put the clock in the wheel. Thread mutex must be held. */
+static void sched_queue_clock(sched_thread *st, pjmedia_clock *clock,
+			      pj_uint64_t slot)
+{
+    unsigned idx = (unsigned)(slot % PJMEDIA_CLOCK_SCHED_WHEEL_SIZE);
+
+    clock->sched_slot = slot;
+    clock->sched_state = SCHED_IN_WHEEL;
+    pj_list_push_back(&st->wheel[idx], clock);
+    st->slot_cnt[idx]++;
+}
+
+/* Call the clocks which tick in the specified slot */
+static void sched_process_slot(sched_thread *st, pj_uint64_t slot,
+			       pj_timestamp *now)
+{
+    pjmedia_clock_sched *sched = st->sched;
+    unsigned idx = (unsigned)(slot % PJMEDIA_CLOCK_SCHED_WHEEL_SIZE);
+    sched_slot *head = &st->wheel[idx];
+    sched_slot due;
+    pjmedia_clock *clock, *next;
+
+    if (pj_list_empty(head))
+	return;
+
+    /* Move the clocks which are due to a separate list first. The wheel
+     * slot may hold clocks with interval longer than the wheel, which tick
+     * on a later turn.
+     */
+    pj_list_init(&due);
+    for (clock = head->next; clock != (pjmedia_clock*)head; clock = next) {
+	next = clock->next;
+	if (clock->sched_slot <= slot) {
+	    pj_list_erase(clock);
+	    pj_list_push_back(&due, clock);
+	    clock->sched_state = SCHED_IN_DUE;
+	    st->slot_cnt[idx]--;
+	}
+    }
+
+    /* The mutex is released while the callback is called, so that a clock
+     * can be stopped without waiting for the other clocks of the thread,
+     * and the callback may take locks which are held by a thread stopping
+     * a clock. Any clock may be stopped meanwhile, so take the clocks out
+     * of the list one by one.
+     */
+    while (!pj_list_empty(&due)) {
+	pj_uint64_t next_slot;
+
+	clock = due.next;
+	pj_list_erase(clock);
+	clock->sched_state = SCHED_IN_CB;
+
+	pj_mutex_unlock(st->mutex);
+	if (clock->cb)
+	    (*clock->cb)(&clock->timestamp, clock->user_data);
+	pj_mutex_lock(st->mutex);
+
+	/* Wake up the threads which stopped a clock during the callback */
+	while (st->cb_waiters) {
+	    --st->cb_waiters;
+	    pj_sem_post(st->cb_sem);
+	}
+
+	/* Stopped or destroyed during the callback */
+	if (clock->sched_state != SCHED_IN_CB)
+	    continue;
+
+	clock->timestamp.u64 += clock->timestamp_inc;
+	clock_calc_next_tick(clock, now);
+
+	/* If we are late, tick again in the next slot to catch up */
+	next_slot = sched_slot_of(sched, &clock->next_tick);
+	if (next_slot <= slot)
+	    next_slot = slot + 1;
+
+	sched_queue_clock(st, clock, next_slot);
+    }
+}
+
+/* Wait until the next slot boundary */
+static void sched_wait(sched_thread *st)
+{
+#if PJMEDIA_CLOCK_SCHED_USE_TIMERFD
+    if (st->tfd >= 0) {
+	pj_uint64_t expirations;
+	if (read(st->tfd, &expirations, sizeof(expirations)) > 0)
+	    return;
+    }
+#endif
+    {
+	pjmedia_clock_sched *sched = st->sched;
+	pj_timestamp now, next;
+	unsigned usec;
+
+	pj_get_timestamp(&now);
+	next.u64 = sched->base.u64 +
+		   (sched_slot_of(sched, &now) + 1) * sched->slot_ticks;
+	usec = pj_elapsed_usec(&now, &next);
+	pj_thread_sleep((usec + 999) / 1000);
+    }
+}
+
+/*
+ * Clock scheduler thread
+ */
+static int sched_thread_proc(void *arg)
+{
+    sched_thread *st = (sched_thread*) arg;
+    pjmedia_clock_sched *sched = st->sched;
+
+    /* Set thread priority to maximum unless not wanted. */
+    if ((sched->options & PJMEDIA_CLOCK_NO_HIGHEST_PRIO) == 0) {
+	int max = pj_thread_get_prio_max(pj_thread_this());
+	if (max > 0)
+	    pj_thread_set_prio(pj_thread_this(), max);
+    }
+
+    while (!st->quitting) {
+	pj_timestamp now;
+	pj_uint64_t now_slot;
+
+	sched_wait(st);
+
+	pj_get_timestamp(&now);
+	now_slot = sched_slot_of(sched, &now);
+
+	pj_mutex_lock(st->mutex);
+
+	/* After a long stall, one turn of the wheel visits all clocks */
+	if (now_slot > st->cur_slot + PJMEDIA_CLOCK_SCHED_WHEEL_SIZE)
+	    st->cur_slot = now_slot - PJMEDIA_CLOCK_SCHED_WHEEL_SIZE;
+
+	while (st->cur_slot < now_slot && !st->quitting) {
+	    sched_process_slot(st, st->cur_slot, &now);
+	    st->cur_slot++;
+	}
+
+	pj_mutex_unlock(st->mutex);
+    }
+
+    return 0;
+}
+
+/* Start running the clock in the scheduler */
+static pj_status_t sched_add_clock(pjmedia_clock_sched *sched,
+				   pjmedia_clock *clock)
+{
+    sched_thread *st = &sched->threads[0];
+    pj_timestamp now;
+    pj_uint64_t first, span, slot, best;
+    unsigned i, best_cnt;
+
+    /* Use the least loaded thread */
+    for (i = 1; i < sched->thread_cnt; ++i) {
+	if (sched->threads[i].clock_cnt < st->clock_cnt)
+	    st = &sched->threads[i];
+    }
+
+    pj_mutex_lock(st->mutex);
+
+    /* Put the first tick in the least used slot within one interval, to
+     * spread the clocks evenly across the interval.
+     */
+    pj_get_timestamp(&now);
+    first = sched_slot_of(sched, &now) + 1;
+    if (first < st->cur_slot)
+	first = st->cur_slot;
+
+    span = (clock->interval.u64 + sched->slot_ticks - 1) / sched->slot_ticks;
+    if (span == 0)
+	span = 1;
+    else if (span > PJMEDIA_CLOCK_SCHED_WHEEL_SIZE)
+	span = PJMEDIA_CLOCK_SCHED_WHEEL_SIZE;
+
+    /* All threads count from the same base time, so their slots are
+     * aligned. The slot counts of the other threads are read without
+     * their locks, which is fine for picking a phase.
+     */
+    best = first;
+    best_cnt = (unsigned)-1;
+    for (slot = first; slot < first + span; ++slot) {
+	unsigned idx = (unsigned)(slot % PJMEDIA_CLOCK_SCHED_WHEEL_SIZE);
+	unsigned cnt = 0;
+
+	for (i = 0; i < sched->thread_cnt; ++i)
+	    cnt += sched->threads[i].slot_cnt[idx];
+
+	if (cnt < best_cnt) {
+	    best = slot;
+	    best_cnt = cnt;
+	}
+    }
+
+    clock->next_tick.u64 = sched->base.u64 + best * sched->slot_ticks;
+    clock->sched_thread = st;
+    sched_queue_clock(st, clock, best);
+    st->clock_cnt++;
+
+    pj_mutex_unlock(st->mutex);
+
+    return PJ_SUCCESS;
+}
+
+/* Check if the calling thread is one of the scheduler threads */
+static pj_bool_t sched_is_own_thread(pjmedia_clock_sched *sched)
+{
+    pj_thread_t *this_thread = pj_thread_this();
+    unsigned i;
+
+    for (i = 0; i < sched->thread_cnt; ++i) {
+	if (sched->threads[i].thread == this_thread)
+	    return PJ_TRUE;
+    }
+    return PJ_FALSE;
+}
+
+/* Stop running the clock in the scheduler. If its callback is being
+ * called, wait until it returns, unless this is called from a callback:
+ * the clock may be stopping itself, or the clock being stopped may be
+ * stopping the clock of the caller.
+ */
+static void sched_remove_clock(pjmedia_clock *clock)
+{
+    sched_thread *st = clock->sched_thread;
+    pj_bool_t wait_cb = PJ_FALSE;
+
+    pj_mutex_lock(st->mutex);
+
+    if (clock->sched_thread == st) {
+	if (clock->sched_state == SCHED_IN_WHEEL) {
+	    unsigned idx = (unsigned)
+			   (clock->sched_slot % PJMEDIA_CLOCK_SCHED_WHEEL_SIZE);
+	    pj_list_erase(clock);
+	    st->slot_cnt[idx]--;
+	} else if (clock->sched_state == SCHED_IN_DUE) {
+	    pj_list_erase(clock);
+	} else if (clock->sched_state == SCHED_IN_CB &&
+		   !sched_is_own_thread(st->sched))
+	{
+	    st->cb_waiters++;
+	    wait_cb = PJ_TRUE;
+	}
+	clock->sched_state = SCHED_NONE;
+	clock->sched_thread = NULL;
+	st->clock_cnt--;
+    }
+
+    pj_mutex_unlock(st->mutex);
+
+    if (wait_cb)
+	pj_sem_wait(st->cb_sem);
+}
+
+
+/*
+ * Create clock scheduler.
+ */
+PJ_DEF(pj_status_t) pjmedia_clock_sched_create(pj_pool_t *pool,
+					       unsigned thread_cnt,
+					       unsigned options,
+					       pjmedia_clock_sched **p_sched)
+{
+    pjmedia_clock_sched *sched;
+    unsigned i, j;
+    pj_status_t status;
+
+    PJ_ASSERT_RETURN(pool && p_sched, PJ_EINVAL);
+
+    if (thread_cnt == 0)
+	thread_cnt = pj_get_cpu_count();
+
+    sched = PJ_POOL_ZALLOC_T(pool, pjmedia_clock_sched);
+    sched->pool = pj_pool_create(pool->factory, "clksched%p", 1024, 1024,
+				 NULL);
+    sched->options = options;
+
+    status = pj_get_timestamp_freq(&sched->freq);
+    if (status != PJ_SUCCESS)
+	goto on_error;
+
+    sched->slot_ticks = PJMEDIA_CLOCK_SCHED_SLOT_USEC * sched->freq.u64 /
+			USEC_IN_SEC;
+    if (sched->slot_ticks == 0)
+	sched->slot_ticks = 1;
+    pj_get_timestamp(&sched->base);
+
+    sched->threads = (sched_thread*)
+		     pj_pool_calloc(sched->pool, thread_cnt,
+				    sizeof(sched_thread));
+
+    for (i = 0; i < thread_cnt; ++i) {
+	sched_thread *st = &sched->threads[i];
+
+	st->sched = sched;
+	for (j = 0; j < PJMEDIA_CLOCK_SCHED_WHEEL_SIZE; ++j)
+	    pj_list_init(&st->wheel[j]);
+
+#if PJMEDIA_CLOCK_SCHED_USE_TIMERFD
+	/* Periodic timer at the slot boundaries. If it cannot be created,
+	 * the thread falls back to sleeping.
+	 */
+	st->tfd = timerfd_create(CLOCK_MONOTONIC, 0);
+	if (st->tfd >= 0) {
+	    struct itimerspec its;
+	    pj_timestamp now, next;
+	    unsigned usec;
+
+	    pj_get_timestamp(&now);
+	    next.u64 = sched->base.u64 +
+		       (sched_slot_of(sched, &now) + 1) * sched->slot_ticks;
+	    usec = pj_elapsed_usec(&now, &next);
+	    if (usec == 0)
+		usec = 1;
+
+	    its.it_value.tv_sec = usec / 1000000;
+	    its.it_value.tv_nsec = (usec % 1000000) * 1000;
+	    its.it_interval.tv_sec = PJMEDIA_CLOCK_SCHED_SLOT_USEC / 1000000;
+	    its.it_interval.tv_nsec = (PJMEDIA_CLOCK_SCHED_SLOT_USEC%1000000) *
+				      1000;
+	    if (timerfd_settime(st->tfd, 0, &its, NULL) != 0) {
+		close(st->tfd);
+		st->tfd = -1;
+	    }
+	}
+#endif
+
+	status = pj_mutex_create_recursive(sched->pool, "clksched",
+					   &st->mutex);
+	if (status != PJ_SUCCESS)
+	    goto on_error;
+
+	status = pj_sem_create(sched->pool, "clksched", 0, PJ_MAXINT32,
+			       &st->cb_sem);
+	if (status != PJ_SUCCESS)
+	    goto on_error;
+
+	status = pj_thread_create(sched->pool, "clksched%p",
+				  &sched_thread_proc, st, 0, 0, &st->thread);
+	if (status != PJ_SUCCESS)
+	    goto on_error;
+
+	++sched->thread_cnt;
+    }
+
+    *p_sched = sched;
+    return PJ_SUCCESS;
+
+on_error:
+    /* Clean up the thread which failed half way too */
+    if (sched->threads && sched->thread_cnt < thread_cnt)
+	++sched->thread_cnt;
+    pjmedia_clock_sched_destroy(sched);
+    return status;
+}
+
+
+/*
+ * Get number of running clocks.
+ */
+PJ_DEF(unsigned) pjmedia_clock_sched_get_clock_count(
+					    pjmedia_clock_sched *sched)
+{
+    unsigned i, cnt = 0;
+
+    PJ_ASSERT_RETURN(sched, 0);
+
+    for (i = 0; i < sched->thread_cnt; ++i)
+	cnt += sched->threads[i].clock_cnt;
+
+    return cnt;
+}
+
+
+/*
+ * Destroy clock scheduler.
+ */
+PJ_DEF(pj_status_t) pjmedia_clock_sched_destroy(pjmedia_clock_sched *sched)
+{
+    unsigned i, j;
+
+    PJ_ASSERT_RETURN(sched, PJ_EINVAL);
+
+    for (i = 0; i < sched->thread_cnt; ++i) {
+	sched_thread *st = &sched->threads[i];
+
+	st->quitting = PJ_TRUE;
+	if (st->thread) {
+	    pj_thread_join(st->thread);
+	    pj_thread_destroy(st->thread);
+	    st->thread = NULL;
+	}
+
+	/* Stop the clocks which are still running */
+	for (j = 0; j < PJMEDIA_CLOCK_SCHED_WHEEL_SIZE; ++j) {
+	    while (!pj_list_empty(&st->wheel[j])) {
+		pjmedia_clock *clock = st->wheel[j].next;
+
+		pj_list_erase(clock);
+		clock->sched_state = SCHED_NONE;
+		clock->sched_thread = NULL;
+		clock->sched = NULL;
+		clock->running = PJ_FALSE;
+	    }
+	}
+	st->clock_cnt = 0;
+
+	if (st->mutex) {
+	    pj_mutex_destroy(st->mutex);
+	    st->mutex = NULL;
+	}
+
+	if (st->cb_sem) {
+	    pj_sem_destroy(st->cb_sem);
+	    st->cb_sem = NULL;
+	}
+
+#if PJMEDIA_CLOCK_SCHED_USE_TIMERFD
+	if (st->tfd >= 0) {
+	    close(st->tfd);
+	    st->tfd = -1;
+	}
+#endif
+    }
+
+    if (sched->pool) {
+	pj_pool_t *pool = sched->pool;
+	sched->pool = NULL;
+	pj_pool_release(pool);
+    }
+
+    return PJ_SUCCESS;
+}
@@ -23,6 +23,7 @@
 #include <pjmedia/errno.h>
 #include <pjmedia/port.h>
 #include <pjmedia/resample.h>
+#include <pjmedia/signal_ops.h>
 #include <pjmedia/silencedet.h>
 #include <pjmedia/sound_port.h>
 #include <pjmedia/stereo.h>
@@ -91,6 +92,16 @@ static FILE *fhnd_rec;
 
 #define IS_OVERFLOW(s) ((s > MAX_LEVEL) || (s < MIN_LEVEL))
 
+/* Duration of silence to be passed through a resampler before the rest
+ * of the silence can be skipped. It must be longer than the resampler
+ * filter, so that the filter history becomes all zero.
+ */
+#define SILENCE_FLUSH_MSEC  50
+
+/* Convert adjustment level (NORMAL_LEVEL is unity) to signal gain */
+#define ADJ_TO_GAIN(adj)    ((unsigned)(adj) * \
+			     (PJMEDIA_SIGNAL_GAIN_UNITY / NORMAL_LEVEL))
+
 
 /*
  * DON'T GET CONFUSED WITH TX/RX!!
@@ -150,6 +161,8 @@ struct conf_port
     pj_int16_t		*rx_buf;	/**< The RX buffer.		    */
     unsigned		 rx_buf_cap;	/**< Max size, in samples	    */
     unsigned		 rx_buf_count;	/**< # of samples in the buf.	    */
+    unsigned		 rx_silence;	/**< Duration of silence given to
+					     rx_resample, in msec.	    */
 
     /* Mix buf is a temporary buffer used to mix all signal received
      * by this port from all other ports. The mixed signal will be 
@@ -163,6 +176,18 @@ struct conf_port
     int			 mix_adj;	/**< Adjustment level for mix_buf.  */
     int			 last_mix_adj;	/**< Last adjustment level.	    */
     pj_int32_t		*mix_buf;	/**< Total sum of signal.	    */
+    unsigned		 mix_cnt;	/**< Number of signals in mix_buf.  */
+
+    /* With PJMEDIA_CONF_VAD, the signal received from the port is passed
+     * to the silence detector, and it's not mixed while it is silent.
+     * When none of the transmitters of a port has signal, the port
+     * receives SILENCE_FLUSH_MSEC of silence and then NULL frames, like
+     * when it has no transmitter, so a stream doesn't encode silence and
+     * the resampling is skipped.
+     */
+    pjmedia_silence_det	*vad;		/**< Silence detector, or NULL.	    */
+    unsigned		 tx_silence;	/**< Duration of silence sent to the
+					     port, in msec.		    */
 
     /* Tx buffer is a temporary buffer to be used when there's mismatch 
      * between port's clock rate or ptime with conference's sample rate
@@ -235,6 +260,7 @@ struct pjmedia_conf
     unsigned		  channel_count;/**< Number of channels (1=mono).   */
     unsigned		  samples_per_frame;	/**< Samples per frame.	    */
     unsigned		  bits_per_sample;	/**< Bits per sample.	    */
+    unsigned		  ptime;	/**< Frame time, in msec.	    */
 };
 
 
@@ -404,6 +430,16 @@ static pj_status_t create_conf_port( pj_pool_t *pool,
     PJ_ASSERT_RETURN(conf_port->mix_buf, PJ_ENOMEM);
     conf_port->last_mix_adj = NORMAL_LEVEL;
 
+    /* Create silence detector for the signal received from the port. */
+    if (conf->options & PJMEDIA_CONF_VAD) {
+	status = pjmedia_silence_det_create(pool, conf->clock_rate,
+					    conf->samples_per_frame /
+					      conf->channel_count,
+					    &conf_port->vad);
+	if (status != PJ_SUCCESS)
+	    return status;
+    }
+
 
     /* Done */
     *p_conf_port = conf_port;
@@ -552,6 +588,9 @@ PJ_DEF(pj_status_t) pjmedia_conf_create( pj_pool_t *pool,
     conf->clock_rate = clock_rate;
     conf->channel_count = channel_count;
     conf->samples_per_frame = samples_per_frame;
+    conf->ptime = samples_per_frame * 1000 / channel_count / clock_rate;
+    if (conf->ptime == 0)
+	conf->ptime = 1;
     conf->bits_per_sample = bits_per_sample;
 
     
@@ -1461,14 +1500,25 @@ static pj_status_t read_port( pjmedia_conf *conf,
 	    }
 
 	    if (f.type != PJMEDIA_FRAME_TYPE_AUDIO) {
+		unsigned cnt = cport->samples_per_frame;
+
 		TRACE_((THIS_FILE, "  get_frame returned non-audio"));
-		pjmedia_zero_samples( cport->rx_buf + cport->rx_buf_count,
-				      cport->samples_per_frame);
-	    } else {
-		/* We've got at least one frame */
-		*type = PJMEDIA_FRAME_TYPE_AUDIO;
+
+		/* Put silence in the bridge's channel count */
+		if (cport->channel_count != conf->channel_count) {
+		    if (cport->channel_count == 1)
+			cnt *= conf->channel_count;
+		    else
+			cnt /= cport->channel_count;
+		}
+		pjmedia_zero_samples(cport->rx_buf + cport->rx_buf_count, cnt);
+		cport->rx_buf_count += cnt;
+		continue;
 	    }
 
+	    /* We've got at least one frame */
+	    *type = PJMEDIA_FRAME_TYPE_AUDIO;
+
 	    /* Adjust channels */
 	    if (cport->channel_count != conf->channel_count) {
 		if (cport->channel_count == 1) {
@@ -1509,7 +1559,17 @@ static pj_status_t read_port( pjmedia_conf *conf,
 	    TRACE_((THIS_FILE, "  resample, input count=%d", 
 		    pjmedia_resample_get_input_size(cport->rx_resample)));
 
-	    pjmedia_resample_run( cport->rx_resample,cport->rx_buf, frame);
+	    /* The caller ignores the frame if it's silent. Resample the
+	     * beginning of the silence only, to clear the resampler
+	     * history, and skip the rest.
+	     */
+	    if (*type == PJMEDIA_FRAME_TYPE_AUDIO) {
+		pjmedia_resample_run( cport->rx_resample,cport->rx_buf, frame);
+		cport->rx_silence = 0;
+	    } else if (cport->rx_silence < SILENCE_FLUSH_MSEC) {
+		pjmedia_resample_run( cport->rx_resample,cport->rx_buf, frame);
+		cport->rx_silence += conf->ptime;
+	    }
 
 	    src_count = (unsigned)(count * 1.0 * cport->clock_rate / 
 				   conf->clock_rate + 0.5);
@@ -1545,18 +1605,42 @@ static pj_status_t write_port(pjmedia_conf *conf, struct conf_port *cport,
 			      pjmedia_frame_type *frm_type)
 {
     pj_int16_t *buf;
-    unsigned j, ts;
+    unsigned ts;
     pj_status_t status;
     pj_int32_t adj_level;
     pj_int32_t tx_level;
     unsigned dst_count;
+    pj_bool_t no_signal = PJ_FALSE;
 
     *frm_type = PJMEDIA_FRAME_TYPE_AUDIO;
 
+    /* If none of the transmitters had signal in this frame, the port
+     * gets silence. With PJMEDIA_CONF_VAD, the silence is sent only until
+     * the resampler has been flushed, then the port is treated as if
+     * nobody is transmitting to it.
+     */
+    if (cport->mix_cnt == 0) {
+	if ((conf->options & PJMEDIA_CONF_VAD) &&
+	    cport->tx_silence >= SILENCE_FLUSH_MSEC)
+	{
+	    no_signal = PJ_TRUE;
+	} else if (cport->transmitter_cnt &&
+		   cport->tx_setting == PJMEDIA_PORT_ENABLE)
+	{
+	    pj_bzero(cport->mix_buf,
+		     conf->samples_per_frame*sizeof(cport->mix_buf[0]));
+	    cport->tx_silence += conf->ptime;
+	}
+    } else {
+	cport->tx_silence = 0;
+    }
+
     /* If port is muted or nobody is transmitting to this port, 
      * transmit NULL frame. 
      */
-    if (cport->tx_setting == PJMEDIA_PORT_MUTE || cport->transmitter_cnt==0) {
+    if (cport->tx_setting == PJMEDIA_PORT_MUTE || cport->transmitter_cnt==0 ||
+	no_signal)
+    {
 
 	pjmedia_frame frame;
 
@@ -1630,31 +1714,13 @@ static pj_status_t write_port(pjmedia_conf *conf, struct conf_port *cport,
     adj_level = cport->tx_adj_level * cport->mix_adj;
     adj_level >>= 7;
 
-    tx_level = 0;
-
-    if (adj_level != NORMAL_LEVEL) {
-	for (j=0; j<conf->samples_per_frame; ++j) {
-	    pj_int32_t itemp = cport->mix_buf[j];
-
-	    /* Adjust the level */
-	    /*itemp = itemp * adj_level / NORMAL_LEVEL;*/
-	    itemp = (itemp * adj_level) >> 7;
-
-	    /* Clip the signal if it's too loud */
-	    if (itemp > MAX_LEVEL) itemp = MAX_LEVEL;
-	    else if (itemp < MIN_LEVEL) itemp = MIN_LEVEL;
-
-	    /* Put back in the buffer. */
-	    buf[j] = (pj_int16_t) itemp;
-
-	    tx_level += (buf[j]>=0? buf[j] : -buf[j]);
-	}
-    } else {
-	for (j=0; j<conf->samples_per_frame; ++j) {
-	    buf[j] = (pj_int16_t) cport->mix_buf[j];
-	    tx_level += (buf[j]>=0? buf[j] : -buf[j]);
-	}
-    }
+    /* Convert the mixed samples to 16bit in place, adjusting the level
+     * and clipping the signal if it's too loud, and calculate the
+     * signal level at the same time.
+     */
+    tx_level = pjmedia_signal_apply_gain32(buf, cport->mix_buf,
+					   conf->samples_per_frame,
+					   ADJ_TO_GAIN(adj_level));
 
     tx_level /= conf->samples_per_frame;
 
@@ -1785,7 +1851,7 @@ static pj_status_t get_frame(pjmedia_port *this_port,
 {
     pjmedia_conf *conf = (pjmedia_conf*) this_port->port_data.pdata;
     pjmedia_frame_type speaker_frame_type = PJMEDIA_FRAME_TYPE_NONE;
-    unsigned ci, cj, i, j;
+    unsigned ci, cj, i;
     pj_int16_t *p_in;
     
     TRACE_((THIS_FILE, "- clock -"));
@@ -1797,8 +1863,9 @@ static pj_status_t get_frame(pjmedia_port *this_port,
     /* Must lock mutex */
     pj_mutex_lock(conf->mutex);
 
-    /* Reset port source count. We will only reset port's mix
-     * buffer when we have someone transmitting to it.
+    /* Reset port source count. The mix buffer is overwritten by the
+     * first signal mixed to it, or cleared by write_port() when there
+     * is none.
      */
     for (i=0, ci=0; i<conf->max_ports && ci < conf->port_cnt; ++i) {
 	struct conf_port *conf_port = conf->ports[i];
@@ -1810,14 +1877,11 @@ static pj_status_t get_frame(pjmedia_port *this_port,
 	/* Var "ci" is to count how many ports have been visited so far. */
 	++ci;
 
-	/* Reset buffer (only necessary if the port has transmitter) and
-	 * reset auto adjustment level for mixed signal.
+	/* Reset mixed signal count and auto adjustment level for mixed
+	 * signal.
 	 */
 	conf_port->mix_adj = NORMAL_LEVEL;
-	if (conf_port->transmitter_cnt) {
-	    pj_bzero(conf_port->mix_buf,
-		     conf->samples_per_frame*sizeof(conf_port->mix_buf[0]));
-	}
+	conf_port->mix_cnt = 0;
     }
 
     /* Get frames from all ports, and "mix" the signal 
@@ -1826,6 +1890,7 @@ static pj_status_t get_frame(pjmedia_port *this_port,
     for (i=0, ci=0; i < conf->max_ports && ci < conf->port_cnt; ++i) {
 	struct conf_port *conf_port = conf->ports[i];
 	pj_int32_t level = 0;
+	pj_bool_t silent;
 
 	/* Skip empty port. */
 	if (!conf_port)
@@ -1884,8 +1949,10 @@ static pj_status_t get_frame(pjmedia_port *this_port,
 		continue;
 
 	    /* Ignore if we didn't get any frame */
-	    if (frame_type != PJMEDIA_FRAME_TYPE_AUDIO)
+	    if (frame_type != PJMEDIA_FRAME_TYPE_AUDIO) {
+		conf_port->rx_level = 0;
 		continue;
+	    }
 	}
 
 	p_in = (pj_int16_t*) frame->buf;
@@ -1894,42 +1961,29 @@ static pj_status_t get_frame(pjmedia_port *this_port,
 	 * and calculate the average level at the same time.
 	 */
 	if (conf_port->rx_adj_level != NORMAL_LEVEL) {
-	    for (j=0; j<conf->samples_per_frame; ++j) {
-		/* For the level adjustment, we need to store the sample to
-		 * a temporary 32bit integer value to avoid overflowing the
-		 * 16bit sample storage.
-		 */
-		pj_int32_t itemp;
-
-		itemp = p_in[j];
-		/*itemp = itemp * adj / NORMAL_LEVEL;*/
-		/* bad code (signed/unsigned badness):
-		 *  itemp = (itemp * conf_port->rx_adj_level) >> 7;
-		 */
-		itemp *= conf_port->rx_adj_level;
-		itemp >>= 7;
-
-		/* Clip the signal if it's too loud */
-		if (itemp > MAX_LEVEL) itemp = MAX_LEVEL;
-		else if (itemp < MIN_LEVEL) itemp = MIN_LEVEL;
+	    unsigned gain = ADJ_TO_GAIN(conf_port->rx_adj_level);
 
-		p_in[j] = (pj_int16_t) itemp;
-		level += (p_in[j]>=0? p_in[j] : -p_in[j]);
-	    }
+	    level = pjmedia_signal_apply_gain(p_in, conf->samples_per_frame,
+					      gain);
 	} else {
-	    for (j=0; j<conf->samples_per_frame; ++j) {
-		level += (p_in[j]>=0? p_in[j] : -p_in[j]);
-	    }
+	    level = pjmedia_signal_sum_abs(p_in, conf->samples_per_frame);
 	}
 
 	level /= conf->samples_per_frame;
 
+	/* Don't mix the signal while the port is silent */
+	silent = conf_port->vad &&
+		 pjmedia_silence_det_apply(conf_port->vad, level);
+
 	/* Convert level to 8bit complement ulaw */
 	level = pjmedia_linear2ulaw(level) ^ 0xff;
 
 	/* Put this level to port's last RX level. */
 	conf_port->rx_level = level;
 
+	if (silent)
+	    continue;
+
 	// Ticket #671: Skipping very low audio signal may cause noise 
 	// to be generated in the remote end by some hardphones.
 	/* Skip processing frame if level is zero */
@@ -1951,7 +2005,7 @@ static pj_status_t get_frame(pjmedia_port *this_port,
 
 	    mix_buf = listener->mix_buf;
 
-	    if (listener->transmitter_cnt > 1) {
+	    if (listener->mix_cnt++ > 0) {
 		/* Mixing signals,
 		 * and calculate appropriate level adjustment if there is
 		 * any overflowed level in the mixed signal.
@@ -1970,7 +2024,7 @@ static pj_status_t get_frame(pjmedia_port *this_port,
 		    } /* if any overflow in the mixed signals */
 		} /* loop mixing signals */
 	    } else {
-		/* Only 1 transmitter:
+		/* First transmitter:
 		 * just copy the samples to the mix buffer
 		 * no mixing and level adjustment needed
 		 */
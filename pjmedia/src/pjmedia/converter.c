@@ -36,7 +36,7 @@ pjmedia_libswscale_converter_init(pjmedia_converter_mgr *mgr);
 
 #if defined(PJMEDIA_HAS_LIBYUV) && PJMEDIA_HAS_LIBYUV != 0
 PJ_DECL(pj_status_t)
-pjmedia_libyuv_converter_init(pjmedia_converter_mgr *mgr);
+pjmedia_libyuv_converter_init(pjmedia_converter_mgr *mgr, pj_pool_t *pool);
 #endif
 
 PJ_DEF(pj_status_t) pjmedia_converter_mgr_create(pj_pool_t *pool,
@@ -52,7 +52,7 @@ PJ_DEF(pj_status_t) pjmedia_converter_mgr_create(pj_pool_t *pool,
 	converter_manager_instance = mgr;
 
 #if defined(PJMEDIA_HAS_LIBYUV) && PJMEDIA_HAS_LIBYUV != 0
-    status = pjmedia_libyuv_converter_init(mgr);
+    status = pjmedia_libyuv_converter_init(mgr, pool);
     if (status != PJ_SUCCESS) {
 	PJ_PERROR(4,(THIS_FILE, status,
 		     "Error initializing libyuv converter"));
@@ -18,12 +18,19 @@
  */
 
 #include <pjmedia/converter.h>
+#include <pj/assert.h>
 #include <pj/errno.h>
+#include <pj/list.h>
+#include <pj/log.h>
+#include <pj/os.h>
+#include <pj/pool.h>
 
 #if defined(PJMEDIA_HAS_LIBYUV) && PJMEDIA_HAS_LIBYUV != 0
 
 #include  <libyuv.h>
 
+#define THIS_FILE   "converter_libyuv.c"
+
 static pj_status_t factory_create_converter(pjmedia_converter_factory *cf,
 					    pj_pool_t *pool,
 					    const pjmedia_conversion_param*prm,
@@ -61,6 +68,8 @@ typedef enum conv_func_type
     CONV_PACK_TO_PLANAR,
     CONV_PLANAR_TO_PACK,
     CONV_PLANAR_TO_PLANAR,
+    CONV_SEMIPLANAR_TO_PLANAR,
+    CONV_PLANAR_TO_SEMIPLANAR,
     SCALE_PACK,
     SCALE_PLANAR
 } conv_func_type;
@@ -91,21 +100,34 @@ typedef int (*conv_planar_to_planar_method)(const uint8* src1, int src_stride1,
 					    uint8* dst3, int dst_stride3,
 					    int width, int height);
 
+typedef int (*conv_semiplanar_to_planar_method)(
+					    const uint8* src1, int src_stride1,
+					    const uint8* src2, int src_stride2,
+					    uint8* dst1, int dst_stride1,
+					    uint8* dst2, int dst_stride2,
+					    uint8* dst3, int dst_stride3,
+					    int width, int height);
+
+typedef int (*conv_planar_to_semiplanar_method)(
+					    const uint8* src1, int src_stride1,
+					    const uint8* src2, int src_stride2,
+					    const uint8* src3, int src_stride3,
+					    uint8* dst1, int dst_stride1,
+					    uint8* dst2, int dst_stride2,
+					    int width, int height);
+
 typedef int  (*scale_pack_method)
 	     (const uint8* src_argb, int src_stride_argb,
               int src_width, int src_height,
               uint8* dst_argb, int dst_stride_argb,
               int dst_width, int dst_height,
+              int clip_x, int clip_y, int clip_width, int clip_height,
               enum FilterMode filtering);
 
-typedef int (*scale_planar_method)	
-	    (const uint8* src_y, int src_stride_y,
-             const uint8* src_u, int src_stride_u,
-             const uint8* src_v, int src_stride_v,
+typedef void (*scale_planar_method)	
+	    (const uint8* src, int src_stride,
              int src_width, int src_height,
-             uint8* dst_y, int dst_stride_y,
-             uint8* dst_u, int dst_stride_u,
-             uint8* dst_v, int dst_stride_v,
+             uint8* dst, int dst_stride,
              int dst_width, int dst_height,
              enum FilterMode filtering);
 
@@ -115,6 +137,8 @@ typedef union act_method
     conv_pack_to_planar_method	    conv_pack_to_planar;
     conv_planar_to_pack_method	    conv_planar_to_pack;
     conv_planar_to_planar_method    conv_planar_to_planar;
+    conv_semiplanar_to_planar_method conv_semiplanar_to_planar;
+    conv_planar_to_semiplanar_method conv_planar_to_semiplanar;
     scale_pack_method		    scale_pack;
     scale_planar_method		    scale_planar;    
 } act_method;
@@ -139,7 +163,7 @@ typedef struct fmt_convert_map {
 #   define LIBYUV_FILTER_MODE 3
 #endif
 
-#define METHOD_IS_SCALE(mtd) mtd>CONV_PLANAR_TO_PLANAR
+#define METHOD_IS_SCALE(mtd) ((mtd)>=SCALE_PACK)
 
 /* Macro to help define format conversion table. */
 #define GET_PJ_FORMAT(fmt) PJMEDIA_FORMAT_##fmt
@@ -152,6 +176,10 @@ typedef struct fmt_convert_map {
         GET_PJ_FORMAT(dst),CONV_PLANAR_TO_PACK,(gen_conv_func)&method
 #define MAP_CONV_PLANAR_TO_PLANAR(src,dst,method) GET_PJ_FORMAT(src),\
         GET_PJ_FORMAT(dst),CONV_PLANAR_TO_PLANAR,(gen_conv_func)&method
+#define MAP_CONV_SEMIPLANAR_TO_PLANAR(src,dst,method) GET_PJ_FORMAT(src),\
+        GET_PJ_FORMAT(dst),CONV_SEMIPLANAR_TO_PLANAR,(gen_conv_func)&method
+#define MAP_CONV_PLANAR_TO_SEMIPLANAR(src,dst,method) GET_PJ_FORMAT(src),\
+        GET_PJ_FORMAT(dst),CONV_PLANAR_TO_SEMIPLANAR,(gen_conv_func)&method
 #define MAP_SCALE_PACK(fmt,method) GET_PJ_FORMAT(fmt),\
         GET_PJ_FORMAT(fmt),SCALE_PACK,(gen_conv_func)&method
 #define MAP_SCALE_PLANAR(fmt,method) GET_PJ_FORMAT(fmt),\
@@ -164,7 +192,9 @@ static fmt_convert_map conv_to_i420[] =
     {MAP_CONV_PACK_TO_PLANAR(BGRA,I420,ARGBToI420)},
     {MAP_CONV_PACK_TO_PLANAR(YUY2,I420,YUY2ToI420)},
     {MAP_CONV_PACK_TO_PLANAR(UYVY,I420,UYVYToI420)},
-    {MAP_CONV_PLANAR_TO_PLANAR(I422,I420,I422ToI420)}    
+    {MAP_CONV_PLANAR_TO_PLANAR(I422,I420,I422ToI420)},
+    {MAP_CONV_SEMIPLANAR_TO_PLANAR(NV12,I420,NV12ToI420)},
+    {MAP_CONV_SEMIPLANAR_TO_PLANAR(NV21,I420,NV21ToI420)}
 };
 
 static fmt_convert_map conv_from_i420[] = 
@@ -175,7 +205,9 @@ static fmt_convert_map conv_from_i420[] =
     {MAP_CONV_PLANAR_TO_PACK(I420,YUY2,I420ToYUY2)},
     {MAP_CONV_PLANAR_TO_PACK(I420,UYVY,I420ToUYVY)},
     {MAP_CONV_PLANAR_TO_PLANAR(I420,I422,I420ToI422)},
-    {MAP_SCALE_PLANAR(I420,I420Scale)}
+    {MAP_CONV_PLANAR_TO_SEMIPLANAR(I420,NV12,I420ToNV12)},
+    {MAP_CONV_PLANAR_TO_SEMIPLANAR(I420,NV21,I420ToNV21)},
+    {MAP_SCALE_PLANAR(I420,ScalePlane)}
 };
 
 static fmt_convert_map conv_to_bgra[] = 
@@ -196,7 +228,7 @@ static fmt_convert_map conv_from_bgra[] =
     {MAP_CONV_PACK_TO_PACK(BGRA,UYVY,ARGBToUYVY)},
     {MAP_CONV_PACK_TO_PLANAR(BGRA,I422,ARGBToI422)},
     {MAP_CONV_PACK_TO_PLANAR(BGRA,I420,ARGBToI420)},
-    {MAP_SCALE_PACK(BGRA,ARGBScale)}
+    {MAP_SCALE_PACK(BGRA,ARGBScaleClip)}
 };
 
 typedef struct converter_act 
@@ -207,13 +239,63 @@ typedef struct converter_act
     act_method		    method;
 } converter_act;
 
+/* Maximum number of slices a picture is divided into. */
+#define MAX_SLICES	    8
+
+/* Minimum number of rows of a slice. */
+#define MIN_SLICE_ROWS	    64
+
+struct libyuv_converter;
+
+/* A horizontal slice of an act, done by a worker or the calling thread. */
+typedef struct slice_job
+{
+    PJ_DECL_LIST_MEMBER(struct slice_job);
+    struct libyuv_converter		*lconv;
+    const converter_act			*act;
+    const struct fmt_info		*src_fmt_info;
+    const struct fmt_info		*dst_fmt_info;
+    unsigned				 row0;	    /* First dst row.	     */
+    unsigned				 row1;	    /* Last dst row + 1.     */
+    unsigned				 plane;	    /* Plane to scale.	     */
+    pj_bool_t				 queued;    /* Not taken yet?	     */
+} slice_job;
+
 struct libyuv_converter
 {
     pjmedia_converter 			 base;      
+    pj_pool_t				*pool;
+    struct libyuv_converter		*next;	    /* Next in the cache.    */
+    pj_uint32_t				 src_id;
+    pjmedia_rect_size			 src_size;
+    pj_uint32_t				 dst_id;
+    pjmedia_rect_size			 dst_size;
+    pj_sem_t				*done_sem;  /* Slices done by workers*/
+    slice_job				 job[MAX_SLICES];
     int					 act_num;
     converter_act			 act[MAXIMUM_ACT];
 };
 
+struct libyuv_factory
+{
+    pjmedia_converter_factory		 base;
+    pj_pool_t				*pool;
+    pj_mutex_t				*mutex;
+
+    /* Destroyed converters, kept for reuse. */
+    struct libyuv_converter		*cache;
+    unsigned				 cache_cnt;
+
+    /* Slice workers, started when the first converter is created. */
+    pj_thread_t				**thread;
+    unsigned				 thread_cnt;
+    pj_sem_t				*job_sem;
+    slice_job				 job_list;
+    pj_bool_t				 quit;
+};
+
+static struct libyuv_factory libyuv_factory;
+
 /* Find the matched format conversion map. */ 
 static pj_status_t get_converter_map(pj_uint32_t src_id, 
 		 		     pj_uint32_t dst_id,
@@ -276,6 +358,14 @@ static pj_status_t get_converter_map(pj_uint32_t src_id,
 	act[act_idx].method.conv_planar_to_planar = 
 				 (conv_planar_to_planar_method)map[i].conv_func;
 	break;
+    case CONV_SEMIPLANAR_TO_PLANAR:
+	act[act_idx].method.conv_semiplanar_to_planar =
+			     (conv_semiplanar_to_planar_method)map[i].conv_func;
+	break;
+    case CONV_PLANAR_TO_SEMIPLANAR:
+	act[act_idx].method.conv_planar_to_semiplanar =
+			     (conv_planar_to_semiplanar_method)map[i].conv_func;
+	break;
     case SCALE_PACK:
 	act[act_idx].method.scale_pack = (scale_pack_method)map[i].conv_func;
 	break;
@@ -345,7 +435,7 @@ static int set_converter_act(pj_uint32_t src_id,
     pj_bool_t need_scale = PJ_FALSE;
 
     /* Convert to I420 or BGRA if needed. */
-    if ((src_id != PJMEDIA_FORMAT_I420) || (src_id != PJMEDIA_FORMAT_BGRA)) {
+    if ((src_id != PJMEDIA_FORMAT_I420) && (src_id != PJMEDIA_FORMAT_BGRA)) {
 	pj_uint32_t next_id = get_next_conv_fmt(src_id);
         if (get_converter_map(src_id, next_id, src_size, dst_size, ++act_num, 
                               act) != PJ_SUCCESS)
@@ -360,6 +450,10 @@ static int set_converter_act(pj_uint32_t src_id,
     need_scale = ((src_size->w != dst_size->w) ||
 		  (src_size->h != dst_size->h));
 
+    /* Same format and size, let the scale method copy the picture. */
+    if (!act_num && current_id == dst_id)
+	need_scale = PJ_TRUE;
+
     if (need_scale) {
 	if (get_converter_map(current_id, current_id, src_size, dst_size, 
 			      ++act_num, act) != PJ_SUCCESS)
@@ -434,18 +528,302 @@ static pj_bool_t check_converter_act(const converter_act *act,
     return PJ_FALSE;
 }
 
+/* Get the planes of the picture, starting from the specified row. */
+static void get_slice_planes(const pjmedia_video_apply_fmt_param *param,
+			     unsigned row,
+			     pj_uint8_t *planes[])
+{
+    unsigned i;
+
+    for (i = 0; i < PJMEDIA_MAX_VIDEO_PLANES; ++i) {
+	if (param->planes[i] && param->strides[i] > 0 && row) {
+	    /* Chroma planes may have less rows than the picture. */
+	    pj_size_t plane_rows = param->plane_bytes[i] / param->strides[i];
+
+	    planes[i] = param->planes[i] + (row * plane_rows / param->size.h) *
+					   param->strides[i];
+	} else {
+	    planes[i] = param->planes[i];
+	}
+    }
+}
+
+/* Scale one plane of an I420 picture, as I420Scale() does. */
+static void scale_plane(const converter_act *act,
+			const struct fmt_info *src_fmt_info,
+			const struct fmt_info *dst_fmt_info,
+			unsigned plane)
+{
+    const pjmedia_video_apply_fmt_param *src = &src_fmt_info->apply_param;
+    const pjmedia_video_apply_fmt_param *dst = &dst_fmt_info->apply_param;
+    unsigned src_w = src->size.w, src_h = src->size.h;
+    unsigned dst_w = dst->size.w, dst_h = dst->size.h;
+
+    if (plane) {
+	src_w = (src_w + 1) / 2;
+	src_h = (src_h + 1) / 2;
+	dst_w = (dst_w + 1) / 2;
+	dst_h = (dst_h + 1) / 2;
+    }
+
+    (*act->method.scale_planar)(
+		      (const uint8*)src->planes[plane], src->strides[plane],
+		      src_w, src_h,
+		      dst->planes[plane], dst->strides[plane],
+		      dst_w, dst_h,
+		      LIBYUV_FILTER_MODE);
+}
+
+/* Run the act on the rows [row0, row1) of the picture. Packed scaling
+ * clips the full picture scale to the rows, libyuv reads the source rows
+ * needed by their filter. Planar scaling is only run on the whole picture.
+ */
+static void run_act(const converter_act *act,
+		    const struct fmt_info *src_fmt_info,
+		    const struct fmt_info *dst_fmt_info,
+		    unsigned row0,
+		    unsigned row1)
+{
+    const pjmedia_video_apply_fmt_param *src = &src_fmt_info->apply_param;
+    const pjmedia_video_apply_fmt_param *dst = &dst_fmt_info->apply_param;
+    pj_uint8_t *sp[PJMEDIA_MAX_VIDEO_PLANES];
+    pj_uint8_t *dp[PJMEDIA_MAX_VIDEO_PLANES];
+
+    pj_assert(act->act_type != SCALE_PLANAR ||
+	      (row0 == 0 && row1 == dst->size.h));
+
+    get_slice_planes(src, row0, sp);
+    get_slice_planes(dst, row0, dp);
+
+    switch (act->act_type) {
+    case CONV_PACK_TO_PACK:
+	(*act->method.conv_pack_to_pack)(
+			  (const uint8*)sp[0], src->strides[0],
+			  dp[0], dst->strides[0],
+			  dst->size.w, row1 - row0);
+	break;
+    case CONV_PACK_TO_PLANAR:
+	(*act->method.conv_pack_to_planar)(
+			  (const uint8*)sp[0], src->strides[0],
+			  dp[0], dst->strides[0],
+			  dp[1], dst->strides[1],
+			  dp[2], dst->strides[2],
+			  dst->size.w, row1 - row0);
+	break;
+    case CONV_PLANAR_TO_PACK:
+	(*act->method.conv_planar_to_pack)(
+			  (const uint8*)sp[0], src->strides[0],
+			  (const uint8*)sp[1], src->strides[1],
+			  (const uint8*)sp[2], src->strides[2],
+			  dp[0], dst->strides[0],
+			  dst->size.w, row1 - row0);
+	break;
+    case CONV_PLANAR_TO_PLANAR:
+	(*act->method.conv_planar_to_planar)(
+			  (const uint8*)sp[0], src->strides[0],
+			  (const uint8*)sp[1], src->strides[1],
+			  (const uint8*)sp[2], src->strides[2],
+			  dp[0], dst->strides[0],
+			  dp[1], dst->strides[1],
+			  dp[2], dst->strides[2],
+			  dst->size.w, row1 - row0);
+	break;
+    case CONV_SEMIPLANAR_TO_PLANAR:
+	(*act->method.conv_semiplanar_to_planar)(
+			  (const uint8*)sp[0], src->strides[0],
+			  (const uint8*)sp[1], src->strides[1],
+			  dp[0], dst->strides[0],
+			  dp[1], dst->strides[1],
+			  dp[2], dst->strides[2],
+			  dst->size.w, row1 - row0);
+	break;
+    case CONV_PLANAR_TO_SEMIPLANAR:
+	(*act->method.conv_planar_to_semiplanar)(
+			  (const uint8*)sp[0], src->strides[0],
+			  (const uint8*)sp[1], src->strides[1],
+			  (const uint8*)sp[2], src->strides[2],
+			  dp[0], dst->strides[0],
+			  dp[1], dst->strides[1],
+			  dst->size.w, row1 - row0);
+	break;
+    case SCALE_PACK:
+	(*act->method.scale_pack)(
+			  (const uint8*)src->planes[0], src->strides[0],
+			  src->size.w, src->size.h,
+			  dst->planes[0], dst->strides[0],
+			  dst->size.w, dst->size.h,
+			  0, row0, dst->size.w, row1 - row0,
+			  LIBYUV_FILTER_MODE);
+	break;
+    case SCALE_PLANAR:
+	scale_plane(act, src_fmt_info, dst_fmt_info, 0);
+	scale_plane(act, src_fmt_info, dst_fmt_info, 1);
+	scale_plane(act, src_fmt_info, dst_fmt_info, 2);
+	break;
+    }
+}
+
+static void run_job(const slice_job *job)
+{
+    if (job->act->act_type == SCALE_PLANAR) {
+	scale_plane(job->act, job->src_fmt_info, job->dst_fmt_info,
+		    job->plane);
+    } else {
+	run_act(job->act, job->src_fmt_info, job->dst_fmt_info,
+		job->row0, job->row1);
+    }
+}
+
+/* Slice worker thread. */
+static int slice_worker(void *arg)
+{
+    struct libyuv_factory *f = (struct libyuv_factory*)arg;
+
+    for (;;) {
+	slice_job *job = NULL;
+	pj_bool_t quit;
+
+	pj_sem_wait(f->job_sem);
+
+	pj_mutex_lock(f->mutex);
+	quit = f->quit;
+	if (!quit && !pj_list_empty(&f->job_list)) {
+	    job = f->job_list.next;
+	    pj_list_erase(job);
+	    job->queued = PJ_FALSE;
+	}
+	pj_mutex_unlock(f->mutex);
+
+	if (quit)
+	    break;
+
+	if (job) {
+	    run_job(job);
+	    pj_sem_post(job->lconv->done_sem);
+	}
+    }
+
+    return 0;
+}
+
+/* Start the slice workers. Must be called with the factory mutex held. */
+static void start_workers(struct libyuv_factory *f)
+{
+    unsigned i;
+
+    f->thread = (pj_thread_t**)
+		pj_pool_calloc(f->pool, PJMEDIA_LIBYUV_THREAD_CNT,
+			       sizeof(pj_thread_t*));
+
+    for (i = 0; i < PJMEDIA_LIBYUV_THREAD_CNT; ++i) {
+	pj_status_t status;
+
+	status = pj_thread_create(f->pool, "yuvconv%p", &slice_worker, f,
+				  0, 0, &f->thread[f->thread_cnt]);
+	if (status != PJ_SUCCESS) {
+	    PJ_PERROR(4,(THIS_FILE, status,
+			 "Error creating libyuv slice worker"));
+	    break;
+	}
+	++f->thread_cnt;
+    }
+}
+
+/* Run the act on the whole picture. Large pictures are divided into
+ * horizontal slices, the workers take the slices from the queue while the
+ * calling thread does the first one, then the ones no worker has taken.
+ * Planar scaling is divided into its three planes instead: libyuv has no
+ * clipped planar scaler, and scaling a band of source rows on its own
+ * would change the filter phase of the band.
+ */
+static void run_act_sliced(struct libyuv_converter *lconv,
+			   const converter_act *act,
+			   const struct fmt_info *src_fmt_info,
+			   const struct fmt_info *dst_fmt_info)
+{
+    struct libyuv_factory *f = &libyuv_factory;
+    unsigned h = dst_fmt_info->apply_param.size.h;
+    unsigned cnt, i, taken = 0;
+
+    cnt = h / MIN_SLICE_ROWS;
+    if (cnt > f->thread_cnt + 1)
+	cnt = f->thread_cnt + 1;
+    if (cnt > MAX_SLICES)
+	cnt = MAX_SLICES;
+
+    if (cnt < 2 || !lconv->done_sem) {
+	run_act(act, src_fmt_info, dst_fmt_info, 0, h);
+	return;
+    }
+
+    if (act->act_type == SCALE_PLANAR)
+	cnt = 3;
+
+    for (i = 0; i < cnt; ++i) {
+	slice_job *job = &lconv->job[i];
+
+	job->lconv = lconv;
+	job->act = act;
+	job->src_fmt_info = src_fmt_info;
+	job->dst_fmt_info = dst_fmt_info;
+	job->row0 = i ? lconv->job[i-1].row1 : 0;
+	job->row1 = (i == cnt-1) ? h : ((h * (i+1) / cnt) & ~1U);
+	job->plane = i;
+	job->queued = (i > 0);
+    }
+
+    pj_mutex_lock(f->mutex);
+    for (i = 1; i < cnt; ++i)
+	pj_list_push_back(&f->job_list, &lconv->job[i]);
+    pj_mutex_unlock(f->mutex);
+
+    for (i = 1; i < cnt; ++i)
+	pj_sem_post(f->job_sem);
+
+    run_job(&lconv->job[0]);
+
+    for (i = 1; i < cnt; ++i) {
+	slice_job *job = &lconv->job[i];
+	pj_bool_t queued;
+
+	pj_mutex_lock(f->mutex);
+	queued = job->queued;
+	if (queued) {
+	    pj_list_erase(job);
+	    job->queued = PJ_FALSE;
+	}
+	pj_mutex_unlock(f->mutex);
+
+	if (queued)
+	    run_job(job);
+	else
+	    ++taken;
+    }
+
+    /* Wait for the slices taken by the workers. */
+    while (taken--)
+	pj_sem_wait(lconv->done_sem);
+}
+
+static void destroy_converter(struct libyuv_converter *lconv)
+{
+    if (lconv->done_sem)
+	pj_sem_destroy(lconv->done_sem);
+    pj_pool_release(lconv->pool);
+}
+
 static pj_status_t factory_create_converter(pjmedia_converter_factory *cf,
 					    pj_pool_t *pool,
 					    const pjmedia_conversion_param *prm,
 					    pjmedia_converter **p_cv)
 {
+    struct libyuv_factory *f = (struct libyuv_factory*)cf;
     const pjmedia_video_format_detail *src_detail, *dst_detail;
     const pjmedia_video_format_info *src_fmt_info, *dst_fmt_info;
-    struct libyuv_converter *lconv = NULL;
+    struct libyuv_converter *lconv = NULL, **p;
+    pj_pool_t *cpool;
     pj_status_t status = PJ_ENOTSUP;
 
-    PJ_UNUSED_ARG(cf);
-
     /* Only supports video */
     if (prm->src.type != PJMEDIA_TYPE_VIDEO ||
 	prm->dst.type != prm->src.type ||
@@ -473,35 +851,112 @@ static pj_status_t factory_create_converter(pjmedia_converter_factory *cf,
 
     src_detail = pjmedia_format_get_video_format_detail(&prm->src, PJ_TRUE);
     dst_detail = pjmedia_format_get_video_format_detail(&prm->dst, PJ_TRUE);
-    
-    lconv = PJ_POOL_ZALLOC_T(pool, struct libyuv_converter);
+
+    /* Reuse a cached converter with the same formats and sizes. */
+    pj_mutex_lock(f->mutex);
+    for (p = &f->cache; *p; p = &(*p)->next) {
+	if ((*p)->src_id == src_fmt_info->id &&
+	    (*p)->src_size.w == src_detail->size.w &&
+	    (*p)->src_size.h == src_detail->size.h &&
+	    (*p)->dst_id == dst_fmt_info->id &&
+	    (*p)->dst_size.w == dst_detail->size.w &&
+	    (*p)->dst_size.h == dst_detail->size.h)
+	{
+	    lconv = *p;
+	    *p = lconv->next;
+	    --f->cache_cnt;
+	    break;
+	}
+    }
+    if (!lconv && !f->thread && PJMEDIA_LIBYUV_THREAD_CNT > 0)
+	start_workers(f);
+    pj_mutex_unlock(f->mutex);
+
+    if (lconv) {
+	lconv->next = NULL;
+	*p_cv = &lconv->base;
+	return PJ_SUCCESS;
+    }
+
+    /* The converter has its own pool, so that it can outlive the caller's
+     * pool in the cache.
+     */
+    cpool = pj_pool_create(pool->factory, "yuvconv%p", 1000, 1000, NULL);
+    if (!cpool)
+	return PJ_ENOMEM;
+
+    lconv = PJ_POOL_ZALLOC_T(cpool, struct libyuv_converter);
     lconv->base.op = &libyuv_converter_op;
+    lconv->pool = cpool;
+    lconv->src_id = src_fmt_info->id;
+    lconv->src_size = src_detail->size;
+    lconv->dst_id = dst_fmt_info->id;
+    lconv->dst_size = dst_detail->size;
 
-    lconv->act_num = set_converter_act(src_fmt_info->id, dst_fmt_info->id, 
+    lconv->act_num = set_converter_act(src_fmt_info->id, dst_fmt_info->id,
 				       &src_detail->size, &dst_detail->size,
 				       lconv->act);
 
-    if (!lconv->act_num) {
-	return status;
-    }
-
-    if (!check_converter_act(lconv->act, lconv->act_num, 
+    if (!lconv->act_num ||
+	!check_converter_act(lconv->act, lconv->act_num,
 			     src_fmt_info->id, &src_detail->size,
-			     dst_fmt_info->id, &dst_detail->size)) 
+			     dst_fmt_info->id, &dst_detail->size))
     {
+	pj_pool_release(cpool);
 	return status;
     }
 
-    status = set_destination_buffer(pool, lconv);
+    status = set_destination_buffer(cpool, lconv);
+
+    if (status == PJ_SUCCESS && f->thread_cnt) {
+	status = pj_sem_create(cpool, "yuvconv%p", 0, MAX_SLICES,
+			       &lconv->done_sem);
+    }
+
+    if (status != PJ_SUCCESS) {
+	destroy_converter(lconv);
+	return status;
+    }
 
     *p_cv = &lconv->base;
 
-    return status;
+    return PJ_SUCCESS;
 }
 
 static void factory_destroy_factory(pjmedia_converter_factory *cf)
 {
-    PJ_UNUSED_ARG(cf);
+    struct libyuv_factory *f = (struct libyuv_factory*)cf;
+    unsigned i;
+
+    if (f->thread_cnt) {
+	pj_mutex_lock(f->mutex);
+	f->quit = PJ_TRUE;
+	pj_mutex_unlock(f->mutex);
+
+	for (i = 0; i < f->thread_cnt; ++i)
+	    pj_sem_post(f->job_sem);
+
+	for (i = 0; i < f->thread_cnt; ++i) {
+	    pj_thread_join(f->thread[i]);
+	    pj_thread_destroy(f->thread[i]);
+	}
+    }
+
+    while (f->cache) {
+	struct libyuv_converter *lconv = f->cache;
+
+	f->cache = lconv->next;
+	destroy_converter(lconv);
+    }
+
+    if (f->job_sem)
+	pj_sem_destroy(f->job_sem);
+    if (f->mutex)
+	pj_mutex_destroy(f->mutex);
+    if (f->pool)
+	pj_pool_release(f->pool);
+
+    pj_bzero(f, sizeof(*f));
 }
 
 static pj_status_t libyuv_conv_convert(pjmedia_converter *converter,
@@ -515,130 +970,76 @@ static pj_status_t libyuv_conv_convert(pjmedia_converter *converter,
     lconv->act[0].src_fmt_info.apply_param.buffer = src_frame->buf;
 
     /* Set the last act buffer from dst frame. */
-    lconv->act[lconv->act_num-1].dst_fmt_info.apply_param.buffer = 
+    lconv->act[lconv->act_num-1].dst_fmt_info.apply_param.buffer =
 								 dst_frame->buf;
 
-    for (;i<lconv->act_num;++i) {	
+    for (;i<lconv->act_num;++i) {
 	/* Use destination info as the source info for the next act. */
-	struct fmt_info *src_fmt_info = (i==0)?&lconv->act[i].src_fmt_info: 
+	struct fmt_info *src_fmt_info = (i==0)?&lconv->act[i].src_fmt_info:
 					&lconv->act[i-1].dst_fmt_info;
 
-	struct fmt_info *dst_fmt_info = &lconv->act[i].dst_fmt_info;	
-	
-	(*src_fmt_info->vid_fmt_info->apply_fmt)(src_fmt_info->vid_fmt_info, 
+	struct fmt_info *dst_fmt_info = &lconv->act[i].dst_fmt_info;
+
+	(*src_fmt_info->vid_fmt_info->apply_fmt)(src_fmt_info->vid_fmt_info,
 						 &src_fmt_info->apply_param);
 
-	(*dst_fmt_info->vid_fmt_info->apply_fmt)(dst_fmt_info->vid_fmt_info, 
+	(*dst_fmt_info->vid_fmt_info->apply_fmt)(dst_fmt_info->vid_fmt_info,
 						 &dst_fmt_info->apply_param);
 
-	switch (lconv->act[i].act_type) {
-	case CONV_PACK_TO_PACK:
-	    (*lconv->act[i].method.conv_pack_to_pack)(
-			      (const uint8*)src_fmt_info->apply_param.planes[0],
-			      src_fmt_info->apply_param.strides[0],
-			      dst_fmt_info->apply_param.planes[0], 
-			      dst_fmt_info->apply_param.strides[0],
-			      dst_fmt_info->apply_param.size.w, 
-			      dst_fmt_info->apply_param.size.h);
-	    break;
-	case CONV_PACK_TO_PLANAR:
-	    (*lconv->act[i].method.conv_pack_to_planar)(
-			      (const uint8*)src_fmt_info->apply_param.planes[0],
-			      src_fmt_info->apply_param.strides[0],
-			      dst_fmt_info->apply_param.planes[0], 
-			      dst_fmt_info->apply_param.strides[0],
-			      dst_fmt_info->apply_param.planes[1], 
-			      dst_fmt_info->apply_param.strides[1],
-			      dst_fmt_info->apply_param.planes[2], 
-			      dst_fmt_info->apply_param.strides[2],
-			      dst_fmt_info->apply_param.size.w, 
-			      dst_fmt_info->apply_param.size.h);
-	    break;
-	case CONV_PLANAR_TO_PACK:
-	    (*lconv->act[i].method.conv_planar_to_pack)(
-			      (const uint8*)src_fmt_info->apply_param.planes[0],
-			      src_fmt_info->apply_param.strides[0],
-			      (const uint8*)src_fmt_info->apply_param.planes[1],
-			      src_fmt_info->apply_param.strides[1],
-			      (const uint8*)src_fmt_info->apply_param.planes[2],
-			      src_fmt_info->apply_param.strides[2],
-			      dst_fmt_info->apply_param.planes[0], 
-			      dst_fmt_info->apply_param.strides[0],
-			      dst_fmt_info->apply_param.size.w, 
-			      dst_fmt_info->apply_param.size.h);
-	    break;
-	case CONV_PLANAR_TO_PLANAR:
-	    (*lconv->act[i].method.conv_planar_to_planar)(
-			      (const uint8*)src_fmt_info->apply_param.planes[0],
-			      src_fmt_info->apply_param.strides[0],
-			      (const uint8*)src_fmt_info->apply_param.planes[1],
-			      src_fmt_info->apply_param.strides[1],
-			      (const uint8*)src_fmt_info->apply_param.planes[2],
-			      src_fmt_info->apply_param.strides[2],
-			      dst_fmt_info->apply_param.planes[0], 
-			      dst_fmt_info->apply_param.strides[0],
-			      dst_fmt_info->apply_param.planes[1], 
-			      dst_fmt_info->apply_param.strides[1],
-			      dst_fmt_info->apply_param.planes[2], 
-			      dst_fmt_info->apply_param.strides[2],
-			      dst_fmt_info->apply_param.size.w, 
-			      dst_fmt_info->apply_param.size.h);
-	    break;
-	case SCALE_PACK:
-	    (*lconv->act[i].method.scale_pack)(
-			      (const uint8*)src_fmt_info->apply_param.planes[0],
-			      src_fmt_info->apply_param.strides[0],
-			      src_fmt_info->apply_param.size.w,
-			      src_fmt_info->apply_param.size.h,
-			      (uint8*)dst_fmt_info->apply_param.planes[0],
-			      dst_fmt_info->apply_param.strides[0],
-			      dst_fmt_info->apply_param.size.w,
-			      dst_fmt_info->apply_param.size.h,
-			      LIBYUV_FILTER_MODE);
-	    break;	
-	case SCALE_PLANAR:
-	    (*lconv->act[i].method.scale_planar)(
-			      (const uint8*)src_fmt_info->apply_param.planes[0],
-			      src_fmt_info->apply_param.strides[0],
-			      (const uint8*)src_fmt_info->apply_param.planes[1],
-			      src_fmt_info->apply_param.strides[1],
-			      (const uint8*)src_fmt_info->apply_param.planes[2],
-			      src_fmt_info->apply_param.strides[2],
-			      src_fmt_info->apply_param.size.w,
-			      src_fmt_info->apply_param.size.h,
-			      (uint8*)dst_fmt_info->apply_param.planes[0],
-			      dst_fmt_info->apply_param.strides[0],
-			      (uint8*)dst_fmt_info->apply_param.planes[1],
-			      dst_fmt_info->apply_param.strides[1],
-			      (uint8*)dst_fmt_info->apply_param.planes[2],
-			      dst_fmt_info->apply_param.strides[2],
-			      dst_fmt_info->apply_param.size.w,
-			      dst_fmt_info->apply_param.size.h,
-			      LIBYUV_FILTER_MODE);
-	    break;	
-	};	
-    }    
+	run_act_sliced(lconv, &lconv->act[i], src_fmt_info, dst_fmt_info);
+    }
     return PJ_SUCCESS;
 }
 
 static void libyuv_conv_destroy(pjmedia_converter *converter)
 {
-    PJ_UNUSED_ARG(converter);
-}
+    struct libyuv_converter *lconv = (struct libyuv_converter*)converter;
+    struct libyuv_factory *f = &libyuv_factory;
+
+    /* Keep the converter for reuse, if there is still room. */
+    if (f->mutex) {
+	pj_mutex_lock(f->mutex);
+	if (f->cache_cnt < PJMEDIA_LIBYUV_CACHE_SIZE) {
+	    lconv->next = f->cache;
+	    f->cache = lconv;
+	    ++f->cache_cnt;
+	    lconv = NULL;
+	}
+	pj_mutex_unlock(f->mutex);
+    }
 
-static pjmedia_converter_factory libyuv_factory =
-{
-    NULL, NULL,					/* list */
-    "libyuv",					/* name */
-    PJMEDIA_CONVERTER_PRIORITY_NORMAL,		/* priority */
-    NULL					/* op will be init-ed later  */
-};
+    if (lconv)
+	destroy_converter(lconv);
+}
 
 PJ_DEF(pj_status_t)
-pjmedia_libyuv_converter_init(pjmedia_converter_mgr *mgr)
+pjmedia_libyuv_converter_init(pjmedia_converter_mgr *mgr, pj_pool_t *pool)
 {
-    libyuv_factory.op = &libyuv_factory_op;
-    return pjmedia_converter_mgr_register_factory(mgr, &libyuv_factory);
+    struct libyuv_factory *f = &libyuv_factory;
+    pj_status_t status;
+
+    pj_bzero(f, sizeof(*f));
+    f->base.name = "libyuv";
+    f->base.priority = PJMEDIA_CONVERTER_PRIORITY_NORMAL;
+    f->base.op = &libyuv_factory_op;
+    pj_list_init(&f->job_list);
+
+    f->pool = pj_pool_create(pool->factory, "libyuv", 512, 512, NULL);
+    if (!f->pool)
+	return PJ_ENOMEM;
+
+    status = pj_mutex_create_simple(f->pool, "libyuv", &f->mutex);
+    if (status == PJ_SUCCESS) {
+	status = pj_sem_create(f->pool, "libyuv", 0, PJ_MAXINT32,
+			       &f->job_sem);
+    }
+    if (status == PJ_SUCCESS)
+	status = pjmedia_converter_mgr_register_factory(mgr, &f->base);
+
+    if (status != PJ_SUCCESS)
+	factory_destroy_factory(&f->base);
+
+    return status;
 }
 
 
@@ -647,7 +1048,7 @@ pjmedia_libyuv_converter_shutdown(pjmedia_converter_mgr *mgr,
 				  pj_pool_t *pool)
 {
     PJ_UNUSED_ARG(pool);
-    return pjmedia_converter_mgr_unregister_factory(mgr, &libyuv_factory,
+    return pjmedia_converter_mgr_unregister_factory(mgr, &libyuv_factory.base,
 						    PJ_TRUE);
 }
 
@@ -21,6 +21,7 @@
 #include <pjmedia/alaw_ulaw.h>
 #include <pjmedia/errno.h>
 #include <pjmedia/frame.h>
+#include <pjmedia/signal_ops.h>
 #include <pjmedia/silencedet.h>
 #include <pj/array.h>
 #include <pj/assert.h>
@@ -100,29 +101,8 @@ PJ_INLINE(float) FABS(float val)
 }
 
 
-#if defined(PJ_HAS_FLOATING_POINT) && PJ_HAS_FLOATING_POINT!=0
-    typedef float pj_ufloat_t;
-#   define pj_ufloat_from_float(f)	(f)
-#   define pj_ufloat_mul_u(val1, f)	((val1) * (f))
-#   define pj_ufloat_mul_i(val1, f)	((val1) * (f))
-#else
-    typedef pj_uint32_t pj_ufloat_t;
-
-    pj_ufloat_t pj_ufloat_from_float(float f)
-    {
-	return (pj_ufloat_t)(f * 65536);
-    }
-
-    unsigned pj_ufloat_mul_u(unsigned val1, pj_ufloat_t val2)
-    {
-	return (val1 * val2) >> 16;
-    }
-
-    int pj_ufloat_mul_i(int val1, pj_ufloat_t val2)
-    {
-	return (val1 * (pj_int32_t)val2) >> 16;
-    }
-#endif
+/* Largest gain applied to the mic signal, in PJMEDIA_SIGNAL_GAIN_UNITY */
+#define MAX_GAIN		(16 * PJMEDIA_SIGNAL_GAIN_UNITY)
 
 
 /* Conversation state */
@@ -647,14 +627,16 @@ static void echo_supp_update(echo_supp *ec, pj_int16_t *rec_frm,
 
 
 /* Amplify frame */
-static void amplify_frame(pj_int16_t *frm, unsigned length,
-			  pj_ufloat_t factor)
+static void amplify_frame(pj_int16_t *frm, unsigned length, float factor)
 {
-    unsigned i;
+    unsigned gain;
 
-    for (i=0; i<length; ++i) {
-	frm[i] = (pj_int16_t)pj_ufloat_mul_i(frm[i], factor);
-    }
+    if (factor * PJMEDIA_SIGNAL_GAIN_UNITY >= MAX_GAIN)
+	gain = MAX_GAIN;
+    else
+	gain = (unsigned)(factor * PJMEDIA_SIGNAL_GAIN_UNITY + 0.5f);
+
+    pjmedia_signal_apply_gain(frm, length, gain);
 }
 
 /*
@@ -763,8 +745,7 @@ PJ_DEF(pj_status_t) echo_supp_cancel_echo( void *state,
 	    factor = (factor + ec->last_factor*19) / 20;
 
 	/* Amplify frame */
-	amplify_frame(rec_frm, ec->samples_per_frame,
-		      pj_ufloat_from_float(factor));
+	amplify_frame(rec_frm, ec->samples_per_frame, factor);
 	ec->last_factor = factor;
 
 	if (ec->talk_state == ST_REM_TALK) {
@@ -18,6 +18,7 @@
  * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA 
  */
 #include <pjmedia/endpoint.h>
+#include <pjmedia/alaw_ulaw.h>
 #include <pjmedia/errno.h>
 #include <pjmedia/sdp.h>
 #include <pjmedia/vid_codec.h>
@@ -30,6 +31,7 @@
 #include <pj/pool.h>
 #include <pj/sock.h>
 #include <pj/string.h>
+#include <pj/timer.h>
 
 
 #define THIS_FILE   "endpoint.c"
@@ -55,11 +57,26 @@ pj_bool_t pjmedia_add_bandwidth_tias_in_sdp =
 
 /* Worker thread proc. */
 static int PJ_THREAD_FUNC worker_proc(void*);
+static int PJ_THREAD_FUNC media_worker_proc(void*);
+static void destroy_workers(pjmedia_endpt *endpt);
 
 
 #define MAX_THREADS	16
 
 
+/* Media worker: an ioqueue and a timer heap polled by a dedicated thread,
+ * which handles all media transports assigned to it.
+ */
+typedef struct media_worker
+{
+    pj_ioqueue_t	*ioqueue;
+    pj_timer_heap_t	*timer_heap;
+    pj_thread_t		*thread;
+    pj_bool_t		 quit;		/* Signal the thread to quit	    */
+    unsigned		 load;		/* Number of assigned users	    */
+} media_worker;
+
+
 /* List of media endpoint exit callback. */
 typedef struct exit_cb
 {
@@ -100,6 +117,18 @@ struct pjmedia_endpt
 
     /** List of exit callback. */
     exit_cb		  exit_cb_list;
+
+    /** Packet buffer pool, NULL when disabled. */
+    pjmedia_pkt_pool	 *pkt_pool;
+
+    /** Media workers, see pjmedia_endpt_create_workers(). */
+    media_worker	 *worker;
+
+    /** Number of media workers. */
+    unsigned		  worker_cnt;
+
+    /** Lock to protect worker assignment. */
+    pj_lock_t		 *worker_lock;
 };
 
 /**
@@ -122,6 +151,9 @@ PJ_DEF(pj_status_t) pjmedia_endpt_create(pj_pool_factory *pf,
     PJ_ASSERT_RETURN(pf && p_endpt, PJ_EINVAL);
     PJ_ASSERT_RETURN(worker_cnt <= MAX_THREADS, PJ_EINVAL);
 
+    /* Select the G.711 block conversion kernels */
+    pjmedia_alaw_ulaw_block_init();
+
     pool = pj_pool_create(pf, "med-ept", 512, 512, NULL);
     if (!pool)
 	return PJ_ENOMEM;
@@ -146,6 +178,14 @@ PJ_DEF(pj_status_t) pjmedia_endpt_create(pj_pool_factory *pf,
     /* Initialize exit callback list. */
     pj_list_init(&endpt->exit_cb_list);
 
+    /* Create packet buffer pool */
+#if PJMEDIA_PKT_POOL_SIZE
+    status = pjmedia_pkt_pool_create(endpt->pool, "med-pkt", PJMEDIA_MAX_MRU,
+				     PJMEDIA_PKT_POOL_SIZE, &endpt->pkt_pool);
+    if (status != PJ_SUCCESS)
+	goto on_error;
+#endif
+
     /* Create ioqueue if none is specified. */
     if (endpt->ioqueue == NULL) {
 	
@@ -187,6 +227,9 @@ on_error:
     if (endpt->ioqueue && endpt->own_ioqueue)
 	pj_ioqueue_destroy(endpt->ioqueue);
 
+    if (endpt->pkt_pool)
+	pjmedia_pkt_pool_destroy(endpt->pkt_pool);
+
     pjmedia_codec_mgr_destroy(&endpt->codec_mgr);
     pjmedia_aud_subsys_shutdown();
     pj_pool_release(pool);
@@ -228,6 +271,13 @@ PJ_DEF(pj_status_t) pjmedia_endpt_destroy (pjmedia_endpt *endpt)
 	ecb = ecb->next;
     }
 
+    destroy_workers(endpt);
+
+    if (endpt->pkt_pool) {
+	pjmedia_pkt_pool_destroy(endpt->pkt_pool);
+	endpt->pkt_pool = NULL;
+    }
+
     pj_pool_release (endpt->pool);
 
     return PJ_SUCCESS;
@@ -276,6 +326,15 @@ PJ_DEF(pj_ioqueue_t*) pjmedia_endpt_get_ioqueue(pjmedia_endpt *endpt)
     return endpt->ioqueue;
 }
 
+/**
+ * Get the packet buffer pool of the media endpoint.
+ */
+PJ_DEF(pjmedia_pkt_pool*) pjmedia_endpt_get_pkt_pool(pjmedia_endpt *endpt)
+{
+    PJ_ASSERT_RETURN(endpt, NULL);
+    return endpt->pkt_pool;
+}
+
 /**
  * Get the number of worker threads in media endpoint.
  */
@@ -319,9 +378,181 @@ PJ_DEF(pj_status_t) pjmedia_endpt_stop_threads(pjmedia_endpt *endpt)
 	}
     }
 
+    for (i=0; i<endpt->worker_cnt; ++i)
+	endpt->worker[i].quit = PJ_TRUE;
+
+    for (i=0; i<endpt->worker_cnt; ++i) {
+	media_worker *w = &endpt->worker[i];
+
+	if (w->thread) {
+	    pj_thread_join(w->thread);
+	    pj_thread_destroy(w->thread);
+	    w->thread = NULL;
+	}
+    }
+
+    return PJ_SUCCESS;
+}
+
+/*
+ * Create media workers.
+ */
+PJ_DEF(pj_status_t) pjmedia_endpt_create_workers(pjmedia_endpt *endpt,
+						 unsigned count,
+						 pj_bool_t pin_cpu)
+{
+    unsigned i, cpu_cnt;
+    pj_lock_t *lock;
+    pj_status_t status;
+
+    PJ_ASSERT_RETURN(endpt && count, PJ_EINVAL);
+    PJ_ASSERT_RETURN(endpt->worker_cnt == 0, PJ_EINVALIDOP);
+    PJ_ASSERT_RETURN(count <= PJMEDIA_ENDPT_MAX_WORKERS, PJ_ETOOMANY);
+
+    status = pj_lock_create_simple_mutex(endpt->pool, "medwrk",
+					 &endpt->worker_lock);
+    if (status != PJ_SUCCESS)
+	return status;
+
+    endpt->worker = (media_worker*)
+		    pj_pool_calloc(endpt->pool, count, sizeof(media_worker));
+    cpu_cnt = pj_get_cpu_count();
+
+    for (i=0; i<count; ++i) {
+	media_worker *w = &endpt->worker[i];
+	char name[PJ_MAX_OBJ_NAME];
+
+	endpt->worker_cnt = i + 1;
+
+	status = pj_ioqueue_create(endpt->pool, PJ_IOQUEUE_MAX_HANDLES,
+				   &w->ioqueue);
+	if (status != PJ_SUCCESS)
+	    goto on_error;
+
+	status = pj_timer_heap_create(endpt->pool, 16, &w->timer_heap);
+	if (status != PJ_SUCCESS)
+	    goto on_error;
+
+	/* Timers may be scheduled from any thread */
+	status = pj_lock_create_simple_mutex(endpt->pool, "medwrk%p", &lock);
+	if (status != PJ_SUCCESS)
+	    goto on_error;
+	pj_timer_heap_set_lock(w->timer_heap, lock, PJ_TRUE);
+
+	pj_ansi_snprintf(name, sizeof(name), "medwrk%u", i);
+	status = pj_thread_create(endpt->pool, name, &media_worker_proc, w,
+				  0, 0, &w->thread);
+	if (status != PJ_SUCCESS)
+	    goto on_error;
+
+	if (pin_cpu) {
+	    status = pj_thread_set_cpu_affinity(w->thread, i % cpu_cnt);
+	    if (status != PJ_SUCCESS) {
+		PJ_PERROR(4,(THIS_FILE, status,
+			     "Unable to bind media worker %u to CPU %u",
+			     i, i % cpu_cnt));
+	    }
+	}
+    }
+
+    PJ_LOG(4,(THIS_FILE, "%u media worker(s) created%s", count,
+	      (pin_cpu ? ", bound to CPUs" : "")));
+
+    return PJ_SUCCESS;
+
+on_error:
+    destroy_workers(endpt);
+    return status;
+}
+
+/* Stop and destroy all media workers */
+static void destroy_workers(pjmedia_endpt *endpt)
+{
+    unsigned i;
+
+    for (i=0; i<endpt->worker_cnt; ++i)
+	endpt->worker[i].quit = PJ_TRUE;
+
+    for (i=0; i<endpt->worker_cnt; ++i) {
+	media_worker *w = &endpt->worker[i];
+
+	if (w->thread) {
+	    pj_thread_join(w->thread);
+	    pj_thread_destroy(w->thread);
+	    w->thread = NULL;
+	}
+	if (w->timer_heap) {
+	    pj_timer_heap_destroy(w->timer_heap);
+	    w->timer_heap = NULL;
+	}
+	if (w->ioqueue) {
+	    pj_ioqueue_destroy(w->ioqueue);
+	    w->ioqueue = NULL;
+	}
+    }
+    endpt->worker_cnt = 0;
+
+    if (endpt->worker_lock) {
+	pj_lock_destroy(endpt->worker_lock);
+	endpt->worker_lock = NULL;
+    }
+}
+
+/*
+ * Get the number of media workers.
+ */
+PJ_DEF(unsigned) pjmedia_endpt_get_worker_count(pjmedia_endpt *endpt)
+{
+    PJ_ASSERT_RETURN(endpt, 0);
+    return endpt->worker_cnt;
+}
+
+/*
+ * Assign the least loaded media worker.
+ */
+PJ_DEF(pj_status_t) pjmedia_endpt_acquire_worker(pjmedia_endpt *endpt,
+						 unsigned *p_index,
+						 pj_ioqueue_t **p_ioqueue,
+						 pj_timer_heap_t **p_timer_heap)
+{
+    unsigned i, best = 0;
+
+    PJ_ASSERT_RETURN(endpt && p_index, PJ_EINVAL);
+
+    if (endpt->worker_cnt == 0)
+	return PJ_ENOTFOUND;
+
+    pj_lock_acquire(endpt->worker_lock);
+    for (i=1; i<endpt->worker_cnt; ++i) {
+	if (endpt->worker[i].load < endpt->worker[best].load)
+	    best = i;
+    }
+    endpt->worker[best].load++;
+    pj_lock_release(endpt->worker_lock);
+
+    *p_index = best;
+    if (p_ioqueue)
+	*p_ioqueue = endpt->worker[best].ioqueue;
+    if (p_timer_heap)
+	*p_timer_heap = endpt->worker[best].timer_heap;
+
     return PJ_SUCCESS;
 }
 
+/*
+ * Release media worker assignment.
+ */
+PJ_DEF(void) pjmedia_endpt_release_worker(pjmedia_endpt *endpt,
+					  unsigned index)
+{
+    PJ_ASSERT_ON_FAIL(endpt && index < endpt->worker_cnt, return);
+
+    pj_lock_acquire(endpt->worker_lock);
+    pj_assert(endpt->worker[index].load > 0);
+    endpt->worker[index].load--;
+    pj_lock_release(endpt->worker_lock);
+}
+
 /**
  * Worker thread proc.
  */
@@ -337,6 +568,27 @@ static int PJ_THREAD_FUNC worker_proc(void *arg)
     return 0;
 }
 
+/*
+ * Media worker thread proc.
+ */
+static int PJ_THREAD_FUNC media_worker_proc(void *arg)
+{
+    media_worker *w = (media_worker*) arg;
+
+    while (!w->quit) {
+	pj_time_val timeout = { 0, 500 };
+
+	pj_timer_heap_poll(w->timer_heap, &timeout);
+	if (timeout.sec || timeout.msec > 500) {
+	    timeout.sec = 0;
+	    timeout.msec = 500;
+	}
+	pj_ioqueue_poll(w->ioqueue, &timeout);
+    }
+
+    return 0;
+}
+
 /**
  * Create pool.
  */
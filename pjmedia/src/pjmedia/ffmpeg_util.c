@@ -43,6 +43,8 @@ static const struct ffmpeg_fmt_table_t
     { PJMEDIA_FORMAT_UYVY, AV_PIX_FMT_UYVY422},
     { PJMEDIA_FORMAT_I420, AV_PIX_FMT_YUV420P},
     //{ PJMEDIA_FORMAT_YV12, AV_PIX_FMT_YUV420P},
+    { PJMEDIA_FORMAT_NV12, AV_PIX_FMT_NV12},
+    { PJMEDIA_FORMAT_NV21, AV_PIX_FMT_NV21},
     { PJMEDIA_FORMAT_I422, AV_PIX_FMT_YUV422P},
     { PJMEDIA_FORMAT_I420JPEG, AV_PIX_FMT_YUVJ420P},
     { PJMEDIA_FORMAT_I422JPEG, AV_PIX_FMT_YUVJ422P},
@@ -52,8 +52,24 @@
 #define STA_DISC_SAFE_SHRINKING_DIFF	1
 
 
+/* Per frame metadata. All metadata of a frame is kept in one slot, so
+ * inspecting a frame touches a single small struct instead of one element
+ * in each of several parallel arrays.
+ */
+typedef struct jb_frame_slot
+{
+    int		     type;		/**< frame type			    */
+    unsigned	     len;		/**< frame length		    */
+    pj_uint32_t	     bit_info;		/**< frame bit info		    */
+    pj_uint32_t	     ts;		/**< timestamp			    */
+    pjmedia_pkt_buf *pkt;		/**< packet holding the frame, or
+					     NULL if it's in the content   */
+    const char	    *data;		/**< frame in the packet	    */
+} jb_frame_slot;
+
+
 /* Struct of JB internal buffer, represented in a circular buffer containing
- * frame content, frame type, frame length, and frame bit info.
+ * frame content and an array of frame metadata slots.
  */
 typedef struct jb_framelist_t
 {
@@ -63,10 +79,7 @@ typedef struct jb_framelist_t
 
     /* Buffers */
     char	    *content;		/**< frame content array	    */
-    int		    *frame_type;	/**< frame type array		    */
-    pj_size_t	    *content_len;	/**< frame length array		    */
-    pj_uint32_t	    *bit_info;		/**< frame bit info array	    */
-    pj_uint32_t	    *ts;		/**< timestamp array		    */
+    jb_frame_slot   *slot;		/**< frame metadata array	    */
 
     /* States */
     unsigned	     head;		/**< index of head, pointed frame
@@ -76,13 +89,70 @@ typedef struct jb_framelist_t
     unsigned	     discarded_num;	/**< current number of discarded
 					     frames.			    */
     int		     origin;		/**< original index of flist_head   */
+    unsigned	     pkt_cnt;		/**< number of slots holding a
+					     packet reference.		    */
+    pjmedia_pkt_buf *held;		/**< packet of the frame returned
+					     by the last pointer GET.	    */
 
 } jb_framelist_t;
 
 
+/* Number of GET operations over which the playout delay is averaged by
+ * the percentile engine, as a power of two.
+ */
+#define PCT_DELAY_AVG_SHIFT	4
+
+/* Number of arrivals in a window of the percentile engine reference, i.e:
+ * the fastest arrival of the current and previous window.
+ */
+#define PCT_MIN_WINDOW		50
+
+/* Percentile engine: offset of a frame, i.e: the playout clock minus the
+ * frame seq, in 1/256 frame. Offsets wrap around, only their differences
+ * are meaningful.
+ */
+#define PCT_OFFSET(jb, seq)	((jb)->jb_pct_clock - ((pj_uint32_t)(seq) << 8))
+
+/* Percentile engine: hysteresis of the playout adjustment, in 1/256 frame.
+ * The playout is only adjusted when the average delay differs from the
+ * target by more than one and a half frames, so that it doesn't oscillate
+ * around the target.
+ */
+#define PCT_ADJ_HYSTERESIS	384
+
+/* Percentile engine: initial weight of a delay sample in the histogram,
+ * and the weight at which the histogram is scaled down by PCT_WEIGHT_SHIFT
+ * bits. See jbuf_update_delay_hist().
+ */
+#define PCT_WEIGHT_INIT		((pj_uint64_t)1 << 20)
+#define PCT_WEIGHT_MAX		((pj_uint64_t)1 << 40)
+#define PCT_WEIGHT_SHIFT	20
+
+#if PJMEDIA_JBUF_PCT_MEMORY < 2
+#   error PJMEDIA_JBUF_PCT_MEMORY must be at least 2
+#endif
+
+
 typedef void (*discard_algo)(pjmedia_jbuf *jb);
 static void jbuf_discard_static(pjmedia_jbuf *jb);
 static void jbuf_discard_progressive(pjmedia_jbuf *jb);
+static void jbuf_discard_percentile(pjmedia_jbuf *jb);
+static void jbuf_put_frame(pjmedia_jbuf *jb,
+			   pjmedia_pkt_buf *pkt,
+			   const void *frame,
+			   pj_size_t frame_size,
+			   pj_uint32_t bit_info,
+			   int frame_seq,
+			   pj_uint32_t ts,
+			   pj_bool_t *discarded);
+static void jbuf_get_frame(pjmedia_jbuf *jb,
+			   void *frame,
+			   const void **frame_ptr,
+			   pj_size_t *size,
+			   char *p_frame_type,
+			   pj_uint32_t *bit_info,
+			   pj_uint32_t *ts,
+			   int *seq);
 
 
 struct pjmedia_jbuf
@@ -102,6 +172,7 @@ struct pjmedia_jbuf
 					     calculation		    */
     int		    jb_min_shrink_gap;	/**< How often can we shrink	    */
     discard_algo    jb_discard_algo;	/**< Discard algorithm		    */
+    pjmedia_jb_engine jb_engine;	/**< Delay estimation engine	    */
 
     /* Buffer */
     jb_framelist_t  jb_framelist;	/**< the buffer			    */
@@ -135,6 +206,21 @@ struct pjmedia_jbuf
     unsigned	    jb_discard_dist;	/**< Distance from jb_discard_ref
 					     to perform discard (in frm)    */
 
+    /* Percentile engine states */
+    pj_uint64_t	   *jb_pct_hist;	/**< Relative delay histogram	    */
+    unsigned	    jb_pct_bins;	/**< Number of histogram bins	    */
+    pj_uint64_t	    jb_pct_weight;	/**< Weight of a new delay sample   */
+    pj_uint64_t	    jb_pct_total;	/**< Sum of the histogram bins	    */
+    unsigned	    jb_pct_cnt;		/**< Samples in the histogram, up
+					     to PJMEDIA_JBUF_PCT_MEMORY	    */
+    pj_uint32_t	    jb_pct_clock;	/**< Playout clock, i.e: GETs plus
+					     stretching, in 1/256 frame	    */
+    pj_bool_t	    jb_pct_has_min;	/**< jb_pct_min is set?		    */
+    pj_uint32_t	    jb_pct_min[2];	/**< Minimum arrival offset of the
+					     current and previous window    */
+    unsigned	    jb_pct_win_cnt;	/**< Arrivals in current window	    */
+    int		    jb_pct_delay_avg;	/**< Average playout delay, Q8	    */
+
     /* Statistics */
     pj_math_stat    jb_delay;		/**< Delay statistics of jitter buffer
 					     (in ms)			    */
@@ -192,59 +278,77 @@ static pj_status_t jb_framelist_init( pj_pool_t *pool,
 			      pj_pool_alloc(pool,
 					    framelist->frame_size*
 					    framelist->max_count);
-    framelist->frame_type   = (int*)
-			      pj_pool_alloc(pool,
-					    sizeof(framelist->frame_type[0])*
-					    framelist->max_count);
-    framelist->content_len  = (pj_size_t*)
+    framelist->slot	    = (jb_frame_slot*)
 			      pj_pool_alloc(pool,
-					    sizeof(framelist->content_len[0])*
-					    framelist->max_count);
-    framelist->bit_info	    = (pj_uint32_t*)
-			      pj_pool_alloc(pool,
-					    sizeof(framelist->bit_info[0])*
-					    framelist->max_count);
-    framelist->ts	    = (pj_uint32_t*)
-			      pj_pool_alloc(pool,
-					    sizeof(framelist->ts[0])*
+					    sizeof(framelist->slot[0])*
 					    framelist->max_count);
 
     return jb_framelist_reset(framelist);
 
 }
 
+/* Release the packet reference of a slot, if any */
+PJ_INLINE(void) jb_slot_release(jb_framelist_t *framelist,
+				jb_frame_slot *slot)
+{
+    if (slot->pkt) {
+	pjmedia_pkt_buf_dec_ref(slot->pkt);
+	slot->pkt = NULL;
+	slot->data = NULL;
+	framelist->pkt_cnt--;
+    }
+}
+
+/* Release the packet of the frame returned by the last pointer GET */
+PJ_INLINE(void) jb_framelist_release_held(jb_framelist_t *framelist)
+{
+    if (framelist->held) {
+	pjmedia_pkt_buf_dec_ref(framelist->held);
+	framelist->held = NULL;
+    }
+}
+
 static pj_status_t jb_framelist_destroy(jb_framelist_t *framelist)
 {
-    PJ_UNUSED_ARG(framelist);
-    return PJ_SUCCESS;
+    /* Give the packets back to their pool */
+    return jb_framelist_reset(framelist);
 }
 
 static pj_status_t jb_framelist_reset(jb_framelist_t *framelist)
 {
+    jb_framelist_release_held(framelist);
+    if (framelist->pkt_cnt) {
+	unsigned i;
+
+	for (i = 0; i < framelist->max_count; ++i)
+	    jb_slot_release(framelist, &framelist->slot[i]);
+	pj_assert(framelist->pkt_cnt == 0);
+    }
+
     framelist->head = 0;
     framelist->origin = INVALID_OFFSET;
     framelist->size = 0;
     framelist->discarded_num = 0;
 
+    /* Zeroed slot is a missing frame */
+    pj_assert(PJMEDIA_JB_MISSING_FRAME == 0);
+    pj_bzero(framelist->slot,
+	     sizeof(framelist->slot[0]) * framelist->max_count);
 
-    //pj_bzero(framelist->content,
-    //	     framelist->frame_size *
-    //	     framelist->max_count);
-
-    pj_memset(framelist->frame_type,
-	      PJMEDIA_JB_MISSING_FRAME,
-	      sizeof(framelist->frame_type[0]) *
-	      framelist->max_count);
+    return PJ_SUCCESS;
+}
 
-    pj_bzero(framelist->content_len,
-	     sizeof(framelist->content_len[0]) *
-	     framelist->max_count);
 
-    //pj_bzero(framelist->bit_info,
-    //	     sizeof(framelist->bit_info[0]) *
-    //	     framelist->max_count);
+/* Get the ring position of the frame at the specified distance from the
+ * head. The distance must be less than the capacity, so the position
+ * wraps at most once and no division is needed.
+ */
+PJ_INLINE(unsigned) jb_framelist_pos(const jb_framelist_t *framelist,
+				     unsigned distance)
+{
+    unsigned pos = framelist->head + distance;
 
-    return PJ_SUCCESS;
+    return (pos >= framelist->max_count) ? pos - framelist->max_count : pos;
 }
 
 
@@ -265,18 +369,26 @@ static int jb_framelist_origin(const jb_framelist_t *framelist)
 }
 
 
+/* Get the head frame. The frame is either copied to 'frame', or, when
+ * 'frame_ptr' is specified, returned as a pointer which stays valid until
+ * the next operation on the framelist.
+ */
 static pj_bool_t jb_framelist_get(jb_framelist_t *framelist,
-				  void *frame, pj_size_t *size,
+				  void *frame, const void **frame_ptr,
+				  pj_size_t *size,
 				  pjmedia_jb_frame_type *p_type,
 				  pj_uint32_t *bit_info,
 				  pj_uint32_t *ts,
 				  int *seq)
 {
+    jb_framelist_release_held(framelist);
+
     if (framelist->size) {
 	pj_bool_t prev_discarded = PJ_FALSE;
+	jb_frame_slot *slot;
 
 	/* Skip discarded frames */
-	while (framelist->frame_type[framelist->head] ==
+	while (framelist->slot[framelist->head].type ==
 	       PJMEDIA_JB_DISCARDED_FRAME)
 	{
 	    jb_framelist_remove_head(framelist, 1);
@@ -285,6 +397,8 @@ static pj_bool_t jb_framelist_get(jb_framelist_t *framelist,
 
 	/* Return the head frame if any */
 	if (framelist->size) {
+	    slot = &framelist->slot[framelist->head];
+
 	    if (prev_discarded) {
 		/* Ticket #1188: when previous frame(s) was discarded, return
 		 * 'missing' frame to trigger PLC to get smoother signal.
@@ -294,33 +408,42 @@ static pj_bool_t jb_framelist_get(jb_framelist_t *framelist,
 		    *size = 0;
 		if (bit_info)
 		    *bit_info = 0;
+		if (frame_ptr)
+		    *frame_ptr = NULL;
 	    } else {
-		pj_memcpy(frame,
-			  framelist->content +
-			  framelist->head * framelist->frame_size,
-			  framelist->frame_size);
-		*p_type = (pjmedia_jb_frame_type)
-			  framelist->frame_type[framelist->head];
+		const char *data = slot->pkt ? slot->data :
+				   framelist->content +
+				   framelist->head * framelist->frame_size;
+
+		if (frame_ptr) {
+		    *frame_ptr = data;
+
+		    /* Keep the packet alive until the next GET */
+		    if (slot->pkt) {
+			framelist->held = slot->pkt;
+			slot->pkt = NULL;
+			framelist->pkt_cnt--;
+		    }
+		} else {
+		    pj_memcpy(frame, data,
+			      slot->pkt ? slot->len : framelist->frame_size);
+		}
+		*p_type = (pjmedia_jb_frame_type) slot->type;
 		if (size)
-		    *size   = framelist->content_len[framelist->head];
+		    *size   = slot->len;
 		if (bit_info)
-		    *bit_info = framelist->bit_info[framelist->head];
+		    *bit_info = slot->bit_info;
 	    }
 	    if (ts)
-		*ts = framelist->ts[framelist->head];
+		*ts = slot->ts;
 	    if (seq)
 		*seq = framelist->origin;
 
-	    //pj_bzero(framelist->content +
-	    //	 framelist->head * framelist->frame_size,
-	    //	 framelist->frame_size);
-	    framelist->frame_type[framelist->head] = PJMEDIA_JB_MISSING_FRAME;
-	    framelist->content_len[framelist->head] = 0;
-	    framelist->bit_info[framelist->head] = 0;
-	    framelist->ts[framelist->head] = 0;
+	    jb_slot_release(framelist, slot);
+	    pj_bzero(slot, sizeof(*slot));
 
 	    framelist->origin++;
-	    framelist->head = (framelist->head + 1) % framelist->max_count;
+	    framelist->head = jb_framelist_pos(framelist, 1);
 	    framelist->size--;
 
 	    return PJ_TRUE;
@@ -328,7 +451,10 @@ static pj_bool_t jb_framelist_get(jb_framelist_t *framelist,
     }
 
     /* No frame available */
-    pj_bzero(frame, framelist->frame_size);
+    if (frame_ptr)
+	*frame_ptr = NULL;
+    else
+	pj_bzero(frame, framelist->frame_size);
 
     return PJ_FALSE;
 }
@@ -353,27 +479,29 @@ static pj_bool_t jb_framelist_peek(jb_framelist_t *framelist,
 
     /* Find actual peek position, note there may be discarded frames */
     while (1) {
-	if (framelist->frame_type[pos] != PJMEDIA_JB_DISCARDED_FRAME) {
+	if (framelist->slot[pos].type != PJMEDIA_JB_DISCARDED_FRAME) {
 	    if (idx == 0)
 		break;
 	    else
 		--idx;
 	}
-	pos = (pos + 1) % framelist->max_count;
+	if (++pos == framelist->max_count)
+	    pos = 0;
     }
 
     /* Return the frame pointer */
-    if (frame)
-	*frame = framelist->content + pos*framelist->frame_size;
+    if (frame) {
+	*frame = framelist->slot[pos].pkt ? framelist->slot[pos].data :
+		 framelist->content + pos*framelist->frame_size;
+    }
     if (type)
-	*type = (pjmedia_jb_frame_type)
-		framelist->frame_type[pos];
+	*type = (pjmedia_jb_frame_type) framelist->slot[pos].type;
     if (size)
-	*size = framelist->content_len[pos];
+	*size = framelist->slot[pos].len;
     if (bit_info)
-	*bit_info = framelist->bit_info[pos];
+	*bit_info = framelist->slot[pos].bit_info;
     if (ts)
-	*ts = framelist->ts[pos];
+	*ts = framelist->slot[pos].ts;
     if (seq)
 	*seq = framelist->origin + offset;
 
@@ -389,54 +517,26 @@ static unsigned jb_framelist_remove_head(jb_framelist_t *framelist,
 	count = framelist->size;
 
     if (count) {
-	/* may be done in two steps if overlapping */
-	unsigned step1,step2;
-	unsigned tmp = framelist->head+count;
-	unsigned i;
+	unsigned i, pos = framelist->head;
 
-	if (tmp > framelist->max_count) {
-	    step1 = framelist->max_count - framelist->head;
-	    step2 = count-step1;
-	} else {
-	    step1 = count;
-	    step2 = 0;
-	}
+	for (i = 0; i < count; ++i) {
+	    jb_frame_slot *slot = &framelist->slot[pos];
 
-	for (i = framelist->head; i < (framelist->head + step1); ++i) {
-	    if (framelist->frame_type[i] == PJMEDIA_JB_DISCARDED_FRAME) {
+	    if (slot->type == PJMEDIA_JB_DISCARDED_FRAME) {
 		pj_assert(framelist->discarded_num > 0);
 		framelist->discarded_num--;
 	    }
-	}
+	    jb_slot_release(framelist, slot);
+	    slot->type = PJMEDIA_JB_MISSING_FRAME;
+	    slot->len = 0;
 
-	//pj_bzero(framelist->content +
-	//	    framelist->head * framelist->frame_size,
-	//          step1*framelist->frame_size);
-	pj_memset(framelist->frame_type+framelist->head,
-		  PJMEDIA_JB_MISSING_FRAME,
-		  step1*sizeof(framelist->frame_type[0]));
-	pj_bzero(framelist->content_len+framelist->head,
-		 step1*sizeof(framelist->content_len[0]));
-
-	if (step2) {
-	    for (i = 0; i < step2; ++i) {
-		if (framelist->frame_type[i] == PJMEDIA_JB_DISCARDED_FRAME) {
-		    pj_assert(framelist->discarded_num > 0);
-		    framelist->discarded_num--;
-		}
-	    }
-	    //pj_bzero( framelist->content,
-	    //	      step2*framelist->frame_size);
-	    pj_memset(framelist->frame_type,
-		      PJMEDIA_JB_MISSING_FRAME,
-		      step2*sizeof(framelist->frame_type[0]));
-	    pj_bzero (framelist->content_len,
-		      step2*sizeof(framelist->content_len[0]));
+	    if (++pos == framelist->max_count)
+		pos = 0;
 	}
 
 	/* update states */
 	framelist->origin += count;
-	framelist->head = (framelist->head + count) % framelist->max_count;
+	framelist->head = pos;
 	framelist->size -= count;
     }
 
@@ -444,8 +544,12 @@ static unsigned jb_framelist_remove_head(jb_framelist_t *framelist,
 }
 
 
+/* Put a frame. When 'pkt' is specified, the frame lies in that packet
+ * buffer and the slot keeps a reference to it instead of copying.
+ */
 static pj_status_t jb_framelist_put_at(jb_framelist_t *framelist,
 				       int index,
+				       pjmedia_pkt_buf *pkt,
 				       const void *frame,
 				       unsigned frame_size,
 				       pj_uint32_t bit_info,
@@ -493,26 +597,34 @@ static pj_status_t jb_framelist_put_at(jb_framelist_t *framelist,
     }
 
     /* get the slot position */
-    pos = (framelist->head + distance) % framelist->max_count;
+    pos = jb_framelist_pos(framelist, distance);
 
     /* if the slot is occupied, it must be duplicated frame, ignore it. */
-    if (framelist->frame_type[pos] != PJMEDIA_JB_MISSING_FRAME)
+    if (framelist->slot[pos].type != PJMEDIA_JB_MISSING_FRAME)
 	return PJ_EEXISTS;
 
     /* put the frame into the slot */
-    framelist->frame_type[pos] = frame_type;
-    framelist->content_len[pos] = frame_size;
-    framelist->bit_info[pos] = bit_info;
-    framelist->ts[pos] = ts;
+    framelist->slot[pos].type = frame_type;
+    framelist->slot[pos].len = frame_size;
+    framelist->slot[pos].bit_info = bit_info;
+    framelist->slot[pos].ts = ts;
 
     /* update framelist size */
     if (framelist->origin + (int)framelist->size <= index)
 	framelist->size = distance + 1;
 
     if(PJMEDIA_JB_NORMAL_FRAME == frame_type) {
-	/* copy frame content */
-	pj_memcpy(framelist->content + pos * framelist->frame_size,
-		  frame, frame_size);
+	if (pkt) {
+	    /* reference the packet */
+	    pjmedia_pkt_buf_add_ref(pkt);
+	    framelist->slot[pos].pkt = pkt;
+	    framelist->slot[pos].data = (const char*)frame;
+	    framelist->pkt_cnt++;
+	} else {
+	    /* copy frame content */
+	    pj_memcpy(framelist->content + pos * framelist->frame_size,
+		      frame, frame_size);
+	}
     }
 
     return PJ_SUCCESS;
@@ -529,11 +641,10 @@ static pj_status_t jb_framelist_discard(jb_framelist_t *framelist,
 		     PJ_EINVAL);
 
     /* Get the slot position */
-    pos = (framelist->head + (index - framelist->origin)) %
-	  framelist->max_count;
+    pos = jb_framelist_pos(framelist, index - framelist->origin);
 
     /* Discard the frame */
-    framelist->frame_type[pos] = PJMEDIA_JB_DISCARDED_FRAME;
+    framelist->slot[pos].type = PJMEDIA_JB_DISCARDED_FRAME;
     framelist->discarded_num++;
 
     return PJ_SUCCESS;
@@ -573,6 +684,11 @@ PJ_DEF(pj_status_t) pjmedia_jbuf_create(pj_pool_t *pool,
     jb->jb_max_count	 = max_count;
     jb->jb_min_shrink_gap= PJMEDIA_JBUF_DISC_MIN_GAP / ptime;
     jb->jb_max_burst	 = PJ_MAX(MAX_BURST_MSEC / ptime, max_count*3/4);
+    jb->jb_engine	 = PJMEDIA_JB_ENGINE_BURST;
+    jb->jb_pct_bins	 = max_count;
+    jb->jb_pct_hist	 = (pj_uint64_t*)
+			   pj_pool_calloc(pool, max_count,
+					  sizeof(jb->jb_pct_hist[0]));
 
     pj_math_stat_init(&jb->jb_delay);
     pj_math_stat_init(&jb->jb_burst);
@@ -650,6 +766,20 @@ PJ_DEF(pj_status_t) pjmedia_jbuf_set_discard( pjmedia_jbuf *jb,
 }
 
 
+PJ_DEF(pj_status_t) pjmedia_jbuf_set_engine( pjmedia_jbuf *jb,
+					     pjmedia_jb_engine engine)
+{
+    PJ_ASSERT_RETURN(jb, PJ_EINVAL);
+    PJ_ASSERT_RETURN(engine == PJMEDIA_JB_ENGINE_BURST ||
+		     engine == PJMEDIA_JB_ENGINE_PERCENTILE, PJ_EINVAL);
+
+    jb->jb_engine = engine;
+    pjmedia_jbuf_reset(jb);
+
+    return PJ_SUCCESS;
+}
+
+
 PJ_DEF(pj_status_t) pjmedia_jbuf_reset(pjmedia_jbuf *jb)
 {
     jb->jb_level	 = 0;
@@ -660,7 +790,15 @@ PJ_DEF(pj_status_t) pjmedia_jbuf_reset(pjmedia_jbuf *jb)
     jb->jb_max_hist_level= 0;
     jb->jb_prefetching   = (jb->jb_prefetch != 0);
     jb->jb_discard_dist  = 0;
-
+    jb->jb_pct_cnt	 = 0;
+    jb->jb_pct_weight	 = PCT_WEIGHT_INIT;
+    jb->jb_pct_total	 = 0;
+    jb->jb_pct_clock	 = 0;
+    jb->jb_pct_has_min	 = PJ_FALSE;
+    jb->jb_pct_win_cnt	 = 0;
+    jb->jb_pct_delay_avg = 0;
+
+    pj_bzero(jb->jb_pct_hist, jb->jb_pct_bins * sizeof(jb->jb_pct_hist[0]));
     jb_framelist_reset(&jb->jb_framelist);
 
     return PJ_SUCCESS;
@@ -770,6 +908,152 @@ static void jbuf_calculate_jitter(pjmedia_jbuf *jb)
 }
 
 
+/* Percentile engine: the minimum arrival offset of the recent windows. */
+static pj_uint32_t jb_pct_get_min(const pjmedia_jbuf *jb)
+{
+    return ((int)(jb->jb_pct_min[0] - jb->jb_pct_min[1]) < 0) ?
+	   jb->jb_pct_min[0] : jb->jb_pct_min[1];
+}
+
+
+/* Percentile engine: add a delay sample for the frame just put. The
+ * sample is how much later than the fastest frame of the recent windows
+ * it arrived, i.e: how long it had to be buffered to be played in time.
+ * Using the minimum of two windows lets the reference follow clock drift
+ * and route changes.
+ */
+static void jbuf_update_delay_hist(pjmedia_jbuf *jb, int frame_seq)
+{
+    pj_uint32_t offset = PCT_OFFSET(jb, frame_seq);
+    int delay;
+    unsigned i;
+
+    delay = (int)(offset - jb_pct_get_min(jb));
+
+    /* A step beyond what may ever be buffered, e.g: sequence restart or
+     * jump, is taken as a new reference rather than as delay.
+     */
+    if (!jb->jb_pct_has_min ||
+	delay > PJ_MAX(jb->jb_max_prefetch, 1) * 256 ||
+	delay < -(int)jb->jb_max_count * 256)
+    {
+	jb->jb_pct_min[0] = jb->jb_pct_min[1] = offset;
+	jb->jb_pct_win_cnt = 0;
+	jb->jb_pct_has_min = PJ_TRUE;
+	return;
+    }
+
+    if ((int)(offset - jb->jb_pct_min[0]) < 0)
+	jb->jb_pct_min[0] = offset;
+    if (++jb->jb_pct_win_cnt >= PCT_MIN_WINDOW) {
+	jb->jb_pct_min[1] = jb->jb_pct_min[0];
+	jb->jb_pct_min[0] = offset;
+	jb->jb_pct_win_cnt = 0;
+    }
+
+    /* Bin i holds the delays from i up to i+1 frames */
+    delay = PJ_MAX(delay, 0) >> 8;
+    if (delay >= (int)jb->jb_pct_bins)
+	delay = jb->jb_pct_bins - 1;
+
+    /* Exponential forgetting. Until the histogram holds
+     * PJMEDIA_JBUF_PCT_MEMORY samples, they all have the same weight so
+     * the histogram converges quickly. After that, every sample weighs
+     * 1/(1 - 1/PJMEDIA_JBUF_PCT_MEMORY) times the previous one, which is
+     * the same as decaying the older samples by that factor, without
+     * touching every bin. When the weight grows too large, the whole
+     * histogram is scaled down, i.e: once every few thousand samples.
+     */
+    if (jb->jb_pct_cnt < PJMEDIA_JBUF_PCT_MEMORY) {
+	++jb->jb_pct_cnt;
+    } else {
+	jb->jb_pct_weight += jb->jb_pct_weight /
+			     (PJMEDIA_JBUF_PCT_MEMORY - 1);
+    }
+
+    if (jb->jb_pct_weight >= PCT_WEIGHT_MAX) {
+	jb->jb_pct_total = 0;
+	for (i = 0; i < jb->jb_pct_bins; ++i) {
+	    jb->jb_pct_hist[i] >>= PCT_WEIGHT_SHIFT;
+	    jb->jb_pct_total += jb->jb_pct_hist[i];
+	}
+	jb->jb_pct_weight >>= PCT_WEIGHT_SHIFT;
+    }
+
+    jb->jb_pct_hist[delay] += jb->jb_pct_weight;
+    jb->jb_pct_total += jb->jb_pct_weight;
+}
+
+
+/* Percentile engine: update the target level from the histogram. */
+static void jbuf_calculate_target(pjmedia_jbuf *jb)
+{
+    pj_uint64_t limit, sum = 0;
+    int target;
+    unsigned i;
+
+    if (jb->jb_pct_cnt == 0)
+	return;
+
+    limit = jb->jb_pct_total / 100 * PJMEDIA_JBUF_PCT_PERCENTILE;
+    for (i = 0; i < jb->jb_pct_bins - 1; ++i) {
+	sum += jb->jb_pct_hist[i];
+	if (sum >= limit)
+	    break;
+    }
+
+    /* A frame delayed by i frames needs i+1 frames in the buffer */
+    target = i + 1;
+    target = PJ_MAX(target, jb->jb_min_prefetch);
+    if (jb->jb_max_prefetch > 0)
+	target = PJ_MIN(target, jb->jb_max_prefetch);
+
+    if (target != jb->jb_eff_level) {
+	TRACE__((jb->jb_name.ptr, "jb target %d -> %d, delay=%d.%02d",
+		 jb->jb_eff_level, target, jb->jb_pct_delay_avg >> 8,
+		 (jb->jb_pct_delay_avg & 0xFF) * 100 >> 8));
+    }
+
+    jb->jb_eff_level = target;
+    if (jb->jb_init_prefetch)
+	jb->jb_prefetch = target;
+
+    pj_math_stat_update(&jb->jb_burst, target);
+}
+
+
+/* Percentile engine: the caller time-stretches the playout towards the
+ * target, so frames are only discarded when that doesn't keep up, i.e. the
+ * average playout delay stays above twice the target. The average, rather
+ * than the current size, is used so that regular bursts don't trigger it.
+ */
+static void jbuf_discard_percentile(pjmedia_jbuf *jb)
+{
+    int seq_origin;
+
+    if ((jb->jb_pct_delay_avg >> 8) <= jb->jb_eff_level * 2 + 1)
+	return;
+
+    /* Check and adjust jb_discard_ref, in case there was seq restart */
+    seq_origin = jb_framelist_origin(&jb->jb_framelist);
+    if (seq_origin < jb->jb_discard_ref)
+	jb->jb_discard_ref = seq_origin;
+
+    if (seq_origin - jb->jb_discard_ref >= jb->jb_min_shrink_gap) {
+	unsigned diff;
+
+	/* Shrink slowly, one frame per cycle */
+	diff = jb_framelist_remove_head(&jb->jb_framelist, 1);
+	jb->jb_discard_ref = jb_framelist_origin(&jb->jb_framelist);
+	jb->jb_discard += diff;
+
+	TRACE__((jb->jb_name.ptr,
+		 "JB shrinking %d frame(s), cur size=%d", diff,
+		 jb_framelist_eff_size(&jb->jb_framelist)));
+    }
+}
+
+
 static void jbuf_discard_static(pjmedia_jbuf *jb)
 {
     /* These code is used for shortening the delay in the jitter buffer.
@@ -928,15 +1212,24 @@ PJ_INLINE(void) jbuf_update(pjmedia_jbuf *jb, int oper)
 	 * the GET op may be idle, in this case, we better skip the jitter
 	 * calculation.
 	 */
-	if (oper == JB_OP_GET && jb->jb_level <= jb->jb_max_burst)
+	if (jb->jb_engine == PJMEDIA_JB_ENGINE_PERCENTILE) {
+	    if (oper == JB_OP_GET)
+		jbuf_calculate_target(jb);
+	} else if (oper == JB_OP_GET && jb->jb_level <= jb->jb_max_burst) {
 	    jbuf_calculate_jitter(jb);
+	}
 
 	jb->jb_level = 0;
     }
 
-    /* Call discard algorithm */
+    /* Call discard algorithm. The percentile engine replaces it with its
+     * own safety net, unless discarding is disabled altogether.
+     */
     if (jb->jb_status == JB_STATUS_PROCESSING && jb->jb_discard_algo) {
-	(*jb->jb_discard_algo)(jb);
+	if (jb->jb_engine == PJMEDIA_JB_ENGINE_PERCENTILE)
+	    jbuf_discard_percentile(jb);
+	else
+	    (*jb->jb_discard_algo)(jb);
     }
 }
 
@@ -966,6 +1259,42 @@ PJ_DEF(void) pjmedia_jbuf_put_frame3(pjmedia_jbuf *jb,
 				     int frame_seq,
 				     pj_uint32_t ts,
 				     pj_bool_t *discarded)
+{
+    jbuf_put_frame(jb, NULL, frame, frame_size, bit_info, frame_seq, ts,
+		   discarded);
+}
+
+PJ_DEF(void) pjmedia_jbuf_put_pkt(pjmedia_jbuf *jb,
+				  pjmedia_pkt_buf *pkt,
+				  const void *frame,
+				  pj_size_t frame_size,
+				  pj_uint32_t bit_info,
+				  int frame_seq,
+				  pj_uint32_t ts,
+				  pj_bool_t *discarded)
+{
+    /* Only reference the packet if the frame really lies in it, codecs
+     * may return parsed frames in their own buffers.
+     */
+    if (pkt && ((const char*)frame < (const char*)pkt->buf ||
+		(const char*)frame + frame_size >
+		    (const char*)pkt->buf + pkt->size))
+    {
+	pkt = NULL;
+    }
+
+    jbuf_put_frame(jb, pkt, frame, frame_size, bit_info, frame_seq, ts,
+		   discarded);
+}
+
+static void jbuf_put_frame(pjmedia_jbuf *jb,
+			   pjmedia_pkt_buf *pkt,
+			   const void *frame,
+			   pj_size_t frame_size,
+			   pj_uint32_t bit_info,
+			   int frame_seq,
+			   pj_uint32_t ts,
+			   pj_bool_t *discarded)
 {
     pj_size_t min_frame_size;
     int new_size, cur_size;
@@ -975,7 +1304,7 @@ PJ_DEF(void) pjmedia_jbuf_put_frame3(pjmedia_jbuf *jb,
 
     /* Attempt to store the frame */
     min_frame_size = PJ_MIN(frame_size, jb->jb_frame_size);
-    status = jb_framelist_put_at(&jb->jb_framelist, frame_seq, frame,
+    status = jb_framelist_put_at(&jb->jb_framelist, frame_seq, pkt, frame,
 				 (unsigned)min_frame_size, bit_info, ts,
 				 PJMEDIA_JB_NORMAL_FRAME);
 
@@ -994,7 +1323,7 @@ PJ_DEF(void) pjmedia_jbuf_put_frame3(pjmedia_jbuf *jb,
 	pj_assert(distance > 0);
 
 	removed = jb_framelist_remove_head(&jb->jb_framelist, distance);
-	status = jb_framelist_put_at(&jb->jb_framelist, frame_seq, frame,
+	status = jb_framelist_put_at(&jb->jb_framelist, frame_seq, pkt, frame,
 				     (unsigned)min_frame_size, bit_info, ts,
 				     PJMEDIA_JB_NORMAL_FRAME);
 
@@ -1016,6 +1345,8 @@ PJ_DEF(void) pjmedia_jbuf_put_frame3(pjmedia_jbuf *jb,
 		jb->jb_prefetching = PJ_FALSE;
 	}
 	jb->jb_level += (new_size > cur_size ? new_size-cur_size : 1);
+	if (jb->jb_engine == PJMEDIA_JB_ENGINE_PERCENTILE)
+	    jbuf_update_delay_hist(jb, frame_seq);
 	jbuf_update(jb, JB_OP_PUT);
     } else
 	jb->jb_discard++;
@@ -1056,6 +1387,39 @@ PJ_DEF(void) pjmedia_jbuf_get_frame3(pjmedia_jbuf *jb,
 				     pj_uint32_t *ts,
 				     int *seq)
 {
+    jbuf_get_frame(jb, frame, NULL, size, p_frame_type, bit_info, ts, seq);
+}
+
+/*
+ * Get frame from jitter buffer without copying.
+ */
+PJ_DEF(void) pjmedia_jbuf_get_frame_ptr(pjmedia_jbuf *jb,
+					const void **frame,
+					pj_size_t *size,
+					char *p_frame_type,
+					pj_uint32_t *bit_info,
+					pj_uint32_t *ts,
+					int *seq)
+{
+    PJ_ASSERT_ON_FAIL(jb && frame, return);
+
+    *frame = NULL;
+    jbuf_get_frame(jb, NULL, frame, size, p_frame_type, bit_info, ts, seq);
+}
+
+static void jbuf_get_frame(pjmedia_jbuf *jb,
+			   void *frame,
+			   const void **frame_ptr,
+			   pj_size_t *size,
+			   char *p_frame_type,
+			   pj_uint32_t *bit_info,
+			   pj_uint32_t *ts,
+			   int *seq)
+{
+    int play_seq = jb_framelist_origin(&jb->jb_framelist);
+
+    jb->jb_pct_clock += 256;
+
     if (jb->jb_prefetching) {
 
 	/* Can't return frame because jitter buffer is filling up
@@ -1078,7 +1442,8 @@ PJ_DEF(void) pjmedia_jbuf_get_frame3(pjmedia_jbuf *jb,
 	pj_bool_t res;
 
 	/* Try to retrieve a frame from frame list */
-	res = jb_framelist_get(&jb->jb_framelist, frame, size, &ftype,
+	res = jb_framelist_get(&jb->jb_framelist, frame, frame_ptr, size,
+			       &ftype,
 			       bit_info, ts, seq);
 	if (res) {
 	    /* We've successfully retrieved a frame from the frame list, but
@@ -1091,6 +1456,19 @@ PJ_DEF(void) pjmedia_jbuf_get_frame3(pjmedia_jbuf *jb,
 		jb->jb_lost++;
 	    }
 
+	    /* Percentile engine: the playout delay of this frame, relative
+	     * to the fastest arrival, in the same unit as the target.
+	     */
+	    if (jb->jb_engine == PJMEDIA_JB_ENGINE_PERCENTILE &&
+		jb->jb_pct_has_min)
+	    {
+		int delay = (int)(PCT_OFFSET(jb, play_seq) -
+				  jb_pct_get_min(jb));
+
+		jb->jb_pct_delay_avg += (delay - jb->jb_pct_delay_avg) >>
+					PCT_DELAY_AVG_SHIFT;
+	    }
+
 	    /* Store delay history at the first GET */
 	    if (jb->jb_last_op == JB_OP_PUT) {
 		unsigned cur_size;
@@ -1148,6 +1526,36 @@ PJ_DEF(pj_status_t) pjmedia_jbuf_get_state( const pjmedia_jbuf *jb,
 }
 
 
+PJ_DEF(void) pjmedia_jbuf_set_playout_stretch(pjmedia_jbuf *jb,
+					      int stretch)
+{
+    PJ_ASSERT_ON_FAIL(jb, return);
+    jb->jb_pct_clock += stretch;
+}
+
+
+PJ_DEF(int) pjmedia_jbuf_get_playout_adj(const pjmedia_jbuf *jb)
+{
+    int diff;
+
+    PJ_ASSERT_RETURN(jb, 0);
+
+    if (jb->jb_engine != PJMEDIA_JB_ENGINE_PERCENTILE ||
+	jb->jb_status != JB_STATUS_PROCESSING || jb->jb_prefetching)
+    {
+	return 0;
+    }
+
+    diff = jb->jb_pct_delay_avg - (jb->jb_eff_level << 8);
+    if (diff > PCT_ADJ_HYSTERESIS)
+	return diff >> 8;
+    if (diff < -PCT_ADJ_HYSTERESIS)
+	return -((-diff) >> 8);
+
+    return 0;
+}
+
+
 PJ_DEF(void) pjmedia_jbuf_peek_frame( pjmedia_jbuf *jb,
 				      unsigned offset,
 				      const void **frame,
@@ -34,9 +34,13 @@ struct pjmedia_master_port
     pjmedia_port    *d_port;
     unsigned	     buff_size;
     void	    *buff;
+    pjmedia_frame   *frame;	/**< Also fits pjmedia_frame_ext.   */
     pj_lock_t	    *lock;
 };
 
+/* Room for the subframe headers of pjmedia_frame_ext frames */
+#define EXT_FRAME_HDR_ROOM  32
+
 
 static void clock_callback(const pj_timestamp *ts, void *user_data);
 
@@ -106,6 +110,15 @@ PJ_DEF(pj_status_t) pjmedia_master_port_create( pj_pool_t *pool,
     if (!m->buff)
 	return PJ_ENOMEM;
 
+    /* Ports with non-PCM format may return pjmedia_frame_ext, which
+     * carries the payload after the frame structure.
+     */
+    m->frame = (pjmedia_frame*)
+	       pj_pool_alloc(pool, sizeof(pjmedia_frame_ext) +
+				   bytes_per_frame + EXT_FRAME_HDR_ROOM);
+    if (!m->frame)
+	return PJ_ENOMEM;
+
     /* Create lock object */
     status = pj_lock_create_simple_mutex(pool, "mport", &m->lock);
     if (status != PJ_SUCCESS)
@@ -160,13 +173,25 @@ PJ_DEF(pj_bool_t) pjmedia_master_port_wait( pjmedia_master_port *m,
     return pjmedia_clock_wait(m->clock, wait, ts);
 }
 
+/*
+ * Use clock scheduler.
+ */
+PJ_DEF(pj_status_t) pjmedia_master_port_set_clock_sched(
+					    pjmedia_master_port *m,
+					    pjmedia_clock_sched *sched)
+{
+    PJ_ASSERT_RETURN(m && m->clock, PJ_EINVAL);
+
+    return pjmedia_clock_set_sched(m->clock, sched);
+}
+
 /*
  * Callback to be called for each clock ticks.
  */
 static void clock_callback(const pj_timestamp *ts, void *user_data)
 {
     pjmedia_master_port *m = (pjmedia_master_port*) user_data;
-    pjmedia_frame frame;
+    pjmedia_frame *frame = m->frame;
     pj_status_t status;
 
     
@@ -174,28 +199,28 @@ static void clock_callback(const pj_timestamp *ts, void *user_data)
     pj_lock_acquire(m->lock);
 
     /* Get frame from upstream port and pass it to downstream port */
-    pj_bzero(&frame, sizeof(frame));
-    frame.buf = m->buff;
-    frame.size = m->buff_size;
-    frame.timestamp.u64 = ts->u64;
+    pj_bzero(frame, sizeof(*frame));
+    frame->buf = m->buff;
+    frame->size = m->buff_size;
+    frame->timestamp.u64 = ts->u64;
 
-    status = pjmedia_port_get_frame(m->u_port, &frame);
+    status = pjmedia_port_get_frame(m->u_port, frame);
     if (status != PJ_SUCCESS)
-	frame.type = PJMEDIA_FRAME_TYPE_NONE;
+	frame->type = PJMEDIA_FRAME_TYPE_NONE;
 
-    status = pjmedia_port_put_frame(m->d_port, &frame);
+    status = pjmedia_port_put_frame(m->d_port, frame);
 
     /* Get frame from downstream port and pass it to upstream port */
-    pj_bzero(&frame, sizeof(frame));
-    frame.buf = m->buff;
-    frame.size = m->buff_size;
-    frame.timestamp.u64 = ts->u64;
+    pj_bzero(frame, sizeof(*frame));
+    frame->buf = m->buff;
+    frame->size = m->buff_size;
+    frame->timestamp.u64 = ts->u64;
 
-    status = pjmedia_port_get_frame(m->d_port, &frame);
+    status = pjmedia_port_get_frame(m->d_port, frame);
     if (status != PJ_SUCCESS)
-	frame.type = PJMEDIA_FRAME_TYPE_NONE;
+	frame->type = PJMEDIA_FRAME_TYPE_NONE;
 
-    status = pjmedia_port_put_frame(m->u_port, &frame);
+    status = pjmedia_port_put_frame(m->u_port, frame);
 
     /* Release lock */
     pj_lock_release(m->lock);
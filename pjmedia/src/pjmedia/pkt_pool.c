@@ -0,0 +1,206 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2011 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include <pjmedia/pkt_pool.h>
+#include <pjmedia/errno.h>
+#include <pj/assert.h>
+#include <pj/lock.h>
+#include <pj/log.h>
+#include <pj/pool.h>
+#include <pj/string.h>
+
+
+#define THIS_FILE	"pkt_pool.c"
+
+/* Buffers are kept 8 bytes aligned, packet parsers (and SRTP) expect at
+ * least 32bit alignment of the packet start.
+ */
+#define BUF_ALIGN	8
+
+
+struct pjmedia_pkt_pool
+{
+    char		 obj_name[PJ_MAX_OBJ_NAME];
+    pj_lock_t		*lock;
+
+    /* All buffers are carved from one slab, so that the buffer owning a
+     * pointer is found with a range check and a division.
+     */
+    char		*slab;
+    unsigned		 stride;
+    unsigned		 count;
+    pjmedia_pkt_buf	*bufs;
+
+    /* LIFO free list, so that a buffer which is released and allocated
+     * again right away (the common case in transports) is still warm in
+     * the cache.
+     */
+    pjmedia_pkt_buf	*free_list;
+    unsigned		 free_cnt;
+};
+
+
+PJ_DEF(pj_status_t) pjmedia_pkt_pool_create(pj_pool_t *pool,
+					    const char *name,
+					    unsigned buf_size,
+					    unsigned count,
+					    pjmedia_pkt_pool **p_pkt_pool)
+{
+    pjmedia_pkt_pool *pp;
+    unsigned i;
+    pj_status_t status;
+
+    PJ_ASSERT_RETURN(pool && buf_size && count && p_pkt_pool, PJ_EINVAL);
+
+    if (name == NULL)
+	name = "pktpool%p";
+
+    pp = PJ_POOL_ZALLOC_T(pool, pjmedia_pkt_pool);
+    pj_ansi_snprintf(pp->obj_name, sizeof(pp->obj_name), name, pp);
+
+    pp->stride = (buf_size + BUF_ALIGN - 1) & ~(BUF_ALIGN - 1);
+    pp->count = count;
+    pp->slab = (char*) pj_pool_alloc(pool, pp->stride * count + BUF_ALIGN);
+    pp->bufs = (pjmedia_pkt_buf*)
+	       pj_pool_zalloc(pool, count * sizeof(pjmedia_pkt_buf));
+    if (!pp->slab || !pp->bufs)
+	return PJ_ENOMEM;
+
+    /* Pool allocations are only guaranteed to be PJ_POOL_ALIGNMENT
+     * aligned.
+     */
+    pp->slab = (char*)(((pj_size_t)pp->slab + BUF_ALIGN - 1) &
+		       ~(pj_size_t)(BUF_ALIGN - 1));
+
+    /* Build the free list so that the first buffer is allocated first */
+    for (i = count; i > 0; --i) {
+	pjmedia_pkt_buf *pkt = &pp->bufs[i-1];
+
+	pkt->pool = pp;
+	pkt->buf = pp->slab + (i-1) * pp->stride;
+	pkt->size = buf_size;
+	pkt->next = pp->free_list;
+	pp->free_list = pkt;
+    }
+    pp->free_cnt = count;
+
+    status = pj_lock_create_simple_mutex(pool, pp->obj_name, &pp->lock);
+    if (status != PJ_SUCCESS)
+	return status;
+
+    PJ_LOG(5,(pp->obj_name, "Packet pool created, %u buffers of %u bytes",
+	      count, buf_size));
+
+    *p_pkt_pool = pp;
+    return PJ_SUCCESS;
+}
+
+
+PJ_DEF(pj_status_t) pjmedia_pkt_pool_destroy(pjmedia_pkt_pool *pkt_pool)
+{
+    PJ_ASSERT_RETURN(pkt_pool, PJ_EINVAL);
+
+    if (pkt_pool->free_cnt != pkt_pool->count) {
+	PJ_LOG(4,(pkt_pool->obj_name, "Destroying packet pool with %u "
+		  "buffers still in use",
+		  pkt_pool->count - pkt_pool->free_cnt));
+    }
+
+    if (pkt_pool->lock) {
+	pj_lock_destroy(pkt_pool->lock);
+	pkt_pool->lock = NULL;
+    }
+
+    return PJ_SUCCESS;
+}
+
+
+PJ_DEF(pjmedia_pkt_buf*) pjmedia_pkt_pool_alloc(pjmedia_pkt_pool *pkt_pool)
+{
+    pjmedia_pkt_buf *pkt;
+
+    PJ_ASSERT_RETURN(pkt_pool, NULL);
+
+    pj_lock_acquire(pkt_pool->lock);
+    pkt = pkt_pool->free_list;
+    if (pkt) {
+	pkt_pool->free_list = pkt->next;
+	pkt_pool->free_cnt--;
+	pkt->next = NULL;
+	pkt->ref_cnt = 1;
+    }
+    pj_lock_release(pkt_pool->lock);
+
+    return pkt;
+}
+
+
+PJ_DEF(pjmedia_pkt_buf*) pjmedia_pkt_pool_find(pjmedia_pkt_pool *pkt_pool,
+					       const void *ptr)
+{
+    const char *p = (const char*)ptr;
+    pj_size_t offset;
+
+    PJ_ASSERT_RETURN(pkt_pool, NULL);
+
+    if (p < pkt_pool->slab)
+	return NULL;
+
+    offset = p - pkt_pool->slab;
+    if (offset >= (pj_size_t)pkt_pool->stride * pkt_pool->count)
+	return NULL;
+
+    return &pkt_pool->bufs[offset / pkt_pool->stride];
+}
+
+
+PJ_DEF(unsigned) pjmedia_pkt_pool_get_free_cnt(pjmedia_pkt_pool *pkt_pool)
+{
+    PJ_ASSERT_RETURN(pkt_pool, 0);
+    return pkt_pool->free_cnt;
+}
+
+
+PJ_DEF(void) pjmedia_pkt_buf_add_ref(pjmedia_pkt_buf *pkt)
+{
+    PJ_ASSERT_ON_FAIL(pkt, return);
+
+    pj_lock_acquire(pkt->pool->lock);
+    pj_assert(pkt->ref_cnt > 0);
+    pkt->ref_cnt++;
+    pj_lock_release(pkt->pool->lock);
+}
+
+
+PJ_DEF(void) pjmedia_pkt_buf_dec_ref(pjmedia_pkt_buf *pkt)
+{
+    pjmedia_pkt_pool *pp;
+
+    PJ_ASSERT_ON_FAIL(pkt, return);
+
+    pp = pkt->pool;
+    pj_lock_acquire(pp->lock);
+    pj_assert(pkt->ref_cnt > 0);
+    if (--pkt->ref_cnt == 0) {
+	pkt->next = pp->free_list;
+	pp->free_list = pkt;
+	pp->free_cnt++;
+    }
+    pj_lock_release(pp->lock);
+}
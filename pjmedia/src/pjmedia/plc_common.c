@@ -19,6 +19,7 @@
  */
 #include <pjmedia/plc.h>
 #include <pjmedia/errno.h>
+#include <pjmedia/frame.h>
 #include <pjmedia/wsola.h>
 #include <pj/assert.h>
 #include <pj/pool.h>
@@ -110,6 +111,113 @@ PJ_DEF(pj_status_t) pjmedia_plc_generate( pjmedia_plc *plc,
 }
 
 
+/* Shortest and longest pitch period searched by pjmedia_plc_interpolate(),
+ * in Hz.
+ */
+#define INTERP_MAX_PITCH_HZ	400
+#define INTERP_MIN_PITCH_HZ	70
+
+/* Longest frame supported by pjmedia_plc_interpolate(), 20 ms at 48 KHz */
+#define INTERP_MAX_COUNT	960
+
+/* Find the pitch period at the start of the frame, i.e: the lag that best
+ * correlates the beginning of the frame with itself.
+ */
+static unsigned find_period(const pj_int16_t frm[], unsigned count,
+			    unsigned min_p, unsigned max_p)
+{
+    unsigned wnd = count - max_p;
+    unsigned p, best = max_p;
+    pj_int64_t best_corr = 0;
+
+    for (p=min_p; p<=max_p; ++p) {
+	pj_int64_t corr = 0;
+	unsigned i;
+
+	for (i=0; i<wnd; ++i)
+	    corr += (pj_int32_t)frm[i] * frm[i+p];
+
+	if (corr > best_corr) {
+	    best_corr = corr;
+	    best = p;
+	}
+    }
+
+    return best;
+}
+
+
+/*
+ * Interpolate a replacement frame towards the next frame.
+ */
+PJ_DEF(pj_status_t) pjmedia_plc_interpolate( unsigned clock_rate,
+					     pj_int16_t frame[],
+					     const pj_int16_t next[],
+					     unsigned count)
+{
+    pj_int16_t ext[INTERP_MAX_COUNT];
+    unsigned min_p, max_p, period, xfade, pos, n;
+    unsigned step = (count + 159) / 160;
+    pj_int64_t best_corr;
+
+    PJ_ASSERT_RETURN(clock_rate && frame && next && count, PJ_EINVAL);
+
+    /* Longer frames depend on the stream's ptime, they're not a bug */
+    if (count > INTERP_MAX_COUNT)
+	return PJ_ETOOBIG;
+
+    /* Leave at least half of the frame for the correlation window */
+    min_p = clock_rate / INTERP_MAX_PITCH_HZ;
+    max_p = clock_rate / INTERP_MIN_PITCH_HZ;
+    if (max_p > count / 2)
+	max_p = count / 2;
+    if (max_p == 0)
+	return PJ_ETOOSMALL;
+    if (min_p == 0)
+	min_p = 1;
+    if (min_p > max_p)
+	min_p = max_p;
+
+    period = find_period(next, count, min_p, max_p);
+
+    /* Extend the next frame backwards, so that the last sample lines up
+     * with next[period-1].
+     */
+    for (n=0; n<count; ++n)
+	ext[n] = next[(period - (count - n) % period) % period];
+
+    /* Crossfade from the extrapolation into the extension where the two
+     * are most alike in the second half of the frame, so that they don't
+     * cancel each other out. The extrapolation is more reliable near the
+     * start of the frame, the extension near the end.
+     */
+    xfade = count / 4;
+    pos = count - xfade;
+    best_corr = 0;
+    for (n=count/2-xfade/2; n+xfade<=count; n+=step) {
+	pj_int64_t corr = 0;
+	unsigned i;
+
+	for (i=0; i<xfade; ++i)
+	    corr += (pj_int32_t)frame[n+i] * ext[n+i];
+	if (corr > best_corr) {
+	    best_corr = corr;
+	    pos = n;
+	}
+    }
+
+    for (n=0; n<xfade; ++n) {
+	frame[pos+n] = (pj_int16_t)(((pj_int32_t)frame[pos+n] * (int)(xfade-n) +
+				     (pj_int32_t)ext[pos+n] * (int)n) /
+				    (int)xfade);
+    }
+    pjmedia_copy_samples(frame + pos + xfade, ext + pos + xfade,
+			 count - pos - xfade);
+
+    return PJ_SUCCESS;
+}
+
+
 //////////////////////////////////////////////////////////////////////////////
 /*
  * Packet loss concealment based on WSOLA
@@ -0,0 +1,380 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2011 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include <pjmedia/resample.h>
+#include <pjmedia/errno.h>
+#include <pj/assert.h>
+#include <pj/log.h>
+#include <pj/math.h>
+#include <pj/pool.h>
+#include <pj/string.h>
+
+#if PJMEDIA_RESAMPLE_IMP==PJMEDIA_RESAMPLE_POLYPHASE
+
+#include <math.h>
+
+/*
+ * Native fixed-point polyphase resampler.
+ *
+ * The conversion ratio rate_out/rate_in is reduced to L/M. Conceptually
+ * the input is upsampled by L, low-pass filtered and decimated by M. The
+ * prototype low-pass filter (a Kaiser windowed sinc of L*ntaps taps) is
+ * split into L phases of ntaps taps each, so every output sample is a
+ * single ntaps long dot product between the input history and one phase.
+ *
+ * The filter bank is designed when the session is created, with every
+ * phase normalized to unity DC gain and quantized to Q15. The taps of
+ * each phase are stored in reverse order, so the dot product walks the
+ * input and the coefficients in the same direction, which is done with
+ * PMADDWD on SSE2 and VMLAL on NEON.
+ */
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   define POLY_HAS_SSE2    1
+#   include <emmintrin.h>
+#else
+#   define POLY_HAS_SSE2    0
+#endif
+
+#if !POLY_HAS_SSE2 && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#   define POLY_HAS_NEON    1
+#   include <arm_neon.h>
+#else
+#   define POLY_HAS_NEON    0
+#endif
+
+#define THIS_FILE   "resample_polyphase.c"
+
+/* Taps per phase are a multiple of this, for the SIMD loops */
+#define TAP_ALIGN	8
+
+/* Coefficient fraction bits */
+#define COEF_SHIFT	15
+
+/* Maximum taps per phase */
+#define MAX_TAPS	512
+
+
+struct pjmedia_resample
+{
+    unsigned	 up;		/* Interpolation factor (L).		    */
+    unsigned	 down;		/* Decimation factor (M).		    */
+    unsigned	 ntaps;		/* Taps per phase.			    */
+    pj_int16_t	*bank;		/* up * ntaps coefficients, reversed.	    */
+
+    unsigned	 channel_cnt;	/* Channel count.			    */
+    unsigned	 in_samples;	/* Input samples per channel per frame.	    */
+    unsigned	 out_samples;	/* Output samples per channel per frame.    */
+    unsigned	 frame_size;	/* Input samples per frame (all channels).  */
+
+    /* Per channel input buffer: ntaps-1 samples of history followed by
+     * the current frame.
+     */
+    pj_int16_t **buf;
+};
+
+
+static unsigned gcd(unsigned a, unsigned b)
+{
+    while (b) {
+	unsigned t = a % b;
+	a = b;
+	b = t;
+    }
+    return a;
+}
+
+/* Zeroth order modified Bessel function of the first kind */
+static double bessel_i0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    unsigned k;
+
+    for (k = 1; k < 32; ++k) {
+	term *= (x / (2.0 * k)) * (x / (2.0 * k));
+	sum += term;
+	if (term < sum * 1e-12)
+	    break;
+    }
+    return sum;
+}
+
+/* Design the filter bank */
+static void design_bank(pjmedia_resample *rs, double rolloff, double beta)
+{
+    const double pi = 3.14159265358979323846;
+    unsigned len = rs->up * rs->ntaps;
+    double center = (len - 1) / 2.0;
+    double fc = rolloff * 0.5 / PJ_MAX(rs->up, rs->down);
+    double i0_beta = bessel_i0(beta);
+    double coef[MAX_TAPS];	    /* One phase, before quantization */
+    unsigned p, m;
+
+    pj_assert(rs->ntaps <= MAX_TAPS);
+
+    for (p = 0; p < rs->up; ++p) {
+	pj_int16_t *c = rs->bank + p * rs->ntaps;
+	double sum = 0;
+	int qsum = 0, peak = -32769;
+	unsigned peak_idx = 0;
+
+	/* Phase p holds taps p, p+L, p+2L, .. of the prototype filter */
+	for (m = 0; m < rs->ntaps; ++m) {
+	    double t = (p + (double)m * rs->up) - center;
+	    double r = t / (center + 1);
+	    double h;
+
+	    h = (t == 0) ? 1.0 : sin(2 * pi * fc * t) / (2 * pi * fc * t);
+	    h *= bessel_i0(beta * sqrt(PJ_MAX(0.0, 1.0 - r * r))) / i0_beta;
+	    coef[m] = h;
+	    sum += h;
+	}
+
+	/* Normalize to unity gain and quantize, reversed. Put the rounding
+	 * error on the largest tap, when it fits, so the phase gain is exact.
+	 */
+	for (m = 0; m < rs->ntaps; ++m) {
+	    double v = coef[m] / sum * (1 << COEF_SHIFT);
+	    int q = (int)floor(v + 0.5);
+
+	    if (q > 32767) q = 32767;
+	    if (q < -32768) q = -32768;
+	    c[rs->ntaps - 1 - m] = (pj_int16_t)q;
+	    qsum += q;
+	    if (q > peak) {
+		peak = q;
+		peak_idx = rs->ntaps - 1 - m;
+	    }
+	}
+	peak += (1 << COEF_SHIFT) - qsum;
+	if (peak >= -32768 && peak <= 32767)
+	    c[peak_idx] = (pj_int16_t)peak;
+    }
+}
+
+
+/* Dot product of ntaps input samples and coefficients */
+#if POLY_HAS_SSE2
+static pj_int32_t dot_product(const pj_int16_t *x, const pj_int16_t *c,
+			      unsigned ntaps)
+{
+    __m128i acc = _mm_setzero_si128();
+    unsigned j;
+
+    for (j = 0; j < ntaps; j += 8) {
+	acc = _mm_add_epi32(acc,
+			    _mm_madd_epi16(
+				_mm_loadu_si128((const __m128i*)(x + j)),
+				_mm_load_si128((const __m128i*)(c + j))));
+    }
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0x4E));
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0xB1));
+    return _mm_cvtsi128_si32(acc);
+}
+#elif POLY_HAS_NEON
+static pj_int32_t dot_product(const pj_int16_t *x, const pj_int16_t *c,
+			      unsigned ntaps)
+{
+    int32x4_t acc = vdupq_n_s32(0);
+    int32x2_t sum;
+    unsigned j;
+
+    for (j = 0; j < ntaps; j += 8) {
+	int16x8_t a = vld1q_s16(x + j);
+	int16x8_t b = vld1q_s16(c + j);
+
+	acc = vmlal_s16(acc, vget_low_s16(a), vget_low_s16(b));
+	acc = vmlal_s16(acc, vget_high_s16(a), vget_high_s16(b));
+    }
+    sum = vadd_s32(vget_low_s32(acc), vget_high_s32(acc));
+    sum = vpadd_s32(sum, sum);
+    return vget_lane_s32(sum, 0);
+}
+#else
+static pj_int32_t dot_product(const pj_int16_t *x, const pj_int16_t *c,
+			      unsigned ntaps)
+{
+    pj_int32_t acc = 0;
+    unsigned j;
+
+    for (j = 0; j < ntaps; ++j)
+	acc += (pj_int32_t)x[j] * c[j];
+    return acc;
+}
+#endif
+
+
+PJ_DEF(pj_status_t) pjmedia_resample_create( pj_pool_t *pool,
+					     pj_bool_t high_quality,
+					     pj_bool_t large_filter,
+					     unsigned channel_count,
+					     unsigned rate_in,
+					     unsigned rate_out,
+					     unsigned samples_per_frame,
+					     pjmedia_resample **p_resample)
+{
+    pjmedia_resample *resample;
+    unsigned g, base_taps, i;
+    double rolloff, beta;
+
+    PJ_ASSERT_RETURN(pool && p_resample && rate_in && rate_out &&
+		     channel_count && samples_per_frame, PJ_EINVAL);
+    PJ_ASSERT_RETURN(samples_per_frame % channel_count == 0, PJ_EINVAL);
+
+    resample = PJ_POOL_ZALLOC_T(pool, pjmedia_resample);
+    PJ_ASSERT_RETURN(resample, PJ_ENOMEM);
+
+    g = gcd(rate_in, rate_out);
+    resample->up = rate_out / g;
+    resample->down = rate_in / g;
+    resample->channel_cnt = channel_count;
+    resample->frame_size = samples_per_frame;
+    resample->in_samples = samples_per_frame / channel_count;
+
+    /* The frame must map to a whole number of output samples */
+    if ((resample->in_samples * resample->up) % resample->down != 0)
+	return PJMEDIA_ENCSAMPLESPFRAME;
+    resample->out_samples = resample->in_samples * resample->up /
+			    resample->down;
+
+    /* Filter length, in input samples. Decimation stretches the filter
+     * in proportion to the lower cutoff.
+     */
+    if (!high_quality) {
+	base_taps = 8;
+	rolloff = 0.80;
+	beta = 5.0;
+    } else if (!large_filter) {
+	base_taps = 16;
+	rolloff = 0.88;
+	beta = 7.0;
+    } else {
+	base_taps = 32;
+	rolloff = 0.92;
+	beta = 8.5;
+    }
+    resample->ntaps = base_taps * resample->down / resample->up;
+    resample->ntaps = PJ_MAX(resample->ntaps, base_taps);
+    resample->ntaps = (resample->ntaps + TAP_ALIGN - 1) & ~(TAP_ALIGN - 1);
+    if (resample->ntaps > MAX_TAPS)
+	return PJ_ETOOBIG;
+
+    /* Filter bank, 16 byte aligned for the SIMD loads */
+    resample->bank = (pj_int16_t*)
+		     pj_pool_alloc(pool, resample->up * resample->ntaps *
+					 sizeof(pj_int16_t) + 16);
+    PJ_ASSERT_RETURN(resample->bank, PJ_ENOMEM);
+    resample->bank = (pj_int16_t*)(((pj_size_t)resample->bank + 15) &
+				   ~(pj_size_t)15);
+    design_bank(resample, rolloff, beta);
+
+    /* Input buffers */
+    resample->buf = (pj_int16_t**)
+		    pj_pool_calloc(pool, channel_count, sizeof(pj_int16_t*));
+    for (i = 0; i < channel_count; ++i) {
+	resample->buf[i] = (pj_int16_t*)
+			   pj_pool_zalloc(pool, (resample->ntaps - 1 +
+						 resample->in_samples) *
+						sizeof(pj_int16_t));
+	PJ_ASSERT_RETURN(resample->buf[i], PJ_ENOMEM);
+    }
+
+    *p_resample = resample;
+
+    PJ_LOG(5,(THIS_FILE, "resample created: %s quality, %s filter, "
+			 "ch=%d, in/out rate=%d/%d, L/M=%d/%d, %d taps/phase",
+	      (high_quality ? "high" : "low"),
+	      (large_filter ? "large" : "small"),
+	      channel_count, rate_in, rate_out,
+	      resample->up, resample->down, resample->ntaps));
+
+    return PJ_SUCCESS;
+}
+
+
+PJ_DEF(void) pjmedia_resample_run( pjmedia_resample *resample,
+				   const pj_int16_t *input,
+				   pj_int16_t *output )
+{
+    unsigned ch, hist;
+
+    PJ_ASSERT_ON_FAIL(resample, return);
+
+    hist = resample->ntaps - 1;
+
+    for (ch = 0; ch < resample->channel_cnt; ++ch) {
+	pj_int16_t *buf = resample->buf[ch];
+	pj_int16_t *dst = output + ch;
+	unsigned phase = 0, pos = 0, i;
+
+	/* Append the frame to the history */
+	if (resample->channel_cnt == 1) {
+	    pjmedia_copy_samples(buf + hist, input, resample->in_samples);
+	} else {
+	    for (i = 0; i < resample->in_samples; ++i)
+		buf[hist + i] = input[i * resample->channel_cnt + ch];
+	}
+
+	/* Output sample k uses input samples up to k*M/L, with the phase
+	 * (k*M) mod L. The phase returns to zero at the end of each frame,
+	 * since the frame maps to a whole number of output samples.
+	 */
+	for (i = 0; i < resample->out_samples; ++i) {
+	    pj_int32_t acc;
+
+	    acc = dot_product(buf + pos,
+			      resample->bank + phase * resample->ntaps,
+			      resample->ntaps);
+	    acc = (acc + (1 << (COEF_SHIFT - 1))) >> COEF_SHIFT;
+	    if (acc > 32767) acc = 32767;
+	    else if (acc < -32768) acc = -32768;
+
+	    *dst = (pj_int16_t)acc;
+	    dst += resample->channel_cnt;
+
+	    phase += resample->down;
+	    while (phase >= resample->up) {
+		phase -= resample->up;
+		++pos;
+	    }
+	}
+
+	/* Keep the last ntaps-1 samples as history */
+	pjmedia_move_samples(buf, buf + resample->in_samples, hist);
+    }
+}
+
+
+PJ_DEF(unsigned) pjmedia_resample_get_input_size(pjmedia_resample *resample)
+{
+    PJ_ASSERT_RETURN(resample != NULL, 0);
+    return resample->frame_size;
+}
+
+
+PJ_DEF(void) pjmedia_resample_destroy(pjmedia_resample *resample)
+{
+    PJ_UNUSED_ARG(resample);
+}
+
+#else /* PJMEDIA_RESAMPLE_IMP==PJMEDIA_RESAMPLE_POLYPHASE */
+
+int pjmedia_resample_polyphase_excluded;
+
+#endif	/* PJMEDIA_RESAMPLE_IMP==PJMEDIA_RESAMPLE_POLYPHASE */
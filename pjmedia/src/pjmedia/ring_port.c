@@ -0,0 +1,492 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2011 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include <pjmedia/ring_port.h>
+#include <pjmedia/circbuf.h>
+#include <pjmedia/errno.h>
+#include <pjmedia/wsola.h>
+#include <pj/assert.h>
+#include <pj/log.h>
+#include <pj/math.h>
+#include <pj/os.h>
+#include <pj/pool.h>
+#include <pj/string.h>
+
+
+#define SIGNATURE	    PJMEDIA_SIG_PORT_RING
+#define THIS_FILE	    "ring_port.c"
+
+/* Length of the window, in ms, over which the consumer observes the
+ * minimum ring level before deciding to shrink the audio.
+ */
+#define DRIFT_WINDOW_MSEC   1000
+
+/* Space to keep the producer and consumer indexes in separate cache
+ * lines, so that they don't bounce between cores on every frame.
+ */
+#define CACHE_LINE_SIZE	    64
+
+
+/*
+ * The read and write indexes are the only state shared by the producer
+ * and the consumer. Each is written by one side only, with release
+ * semantics so that the slot contents are visible before the index
+ * update, and read by the other side with acquire semantics. Indexes
+ * run freely and wrap around at 2^32; the slot count is a power of two
+ * so that masking the index is consistent across the wrap.
+ */
+#if (defined(__GNUC__) && (__GNUC__ > 4 || \
+			   (__GNUC__ == 4 && __GNUC_MINOR__ >= 7))) || \
+    defined(__clang__)
+
+typedef pj_uint32_t ring_idx_t;
+#   define IDX_INIT(pool, p)	(*(p) = 0, PJ_SUCCESS)
+#   define IDX_DESTROY(p)
+#   define IDX_LOAD(p)		__atomic_load_n(p, __ATOMIC_ACQUIRE)
+#   define IDX_STORE(p, v)	__atomic_store_n(p, v, __ATOMIC_RELEASE)
+
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+
+#   include <intrin.h>
+#   pragma intrinsic(_ReadWriteBarrier)
+
+/* x86 does not reorder loads with other loads nor stores with other
+ * stores, so preventing compiler reordering is sufficient.
+ */
+typedef volatile pj_uint32_t ring_idx_t;
+#   define IDX_INIT(pool, p)	(*(p) = 0, PJ_SUCCESS)
+#   define IDX_DESTROY(p)
+#   define IDX_LOAD(p)		idx_load(p)
+#   define IDX_STORE(p, v)	idx_store(p, v)
+
+static pj_uint32_t idx_load(ring_idx_t *p)
+{
+    pj_uint32_t v = *p;
+    _ReadWriteBarrier();
+    return v;
+}
+
+static void idx_store(ring_idx_t *p, pj_uint32_t v)
+{
+    _ReadWriteBarrier();
+    *p = v;
+}
+
+#else
+
+/* No known barrier primitive for this compiler, fall back to pj_atomic,
+ * which is correct although it may be implemented with a mutex.
+ */
+typedef pj_atomic_t *ring_idx_t;
+#   define IDX_INIT(pool, p)	pj_atomic_create(pool, 0, p)
+#   define IDX_DESTROY(p)	pj_atomic_destroy(*(p))
+#   define IDX_LOAD(p)		((pj_uint32_t)pj_atomic_get(*(p)))
+#   define IDX_STORE(p, v)	pj_atomic_set(*(p), (pj_atomic_value_t)(v))
+
+#endif
+
+
+struct ring_port
+{
+    pjmedia_port	 base;
+    unsigned		 options;
+    unsigned		 spf;		/**< Samples per frame.		    */
+    unsigned		 max_frames;	/**< Ring capacity, in frames.	    */
+    unsigned		 mask;		/**< Slot count - 1.		    */
+    unsigned		 target;	/**< Target level, in frames.	    */
+    unsigned		 window;	/**< Drift window, in frames.	    */
+    pj_int16_t		*buf;		/**< Slots storage.		    */
+
+    /* Producer side */
+    ring_idx_t		 write_idx;
+    unsigned		 put_cnt;
+    unsigned		 overflow_cnt;
+    char		 pad_[CACHE_LINE_SIZE];
+
+    /* Consumer side */
+    ring_idx_t		 read_idx;
+    unsigned		 get_cnt;
+    unsigned		 underflow_cnt;
+    unsigned		 shrink_samples;
+    unsigned		 expand_frames;
+
+    /* Drift compensation, only used by the consumer */
+    pjmedia_wsola	*wsola;		/**< Shrink and expand the audio.   */
+    pjmedia_circ_buf	*stage;		/**< Samples taken out of the ring. */
+    pj_bool_t		 primed;	/**< Ring has reached target level. */
+    pj_bool_t		 prev_lost;	/**< Last frame was synthesized.    */
+    unsigned		 win_cnt;	/**< Frames in current window.	    */
+    unsigned		 win_min;	/**< Minimum level in the window.   */
+    unsigned		 shrink_cnt;	/**< Samples still to be removed.   */
+};
+
+
+static pj_status_t ring_put_frame(pjmedia_port *this_port,
+				  pjmedia_frame *frame);
+static pj_status_t ring_get_frame(pjmedia_port *this_port,
+				  pjmedia_frame *frame);
+static pj_status_t ring_on_destroy(pjmedia_port *this_port);
+
+
+PJ_DEF(pj_status_t) pjmedia_ring_port_create(pj_pool_t *pool,
+					     const char *name,
+					     unsigned clock_rate,
+					     unsigned channel_count,
+					     unsigned samples_per_frame,
+					     unsigned bits_per_sample,
+					     unsigned max_frames,
+					     unsigned options,
+					     pjmedia_port **p_port)
+{
+    struct ring_port *rp;
+    pj_str_t port_name;
+    unsigned slot_cnt;
+    pj_status_t status;
+
+    PJ_ASSERT_RETURN(pool && clock_rate && channel_count &&
+		     samples_per_frame && max_frames && p_port, PJ_EINVAL);
+    PJ_ASSERT_RETURN(bits_per_sample == 16, PJMEDIA_ENCBITS);
+
+    if (!name)
+	name = "ring";
+
+    rp = PJ_POOL_ZALLOC_T(pool, struct ring_port);
+    PJ_ASSERT_RETURN(rp != NULL, PJ_ENOMEM);
+
+    pj_strdup2_with_null(pool, &port_name, name);
+    pjmedia_port_info_init(&rp->base.info, &port_name, SIGNATURE,
+			   clock_rate, channel_count, bits_per_sample,
+			   samples_per_frame);
+
+    for (slot_cnt = 1; slot_cnt < max_frames; slot_cnt <<= 1)
+	;
+
+    rp->options = options;
+    rp->spf = samples_per_frame;
+    rp->max_frames = max_frames;
+    rp->mask = slot_cnt - 1;
+    rp->target = (max_frames + 1) / 2;
+    rp->window = DRIFT_WINDOW_MSEC * clock_rate * channel_count /
+		 samples_per_frame / 1000;
+    if (rp->window == 0)
+	rp->window = 1;
+    rp->win_min = (unsigned)-1;
+
+    rp->buf = (pj_int16_t*)
+	      pj_pool_calloc(pool, slot_cnt * samples_per_frame,
+			     sizeof(pj_int16_t));
+    PJ_ASSERT_RETURN(rp->buf != NULL, PJ_ENOMEM);
+
+    status = IDX_INIT(pool, &rp->write_idx);
+    if (status != PJ_SUCCESS)
+	return status;
+
+    status = IDX_INIT(pool, &rp->read_idx);
+    if (status != PJ_SUCCESS)
+	return status;
+
+    if ((options & PJMEDIA_RING_PORT_NO_DRIFT_COMP) == 0) {
+	/* The stage holds less than one frame of leftover samples plus
+	 * up to two frames taken out of the ring.
+	 */
+	status = pjmedia_circ_buf_create(pool, 3 * samples_per_frame,
+					 &rp->stage);
+	if (status != PJ_SUCCESS)
+	    return status;
+
+	status = pjmedia_wsola_create(pool, clock_rate, samples_per_frame,
+				      channel_count, 0, &rp->wsola);
+	if (status != PJ_SUCCESS)
+	    return status;
+    }
+
+    rp->base.put_frame = &ring_put_frame;
+    rp->base.get_frame = &ring_get_frame;
+    rp->base.on_destroy = &ring_on_destroy;
+
+    PJ_LOG(5,(name, "Ring port created: %u frames of %u samples%s",
+	      max_frames, samples_per_frame,
+	      (rp->wsola ? ", with drift compensation" : "")));
+
+    *p_port = &rp->base;
+    return PJ_SUCCESS;
+}
+
+
+/* Get the number of frames in the ring. */
+static unsigned ring_level(struct ring_port *rp)
+{
+    pj_uint32_t r = IDX_LOAD(&rp->read_idx);
+    pj_uint32_t w = IDX_LOAD(&rp->write_idx);
+
+    return (unsigned)(w - r);
+}
+
+
+/* Consumer: get the oldest frame in the ring without removing it, or
+ * NULL if the ring is empty.
+ */
+static const pj_int16_t *peek_frame(struct ring_port *rp)
+{
+    pj_uint32_t r = IDX_LOAD(&rp->read_idx);
+    pj_uint32_t w = IDX_LOAD(&rp->write_idx);
+
+    if (w == r)
+	return NULL;
+
+    return rp->buf + (r & rp->mask) * rp->spf;
+}
+
+
+/* Consumer: release the frame returned by peek_frame(). */
+static void release_frame(struct ring_port *rp)
+{
+    pj_uint32_t r = IDX_LOAD(&rp->read_idx);
+
+    IDX_STORE(&rp->read_idx, r + 1);
+}
+
+
+/*
+ * Producer: put a frame to the ring.
+ */
+static pj_status_t ring_put_frame(pjmedia_port *this_port,
+				  pjmedia_frame *frame)
+{
+    struct ring_port *rp = (struct ring_port*)this_port;
+    pj_uint32_t w = IDX_LOAD(&rp->write_idx);
+    pj_uint32_t r = IDX_LOAD(&rp->read_idx);
+    pj_int16_t *slot;
+
+    if (w - r >= rp->max_frames) {
+	++rp->overflow_cnt;
+	return PJ_SUCCESS;
+    }
+
+    slot = rp->buf + (w & rp->mask) * rp->spf;
+    if (frame->type == PJMEDIA_FRAME_TYPE_AUDIO &&
+	frame->size >= rp->spf * sizeof(pj_int16_t))
+    {
+	pjmedia_copy_samples(slot, (const pj_int16_t*)frame->buf, rp->spf);
+    } else {
+	pjmedia_zero_samples(slot, rp->spf);
+    }
+
+    IDX_STORE(&rp->write_idx, w + 1);
+    ++rp->put_cnt;
+
+    return PJ_SUCCESS;
+}
+
+
+/* Consumer: remove some samples from the stage, see shrink_buffer() in
+ * delaybuf.c.
+ */
+static void shrink_stage(struct ring_port *rp)
+{
+    pj_int16_t *buf1, *buf2;
+    unsigned buf1len, buf2len;
+    unsigned erase_cnt;
+    pj_status_t status;
+
+    erase_cnt = PJ_MIN(rp->shrink_cnt, rp->spf / 2);
+    if (erase_cnt == 0 ||
+	pjmedia_circ_buf_get_len(rp->stage) <= erase_cnt * 2)
+    {
+	return;
+    }
+
+    pjmedia_circ_buf_get_read_regions(rp->stage, &buf1, &buf1len,
+				      &buf2, &buf2len);
+    status = pjmedia_wsola_discard(rp->wsola, buf1, buf1len, buf2, buf2len,
+				   &erase_cnt);
+    if (status != PJ_SUCCESS || erase_cnt == 0)
+	return;
+
+    pjmedia_circ_buf_set_len(rp->stage,
+			     pjmedia_circ_buf_get_len(rp->stage) - erase_cnt);
+    rp->shrink_cnt -= PJ_MIN(rp->shrink_cnt, erase_cnt);
+    rp->shrink_samples += erase_cnt;
+}
+
+
+/* Consumer: get a frame with drift compensation. */
+static void get_frame_drift(struct ring_port *rp, pj_int16_t *dst)
+{
+    const pj_int16_t *slot;
+
+    if (!rp->primed && ring_level(rp) >= rp->target)
+	rp->primed = PJ_TRUE;
+
+    if (rp->primed) {
+	unsigned level;
+
+	/* Track the lowest level seen in the window. If the ring never went
+	 * below the target, the producer is running faster than us.
+	 */
+	level = ring_level(rp);
+	if (level < rp->win_min)
+	    rp->win_min = level;
+	if (++rp->win_cnt >= rp->window) {
+	    if (rp->win_min > rp->target)
+		rp->shrink_cnt = (rp->win_min - rp->target) * rp->spf;
+	    rp->win_cnt = 0;
+	    rp->win_min = (unsigned)-1;
+	}
+
+	/* Give WSOLA two frames to work with when shrinking */
+	if (rp->shrink_cnt) {
+	    while (pjmedia_circ_buf_get_len(rp->stage) < 2 * rp->spf &&
+		   (slot = peek_frame(rp)) != NULL)
+	    {
+		pjmedia_circ_buf_write(rp->stage, (pj_int16_t*)slot,
+				       rp->spf);
+		release_frame(rp);
+	    }
+	    shrink_stage(rp);
+	}
+
+	/* Top up the stage to at least one frame */
+	while (pjmedia_circ_buf_get_len(rp->stage) < rp->spf &&
+	       (slot = peek_frame(rp)) != NULL)
+	{
+	    pjmedia_circ_buf_write(rp->stage, (pj_int16_t*)slot, rp->spf);
+	    release_frame(rp);
+	}
+    }
+
+    if (rp->primed && pjmedia_circ_buf_get_len(rp->stage) >= rp->spf) {
+	pjmedia_circ_buf_read(rp->stage, dst, rp->spf);
+	pjmedia_wsola_save(rp->wsola, dst, rp->prev_lost);
+	rp->prev_lost = PJ_FALSE;
+    } else {
+	if (rp->primed) {
+	    /* Ran dry, wait until the ring refills to the target level */
+	    ++rp->underflow_cnt;
+	    rp->primed = PJ_FALSE;
+	}
+	pjmedia_wsola_generate(rp->wsola, dst);
+	rp->prev_lost = PJ_TRUE;
+	++rp->expand_frames;
+    }
+}
+
+
+/*
+ * Consumer: get a frame from the ring.
+ */
+static pj_status_t ring_get_frame(pjmedia_port *this_port,
+				  pjmedia_frame *frame)
+{
+    struct ring_port *rp = (struct ring_port*)this_port;
+    pj_int16_t *dst = (pj_int16_t*)frame->buf;
+
+    frame->type = PJMEDIA_FRAME_TYPE_AUDIO;
+    frame->size = rp->spf * sizeof(pj_int16_t);
+    ++rp->get_cnt;
+
+    if (rp->wsola) {
+	get_frame_drift(rp, dst);
+    } else {
+	const pj_int16_t *slot = peek_frame(rp);
+
+	if (slot) {
+	    pjmedia_copy_samples(dst, slot, rp->spf);
+	    release_frame(rp);
+	} else {
+	    pjmedia_zero_samples(dst, rp->spf);
+	    ++rp->underflow_cnt;
+	}
+    }
+
+    return PJ_SUCCESS;
+}
+
+
+/*
+ * Destroy port.
+ */
+static pj_status_t ring_on_destroy(pjmedia_port *this_port)
+{
+    struct ring_port *rp = (struct ring_port*)this_port;
+
+    if (rp->wsola) {
+	pjmedia_wsola_destroy(rp->wsola);
+	rp->wsola = NULL;
+    }
+
+    IDX_DESTROY(&rp->write_idx);
+    IDX_DESTROY(&rp->read_idx);
+
+    return PJ_SUCCESS;
+}
+
+
+PJ_DEF(unsigned) pjmedia_ring_port_get_level(pjmedia_port *port)
+{
+    PJ_ASSERT_RETURN(port && port->info.signature == SIGNATURE, 0);
+
+    return ring_level((struct ring_port*)port);
+}
+
+
+PJ_DEF(pj_status_t) pjmedia_ring_port_get_stat(pjmedia_port *port,
+					       pjmedia_ring_port_stat *stat)
+{
+    struct ring_port *rp = (struct ring_port*)port;
+
+    PJ_ASSERT_RETURN(port && stat, PJ_EINVAL);
+    PJ_ASSERT_RETURN(port->info.signature == SIGNATURE, PJ_EINVALIDOP);
+
+    stat->level = ring_level(rp);
+    stat->put_cnt = rp->put_cnt;
+    stat->get_cnt = rp->get_cnt;
+    stat->overflow_cnt = rp->overflow_cnt;
+    stat->underflow_cnt = rp->underflow_cnt;
+    stat->shrink_samples = rp->shrink_samples;
+    stat->expand_frames = rp->expand_frames;
+
+    return PJ_SUCCESS;
+}
+
+
+PJ_DEF(pj_status_t) pjmedia_ring_port_reset(pjmedia_port *port)
+{
+    struct ring_port *rp = (struct ring_port*)port;
+
+    PJ_ASSERT_RETURN(port, PJ_EINVAL);
+    PJ_ASSERT_RETURN(port->info.signature == SIGNATURE, PJ_EINVALIDOP);
+
+    /* Consumer owns the read index, so discarding is just catching up
+     * with the producer.
+     */
+    IDX_STORE(&rp->read_idx, IDX_LOAD(&rp->write_idx));
+
+    if (rp->wsola) {
+	pjmedia_circ_buf_reset(rp->stage);
+	pjmedia_wsola_reset(rp->wsola, 0);
+	rp->primed = PJ_FALSE;
+	rp->prev_lost = PJ_FALSE;
+	rp->win_cnt = 0;
+	rp->win_min = (unsigned)-1;
+	rp->shrink_cnt = 0;
+    }
+
+    return PJ_SUCCESS;
+}
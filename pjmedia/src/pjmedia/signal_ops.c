@@ -0,0 +1,302 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2011 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include <pjmedia/signal_ops.h>
+
+/*
+ * Signal level and gain kernels.
+ *
+ * The SIMD kernels process eight samples per iteration and leave the
+ * remaining samples to the portable loops, so they produce exactly the
+ * same result as the portable code. The absolute value of -32768 does not
+ * fit in a signed 16-bit lane, so the level is accumulated from unsigned
+ * magnitudes widened to 32 bits. The gain is applied with a 16x16 bit
+ * multiplication into 32-bit products, which are shifted and then clipped
+ * by the saturating pack (PACKSSDW on SSE2, VQMOVN on NEON).
+ *
+ * For 32-bit sources, SSE2 has no signed 32x32 bit multiplication, so the
+ * sample is split into x = xh * 2^15 + xl, with xl in 0..32767, and
+ * (x * gain) >> 12 is calculated as ((xh * gain) << 3) + ((xl * gain) >> 12)
+ * with two PMADDWD, which is exact as long as the result fits in 32 bits.
+ * NEON uses a widening 32x32 bit multiplication instead.
+ *
+ * The SIMD kernels are only used for gains up to 0x7FFF (eight times the
+ * unity gain), which covers all the gain values used by pjmedia.
+ */
+#if defined(PJMEDIA_HAS_SIGNAL_SIMD) && PJMEDIA_HAS_SIGNAL_SIMD!=0 && \
+    (defined(__SSE2__) || defined(_M_X64) || \
+     (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#   define SIGNAL_HAS_SSE2  1
+#   include <emmintrin.h>
+#else
+#   define SIGNAL_HAS_SSE2  0
+#endif
+
+#if defined(PJMEDIA_HAS_SIGNAL_SIMD) && PJMEDIA_HAS_SIGNAL_SIMD!=0 && \
+    !SIGNAL_HAS_SSE2 && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#   define SIGNAL_HAS_NEON  1
+#   include <arm_neon.h>
+#else
+#   define SIGNAL_HAS_NEON  0
+#endif
+
+#define MAX_SIMD_GAIN	0x7FFF
+#define GAIN_SHIFT	12
+
+
+PJ_INLINE(pj_int16_t) clip16(pj_int32_t val)
+{
+    if (val > 32767)
+	return 32767;
+    else if (val < -32768)
+	return -32768;
+    else
+	return (pj_int16_t)val;
+}
+
+PJ_INLINE(pj_uint32_t) abs16(pj_int16_t val)
+{
+    return (val < 0) ? (pj_uint32_t)(-(pj_int32_t)val) : (pj_uint32_t)val;
+}
+
+/* Portable implementation of the gain, for 16-bit and 32-bit sources. */
+static pj_uint32_t apply_gain_c(pj_int16_t dst[], const pj_int16_t src16[],
+				const pj_int32_t src32[], pj_size_t count,
+				unsigned gain)
+{
+    pj_uint32_t sum = 0;
+    pj_size_t i;
+
+    for (i=0; i<count; ++i) {
+	pj_int64_t val = src16 ? src16[i] : src32[i];
+
+	dst[i] = clip16((pj_int32_t)((val * gain) >> GAIN_SHIFT));
+	sum += abs16(dst[i]);
+    }
+
+    return sum;
+}
+
+
+#if SIGNAL_HAS_SSE2
+
+/* Add the magnitudes of eight samples to four 32-bit accumulators. */
+PJ_INLINE(__m128i) sum_abs8(__m128i acc, __m128i x)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sign = _mm_srai_epi16(x, 15);
+    __m128i mag = _mm_sub_epi16(_mm_xor_si128(x, sign), sign);
+
+    acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(mag, zero));
+    return _mm_add_epi32(acc, _mm_unpackhi_epi16(mag, zero));
+}
+
+PJ_INLINE(pj_uint32_t) hsum(__m128i acc)
+{
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1,0,3,2)));
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2,3,0,1)));
+    return (pj_uint32_t)_mm_cvtsi128_si32(acc);
+}
+
+static pj_uint32_t sum_abs_simd(const pj_int16_t samples[], pj_size_t n)
+{
+    __m128i acc = _mm_setzero_si128();
+    pj_size_t i;
+
+    for (i=0; i<n; i+=8) {
+	acc = sum_abs8(acc, _mm_loadu_si128((const __m128i*)(samples+i)));
+    }
+    return hsum(acc);
+}
+
+static pj_uint32_t apply_gain_simd(pj_int16_t samples[], pj_size_t n,
+				   unsigned gain)
+{
+    const __m128i g = _mm_set1_epi16((short)gain);
+    __m128i acc = _mm_setzero_si128();
+    pj_size_t i;
+
+    for (i=0; i<n; i+=8) {
+	__m128i x = _mm_loadu_si128((const __m128i*)(samples+i));
+	__m128i lo = _mm_mullo_epi16(x, g);
+	__m128i hi = _mm_mulhi_epi16(x, g);
+	__m128i p0 = _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), GAIN_SHIFT);
+	__m128i p1 = _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), GAIN_SHIFT);
+
+	x = _mm_packs_epi32(p0, p1);
+	_mm_storeu_si128((__m128i*)(samples+i), x);
+	acc = sum_abs8(acc, x);
+    }
+    return hsum(acc);
+}
+
+/* (x * gain) >> 12 of four 32-bit samples, see the description above.
+ * The gain is in the low half of each 32-bit lane of g.
+ */
+PJ_INLINE(__m128i) mul_gain32(__m128i x, __m128i g)
+{
+    const __m128i mask = _mm_set1_epi32(0x7FFF);
+    __m128i xh = _mm_madd_epi16(_mm_srai_epi32(x, 15), g);
+    __m128i xl = _mm_madd_epi16(_mm_and_si128(x, mask), g);
+
+    return _mm_add_epi32(_mm_slli_epi32(xh, 15 - GAIN_SHIFT),
+			 _mm_srli_epi32(xl, GAIN_SHIFT));
+}
+
+static pj_uint32_t apply_gain32_simd(pj_int16_t dst[],
+				     const pj_int32_t src[],
+				     pj_size_t n, unsigned gain)
+{
+    const __m128i g = _mm_set1_epi32((int)gain);
+    __m128i acc = _mm_setzero_si128();
+    pj_size_t i;
+
+    for (i=0; i<n; i+=8) {
+	/* Both loads must happen before the store, since dst may alias
+	 * the start of the same eight source samples.
+	 */
+	__m128i x0 = _mm_loadu_si128((const __m128i*)(src+i));
+	__m128i x1 = _mm_loadu_si128((const __m128i*)(src+i+4));
+	__m128i x = _mm_packs_epi32(mul_gain32(x0, g), mul_gain32(x1, g));
+
+	_mm_storeu_si128((__m128i*)(dst+i), x);
+	acc = sum_abs8(acc, x);
+    }
+    return hsum(acc);
+}
+
+#elif SIGNAL_HAS_NEON
+
+static pj_uint32_t sum_abs_simd(const pj_int16_t samples[], pj_size_t n)
+{
+    int32x4_t acc0 = vdupq_n_s32(0), acc1 = vdupq_n_s32(0);
+    uint32x4_t acc;
+    pj_size_t i;
+
+    for (i=0; i<n; i+=8) {
+	int16x8_t x = vld1q_s16(samples+i);
+	acc0 = vabal_s16(acc0, vget_low_s16(x), vdup_n_s16(0));
+	acc1 = vabal_s16(acc1, vget_high_s16(x), vdup_n_s16(0));
+    }
+    acc = vreinterpretq_u32_s32(vaddq_s32(acc0, acc1));
+    return vgetq_lane_u32(acc, 0) + vgetq_lane_u32(acc, 1) +
+	   vgetq_lane_u32(acc, 2) + vgetq_lane_u32(acc, 3);
+}
+
+static pj_uint32_t apply_gain_simd(pj_int16_t samples[], pj_size_t n,
+				   unsigned gain)
+{
+    const int16x4_t g = vdup_n_s16((pj_int16_t)gain);
+    pj_size_t i;
+
+    for (i=0; i<n; i+=8) {
+	int16x8_t x = vld1q_s16(samples+i);
+	int32x4_t p0 = vshrq_n_s32(vmull_s16(vget_low_s16(x), g), GAIN_SHIFT);
+	int32x4_t p1 = vshrq_n_s32(vmull_s16(vget_high_s16(x), g),
+				   GAIN_SHIFT);
+
+	vst1q_s16(samples+i, vcombine_s16(vqmovn_s32(p0), vqmovn_s32(p1)));
+    }
+    return sum_abs_simd(samples, n);
+}
+
+static pj_uint32_t apply_gain32_simd(pj_int16_t dst[],
+				     const pj_int32_t src[],
+				     pj_size_t n, unsigned gain)
+{
+    const int32x2_t g = vdup_n_s32((pj_int32_t)gain);
+    pj_size_t i;
+
+    for (i=0; i<n; i+=8) {
+	/* Load everything before the store, dst may alias src. */
+	int32x4_t x0 = vld1q_s32(src+i);
+	int32x4_t x1 = vld1q_s32(src+i+4);
+	int32x4_t p0, p1;
+
+	p0 = vcombine_s32(
+		vshrn_n_s64(vmull_s32(vget_low_s32(x0), g), GAIN_SHIFT),
+		vshrn_n_s64(vmull_s32(vget_high_s32(x0), g), GAIN_SHIFT));
+	p1 = vcombine_s32(
+		vshrn_n_s64(vmull_s32(vget_low_s32(x1), g), GAIN_SHIFT),
+		vshrn_n_s64(vmull_s32(vget_high_s32(x1), g), GAIN_SHIFT));
+
+	vst1q_s16(dst+i, vcombine_s16(vqmovn_s32(p0), vqmovn_s32(p1)));
+    }
+    return sum_abs_simd(dst, n);
+}
+
+#endif	/* SIGNAL_HAS_NEON */
+
+
+PJ_DEF(pj_uint32_t) pjmedia_signal_sum_abs(const pj_int16_t samples[],
+					   pj_size_t count)
+{
+    pj_uint32_t sum = 0;
+    pj_size_t i = 0;
+
+#if SIGNAL_HAS_SSE2 || SIGNAL_HAS_NEON
+    i = count & ~((pj_size_t)7);
+    if (i)
+	sum = sum_abs_simd(samples, i);
+#endif
+
+    for (; i<count; ++i)
+	sum += abs16(samples[i]);
+
+    return sum;
+}
+
+
+PJ_DEF(pj_uint32_t) pjmedia_signal_apply_gain(pj_int16_t samples[],
+					      pj_size_t count,
+					      unsigned gain)
+{
+    pj_uint32_t sum = 0;
+    pj_size_t i = 0;
+
+#if SIGNAL_HAS_SSE2 || SIGNAL_HAS_NEON
+    if (gain <= MAX_SIMD_GAIN) {
+	i = count & ~((pj_size_t)7);
+	if (i)
+	    sum = apply_gain_simd(samples, i, gain);
+    }
+#endif
+
+    return sum + apply_gain_c(samples+i, samples+i, NULL, count-i, gain);
+}
+
+
+PJ_DEF(pj_uint32_t) pjmedia_signal_apply_gain32(pj_int16_t dst[],
+						const pj_int32_t src[],
+						pj_size_t count,
+						unsigned gain)
+{
+    pj_uint32_t sum = 0;
+    pj_size_t i = 0;
+
+#if SIGNAL_HAS_SSE2 || SIGNAL_HAS_NEON
+    if (gain <= MAX_SIMD_GAIN) {
+	i = count & ~((pj_size_t)7);
+	if (i)
+	    sum = apply_gain32_simd(dst, src, i, gain);
+    }
+#endif
+
+    return sum + apply_gain_c(dst+i, NULL, src+i, count-i, gain);
+}
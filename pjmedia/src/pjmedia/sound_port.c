@@ -22,6 +22,7 @@
 #include <pjmedia/delaybuf.h>
 #include <pjmedia/echo.h>
 #include <pjmedia/errno.h>
+#include <pjmedia/ring_port.h>
 #include <pj/assert.h>
 #include <pj/log.h>
 #include <pj/rand.h>
@@ -66,21 +67,24 @@ struct pjmedia_snd_port
     void		*user_data;
     pjmedia_aud_play_cb  on_play_frame;
     pjmedia_aud_rec_cb   on_rec_frame;
+
+    /* decoupled mode (PJMEDIA_SND_PORT_DECOUPLED) */
+    pjmedia_port	*play_ring;
+    pjmedia_port	*rec_ring;
+    pjmedia_clock	*clock;
+    void		*clock_buf;
 };
 
 /*
- * The callback called by sound player when it needs more samples to be
- * played.
+ * Get a frame to be played from the downstream port, and pass it to the
+ * echo canceller.
  */
-static pj_status_t play_cb(void *user_data, pjmedia_frame *frame)
+static void pull_play_frame(pjmedia_snd_port *snd_port, pjmedia_frame *frame)
 {
-    pjmedia_snd_port *snd_port = (pjmedia_snd_port*) user_data;
     pjmedia_port *port;
     const unsigned required_size = (unsigned)frame->size;
     pj_status_t status;
 
-    pjmedia_clock_src_update(&snd_port->play_clocksrc, &frame->timestamp);
-
     port = snd_port->port;
     if (port == NULL)
 	goto no_frame;
@@ -105,11 +109,7 @@ static pj_status_t play_cb(void *user_data, pjmedia_frame *frame)
 	pjmedia_echo_playback(snd_port->ec_state, (pj_int16_t*)frame->buf);
     }
 
-    /* Invoke preview callback */
-    if (snd_port->on_play_frame)
-	(*snd_port->on_play_frame)(snd_port->user_data, frame);
-
-    return PJ_SUCCESS;
+    return;
 
 no_frame:
     frame->type = PJMEDIA_FRAME_TYPE_AUDIO;
@@ -127,6 +127,41 @@ no_frame:
 	    pjmedia_echo_playback(snd_port->ec_state, (pj_int16_t*)frame->buf);
 	}
     }
+}
+
+
+/*
+ * Pass a captured frame to the echo canceller, then to the downstream
+ * port.
+ */
+static void push_rec_frame(pjmedia_snd_port *snd_port, pjmedia_frame *frame)
+{
+    pjmedia_port *port;
+
+    port = snd_port->port;
+    if (port == NULL)
+	return;
+
+    /* Cancel echo */
+    if (snd_port->ec_state && !snd_port->ec_suspended) {
+	pjmedia_echo_capture(snd_port->ec_state, (pj_int16_t*) frame->buf, 0);
+    }
+
+    pjmedia_port_put_frame(port, frame);
+}
+
+
+/*
+ * The callback called by sound player when it needs more samples to be
+ * played.
+ */
+static pj_status_t play_cb(void *user_data, pjmedia_frame *frame)
+{
+    pjmedia_snd_port *snd_port = (pjmedia_snd_port*) user_data;
+
+    pjmedia_clock_src_update(&snd_port->play_clocksrc, &frame->timestamp);
+
+    pull_play_frame(snd_port, frame);
 
     /* Invoke preview callback */
     if (snd_port->on_play_frame)
@@ -143,7 +178,6 @@ no_frame:
 static pj_status_t rec_cb(void *user_data, pjmedia_frame *frame)
 {
     pjmedia_snd_port *snd_port = (pjmedia_snd_port*) user_data;
-    pjmedia_port *port;
 
     pjmedia_clock_src_update(&snd_port->cap_clocksrc, &frame->timestamp);
 
@@ -151,21 +185,83 @@ static pj_status_t rec_cb(void *user_data, pjmedia_frame *frame)
     if (snd_port->on_rec_frame)
 	(*snd_port->on_rec_frame)(snd_port->user_data, frame);
 
-    port = snd_port->port;
-    if (port == NULL)
-	return PJ_SUCCESS;
+    push_rec_frame(snd_port, frame);
 
-    /* Cancel echo */
-    if (snd_port->ec_state && !snd_port->ec_suspended) {
-	pjmedia_echo_capture(snd_port->ec_state, (pj_int16_t*) frame->buf, 0);
-    }
+    return PJ_SUCCESS;
+}
 
-    pjmedia_port_put_frame(port, frame);
+/*
+ * The callback called by sound player when it needs more samples to be
+ * played. This version is for decoupled mode, the frame is taken from the
+ * playback ring which is filled by clock_cb().
+ */
+static pj_status_t play_cb_ring(void *user_data, pjmedia_frame *frame)
+{
+    pjmedia_snd_port *snd_port = (pjmedia_snd_port*) user_data;
+
+    pjmedia_clock_src_update(&snd_port->play_clocksrc, &frame->timestamp);
 
+    pjmedia_port_get_frame(snd_port->play_ring, frame);
+
+    /* Invoke preview callback */
+    if (snd_port->on_play_frame)
+	(*snd_port->on_play_frame)(snd_port->user_data, frame);
 
     return PJ_SUCCESS;
 }
 
+
+/*
+ * The callback called by sound recorder when it has finished capturing a
+ * frame. This version is for decoupled mode, the frame is queued to the
+ * capture ring which is drained by clock_cb().
+ */
+static pj_status_t rec_cb_ring(void *user_data, pjmedia_frame *frame)
+{
+    pjmedia_snd_port *snd_port = (pjmedia_snd_port*) user_data;
+
+    pjmedia_clock_src_update(&snd_port->cap_clocksrc, &frame->timestamp);
+
+    /* Invoke preview callback */
+    if (snd_port->on_rec_frame)
+	(*snd_port->on_rec_frame)(snd_port->user_data, frame);
+
+    pjmedia_port_put_frame(snd_port->rec_ring, frame);
+
+    return PJ_SUCCESS;
+}
+
+
+/*
+ * Media clock callback for decoupled mode. This exchanges one frame in
+ * each direction between the rings and the downstream port.
+ */
+static void clock_cb(const pj_timestamp *ts, void *user_data)
+{
+    pjmedia_snd_port *snd_port = (pjmedia_snd_port*) user_data;
+    pjmedia_frame frame;
+
+    pj_bzero(&frame, sizeof(frame));
+    frame.buf = snd_port->clock_buf;
+
+    if (snd_port->play_ring) {
+	frame.type = PJMEDIA_FRAME_TYPE_AUDIO;
+	frame.size = snd_port->samples_per_frame *
+		     snd_port->bits_per_sample / 8;
+	frame.timestamp = *ts;
+	pull_play_frame(snd_port, &frame);
+	pjmedia_port_put_frame(snd_port->play_ring, &frame);
+    }
+
+    if (snd_port->rec_ring) {
+	frame.size = snd_port->samples_per_frame *
+		     snd_port->bits_per_sample / 8;
+	frame.timestamp = *ts;
+	pjmedia_port_get_frame(snd_port->rec_ring, &frame);
+	push_rec_frame(snd_port, &frame);
+    }
+}
+
 /*
  * The callback called by sound player when it needs more samples to be
  * played. This version is for non-PCM data.
@@ -212,6 +308,89 @@ static pj_status_t rec_cb_ext(void *user_data, pjmedia_frame *frame)
     return PJ_SUCCESS;
 }
 
+static void destroy_decoupled(pjmedia_snd_port *snd_port);
+
+/*
+ * Create the rings and the media clock for decoupled mode. When the sound
+ * device is restarted, the rings, clock and buffer created by the previous
+ * start are reused as long as the frame size has not changed.
+ */
+static pj_status_t create_decoupled(pj_pool_t *pool,
+				    pjmedia_snd_port *snd_port)
+{
+    pj_status_t status;
+
+    if (snd_port->clock) {
+	pjmedia_port *ring = snd_port->play_ring ? snd_port->play_ring :
+						   snd_port->rec_ring;
+
+	if (ring && PJMEDIA_PIA_SPF(&ring->info) == 
+		    snd_port->samples_per_frame)
+	{
+	    /* Discard audio left from the previous run */
+	    if (snd_port->play_ring)
+		pjmedia_ring_port_reset(snd_port->play_ring);
+	    if (snd_port->rec_ring)
+		pjmedia_ring_port_reset(snd_port->rec_ring);
+	    return PJ_SUCCESS;
+	}
+
+	destroy_decoupled(snd_port);
+    }
+
+    if (snd_port->dir & PJMEDIA_DIR_PLAYBACK) {
+	status = pjmedia_ring_port_create(pool, "sndplay",
+					  snd_port->clock_rate,
+					  snd_port->channel_count,
+					  snd_port->samples_per_frame,
+					  snd_port->bits_per_sample,
+					  PJMEDIA_SND_PORT_RING_FRAMES, 0,
+					  &snd_port->play_ring);
+	if (status != PJ_SUCCESS)
+	    return status;
+    }
+
+    if (snd_port->dir & PJMEDIA_DIR_CAPTURE) {
+	status = pjmedia_ring_port_create(pool, "sndrec",
+					  snd_port->clock_rate,
+					  snd_port->channel_count,
+					  snd_port->samples_per_frame,
+					  snd_port->bits_per_sample,
+					  PJMEDIA_SND_PORT_RING_FRAMES, 0,
+					  &snd_port->rec_ring);
+	if (status != PJ_SUCCESS)
+	    return status;
+    }
+
+    snd_port->clock_buf = pj_pool_zalloc(pool, snd_port->samples_per_frame *
+						snd_port->bits_per_sample / 8);
+    PJ_ASSERT_RETURN(snd_port->clock_buf, PJ_ENOMEM);
+
+    return pjmedia_clock_create(pool, snd_port->clock_rate,
+				snd_port->channel_count,
+				snd_port->samples_per_frame, 0,
+				&clock_cb, snd_port, &snd_port->clock);
+}
+
+/*
+ * Destroy the rings and the media clock of decoupled mode.
+ */
+static void destroy_decoupled(pjmedia_snd_port *snd_port)
+{
+    if (snd_port->clock) {
+	pjmedia_clock_destroy(snd_port->clock);
+	snd_port->clock = NULL;
+    }
+    if (snd_port->play_ring) {
+	pjmedia_port_destroy(snd_port->play_ring);
+	snd_port->play_ring = NULL;
+    }
+    if (snd_port->rec_ring) {
+	pjmedia_port_destroy(snd_port->rec_ring);
+	snd_port->rec_ring = NULL;
+    }
+}
+
 /* Initialize with default values (zero) */
 PJ_DEF(void) pjmedia_snd_port_param_default(pjmedia_snd_port_param *prm)
 {
@@ -273,7 +452,17 @@ static pj_status_t start_sound_device( pj_pool_t *pool,
     }
 
     /* Use different callback if format is not PCM */
-    if (snd_port->aud_param.ext_fmt.id == PJMEDIA_FORMAT_L16) {
+    if (snd_port->aud_param.ext_fmt.id == PJMEDIA_FORMAT_L16 &&
+	(snd_port->options & PJMEDIA_SND_PORT_DECOUPLED))
+    {
+	status = create_decoupled(pool, snd_port);
+	if (status != PJ_SUCCESS) {
+	    destroy_decoupled(snd_port);
+	    return status;
+	}
+	snd_rec_cb = &rec_cb_ring;
+	snd_play_cb = &play_cb_ring;
+    } else if (snd_port->aud_param.ext_fmt.id == PJMEDIA_FORMAT_L16) {
 	snd_rec_cb = &rec_cb;
 	snd_play_cb = &play_cb;
     } else {
@@ -332,6 +521,19 @@ static pj_status_t start_sound_device( pj_pool_t *pool,
 	return status;
     }
 
+    /* Start the media clock of decoupled mode. It runs even when the
+     * device is not auto-started, the rings absorb the difference.
+     */
+    if (snd_port->clock) {
+	status = pjmedia_clock_start(snd_port->clock);
+	if (status != PJ_SUCCESS) {
+	    pjmedia_aud_stream_stop(snd_port->aud_stream);
+	    pjmedia_aud_stream_destroy(snd_port->aud_stream);
+	    snd_port->aud_stream = NULL;
+	    return status;
+	}
+    }
+
     return PJ_SUCCESS;
 }
 
@@ -342,10 +544,25 @@ static pj_status_t start_sound_device( pj_pool_t *pool,
  */
 static pj_status_t stop_sound_device( pjmedia_snd_port *snd_port )
 {
+    pj_status_t status = PJ_SUCCESS, destroy_status;
+
+    /* Stop the media clock first, since it uses the EC */
+    if (snd_port->clock)
+	pjmedia_clock_stop(snd_port->clock);
+
     /* Check if we have sound stream device. */
     if (snd_port->aud_stream) {
-	pjmedia_aud_stream_stop(snd_port->aud_stream);
-	pjmedia_aud_stream_destroy(snd_port->aud_stream);
+	status = pjmedia_aud_stream_stop(snd_port->aud_stream);
+	if (status != PJ_SUCCESS) {
+	    PJ_PERROR(3,(THIS_FILE, status, "Error stopping sound device"));
+	}
+	destroy_status = pjmedia_aud_stream_destroy(snd_port->aud_stream);
+	if (destroy_status != PJ_SUCCESS) {
+	    PJ_PERROR(3,(THIS_FILE, destroy_status,
+			 "Error destroying sound device"));
+	    if (status == PJ_SUCCESS)
+		status = destroy_status;
+	}
 	snd_port->aud_stream = NULL;
     }
 
@@ -355,7 +572,7 @@ static pj_status_t stop_sound_device( pjmedia_snd_port *snd_port )
 	snd_port->ec_state = NULL;
     }
 
-    return PJ_SUCCESS;
+    return status;
 }
 
 
@@ -533,9 +750,16 @@ PJ_DEF(pj_status_t) pjmedia_snd_port_create2(pj_pool_t *pool,
  */
 PJ_DEF(pj_status_t) pjmedia_snd_port_destroy(pjmedia_snd_port *snd_port)
 {
+    pj_status_t status;
+
     PJ_ASSERT_RETURN(snd_port, PJ_EINVAL);
 
-    return stop_sound_device(snd_port);
+    status = stop_sound_device(snd_port);
+
+    /* The rings and clock of decoupled mode are kept across restarts */
+    destroy_decoupled(snd_port);
+
+    return status;
 }
 
 
@@ -649,6 +873,16 @@ PJ_DEF(pj_status_t) pjmedia_snd_port_set_ec( pjmedia_snd_port *snd_port,
 	     * possibility of missing/late reference frame.
 	     */
 	    delay_ms = prm.output_latency_ms * 3/4;
+
+	    /* In decoupled mode, the EC sees the frames before they enter
+	     * the playback ring and after they leave the capture ring.
+	     */
+	    if (snd_port->clock) {
+		unsigned ptime = snd_port->samples_per_frame * 1000 /
+				 snd_port->channel_count /
+				 snd_port->clock_rate;
+		delay_ms += 2 * ptime * ((PJMEDIA_SND_PORT_RING_FRAMES+1)/2);
+	    }
 	    status = pjmedia_echo_create2(pool, snd_port->clock_rate, 
 					  snd_port->channel_count,
 					  snd_port->samples_per_frame, 
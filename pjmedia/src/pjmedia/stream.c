@@ -23,6 +23,9 @@
 #include <pjmedia/rtcp.h>
 #include <pjmedia/jbuf.h>
 #include <pjmedia/stream_common.h>
+#include <pjmedia/circbuf.h>
+#include <pjmedia/plc.h>
+#include <pjmedia/wsola.h>
 #include <pj/array.h>
 #include <pj/assert.h>
 #include <pj/ctype.h>
@@ -138,6 +141,13 @@ struct pjmedia_stream
 
     unsigned		     plc_cnt;	    /**< # of consecutive PLC frames*/
     unsigned		     max_plc_cnt;   /**< Max # of PLC frames	    */
+    pjmedia_plc		    *plc;	    /**< Generic PLC for codecs
+						 without their own, or NULL */
+    pj_int16_t		    *plc_next_buf;  /**< Frame after the lost one,
+						 decoded early, or NULL if
+						 lookahead is disabled.	    */
+    int			     plc_next_seq;  /**< Sequence of plc_next_buf   */
+    pj_bool_t		     plc_next_valid;/**< plc_next_buf has a frame   */
 
     unsigned		     vad_enabled;   /**< VAD enabled in param.	    */
     unsigned		     frame_size;    /**< Size of encoded base frame.*/
@@ -146,12 +156,28 @@ struct pjmedia_stream
 						 bit.			    */
     pj_uint32_t		     ts_vad_disabled;/**< TS when VAD was disabled. */
     pj_uint32_t		     tx_duration;   /**< TX duration in timestamp.  */
+    pj_uint32_t		     ext_frm_fmt;   /**< Format of pre-encoded frames
+						 the codec can send as is,
+						 or zero.		    */
 
     pj_mutex_t		    *jb_mutex;
     pjmedia_jbuf	    *jb;	    /**< Jitter buffer.		    */
+    pjmedia_pkt_pool	    *pkt_pool;	    /**< Packet pool of the endpt.  */
+    pj_bool_t		     pkt_pool_low;  /**< Pool reserve was reached.  */
     char		     jb_last_frm;   /**< Last frame type from jb    */
     unsigned		     jb_last_frm_cnt;/**< Last JB frame type counter*/
 
+    /* Playout time-stretching for the percentile jitter buffer engine: */
+    pjmedia_wsola	    *jb_wsola;	    /**< WSOLA, or NULL if unused.  */
+    pjmedia_circ_buf	    *jb_stage;	    /**< Decoded samples not yet
+						 played.		    */
+    pj_int16_t		    *jb_stage_buf;  /**< One decoded frame.	    */
+    pj_bool_t		     jb_prev_lost;  /**< Last frame was synthesized*/
+    unsigned		     jb_stretch_gap;/**< Frames until the next
+						 stretch is allowed.	    */
+    unsigned		     jb_stretch_min_gap;
+					    /**< Min frames between stretch.*/
+
     pjmedia_rtcp_session     rtcp;	    /**< RTCP for incoming RTP.	    */
 
     pj_uint32_t		     rtcp_last_tx;  /**< RTCP tx time in timestamp  */
@@ -227,6 +253,31 @@ struct pjmedia_stream
 
     pj_uint32_t		     rtp_rx_last_ts;        /**< Last received RTP timestamp*/
     pj_status_t		     rtp_rx_last_err;       /**< Last RTP recv() error */
+
+    /* Media relay: */
+    pjmedia_stream	    *relay_peer;    /**< Stream to forward incoming
+						 RTP to, or NULL.	    */
+    pjmedia_stream	    *relay_src;	    /**< Stream relaying its
+						 incoming RTP to this one,
+						 i.e: outgoing RTP is fed
+						 by the relay, or NULL.	    */
+    pj_bool_t		     relay_tx_init; /**< Relay seq/ts offsets set.  */
+    pj_uint16_t		     relay_seq_off; /**< Outgoing minus incoming
+						 RTP sequence number.	    */
+    pj_uint32_t		     relay_ts_off;  /**< Outgoing minus incoming
+						 RTP timestamp.		    */
+    pj_uint32_t		     relay_tx_ts;   /**< RTP timestamp of the last
+						 relayed packet sent.	    */
+    pj_timestamp	     relay_tx_time; /**< Time it was sent.	    */
+    pj_bool_t		     relay_rr_valid;/**< relay_rr has been set.     */
+    pjmedia_rtcp_rr	     relay_rr;	    /**< Report block about the
+						 relayed packets, received
+						 by the relay peer.	    */
+    pj_bool_t		     rx_rr_valid;   /**< rx_rr has been set.	    */
+    pjmedia_rtcp_rr	     rx_rr;	    /**< Last report block received
+						 about outgoing RTP.	    */
+    pj_uint32_t		     tx_rtp_ts_len; /**< RTP timestamp delta of the
+						 last packet sent.	    */
 };
 
 
@@ -468,12 +519,120 @@ static void send_keep_alive_packet(pjmedia_stream *stream)
 }
 #endif	/* defined(PJMEDIA_STREAM_ENABLE_KA) */
 
+/* The jitter buffer frame just retrieved was empty, and the remaining
+ * samples of the port frame will be concealed without retrieving more
+ * frames. Report their playout time to the jitter buffer as stretching,
+ * so the percentile engine's playout clock keeps following real time.
+ */
+static void skip_jb_frames(pjmedia_stream *stream, unsigned samples_left,
+			   unsigned samples_per_frame)
+{
+    unsigned cnt = (samples_left + samples_per_frame - 1) /
+		   samples_per_frame;
+
+    if (cnt > 1)
+	pjmedia_jbuf_set_playout_stretch(stream->jb, (cnt - 1) * 256);
+}
+
+
 /*
  * play_callback()
  *
  * This callback is called by sound device's player thread when it
  * needs to feed the player with some frames.
  */
+/* Conceal one lost codec frame, with the codec's own PLC or else with the
+ * generic PLC.
+ */
+static pj_status_t conceal_frame(pjmedia_stream *stream, pj_int16_t *buf,
+				 unsigned size)
+{
+    pj_status_t status;
+
+    if (stream->plc_cnt >= stream->max_plc_cnt)
+	return PJ_ETOOMANY;
+
+    if (stream->codec->op->recover && stream->codec_param.setting.plc) {
+	pjmedia_frame frame_out;
+
+	frame_out.buf = buf;
+	frame_out.size = size;
+	status = pjmedia_codec_recover(stream->codec, size, &frame_out);
+    } else if (stream->plc) {
+	status = pjmedia_plc_generate(stream->plc, buf);
+    } else {
+	status = PJ_ENOTSUP;
+    }
+
+    if (status == PJ_SUCCESS) {
+	if (stream->plc_cnt == 0)
+	    ++stream->rtcp.stat.rx_plc.events;
+	++stream->rtcp.stat.rx_plc.frames;
+	++stream->plc_cnt;
+    }
+
+    return status;
+}
+
+
+/* If the frame following a concealed frame is already in the jitter
+ * buffer, decode it now and interpolate the concealed frame towards it.
+ * The decoded frame is kept until the jitter buffer returns it.
+ */
+static void conceal_lookahead(pjmedia_stream *stream, pj_int16_t *buf,
+			      unsigned samples_per_frame)
+{
+    pjmedia_frame frame_in, frame_out;
+    const void *frame_ptr;
+    pj_size_t frame_size;
+    pj_uint32_t bit_info;
+    char frame_type;
+    int seq;
+
+    pjmedia_jbuf_peek_frame(stream->jb, 0, &frame_ptr, &frame_size,
+			    &frame_type, &bit_info, NULL, &seq);
+    if (frame_type != PJMEDIA_JB_NORMAL_FRAME)
+	return;
+
+    frame_in.buf = (void*)frame_ptr;
+    frame_in.size = frame_size;
+    frame_in.bit_info = bit_info;
+    frame_in.type = PJMEDIA_FRAME_TYPE_AUDIO;
+
+    frame_out.buf = stream->plc_next_buf;
+    frame_out.size = samples_per_frame * BYTES_PER_SAMPLE;
+    if (pjmedia_codec_decode(stream->codec, &frame_in,
+			     (unsigned)frame_out.size, &frame_out) != 0)
+    {
+	return;
+    }
+    if (frame_out.size < samples_per_frame * BYTES_PER_SAMPLE) {
+	unsigned cnt = (unsigned)(frame_out.size / BYTES_PER_SAMPLE);
+	pjmedia_zero_samples(stream->plc_next_buf + cnt,
+			     samples_per_frame - cnt);
+    }
+
+    /* The generic PLC may smoothen the frame, interpolate towards the
+     * frame as it will be played.
+     */
+    if (stream->plc)
+	pjmedia_plc_save(stream->plc, stream->plc_next_buf);
+
+    /* The decoded frame is kept even if the frame can't be interpolated
+     * (e.g: too long), as the codec has decoded it already.
+     */
+    stream->plc_next_seq = seq;
+    stream->plc_next_valid = PJ_TRUE;
+
+    if (pjmedia_plc_interpolate(stream->codec_param.info.clock_rate, buf,
+				stream->plc_next_buf,
+				samples_per_frame) == PJ_SUCCESS)
+    {
+	++stream->rtcp.stat.rx_plc.interp;
+    }
+}
+
+
 static pj_status_t get_frame( pjmedia_port *port, pjmedia_frame *frame)
 {
     pjmedia_stream *stream = (pjmedia_stream*) port->port_data.pdata;
@@ -483,8 +642,8 @@ static pj_status_t get_frame( pjmedia_port *port, pjmedia_frame *frame)
     pj_status_t status;
 
 
-    /* Return no frame is channel is paused */
-    if (channel->paused) {
+    /* Return no frame is channel is paused or relaying */
+    if (channel->paused || stream->relay_peer) {
 	frame->type = PJMEDIA_FRAME_TYPE_NONE;
 	return PJ_SUCCESS;
     }
@@ -509,10 +668,21 @@ static pj_status_t get_frame( pjmedia_port *port, pjmedia_frame *frame)
 	char frame_type;
 	pj_size_t frame_size;
 	pj_uint32_t bit_info;
+	const void *frame_ptr;
+	pj_bool_t lookahead;
+	int seq;
 
-	/* Get frame from jitter buffer. */
-	pjmedia_jbuf_get_frame2(stream->jb, channel->out_pkt, &frame_size,
-			        &frame_type, &bit_info);
+	/* Get frame from jitter buffer. The frame is decoded in place, it
+	 * stays valid while we hold the jitter buffer mutex.
+	 */
+	pjmedia_jbuf_get_frame_ptr(stream->jb, &frame_ptr, &frame_size,
+				   &frame_type, &bit_info, NULL, &seq);
+
+	/* Has this frame been decoded already, to conceal the one before? */
+	lookahead = stream->plc_next_valid &&
+		    frame_type == PJMEDIA_JB_NORMAL_FRAME &&
+		    seq == stream->plc_next_seq;
+	stream->plc_next_valid = PJ_FALSE;
 
 #if TRACE_JB
 	trace_jb_get(stream, frame_type, frame_size);
@@ -521,28 +691,19 @@ static pj_status_t get_frame( pjmedia_port *port, pjmedia_frame *frame)
 	if (frame_type == PJMEDIA_JB_MISSING_FRAME) {
 
 	    /* Activate PLC */
-	    if (stream->codec->op->recover &&
-		stream->codec_param.setting.plc &&
-		stream->plc_cnt < stream->max_plc_cnt)
-	    {
-		pjmedia_frame frame_out;
-
-		frame_out.buf = p_out_samp + samples_count;
-		frame_out.size = frame->size - samples_count*2;
-		status = pjmedia_codec_recover(stream->codec,
-					       (unsigned)frame_out.size,
-					       &frame_out);
-
-		++stream->plc_cnt;
-
-	    } else {
-		status = -1;
-	    }
+	    status = conceal_frame(stream, p_out_samp + samples_count,
+				   (unsigned)frame->size - samples_count*2);
 
 	    if (status != PJ_SUCCESS) {
 		/* Either PLC failed or PLC not supported/enabled */
 		pjmedia_zero_samples(p_out_samp + samples_count,
 				     samples_required - samples_count);
+	    } else {
+		/* Interpolate when the next frame has arrived already */
+		if (stream->plc_next_buf) {
+		    conceal_lookahead(stream, p_out_samp + samples_count,
+				      samples_per_frame);
+		}
 	    }
 
 	    if (frame_type != stream->jb_last_frm) {
@@ -560,6 +721,12 @@ static pj_status_t get_frame( pjmedia_port *port, pjmedia_frame *frame)
 
 	    const char *with_plc = "";
 
+	    /* The rest of the frame doesn't take frames from the jitter
+	     * buffer, tell it that their playout time passed anyway.
+	     */
+	    skip_jb_frames(stream, samples_required - samples_count,
+			   samples_per_frame);
+
 	    /* Jitter buffer is empty. If this is the first "empty" state,
 	     * activate PLC to smoothen the fade-out, otherwise zero
 	     * the frame.
@@ -569,27 +736,14 @@ static pj_status_t get_frame( pjmedia_port *port, pjmedia_frame *frame)
 	    //if (frame_type != stream->jb_last_frm) {
 	    if (1) {
 		/* Activate PLC to smoothen the missing frame */
-		if (stream->codec->op->recover &&
-		    stream->codec_param.setting.plc &&
-		    stream->plc_cnt < stream->max_plc_cnt)
-		{
-		    pjmedia_frame frame_out;
-
-		    do {
-			frame_out.buf = p_out_samp + samples_count;
-			frame_out.size = frame->size - samples_count*2;
-			status = pjmedia_codec_recover(stream->codec,
-						       (unsigned)frame_out.size,
-						       &frame_out);
-			if (status != PJ_SUCCESS)
-			    break;
-
-			samples_count += samples_per_frame;
-			++stream->plc_cnt;
-
-		    } while (samples_count < samples_required &&
-			     stream->plc_cnt < stream->max_plc_cnt);
+		while (samples_count < samples_required) {
+		    status = conceal_frame(stream, p_out_samp + samples_count,
+					   (unsigned)frame->size -
+					   samples_count*2);
+		    if (status != PJ_SUCCESS)
+			break;
 
+		    samples_count += samples_per_frame;
 		    with_plc = ", plc invoked";
 		}
 	    }
@@ -623,28 +777,17 @@ static pj_status_t get_frame( pjmedia_port *port, pjmedia_frame *frame)
 	    /* It can only be PJMEDIA_JB_ZERO_PREFETCH frame */
 	    pj_assert(frame_type == PJMEDIA_JB_ZERO_PREFETCH_FRAME);
 
-	    /* Always activate PLC when it's available.. */
-	    if (stream->codec->op->recover &&
-		stream->codec_param.setting.plc &&
-		stream->plc_cnt < stream->max_plc_cnt)
-	    {
-		pjmedia_frame frame_out;
-
-		do {
-		    frame_out.buf = p_out_samp + samples_count;
-		    frame_out.size = frame->size - samples_count*2;
-		    status = pjmedia_codec_recover(stream->codec,
-						   (unsigned)frame_out.size,
-						   &frame_out);
-		    if (status != PJ_SUCCESS)
-			break;
-		    samples_count += samples_per_frame;
-
-		    ++stream->plc_cnt;
+	    skip_jb_frames(stream, samples_required - samples_count,
+			   samples_per_frame);
 
-		} while (samples_count < samples_required &&
-			 stream->plc_cnt < stream->max_plc_cnt);
+	    /* Always activate PLC when it's available.. */
+	    while (samples_count < samples_required) {
+		status = conceal_frame(stream, p_out_samp + samples_count,
+				       (unsigned)frame->size - samples_count*2);
+		if (status != PJ_SUCCESS)
+		    break;
 
+		samples_count += samples_per_frame;
 		with_plc = ", plc invoked";
 	    }
 
@@ -676,23 +819,33 @@ static pj_status_t get_frame( pjmedia_port *port, pjmedia_frame *frame)
 
 	    stream->plc_cnt = 0;
 
-	    /* Decode */
-	    frame_in.buf = channel->out_pkt;
-	    frame_in.size = frame_size;
-	    frame_in.bit_info = bit_info;
-	    frame_in.type = PJMEDIA_FRAME_TYPE_AUDIO;  /* ignored */
+	    if (lookahead) {
+		/* Already decoded (and given to the PLC) by the concealment */
+		pjmedia_copy_samples(p_out_samp + samples_count,
+				     stream->plc_next_buf, samples_per_frame);
+		status = PJ_SUCCESS;
+	    } else {
+		/* Decode */
+		frame_in.buf = (void*)frame_ptr;
+		frame_in.size = frame_size;
+		frame_in.bit_info = bit_info;
+		frame_in.type = PJMEDIA_FRAME_TYPE_AUDIO;  /* ignored */
 
-	    frame_out.buf = p_out_samp + samples_count;
-	    frame_out.size = frame->size - samples_count*BYTES_PER_SAMPLE;
-	    status = pjmedia_codec_decode( stream->codec, &frame_in,
-					   (unsigned)frame_out.size,
-					   &frame_out);
+		frame_out.buf = p_out_samp + samples_count;
+		frame_out.size = frame->size - samples_count*BYTES_PER_SAMPLE;
+		status = pjmedia_codec_decode( stream->codec, &frame_in,
+					       (unsigned)frame_out.size,
+					       &frame_out);
+	    }
 	    if (status != 0) {
 		LOGERR_((port->info.name.ptr, "codec decode() error",
 			 status));
 
 		pjmedia_zero_samples(p_out_samp + samples_count,
 				     samples_per_frame);
+	    } else {
+		if (stream->plc && !lookahead)
+		    pjmedia_plc_save(stream->plc, p_out_samp + samples_count);
 	    }
 
 	    if (stream->jb_last_frm != frame_type) {
@@ -730,6 +883,130 @@ static pj_status_t get_frame( pjmedia_port *port, pjmedia_frame *frame)
 }
 
 
+/* Decode one more frame into the time-stretching stage. Returns
+ * PJ_FALSE if the stream has no frame to play, e.g: it is paused.
+ */
+static pj_bool_t stretch_fill_stage(pjmedia_stream *stream,
+				    pjmedia_frame *frame)
+{
+    pjmedia_frame tmp;
+
+    tmp.type = PJMEDIA_FRAME_TYPE_AUDIO;
+    tmp.buf = stream->jb_stage_buf;
+    tmp.size = PJMEDIA_PIA_SPF(&stream->port.info) * BYTES_PER_SAMPLE;
+    tmp.bit_info = 0;
+    tmp.timestamp.u64 = 0;
+
+    get_frame(&stream->port, &tmp);
+    if (tmp.type != PJMEDIA_FRAME_TYPE_AUDIO) {
+	frame->type = tmp.type;
+	frame->size = 0;
+	pjmedia_circ_buf_reset(stream->jb_stage);
+	return PJ_FALSE;
+    }
+
+    pjmedia_circ_buf_write(stream->jb_stage, stream->jb_stage_buf,
+			   (unsigned)(tmp.size / BYTES_PER_SAMPLE));
+    return PJ_TRUE;
+}
+
+
+/* The get_frame callback used with the percentile jitter buffer engine.
+ * Frames are decoded as usual, and the playout is compressed or expanded
+ * with WSOLA when the jitter buffer level drifts away from its target.
+ */
+static pj_status_t get_frame_stretch( pjmedia_port *port,
+				      pjmedia_frame *frame)
+{
+    pjmedia_stream *stream = (pjmedia_stream*) port->port_data.pdata;
+    unsigned spf = PJMEDIA_PIA_SPF(&port->info);
+    pj_int16_t *dst = (pj_int16_t*) frame->buf;
+    unsigned frm_spf;
+    int adj = 0;
+
+    if (stream->dec->paused || stream->relay_peer) {
+	frame->type = PJMEDIA_FRAME_TYPE_NONE;
+	return PJ_SUCCESS;
+    }
+
+    /* The jitter buffer counts the stretch in its own frames, i.e: codec
+     * frames, and a port frame may hold several of them.
+     */
+    frm_spf = stream->codec_param.info.frm_ptime *
+	      stream->codec_param.info.clock_rate *
+	      stream->codec_param.info.channel_cnt / 1000;
+
+    if (stream->jb_stretch_gap) {
+	--stream->jb_stretch_gap;
+    } else {
+	pj_mutex_lock(stream->jb_mutex);
+	adj = pjmedia_jbuf_get_playout_adj(stream->jb);
+	pj_mutex_unlock(stream->jb_mutex);
+    }
+
+    if (adj < 0 && pjmedia_circ_buf_get_len(stream->jb_stage) < spf) {
+	/* Too few frames buffered, play a synthesized frame without
+	 * taking one from the jitter buffer.
+	 */
+	pjmedia_wsola_generate(stream->jb_wsola, dst);
+	stream->jb_prev_lost = PJ_TRUE;
+	stream->jb_stretch_gap = stream->jb_stretch_min_gap;
+
+	pj_mutex_lock(stream->jb_mutex);
+	pjmedia_jbuf_set_playout_stretch(stream->jb, spf * 256 / frm_spf);
+	pj_mutex_unlock(stream->jb_mutex);
+
+	frame->type = PJMEDIA_FRAME_TYPE_AUDIO;
+	frame->size = spf * BYTES_PER_SAMPLE;
+	frame->timestamp.u64 = 0;
+	return PJ_SUCCESS;
+    }
+
+    if (adj > 0) {
+	/* Too many frames buffered, give WSOLA two frames to compress */
+	pj_int16_t *buf1, *buf2;
+	unsigned buf1len, buf2len, erase_cnt;
+
+	while (pjmedia_circ_buf_get_len(stream->jb_stage) < 2 * spf) {
+	    if (!stretch_fill_stage(stream, frame))
+		return PJ_SUCCESS;
+	}
+
+	erase_cnt = spf / 2;
+	pjmedia_circ_buf_get_read_regions(stream->jb_stage, &buf1, &buf1len,
+					  &buf2, &buf2len);
+	if (pjmedia_wsola_discard(stream->jb_wsola, buf1, buf1len, buf2,
+				  buf2len, &erase_cnt) == PJ_SUCCESS &&
+	    erase_cnt)
+	{
+	    pjmedia_circ_buf_set_len(stream->jb_stage,
+				     pjmedia_circ_buf_get_len(stream->jb_stage)
+				     - erase_cnt);
+
+	    pj_mutex_lock(stream->jb_mutex);
+	    pjmedia_jbuf_set_playout_stretch(stream->jb,
+					     -(int)(erase_cnt * 256 / frm_spf));
+	    pj_mutex_unlock(stream->jb_mutex);
+	}
+	stream->jb_stretch_gap = stream->jb_stretch_min_gap;
+    }
+
+    while (pjmedia_circ_buf_get_len(stream->jb_stage) < spf) {
+	if (!stretch_fill_stage(stream, frame))
+	    return PJ_SUCCESS;
+    }
+
+    pjmedia_circ_buf_read(stream->jb_stage, dst, spf);
+    pjmedia_wsola_save(stream->jb_wsola, dst, stream->jb_prev_lost);
+    stream->jb_prev_lost = PJ_FALSE;
+
+    frame->type = PJMEDIA_FRAME_TYPE_AUDIO;
+    frame->size = spf * BYTES_PER_SAMPLE;
+    frame->timestamp.u64 = 0;
+    return PJ_SUCCESS;
+}
+
+
 /* The other version of get_frame callback used when stream port format
  * is non linear PCM.
  */
@@ -933,6 +1210,66 @@ static void create_dtmf_payload(pjmedia_stream *stream,
 }
 
 
+/*
+ * Translate the RTCP SR/RR built by the RTCP session when relaying.
+ *
+ * When the outgoing RTP is fed by a relay, the RTP timestamp in the SR
+ * is derived from the last relayed packet, since the relayed timestamps
+ * follow the remote's clock rather than the local one. When this stream
+ * relays its incoming RTP, the report block sent back to the remote
+ * includes the loss and jitter reported by the relay peer's remote, so
+ * that the remote sees the reception quality of the whole path.
+ */
+static void translate_relay_rtcp(pjmedia_stream *stream,
+				 void *sr_rr_pkt, int len)
+{
+    pjmedia_rtcp_rr *rr;
+
+    pj_mutex_lock(stream->jb_mutex);
+
+    if (len == sizeof(pjmedia_rtcp_sr_pkt)) {
+	pjmedia_rtcp_sr_pkt *sr_pkt = (pjmedia_rtcp_sr_pkt*)sr_rr_pkt;
+
+	if (stream->relay_src && stream->relay_tx_init) {
+	    pj_timestamp now;
+	    pj_uint64_t elapsed;
+
+	    pj_get_timestamp(&now);
+	    elapsed = pj_elapsed_usec(&stream->relay_tx_time, &now);
+	    sr_pkt->sr.rtp_ts = pj_htonl(stream->relay_tx_ts +
+			(pj_uint32_t)(elapsed * stream->rtcp.clock_rate /
+				      1000000));
+	}
+	rr = &sr_pkt->rr;
+    } else {
+	rr = &((pjmedia_rtcp_rr_pkt*)sr_rr_pkt)->rr;
+    }
+
+    if (stream->relay_peer && stream->relay_rr_valid) {
+	const pjmedia_rtcp_rr *peer_rr = &stream->relay_rr;
+	unsigned fract1 = rr->fract_lost, fract2 = peer_rr->fract_lost;
+	pj_uint32_t lost;
+
+	lost = (rr->total_lost_2 << 16) + (rr->total_lost_1 << 8) +
+	       rr->total_lost_0 +
+	       (peer_rr->total_lost_2 << 16) + (peer_rr->total_lost_1 << 8) +
+	       peer_rr->total_lost_0;
+	if (lost > 0x7FFFFF)
+	    lost = 0x7FFFFF;
+
+	/* Packets reach the far end if neither leg loses them */
+	rr->fract_lost = (fract1 + fract2 - fract1 * fract2 / 256) & 0xFF;
+	rr->total_lost_2 = (lost >> 16) & 0xFF;
+	rr->total_lost_1 = (lost >> 8) & 0xFF;
+	rr->total_lost_0 = (lost & 0xFF);
+	rr->jitter = pj_htonl(pj_ntohl(rr->jitter) +
+			      pj_ntohl(peer_rr->jitter));
+    }
+
+    pj_mutex_unlock(stream->jb_mutex);
+}
+
+
 static pj_status_t send_rtcp(pjmedia_stream *stream,
 			     pj_bool_t with_sdes,
 			     pj_bool_t with_bye,
@@ -945,6 +1282,8 @@ static pj_status_t send_rtcp(pjmedia_stream *stream,
 
     /* Build RTCP RR/SR packet */
     pjmedia_rtcp_build_rtcp(&stream->rtcp, &sr_rr_pkt, &len);
+    if (stream->relay_src || stream->relay_peer)
+	translate_relay_rtcp(stream, sr_rr_pkt, len);
 
 #if !defined(PJMEDIA_HAS_RTCP_XR) || (PJMEDIA_HAS_RTCP_XR == 0)
     with_xr = PJ_FALSE;
@@ -1150,6 +1489,27 @@ static void rebuffer(pjmedia_stream *stream,
 }
 
 
+/*
+ * Check whether nothing has been sent for PJMEDIA_CODEC_MAX_SILENCE_PERIOD,
+ * i.e: the codec with VAD would send a silence frame to keep the NAT
+ * binding open.
+ */
+static pj_bool_t is_silence_period_over(pjmedia_stream *stream)
+{
+#if PJMEDIA_CODEC_MAX_SILENCE_PERIOD == -1
+    PJ_UNUSED_ARG(stream);
+    return PJ_FALSE;
+#else
+    pj_uint32_t silence_period;
+
+    silence_period = pj_ntohl(stream->enc->rtp.out_hdr.ts) -
+		     stream->rtcp.stat.rtp_tx_last_ts;
+    return silence_period >= PJMEDIA_CODEC_MAX_SILENCE_PERIOD *
+			     stream->codec_param.info.clock_rate / 1000;
+#endif
+}
+
+
 /**
  * put_frame_imp()
  */
@@ -1191,10 +1551,24 @@ static pj_status_t put_frame_imp( pjmedia_port *port,
 	return PJ_SUCCESS;
     }
 
+    /* A pre-encoded frame is only sent when it carries the payload of the
+     * stream's codec, see pjmedia_wav_player_port_create_encoded().
+     */
+    if (frame->type == PJMEDIA_FRAME_TYPE_EXTENDED &&
+	stream->port.info.fmt.id == PJMEDIA_FORMAT_L16 &&
+	(stream->ext_frm_fmt == 0 || frame->bit_info != stream->ext_frm_fmt))
+    {
+	return PJMEDIA_EINVALIDPT;
+    }
+
     /* Number of samples in the frame */
     if (frame->type == PJMEDIA_FRAME_TYPE_AUDIO)
 	ts_len = ((unsigned)frame->size >> 1) /
 		 stream->codec_param.info.channel_cnt;
+    else if (frame->type == PJMEDIA_FRAME_TYPE_EXTENDED &&
+	     stream->port.info.fmt.id == PJMEDIA_FORMAT_L16)
+	ts_len = ((pjmedia_frame_ext*)frame)->samples_cnt /
+		 stream->codec_param.info.channel_cnt;
     else if (frame->type == PJMEDIA_FRAME_TYPE_EXTENDED)
 	ts_len = PJMEDIA_PIA_SPF(&stream->port.info) /
 		 PJMEDIA_PIA_CCNT(&stream->port.info);
@@ -1216,6 +1590,9 @@ static pj_status_t put_frame_imp( pjmedia_port *port,
     rtp_ts_len = ts_len;
 #endif
 
+    if (rtp_ts_len)
+	stream->tx_rtp_ts_len = rtp_ts_len;
+
     /* Init frame_out buffer. */
     frame_out.buf = ((char*)channel->out_pkt) + sizeof(pjmedia_rtp_hdr);
     frame_out.size = 0;
@@ -1263,9 +1640,16 @@ static pj_status_t put_frame_imp( pjmedia_port *port,
      * This was originally done in http://trac.pjsip.org/repos/ticket/56,
      * but then disabled in http://trac.pjsip.org/repos/ticket/439, but
      * now it's enabled again.
+     *
+     * When VAD is enabled the codec would only suppress the zero frame,
+     * so it is only encoded once nothing has been sent for
+     * PJMEDIA_CODEC_MAX_SILENCE_PERIOD, for the codec to send its periodic
+     * silence frame. Otherwise only the RTP timestamp is advanced below.
      */
     } else if (frame->type == PJMEDIA_FRAME_TYPE_AUDIO &&
 	       frame->buf == NULL &&
+	       (stream->codec_param.setting.vad == 0 ||
+		is_silence_period_over(stream)) &&
 	       stream->port.info.fmt.id == PJMEDIA_FORMAT_L16 &&
 	       (stream->dir & PJMEDIA_DIR_ENCODING) &&
 	       stream->enc_samples_per_pkt < PJ_ARRAY_SIZE(zero_frame))
@@ -1297,6 +1681,25 @@ static pj_status_t put_frame_imp( pjmedia_port *port,
 					 &rtphdrlen);
 
 
+    /* Pre-encoded frame (e.g. from pjmedia_wav_player_port_create_encoded())
+     * given to a stream whose codec takes PCM: the frame already carries
+     * the payload of the stream's codec, send it without the encoder.
+     */
+    } else if (frame->type == PJMEDIA_FRAME_TYPE_EXTENDED &&
+	       stream->port.info.fmt.id == PJMEDIA_FORMAT_L16)
+    {
+	frame_out.size = pjmedia_frame_ext_copy_payload(
+				(pjmedia_frame_ext*)frame, frame_out.buf,
+				(unsigned)(channel->out_pkt_size -
+					   sizeof(pjmedia_rtp_hdr)));
+
+	/* Encapsulate. */
+	status = pjmedia_rtp_encode_rtp( &channel->rtp,
+					 channel->pt, 0,
+					 (int)frame_out.size, rtp_ts_len,
+					 (const void**)&rtphdr,
+					 &rtphdrlen);
+
     /* Encode audio frame */
     } else if ((frame->type == PJMEDIA_FRAME_TYPE_AUDIO &&
 	        frame->buf != NULL) ||
@@ -1416,6 +1819,10 @@ static pj_status_t put_frame( pjmedia_port *port,
     pjmedia_frame tmp_zero_frame;
     unsigned samples_per_frame;
 
+    /* Outgoing RTP is fed by the relay, ignore frames from the port */
+    if (stream->relay_src)
+	return PJ_SUCCESS;
+
     samples_per_frame = stream->enc_samples_per_pkt;
 
     /* http://www.pjsip.org/trac/ticket/56:
@@ -1469,8 +1876,17 @@ static pj_status_t put_frame( pjmedia_port *port,
 
     /* If encoder has different ptime than decoder, then the frame must
      * be passed through the encoding buffer via rebuffer() function.
+     * Pre-encoded frames can't be rebuffered, they are sent with the
+     * ptime of the frame.
      */
-    if (stream->enc_buf != NULL) {
+    if (stream->enc_buf != NULL &&
+	frame->type == PJMEDIA_FRAME_TYPE_EXTENDED &&
+	stream->port.info.fmt.id == PJMEDIA_FORMAT_L16)
+    {
+	stream->enc_buf_pos = stream->enc_buf_count = 0;
+	return put_frame_imp(port, frame);
+
+    } else if (stream->enc_buf != NULL) {
 	pjmedia_frame tmp_rebuffer_frame;
 	pj_status_t status = PJ_SUCCESS;
 
@@ -1607,6 +2023,108 @@ static void handle_incoming_dtmf( pjmedia_stream *stream,
 }
 
 
+/*
+ * Forward incoming RTP packet to the relay peer, rewriting the SSRC,
+ * sequence number, timestamp and payload type to those of the peer's
+ * outgoing RTP session. The caller must hold the jitter buffer mutex of
+ * both streams.
+ */
+static void relay_rtp(pjmedia_stream *stream,
+		      const pjmedia_rtp_hdr *hdr,
+		      const void *payload,
+		      unsigned payloadlen,
+		      const pjmedia_rtp_status *seq_st)
+{
+    pjmedia_stream *peer = stream->relay_peer;
+    pjmedia_channel *channel = peer->enc;
+    pj_uint8_t pkt[PJMEDIA_MAX_MTU];
+    pjmedia_rtp_hdr *out_hdr = (pjmedia_rtp_hdr*)pkt;
+    pj_uint16_t in_seq, out_seq;
+    pj_uint32_t in_ts, out_ts;
+    unsigned size;
+    int pt;
+
+    if (channel->paused)
+	return;
+
+    /* Map the payload type. Unknown payload types (e.g. comfort noise)
+     * are passed through unchanged.
+     */
+    if (hdr->pt == stream->rx_event_pt) {
+	if (peer->tx_event_pt < 0)
+	    return;
+	pt = peer->tx_event_pt;
+    } else if (hdr->pt == stream->dec->pt) {
+	pt = channel->pt;
+    } else {
+	pt = hdr->pt;
+    }
+
+    size = sizeof(pjmedia_rtp_hdr) + payloadlen;
+    if (size > sizeof(pkt))
+	return;
+
+    in_seq = pj_ntohs(hdr->seq);
+    in_ts = pj_ntohl(hdr->ts);
+
+    /* Calculate the offsets on the first packet, or when the remote
+     * restarted its RTP session, so that the outgoing packets continue
+     * right after the last packet sent by the peer. The last packet's
+     * RTP timestamp delta is used rather than the frame size, since
+     * they differ for some codecs (e.g. G.722).
+     */
+    if (!peer->relay_tx_init || seq_st->status.flag.restart ||
+	seq_st->status.flag.badssrc)
+    {
+	peer->relay_seq_off = (pj_uint16_t)(channel->rtp.out_extseq + 1 -
+					    in_seq);
+	peer->relay_ts_off = pj_ntohl(channel->rtp.out_hdr.ts) +
+			     peer->tx_rtp_ts_len - in_ts;
+	peer->relay_tx_init = PJ_TRUE;
+    }
+
+    out_seq = (pj_uint16_t)(in_seq + peer->relay_seq_off);
+    out_ts = in_ts + peer->relay_ts_off;
+
+    /* Build the packet. CSRC list and header extension are not relayed. */
+    pj_memcpy(out_hdr, &channel->rtp.out_hdr, sizeof(pjmedia_rtp_hdr));
+    out_hdr->pt = (pj_uint8_t)pt;
+    out_hdr->m = hdr->m;
+    out_hdr->seq = pj_htons(out_seq);
+    out_hdr->ts = pj_htonl(out_ts);
+    pj_memcpy(out_hdr + 1, payload, payloadlen);
+
+    /* Keep the peer's RTP session in step, so that it can continue
+     * encoding seamlessly once the relay is stopped.
+     */
+    if ((pj_int16_t)(out_seq - (pj_uint16_t)channel->rtp.out_extseq) > 0) {
+	if (out_seq == (pj_uint16_t)(channel->rtp.out_extseq + 1))
+	    peer->tx_rtp_ts_len = out_ts - pj_ntohl(channel->rtp.out_hdr.ts);
+	channel->rtp.out_extseq = out_seq;
+	channel->rtp.out_hdr.seq = pj_htons(out_seq);
+	channel->rtp.out_hdr.ts = pj_htonl(out_ts);
+	peer->relay_tx_ts = out_ts;
+	pj_get_timestamp(&peer->relay_tx_time);
+    }
+
+    /* Forward the peer's reception quality back with our own reports */
+    if (peer->rx_rr_valid) {
+	stream->relay_rr = peer->rx_rr;
+	stream->relay_rr_valid = PJ_TRUE;
+    }
+
+    if (peer->dir != PJMEDIA_DIR_DECODING)
+	check_tx_rtcp(peer, out_ts);
+
+    if (pjmedia_transport_send_rtp(peer->transport, pkt, size) != PJ_SUCCESS)
+	return;
+
+    pjmedia_rtcp_tx_rtp(&peer->rtcp, payloadlen);
+    peer->rtcp.stat.rtp_tx_last_ts = pj_ntohl(channel->rtp.out_hdr.ts);
+    peer->rtcp.stat.rtp_tx_last_seq = pj_ntohs(channel->rtp.out_hdr.seq);
+}
+
+
 /*
  * This callback is called by stream transport on receipt of packets
  * in the RTP socket.
@@ -1702,6 +2220,40 @@ static void on_rx_rtp( void *data,
 	goto on_return;
     }
 
+    /* Forward the packet when relaying, bypassing the jitter buffer */
+    if (stream->relay_peer) {
+	pjmedia_stream *peer;
+	pj_bool_t relayed = PJ_FALSE;
+
+	pj_mutex_lock( stream->jb_mutex );
+	peer = stream->relay_peer;
+	if (peer) {
+	    /* The peer may be relaying to this stream at the same time, so
+	     * its mutex is only tried. On contention the packet is dropped,
+	     * as if lost on the way, rather than stalling the receive path.
+	     */
+	    if (pj_mutex_trylock(peer->jb_mutex) == PJ_SUCCESS) {
+		if (!seq_st.status.flag.dup)
+		    relay_rtp(stream, hdr, payload, payloadlen, &seq_st);
+		pj_mutex_unlock( peer->jb_mutex );
+	    } else {
+		pkt_discarded = PJ_TRUE;
+	    }
+	    relayed = PJ_TRUE;
+	}
+	pj_mutex_unlock( stream->jb_mutex );
+
+	if (relayed) {
+	    /* Still report DTMF digits to the application */
+	    if (hdr->pt == stream->rx_event_pt &&
+		!seq_st.status.flag.outorder && !seq_st.status.flag.dup)
+	    {
+		handle_incoming_dtmf(stream, payload, payloadlen);
+	    }
+	    goto on_return;
+	}
+    }
+
     /* Handle incoming DTMF. */
     if (hdr->pt == stream->rx_event_pt) {
 	/* Ignore out-of-order packet as it will be detected as new
@@ -1733,6 +2285,41 @@ static void on_rx_rtp( void *data,
 	unsigned i, count = MAX;
 	unsigned ts_span;
 	pjmedia_frame frames[MAX];
+	pjmedia_pkt_buf *pkt_buf = NULL;
+
+	/* Let the jitter buffer keep the frames in a buffer of the packet
+	 * pool rather than copies, as long as enough buffers are left for
+	 * the other streams. A packet which the transport didn't receive
+	 * into the pool is moved to a pool buffer here.
+	 */
+	if (stream->pkt_pool &&
+	    pjmedia_pkt_pool_get_free_cnt(stream->pkt_pool) >
+		PJMEDIA_PKT_POOL_RESERVE)
+	{
+	    pkt_buf = pjmedia_pkt_pool_find(stream->pkt_pool, pkt);
+	    if (pkt_buf) {
+		pjmedia_pkt_buf_add_ref(pkt_buf);
+	    } else {
+		pkt_buf = pjmedia_pkt_pool_alloc(stream->pkt_pool);
+		if (pkt_buf && (pj_size_t)bytes_read > pkt_buf->size) {
+		    pjmedia_pkt_buf_dec_ref(pkt_buf);
+		    pkt_buf = NULL;
+		} else if (pkt_buf) {
+		    pj_memcpy(pkt_buf->buf, pkt, bytes_read);
+		    payload = (const pj_uint8_t*)pkt_buf->buf +
+			      ((const pj_uint8_t*)payload -
+			       (const pj_uint8_t*)pkt);
+		}
+	    }
+	    stream->pkt_pool_low = PJ_FALSE;
+
+	} else if (stream->pkt_pool && !stream->pkt_pool_low) {
+	    PJ_LOG(4,(stream->port.info.name.ptr,
+		      "Packet pool is down to %u free buffers, jitter "
+		      "buffer copies the frames",
+		      pjmedia_pkt_pool_get_free_cnt(stream->pkt_pool)));
+	    stream->pkt_pool_low = PJ_TRUE;
+	}
 
 	/* Get the timestamp of the first sample */
 	ts.u64 = pj_ntohl(hdr->ts);
@@ -1831,12 +2418,17 @@ static void on_rx_rtp( void *data,
 	    pj_bool_t discarded;
 
 	    ext_seq = (unsigned)(frames[i].timestamp.u64 / ts_span);
-	    pjmedia_jbuf_put_frame2(stream->jb, frames[i].buf, frames[i].size,
-				    frames[i].bit_info, ext_seq, &discarded);
+	    pjmedia_jbuf_put_pkt(stream->jb, pkt_buf, frames[i].buf,
+				 frames[i].size, frames[i].bit_info, ext_seq,
+				 0, &discarded);
 	    if (discarded)
 		pkt_discarded = PJ_TRUE;
 	}
 
+	/* The jitter buffer holds its own references */
+	if (pkt_buf)
+	    pjmedia_pkt_buf_dec_ref(pkt_buf);
+
 #if TRACE_JB
 	trace_jb_put(stream, hdr, payloadlen, count);
 #endif
@@ -1882,6 +2474,52 @@ on_return:
 }
 
 
+/*
+ * Save the report block about our outgoing RTP from an incoming RTCP
+ * compound packet, so that the relay can forward it to the stream whose
+ * RTP is being relayed.
+ */
+static void save_rx_report(pjmedia_stream *stream, const void *pkt,
+			   pj_ssize_t size)
+{
+    const pj_uint8_t *p = (const pj_uint8_t*)pkt;
+    const pj_uint8_t *end = p + size;
+
+    while (p + sizeof(pjmedia_rtcp_common) <= end) {
+	const pjmedia_rtcp_common *common = (const pjmedia_rtcp_common*)p;
+	const pj_uint8_t *next = p + (pj_ntohs((pj_uint16_t)common->length)
+				      + 1) * 4;
+	const pjmedia_rtcp_rr *rr;
+	unsigned i;
+
+	if (next > end)
+	    break;
+
+	if (common->pt == 200)	    /* SR */
+	    rr = (const pjmedia_rtcp_rr*)(p + sizeof(pjmedia_rtcp_common) +
+					  sizeof(pjmedia_rtcp_sr));
+	else if (common->pt == 201) /* RR */
+	    rr = (const pjmedia_rtcp_rr*)(p + sizeof(pjmedia_rtcp_common));
+	else
+	    rr = NULL;
+
+	for (i = 0; rr && i < common->count &&
+		    (const pj_uint8_t*)(rr + 1) <= next; ++i, ++rr)
+	{
+	    if (rr->ssrc == stream->enc->rtp.out_hdr.ssrc) {
+		pj_mutex_lock(stream->jb_mutex);
+		stream->rx_rr = *rr;
+		stream->rx_rr_valid = PJ_TRUE;
+		pj_mutex_unlock(stream->jb_mutex);
+		return;
+	    }
+	}
+
+	p = next;
+    }
+}
+
+
 /*
  * This callback is called by stream transport on receipt of packets
  * in the RTCP socket.
@@ -1900,6 +2538,9 @@ static void on_rx_rtcp( void *data,
     }
 
     pjmedia_rtcp_rx_rtcp(&stream->rtcp, pkt, bytes_read);
+
+    if (stream->relay_src)
+	save_rx_report(stream, pkt, bytes_read);
 }
 
 
@@ -2038,6 +2679,7 @@ PJ_DEF(pj_status_t) pjmedia_stream_create( pjmedia_endpt *endpt,
     /* Init stream: */
     stream->endpt = endpt;
     stream->codec_mgr = pjmedia_endpt_get_codec_mgr(endpt);
+    stream->pkt_pool = pjmedia_endpt_get_pkt_pool(endpt);
     stream->dir = info->dir;
     stream->user_data = user_data;
     stream->rtcp_interval = (PJMEDIA_RTCP_INTERVAL-500 + (pj_rand()%1000)) *
@@ -2064,9 +2706,12 @@ PJ_DEF(pj_status_t) pjmedia_stream_create( pjmedia_endpt *endpt,
     stream->cname.slen = p - stream->cname.ptr;
 
 
-    /* Create mutex to protect jitter buffer: */
+    /* Create mutex to protect jitter buffer. It also protects the relay
+     * state, and is recursive because the RTCP report of a relay peer is
+     * sent while its mutex is already held.
+     */
 
-    status = pj_mutex_create_simple(pool, NULL, &stream->jb_mutex);
+    status = pj_mutex_create_recursive(pool, NULL, &stream->jb_mutex);
     if (status != PJ_SUCCESS)
 	goto err_cleanup;
 
@@ -2114,6 +2759,17 @@ PJ_DEF(pj_status_t) pjmedia_stream_create( pjmedia_endpt *endpt,
 		           stream->codec_param.setting.frm_per_pkt * 1000;
     stream->port.info.fmt.id = stream->codec_param.info.fmt_id;
     if (stream->codec_param.info.fmt_id == PJMEDIA_FORMAT_L16) {
+	const pj_str_t pcmu = { "PCMU", 4 };
+	const pj_str_t pcma = { "PCMA", 4 };
+
+	/* Pre-encoded G.711 frames are sent as is by a G.711 codec of the
+	 * same law only.
+	 */
+	if (pj_stricmp(&info->fmt.encoding_name, &pcmu) == 0)
+	    stream->ext_frm_fmt = PJMEDIA_FORMAT_PCMU;
+	else if (pj_stricmp(&info->fmt.encoding_name, &pcma) == 0)
+	    stream->ext_frm_fmt = PJMEDIA_FORMAT_PCMA;
+
 	/* Raw format */
 	afd->avg_bps = afd->max_bps = afd->clock_rate * afd->channel_count *
 				      afd->bits_per_sample;
@@ -2258,6 +2914,62 @@ PJ_DEF(pj_status_t) pjmedia_stream_create( pjmedia_endpt *endpt,
     /* Set up jitter buffer */
     pjmedia_jbuf_set_adaptive( stream->jb, jb_init, jb_min_pre, jb_max_pre);
 
+    /* The percentile engine expects the playout to be time-stretched
+     * towards its target, which is only possible with linear PCM.
+     */
+    if (info->jb_engine == PJMEDIA_JB_ENGINE_PERCENTILE) {
+	status = pjmedia_jbuf_set_engine(stream->jb, info->jb_engine);
+	if (status != PJ_SUCCESS)
+	    goto err_cleanup;
+
+	if (stream->port.get_frame == &get_frame) {
+	    unsigned spf = PJMEDIA_PIA_SPF(&stream->port.info);
+
+	    status = pjmedia_wsola_create(pool, afd->clock_rate, spf,
+					  afd->channel_count, 0,
+					  &stream->jb_wsola);
+	    if (status != PJ_SUCCESS)
+		goto err_cleanup;
+
+	    /* The stage holds less than one frame of leftover samples plus
+	     * up to two decoded frames.
+	     */
+	    status = pjmedia_circ_buf_create(pool, 3 * spf,
+					     &stream->jb_stage);
+	    if (status != PJ_SUCCESS)
+		goto err_cleanup;
+
+	    stream->jb_stage_buf = (pj_int16_t*)
+				   pj_pool_alloc(pool, spf * BYTES_PER_SAMPLE);
+	    stream->jb_stretch_min_gap = PJMEDIA_JBUF_DISC_MIN_GAP /
+					 PJMEDIA_PIA_PTIME(&stream->port.info);
+	    stream->port.get_frame = &get_frame_stretch;
+	}
+    }
+
+#if defined(PJMEDIA_STREAM_PLC_LOOKAHEAD) && PJMEDIA_STREAM_PLC_LOOKAHEAD!=0
+    /* Set up the concealment with jitter buffer lookahead, for mono PCM */
+    if ((stream->port.get_frame == &get_frame ||
+	 stream->port.get_frame == &get_frame_stretch) &&
+	stream->codec_param.info.channel_cnt == 1 &&
+	stream->codec_param.setting.plc)
+    {
+	unsigned frm_spf = stream->codec_param.info.frm_ptime *
+			   stream->codec_param.info.clock_rate / 1000;
+
+	if (stream->codec->op->recover == NULL) {
+	    status = pjmedia_plc_create(pool,
+					stream->codec_param.info.clock_rate,
+					frm_spf, 0, &stream->plc);
+	    if (status != PJ_SUCCESS)
+		goto err_cleanup;
+	}
+
+	stream->plc_next_buf = (pj_int16_t*)
+			       pj_pool_alloc(pool, frm_spf * BYTES_PER_SAMPLE);
+    }
+#endif
+
     /* Create decoder channel: */
 
     status = create_channel( pool, stream, PJMEDIA_DIR_DECODING,
@@ -2451,6 +3163,14 @@ PJ_DEF(pj_status_t) pjmedia_stream_destroy( pjmedia_stream *stream )
 
     PJ_ASSERT_RETURN(stream != NULL, PJ_EINVAL);
 
+    /* Stop relaying, both to the peer and from the stream relaying to
+     * this stream, so that neither keeps a pointer to this stream.
+     */
+    if (stream->relay_peer)
+	pjmedia_stream_set_relay(stream, NULL);
+    if (stream->relay_src)
+	pjmedia_stream_set_relay(stream->relay_src, NULL);
+
     /* Send RTCP BYE (also SDES & XR) */
     if (!stream->rtcp_sdes_bye_disabled) {
 	send_rtcp(stream, PJ_TRUE, PJ_TRUE, PJ_TRUE);
@@ -2532,6 +3252,11 @@ PJ_DEF(pj_status_t) pjmedia_stream_destroy( pjmedia_stream *stream )
     if (stream->jb)
 	pjmedia_jbuf_destroy(stream->jb);
 
+    if (stream->jb_wsola) {
+	pjmedia_wsola_destroy(stream->jb_wsola);
+	stream->jb_wsola = NULL;
+    }
+
 #if TRACE_JB
     if (TRACE_JB_OPENED(stream)) {
 	pj_file_close(stream->trace_jb_fd);
@@ -2888,3 +3613,119 @@ pjmedia_stream_send_rtcp_bye( pjmedia_stream *stream )
 
     return PJ_SUCCESS;
 }
+
+/* Check that two sets of codec format parameters are the same, regardless
+ * of their order.
+ */
+static pj_bool_t fmtp_equal(const pjmedia_codec_fmtp *fmtp1,
+			    const pjmedia_codec_fmtp *fmtp2)
+{
+    unsigned i, j;
+
+    if (fmtp1->cnt != fmtp2->cnt)
+	return PJ_FALSE;
+
+    for (i = 0; i < fmtp1->cnt; ++i) {
+	for (j = 0; j < fmtp2->cnt; ++j) {
+	    if (pj_stricmp(&fmtp1->param[i].name,
+			   &fmtp2->param[j].name) == 0)
+	    {
+		break;
+	    }
+	}
+	if (j == fmtp2->cnt ||
+	    pj_stricmp(&fmtp1->param[i].val, &fmtp2->param[j].val) != 0)
+	{
+	    return PJ_FALSE;
+	}
+    }
+
+    return PJ_TRUE;
+}
+
+/*
+ * Forward incoming RTP to another stream.
+ */
+PJ_DEF(pj_status_t) pjmedia_stream_set_relay( pjmedia_stream *stream,
+					      pjmedia_stream *peer )
+{
+    pjmedia_stream *old_peer;
+
+    PJ_ASSERT_RETURN(stream && stream != peer, PJ_EINVAL);
+
+    if (peer) {
+	const pjmedia_audio_format_detail *afd1, *afd2;
+
+	PJ_ASSERT_RETURN(stream->dir & PJMEDIA_DIR_DECODING, PJ_EINVALIDOP);
+	PJ_ASSERT_RETURN(peer->dir & PJMEDIA_DIR_ENCODING, PJ_EINVALIDOP);
+
+	/* Both streams must use the same codec */
+	afd1 = pjmedia_format_get_audio_format_detail(&stream->port.info.fmt,
+						      PJ_TRUE);
+	afd2 = pjmedia_format_get_audio_format_detail(&peer->port.info.fmt,
+						      PJ_TRUE);
+	if (pj_stricmp(&stream->si.fmt.encoding_name,
+		       &peer->si.fmt.encoding_name) != 0 ||
+	    stream->si.fmt.clock_rate != peer->si.fmt.clock_rate ||
+	    afd1->channel_count != afd2->channel_count)
+	{
+	    return PJMEDIA_ENOTCOMPATIBLE;
+	}
+
+	/* The payload received by the stream is encoded with its decoder
+	 * parameters, the remote of the peer expects its encoder parameters
+	 * (e.g. iLBC mode or AMR octet-align).
+	 */
+	if (!fmtp_equal(&stream->codec_param.setting.dec_fmtp,
+			&peer->codec_param.setting.enc_fmtp))
+	{
+	    return PJMEDIA_ENOTCOMPATIBLE;
+	}
+    }
+
+    /* Only one stream is locked at a time here, since the streams may be
+     * relaying to each other. The peer is prepared before it starts
+     * receiving relayed packets, and released after it has stopped.
+     */
+    pj_mutex_lock(stream->jb_mutex);
+    old_peer = stream->relay_peer;
+    pj_mutex_unlock(stream->jb_mutex);
+
+    if (old_peer == peer)
+	return PJ_SUCCESS;
+
+    if (peer) {
+	pj_mutex_lock(peer->jb_mutex);
+	if (peer->relay_src) {
+	    /* Already fed by another stream */
+	    pj_mutex_unlock(peer->jb_mutex);
+	    return PJ_EBUSY;
+	}
+	peer->relay_tx_init = PJ_FALSE;
+	peer->rx_rr_valid = PJ_FALSE;
+	peer->relay_src = stream;
+	pj_mutex_unlock(peer->jb_mutex);
+    }
+
+    pj_mutex_lock(stream->jb_mutex);
+    if (peer) {
+	PJ_LOG(4,(stream->port.info.name.ptr, "Relaying RTP to %s",
+		  peer->port.info.name.ptr));
+    } else {
+	/* Start fresh when the decoder takes over again */
+	pjmedia_jbuf_reset(stream->jb);
+	PJ_LOG(4,(stream->port.info.name.ptr, "RTP relay stopped"));
+    }
+    stream->relay_peer = peer;
+    stream->relay_rr_valid = PJ_FALSE;
+    pj_mutex_unlock(stream->jb_mutex);
+
+    if (old_peer) {
+	pj_mutex_lock(old_peer->jb_mutex);
+	if (old_peer->relay_src == stream)
+	    old_peer->relay_src = NULL;
+	pj_mutex_unlock(old_peer->jb_mutex);
+    }
+
+    return PJ_SUCCESS;
+}
@@ -51,6 +51,10 @@
 
 #define THIS_FILE   "transport_srtp.c"
 
+#if SRTP_MAX_TRAILER_LEN + 4 > PJMEDIA_SRTP_MAX_TRAILER_LEN
+#  error "PJMEDIA_SRTP_MAX_TRAILER_LEN is too small for libsrtp"
+#endif
+
 /* Maximum size of outgoing packet */
 #define MAX_RTP_BUFFER_LEN	    PJMEDIA_MAX_MTU
 #define MAX_RTCP_BUFFER_LEN	    PJMEDIA_MAX_MTU
@@ -942,38 +946,17 @@ static pj_status_t transport_destroy  (pjmedia_transport *tp)
 }
 
 /*
- * This callback is called by transport when incoming rtp is received
+ * Unprotect incoming SRTP packet, restarting SRTP if needed while in
+ * probation state. Must be called with the mutex held.
  */
-static void srtp_rtp_cb( void *user_data, void *pkt, pj_ssize_t size)
+static err_status_t unprotect_rtp(transport_srtp *srtp, void *pkt, int *len)
 {
-    transport_srtp *srtp = (transport_srtp *) user_data;
-    int len = size;
     err_status_t err;
-    void (*cb)(void*, void*, pj_ssize_t) = NULL;
-    void *cb_data = NULL;
-
-    if (srtp->bypass_srtp) {
-	srtp->rtp_cb(srtp->user_data, pkt, size);
-	return;
-    }
-
-    if (size < 0) {
-	return;
-    }
-
-    /* Make sure buffer is 32bit aligned */
-    PJ_ASSERT_ON_FAIL( (((pj_ssize_t)pkt) & 0x03)==0, return );
 
     if (srtp->probation_cnt > 0)
 	--srtp->probation_cnt;
 
-    pj_lock_acquire(srtp->mutex);
-
-    if (!srtp->session_inited) {
-	pj_lock_release(srtp->mutex);
-	return;
-    }
-    err = srtp_unprotect(srtp->srtp_rx_ctx, (pj_uint8_t*)pkt, &len);
+    err = srtp_unprotect(srtp->srtp_rx_ctx, (pj_uint8_t*)pkt, len);
     if (srtp->probation_cnt > 0 &&
 	(err == err_status_replay_old || err == err_status_replay_fail))
     {
@@ -994,10 +977,44 @@ static void srtp_rtp_cb( void *user_data, void *pkt, pj_ssize_t size)
 	    PJ_LOG(5,(srtp->pool->obj_name, "Failed to restart SRTP, err=%s",
 		      get_libsrtp_errstr(err)));
 	} else if (!srtp->bypass_srtp) {
-	    err = srtp_unprotect(srtp->srtp_rx_ctx, (pj_uint8_t*)pkt, &len);
+	    err = srtp_unprotect(srtp->srtp_rx_ctx, (pj_uint8_t*)pkt, len);
 	}
     }
 
+    return err;
+}
+
+/*
+ * This callback is called by transport when incoming rtp is received
+ */
+static void srtp_rtp_cb( void *user_data, void *pkt, pj_ssize_t size)
+{
+    transport_srtp *srtp = (transport_srtp *) user_data;
+    int len = size;
+    err_status_t err;
+    void (*cb)(void*, void*, pj_ssize_t) = NULL;
+    void *cb_data = NULL;
+
+    if (srtp->bypass_srtp) {
+	srtp->rtp_cb(srtp->user_data, pkt, size);
+	return;
+    }
+
+    if (size < 0) {
+	return;
+    }
+
+    /* Make sure buffer is 32bit aligned */
+    PJ_ASSERT_ON_FAIL( (((pj_ssize_t)pkt) & 0x03)==0, return );
+
+    pj_lock_acquire(srtp->mutex);
+
+    if (!srtp->session_inited) {
+	pj_lock_release(srtp->mutex);
+	return;
+    }
+    err = unprotect_rtp(srtp, pkt, &len);
+
     if (err != err_status_ok) {
 	PJ_LOG(5,(srtp->pool->obj_name,
 		  "Failed to unprotect SRTP, pkt size=%d, err=%s",
@@ -1767,6 +1784,94 @@ PJ_DEF(pj_status_t) pjmedia_transport_srtp_decrypt_pkt(pjmedia_transport *tp,
     return (err==err_status_ok) ? PJ_SUCCESS : PJMEDIA_ERRNO_FROM_LIBSRTP(err);
 }
 
+
+/*
+ * Protect or unprotect a vector of packets, taking the mutex of each
+ * transport once for each run of its packets.
+ */
+static pj_status_t process_pkts(pjmedia_srtp_pkt pkts[], unsigned count,
+				pj_bool_t protect)
+{
+    pj_status_t status = PJ_SUCCESS;
+    unsigned i, j, k;
+
+    PJ_ASSERT_RETURN(pkts || count == 0, PJ_EINVAL);
+
+    for (i = 0; i < count; i = j) {
+	transport_srtp *srtp = (transport_srtp*) pkts[i].tp;
+
+	PJ_ASSERT_RETURN(srtp, PJ_EINVAL);
+
+	for (j = i + 1; j < count && pkts[j].tp == pkts[i].tp; ++j)
+	    ;
+
+	if (srtp->bypass_srtp) {
+	    for (k = i; k < j; ++k)
+		pkts[k].status = PJ_SUCCESS;
+	    continue;
+	}
+
+	pj_lock_acquire(srtp->mutex);
+
+	for (k = i; k < j; ++k) {
+	    pjmedia_srtp_pkt *p = &pkts[k];
+	    err_status_t err;
+
+	    /* Make sure buffer is 32bit aligned */
+	    if (!p->pkt || p->pkt_len <= 0 || (((pj_ssize_t)p->pkt) & 0x03)) {
+		p->status = PJ_EINVAL;
+	    } else if (!srtp->session_inited) {
+		p->status = PJ_EINVALIDOP;
+	    } else {
+		if (protect && p->is_rtp) {
+		    err = srtp_protect(srtp->srtp_tx_ctx, p->pkt, &p->pkt_len);
+		} else if (protect) {
+		    err = srtp_protect_rtcp(srtp->srtp_tx_ctx, p->pkt,
+					    &p->pkt_len);
+		} else if (p->is_rtp) {
+		    err = unprotect_rtp(srtp, p->pkt, &p->pkt_len);
+		} else {
+		    err = srtp_unprotect_rtcp(srtp->srtp_rx_ctx, p->pkt,
+					      &p->pkt_len);
+		}
+
+		if (err == err_status_ok) {
+		    p->status = PJ_SUCCESS;
+		} else {
+		    p->status = PJMEDIA_ERRNO_FROM_LIBSRTP(err);
+		    PJ_LOG(5,(srtp->pool->obj_name,
+			      "Failed to %s packet, pkt size=%d, err=%s",
+			      (protect ? "protect" : "unprotect"),
+			      p->pkt_len, get_libsrtp_errstr(err)));
+		}
+	    }
+
+	    if (p->status != PJ_SUCCESS && status == PJ_SUCCESS)
+		status = p->status;
+	}
+
+	pj_lock_release(srtp->mutex);
+    }
+
+    return status;
+}
+
+
+PJ_DEF(pj_status_t) pjmedia_transport_srtp_protect_pkts(
+					    pjmedia_srtp_pkt pkts[],
+					    unsigned count)
+{
+    return process_pkts(pkts, count, PJ_TRUE);
+}
+
+
+PJ_DEF(pj_status_t) pjmedia_transport_srtp_unprotect_pkts(
+					    pjmedia_srtp_pkt pkts[],
+					    unsigned count)
+{
+    return process_pkts(pkts, count, PJ_FALSE);
+}
+
 #endif
 
 
@@ -18,6 +18,7 @@
  * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA 
  */
 #include <pjmedia/transport_udp.h>
+#include <pjmedia/pkt_pool.h>
 #include <pj/addr_resolv.h>
 #include <pj/assert.h>
 #include <pj/errno.h>
@@ -52,6 +53,9 @@ struct transport_udp
     pjmedia_transport	base;		/**< Base transport.		    */
 
     pj_pool_t	       *pool;		/**< Memory pool		    */
+    pjmedia_endpt      *endpt;		/**< Media endpoint		    */
+    pj_bool_t		has_worker;	/**< Assigned to a media worker?    */
+    unsigned		worker;		/**< Media worker index		    */
     unsigned		options;	/**< Transport options.		    */
     unsigned		media_options;	/**< Transport media options.	    */
     void	       *user_data;	/**< Only valid when attached	    */
@@ -78,6 +82,9 @@ struct transport_udp
     pj_sockaddr		rtp_src_addr;	/**< Actual packet src addr.	    */
     unsigned		rtp_src_cnt;	/**< How many pkt from this addr.   */
     int			rtp_addrlen;	/**< Address length.		    */
+    pjmedia_pkt_pool   *rtp_pkt_pool;	/**< Packet pool of the endpt.	    */
+    pjmedia_pkt_buf    *rtp_pkt_buf;	/**< Pool buffer of pending read.   */
+    char	       *rtp_rx_buf;	/**< Buffer of pending read.	    */
     char		rtp_pkt[RTP_LEN];/**< Incoming RTP packet buffer    */
 
     pj_sock_t		rtcp_sock;	/**< RTCP socket		    */
@@ -96,6 +103,7 @@ struct transport_udp
 static void on_rx_rtp( pj_ioqueue_key_t *key, 
                        pj_ioqueue_op_key_t *op_key, 
                        pj_ssize_t bytes_read);
+static void get_rtp_rx_buf(struct transport_udp *udp);
 static void on_rx_rtcp(pj_ioqueue_key_t *key, 
                        pj_ioqueue_op_key_t *op_key, 
                        pj_ssize_t bytes_read);
@@ -284,9 +292,6 @@ PJ_DEF(pj_status_t) pjmedia_transport_udp_attach( pjmedia_endpt *endpt,
     /* Sanity check */
     PJ_ASSERT_RETURN(endpt && si && p_tp, PJ_EINVAL);
 
-    /* Get ioqueue instance */
-    ioqueue = pjmedia_endpt_get_ioqueue(endpt);
-
     if (name==NULL)
 	name = "udp%p";
 
@@ -301,6 +306,19 @@ PJ_DEF(pj_status_t) pjmedia_transport_udp_attach( pjmedia_endpt *endpt,
     pj_memcpy(tp->base.name, pool->obj_name, PJ_MAX_OBJ_NAME);
     tp->base.op = &transport_udp_op;
     tp->base.type = PJMEDIA_TRANSPORT_TYPE_UDP;
+    tp->endpt = endpt;
+
+    /* Get ioqueue instance. When the media endpoint has media workers,
+     * both sockets go to the least loaded worker, so this transport is
+     * always serviced by the same thread.
+     */
+    if (pjmedia_endpt_acquire_worker(endpt, &tp->worker, &ioqueue,
+				     NULL) == PJ_SUCCESS)
+    {
+	tp->has_worker = PJ_TRUE;
+    } else {
+	ioqueue = pjmedia_endpt_get_ioqueue(endpt);
+    }
 
     /* Copy socket infos */
     tp->rtp_sock = si->rtp_sock;
@@ -350,10 +368,12 @@ PJ_DEF(pj_status_t) pjmedia_transport_udp_attach( pjmedia_endpt *endpt,
 			       sizeof(tp->rtp_pending_write[i].op_key));
 
     /* Kick of pending RTP read from the ioqueue */
+    tp->rtp_pkt_pool = pjmedia_endpt_get_pkt_pool(endpt);
+    get_rtp_rx_buf(tp);
     tp->rtp_addrlen = sizeof(tp->rtp_src_addr);
-    size = sizeof(tp->rtp_pkt);
+    size = RTP_LEN;
     status = pj_ioqueue_recvfrom(tp->rtp_key, &tp->rtp_read_op,
-			         tp->rtp_pkt, &size, PJ_IOQUEUE_ALWAYS_ASYNC,
+			         tp->rtp_rx_buf, &size, PJ_IOQUEUE_ALWAYS_ASYNC,
 				 &tp->rtp_src_addr, &tp->rtp_addrlen);
     if (status != PJ_EPENDING)
 	goto on_error;
@@ -423,6 +443,16 @@ static pj_status_t transport_destroy(pjmedia_transport *tp)
 	udp->rtp_sock = PJ_INVALID_SOCKET;
     }
 
+    if (udp->rtp_pkt_buf) {
+	pjmedia_pkt_buf_dec_ref(udp->rtp_pkt_buf);
+	udp->rtp_pkt_buf = NULL;
+    }
+
+    if (udp->has_worker) {
+	pjmedia_endpt_release_worker(udp->endpt, udp->worker);
+	udp->has_worker = PJ_FALSE;
+    }
+
     if (udp->rtcp_key) {
 	pj_ioqueue_unregister(udp->rtcp_key);
 	udp->rtcp_key = NULL;
@@ -438,6 +468,35 @@ static pj_status_t transport_destroy(pjmedia_transport *tp)
 }
 
 
+/* Set the buffer for the next RTP read. The packet is received directly
+ * into a buffer of the packet pool, so that the stream can keep it in its
+ * jitter buffer without copying. A transport holds at most one pool
+ * buffer, and none when the pool is down to its reserve, in which case
+ * the private buffer is used.
+ */
+static void get_rtp_rx_buf(struct transport_udp *udp)
+{
+    if (udp->rtp_pkt_buf) {
+	pjmedia_pkt_buf_dec_ref(udp->rtp_pkt_buf);
+	udp->rtp_pkt_buf = NULL;
+    }
+
+    if (udp->rtp_pkt_pool &&
+	pjmedia_pkt_pool_get_free_cnt(udp->rtp_pkt_pool) >
+	    PJMEDIA_PKT_POOL_RESERVE)
+    {
+	udp->rtp_pkt_buf = pjmedia_pkt_pool_alloc(udp->rtp_pkt_pool);
+	if (udp->rtp_pkt_buf && udp->rtp_pkt_buf->size < RTP_LEN) {
+	    pjmedia_pkt_buf_dec_ref(udp->rtp_pkt_buf);
+	    udp->rtp_pkt_buf = NULL;
+	}
+    }
+
+    udp->rtp_rx_buf = udp->rtp_pkt_buf ? (char*)udp->rtp_pkt_buf->buf :
+					 udp->rtp_pkt;
+}
+
+
 /* Notification from ioqueue about incoming RTP packet */
 static void on_rx_rtp( pj_ioqueue_key_t *key, 
                        pj_ioqueue_op_key_t *op_key, 
@@ -530,12 +589,15 @@ static void on_rx_rtp( pj_ioqueue_key_t *key,
 	}
 
 	if (!discard && udp->attached && cb)
-	    (*cb)(user_data, udp->rtp_pkt, bytes_read);
+	    (*cb)(user_data, udp->rtp_rx_buf, bytes_read);
+
+	/* The stream has added its own reference if it keeps the packet */
+	get_rtp_rx_buf(udp);
 
-	bytes_read = sizeof(udp->rtp_pkt);
+	bytes_read = RTP_LEN;
 	udp->rtp_addrlen = sizeof(udp->rtp_src_addr);
 	status = pj_ioqueue_recvfrom(udp->rtp_key, &udp->rtp_read_op,
-				     udp->rtp_pkt, &bytes_read, 0,
+				     udp->rtp_rx_buf, &bytes_read, 0,
 				     &udp->rtp_src_addr, 
 				     &udp->rtp_addrlen);
 
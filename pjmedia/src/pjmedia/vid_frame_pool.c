@@ -0,0 +1,459 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2010-2011 Teluu Inc. (http://www.teluu.com)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include <pjmedia/vid_frame_pool.h>
+#include <pjmedia/errno.h>
+#include <pj/assert.h>
+#include <pj/hash.h>
+#include <pj/lock.h>
+#include <pj/log.h>
+#include <pj/string.h>
+
+
+#define THIS_FILE	"vid_frame_pool.c"
+
+/* Pictures are kept 32 bytes aligned for the SIMD code of the converters
+ * and codecs.
+ */
+#define BUF_ALIGN	32
+
+/* Size of the hash table used to find a buffer from its address */
+#define HASH_SIZE	63
+
+
+/* A buffer and the memory pool it lives in */
+struct frame_buf
+{
+    pjmedia_vid_frame_buf    base;
+    pj_pool_t		    *pool;
+    pj_hash_entry_buf	     hentry;
+};
+
+
+struct pjmedia_vid_frame_pool
+{
+    char		     obj_name[PJ_MAX_OBJ_NAME];
+    pj_pool_t		    *pool;
+    pj_pool_factory	    *pf;
+    pj_lock_t		    *lock;
+
+    /* All live buffers, keyed by address */
+    pj_hash_table_t	    *ht;
+    unsigned		     buf_cnt;
+
+    /* LIFO list of released buffers kept for reuse */
+    pjmedia_vid_frame_buf   *idle_list;
+    unsigned		     idle_cnt;
+    unsigned		     max_idle;
+};
+
+
+static pjmedia_vid_frame_pool *frame_pool_instance;
+
+
+PJ_DEF(pj_status_t) pjmedia_vid_frame_pool_create(pj_pool_factory *pf,
+						  const char *name,
+						  unsigned max_idle,
+						  pjmedia_vid_frame_pool **p_fp)
+{
+    pj_pool_t *pool;
+    pjmedia_vid_frame_pool *fp;
+    pj_status_t status;
+
+    PJ_ASSERT_RETURN(pf, PJ_EINVAL);
+
+    if (name == NULL)
+	name = "vidfrm%p";
+
+    pool = pj_pool_create(pf, name, 512, 512, NULL);
+    if (!pool)
+	return PJ_ENOMEM;
+
+    fp = PJ_POOL_ZALLOC_T(pool, pjmedia_vid_frame_pool);
+    pj_ansi_snprintf(fp->obj_name, sizeof(fp->obj_name), name, fp);
+    fp->pool = pool;
+    fp->pf = pf;
+    fp->max_idle = max_idle;
+
+    fp->ht = pj_hash_create(pool, HASH_SIZE);
+    status = pj_lock_create_simple_mutex(pool, fp->obj_name, &fp->lock);
+    if (status != PJ_SUCCESS) {
+	pj_pool_release(pool);
+	return status;
+    }
+
+    if (!frame_pool_instance)
+	frame_pool_instance = fp;
+
+    PJ_LOG(5,(fp->obj_name, "Video frame pool created"));
+
+    if (p_fp)
+	*p_fp = fp;
+
+    return PJ_SUCCESS;
+}
+
+
+PJ_DEF(pjmedia_vid_frame_pool*) pjmedia_vid_frame_pool_instance(void)
+{
+    return frame_pool_instance;
+}
+
+
+PJ_DEF(void) pjmedia_vid_frame_pool_set_instance(pjmedia_vid_frame_pool *fp)
+{
+    frame_pool_instance = fp;
+}
+
+
+static void free_buf(pjmedia_vid_frame_pool *fp, struct frame_buf *fb)
+{
+    pj_hash_set_np(fp->ht, &fb->base.buf, sizeof(fb->base.buf), 0,
+		   fb->hentry, NULL);
+    fp->buf_cnt--;
+    pj_pool_release(fb->pool);
+}
+
+
+PJ_DEF(void) pjmedia_vid_frame_pool_destroy(pjmedia_vid_frame_pool *fp)
+{
+    pj_hash_iterator_t it_buf, *it;
+
+    if (!fp) fp = frame_pool_instance;
+
+    PJ_ASSERT_ON_FAIL(fp != NULL, return);
+
+    if (fp->buf_cnt != fp->idle_cnt) {
+	PJ_LOG(4,(fp->obj_name, "Destroying video frame pool with %u "
+		  "buffers still in use", fp->buf_cnt - fp->idle_cnt));
+    }
+
+    /* Release the memory of all buffers, including those still in use */
+    while ((it = pj_hash_first(fp->ht, &it_buf)) != NULL) {
+	free_buf(fp, (struct frame_buf*) pj_hash_this(fp->ht, it));
+    }
+
+    if (frame_pool_instance == fp)
+	frame_pool_instance = NULL;
+
+    pj_lock_destroy(fp->lock);
+    pj_pool_release(fp->pool);
+}
+
+
+/* Take a buffer with one reference, must be called with the lock held */
+static pjmedia_vid_frame_buf *alloc_buf(pjmedia_vid_frame_pool *fp,
+					pj_size_t size)
+{
+    pjmedia_vid_frame_buf **p, **best = NULL;
+    struct frame_buf *fb;
+    pj_pool_t *pool;
+
+    /* Reuse the smallest idle buffer which is large enough */
+    for (p = &fp->idle_list; *p; p = &(*p)->next) {
+	if ((*p)->size >= size && (!best || (*p)->size < (*best)->size))
+	    best = p;
+    }
+
+    if (best) {
+	pjmedia_vid_frame_buf *b = *best;
+
+	*best = b->next;
+	fp->idle_cnt--;
+	b->next = NULL;
+	b->ref_cnt = 1;
+	return b;
+    }
+
+    /* None fits, e.g. after the picture size has changed. Drop one idle
+     * buffer so that buffers of an old size do not stay around forever.
+     */
+    if (fp->idle_list) {
+	fb = (struct frame_buf*) fp->idle_list;
+	fp->idle_list = fb->base.next;
+	fp->idle_cnt--;
+	free_buf(fp, fb);
+    }
+
+    pool = pj_pool_create(fp->pf, "vidfrm%p",
+			  sizeof(struct frame_buf) + size + BUF_ALIGN + 64,
+			  4096, NULL);
+    if (!pool)
+	return NULL;
+
+    fb = PJ_POOL_ZALLOC_T(pool, struct frame_buf);
+    fb->pool = pool;
+    fb->base.pool = fp;
+    fb->base.buf = pj_pool_alloc(pool, size + BUF_ALIGN);
+    if (!fb->base.buf) {
+	pj_pool_release(pool);
+	return NULL;
+    }
+    fb->base.buf = (void*)(((pj_size_t)fb->base.buf + BUF_ALIGN - 1) &
+			   ~(pj_size_t)(BUF_ALIGN - 1));
+    fb->base.size = size;
+    fb->base.ref_cnt = 1;
+
+    pj_hash_set_np(fp->ht, &fb->base.buf, sizeof(fb->base.buf), 0,
+		   fb->hentry, fb);
+    fp->buf_cnt++;
+
+    PJ_LOG(6,(fp->obj_name, "Buffer of %lu bytes allocated, total %u",
+	      (unsigned long)size, fp->buf_cnt));
+
+    return &fb->base;
+}
+
+
+/* Release a reference, must be called with the lock held */
+static void release_buf(pjmedia_vid_frame_pool *fp, pjmedia_vid_frame_buf *b)
+{
+    pj_assert(b->ref_cnt > 0);
+    if (--b->ref_cnt > 0)
+	return;
+
+    if (fp->idle_cnt < fp->max_idle) {
+	b->next = fp->idle_list;
+	fp->idle_list = b;
+	fp->idle_cnt++;
+    } else {
+	free_buf(fp, (struct frame_buf*)b);
+    }
+}
+
+
+/* Find buffer, must be called with the lock held */
+static pjmedia_vid_frame_buf *find_buf(pjmedia_vid_frame_pool *fp,
+				       const void *buf)
+{
+    if (!buf)
+	return NULL;
+
+    return (pjmedia_vid_frame_buf*)
+	   pj_hash_get(fp->ht, &buf, sizeof(buf), NULL);
+}
+
+
+PJ_DEF(pjmedia_vid_frame_buf*)
+pjmedia_vid_frame_pool_alloc(pjmedia_vid_frame_pool *fp, pj_size_t size)
+{
+    pjmedia_vid_frame_buf *b;
+
+    if (!fp) fp = frame_pool_instance;
+    if (!fp)
+	return NULL;
+
+    pj_lock_acquire(fp->lock);
+    b = alloc_buf(fp, size);
+    pj_lock_release(fp->lock);
+
+    return b;
+}
+
+
+PJ_DEF(pjmedia_vid_frame_buf*)
+pjmedia_vid_frame_pool_find(pjmedia_vid_frame_pool *fp, const void *buf)
+{
+    pjmedia_vid_frame_buf *b;
+
+    if (!fp) fp = frame_pool_instance;
+    if (!fp)
+	return NULL;
+
+    pj_lock_acquire(fp->lock);
+    b = find_buf(fp, buf);
+    pj_lock_release(fp->lock);
+
+    return b;
+}
+
+
+PJ_DEF(void) pjmedia_vid_frame_buf_add_ref(pjmedia_vid_frame_buf *fb)
+{
+    PJ_ASSERT_ON_FAIL(fb, return);
+
+    pj_lock_acquire(fb->pool->lock);
+    pj_assert(fb->ref_cnt > 0);
+    fb->ref_cnt++;
+    pj_lock_release(fb->pool->lock);
+}
+
+
+PJ_DEF(void) pjmedia_vid_frame_buf_dec_ref(pjmedia_vid_frame_buf *fb)
+{
+    pjmedia_vid_frame_pool *fp;
+
+    PJ_ASSERT_ON_FAIL(fb, return);
+
+    fp = fb->pool;
+    pj_lock_acquire(fp->lock);
+    release_buf(fp, fb);
+    pj_lock_release(fp->lock);
+}
+
+
+PJ_DEF(pj_status_t) pjmedia_vid_frame_pool_share(pjmedia_vid_frame_pool *fp,
+						 pjmedia_frame *dst,
+						 const pjmedia_frame *src)
+{
+    pjmedia_vid_frame_buf *s, *d;
+
+    PJ_ASSERT_RETURN(dst && src, PJ_EINVAL);
+
+    if (!fp) fp = frame_pool_instance;
+    if (!fp)
+	return PJ_ENOTFOUND;
+
+    pj_lock_acquire(fp->lock);
+
+    s = find_buf(fp, src->buf);
+    if (!s) {
+	pj_lock_release(fp->lock);
+	return PJ_ENOTFOUND;
+    }
+
+    d = find_buf(fp, dst->buf);
+    if (d != s) {
+	s->ref_cnt++;
+	if (d)
+	    release_buf(fp, d);
+	dst->buf = src->buf;
+    }
+
+    pj_lock_release(fp->lock);
+
+    dst->type = src->type;
+    dst->size = src->size;
+    dst->timestamp = src->timestamp;
+    dst->bit_info = src->bit_info;
+
+    return PJ_SUCCESS;
+}
+
+
+PJ_DEF(pj_status_t)
+pjmedia_vid_frame_pool_exchange(pjmedia_vid_frame_pool *fp,
+				pjmedia_frame *dst,
+				pjmedia_frame *src)
+{
+    pjmedia_vid_frame_buf *s, *d;
+
+    PJ_ASSERT_RETURN(dst && src, PJ_EINVAL);
+
+    if (!fp) fp = frame_pool_instance;
+    if (!fp)
+	return PJ_ENOTFOUND;
+
+    pj_lock_acquire(fp->lock);
+
+    s = find_buf(fp, src->buf);
+    d = find_buf(fp, dst->buf);
+    if (!s || !d || s == d) {
+	pj_lock_release(fp->lock);
+	return PJ_ENOTFOUND;
+    }
+
+    if (s->ref_cnt != 1 || d->ref_cnt != 1 || s->size < d->size) {
+	pj_lock_release(fp->lock);
+	return PJ_EINVALIDOP;
+    }
+
+    /* The source keeps a buffer as large as the one it gives away */
+    if (d->size < s->size) {
+	pjmedia_vid_frame_buf *n = alloc_buf(fp, s->size);
+
+	if (!n) {
+	    pj_lock_release(fp->lock);
+	    return PJ_ENOMEM;
+	}
+	release_buf(fp, d);
+	d = n;
+    }
+
+    pj_lock_release(fp->lock);
+
+    dst->buf = s->buf;
+    dst->type = src->type;
+    dst->size = src->size;
+    dst->timestamp = src->timestamp;
+    dst->bit_info = src->bit_info;
+
+    src->buf = d->buf;
+    src->size = 0;
+
+    return PJ_SUCCESS;
+}
+
+
+PJ_DEF(pj_status_t)
+pjmedia_vid_frame_pool_make_writable(pjmedia_vid_frame_pool *fp,
+				     pjmedia_frame *frame,
+				     pj_size_t size)
+{
+    pjmedia_vid_frame_buf *b, *n;
+
+    PJ_ASSERT_RETURN(frame, PJ_EINVAL);
+
+    if (!fp) fp = frame_pool_instance;
+    if (!fp)
+	return PJ_SUCCESS;
+
+    pj_lock_acquire(fp->lock);
+
+    b = find_buf(fp, frame->buf);
+    if (!b || (b->ref_cnt == 1 && b->size >= size)) {
+	pj_lock_release(fp->lock);
+	return PJ_SUCCESS;
+    }
+
+    n = alloc_buf(fp, (b->size > size? b->size : size));
+    if (!n) {
+	pj_lock_release(fp->lock);
+	return PJ_ENOMEM;
+    }
+    release_buf(fp, b);
+
+    pj_lock_release(fp->lock);
+
+    frame->buf = n->buf;
+    return PJ_SUCCESS;
+}
+
+
+PJ_DEF(void) pjmedia_vid_frame_pool_release(pjmedia_vid_frame_pool *fp,
+					    pjmedia_frame *frame)
+{
+    pjmedia_vid_frame_buf *b;
+
+    PJ_ASSERT_ON_FAIL(frame, return);
+
+    if (!fp) fp = frame_pool_instance;
+    if (!fp)
+	return;
+
+    pj_lock_acquire(fp->lock);
+    b = find_buf(fp, frame->buf);
+    if (b)
+	release_buf(fp, b);
+    pj_lock_release(fp->lock);
+
+    if (b) {
+	frame->buf = NULL;
+	frame->size = 0;
+    }
+}
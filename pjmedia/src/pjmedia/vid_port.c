@@ -22,6 +22,7 @@
 #include <pjmedia/errno.h>
 #include <pjmedia/event.h>
 #include <pjmedia/vid_codec.h>
+#include <pjmedia/vid_frame_pool.h>
 #include <pj/log.h>
 #include <pj/pool.h>
 
@@ -663,7 +664,16 @@ PJ_DEF(pj_status_t) pjmedia_vid_port_create( pj_pool_t *pool,
 
         vp->frm_buf = PJ_POOL_ZALLOC_T(pool, pjmedia_frame);
         vp->frm_buf_size = vafp.framebytes;
-        vp->frm_buf->buf = pj_pool_alloc(pool, vafp.framebytes);
+        {
+	    /* Use the video frame pool if there is one, so that pictures
+	     * can be passed to and from this buffer by reference.
+	     */
+	    pjmedia_vid_frame_buf *fb;
+
+	    fb = pjmedia_vid_frame_pool_alloc(NULL, vafp.framebytes);
+	    vp->frm_buf->buf = fb? fb->buf :
+			       pj_pool_alloc(pool, vafp.framebytes);
+        }
         vp->frm_buf->size = vp->frm_buf_size;
         vp->frm_buf->type = PJMEDIA_FRAME_TYPE_NONE;
 
@@ -833,6 +843,9 @@ PJ_DEF(void) pjmedia_vid_port_destroy(pjmedia_vid_port *vp)
 	pj_mutex_destroy(vp->frm_mutex);
 	vp->frm_mutex = NULL;
     }
+    if (vp->frm_buf) {
+	pjmedia_vid_frame_pool_release(NULL, vp->frm_buf);
+    }
     if (vp->conv.conv) {
         pjmedia_converter_destroy(vp->conv.conv);
         vp->conv.conv = NULL;
@@ -1011,12 +1024,20 @@ static pj_status_t convert_frame(pjmedia_vid_port *vp,
     return status;
 }
 
-/* Copy frame to buffer. */
+/* Copy frame to buffer. If the frame is in the video frame pool, just
+ * keep a reference to it.
+ */
 static void copy_frame_to_buffer(pjmedia_vid_port *vp,
                                  pjmedia_frame *frame)
 {
     pj_mutex_lock(vp->frm_mutex);
-    pjmedia_frame_copy(vp->frm_buf, frame);
+    if (pjmedia_vid_frame_pool_share(NULL, vp->frm_buf, frame) != PJ_SUCCESS &&
+	pjmedia_vid_frame_pool_make_writable(NULL, vp->frm_buf,
+					     vp->frm_buf_size) == PJ_SUCCESS)
+    {
+	vp->frm_buf->size = vp->frm_buf_size;
+	pjmedia_frame_copy(vp->frm_buf, frame);
+    }
     pj_mutex_unlock(vp->frm_mutex);
 }
 
@@ -1043,6 +1064,7 @@ static void enc_clock_cb(const pj_timestamp *ts, void *user_data)
      */
     pjmedia_vid_port *vp = (pjmedia_vid_port*)user_data;
     pjmedia_frame frame_;
+    pj_bool_t shared = PJ_FALSE;
     pj_status_t status = PJ_SUCCESS;
 
     pj_assert(vp->role==ROLE_ACTIVE);
@@ -1054,6 +1076,11 @@ static void enc_clock_cb(const pj_timestamp *ts, void *user_data)
 
     if (vp->stream_role == ROLE_PASSIVE) {
         while (vp->conv.usec_ctr < vp->conv.usec_dst) {
+            /* The previous picture may still be used by the client */
+            status = pjmedia_vid_frame_pool_make_writable(NULL, vp->frm_buf,
+                                                          vp->frm_buf_size);
+            if (status != PJ_SUCCESS)
+                return;
             vp->frm_buf->size = vp->frm_buf_size;
             status = pjmedia_vid_dev_stream_get_frame(vp->strm, vp->frm_buf);
             vp->conv.usec_ctr += vp->conv.usec_src;
@@ -1067,13 +1094,25 @@ static void enc_clock_cb(const pj_timestamp *ts, void *user_data)
 
     frame_.buf = vp->conv.conv_buf;
     frame_.size = vp->conv.conv_buf_size;
-    status = get_frame_from_buffer(vp, &frame_);
-    if (status != PJ_SUCCESS)
-        return;
+    if (!vp->conv.conv) {
+        /* No conversion needed, pass the picture by reference if it is in
+         * the video frame pool.
+         */
+        pj_mutex_lock(vp->frm_mutex);
+        shared = (pjmedia_vid_frame_pool_share(NULL, &frame_,
+                                               vp->frm_buf) == PJ_SUCCESS);
+        pj_mutex_unlock(vp->frm_mutex);
+    }
+    if (!shared) {
+        status = get_frame_from_buffer(vp, &frame_);
+        if (status != PJ_SUCCESS)
+            return;
+    }
 
     status = pjmedia_port_put_frame(vp->client_port, &frame_);
-    if (status != PJ_SUCCESS)
-        return;
+
+    if (shared)
+        pjmedia_vid_frame_pool_release(NULL, &frame_);
 }
 
 static void dec_clock_cb(const pj_timestamp *ts, void *user_data)
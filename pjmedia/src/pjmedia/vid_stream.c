@@ -23,6 +23,7 @@
 #include <pjmedia/rtcp.h>
 #include <pjmedia/jbuf.h>
 #include <pjmedia/stream_common.h>
+#include <pjmedia/vid_frame_pool.h>
 #include <pj/array.h>
 #include <pj/assert.h>
 #include <pj/compat/socket.h>
@@ -1243,7 +1244,11 @@ static pj_status_t get_frame(pjmedia_port *port,
 		      (int)frame->size, (int)stream->dec_frame.size));
 	    frame->type = PJMEDIA_FRAME_TYPE_NONE;
 	    frame->size = 0;
-	} else {
+	} else if (pjmedia_vid_frame_pool_exchange(NULL, frame,
+						   &stream->dec_frame) !=
+		   PJ_SUCCESS)
+	{
+	    /* The caller's buffer is not an unshared pool buffer, copy */
 	    frame->type = stream->dec_frame.type;
 	    frame->timestamp = stream->dec_frame.timestamp;
 	    frame->size = stream->dec_frame.size;
@@ -1545,9 +1550,18 @@ PJ_DEF(pj_status_t) pjmedia_vid_stream_create(
     if (status != PJ_SUCCESS)
 	return status;
 
-    /* Create temporary buffer for immediate decoding */
+    /* Create temporary buffer for immediate decoding. Take it from the
+     * video frame pool if there is one, so that get_frame() can hand the
+     * decoded picture over to the renderer without copying it.
+     */
     stream->dec_max_size = vfd_dec->size.w * vfd_dec->size.h * 4;
-    stream->dec_frame.buf = pj_pool_alloc(pool, stream->dec_max_size);
+    {
+	pjmedia_vid_frame_buf *fb;
+
+	fb = pjmedia_vid_frame_pool_alloc(NULL, stream->dec_max_size);
+	stream->dec_frame.buf = fb? fb->buf :
+				pj_pool_alloc(pool, stream->dec_max_size);
+    }
 
     /* Init jitter buffer parameters: */
     frm_ptime	    = 1000 * vfd_enc->fps.denum / vfd_enc->fps.num;
@@ -1751,6 +1765,9 @@ PJ_DEF(pj_status_t) pjmedia_vid_stream_destroy( pjmedia_vid_stream *stream )
 	stream->jb = NULL;
     }
 
+    /* Release the decoding buffer if it belongs to the video frame pool */
+    pjmedia_vid_frame_pool_release(NULL, &stream->dec_frame);
+
 #if TRACE_JB
     if (TRACE_JB_OPENED(stream)) {
 	pj_file_close(stream->trace_jb_fd);
@@ -19,6 +19,7 @@
 #include <pjmedia/vid_tee.h>
 #include <pjmedia/converter.h>
 #include <pjmedia/errno.h>
+#include <pjmedia/vid_frame_pool.h>
 #include <pj/array.h>
 #include <pj/log.h>
 #include <pj/pool.h>
@@ -130,6 +131,27 @@ PJ_DEF(pj_status_t) pjmedia_vid_tee_create( pj_pool_t *pool,
     return PJ_SUCCESS;
 }
 
+static void release_buf(vid_tee_port *vid_tee)
+{
+    pjmedia_frame frame;
+    unsigned i;
+
+    /* Buffers from the video frame pool may still be used by destination
+     * ports, so they are released rather than freed with buf_pool.
+     */
+    pj_bzero(&frame, sizeof(frame));
+    for (i = 0; i < PJ_ARRAY_SIZE(vid_tee->buf); i++) {
+        frame.buf = vid_tee->buf[i];
+        pjmedia_vid_frame_pool_release(NULL, &frame);
+        vid_tee->buf[i] = NULL;
+    }
+
+    if (vid_tee->buf_pool) {
+        pj_pool_release(vid_tee->buf_pool);
+        vid_tee->buf_pool = NULL;
+    }
+}
+
 static void realloc_buf(vid_tee_port *vid_tee,
                         unsigned buf_cnt, pj_size_t buf_size)
 {
@@ -141,23 +163,51 @@ static void realloc_buf(vid_tee_port *vid_tee,
     if (buf_size > vid_tee->buf_size) {
         /* We need a larger buffer here. */
         vid_tee->buf_size = buf_size;
-        if (vid_tee->buf_pool) {
-            pj_pool_release(vid_tee->buf_pool);
-            vid_tee->buf_pool = NULL;
-        }
-        vid_tee->buf[0] = vid_tee->buf[1] = NULL;
-    }
-    
-    if (!vid_tee->buf_pool) {
-        vid_tee->buf_pool = pj_pool_create(vid_tee->pf, "video tee buffer",
-                                           1000, 1000, NULL);
+        release_buf(vid_tee);
     }
  
     for (i = 0; i < vid_tee->buf_cnt; i++) {
-        if (!vid_tee->buf[i])
-            vid_tee->buf[i] = pj_pool_alloc(vid_tee->buf_pool,
-                                            vid_tee->buf_size);
+        pjmedia_vid_frame_buf *fb;
+
+        if (vid_tee->buf[i])
+            continue;
+
+        /* Prefer the video frame pool, so that destination ports can
+         * keep the converted picture by reference.
+         */
+        fb = pjmedia_vid_frame_pool_alloc(NULL, vid_tee->buf_size);
+        if (fb) {
+            vid_tee->buf[i] = fb->buf;
+            continue;
+        }
+
+        if (!vid_tee->buf_pool) {
+            vid_tee->buf_pool = pj_pool_create(vid_tee->pf,
+                                               "video tee buffer",
+                                               1000, 1000, NULL);
+        }
+        vid_tee->buf[i] = pj_pool_alloc(vid_tee->buf_pool,
+                                        vid_tee->buf_size);
+    }
+}
+
+/* Get a buffer to write a new picture into. A buffer still used by a
+ * destination port from the previous picture is replaced.
+ */
+static void *get_writable_buf(vid_tee_port *vid_tee, unsigned idx)
+{
+    pjmedia_frame frame;
+
+    pj_bzero(&frame, sizeof(frame));
+    frame.buf = vid_tee->buf[idx];
+    if (pjmedia_vid_frame_pool_make_writable(NULL, &frame,
+                                             vid_tee->buf_size) != PJ_SUCCESS)
+    {
+        return NULL;
     }
+
+    vid_tee->buf[idx] = frame.buf;
+    return frame.buf;
 }
 
 /*
@@ -198,9 +248,32 @@ PJ_DEF(pj_status_t) pjmedia_vid_tee_add_dst_port(pjmedia_port *vid_tee,
 }
 
 
+/*
+ * Destroy the converter of a destination port, unless another destination
+ * port shares it.
+ */
+static void release_conv(vid_tee_port *tee, unsigned idx)
+{
+    unsigned i;
+
+    if (!tee->tee_conv[idx].conv)
+        return;
+
+    for (i = 0; i < tee->dst_port_cnt; ++i) {
+        if (i != idx && tee->tee_conv[i].conv == tee->tee_conv[idx].conv)
+            break;
+    }
+    if (i == tee->dst_port_cnt)
+        pjmedia_converter_destroy(tee->tee_conv[idx].conv);
+
+    tee->tee_conv[idx].conv = NULL;
+}
+
+
 /*
  * Add a destination media port to the video tee. Create a converter if
- * necessary.
+ * necessary, or share the converter of a destination port which has the
+ * same format.
  */
 PJ_DEF(pj_status_t) pjmedia_vid_tee_add_dst_port2(pjmedia_port *vid_tee,
 						  unsigned option,
@@ -227,6 +300,22 @@ PJ_DEF(pj_status_t) pjmedia_vid_tee_add_dst_port2(pjmedia_port *vid_tee,
         pjmedia_video_apply_fmt_param vafp;
         pjmedia_conversion_param conv_param;
         pj_status_t status;
+        unsigned i;
+
+        /* Share the converter of a destination port with the same format,
+         * tee_put_frame() converts the picture once for both of them.
+         */
+        for (i = 0; i < tee->dst_port_cnt; ++i) {
+            pjmedia_port *dst = tee->dst_ports[i].dst;
+
+            if (tee->tee_conv[i].conv &&
+                dst->info.fmt.id == port->info.fmt.id &&
+                dst->info.fmt.det.vid.size.w == vfd->size.w &&
+                dst->info.fmt.det.vid.size.h == vfd->size.h)
+            {
+                break;
+            }
+        }
 
         vfi = pjmedia_get_video_format_info(NULL, port->info.fmt.id);
         if (vfi == NULL)
@@ -241,14 +330,18 @@ PJ_DEF(pj_status_t) pjmedia_vid_tee_add_dst_port2(pjmedia_port *vid_tee,
         realloc_buf(tee, (option & PJMEDIA_VID_TEE_DST_DO_IN_PLACE_PROC)?
                     2: 1, vafp.framebytes);
         
-        pjmedia_format_copy(&conv_param.src, &vid_tee->info.fmt);
-	pjmedia_format_copy(&conv_param.dst, &port->info.fmt);
-        
-        status = pjmedia_converter_create(
-                     NULL, tee->pool, &conv_param,
-                     &tee->tee_conv[tee->dst_port_cnt].conv);
-        if (status != PJ_SUCCESS)
-            return status;
+        if (i < tee->dst_port_cnt) {
+            tee->tee_conv[tee->dst_port_cnt].conv = tee->tee_conv[i].conv;
+        } else {
+            pjmedia_format_copy(&conv_param.src, &vid_tee->info.fmt);
+            pjmedia_format_copy(&conv_param.dst, &port->info.fmt);
+
+            status = pjmedia_converter_create(
+                         NULL, tee->pool, &conv_param,
+                         &tee->tee_conv[tee->dst_port_cnt].conv);
+            if (status != PJ_SUCCESS)
+                return status;
+        }
         
         tee->tee_conv[tee->dst_port_cnt].conv_buf_size = vafp.framebytes;
     } else {
@@ -278,9 +371,8 @@ PJ_DEF(pj_status_t) pjmedia_vid_tee_remove_dst_port(pjmedia_port *vid_tee,
 
     for (i = 0; i < tee->dst_port_cnt; ++i) {
 	if (tee->dst_ports[i].dst == port) {
-            if (tee->tee_conv[i].conv)
-                pjmedia_converter_destroy(tee->tee_conv[i].conv);
-            
+            release_conv(tee, i);
+
 	    pj_array_erase(tee->dst_ports, sizeof(tee->dst_ports[0]),
 			   tee->dst_port_cnt, i);
             pj_array_erase(tee->tee_conv, sizeof(tee->tee_conv[0]),
@@ -312,8 +404,10 @@ static pj_status_t tee_put_frame(pjmedia_port *port, pjmedia_frame *frame)
         if (tee->tee_conv[i].conv) {
             pj_status_t status;
             
-            frame_.buf  = tee->buf[0];
+            frame_.buf  = get_writable_buf(tee, 0);
             frame_.size = tee->tee_conv[i].conv_buf_size;
+            if (!frame_.buf)
+                continue;
             status = pjmedia_converter_convert(tee->tee_conv[i].conv,
                                                frame, &frame_);
             if (status != PJ_SUCCESS) {
@@ -350,8 +444,10 @@ static pj_status_t tee_put_frame(pjmedia_port *port, pjmedia_frame *frame)
             if (tee->dst_ports[j].option & PJMEDIA_VID_TEE_DST_DO_IN_PLACE_PROC)
             {
                 PJ_ASSERT_RETURN(tee->buf_size <= frame_.size, PJ_ETOOBIG);
-                framep.buf = tee->buf[tee->buf_cnt-1];
+                framep.buf = get_writable_buf(tee, tee->buf_cnt-1);
                 framep.size = frame_.size;
+                if (!framep.buf)
+                    continue;
                 pj_memcpy(framep.buf, frame_.buf, frame_.size);
             }
 
@@ -383,9 +479,12 @@ static pj_status_t tee_destroy(pjmedia_port *port)
 
     PJ_ASSERT_RETURN(port && port->info.signature==TEE_PORT_SIGN, PJ_EINVAL);
 
+    while (tee->dst_port_cnt) {
+        release_conv(tee, --tee->dst_port_cnt);
+    }
+
     pj_pool_release(tee->pool);
-    if (tee->buf_pool)
-        pj_pool_release(tee->buf_pool);
+    release_buf(tee);
                     
     pj_bzero(tee, sizeof(*tee));
 
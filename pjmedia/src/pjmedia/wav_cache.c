@@ -0,0 +1,557 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2011 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include <pjmedia/wav_cache.h>
+#include <pjmedia/alaw_ulaw.h>
+#include <pjmedia/errno.h>
+#include <pjmedia/wave.h>
+#include <pj/assert.h>
+#include <pj/errno.h>
+#include <pj/file_access.h>
+#include <pj/file_io.h>
+#include <pj/hash.h>
+#include <pj/list.h>
+#include <pj/log.h>
+#include <pj/os.h>
+#include <pj/pool.h>
+#include <pj/string.h>
+
+#if PJMEDIA_WAV_CACHE_USE_MMAP
+#   include <errno.h>
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+
+#define THIS_FILE	"wav_cache.c"
+
+
+struct pjmedia_wav_cache_entry
+{
+    PJ_DECL_LIST_MEMBER(struct pjmedia_wav_cache_entry);
+
+    pjmedia_wav_cache	    *cache;
+    pj_pool_t		    *pool;
+    char		    *filename;
+    pj_hash_entry_buf	     hbuf;
+    unsigned		     ref_cnt;
+    pjmedia_wav_cache_info   info;
+
+    /* The mapped file, if the file is mapped */
+    void		    *map;
+    pj_size_t		     map_size;
+
+    /* Payload as stored in the file (little endian) */
+    const pj_uint8_t	    *data;
+
+    /* Payload in each format, created on demand */
+    const void		    *pcm;
+    const void		    *ulaw;
+    const void		    *alaw;
+};
+
+
+struct pjmedia_wav_cache
+{
+    pj_pool_t		    *pool;
+    pj_pool_factory	    *pf;
+    pj_mutex_t		    *mutex;
+    pj_hash_table_t	    *ht;
+    pjmedia_wav_cache_entry  entries;
+};
+
+
+/* Parse the WAV header of the file in memory and locate the payload. */
+static pj_status_t parse_file(pjmedia_wav_cache_entry *e,
+			      const pj_uint8_t *file,
+			      pj_size_t size)
+{
+    pjmedia_wave_hdr hdr;
+    pjmedia_wave_subchunk subchunk;
+    pj_size_t pos;
+    unsigned bytes_per_sample;
+
+    /* Size must be more than WAVE header size */
+    if (size <= sizeof(pjmedia_wave_hdr))
+	return PJMEDIA_ENOTVALIDWAVE;
+
+    /* The file header plus fmt header only */
+    pj_memcpy(&hdr, file, sizeof(hdr) - 8);
+    pjmedia_wave_hdr_file_to_host(&hdr);
+
+    if (hdr.riff_hdr.riff != PJMEDIA_RIFF_TAG ||
+	hdr.riff_hdr.wave != PJMEDIA_WAVE_TAG ||
+	hdr.fmt_hdr.fmt != PJMEDIA_FMT_TAG)
+    {
+	return PJMEDIA_ENOTVALIDWAVE;
+    }
+
+    switch (hdr.fmt_hdr.fmt_tag) {
+    case PJMEDIA_WAVE_FMT_TAG_PCM:
+	if (hdr.fmt_hdr.bits_per_sample != 16 ||
+	    hdr.fmt_hdr.block_align != 2 * hdr.fmt_hdr.nchan)
+	{
+	    return PJMEDIA_EWAVEUNSUPP;
+	}
+	e->info.fmt_id = PJMEDIA_FORMAT_PCM;
+	bytes_per_sample = 2;
+	break;
+
+    case PJMEDIA_WAVE_FMT_TAG_ALAW:
+    case PJMEDIA_WAVE_FMT_TAG_ULAW:
+	if (hdr.fmt_hdr.bits_per_sample != 8 ||
+	    hdr.fmt_hdr.block_align != hdr.fmt_hdr.nchan)
+	{
+	    return PJMEDIA_ENOTVALIDWAVE;
+	}
+	e->info.fmt_id = (hdr.fmt_hdr.fmt_tag == PJMEDIA_WAVE_FMT_TAG_ALAW) ?
+			 PJMEDIA_FORMAT_ALAW : PJMEDIA_FORMAT_ULAW;
+	bytes_per_sample = 1;
+	break;
+
+    default:
+	return PJMEDIA_EWAVEUNSUPP;
+    }
+
+    if (hdr.fmt_hdr.nchan == 0 || hdr.fmt_hdr.sample_rate == 0)
+	return PJMEDIA_ENOTVALIDWAVE;
+
+    /* Skip the chunks until the 'data' chunk */
+    pos = 20 + hdr.fmt_hdr.len;
+    for (;;) {
+	if (pos + 8 > size)
+	    return PJMEDIA_EWAVETOOSHORT;
+
+	pj_memcpy(&subchunk, file + pos, 8);
+	PJMEDIA_WAVE_NORMALIZE_SUBCHUNK(&subchunk);
+	pos += 8;
+
+	if (subchunk.id == PJMEDIA_DATA_TAG)
+	    break;
+
+	pos += subchunk.len;
+    }
+
+    if (subchunk.len > size - pos)
+	return PJMEDIA_EWAVEUNSUPP;
+    if (subchunk.len < bytes_per_sample * hdr.fmt_hdr.nchan)
+	return PJMEDIA_EWAVETOOSHORT;
+
+    e->data = file + pos;
+    e->info.clock_rate = hdr.fmt_hdr.sample_rate;
+    e->info.channel_count = hdr.fmt_hdr.nchan;
+    e->info.size_samples = subchunk.len / bytes_per_sample;
+    e->info.size_samples -= e->info.size_samples % hdr.fmt_hdr.nchan;
+
+    return PJ_SUCCESS;
+}
+
+
+/* Load the file into the entry. */
+static pj_status_t load_file(pjmedia_wav_cache_entry *e)
+{
+    const pj_uint8_t *file;
+    pj_size_t size;
+
+#if PJMEDIA_WAV_CACHE_USE_MMAP
+    struct stat st;
+    int fd;
+
+    fd = open(e->filename, O_RDONLY);
+    if (fd < 0)
+	return (errno == ENOENT) ? PJ_ENOTFOUND : PJ_RETURN_OS_ERROR(errno);
+
+    if (fstat(fd, &st) != 0) {
+	pj_status_t status = PJ_RETURN_OS_ERROR(errno);
+	close(fd);
+	return status;
+    }
+
+    size = (pj_size_t)st.st_size;
+    if (size <= sizeof(pjmedia_wave_hdr)) {
+	close(fd);
+	return PJMEDIA_ENOTVALIDWAVE;
+    }
+
+    e->map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (e->map == MAP_FAILED) {
+	e->map = NULL;
+	return PJ_RETURN_OS_ERROR(errno);
+    }
+    e->map_size = size;
+    file = (const pj_uint8_t*) e->map;
+
+#else
+    pj_oshandle_t fd;
+    pj_ssize_t size_read;
+    pj_off_t fsize;
+    pj_status_t status;
+
+    if (!pj_file_exists(e->filename))
+	return PJ_ENOTFOUND;
+
+    fsize = pj_file_size(e->filename);
+    if (fsize <= (pj_off_t)sizeof(pjmedia_wave_hdr))
+	return PJMEDIA_ENOTVALIDWAVE;
+    size = (pj_size_t)fsize;
+
+    file = (const pj_uint8_t*) pj_pool_alloc(e->pool, size);
+    if (!file)
+	return PJ_ENOMEM;
+
+    status = pj_file_open(e->pool, e->filename, PJ_O_RDONLY, &fd);
+    if (status != PJ_SUCCESS)
+	return status;
+
+    size_read = (pj_ssize_t)size;
+    status = pj_file_read(fd, (void*)file, &size_read);
+    pj_file_close(fd);
+    if (status != PJ_SUCCESS)
+	return status;
+    if (size_read != (pj_ssize_t)size)
+	return PJMEDIA_EWAVETOOSHORT;
+#endif
+
+    return parse_file(e, file, size);
+}
+
+
+static void destroy_entry(pjmedia_wav_cache_entry *e)
+{
+#if PJMEDIA_WAV_CACHE_USE_MMAP
+    if (e->map) {
+	munmap(e->map, e->map_size);
+	e->map = NULL;
+    }
+#endif
+    pj_pool_release(e->pool);
+}
+
+
+/*
+ * Create the cache.
+ */
+PJ_DEF(pj_status_t) pjmedia_wav_cache_create(pj_pool_factory *pf,
+					     pjmedia_wav_cache **p_cache)
+{
+    pj_pool_t *pool;
+    pjmedia_wav_cache *cache;
+    pj_status_t status;
+
+    PJ_ASSERT_RETURN(pf && p_cache, PJ_EINVAL);
+
+    pool = pj_pool_create(pf, "wavcache%p", 512, 512, NULL);
+    if (!pool)
+	return PJ_ENOMEM;
+
+    cache = PJ_POOL_ZALLOC_T(pool, pjmedia_wav_cache);
+    cache->pool = pool;
+    cache->pf = pf;
+    pj_list_init(&cache->entries);
+
+    status = pj_mutex_create_simple(pool, "wavcache", &cache->mutex);
+    if (status != PJ_SUCCESS) {
+	pj_pool_release(pool);
+	return status;
+    }
+
+    cache->ht = pj_hash_create(pool, 31);
+
+    *p_cache = cache;
+    return PJ_SUCCESS;
+}
+
+
+/*
+ * Get a file from the cache.
+ */
+PJ_DEF(pj_status_t) pjmedia_wav_cache_get(pjmedia_wav_cache *cache,
+					  const char *filename,
+					  pjmedia_wav_cache_entry **p_entry)
+{
+    pjmedia_wav_cache_entry *e;
+    pj_pool_t *pool;
+    pj_size_t len;
+    pj_status_t status;
+
+    PJ_ASSERT_RETURN(cache && filename && p_entry, PJ_EINVAL);
+
+    len = pj_ansi_strlen(filename);
+
+    pj_mutex_lock(cache->mutex);
+
+    e = (pjmedia_wav_cache_entry*)
+	pj_hash_get(cache->ht, filename, (unsigned)len, NULL);
+    if (e) {
+	++e->ref_cnt;
+	pj_mutex_unlock(cache->mutex);
+	*p_entry = e;
+	return PJ_SUCCESS;
+    }
+
+    /* Load the file. This is done with the cache locked, so that several
+     * players which start the same prompt at the same time load it once.
+     */
+    pool = pj_pool_create(cache->pf, "wavc%p", 512, 4000, NULL);
+    if (!pool) {
+	pj_mutex_unlock(cache->mutex);
+	return PJ_ENOMEM;
+    }
+
+    e = PJ_POOL_ZALLOC_T(pool, pjmedia_wav_cache_entry);
+    e->cache = cache;
+    e->pool = pool;
+    e->filename = (char*) pj_pool_alloc(pool, len + 1);
+    pj_memcpy(e->filename, filename, len + 1);
+
+    status = load_file(e);
+    if (status != PJ_SUCCESS) {
+	pj_mutex_unlock(cache->mutex);
+	destroy_entry(e);
+	return status;
+    }
+
+    e->ref_cnt = 1;
+    pj_hash_set_np(cache->ht, e->filename, (unsigned)len, 0, e->hbuf, e);
+    pj_list_push_back(&cache->entries, e);
+
+    pj_mutex_unlock(cache->mutex);
+
+    PJ_LOG(4,(THIS_FILE, "WAV file '%s' cached: samp.rate=%u, ch=%u, "
+	      "%u samples%s", filename, e->info.clock_rate,
+	      e->info.channel_count, e->info.size_samples,
+	      (e->map ? ", mapped" : "")));
+
+    *p_entry = e;
+    return PJ_SUCCESS;
+}
+
+
+/*
+ * Release a cache entry.
+ */
+PJ_DEF(void) pjmedia_wav_cache_release(pjmedia_wav_cache_entry *entry)
+{
+    PJ_ASSERT_ON_FAIL(entry, return);
+
+    pj_mutex_lock(entry->cache->mutex);
+    pj_assert(entry->ref_cnt > 0);
+    --entry->ref_cnt;
+    pj_mutex_unlock(entry->cache->mutex);
+}
+
+
+/*
+ * Get the entry info.
+ */
+PJ_DEF(pj_status_t)
+pjmedia_wav_cache_entry_get_info(const pjmedia_wav_cache_entry *entry,
+				 pjmedia_wav_cache_info *info)
+{
+    PJ_ASSERT_RETURN(entry && info, PJ_EINVAL);
+
+    pj_memcpy(info, &entry->info, sizeof(*info));
+    return PJ_SUCCESS;
+}
+
+
+/* Get the PCM payload, converting it if needed. Cache must be locked. */
+static const pj_int16_t *get_pcm(pjmedia_wav_cache_entry *e)
+{
+    pj_uint32_t cnt = e->info.size_samples;
+    pj_int16_t *pcm;
+
+    if (e->pcm)
+	return (const pj_int16_t*) e->pcm;
+
+#if !defined(PJ_IS_BIG_ENDIAN) || PJ_IS_BIG_ENDIAN==0
+    /* The file payload can be used as it is if it's aligned */
+    if (e->info.fmt_id == PJMEDIA_FORMAT_PCM &&
+	((pj_size_t)e->data & 1) == 0)
+    {
+	e->pcm = e->data;
+	return (const pj_int16_t*) e->pcm;
+    }
+#endif
+
+    pcm = (pj_int16_t*) pj_pool_alloc(e->pool, cnt * sizeof(pj_int16_t));
+    if (!pcm)
+	return NULL;
+
+    if (e->info.fmt_id == PJMEDIA_FORMAT_ULAW) {
+	pjmedia_ulaw_decode_block(pcm, e->data, cnt);
+    } else if (e->info.fmt_id == PJMEDIA_FORMAT_ALAW) {
+	pjmedia_alaw_decode_block(pcm, e->data, cnt);
+    } else {
+	pj_uint32_t i;
+
+	/* Little endian samples, possibly unaligned */
+	for (i = 0; i < cnt; ++i) {
+	    pcm[i] = (pj_int16_t)(e->data[i*2] | (e->data[i*2+1] << 8));
+	}
+    }
+
+    e->pcm = pcm;
+    return pcm;
+}
+
+
+/* Get the G.711 payload, converting it if needed. Cache must be locked. */
+static const pj_uint8_t *get_g711(pjmedia_wav_cache_entry *e,
+				  pjmedia_format_id fmt_id)
+{
+    const void **p_data = (fmt_id == PJMEDIA_FORMAT_ULAW) ? &e->ulaw :
+							    &e->alaw;
+    pj_uint32_t i, cnt = e->info.size_samples;
+    pj_uint8_t *data;
+
+    if (*p_data)
+	return (const pj_uint8_t*) *p_data;
+
+    if (e->info.fmt_id == fmt_id) {
+	*p_data = e->data;
+	return e->data;
+    }
+
+    data = (pj_uint8_t*) pj_pool_alloc(e->pool, cnt);
+    if (!data)
+	return NULL;
+
+    if (e->info.fmt_id == PJMEDIA_FORMAT_PCM) {
+	const pj_int16_t *pcm = get_pcm(e);
+	if (!pcm)
+	    return NULL;
+
+	if (fmt_id == PJMEDIA_FORMAT_ULAW)
+	    pjmedia_ulaw_encode_block(data, pcm, cnt);
+	else
+	    pjmedia_alaw_encode_block(data, pcm, cnt);
+
+    } else if (fmt_id == PJMEDIA_FORMAT_ULAW) {
+	/* From A-Law */
+	for (i = 0; i < cnt; ++i)
+	    data[i] = pjmedia_alaw2ulaw(e->data[i]);
+
+    } else {
+	/* From U-Law */
+	for (i = 0; i < cnt; ++i)
+	    data[i] = pjmedia_ulaw2alaw(e->data[i]);
+    }
+
+    *p_data = data;
+    return data;
+}
+
+
+/*
+ * Get the entry payload.
+ */
+PJ_DEF(pj_status_t)
+pjmedia_wav_cache_entry_get_data(pjmedia_wav_cache_entry *entry,
+				 pjmedia_format_id fmt_id,
+				 const void **p_data,
+				 pj_size_t *p_size)
+{
+    const void *data;
+    pj_size_t size;
+
+    PJ_ASSERT_RETURN(entry && p_data && p_size, PJ_EINVAL);
+    PJ_ASSERT_RETURN(fmt_id == PJMEDIA_FORMAT_PCM ||
+		     fmt_id == PJMEDIA_FORMAT_ULAW ||
+		     fmt_id == PJMEDIA_FORMAT_ALAW, PJ_ENOTSUP);
+
+    pj_mutex_lock(entry->cache->mutex);
+
+    if (fmt_id == PJMEDIA_FORMAT_PCM) {
+	data = get_pcm(entry);
+	size = entry->info.size_samples * sizeof(pj_int16_t);
+    } else {
+	data = get_g711(entry, fmt_id);
+	size = entry->info.size_samples;
+    }
+
+    pj_mutex_unlock(entry->cache->mutex);
+
+    if (!data)
+	return PJ_ENOMEM;
+
+    *p_data = data;
+    *p_size = size;
+    return PJ_SUCCESS;
+}
+
+
+/*
+ * Remove unused entries.
+ */
+PJ_DEF(unsigned) pjmedia_wav_cache_flush(pjmedia_wav_cache *cache)
+{
+    pjmedia_wav_cache_entry *e, *next;
+    unsigned cnt = 0;
+
+    PJ_ASSERT_RETURN(cache, 0);
+
+    pj_mutex_lock(cache->mutex);
+
+    for (e = cache->entries.next; e != &cache->entries; e = next) {
+	next = e->next;
+
+	if (e->ref_cnt)
+	    continue;
+
+	pj_hash_set(NULL, cache->ht, e->filename, PJ_HASH_KEY_STRING, 0,
+		    NULL);
+	pj_list_erase(e);
+	destroy_entry(e);
+	++cnt;
+    }
+
+    pj_mutex_unlock(cache->mutex);
+
+    return cnt;
+}
+
+
+/*
+ * Destroy the cache.
+ */
+PJ_DEF(pj_status_t) pjmedia_wav_cache_destroy(pjmedia_wav_cache *cache)
+{
+    PJ_ASSERT_RETURN(cache, PJ_EINVAL);
+
+    while (!pj_list_empty(&cache->entries)) {
+	pjmedia_wav_cache_entry *e = cache->entries.next;
+
+	if (e->ref_cnt) {
+	    PJ_LOG(3,(THIS_FILE, "Destroying WAV cache while '%s' is still "
+		      "in use", e->filename));
+	}
+
+	pj_list_erase(e);
+	destroy_entry(e);
+    }
+
+    pj_mutex_destroy(cache->mutex);
+    pj_pool_release(cache->pool);
+
+    return PJ_SUCCESS;
+}
@@ -72,12 +72,26 @@ struct file_reader_port
     pj_off_t	     fpos;
     pj_oshandle_t    fd;
 
+    /* When playing from WAV cache, the play position in the cached PCM
+     * samples, or in the cached G.711 data for encoded players.
+     */
+    pjmedia_wav_cache_entry *centry;
+    const pj_int16_t *samples;
+    const pj_uint8_t *enc_samples;
+    const pj_uint8_t *enc_silence;
+    pj_uint32_t	     sample_cnt;
+    pj_uint32_t	     sample_pos;
+
     pj_status_t	   (*cb)(pjmedia_port*, void*);
 };
 
 
 static pj_status_t file_get_frame(pjmedia_port *this_port, 
 				  pjmedia_frame *frame);
+static pj_status_t cache_get_frame(pjmedia_port *this_port,
+				   pjmedia_frame *frame);
+static pj_status_t enc_get_frame(pjmedia_port *this_port,
+				 pjmedia_frame *frame);
 static pj_status_t file_on_destroy(pjmedia_port *this_port);
 
 static struct file_reader_port *create_file_port(pj_pool_t *pool)
@@ -424,6 +438,161 @@ PJ_DEF(pj_status_t) pjmedia_wav_player_port_create( pj_pool_t *pool,
 }
 
 
+/*
+ * Create WAVE player port from WAV cache, producing fmt_id frames.
+ */
+static pj_status_t create_cached_port(pj_pool_t *pool,
+				      pjmedia_wav_cache *cache,
+				      const char *filename,
+				      pjmedia_format_id fmt_id,
+				      unsigned ptime,
+				      unsigned options,
+				      pjmedia_port **p_port)
+{
+    struct file_reader_port *fport;
+    pjmedia_wav_cache_entry *centry;
+    pjmedia_wav_cache_info info;
+    const void *samples;
+    pj_size_t size;
+    pj_str_t name;
+    unsigned samples_per_frame;
+    pj_status_t status;
+
+    status = pjmedia_wav_cache_get(cache, filename, &centry);
+    if (status != PJ_SUCCESS)
+	return status;
+
+    pjmedia_wav_cache_entry_get_info(centry, &info);
+
+    samples_per_frame = ptime * info.clock_rate * info.channel_count / 1000;
+    if (info.size_samples < samples_per_frame) {
+	pjmedia_wav_cache_release(centry);
+	return PJMEDIA_EWAVETOOSHORT;
+    }
+
+    /* The data in the output format is shared in the cache */
+    status = pjmedia_wav_cache_entry_get_data(centry, fmt_id,
+					      &samples, &size);
+    if (status != PJ_SUCCESS) {
+	pjmedia_wav_cache_release(centry);
+	return status;
+    }
+
+    /* Create fport instance. */
+    fport = create_file_port(pool);
+    if (!fport) {
+	pjmedia_wav_cache_release(centry);
+	return PJ_ENOMEM;
+    }
+
+    fport->options = options;
+    fport->centry = centry;
+    fport->sample_cnt = info.size_samples;
+
+    if (info.fmt_id == PJMEDIA_FORMAT_PCM) {
+	fport->fmt_tag = PJMEDIA_WAVE_FMT_TAG_PCM;
+	fport->bytes_per_sample = 2;
+    } else {
+	fport->fmt_tag = (info.fmt_id == PJMEDIA_FORMAT_ULAW) ?
+			 PJMEDIA_WAVE_FMT_TAG_ULAW : PJMEDIA_WAVE_FMT_TAG_ALAW;
+	fport->bytes_per_sample = 1;
+    }
+    fport->data_len = info.size_samples * fport->bytes_per_sample;
+
+    /* Update port info. */
+    pj_strdup2(pool, &name, filename);
+    if (fmt_id == PJMEDIA_FORMAT_PCM) {
+	fport->base.get_frame = &cache_get_frame;
+	fport->samples = (const pj_int16_t*) samples;
+
+	pjmedia_port_info_init(&fport->base.info, &name, SIGNATURE,
+			       info.clock_rate, info.channel_count,
+			       BITS_PER_SAMPLE, samples_per_frame);
+    } else {
+	pjmedia_format fmt;
+	pj_uint8_t *silence;
+
+	fport->base.get_frame = &enc_get_frame;
+	fport->enc_samples = (const pj_uint8_t*) samples;
+
+	/* Silence to fill the last frame when not looping */
+	silence = (pj_uint8_t*) pj_pool_alloc(pool, samples_per_frame);
+	pj_memset(silence, (fmt_id == PJMEDIA_FORMAT_PCMU) ?
+			   pjmedia_linear2ulaw(0) : pjmedia_linear2alaw(0),
+		  samples_per_frame);
+	fport->enc_silence = silence;
+
+	pjmedia_format_init_audio(&fmt, fmt_id, info.clock_rate,
+				  info.channel_count, 8, ptime * 1000,
+				  info.clock_rate * info.channel_count * 8,
+				  info.clock_rate * info.channel_count * 8);
+	pjmedia_port_info_init2(&fport->base.info, &name, SIGNATURE,
+				PJMEDIA_DIR_ENCODING, &fmt);
+    }
+
+    *p_port = &fport->base;
+
+    PJ_LOG(4,(THIS_FILE,
+	      "File player '%.*s' created from cache: samp.rate=%d, ch=%d%s",
+	      (int)fport->base.info.name.slen,
+	      fport->base.info.name.ptr,
+	      info.clock_rate, info.channel_count,
+	      (fmt_id == PJMEDIA_FORMAT_PCM ? "" : ", encoded")));
+
+    return PJ_SUCCESS;
+}
+
+
+/*
+ * Create WAVE player port from WAV cache.
+ */
+PJ_DEF(pj_status_t)
+pjmedia_wav_player_port_create_cached(pj_pool_t *pool,
+				      pjmedia_wav_cache *cache,
+				      const char *filename,
+				      unsigned ptime,
+				      unsigned options,
+				      pjmedia_port **p_port)
+{
+    /* Check arguments. */
+    PJ_ASSERT_RETURN(pool && cache && filename && p_port, PJ_EINVAL);
+
+    /* Normalize ptime */
+    if (ptime == 0)
+	ptime = 20;
+
+    /* Players produce PCM */
+    return create_cached_port(pool, cache, filename, PJMEDIA_FORMAT_PCM,
+			      ptime, options, p_port);
+}
+
+
+/*
+ * Create WAVE player port producing G.711 frames from WAV cache.
+ */
+PJ_DEF(pj_status_t)
+pjmedia_wav_player_port_create_encoded(pj_pool_t *pool,
+				       pjmedia_wav_cache *cache,
+				       const char *filename,
+				       pjmedia_format_id fmt_id,
+				       unsigned ptime,
+				       unsigned options,
+				       pjmedia_port **p_port)
+{
+    /* Check arguments. */
+    PJ_ASSERT_RETURN(pool && cache && filename && p_port, PJ_EINVAL);
+    PJ_ASSERT_RETURN(fmt_id == PJMEDIA_FORMAT_PCMU ||
+		     fmt_id == PJMEDIA_FORMAT_PCMA, PJ_EINVAL);
+
+    /* Normalize ptime */
+    if (ptime == 0)
+	ptime = 20;
+
+    return create_cached_port(pool, cache, filename, fmt_id, ptime,
+			      options, p_port);
+}
+
+
 /*
  * Get additional info about the file player.
  */
@@ -478,6 +647,9 @@ PJ_DEF(pj_ssize_t) pjmedia_wav_player_get_len(pjmedia_port *port)
 
     fport = (struct file_reader_port*) port;
 
+    if (fport->centry)
+	return fport->data_len;
+
     size = (pj_ssize_t) fport->fsize;
     return size - fport->start_data;
 }
@@ -506,6 +678,12 @@ PJ_DEF(pj_status_t) pjmedia_wav_player_port_set_pos(pjmedia_port *port,
      */
     PJ_ASSERT_RETURN(bytes < fport->data_len, PJ_EINVAL);
 
+    if (fport->centry) {
+	fport->sample_pos = bytes / fport->bytes_per_sample;
+	fport->eof = PJ_FALSE;
+	return PJ_SUCCESS;
+    }
+
     fport->fpos = fport->start_data + bytes;
     fport->data_left = fport->data_len - bytes;
     pj_file_setpos( fport->fd, fport->fpos, PJ_SEEK_SET);
@@ -537,6 +715,9 @@ PJ_DEF(pj_ssize_t) pjmedia_wav_player_port_get_pos( pjmedia_port *port )
 
     fport = (struct file_reader_port*) port;
 
+    if (fport->centry)
+	return fport->sample_pos * fport->bytes_per_sample;
+
     payload_pos = (pj_size_t)(fport->fpos - fport->start_data);
     if (payload_pos >= fport->bufsize)
 	return payload_pos - fport->bufsize + (fport->readpos - fport->buf);
@@ -712,6 +893,138 @@ static pj_status_t file_get_frame(pjmedia_port *this_port,
     return PJ_SUCCESS;
 }
 
+/*
+ * Handle the end of the file of cached players, when the previous frame
+ * reached it. Returns PJ_EEOF when no more frame should be returned.
+ */
+static pj_status_t cache_check_eof(struct file_reader_port *fport,
+				   pjmedia_frame *frame)
+{
+    pjmedia_port *this_port = &fport->base;
+    pj_status_t status = PJ_SUCCESS;
+
+    if (fport->eof) {
+	PJ_LOG(5,(THIS_FILE, "File port %.*s EOF",
+		  (int)fport->base.info.name.slen,
+		  fport->base.info.name.ptr));
+
+	if (fport->cb)
+	    status = (*fport->cb)(this_port, fport->base.port_data.pdata);
+
+	/* Don't access the port if the callback returns error, it might
+	 * have been destroyed.
+	 */
+	if ((status != PJ_SUCCESS) || (fport->options & PJMEDIA_FILE_NO_LOOP)) {
+	    frame->type = PJMEDIA_FRAME_TYPE_NONE;
+	    frame->size = 0;
+	    return PJ_EEOF;
+	}
+
+	fport->eof = PJ_FALSE;
+    }
+
+    return PJ_SUCCESS;
+}
+
+/*
+ * Get frame from WAV cache.
+ */
+static pj_status_t cache_get_frame(pjmedia_port *this_port,
+				   pjmedia_frame *frame)
+{
+    struct file_reader_port *fport = (struct file_reader_port*)this_port;
+    pj_int16_t *dst = (pj_int16_t*) frame->buf;
+    pj_uint32_t count, done = 0;
+
+    pj_assert(fport->base.info.signature == SIGNATURE);
+
+    if (cache_check_eof(fport, frame) != PJ_SUCCESS)
+	return PJ_EEOF;
+
+    frame->type = PJMEDIA_FRAME_TYPE_AUDIO;
+    frame->timestamp.u64 = 0;
+    count = (pj_uint32_t)(frame->size / sizeof(pj_int16_t));
+
+    while (done < count) {
+	pj_uint32_t n = fport->sample_cnt - fport->sample_pos;
+
+	if (n > count - done)
+	    n = count - done;
+
+	pj_memcpy(dst + done, fport->samples + fport->sample_pos,
+		  n * sizeof(pj_int16_t));
+	done += n;
+	fport->sample_pos += n;
+
+	if (fport->sample_pos == fport->sample_cnt) {
+	    fport->eof = PJ_TRUE;
+
+	    if (fport->options & PJMEDIA_FILE_NO_LOOP) {
+		pjmedia_zero_samples(dst + done, count - done);
+		break;
+	    }
+
+	    /* Rewind */
+	    fport->sample_pos = 0;
+	}
+    }
+
+    return PJ_SUCCESS;
+}
+
+/*
+ * Get encoded frame from WAV cache. The frame gets one subframe, or two
+ * when it wraps around the end of the file.
+ */
+static pj_status_t enc_get_frame(pjmedia_port *this_port,
+				 pjmedia_frame *frame)
+{
+    struct file_reader_port *fport = (struct file_reader_port*)this_port;
+    pjmedia_frame_ext *f = (pjmedia_frame_ext*) frame;
+    pj_uint32_t count, done = 0;
+
+    pj_assert(fport->base.info.signature == SIGNATURE);
+
+    if (cache_check_eof(fport, frame) != PJ_SUCCESS)
+	return PJ_EEOF;
+
+    pj_bzero(f, sizeof(pjmedia_frame_ext));
+    f->base.type = PJMEDIA_FRAME_TYPE_EXTENDED;
+    f->base.bit_info = fport->base.info.fmt.id;
+    count = PJMEDIA_PIA_SPF(&fport->base.info);
+
+    while (done < count) {
+	pj_uint32_t n = fport->sample_cnt - fport->sample_pos;
+
+	if (n > count - done)
+	    n = count - done;
+
+	pjmedia_frame_ext_append_subframe(f,
+					  fport->enc_samples + fport->sample_pos,
+					  n << 3, n);
+	done += n;
+	fport->sample_pos += n;
+
+	if (fport->sample_pos == fport->sample_cnt) {
+	    fport->eof = PJ_TRUE;
+
+	    if (fport->options & PJMEDIA_FILE_NO_LOOP) {
+		if (done < count) {
+		    pjmedia_frame_ext_append_subframe(f, fport->enc_silence,
+						      (count - done) << 3,
+						      count - done);
+		}
+		break;
+	    }
+
+	    /* Rewind */
+	    fport->sample_pos = 0;
+	}
+    }
+
+    return PJ_SUCCESS;
+}
+
 /*
  * Destroy port.
  */
@@ -721,6 +1034,12 @@ static pj_status_t file_on_destroy(pjmedia_port *this_port)
 
     pj_assert(this_port->info.signature == SIGNATURE);
 
+    if (fport->centry) {
+	pjmedia_wav_cache_release(fport->centry);
+	fport->centry = NULL;
+	return PJ_SUCCESS;
+    }
+
     pj_file_close(fport->fd);
     return PJ_SUCCESS;
 }
@@ -71,12 +71,22 @@ struct playlist_port
     int              current_file;  /* index of current file.	*/
     int              max_file;	    /* how many files.		*/
 
+    /* When playing from WAV cache, the cached PCM samples of each file
+     * and the play position in the current file.
+     */
+    pjmedia_wav_cache_entry **centry_list;
+    const pj_int16_t **samples_list;
+    pj_uint32_t     *sample_cnt_list;
+    pj_uint32_t      sample_pos;
+
     pj_status_t	   (*cb)(pjmedia_port*, void*);
 };
 
 
 static pj_status_t file_list_get_frame(pjmedia_port *this_port,
 				       pjmedia_frame *frame);
+static pj_status_t cache_list_get_frame(pjmedia_port *this_port,
+					pjmedia_frame *frame);
 static pj_status_t file_list_on_destroy(pjmedia_port *this_port);
 
 
@@ -536,6 +546,132 @@ on_error:
 }
 
 
+/*
+ * Create wave list player from WAV cache.
+ */
+PJ_DEF(pj_status_t) pjmedia_wav_playlist_create_cached(
+						pj_pool_t *pool,
+						pjmedia_wav_cache *cache,
+						const pj_str_t *port_label,
+						const pj_str_t file_list[],
+						int file_count,
+						unsigned ptime,
+						unsigned options,
+						pjmedia_port **p_port)
+{
+    struct playlist_port *fport;
+    pjmedia_audio_format_detail *afd;
+    pj_str_t tmp_port_label;
+    char filename[PJ_MAXPATH];
+    int index;
+    pj_status_t status;
+
+    /* Check arguments. */
+    PJ_ASSERT_RETURN(pool && cache && file_list && file_count > 0 && p_port,
+		     PJ_EINVAL);
+
+    /* Normalize port_label */
+    if (port_label == NULL || port_label->slen == 0) {
+	tmp_port_label = pj_str("WAV playlist");
+	port_label = &tmp_port_label;
+    }
+
+    /* Normalize ptime */
+    if (ptime == 0)
+	ptime = 20;
+
+    /* Create fport instance. */
+    fport = create_file_list_port(pool, port_label);
+    if (!fport)
+	return PJ_ENOMEM;
+
+    fport->base.get_frame = &cache_list_get_frame;
+    fport->options = options;
+    fport->max_file = file_count;
+    fport->centry_list = (pjmedia_wav_cache_entry**)
+			 pj_pool_zalloc(pool, sizeof(pjmedia_wav_cache_entry*)
+					      * file_count);
+    fport->samples_list = (const pj_int16_t**)
+			  pj_pool_zalloc(pool, sizeof(pj_int16_t*) *
+					       file_count);
+    fport->sample_cnt_list = (pj_uint32_t*)
+			     pj_pool_zalloc(pool, sizeof(pj_uint32_t) *
+						  file_count);
+
+    afd = pjmedia_format_get_audio_format_detail(&fport->base.info.fmt, 1);
+
+    for (index=0; index<file_count; index++) {
+	pjmedia_wav_cache_info info;
+	const void *samples;
+	pj_size_t size;
+
+	if (file_list[index].slen >= PJ_MAXPATH) {
+	    status = PJ_ENAMETOOLONG;
+	    goto on_error;
+	}
+
+	pj_memcpy(filename, file_list[index].ptr, file_list[index].slen);
+	filename[file_list[index].slen] = '\0';
+
+	status = pjmedia_wav_cache_get(cache, filename,
+				       &fport->centry_list[index]);
+	if (status != PJ_SUCCESS) {
+	    PJ_PERROR(4,(THIS_FILE, status,
+			 "WAV playlist error: unable to load '%s'", filename));
+	    goto on_error;
+	}
+
+	pjmedia_wav_cache_entry_get_info(fport->centry_list[index], &info);
+
+	if (index == 0) {
+	    afd->channel_count = info.channel_count;
+	    afd->clock_rate = info.clock_rate;
+	    afd->bits_per_sample = 16;
+	    afd->frame_time_usec = ptime * 1000;
+	    afd->avg_bps = afd->max_bps = afd->clock_rate *
+					  afd->channel_count *
+					  afd->bits_per_sample;
+	} else if (info.channel_count != afd->channel_count ||
+		   info.clock_rate != afd->clock_rate)
+	{
+	    PJ_LOG(4,(THIS_FILE,
+		      "WAV playlist error: file '%s' has differrent number"
+		      " of channels or sample rate", filename));
+	    status = PJMEDIA_EWAVEUNSUPP;
+	    goto on_error;
+	}
+
+	status = pjmedia_wav_cache_entry_get_data(fport->centry_list[index],
+						  PJMEDIA_FORMAT_PCM,
+						  &samples, &size);
+	if (status != PJ_SUCCESS)
+	    goto on_error;
+
+	fport->samples_list[index] = (const pj_int16_t*) samples;
+	fport->sample_cnt_list[index] = info.size_samples;
+    }
+
+    *p_port = &fport->base;
+
+    PJ_LOG(4,(THIS_FILE,
+	     "WAV playlist '%.*s' created from cache: samp.rate=%d, ch=%d",
+	     (int)port_label->slen,
+	     port_label->ptr,
+	     afd->clock_rate,
+	     afd->channel_count));
+
+    return PJ_SUCCESS;
+
+on_error:
+    for (index=0; index<file_count; ++index) {
+	if (fport->centry_list[index])
+	    pjmedia_wav_cache_release(fport->centry_list[index]);
+    }
+
+    return status;
+}
+
+
 /*
  * Register a callback to be called when the file reading has reached the
  * end of the last file.
@@ -624,6 +760,94 @@ static pj_status_t file_list_get_frame(pjmedia_port *this_port,
 }
 
 
+/*
+ * Get frame from WAV cache for file_list operation
+ */
+static pj_status_t cache_list_get_frame(pjmedia_port *this_port,
+					pjmedia_frame *frame)
+{
+    struct playlist_port *fport = (struct playlist_port*)this_port;
+    pj_int16_t *dst = (pj_int16_t*) frame->buf;
+    pj_uint32_t count, done = 0;
+    pj_status_t status;
+
+    pj_assert(fport->base.info.signature == SIGNATURE);
+
+    /* Can't read file if EOF and loop flag is disabled */
+    if (fport->eof) {
+	frame->type = PJMEDIA_FRAME_TYPE_NONE;
+	frame->size = 0;
+	return PJ_EEOF;
+    }
+
+    frame->type = PJMEDIA_FRAME_TYPE_AUDIO;
+    frame->timestamp.u64 = 0;
+    count = (pj_uint32_t)(frame->size / BYTES_PER_SAMPLE);
+
+    while (done < count) {
+	int current_file = fport->current_file;
+	pj_uint32_t n = fport->sample_cnt_list[current_file] -
+			fport->sample_pos;
+
+	if (n > count - done)
+	    n = count - done;
+
+	pj_memcpy(dst + done,
+		  fport->samples_list[current_file] + fport->sample_pos,
+		  n * BYTES_PER_SAMPLE);
+	done += n;
+	fport->sample_pos += n;
+
+	if (fport->sample_pos < fport->sample_cnt_list[current_file])
+	    continue;
+
+	/* Move to next file */
+	fport->sample_pos = 0;
+	if (++fport->current_file < fport->max_file)
+	    continue;
+
+	/* All files have been played. Call callback, if any. */
+	if (fport->cb) {
+	    PJ_LOG(5,(THIS_FILE,
+		      "File port %.*s EOF, calling callback",
+		      (int)fport->base.info.name.slen,
+		      fport->base.info.name.ptr));
+
+	    /* Set the eof flag before calling the callback, in case the
+	     * port is destroyed by the callback.
+	     */
+	    fport->eof = PJ_TRUE;
+
+	    status = (*fport->cb)(&fport->base, fport->base.port_data.pdata);
+	    if (status != PJ_SUCCESS) {
+		pjmedia_zero_samples(dst + done, count - done);
+		return status;
+	    }
+
+	    fport->eof = PJ_FALSE;
+	}
+
+	if (fport->options & PJMEDIA_FILE_NO_LOOP) {
+	    PJ_LOG(5,(THIS_FILE, "File port %.*s EOF, stopping..",
+		      (int)fport->base.info.name.slen,
+		      fport->base.info.name.ptr));
+	    fport->eof = PJ_TRUE;
+	    pjmedia_zero_samples(dst + done, count - done);
+	    break;
+	}
+
+	PJ_LOG(5,(THIS_FILE, "File port %.*s EOF, rewinding..",
+		  (int)fport->base.info.name.slen,
+		  fport->base.info.name.ptr));
+
+	/* start with first file again. */
+	fport->current_file = 0;
+    }
+
+    return PJ_SUCCESS;
+}
+
+
 /*
  * Destroy port.
  */
@@ -634,6 +858,12 @@ static pj_status_t file_list_on_destroy(pjmedia_port *this_port)
 
     pj_assert(this_port->info.signature == SIGNATURE);
 
+    if (fport->centry_list) {
+	for (index=0; index<fport->max_file; index++)
+	    pjmedia_wav_cache_release(fport->centry_list[index]);
+	return PJ_SUCCESS;
+    }
+
     for (index=0; index<fport->max_file; index++)
 	pj_file_close(fport->fd_list[index]);
 
@@ -24,7 +24,9 @@
 #include <pj/assert.h>
 #include <pj/file_access.h>
 #include <pj/file_io.h>
+#include <pj/list.h>
 #include <pj/log.h>
+#include <pj/os.h>
 #include <pj/pool.h>
 #include <pj/string.h>
 
@@ -32,6 +34,80 @@
 #define THIS_FILE	    "wav_writer.c"
 #define SIGNATURE	    PJMEDIA_SIG_PORT_WAV_WRITER
 
+/* Largest WAV header written: the header of G.711 files has FACT chunk. */
+#define MAX_HDR_SIZE	    (sizeof(pjmedia_wave_hdr) + 12)
+
+
+/*
+ * The buffer ring of asynchronous writers is shared by the thread which
+ * puts the frames and the I/O thread, with the same index primitives as
+ * ring_port.c: each index is written by one side only, with release
+ * semantics, and read by the other side with acquire semantics.
+ */
+#if (defined(__GNUC__) && (__GNUC__ > 4 || \
+			   (__GNUC__ == 4 && __GNUC_MINOR__ >= 7))) || \
+    defined(__clang__)
+
+typedef pj_uint32_t ring_idx_t;
+#   define IDX_INIT(pool, p)	(*(p) = 0, PJ_SUCCESS)
+#   define IDX_DESTROY(p)
+#   define IDX_LOAD(p)		__atomic_load_n(p, __ATOMIC_ACQUIRE)
+#   define IDX_STORE(p, v)	__atomic_store_n(p, v, __ATOMIC_RELEASE)
+
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+
+#   include <intrin.h>
+#   pragma intrinsic(_ReadWriteBarrier)
+
+typedef volatile pj_uint32_t ring_idx_t;
+#   define IDX_INIT(pool, p)	(*(p) = 0, PJ_SUCCESS)
+#   define IDX_DESTROY(p)
+#   define IDX_LOAD(p)		idx_load(p)
+#   define IDX_STORE(p, v)	idx_store(p, v)
+
+static pj_uint32_t idx_load(ring_idx_t *p)
+{
+    pj_uint32_t v = *p;
+    _ReadWriteBarrier();
+    return v;
+}
+
+static void idx_store(ring_idx_t *p, pj_uint32_t v)
+{
+    _ReadWriteBarrier();
+    *p = v;
+}
+
+#else
+
+typedef pj_atomic_t *ring_idx_t;
+#   define IDX_INIT(pool, p)	pj_atomic_create(pool, 0, p)
+#   define IDX_DESTROY(p)	pj_atomic_destroy(*(p))
+#   define IDX_LOAD(p)		((pj_uint32_t)pj_atomic_get(*(p)))
+#   define IDX_STORE(p, v)	pj_atomic_set(*(p), (pj_atomic_value_t)(v))
+
+#endif
+
+
+struct file_port;
+
+/* Entry of the writer list of the I/O thread */
+struct writer_node
+{
+    PJ_DECL_LIST_MEMBER(struct writer_node);
+    struct file_port	*fport;
+};
+
+struct pjmedia_wav_writer_io
+{
+    pj_pool_t		*pool;
+    pj_mutex_t		*mutex;	    /**< Protects writer list and stat. */
+    pj_sem_t		*sem;	    /**< Signaled when there's work.    */
+    pj_thread_t		*thread;
+    pj_bool_t		 quit;
+    struct writer_node	 writers;
+    pjmedia_wav_writer_io_stat stat;
+};
 
 struct file_port
 {
@@ -48,45 +124,64 @@ struct file_port
 
     pj_size_t	     cb_size;
     pj_status_t	   (*cb)(pjmedia_port*, void*);
+
+    /* Asynchronous writer. The ring has slot_cnt buffers of bufsize bytes
+     * each. The producer fills the buffer at wr_pos, and hands it over to
+     * the I/O thread by advancing write_idx. The I/O thread writes the
+     * buffers and returns them by advancing read_idx.
+     */
+    pjmedia_wav_writer_io *io;
+    struct writer_node node;
+    unsigned	     slot_cnt;
+    char	    *slots;
+    pj_size_t	    *slot_len;
+    pj_sem_t	    *drained;	    /**< Signaled when closing is done. */
+    pj_bool_t	     closing;
+    pj_status_t	     io_status;	    /**< Last write error.		*/
+
+    /* Producer side */
+    ring_idx_t	     write_idx;
+    pj_uint32_t	     wr_pos;
+    pj_size_t	     fill;	    /**< Bytes in buffer wr_pos.	*/
+    pj_bool_t	     has_slot;	    /**< Buffer wr_pos is owned.	*/
+    unsigned	     drop_cnt;
+    char	     pad_[64];
+
+    /* I/O thread side */
+    ring_idx_t	     read_idx;
+    pj_uint32_t	     rd_pos;
 };
 
 static pj_status_t file_put_frame(pjmedia_port *this_port, 
 				  pjmedia_frame *frame);
+static pj_status_t async_put_frame(pjmedia_port *this_port,
+				   pjmedia_frame *frame);
 static pj_status_t file_get_frame(pjmedia_port *this_port, 
 				  pjmedia_frame *frame);
 static pj_status_t file_on_destroy(pjmedia_port *this_port);
 
 
 /*
- * Create file writer port.
+ * Initialize the port and build the WAV header in hdr_buf.
  */
-PJ_DEF(pj_status_t) pjmedia_wav_writer_port_create( pj_pool_t *pool,
-						     const char *filename,
-						     unsigned sampling_rate,
-						     unsigned channel_count,
-						     unsigned samples_per_frame,
-						     unsigned bits_per_sample,
-						     unsigned flags,
-						     pj_ssize_t buff_size,
-						     pjmedia_port **p_port )
+static struct file_port *create_port(pj_pool_t *pool,
+				     const char *filename,
+				     unsigned sampling_rate,
+				     unsigned channel_count,
+				     unsigned samples_per_frame,
+				     unsigned bits_per_sample,
+				     unsigned flags,
+				     char hdr_buf[MAX_HDR_SIZE],
+				     pj_size_t *hdr_size)
 {
     struct file_port *fport;
     pjmedia_wave_hdr wave_hdr;
-    pj_ssize_t size;
     pj_str_t name;
-    pj_status_t status;
-
-    /* Check arguments. */
-    PJ_ASSERT_RETURN(pool && filename && p_port, PJ_EINVAL);
-
-    /* Only supports 16bits per sample for now.
-     * See flush_buffer().
-     */
-    PJ_ASSERT_RETURN(bits_per_sample == 16, PJ_EINVAL);
 
     /* Create file port instance. */
     fport = PJ_POOL_ZALLOC_T(pool, struct file_port);
-    PJ_ASSERT_RETURN(fport != NULL, PJ_ENOMEM);
+    if (fport == NULL)
+	return NULL;
 
     /* Initialize port info. */
     pj_strdup2(pool, &name, filename);
@@ -109,14 +204,6 @@ PJ_DEF(pj_status_t) pjmedia_wav_writer_port_create( pj_pool_t *pool,
 	fport->bytes_per_sample = 2;
     }
 
-    /* Open file in write and read mode.
-     * We need the read mode because we'll modify the WAVE header once
-     * the recording has completed.
-     */
-    status = pj_file_open(pool, filename, PJ_O_WRONLY, &fport->fd);
-    if (status != PJ_SUCCESS)
-	return status;
-
     /* Initialize WAVE header */
     pj_bzero(&wave_hdr, sizeof(pjmedia_wave_hdr));
     wave_hdr.riff_hdr.riff = PJMEDIA_RIFF_TAG;
@@ -145,52 +232,87 @@ PJ_DEF(pj_status_t) pjmedia_wav_writer_port_create( pj_pool_t *pool,
     pjmedia_wave_hdr_host_to_file(&wave_hdr);
 
 
-    /* Write WAVE header */
+    /* Build WAVE header */
     if (fport->fmt_tag != PJMEDIA_WAVE_FMT_TAG_PCM) {
 	pjmedia_wave_subchunk fact_chunk;
 	pj_uint32_t tmp = 0;
+	pj_size_t size;
 
 	fact_chunk.id = PJMEDIA_FACT_TAG;
 	fact_chunk.len = 4;
 
 	PJMEDIA_WAVE_NORMALIZE_SUBCHUNK(&fact_chunk);
 
-	/* Write WAVE header without DATA chunk header */
+	/* WAVE header without DATA chunk header */
 	size = sizeof(pjmedia_wave_hdr) - sizeof(wave_hdr.data_hdr);
-	status = pj_file_write(fport->fd, &wave_hdr, &size);
-	if (status != PJ_SUCCESS) {
-	    pj_file_close(fport->fd);
-	    return status;
-	}
+	pj_memcpy(hdr_buf, &wave_hdr, size);
+	*hdr_size = size;
+
+	/* FACT chunk if it stores compressed data */
+	pj_memcpy(hdr_buf + *hdr_size, &fact_chunk, sizeof(fact_chunk));
+	*hdr_size += sizeof(fact_chunk);
+	pj_memcpy(hdr_buf + *hdr_size, &tmp, 4);
+	*hdr_size += 4;
+
+	/* DATA chunk header */
+	pj_memcpy(hdr_buf + *hdr_size, &wave_hdr.data_hdr,
+		  sizeof(wave_hdr.data_hdr));
+	*hdr_size += sizeof(wave_hdr.data_hdr);
+    } else {
+	pj_memcpy(hdr_buf, &wave_hdr, sizeof(pjmedia_wave_hdr));
+	*hdr_size = sizeof(pjmedia_wave_hdr);
+    }
 
-	/* Write FACT chunk if it stores compressed data */
-	size = sizeof(fact_chunk);
-	status = pj_file_write(fport->fd, &fact_chunk, &size);
-	if (status != PJ_SUCCESS) {
-	    pj_file_close(fport->fd);
-	    return status;
-	}
-	size = 4;
-	status = pj_file_write(fport->fd, &tmp, &size);
-	if (status != PJ_SUCCESS) {
-	    pj_file_close(fport->fd);
-	    return status;
-	}
+    return fport;
+}
 
-	/* Write DATA chunk header */
-	size = sizeof(wave_hdr.data_hdr);
-	status = pj_file_write(fport->fd, &wave_hdr.data_hdr, &size);
-	if (status != PJ_SUCCESS) {
-	    pj_file_close(fport->fd);
-	    return status;
-	}
-    } else {
-	size = sizeof(pjmedia_wave_hdr);
-	status = pj_file_write(fport->fd, &wave_hdr, &size);
-	if (status != PJ_SUCCESS) {
-	    pj_file_close(fport->fd);
-	    return status;
-	}
+
+/*
+ * Create file writer port.
+ */
+PJ_DEF(pj_status_t) pjmedia_wav_writer_port_create( pj_pool_t *pool,
+						     const char *filename,
+						     unsigned sampling_rate,
+						     unsigned channel_count,
+						     unsigned samples_per_frame,
+						     unsigned bits_per_sample,
+						     unsigned flags,
+						     pj_ssize_t buff_size,
+						     pjmedia_port **p_port )
+{
+    struct file_port *fport;
+    char hdr_buf[MAX_HDR_SIZE];
+    pj_size_t hdr_size;
+    pj_ssize_t size;
+    pj_status_t status;
+
+    /* Check arguments. */
+    PJ_ASSERT_RETURN(pool && filename && p_port, PJ_EINVAL);
+
+    /* Only supports 16bits per sample for now.
+     * See flush_buffer().
+     */
+    PJ_ASSERT_RETURN(bits_per_sample == 16, PJ_EINVAL);
+
+    fport = create_port(pool, filename, sampling_rate, channel_count,
+			samples_per_frame, bits_per_sample, flags,
+			hdr_buf, &hdr_size);
+    PJ_ASSERT_RETURN(fport != NULL, PJ_ENOMEM);
+
+    /* Open file in write and read mode.
+     * We need the read mode because we'll modify the WAVE header once
+     * the recording has completed.
+     */
+    status = pj_file_open(pool, filename, PJ_O_WRONLY, &fport->fd);
+    if (status != PJ_SUCCESS)
+	return status;
+
+    /* Write WAVE header */
+    size = hdr_size;
+    status = pj_file_write(fport->fd, hdr_buf, &size);
+    if (status != PJ_SUCCESS) {
+	pj_file_close(fport->fd);
+	return status;
     }
 
     /* Set buffer size. */
@@ -224,6 +346,295 @@ PJ_DEF(pj_status_t) pjmedia_wav_writer_port_create( pj_pool_t *pool,
 }
 
 
+/*
+ * Write the buffers which the writer has handed over, in as few writes as
+ * possible. Called by the I/O thread with the writer list locked.
+ */
+static void write_buffers(pjmedia_wav_writer_io *io,
+			  struct file_port *fport)
+{
+    pj_uint32_t end = IDX_LOAD(&fport->write_idx);
+    unsigned mask = fport->slot_cnt - 1;
+
+    while (fport->rd_pos != end) {
+	unsigned first = fport->rd_pos & mask;
+	unsigned n = 0;
+	pj_ssize_t size = 0;
+	pj_status_t status;
+
+	/* Batch the buffers which follow each other in memory. Only the
+	 * last buffer of the recording may be partly filled.
+	 */
+	do {
+	    size += fport->slot_len[first + n];
+	    ++n;
+	} while (fport->rd_pos + n != end && first + n <= mask &&
+		 fport->slot_len[first + n - 1] == fport->bufsize);
+
+	status = pj_file_write(fport->fd, fport->slots + first*fport->bufsize,
+			       &size);
+	if (status != PJ_SUCCESS) {
+	    if (fport->io_status == PJ_SUCCESS) {
+		PJ_PERROR(3,(THIS_FILE, status, "Error writing %.*s",
+			     (int)fport->base.info.name.slen,
+			     fport->base.info.name.ptr));
+	    }
+	    fport->io_status = status;
+	} else {
+	    io->stat.bytes_written += size;
+	}
+	++io->stat.write_cnt;
+
+	/* Return the buffers to the writer */
+	fport->rd_pos += n;
+	IDX_STORE(&fport->read_idx, fport->rd_pos);
+    }
+}
+
+
+/*
+ * WAV writer I/O thread.
+ */
+static int PJ_THREAD_FUNC io_thread(void *arg)
+{
+    pjmedia_wav_writer_io *io = (pjmedia_wav_writer_io*) arg;
+
+    for (;;) {
+	struct writer_node *node;
+
+	pj_sem_wait(io->sem);
+	if (io->quit)
+	    break;
+
+	pj_mutex_lock(io->mutex);
+
+	node = io->writers.next;
+	while (node != &io->writers) {
+	    struct writer_node *next = node->next;
+	    struct file_port *fport = node->fport;
+
+	    write_buffers(io, fport);
+
+	    /* Release the writer which is being closed once it's drained */
+	    if (fport->closing &&
+		fport->rd_pos == IDX_LOAD(&fport->write_idx))
+	    {
+		pj_list_erase(node);
+		--io->stat.writer_cnt;
+		io->stat.drop_cnt += fport->drop_cnt;
+		pj_sem_post(fport->drained);
+	    }
+
+	    node = next;
+	}
+
+	pj_mutex_unlock(io->mutex);
+    }
+
+    return 0;
+}
+
+
+/*
+ * Create WAV writer I/O thread.
+ */
+PJ_DEF(pj_status_t) pjmedia_wav_writer_io_create(pj_pool_factory *pf,
+						 pjmedia_wav_writer_io **p_io)
+{
+    pj_pool_t *pool;
+    pjmedia_wav_writer_io *io;
+    pj_status_t status;
+
+    PJ_ASSERT_RETURN(pf && p_io, PJ_EINVAL);
+
+    pool = pj_pool_create(pf, "wavwio", 512, 512, NULL);
+    if (!pool)
+	return PJ_ENOMEM;
+
+    io = PJ_POOL_ZALLOC_T(pool, pjmedia_wav_writer_io);
+    io->pool = pool;
+    pj_list_init(&io->writers);
+
+    status = pj_mutex_create_simple(pool, "wavwio", &io->mutex);
+    if (status != PJ_SUCCESS)
+	goto on_error;
+
+    status = pj_sem_create(pool, "wavwio", 0, PJ_MAXINT32, &io->sem);
+    if (status != PJ_SUCCESS)
+	goto on_error;
+
+    status = pj_thread_create(pool, "wavwio", &io_thread, io, 0, 0,
+			      &io->thread);
+    if (status != PJ_SUCCESS)
+	goto on_error;
+
+    *p_io = io;
+    return PJ_SUCCESS;
+
+on_error:
+    pjmedia_wav_writer_io_destroy(io);
+    return status;
+}
+
+
+/*
+ * Get WAV writer I/O thread statistics.
+ */
+PJ_DEF(pj_status_t)
+pjmedia_wav_writer_io_get_stat(pjmedia_wav_writer_io *io,
+			       pjmedia_wav_writer_io_stat *stat)
+{
+    struct writer_node *node;
+
+    PJ_ASSERT_RETURN(io && stat, PJ_EINVAL);
+
+    pj_mutex_lock(io->mutex);
+    pj_memcpy(stat, &io->stat, sizeof(*stat));
+    for (node = io->writers.next; node != &io->writers; node = node->next)
+	stat->drop_cnt += node->fport->drop_cnt;
+    pj_mutex_unlock(io->mutex);
+
+    return PJ_SUCCESS;
+}
+
+
+/*
+ * Destroy WAV writer I/O thread.
+ */
+PJ_DEF(pj_status_t) pjmedia_wav_writer_io_destroy(pjmedia_wav_writer_io *io)
+{
+    PJ_ASSERT_RETURN(io, PJ_EINVAL);
+    PJ_ASSERT_RETURN(pj_list_empty(&io->writers), PJ_EBUSY);
+
+    if (io->thread) {
+	io->quit = PJ_TRUE;
+	pj_sem_post(io->sem);
+	pj_thread_join(io->thread);
+	pj_thread_destroy(io->thread);
+	io->thread = NULL;
+    }
+    if (io->sem) {
+	pj_sem_destroy(io->sem);
+	io->sem = NULL;
+    }
+    if (io->mutex) {
+	pj_mutex_destroy(io->mutex);
+	io->mutex = NULL;
+    }
+    pj_pool_release(io->pool);
+
+    return PJ_SUCCESS;
+}
+
+
+/*
+ * Create asynchronous file writer port.
+ */
+PJ_DEF(pj_status_t)
+pjmedia_wav_writer_port_create_async(pj_pool_t *pool,
+				     pjmedia_wav_writer_io *io,
+				     const char *filename,
+				     unsigned sampling_rate,
+				     unsigned channel_count,
+				     unsigned samples_per_frame,
+				     unsigned bits_per_sample,
+				     unsigned flags,
+				     pj_ssize_t buff_size,
+				     pjmedia_port **p_port)
+{
+    enum { ALIGN = PJMEDIA_WAV_WRITER_IO_ALIGN };
+    struct file_port *fport;
+    char hdr_buf[MAX_HDR_SIZE];
+    pj_size_t hdr_size;
+    char *mem;
+    pj_status_t status;
+
+    /* Check arguments. */
+    PJ_ASSERT_RETURN(pool && io && filename && p_port, PJ_EINVAL);
+    PJ_ASSERT_RETURN(bits_per_sample == 16, PJ_EINVAL);
+
+    /* Ring indexes wrap around at 2^32, the buffer count must be a power
+     * of two.
+     */
+    PJ_ASSERT_RETURN(PJMEDIA_WAV_WRITER_IO_BUF_CNT >= 2 &&
+		     (PJMEDIA_WAV_WRITER_IO_BUF_CNT &
+		      (PJMEDIA_WAV_WRITER_IO_BUF_CNT-1)) == 0, PJ_EINVAL);
+    PJ_ASSERT_RETURN(ALIGN >= MAX_HDR_SIZE && (ALIGN & 1) == 0, PJ_EINVAL);
+
+    fport = create_port(pool, filename, sampling_rate, channel_count,
+			samples_per_frame, bits_per_sample, flags,
+			hdr_buf, &hdr_size);
+    PJ_ASSERT_RETURN(fport != NULL, PJ_ENOMEM);
+
+    fport->base.put_frame = &async_put_frame;
+    fport->io = io;
+    fport->node.fport = fport;
+
+    /* Set buffer size, rounded up to the alignment */
+    if (buff_size < 1) buff_size = PJMEDIA_FILE_PORT_BUFSIZE;
+    fport->bufsize = (buff_size + ALIGN - 1) / ALIGN * ALIGN;
+
+    /* Allocate the aligned buffers */
+    fport->slot_cnt = PJMEDIA_WAV_WRITER_IO_BUF_CNT;
+    mem = (char*) pj_pool_alloc(pool, fport->slot_cnt * fport->bufsize +
+				      ALIGN);
+    fport->slot_len = (pj_size_t*) pj_pool_calloc(pool, fport->slot_cnt,
+						  sizeof(pj_size_t));
+    if (mem == NULL || fport->slot_len == NULL)
+	return PJ_ENOMEM;
+    fport->slots = mem + (ALIGN - (pj_size_t)mem % ALIGN) % ALIGN;
+
+    status = IDX_INIT(pool, &fport->write_idx);
+    if (status != PJ_SUCCESS)
+	return status;
+    status = IDX_INIT(pool, &fport->read_idx);
+    if (status != PJ_SUCCESS) {
+	IDX_DESTROY(&fport->write_idx);
+	return status;
+    }
+
+    status = pj_sem_create(pool, "wavw", 0, 1, &fport->drained);
+    if (status != PJ_SUCCESS)
+	goto on_error;
+
+    status = pj_file_open(pool, filename, PJ_O_WRONLY, &fport->fd);
+    if (status != PJ_SUCCESS)
+	goto on_error;
+
+    /* The WAV header starts the first buffer, so that the file is
+     * written in aligned blocks.
+     */
+    pj_memcpy(fport->slots, hdr_buf, hdr_size);
+    fport->fill = hdr_size;
+    fport->has_slot = PJ_TRUE;
+
+    pj_mutex_lock(io->mutex);
+    pj_list_push_back(&io->writers, &fport->node);
+    ++io->stat.writer_cnt;
+    pj_mutex_unlock(io->mutex);
+
+    /* Done. */
+    *p_port = &fport->base;
+
+    PJ_LOG(4,(THIS_FILE,
+	      "Async file writer '%.*s' created: samp.rate=%d, "
+	      "bufsize=%ux%uKB",
+	      (int)fport->base.info.name.slen,
+	      fport->base.info.name.ptr,
+	      PJMEDIA_PIA_SRATE(&fport->base.info),
+	      fport->slot_cnt, fport->bufsize / 1024));
+
+    return PJ_SUCCESS;
+
+on_error:
+    if (fport->drained)
+	pj_sem_destroy(fport->drained);
+    IDX_DESTROY(&fport->write_idx);
+    IDX_DESTROY(&fport->read_idx);
+    return status;
+}
+
+
 
 /*
  * Get current writing position. 
@@ -334,20 +745,13 @@ static pj_status_t file_put_frame(pjmedia_port *this_port,
     if (fport->fmt_tag == PJMEDIA_WAVE_FMT_TAG_PCM) {
 	pj_memcpy(fport->writepos, frame->buf, frame->size);
     } else {
-	unsigned i;
-	pj_int16_t *src = (pj_int16_t*)frame->buf;
+	const pj_int16_t *src = (const pj_int16_t*)frame->buf;
 	pj_uint8_t *dst = (pj_uint8_t*)fport->writepos;
 
-	if (fport->fmt_tag == PJMEDIA_WAVE_FMT_TAG_ULAW) {
-	    for (i = 0; i < frame_size; ++i) {
-		*dst++ = pjmedia_linear2ulaw(*src++);
-	    }
-	} else {
-	    for (i = 0; i < frame_size; ++i) {
-		*dst++ = pjmedia_linear2alaw(*src++);
-	    }
-	}
-
+	if (fport->fmt_tag == PJMEDIA_WAVE_FMT_TAG_ULAW)
+	    pjmedia_ulaw_encode_block(dst, src, frame_size);
+	else
+	    pjmedia_alaw_encode_block(dst, src, frame_size);
     }
     fport->writepos += frame_size;
 
@@ -367,6 +771,113 @@ static pj_status_t file_put_frame(pjmedia_port *this_port,
     return PJ_SUCCESS;
 }
 
+/*
+ * Hand over the current buffer of asynchronous writer to the I/O thread.
+ */
+static void submit_buffer(struct file_port *fport)
+{
+    fport->slot_len[fport->wr_pos & (fport->slot_cnt - 1)] = fport->fill;
+    ++fport->wr_pos;
+    IDX_STORE(&fport->write_idx, fport->wr_pos);
+    fport->has_slot = PJ_FALSE;
+
+    pj_sem_post(fport->io->sem);
+}
+
+/*
+ * Put a frame into the buffers of asynchronous writer. The frame may span
+ * two buffers, so that every buffer is completely filled before it is
+ * handed over to the I/O thread. This never waits for the disk: when all
+ * buffers are being written, the rest of the frame is dropped.
+ */
+static pj_status_t async_put_frame(pjmedia_port *this_port,
+				   pjmedia_frame *frame)
+{
+    struct file_port *fport = (struct file_port *)this_port;
+    const pj_int16_t *src = (const pj_int16_t*)frame->buf;
+    pj_size_t count = frame->size >> 1;
+
+    while (count) {
+	char *dst;
+	pj_size_t n;
+
+	/* Take the next buffer, if it has been written */
+	if (!fport->has_slot) {
+	    if (fport->wr_pos - IDX_LOAD(&fport->read_idx) ==
+		fport->slot_cnt)
+	    {
+		++fport->drop_cnt;
+		break;
+	    }
+	    fport->has_slot = PJ_TRUE;
+	    fport->fill = 0;
+	}
+
+	n = (fport->bufsize - fport->fill) / fport->bytes_per_sample;
+	if (n > count)
+	    n = count;
+
+	dst = fport->slots +
+	      (fport->wr_pos & (fport->slot_cnt - 1)) * fport->bufsize +
+	      fport->fill;
+	if (fport->fmt_tag == PJMEDIA_WAVE_FMT_TAG_PCM) {
+	    pj_memcpy(dst, src, n << 1);
+	    swap_samples((pj_int16_t*)dst, (unsigned)n);
+	} else if (fport->fmt_tag == PJMEDIA_WAVE_FMT_TAG_ULAW) {
+	    pjmedia_ulaw_encode_block((pj_uint8_t*)dst, src, n);
+	} else {
+	    pjmedia_alaw_encode_block((pj_uint8_t*)dst, src, n);
+	}
+
+	fport->fill += n * fport->bytes_per_sample;
+	fport->total += n * fport->bytes_per_sample;
+	src += n;
+	count -= n;
+
+	if (fport->fill == fport->bufsize)
+	    submit_buffer(fport);
+    }
+
+    /* Check if we need to call callback */
+    if (fport->cb && fport->total >= fport->cb_size) {
+	pj_status_t (*cb)(pjmedia_port*, void*);
+
+	cb = fport->cb;
+	fport->cb = NULL;
+
+	return (*cb)(this_port, this_port->port_data.pdata);
+    }
+
+    return PJ_SUCCESS;
+}
+
+/*
+ * Wait until the I/O thread has written all buffers of asynchronous
+ * writer, and detach the writer from the I/O thread.
+ */
+static pj_status_t async_close(struct file_port *fport)
+{
+    pjmedia_wav_writer_io *io = fport->io;
+
+    /* Hand over the last, partly filled, buffer */
+    if (fport->has_slot && fport->fill)
+	submit_buffer(fport);
+
+    pj_mutex_lock(io->mutex);
+    fport->closing = PJ_TRUE;
+    pj_mutex_unlock(io->mutex);
+
+    pj_sem_post(io->sem);
+    pj_sem_wait(fport->drained);
+
+    pj_sem_destroy(fport->drained);
+    IDX_DESTROY(&fport->write_idx);
+    IDX_DESTROY(&fport->read_idx);
+    fport->io = NULL;
+
+    return fport->io_status;
+}
+
 /*
  * Get frame, basicy is a no-op operation.
  */
@@ -393,7 +904,9 @@ static pj_status_t file_on_destroy(pjmedia_port *this_port)
     pj_uint32_t data_len_pos = DATA_LEN_POS;
 
     /* Flush remaining buffers. */
-    if (fport->writepos != fport->buf) 
+    if (fport->io)
+	async_close(fport);
+    else if (fport->writepos != fport->buf) 
 	flush_buffer(fport);
 
     /* Get file size. */
@@ -155,6 +155,12 @@ struct pjmedia_wsola
 
 };
 
+/* Round down a sample count to whole samples of all channels, so that
+ * positions in interleaved buffers stay aligned to channel #0.
+ */
+#define ALIGN_CH(wsola, cnt) \
+	    ((unsigned)(cnt) / (wsola)->channel_count * (wsola)->channel_count)
+
 #if (PJMEDIA_WSOLA_IMP==PJMEDIA_WSOLA_IMP_WSOLA_LITE)
 
 /* In this implementation, waveform similarity comparison is done by calculating
@@ -166,7 +172,7 @@ struct pjmedia_wsola
  * diff level = (template[1]+..+template[n]) - (target[1]+..+target[n])
  */
 static pj_int16_t *find_pitch(pj_int16_t *frm, pj_int16_t *beg, pj_int16_t *end, 
-			 unsigned template_cnt, int first)
+			 unsigned template_cnt, unsigned step, int first)
 {
     pj_int16_t *sr, *best=beg;
     int best_corr = 0x7FFFFFFF;
@@ -176,7 +182,7 @@ static pj_int16_t *find_pitch(pj_int16_t *frm, pj_int16_t *beg, pj_int16_t *end,
     for (i = 0; i<template_cnt; ++i)
 	frm_sum += frm[i];
 
-    for (sr=beg; sr!=end; ++sr) {
+    for (sr=beg; sr<end; sr+=step) {
 	int corr = frm_sum;
 	int abs_corr = 0;
 
@@ -225,12 +231,12 @@ static pj_int16_t *find_pitch(pj_int16_t *frm, pj_int16_t *beg, pj_int16_t *end,
 #if (PJMEDIA_WSOLA_IMP==PJMEDIA_WSOLA_IMP_WSOLA)
 
 static pj_int16_t *find_pitch(pj_int16_t *frm, pj_int16_t *beg, pj_int16_t *end, 
-			 unsigned template_cnt, int first)
+			 unsigned template_cnt, unsigned step, int first)
 {
     pj_int16_t *sr, *best=beg;
     double best_corr = 0;
 
-    for (sr=beg; sr!=end; ++sr) {
+    for (sr=beg; sr<end; sr+=step) {
 	double corr = 0;
 	unsigned i;
 
@@ -293,15 +299,18 @@ static void overlapp_add_simple(pj_int16_t dst[], unsigned count,
     }
 }
 
-static void create_win(pj_pool_t *pool, float **pw, unsigned count)
+static void create_win(pj_pool_t *pool, float **pw, unsigned count,
+		       unsigned channel_count)
 {
-    unsigned i;
+    unsigned i, n = count / channel_count;
     float *w = (float*)pj_pool_calloc(pool, count, sizeof(float));
 
     *pw = w;
 
+    /* All channels of a sampling instant have the same weight */
     for (i=0;i<count; i++) {
-	w[i] = (float)(0.5 - 0.5 * cos(2.0 * PJ_PI * i / (count*2-1)) );
+	unsigned j = i / channel_count;
+	w[i] = (float)(0.5 - 0.5 * cos(2.0 * PJ_PI * j / (n*2-1)) );
     }
 }
 
@@ -315,13 +324,13 @@ enum { WINDOW_MAX_VAL = (1 << WINDOW_BITS)-1 };
 #if (PJMEDIA_WSOLA_IMP==PJMEDIA_WSOLA_IMP_WSOLA)
 
 static pj_int16_t *find_pitch(pj_int16_t *frm, pj_int16_t *beg, pj_int16_t *end, 
-			 unsigned template_cnt, int first)
+			 unsigned template_cnt, unsigned step, int first)
 {
     pj_int16_t *sr, *best=beg;
     pj_int64_t best_corr = 0;
 
     
-    for (sr=beg; sr!=end; ++sr) {
+    for (sr=beg; sr<end; sr+=step) {
 	pj_int64_t corr = 0;
 	unsigned i;
 
@@ -409,30 +418,33 @@ static pj_uint32_t approx_cos( pj_uint32_t x )
 }
 #endif	/* PJ_HAS_INT64 && .. */
 
-static void create_win(pj_pool_t *pool, pj_uint16_t **pw, unsigned count)
+static void create_win(pj_pool_t *pool, pj_uint16_t **pw, unsigned count,
+		       unsigned channel_count)
 {
     
-    unsigned i;
+    unsigned i, n = count / channel_count;
     pj_uint16_t *w = (pj_uint16_t*)pj_pool_calloc(pool, count, 
 						  sizeof(pj_uint16_t));
 
     *pw = w;
 
+    /* All channels of a sampling instant have the same weight */
     for (i=0; i<count; i++) {
+	unsigned j = i / channel_count;
 #if PJ_HAS_INT64 && !PJMEDIA_WSOLA_LINEAR_WIN
 	pj_uint32_t phase;
 	pj_uint64_t cos_val;
 
-	/* w[i] = (float)(0.5 - 0.5 * cos(2.0 * PJ_PI * i / (count*2-1)) ); */
+	/* w[i] = (float)(0.5 - 0.5 * cos(2.0 * PJ_PI * j / (n*2-1)) ); */
 
-	phase = (pj_uint32_t)(PJ_INT64(0xFFFFFFFF) * i / (count*2-1));
+	phase = (pj_uint32_t)(PJ_INT64(0xFFFFFFFF) * j / (n*2-1));
 	cos_val = approx_cos(phase);
 
 	w[i] = (pj_uint16_t)(WINDOW_MAX_VAL - 
 			      (WINDOW_MAX_VAL * cos_val) / 0xFFFFFFFF);
 #else
 	/* Revert to linear */
-	w[i] = (pj_uint16_t)(i * WINDOW_MAX_VAL / count);
+	w[i] = (pj_uint16_t)(j * WINDOW_MAX_VAL / n);
 #endif
     }
 }
@@ -520,7 +532,8 @@ PJ_DEF(pj_status_t) pjmedia_wsola_create( pj_pool_t *pool,
     wsola->samples_per_frame = (pj_uint16_t) samples_per_frame;
     wsola->channel_count = (pj_uint16_t) channel_count;
     wsola->options = (pj_uint16_t) options;
-    wsola->max_expand_cnt = clock_rate * MAX_EXPAND_MSEC / 1000;
+    wsola->max_expand_cnt = clock_rate * channel_count * MAX_EXPAND_MSEC /
+			    1000;
     wsola->fade_out_pos = wsola->max_expand_cnt;
 
     /* Create circular buffer */
@@ -532,17 +545,20 @@ PJ_DEF(pj_status_t) pjmedia_wsola_create( pj_pool_t *pool,
     }
 
     /* Calculate history size */
-    wsola->hist_size = (pj_uint16_t)(HIST_CNT * samples_per_frame);
+    wsola->hist_size = (pj_uint16_t)ALIGN_CH(wsola,
+					     HIST_CNT * samples_per_frame);
 
     /* Calculate template size */
-    wsola->templ_size = (pj_uint16_t)(TEMPLATE_PTIME * clock_rate * 
-				      channel_count / 1000);
+    wsola->templ_size = (pj_uint16_t)ALIGN_CH(wsola, TEMPLATE_PTIME *
+					      clock_rate * channel_count /
+					      1000);
     if (wsola->templ_size > samples_per_frame)
 	wsola->templ_size = wsola->samples_per_frame;
 
     /* Calculate hanning window size */
-    wsola->hanning_size = (pj_uint16_t)(HANNING_PTIME * clock_rate * 
-				        channel_count / 1000);
+    wsola->hanning_size = (pj_uint16_t)ALIGN_CH(wsola, HANNING_PTIME *
+						clock_rate * channel_count /
+						1000);
     if (wsola->hanning_size > wsola->samples_per_frame)
 	wsola->hanning_size = wsola->samples_per_frame;
 
@@ -557,14 +573,15 @@ PJ_DEF(pj_status_t) pjmedia_wsola_create( pj_pool_t *pool,
     if ((options & PJMEDIA_WSOLA_NO_PLC) == 0) {
 	wsola->min_extra = wsola->hanning_size;
 	wsola->expand_sr_min_dist = (pj_uint16_t)
-				    (EXP_MIN_DIST * wsola->samples_per_frame);
+		ALIGN_CH(wsola, EXP_MIN_DIST * wsola->samples_per_frame);
 	wsola->expand_sr_max_dist = (pj_uint16_t)
-				    (EXP_MAX_DIST * wsola->samples_per_frame);
+		ALIGN_CH(wsola, EXP_MAX_DIST * wsola->samples_per_frame);
     }
 
     /* Setup with hanning */
     if ((options & PJMEDIA_WSOLA_NO_HANNING) == 0) {
-	create_win(pool, &wsola->hanning, wsola->hanning_size);
+	create_win(pool, &wsola->hanning, wsola->hanning_size,
+		   channel_count);
     }
 
     /* Setup with discard */
@@ -594,7 +611,8 @@ PJ_DEF(pj_status_t) pjmedia_wsola_set_max_expand(pjmedia_wsola *wsola,
 						  unsigned msec)
 {
     PJ_ASSERT_RETURN(wsola, PJ_EINVAL);
-    wsola->max_expand_cnt = msec * wsola->clock_rate / 1000;
+    wsola->max_expand_cnt = msec * wsola->clock_rate *
+			    wsola->channel_count / 1000;
     return PJ_SUCCESS;
 }
 
@@ -633,17 +651,16 @@ static void expand(pjmedia_wsola *wsola, unsigned needed)
 	templ = reg1 + reg1_len - wsola->hanning_size;
 	CHECK_(templ - reg1 >= wsola->hist_size);
 
+	/* The search distances are multiple of the channel count, so
+	 * "start" is aligned to channel #0, as the template is.
+	 */
 	start = find_pitch(templ, 
 			   templ - wsola->expand_sr_max_dist, 
 			   templ - wsola->expand_sr_min_dist,
 			   wsola->templ_size, 
+			   wsola->channel_count,
 			   1);
 
-	/* Should we make sure that "start" is really aligned to
-	 * channel #0, in case of stereo? Probably not necessary, as
-	 * find_pitch() should have found the best match anyway.
-	 */
-
 	if (wsola->options & PJMEDIA_WSOLA_NO_HANNING) {
 	    overlapp_add_simple(wsola->merge_buf, wsola->hanning_size, 
 			        templ, start);
@@ -709,7 +726,8 @@ static unsigned compress(pjmedia_wsola *wsola, pj_int16_t *buf, unsigned count,
 	// Make start distance to del_cnt, so discard will be performed in
 	// only one iteration.
 	//start = buf + (frmsz >> 1);
-	start = buf + del_cnt - samples_del;
+	start = buf + ALIGN_CH(wsola, del_cnt - samples_del +
+				      wsola->channel_count - 1);
 	end = start + wsola->samples_per_frame;
 
 	if (end + wsola->hanning_size > buf + count) {
@@ -718,7 +736,8 @@ static unsigned compress(pjmedia_wsola *wsola, pj_int16_t *buf, unsigned count,
 
 	CHECK_(start < end);
 
-	start = find_pitch(buf, start, end, wsola->templ_size, 0);
+	start = find_pitch(buf, start, end, wsola->templ_size,
+			   wsola->channel_count, 0);
 	dist = (unsigned)(start - buf);
 
 	if (wsola->options & PJMEDIA_WSOLA_NO_HANNING) {
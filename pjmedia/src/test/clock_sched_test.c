@@ -0,0 +1,361 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2011 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "test.h"
+
+#define THIS_FILE	"clock_sched_test.c"
+
+#define CLOCK_RATE	8000
+#define SPF		160	/* 20 ms */
+#define CLOCK_CNT	40
+#define RUN_MSEC	1000
+#define STOP_AFTER	5
+
+
+typedef struct clock_data
+{
+    pjmedia_clock   *clock;
+    pj_timestamp     start;
+    unsigned	     first_msec;
+    unsigned	     tick_cnt;
+    pj_bool_t	     bad_ts;
+    pj_bool_t	     stop_self;
+} clock_data;
+
+
+static void clock_cb(const pj_timestamp *ts, void *user_data)
+{
+    clock_data *cd = (clock_data*) user_data;
+
+    if (cd->tick_cnt == 0) {
+	pj_timestamp now;
+
+	pj_get_timestamp(&now);
+	cd->first_msec = (pj_elapsed_usec(&cd->start, &now) + 500) / 1000;
+    }
+
+    if (ts->u64 != (pj_uint64_t)cd->tick_cnt * SPF)
+	cd->bad_ts = PJ_TRUE;
+
+    ++cd->tick_cnt;
+
+    if (cd->stop_self && cd->tick_cnt == STOP_AFTER)
+	pjmedia_clock_stop(cd->clock);
+}
+
+
+/* Run many clocks in two scheduler threads */
+static int tick_test(pj_pool_t *pool)
+{
+    pjmedia_clock_sched *sched;
+    clock_data cd[CLOCK_CNT];
+    unsigned phase_cnt[SPF * 1000 / CLOCK_RATE];
+    unsigned i, phases;
+    pj_timestamp start;
+    int rc = 0;
+    pj_status_t status;
+
+    status = pjmedia_clock_sched_create(pool, 2,
+					PJMEDIA_CLOCK_NO_HIGHEST_PRIO,
+					&sched);
+    if (status != PJ_SUCCESS)
+	return -10;
+
+    pj_bzero(cd, sizeof(cd));
+    pj_bzero(phase_cnt, sizeof(phase_cnt));
+
+    for (i = 0; i < CLOCK_CNT; ++i) {
+	status = pjmedia_clock_create(pool, CLOCK_RATE, 1, SPF, 0,
+				      &clock_cb, &cd[i], &cd[i].clock);
+	if (status != PJ_SUCCESS) {
+	    rc = -20;
+	    goto on_return;
+	}
+	pjmedia_clock_set_sched(cd[i].clock, sched);
+    }
+
+    /* The last clock stops itself from its callback */
+    cd[CLOCK_CNT-1].stop_self = PJ_TRUE;
+
+    pj_get_timestamp(&start);
+    for (i = 0; i < CLOCK_CNT; ++i) {
+	cd[i].start = start;
+	status = pjmedia_clock_start(cd[i].clock);
+	if (status != PJ_SUCCESS) {
+	    rc = -30;
+	    goto on_return;
+	}
+    }
+
+    if (pjmedia_clock_sched_get_clock_count(sched) != CLOCK_CNT) {
+	rc = -40;
+	goto on_return;
+    }
+
+    pj_thread_sleep(RUN_MSEC);
+
+    for (i = 0; i < CLOCK_CNT; ++i)
+	pjmedia_clock_stop(cd[i].clock);
+
+    if (pjmedia_clock_sched_get_clock_count(sched) != 0) {
+	rc = -50;
+	goto on_return;
+    }
+
+    for (i = 0; i < CLOCK_CNT; ++i) {
+	unsigned expected = RUN_MSEC * CLOCK_RATE / SPF / 1000;
+
+	if (cd[i].bad_ts) {
+	    rc = -60;
+	    goto on_return;
+	}
+
+	if (cd[i].stop_self) {
+	    if (cd[i].tick_cnt != STOP_AFTER) {
+		rc = -70;
+		goto on_return;
+	    }
+	    continue;
+	}
+
+	/* Be lenient, the test machine may be busy */
+	if (cd[i].tick_cnt < expected * 8 / 10 ||
+	    cd[i].tick_cnt > expected + 2)
+	{
+	    PJ_LOG(3,(THIS_FILE, "    clock %u: %u ticks, expecting %u",
+		      i, cd[i].tick_cnt, expected));
+	    rc = -80;
+	    goto on_return;
+	}
+
+	phase_cnt[cd[i].first_msec % PJ_ARRAY_SIZE(phase_cnt)]++;
+    }
+
+    /* The clocks must be spread across the frame interval. The first tick
+     * is measured with the wake up jitter of the scheduler threads, so
+     * neighbouring phases may merge.
+     */
+    for (i = 0, phases = 0; i < PJ_ARRAY_SIZE(phase_cnt); ++i) {
+	if (phase_cnt[i])
+	    ++phases;
+    }
+    PJ_LOG(3,(THIS_FILE, "    %u clocks spread in %u phases", CLOCK_CNT-1,
+	      phases));
+    if (phases < PJ_ARRAY_SIZE(phase_cnt) / 4) {
+	rc = -90;
+	goto on_return;
+    }
+
+    /* No more ticks after the clocks are stopped */
+    cd[0].tick_cnt = 0;
+    pj_thread_sleep(50);
+    if (cd[0].tick_cnt != 0)
+	rc = -100;
+
+on_return:
+    for (i = 0; i < CLOCK_CNT; ++i) {
+	if (cd[i].clock)
+	    pjmedia_clock_destroy(cd[i].clock);
+    }
+    pjmedia_clock_sched_destroy(sched);
+    return rc;
+}
+
+
+/* Run master ports in the scheduler */
+static int master_port_test(pj_pool_t *pool)
+{
+    pjmedia_clock_sched *sched;
+    pjmedia_master_port *mp[4];
+    unsigned i;
+    int rc = 0;
+    pj_status_t status;
+
+    status = pjmedia_clock_sched_create(pool, 1,
+					PJMEDIA_CLOCK_NO_HIGHEST_PRIO,
+					&sched);
+    if (status != PJ_SUCCESS)
+	return -200;
+
+    pj_bzero(mp, sizeof(mp));
+    for (i = 0; i < PJ_ARRAY_SIZE(mp); ++i) {
+	pjmedia_port *u_port, *d_port;
+
+	pjmedia_null_port_create(pool, CLOCK_RATE, 1, SPF, 16, &u_port);
+	pjmedia_null_port_create(pool, CLOCK_RATE, 1, SPF, 16, &d_port);
+
+	status = pjmedia_master_port_create(pool, u_port, d_port, 0, &mp[i]);
+	if (status != PJ_SUCCESS) {
+	    rc = -210;
+	    goto on_return;
+	}
+
+	status = pjmedia_master_port_set_clock_sched(mp[i], sched);
+	if (status == PJ_SUCCESS)
+	    status = pjmedia_master_port_start(mp[i]);
+	if (status != PJ_SUCCESS) {
+	    rc = -220;
+	    goto on_return;
+	}
+    }
+
+    if (pjmedia_clock_sched_get_clock_count(sched) != PJ_ARRAY_SIZE(mp)) {
+	rc = -230;
+	goto on_return;
+    }
+
+    pj_thread_sleep(100);
+
+on_return:
+    for (i = 0; i < PJ_ARRAY_SIZE(mp); ++i) {
+	if (mp[i])
+	    pjmedia_master_port_destroy(mp[i], PJ_TRUE);
+    }
+    if (rc == 0 && pjmedia_clock_sched_get_clock_count(sched) != 0)
+	rc = -240;
+    pjmedia_clock_sched_destroy(sched);
+    return rc;
+}
+
+
+/* A clock callback which waits for the mutex of the application */
+typedef struct block_data
+{
+    pj_mutex_t	    *mutex;
+    pj_bool_t	     entered;
+} block_data;
+
+static void block_cb(const pj_timestamp *ts, void *user_data)
+{
+    block_data *bd = (block_data*) user_data;
+
+    PJ_UNUSED_ARG(ts);
+
+    bd->entered = PJ_TRUE;
+    pj_mutex_lock(bd->mutex);
+    pj_mutex_unlock(bd->mutex);
+}
+
+
+/* Stopping a clock must not wait for the callbacks of the other clocks of
+ * its scheduler thread, and the clocks stopped by destroying the scheduler
+ * can be started again.
+ */
+static int stop_test(pj_pool_t *pool)
+{
+    pjmedia_clock_sched *sched;
+    pjmedia_clock *blk_clock = NULL;
+    clock_data cd;
+    block_data bd;
+    unsigned i;
+    int rc = 0;
+    pj_status_t status;
+
+    status = pjmedia_clock_sched_create(pool, 1,
+					PJMEDIA_CLOCK_NO_HIGHEST_PRIO,
+					&sched);
+    if (status != PJ_SUCCESS)
+	return -300;
+
+    pj_bzero(&cd, sizeof(cd));
+    pj_bzero(&bd, sizeof(bd));
+
+    status = pj_mutex_create_simple(pool, "clkschedtest", &bd.mutex);
+    if (status == PJ_SUCCESS)
+	status = pjmedia_clock_create(pool, CLOCK_RATE, 1, SPF, 0, &block_cb,
+				      &bd, &blk_clock);
+    if (status == PJ_SUCCESS)
+	status = pjmedia_clock_create(pool, CLOCK_RATE, 1, SPF, 0, &clock_cb,
+				      &cd, &cd.clock);
+    if (status != PJ_SUCCESS) {
+	rc = -310;
+	goto on_return;
+    }
+    pjmedia_clock_set_sched(blk_clock, sched);
+    pjmedia_clock_set_sched(cd.clock, sched);
+
+    /* Block the callback of one clock with the mutex held by this thread,
+     * then stop the other clock.
+     */
+    pj_mutex_lock(bd.mutex);
+    pj_get_timestamp(&cd.start);
+    pjmedia_clock_start(blk_clock);
+    pjmedia_clock_start(cd.clock);
+
+    for (i = 0; i < 100 && !bd.entered; ++i)
+	pj_thread_sleep(10);
+
+    pjmedia_clock_stop(cd.clock);
+    pj_mutex_unlock(bd.mutex);
+    pjmedia_clock_stop(blk_clock);
+
+    if (!bd.entered) {
+	rc = -320;
+	goto on_return;
+    }
+
+    /* The clock no longer uses the destroyed scheduler */
+    pjmedia_clock_start(cd.clock);
+    pjmedia_clock_sched_destroy(sched);
+    sched = NULL;
+
+    cd.tick_cnt = 0;
+    pjmedia_clock_start(cd.clock);
+    pj_thread_sleep(100);
+    pjmedia_clock_stop(cd.clock);
+    if (cd.tick_cnt == 0)
+	rc = -330;
+
+on_return:
+    if (blk_clock)
+	pjmedia_clock_destroy(blk_clock);
+    if (cd.clock)
+	pjmedia_clock_destroy(cd.clock);
+    if (bd.mutex)
+	pj_mutex_destroy(bd.mutex);
+    if (sched)
+	pjmedia_clock_sched_destroy(sched);
+    return rc;
+}
+
+
+int clock_sched_test(void)
+{
+    pj_pool_t *pool;
+    int rc;
+
+    pool = pj_pool_create(mem, "clkschedtest", 4000, 4000, NULL);
+
+    PJ_LOG(3,(THIS_FILE, "  clock tick test"));
+    rc = tick_test(pool);
+    if (rc != 0)
+	goto on_return;
+
+    PJ_LOG(3,(THIS_FILE, "  master port test"));
+    rc = master_port_test(pool);
+    if (rc != 0)
+	goto on_return;
+
+    PJ_LOG(3,(THIS_FILE, "  clock stop test"));
+    rc = stop_test(pool);
+
+on_return:
+    pj_pool_release(pool);
+    return rc;
+}
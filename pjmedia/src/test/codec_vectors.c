@@ -508,6 +508,95 @@ on_return:
     return rc;
 }
 
+/*
+ * G.711 block conversion test. Check that the block functions give the
+ * same result as the per-sample conversion for every input value, then
+ * compare their throughput.
+ */
+#define G711_BLOCK_LEN	    160
+#define G711_BENCH_LOOP	    20000
+
+static int g711_block_test(void)
+{
+    pj_int16_t pcm[G711_BLOCK_LEN+3], pcm2[G711_BLOCK_LEN+3];
+    pj_uint8_t enc[G711_BLOCK_LEN+3], enc2[G711_BLOCK_LEN+3];
+    pj_timestamp t0, t1, t2;
+    unsigned i, j, loop;
+
+    pjmedia_alaw_ulaw_block_init();
+
+    /* All PCM values, in blocks with an odd length to exercise the
+     * scalar tail too.
+     */
+    for (i=0; i<65536; i+=G711_BLOCK_LEN+3) {
+	unsigned n = PJ_MIN(G711_BLOCK_LEN+3, 65536-i);
+
+	for (j=0; j<n; ++j)
+	    pcm[j] = (pj_int16_t)(i + j);
+
+	pjmedia_ulaw_encode(enc, pcm, n);
+	pjmedia_ulaw_encode_block(enc2, pcm, n);
+	if (pj_memcmp(enc, enc2, n) != 0) {
+	    PJ_LOG(1,(THIS_FILE, "     U-law encode mismatch near %d", i));
+	    return -1010;
+	}
+
+	pjmedia_alaw_encode(enc, pcm, n);
+	pjmedia_alaw_encode_block(enc2, pcm, n);
+	if (pj_memcmp(enc, enc2, n) != 0) {
+	    PJ_LOG(1,(THIS_FILE, "     A-law encode mismatch near %d", i));
+	    return -1020;
+	}
+    }
+
+    /* All codes */
+    for (i=0; i<256; i+=G711_BLOCK_LEN+3) {
+	unsigned n = PJ_MIN(G711_BLOCK_LEN+3, 256-i);
+
+	for (j=0; j<n; ++j)
+	    enc[j] = (pj_uint8_t)(i + j);
+
+	pjmedia_ulaw_decode(pcm, enc, n);
+	pjmedia_ulaw_decode_block(pcm2, enc, n);
+	if (pj_memcmp(pcm, pcm2, n*2) != 0) {
+	    PJ_LOG(1,(THIS_FILE, "     U-law decode mismatch near %d", i));
+	    return -1030;
+	}
+
+	pjmedia_alaw_decode(pcm, enc, n);
+	pjmedia_alaw_decode_block(pcm2, enc, n);
+	if (pj_memcmp(pcm, pcm2, n*2) != 0) {
+	    PJ_LOG(1,(THIS_FILE, "     A-law decode mismatch near %d", i));
+	    return -1040;
+	}
+    }
+
+    /* Throughput */
+    for (j=0; j<G711_BLOCK_LEN; ++j)
+	pcm[j] = (pj_int16_t)((pj_rand() % 65536) - 32768);
+
+    pj_get_timestamp(&t0);
+    for (loop=0; loop<G711_BENCH_LOOP; ++loop) {
+	pjmedia_ulaw_encode(enc, pcm, G711_BLOCK_LEN);
+	pjmedia_ulaw_decode(pcm2, enc, G711_BLOCK_LEN);
+	pcm[loop % G711_BLOCK_LEN] ^= pcm2[0];
+    }
+    pj_get_timestamp(&t1);
+    for (loop=0; loop<G711_BENCH_LOOP; ++loop) {
+	pjmedia_ulaw_encode_block(enc, pcm, G711_BLOCK_LEN);
+	pjmedia_ulaw_decode_block(pcm2, enc, G711_BLOCK_LEN);
+	pcm[loop % G711_BLOCK_LEN] ^= pcm2[0];
+    }
+    pj_get_timestamp(&t2);
+
+    PJ_LOG(3,(THIS_FILE, "    U-law encode+decode of %u frames of %u "
+			 "samples: per-sample %u usec, block %u usec",
+	      G711_BENCH_LOOP, G711_BLOCK_LEN,
+	      pj_elapsed_usec(&t0, &t1), pj_elapsed_usec(&t1, &t2)));
+
+    return 0;
+}
+
 #if PJMEDIA_HAS_G7221_CODEC
 /* For ITU testing, off the 2 lsbs. */
 static void g7221_pcm_manip(short *pcm, unsigned count)
@@ -579,6 +668,11 @@ int codec_test_vectors(void)
     unsigned i;
     pj_status_t status;
 
+    PJ_LOG(3,(THIS_FILE,"  G.711 block conversion test:"));
+    rc = g711_block_test();
+    if (rc != 0)
+	return rc;
+
     status = pjmedia_endpt_create(mem, NULL, 0, &endpt);
     if (status != PJ_SUCCESS)
 	return -5;
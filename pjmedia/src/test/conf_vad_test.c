@@ -0,0 +1,231 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2011 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "test.h"
+
+#define THIS_FILE	"conf_vad_test.c"
+
+#define CLOCK_RATE	8000
+#define SPF		160
+#define PTIME		20
+
+/* Silence frames given to a listener before NULL frames, i.e:
+ * SILENCE_FLUSH_MSEC of conference.c in PTIME frames.
+ */
+#define FLUSH_FRAMES	3
+
+/* Frames of silence until the silence detector of the bridge is sure */
+#define SILENT_FRAMES	50
+
+#define SIGNATURE	PJMEDIA_SIG_CLASS_PORT_AUD('C','V')
+
+enum src_mode
+{
+    SRC_TONE,
+    SRC_SILENCE,
+    SRC_NONE
+};
+
+/* Source port produces a tone, zero samples, or NULL frames, and sink port
+ * counts the frames it receives by the content.
+ */
+struct test_port
+{
+    pjmedia_port	base;
+    enum src_mode	mode;
+    unsigned		signal_cnt;
+    unsigned		zero_cnt;
+    unsigned		none_cnt;
+};
+
+static pj_status_t src_get_frame(pjmedia_port *this_port,
+				 pjmedia_frame *frame)
+{
+    struct test_port *port = (struct test_port*)this_port;
+    pj_int16_t *samples = (pj_int16_t*)frame->buf;
+    unsigned i;
+
+    if (port->mode == SRC_NONE) {
+	frame->type = PJMEDIA_FRAME_TYPE_NONE;
+	frame->size = 0;
+	return PJ_SUCCESS;
+    }
+
+    for (i = 0; i < SPF; ++i) {
+	if (port->mode == SRC_TONE)
+	    samples[i] = (pj_int16_t)((i & 8) ? 5000 : -5000);
+	else
+	    samples[i] = 0;
+    }
+    frame->type = PJMEDIA_FRAME_TYPE_AUDIO;
+    frame->size = SPF * 2;
+
+    return PJ_SUCCESS;
+}
+
+static pj_status_t sink_put_frame(pjmedia_port *this_port,
+				  pjmedia_frame *frame)
+{
+    struct test_port *port = (struct test_port*)this_port;
+    const pj_int16_t *samples = (const pj_int16_t*)frame->buf;
+    unsigned i;
+
+    if (frame->type != PJMEDIA_FRAME_TYPE_AUDIO) {
+	++port->none_cnt;
+	return PJ_SUCCESS;
+    }
+
+    for (i = 0; i < SPF && samples && samples[i] == 0; ++i)
+	;
+    if (i == SPF || !samples)
+	++port->zero_cnt;
+    else
+	++port->signal_cnt;
+
+    return PJ_SUCCESS;
+}
+
+static void init_port(struct test_port *port, const char *name)
+{
+    pj_str_t port_name = pj_str((char*)name);
+
+    pj_bzero(port, sizeof(*port));
+    pjmedia_port_info_init(&port->base.info, &port_name, SIGNATURE,
+			   CLOCK_RATE, 1, 16, SPF);
+    port->base.get_frame = &src_get_frame;
+    port->base.put_frame = &sink_put_frame;
+}
+
+/* Run the bridge for the number of frames, starting the sink counters */
+static void run_conf(pjmedia_port *master, struct test_port *sink,
+		     unsigned count)
+{
+    pj_int16_t buf[SPF];
+    pjmedia_frame frame;
+
+    sink->signal_cnt = sink->zero_cnt = sink->none_cnt = 0;
+
+    while (count--) {
+	pj_bzero(&frame, sizeof(frame));
+	frame.buf = buf;
+	frame.size = sizeof(buf);
+	pjmedia_port_get_frame(master, &frame);
+    }
+}
+
+int conf_vad_test(void)
+{
+    pj_pool_t *pool;
+    pjmedia_conf *conf = NULL;
+    pjmedia_port *master;
+    struct test_port src, sink;
+    unsigned src_slot, sink_slot, tx_level, rx_level;
+    int rc = 0;
+
+    pool = pj_pool_create(mem, "confvad", 4000, 4000, NULL);
+
+    if (pjmedia_conf_create(pool, 4, CLOCK_RATE, 1, SPF, 16,
+			    PJMEDIA_CONF_NO_DEVICE | PJMEDIA_CONF_VAD,
+			    &conf) != PJ_SUCCESS)
+    {
+	rc = -10;
+	goto on_return;
+    }
+    master = pjmedia_conf_get_master_port(conf);
+
+    init_port(&src, "src");
+    init_port(&sink, "sink");
+
+    if (pjmedia_conf_add_port(conf, pool, &src.base, NULL,
+			      &src_slot) != PJ_SUCCESS ||
+	pjmedia_conf_add_port(conf, pool, &sink.base, NULL,
+			      &sink_slot) != PJ_SUCCESS ||
+	pjmedia_conf_connect_port(conf, src_slot, sink_slot,
+				  0) != PJ_SUCCESS)
+    {
+	rc = -20;
+	goto on_return;
+    }
+
+    PJ_LOG(3,(THIS_FILE, "  signal test"));
+    src.mode = SRC_TONE;
+    run_conf(master, &sink, 10);
+    pjmedia_conf_get_signal_level(conf, src_slot, &tx_level, &rx_level);
+    if (sink.signal_cnt != 10 || rx_level == 0) {
+	rc = -30;
+	goto on_return;
+    }
+
+    /* Without frames from the source, its level is reset, and the sink
+     * gets silence for the flush period, then NULL frames.
+     */
+    PJ_LOG(3,(THIS_FILE, "  NULL frames test"));
+    src.mode = SRC_NONE;
+    run_conf(master, &sink, 10);
+    pjmedia_conf_get_signal_level(conf, src_slot, &tx_level, &rx_level);
+    if (rx_level != 0) {
+	rc = -40;
+	goto on_return;
+    }
+    if (sink.signal_cnt != 0 || sink.zero_cnt != FLUSH_FRAMES ||
+	sink.none_cnt != 10 - FLUSH_FRAMES)
+    {
+	PJ_LOG(3,(THIS_FILE, "    signal/zero/none frames: %u/%u/%u",
+		  sink.signal_cnt, sink.zero_cnt, sink.none_cnt));
+	rc = -50;
+	goto on_return;
+    }
+
+    /* Signal gets through again right away */
+    src.mode = SRC_TONE;
+    run_conf(master, &sink, 1);
+    if (sink.signal_cnt != 1) {
+	rc = -60;
+	goto on_return;
+    }
+
+    /* Once the silence detector finds the source silent, the source is
+     * not mixed anymore, so the sink gets NULL frames after the flush.
+     */
+    PJ_LOG(3,(THIS_FILE, "  silent port test"));
+    src.mode = SRC_SILENCE;
+    run_conf(master, &sink, SILENT_FRAMES);
+    if (sink.signal_cnt != 0 || sink.none_cnt == 0) {
+	rc = -70;
+	goto on_return;
+    }
+    run_conf(master, &sink, 10);
+    if (sink.none_cnt != 10) {
+	rc = -80;
+	goto on_return;
+    }
+
+    src.mode = SRC_TONE;
+    run_conf(master, &sink, 5);
+    if (sink.signal_cnt == 0) {
+	rc = -90;
+	goto on_return;
+    }
+
+on_return:
+    if (conf)
+	pjmedia_conf_destroy(conf);
+    pj_pool_release(pool);
+    return rc;
+}
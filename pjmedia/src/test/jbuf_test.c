@@ -27,17 +27,27 @@
 #define JB_MAX_PREFETCH	    10
 #define JB_PTIME	    20
 #define JB_BUF_SIZE	    50
+#define JB_STRETCH_GAP	    10	/* Min GETs between playout adjustments */
+#define JB_PKT_FRAME	    160	/* Frame size of the packet reference test */
 
 //#define REPORT
 //#define PRINT_COMMENT
 
 typedef struct test_param_t {
     pj_bool_t adaptive;
+    pj_bool_t percentile;
     unsigned init_prefetch;
     unsigned min_prefetch;
     unsigned max_prefetch;
 } test_param_t;
 
+/* Playout time-stretching done on behalf of the percentile engine */
+typedef struct stretch_state_t {
+    unsigned gap;	    /**< GETs since the last adjustment.    */
+    unsigned compress;	    /**< Number of extra frames retrieved.  */
+    unsigned expand;	    /**< Number of frames synthesized.	    */
+} stretch_state_t;
+
 typedef struct test_cond_t {
     int burst;
     int discard;
@@ -58,7 +68,9 @@ static pj_bool_t parse_test_headers(char *line, test_param_t *param,
 
 	sscanf(p+1, "%s %u %u %u", mode_st, &param->init_prefetch,
 	       &param->min_prefetch, &param->max_prefetch);
-	param->adaptive = (pj_ansi_stricmp(mode_st, "adaptive") == 0);
+	param->percentile = (pj_ansi_stricmp(mode_st, "percentile") == 0);
+	param->adaptive = param->percentile ||
+			  (pj_ansi_stricmp(mode_st, "adaptive") == 0);
 
     } else if (*p == '!') {
 	/* Success condition. */
@@ -102,7 +114,38 @@ static pj_bool_t parse_test_headers(char *line, test_param_t *param,
     return PJ_TRUE;
 }
 
+/* GET a frame the way a time-stretching consumer (e.g: the audio stream)
+ * would with the percentile engine: retrieve one more frame to compress
+ * the playout, or synthesize a frame instead of retrieving one to expand
+ * it, at most once every JB_STRETCH_GAP GETs.
+ */
+static void get_frame_stretch(pjmedia_jbuf *jb, stretch_state_t *stretch)
+{
+    char frame[1];
+    char f_type;
+    int adj;
+
+    adj = pjmedia_jbuf_get_playout_adj(jb);
+    if (adj == 0 || ++stretch->gap < JB_STRETCH_GAP) {
+	pjmedia_jbuf_get_frame(jb, frame, &f_type);
+	return;
+    }
+
+    stretch->gap = 0;
+    if (adj > 0) {
+	pjmedia_jbuf_get_frame(jb, frame, &f_type);
+	pjmedia_jbuf_get_frame(jb, frame, &f_type);
+	pjmedia_jbuf_set_playout_stretch(jb, -256);
+	++stretch->compress;
+    } else {
+	pjmedia_jbuf_set_playout_stretch(jb, 256);
+	++stretch->expand;
+    }
+}
+
 static pj_bool_t process_test_data(char data, pjmedia_jbuf *jb,
+				   const test_param_t *param,
+				   stretch_state_t *stretch,
 				   pj_uint16_t *seq, pj_uint16_t *last_seq)
 {
     char frame[1];
@@ -112,7 +155,10 @@ static pj_bool_t process_test_data(char data, pjmedia_jbuf *jb,
 
     switch (toupper(data)) {
     case 'G': /* Get */
-	pjmedia_jbuf_get_frame(jb, frame, &f_type);
+	if (param->percentile)
+	    get_frame_stretch(jb, stretch);
+	else
+	    pjmedia_jbuf_get_frame(jb, frame, &f_type);
 	break;
     case 'P': /* Put */
 	pjmedia_jbuf_put_frame(jb, (void*)frame, 1, *seq);
@@ -165,6 +211,119 @@ static pj_bool_t process_test_data(char data, pjmedia_jbuf *jb,
     return PJ_TRUE;
 }
 
+/* Frames put with a packet buffer must be referenced rather than copied,
+ * and every reference must be given back to the packet pool.
+ */
+static int pkt_ref_test(void)
+{
+    pj_str_t jb_name = {"JBPKT", 5};
+    pj_pool_t *pool;
+    pjmedia_pkt_pool *pkt_pool;
+    pjmedia_pkt_buf *pkt;
+    pjmedia_jbuf *jb;
+    char local[JB_PKT_FRAME];
+    char copy[JB_PKT_FRAME];
+    const void *frame;
+    pj_size_t size;
+    char frame_type;
+    int rc = 0;
+
+    pool = pj_pool_create(mem, "JBPKT", 4000, 4000, NULL);
+    if (pjmedia_pkt_pool_create(pool, NULL, 200, 4, &pkt_pool) != PJ_SUCCESS)
+    {
+	pj_pool_release(pool);
+	return -100;
+    }
+    pjmedia_jbuf_create(pool, &jb_name, JB_PKT_FRAME, JB_PTIME, 8, &jb);
+    pjmedia_jbuf_set_fixed(jb, 0);
+
+    /* Frame in the packet, after the RTP header: referenced */
+    pkt = pjmedia_pkt_pool_alloc(pkt_pool);
+    pj_memset((char*)pkt->buf + 12, 'a', JB_PKT_FRAME);
+    pjmedia_jbuf_put_pkt(jb, pkt, (char*)pkt->buf + 12, JB_PKT_FRAME, 0,
+			 1, 0, NULL);
+    /* Duplicate, must not take another reference */
+    pjmedia_jbuf_put_pkt(jb, pkt, (char*)pkt->buf + 12, JB_PKT_FRAME, 0,
+			 1, 0, NULL);
+    pjmedia_pkt_buf_dec_ref(pkt);
+    if (pjmedia_pkt_pool_get_free_cnt(pkt_pool) != 3) {
+	rc = -110;
+	goto on_return;
+    }
+
+    /* Frame outside of the packet: copied */
+    pkt = pjmedia_pkt_pool_alloc(pkt_pool);
+    pj_memset(local, 'b', sizeof(local));
+    pjmedia_jbuf_put_pkt(jb, pkt, local, JB_PKT_FRAME, 0, 2, 0, NULL);
+    pjmedia_pkt_buf_dec_ref(pkt);
+    if (pjmedia_pkt_pool_get_free_cnt(pkt_pool) != 3) {
+	rc = -120;
+	goto on_return;
+    }
+    pj_memset(local, 0, sizeof(local));
+
+    /* The first frame is returned in place and held until the next GET */
+    pjmedia_jbuf_get_frame_ptr(jb, &frame, &size, &frame_type, NULL, NULL,
+			       NULL);
+    if (frame_type != PJMEDIA_JB_NORMAL_FRAME || size != JB_PKT_FRAME ||
+	pjmedia_pkt_pool_find(pkt_pool, frame) == NULL ||
+	((const char*)frame)[0] != 'a' ||
+	pjmedia_pkt_pool_get_free_cnt(pkt_pool) != 3)
+    {
+	rc = -130;
+	goto on_return;
+    }
+    pjmedia_jbuf_get_frame_ptr(jb, &frame, &size, &frame_type, NULL, NULL,
+			       NULL);
+    if (frame_type != PJMEDIA_JB_NORMAL_FRAME || size != JB_PKT_FRAME ||
+	((const char*)frame)[JB_PKT_FRAME-1] != 'b' ||
+	pjmedia_pkt_pool_get_free_cnt(pkt_pool) != 4)
+    {
+	rc = -140;
+	goto on_return;
+    }
+
+    /* Copying GET releases the reference */
+    pkt = pjmedia_pkt_pool_alloc(pkt_pool);
+    pj_memset(pkt->buf, 'c', JB_PKT_FRAME);
+    pjmedia_jbuf_put_pkt(jb, pkt, pkt->buf, JB_PKT_FRAME, 0, 3, 0, NULL);
+    pjmedia_pkt_buf_dec_ref(pkt);
+    pjmedia_jbuf_get_frame2(jb, copy, &size, &frame_type, NULL);
+    if (frame_type != PJMEDIA_JB_NORMAL_FRAME || copy[0] != 'c' ||
+	pjmedia_pkt_pool_get_free_cnt(pkt_pool) != 4)
+    {
+	rc = -150;
+	goto on_return;
+    }
+
+    /* Reset releases all references */
+    pkt = pjmedia_pkt_pool_alloc(pkt_pool);
+    pjmedia_jbuf_put_pkt(jb, pkt, pkt->buf, JB_PKT_FRAME, 0, 4, 0, NULL);
+    pjmedia_jbuf_put_pkt(jb, pkt, (char*)pkt->buf + 20, 20, 0, 5, 0, NULL);
+    pjmedia_pkt_buf_dec_ref(pkt);
+    pjmedia_jbuf_reset(jb);
+    if (pjmedia_pkt_pool_get_free_cnt(pkt_pool) != 4) {
+	rc = -160;
+	goto on_return;
+    }
+
+    /* So does destroy */
+    pkt = pjmedia_pkt_pool_alloc(pkt_pool);
+    pjmedia_jbuf_put_pkt(jb, pkt, pkt->buf, JB_PKT_FRAME, 0, 6, 0, NULL);
+    pjmedia_pkt_buf_dec_ref(pkt);
+
+on_return:
+    pjmedia_jbuf_destroy(jb);
+    if (rc == 0 && pjmedia_pkt_pool_get_free_cnt(pkt_pool) != 4)
+	rc = -170;
+    pjmedia_pkt_pool_destroy(pkt_pool);
+    pj_pool_release(pool);
+
+    if (rc != 0)
+	printf("! Packet reference test failed, rc=%d\n", rc);
+    return rc;
+}
+
 int jbuf_main(void)
 {
     FILE *input;
@@ -178,6 +337,10 @@ int jbuf_main(void)
 	"build"
     };
 
+    rc = pkt_ref_test();
+    if (rc != 0)
+	return rc;
+
     /* Try to open test data file in the working directory */
     input = fopen(input_filename, "rt");
 
@@ -208,6 +371,7 @@ int jbuf_main(void)
 	pjmedia_jbuf *jb;
 	pj_pool_t *pool;
 	pjmedia_jb_state state;
+	stretch_state_t stretch;
 	pj_uint16_t last_seq = 0;
 	pj_uint16_t seq = 1;
 	char line[1024], *p = NULL;
@@ -216,6 +380,7 @@ int jbuf_main(void)
 	test_cond_t cond;
 
 	param.adaptive = PJ_TRUE;
+	param.percentile = PJ_FALSE;
 	param.init_prefetch = JB_INIT_PREFETCH;
 	param.min_prefetch = JB_MIN_PREFETCH;
 	param.max_prefetch = JB_MAX_PREFETCH;
@@ -244,6 +409,10 @@ int jbuf_main(void)
 	pool = pj_pool_create(mem, "JBPOOL", 256*16, 256*16, NULL);
 	pjmedia_jbuf_create(pool, &jb_name, 1, JB_PTIME, JB_BUF_SIZE, &jb);
 	pjmedia_jbuf_reset(jb);
+	pj_bzero(&stretch, sizeof(stretch));
+
+	if (param.percentile)
+	    pjmedia_jbuf_set_engine(jb, PJMEDIA_JB_ENGINE_PERCENTILE);
 
 	if (param.adaptive) {
 	    pjmedia_jbuf_set_adaptive(jb,
@@ -293,7 +462,7 @@ int jbuf_main(void)
 	    }
 
 	    /* Process test data */
-	    if (!process_test_data(c, jb, &seq, &last_seq))
+	    if (!process_test_data(c, jb, &param, &stretch, &seq, &last_seq))
 		break;
 	}
 
@@ -307,6 +476,10 @@ int jbuf_main(void)
 	       state.dev_delay);
 	printf("  lost=%d discard=%d empty=%d burst(avg)=%d\n",
 	       state.lost, state.discard, state.empty, state.avg_burst);
+	if (param.percentile) {
+	    printf("  target=%d stretch (compress/expand)=%d/%d\n",
+		   state.burst, stretch.compress, stretch.expand);
+	}
 
 	/* Evaluate test session */
 	if (cond.burst >= 0 && (int)state.avg_burst > cond.burst) {
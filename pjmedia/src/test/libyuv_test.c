@@ -0,0 +1,295 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2011 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "test.h"
+
+#if HAS_LIBYUV_TEST
+
+#include <libyuv.h>
+
+#define THIS_FILE	"libyuv_test.c"
+
+/* Same filter mode as the converter */
+#ifndef LIBYUV_FILTER_MODE
+#   define LIBYUV_FILTER_MODE	3
+#endif
+
+/* A picture and its planes */
+typedef struct picture
+{
+    pjmedia_video_apply_fmt_param	param;
+    pjmedia_frame			frame;
+} picture;
+
+static void init_picture(pj_pool_t *pool, pj_uint32_t fmt_id,
+			 unsigned w, unsigned h, picture *pic)
+{
+    const pjmedia_video_format_info *vfi;
+
+    vfi = pjmedia_get_video_format_info(NULL, fmt_id);
+
+    pj_bzero(pic, sizeof(*pic));
+    pic->param.size.w = w;
+    pic->param.size.h = h;
+    (*vfi->apply_fmt)(vfi, &pic->param);
+
+    pic->param.buffer = (pj_uint8_t*)pj_pool_alloc(pool,
+						   pic->param.framebytes);
+    (*vfi->apply_fmt)(vfi, &pic->param);
+
+    pic->frame.type = PJMEDIA_FRAME_TYPE_VIDEO;
+    pic->frame.buf = pic->param.buffer;
+    pic->frame.size = pic->param.framebytes;
+}
+
+/* Fill the picture with noise, so that a row converted from the wrong
+ * source rows shows.
+ */
+static void fill_picture(picture *pic)
+{
+    pj_size_t i;
+
+    pj_srand(pic->param.size.h);
+    for (i = 0; i < pic->param.framebytes; ++i)
+	pic->param.buffer[i] = (pj_uint8_t)(pj_rand() >> 4);
+}
+
+static pj_status_t create_converter(pj_pool_t *pool,
+				    pj_uint32_t src_id,
+				    const pjmedia_rect_size *src_size,
+				    pj_uint32_t dst_id,
+				    const pjmedia_rect_size *dst_size,
+				    pjmedia_converter **p_cv)
+{
+    pjmedia_conversion_param prm;
+
+    pjmedia_format_init_video(&prm.src, src_id, src_size->w, src_size->h,
+			      30, 1);
+    pjmedia_format_init_video(&prm.dst, dst_id, dst_size->w, dst_size->h,
+			      30, 1);
+
+    return pjmedia_converter_create(NULL, pool, &prm, p_cv);
+}
+
+/* The conversion of a large picture, which is sliced, must be the same as
+ * the conversion of the whole picture at once.
+ */
+static int slice_test(pj_pool_t *pool)
+{
+    pjmedia_rect_size size = { 1280, 720 };
+    pjmedia_converter *cv;
+    picture i420, bgra, out, ref;
+    pj_status_t status;
+
+    init_picture(pool, PJMEDIA_FORMAT_I420, size.w, size.h, &i420);
+    init_picture(pool, PJMEDIA_FORMAT_BGRA, size.w, size.h, &bgra);
+    fill_picture(&i420);
+
+    /* Planar to packed */
+    init_picture(pool, PJMEDIA_FORMAT_BGRA, size.w, size.h, &out);
+    if (create_converter(pool, PJMEDIA_FORMAT_I420, &size,
+			 PJMEDIA_FORMAT_BGRA, &size, &cv) != PJ_SUCCESS)
+    {
+	return -10;
+    }
+    status = pjmedia_converter_convert(cv, &i420.frame, &out.frame);
+    pjmedia_converter_destroy(cv);
+    if (status != PJ_SUCCESS)
+	return -20;
+
+    I420ToARGB(i420.param.planes[0], i420.param.strides[0],
+	       i420.param.planes[1], i420.param.strides[1],
+	       i420.param.planes[2], i420.param.strides[2],
+	       bgra.param.planes[0], bgra.param.strides[0],
+	       size.w, size.h);
+    if (pj_memcmp(out.param.buffer, bgra.param.buffer,
+		  bgra.param.framebytes) != 0)
+    {
+	return -30;
+    }
+
+    /* Packed to planar */
+    init_picture(pool, PJMEDIA_FORMAT_I420, size.w, size.h, &out);
+    init_picture(pool, PJMEDIA_FORMAT_I420, size.w, size.h, &ref);
+    if (create_converter(pool, PJMEDIA_FORMAT_BGRA, &size,
+			 PJMEDIA_FORMAT_I420, &size, &cv) != PJ_SUCCESS)
+    {
+	return -40;
+    }
+    status = pjmedia_converter_convert(cv, &bgra.frame, &out.frame);
+    pjmedia_converter_destroy(cv);
+    if (status != PJ_SUCCESS)
+	return -50;
+
+    ARGBToI420(bgra.param.planes[0], bgra.param.strides[0],
+	       ref.param.planes[0], ref.param.strides[0],
+	       ref.param.planes[1], ref.param.strides[1],
+	       ref.param.planes[2], ref.param.strides[2],
+	       size.w, size.h);
+    if (pj_memcmp(out.param.buffer, ref.param.buffer,
+		  ref.param.framebytes) != 0)
+    {
+	return -60;
+    }
+
+    return 0;
+}
+
+/* The scaled picture, done in bands or planes, must be the same as the
+ * whole picture scaled at once.
+ */
+static int scale_test(pj_pool_t *pool, pj_uint32_t fmt_id,
+		      const pjmedia_rect_size *src_size,
+		      const pjmedia_rect_size *dst_size)
+{
+    pjmedia_converter *cv;
+    picture src, dst, ref;
+    pj_status_t status;
+
+    init_picture(pool, fmt_id, src_size->w, src_size->h, &src);
+    init_picture(pool, fmt_id, dst_size->w, dst_size->h, &dst);
+    init_picture(pool, fmt_id, dst_size->w, dst_size->h, &ref);
+    fill_picture(&src);
+
+    if (create_converter(pool, fmt_id, src_size, fmt_id, dst_size,
+			 &cv) != PJ_SUCCESS)
+    {
+	return -110;
+    }
+
+    status = pjmedia_converter_convert(cv, &src.frame, &dst.frame);
+    pjmedia_converter_destroy(cv);
+    if (status != PJ_SUCCESS)
+	return -120;
+
+    if (fmt_id == PJMEDIA_FORMAT_I420) {
+	I420Scale(src.param.planes[0], src.param.strides[0],
+		  src.param.planes[1], src.param.strides[1],
+		  src.param.planes[2], src.param.strides[2],
+		  src_size->w, src_size->h,
+		  ref.param.planes[0], ref.param.strides[0],
+		  ref.param.planes[1], ref.param.strides[1],
+		  ref.param.planes[2], ref.param.strides[2],
+		  dst_size->w, dst_size->h,
+		  (enum FilterMode)LIBYUV_FILTER_MODE);
+    } else {
+	ARGBScale(src.param.planes[0], src.param.strides[0],
+		  src_size->w, src_size->h,
+		  ref.param.planes[0], ref.param.strides[0],
+		  dst_size->w, dst_size->h,
+		  (enum FilterMode)LIBYUV_FILTER_MODE);
+    }
+
+    if (pj_memcmp(dst.param.buffer, ref.param.buffer,
+		  ref.param.framebytes) != 0)
+    {
+	PJ_LOG(3,(THIS_FILE, "    %ux%u to %ux%u differs",
+		  src_size->w, src_size->h, dst_size->w, dst_size->h));
+	return -130;
+    }
+
+    return 0;
+}
+
+/* A destroyed converter is reused by the next converter with the same
+ * formats and sizes.
+ */
+static int cache_test(pj_pool_t *pool)
+{
+    pjmedia_rect_size size = { 640, 480 }, size2 = { 320, 240 };
+    pjmedia_converter *cv, *cv2, *cv3;
+    int rc = 0;
+
+    if (create_converter(pool, PJMEDIA_FORMAT_I420, &size,
+			 PJMEDIA_FORMAT_BGRA, &size, &cv) != PJ_SUCCESS)
+    {
+	return -210;
+    }
+    pjmedia_converter_destroy(cv);
+
+    /* Different size, a new converter */
+    if (create_converter(pool, PJMEDIA_FORMAT_I420, &size2,
+			 PJMEDIA_FORMAT_BGRA, &size2, &cv2) != PJ_SUCCESS)
+    {
+	return -220;
+    }
+    if (cv2 == cv && PJMEDIA_LIBYUV_CACHE_SIZE > 0)
+	rc = -230;
+
+    /* Same formats and size, the cached converter */
+    if (create_converter(pool, PJMEDIA_FORMAT_I420, &size,
+			 PJMEDIA_FORMAT_BGRA, &size, &cv3) != PJ_SUCCESS)
+    {
+	pjmedia_converter_destroy(cv2);
+	return -240;
+    }
+    if (cv3 != cv && PJMEDIA_LIBYUV_CACHE_SIZE > 0 && !rc)
+	rc = -250;
+
+    pjmedia_converter_destroy(cv3);
+    pjmedia_converter_destroy(cv2);
+    if (rc != 0)
+	return rc;
+
+    /* The converters of the slice test are in the cache too, they must
+     * still convert properly when reused.
+     */
+    return slice_test(pool);
+}
+
+int libyuv_test(void)
+{
+    pjmedia_rect_size vga = { 640, 480 }, hd = { 1280, 720 },
+		      cif = { 352, 288 };
+    pj_pool_t *pool;
+    int rc;
+
+    pool = pj_pool_create(mem, "libyuv", 4000, 4000, NULL);
+
+    PJ_LOG(3,(THIS_FILE, "  slice test"));
+    rc = slice_test(pool);
+    if (rc != 0)
+	goto on_return;
+
+    PJ_LOG(3,(THIS_FILE, "  scale test"));
+    rc = scale_test(pool, PJMEDIA_FORMAT_I420, &vga, &hd);
+    if (rc != 0)
+	goto on_return;
+    rc = scale_test(pool, PJMEDIA_FORMAT_I420, &hd, &vga);
+    if (rc != 0)
+	goto on_return;
+    rc = scale_test(pool, PJMEDIA_FORMAT_I420, &hd, &cif);
+    if (rc != 0)
+	goto on_return;
+    rc = scale_test(pool, PJMEDIA_FORMAT_BGRA, &vga, &hd);
+    if (rc != 0)
+	goto on_return;
+    rc = scale_test(pool, PJMEDIA_FORMAT_BGRA, &hd, &cif);
+    if (rc != 0)
+	goto on_return;
+
+    PJ_LOG(3,(THIS_FILE, "  cache test"));
+    rc = cache_test(pool);
+
+on_return:
+    pj_pool_release(pool);
+    return rc;
+}
+
+#endif	/* HAS_LIBYUV_TEST */
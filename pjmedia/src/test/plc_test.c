@@ -0,0 +1,176 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2011 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "test.h"
+
+#define THIS_FILE	"plc_test.c"
+
+/* Longest frame supported by pjmedia_plc_interpolate() */
+#define MAX_COUNT	960
+
+/* Periodic signal, the sample at position pos of the stream */
+static pj_int16_t periodic(unsigned pos, unsigned period)
+{
+    unsigned phase = pos % period;
+
+    /* Triangle wave */
+    if (phase < period / 2)
+	return (pj_int16_t)(phase * 16000 / period - 4000);
+    else
+	return (pj_int16_t)((period - phase) * 16000 / period - 4000);
+}
+
+/* A frame concealed perfectly, i.e: the continuation of the previous
+ * frames, is not modified when it is interpolated towards the next frame.
+ * This must hold for frames shorter than the pitch period range, where the
+ * longest searched period is clamped to half of the frame.
+ */
+static int continuity_test(unsigned clock_rate, unsigned count,
+			   unsigned period)
+{
+    pj_int16_t frame[MAX_COUNT], next[MAX_COUNT];
+    unsigned i;
+    pj_status_t status;
+
+    for (i = 0; i < count; ++i) {
+	frame[i] = periodic(i, period);
+	next[i] = periodic(count + i, period);
+    }
+
+    status = pjmedia_plc_interpolate(clock_rate, frame, next, count);
+    if (status != PJ_SUCCESS)
+	return -10;
+
+    for (i = 0; i < count; ++i) {
+	if (frame[i] != periodic(i, period)) {
+	    PJ_LOG(3,(THIS_FILE, "    %u Hz, %u samples: sample %u differs",
+		      clock_rate, count, i));
+	    return -20;
+	}
+    }
+
+    return 0;
+}
+
+/* A silent replacement frame fades in to the next frame at its end */
+static int fade_in_test(void)
+{
+    enum { COUNT = 160, PERIOD = 40 };
+    pj_int16_t frame[COUNT], next[COUNT];
+    int diff;
+    unsigned i;
+
+    for (i = 0; i < COUNT; ++i) {
+	frame[i] = 0;
+	next[i] = periodic(COUNT + i, PERIOD);
+    }
+
+    if (pjmedia_plc_interpolate(8000, frame, next, COUNT) != PJ_SUCCESS)
+	return -30;
+
+    /* Nothing to crossfade with before the last quarter */
+    for (i = 0; i < COUNT * 3 / 4; ++i) {
+	if (frame[i] != 0)
+	    return -40;
+    }
+
+    /* Last sample is almost the sample before the next frame */
+    diff = frame[COUNT-1] - periodic(COUNT-1, PERIOD);
+    if (diff < 0)
+	diff = -diff;
+    if (diff > 4000 / 4)
+	return -50;
+
+    return 0;
+}
+
+/* Frames that can't be interpolated are reported and left untouched */
+static int unsupported_test(void)
+{
+    static pj_int16_t frame[MAX_COUNT * 2], next[MAX_COUNT * 2];
+    unsigned i;
+
+    for (i = 0; i < PJ_ARRAY_SIZE(frame); ++i) {
+	frame[i] = 1000;
+	next[i] = periodic(i, 96);
+    }
+
+    /* 30 ms at 48 KHz */
+    if (pjmedia_plc_interpolate(48000, frame, next,
+				MAX_COUNT * 3 / 2) != PJ_ETOOBIG)
+    {
+	return -60;
+    }
+
+    /* Single sample */
+    if (pjmedia_plc_interpolate(8000, frame, next, 1) != PJ_ETOOSMALL)
+	return -70;
+
+    for (i = 0; i < PJ_ARRAY_SIZE(frame); ++i) {
+	if (frame[i] != 1000)
+	    return -80;
+    }
+
+    return 0;
+}
+
+int plc_test(void)
+{
+    int rc;
+
+    PJ_LOG(3,(THIS_FILE, "  interpolation continuity test"));
+
+    /* 20 ms frames at 200 Hz pitch */
+    rc = continuity_test(8000, 160, 40);
+    if (rc != 0)
+	return rc;
+    rc = continuity_test(16000, 320, 80);
+    if (rc != 0)
+	return rc;
+
+    /* 20 ms at 48 KHz with the longest frame */
+    rc = continuity_test(48000, MAX_COUNT, 240);
+    if (rc != 0)
+	return rc - 100;
+
+    /* Frames shorter than twice the longest pitch period: the period is
+     * clamped to half of the frame, even below the shortest period.
+     */
+    rc = continuity_test(8000, 80, 40);
+    if (rc != 0)
+	return rc - 200;
+    rc = continuity_test(48000, 160, 80);
+    if (rc != 0)
+	return rc - 300;
+    rc = continuity_test(8000, 8, 4);
+    if (rc != 0)
+	return rc - 400;
+
+    PJ_LOG(3,(THIS_FILE, "  interpolation fade in test"));
+    rc = fade_in_test();
+    if (rc != 0)
+	return rc;
+
+    PJ_LOG(3,(THIS_FILE, "  unsupported frames test"));
+    rc = unsupported_test();
+    if (rc != 0)
+	return rc;
+
+    return 0;
+}
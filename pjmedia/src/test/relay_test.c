@@ -0,0 +1,465 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2011 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "test.h"
+#include <pjmedia-codec.h>
+
+#define THIS_FILE	"relay_test.c"
+
+#define SPF		160
+#define PKT_CNT		8
+#define MAX_PKT		(PKT_CNT + 4)
+
+#define IN_SSRC		0x11223344
+#define IN_SEQ		65532		/* wraps around while relaying */
+#define IN_TS		0xFFFFFE00	/* wraps around too */
+#define A_SSRC		0x0A0A0A0A
+#define B_SSRC		0x0B0B0B0B
+#define B_SEQ		1000
+#define B_TS		50000
+#define PEER_LOST	7
+#define PEER_FRACT	64
+#define PEER_JITTER	100
+
+
+/* Media transport which keeps the packets sent by the stream, and lets
+ * the test give packets to the stream as if they were received.
+ */
+struct test_tp
+{
+    pjmedia_transport	 base;
+    void		*user_data;
+    void		(*rtp_cb)(void*, void*, pj_ssize_t);
+    void		(*rtcp_cb)(void*, void*, pj_ssize_t);
+    unsigned		 rtp_cnt;
+    pj_uint8_t		 rtp[MAX_PKT][PJMEDIA_MAX_MTU];
+    pj_size_t		 rtp_size[MAX_PKT];
+    pj_uint8_t		 rtcp[PJMEDIA_MAX_MTU];
+    pj_size_t		 rtcp_size;
+};
+
+static pj_status_t tp_get_info(pjmedia_transport *tp,
+			       pjmedia_transport_info *info)
+{
+    PJ_UNUSED_ARG(tp);
+    PJ_UNUSED_ARG(info);
+    return PJ_SUCCESS;
+}
+
+static pj_status_t tp_attach(pjmedia_transport *tp,
+			     void *user_data,
+			     const pj_sockaddr_t *rem_addr,
+			     const pj_sockaddr_t *rem_rtcp,
+			     unsigned addr_len,
+			     void (*rtp_cb)(void*, void*, pj_ssize_t),
+			     void (*rtcp_cb)(void*, void*, pj_ssize_t))
+{
+    struct test_tp *ttp = (struct test_tp*)tp;
+
+    PJ_UNUSED_ARG(rem_addr);
+    PJ_UNUSED_ARG(rem_rtcp);
+    PJ_UNUSED_ARG(addr_len);
+
+    ttp->user_data = user_data;
+    ttp->rtp_cb = rtp_cb;
+    ttp->rtcp_cb = rtcp_cb;
+    return PJ_SUCCESS;
+}
+
+static void tp_detach(pjmedia_transport *tp, void *user_data)
+{
+    struct test_tp *ttp = (struct test_tp*)tp;
+
+    PJ_UNUSED_ARG(user_data);
+    ttp->rtp_cb = NULL;
+    ttp->rtcp_cb = NULL;
+}
+
+static pj_status_t tp_send_rtp(pjmedia_transport *tp,
+			       const void *pkt,
+			       pj_size_t size)
+{
+    struct test_tp *ttp = (struct test_tp*)tp;
+
+    if (ttp->rtp_cnt < MAX_PKT && size <= PJMEDIA_MAX_MTU) {
+	pj_memcpy(ttp->rtp[ttp->rtp_cnt], pkt, size);
+	ttp->rtp_size[ttp->rtp_cnt++] = size;
+    }
+    return PJ_SUCCESS;
+}
+
+static pj_status_t tp_send_rtcp(pjmedia_transport *tp,
+				const void *pkt,
+				pj_size_t size)
+{
+    struct test_tp *ttp = (struct test_tp*)tp;
+
+    if (size <= PJMEDIA_MAX_MTU) {
+	pj_memcpy(ttp->rtcp, pkt, size);
+	ttp->rtcp_size = size;
+    }
+    return PJ_SUCCESS;
+}
+
+static pj_status_t tp_send_rtcp2(pjmedia_transport *tp,
+				 const pj_sockaddr_t *addr,
+				 unsigned addr_len,
+				 const void *pkt,
+				 pj_size_t size)
+{
+    PJ_UNUSED_ARG(addr);
+    PJ_UNUSED_ARG(addr_len);
+    return tp_send_rtcp(tp, pkt, size);
+}
+
+static pj_status_t tp_destroy(pjmedia_transport *tp)
+{
+    PJ_UNUSED_ARG(tp);
+    return PJ_SUCCESS;
+}
+
+static struct pjmedia_transport_op tp_op =
+{
+    &tp_get_info,
+    &tp_attach,
+    &tp_detach,
+    &tp_send_rtp,
+    &tp_send_rtcp,
+    &tp_send_rtcp2,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    &tp_destroy
+};
+
+static struct test_tp *create_tp(pj_pool_t *pool, const char *name)
+{
+    struct test_tp *ttp = PJ_POOL_ZALLOC_T(pool, struct test_tp);
+
+    pj_ansi_strcpy(ttp->base.name, name);
+    ttp->base.op = &tp_op;
+    ttp->base.type = PJMEDIA_TRANSPORT_TYPE_USER;
+    return ttp;
+}
+
+/* Give an RTP packet from the remote to the stream of the transport */
+static void rx_rtp(struct test_tp *ttp, unsigned idx)
+{
+    pj_uint8_t pkt[sizeof(pjmedia_rtp_hdr) + SPF];
+    pjmedia_rtp_hdr *hdr = (pjmedia_rtp_hdr*)pkt;
+
+    pj_bzero(hdr, sizeof(*hdr));
+    hdr->v = 2;
+    hdr->pt = PJMEDIA_RTP_PT_PCMU;
+    hdr->m = (idx == 0);
+    hdr->seq = pj_htons((pj_uint16_t)(IN_SEQ + idx));
+    hdr->ts = pj_htonl(IN_TS + idx * SPF);
+    hdr->ssrc = pj_htonl(IN_SSRC);
+    pj_memset(hdr + 1, idx, SPF);
+
+    (*ttp->rtp_cb)(ttp->user_data, pkt, sizeof(pkt));
+}
+
+/* Give an RTCP RR from the remote to the stream of the transport, with a
+ * report block about the stream's outgoing RTP.
+ */
+static void rx_rtcp_rr(struct test_tp *ttp, pj_uint32_t ssrc)
+{
+    pjmedia_rtcp_rr_pkt rr;
+
+    pj_bzero(&rr, sizeof(rr));
+    rr.common.version = 2;
+    rr.common.count = 1;
+    rr.common.pt = 201;
+    rr.common.length = pj_htons((pj_uint16_t)(sizeof(rr) / 4 - 1));
+    rr.common.ssrc = pj_htonl(IN_SSRC + 1);
+    rr.rr.ssrc = pj_htonl(ssrc);
+    rr.rr.fract_lost = PEER_FRACT;
+    rr.rr.total_lost_0 = PEER_LOST;
+    rr.rr.last_seq = pj_htonl(B_SEQ + PKT_CNT);
+    rr.rr.jitter = pj_htonl(PEER_JITTER);
+
+    (*ttp->rtcp_cb)(ttp->user_data, &rr, sizeof(rr));
+}
+
+static pj_status_t create_stream(pjmedia_endpt *endpt, pj_pool_t *pool,
+				 const pjmedia_codec_info *ci,
+				 pj_uint32_t ssrc,
+				 struct test_tp *ttp,
+				 pjmedia_stream **p_stream)
+{
+    pjmedia_stream_info si;
+    pj_status_t status;
+
+    pj_bzero(&si, sizeof(si));
+    si.type = PJMEDIA_TYPE_AUDIO;
+    si.proto = PJMEDIA_TP_PROTO_RTP_AVP;
+    si.dir = PJMEDIA_DIR_ENCODING_DECODING;
+    pj_sockaddr_in_init(&si.rem_addr.ipv4, NULL, 4000);
+    pj_sockaddr_in_init(&si.rem_rtcp.ipv4, NULL, 4001);
+    pj_memcpy(&si.fmt, ci, sizeof(pjmedia_codec_info));
+    si.tx_pt = ci->pt;
+    si.tx_event_pt = 101;
+    si.rx_event_pt = 101;
+    si.ssrc = ssrc;
+    si.rtp_seq_ts_set = 3;
+    si.rtp_seq = B_SEQ;
+    si.rtp_ts = B_TS;
+    si.jb_init = si.jb_min_pre = si.jb_max_pre = si.jb_max = -1;
+
+    status = pjmedia_stream_create(endpt, pool, &si, &ttp->base, NULL,
+				   p_stream);
+    if (status != PJ_SUCCESS)
+	return status;
+
+    return pjmedia_stream_start(*p_stream);
+}
+
+/* Find the report block in the SR/RR at the start of an RTCP packet */
+static const pjmedia_rtcp_rr *get_report(const struct test_tp *ttp,
+					 const pjmedia_rtcp_sr **sr)
+{
+    const pjmedia_rtcp_common *common =
+	(const pjmedia_rtcp_common*)ttp->rtcp;
+
+    *sr = NULL;
+    if (ttp->rtcp_size < sizeof(pjmedia_rtcp_rr_pkt) || common->count < 1)
+	return NULL;
+
+    if (common->pt == 200) {
+	if (ttp->rtcp_size < sizeof(pjmedia_rtcp_sr_pkt))
+	    return NULL;
+	*sr = &((const pjmedia_rtcp_sr_pkt*)ttp->rtcp)->sr;
+	return &((const pjmedia_rtcp_sr_pkt*)ttp->rtcp)->rr;
+    }
+    if (common->pt == 201)
+	return &((const pjmedia_rtcp_rr_pkt*)ttp->rtcp)->rr;
+
+    return NULL;
+}
+
+static int relay_test_imp(pj_pool_t *pool)
+{
+    pjmedia_endpt *endpt = NULL;
+    pjmedia_stream *sa = NULL, *sb = NULL;
+    struct test_tp *tpa, *tpb;
+    const pjmedia_codec_info *ci[1];
+    pjmedia_codec_param param;
+    const pjmedia_rtcp_rr *rr;
+    const pjmedia_rtcp_sr *sr;
+    pj_str_t codec_id = pj_str("pcmu");
+    pj_uint16_t first_seq = 0;
+    pj_uint32_t first_ts = 0, last_ts = 0, lost;
+    unsigned i, count = 1;
+    int rc = 0;
+
+    if (pjmedia_endpt_create(mem, NULL, 0, &endpt) != PJ_SUCCESS)
+	return -100;
+
+    if (pjmedia_codec_g711_init(endpt) != PJ_SUCCESS ||
+	pjmedia_codec_mgr_find_codecs_by_id(
+		pjmedia_endpt_get_codec_mgr(endpt), &codec_id, &count,
+		ci, NULL) != PJ_SUCCESS)
+    {
+	rc = -110;
+	goto on_return;
+    }
+
+    tpa = create_tp(pool, "relaytpA");
+    tpb = create_tp(pool, "relaytpB");
+
+    if (create_stream(endpt, pool, ci[0], A_SSRC, tpa, &sa) != PJ_SUCCESS ||
+	create_stream(endpt, pool, ci[0], B_SSRC, tpb, &sb) != PJ_SUCCESS)
+    {
+	rc = -120;
+	goto on_return;
+    }
+
+    /* Relay what stream A receives to the remote of stream B */
+    if (pjmedia_stream_set_relay(sa, sb) != PJ_SUCCESS) {
+	rc = -130;
+	goto on_return;
+    }
+
+    /* The remote of stream B reports the reception of the relayed RTP */
+    for (i = 0; i < PKT_CNT; ++i) {
+	if (i == PKT_CNT / 2)
+	    rx_rtcp_rr(tpb, B_SSRC);
+	rx_rtp(tpa, i);
+    }
+
+    if (tpb->rtp_cnt != PKT_CNT || tpa->rtp_cnt != 0) {
+	rc = -140;
+	goto on_return;
+    }
+
+    /* Relayed packets continue the outgoing RTP session of stream B */
+    for (i = 0; i < PKT_CNT; ++i) {
+	const pjmedia_rtp_hdr *hdr = (const pjmedia_rtp_hdr*)tpb->rtp[i];
+	const pj_uint8_t *payload = (const pj_uint8_t*)(hdr + 1);
+	pj_uint16_t seq = pj_ntohs(hdr->seq);
+	pj_uint32_t ts = pj_ntohl(hdr->ts);
+
+	if (i == 0) {
+	    first_seq = seq;
+	    first_ts = ts;
+	}
+	last_ts = ts;
+
+	if (tpb->rtp_size[i] != sizeof(pjmedia_rtp_hdr) + SPF ||
+	    pj_ntohl(hdr->ssrc) != B_SSRC ||
+	    hdr->pt != PJMEDIA_RTP_PT_PCMU ||
+	    payload[0] != i || payload[SPF-1] != i)
+	{
+	    rc = -150;
+	    goto on_return;
+	}
+	if (seq != (pj_uint16_t)(first_seq + i) ||
+	    ts != first_ts + i * SPF)
+	{
+	    rc = -160;
+	    goto on_return;
+	}
+    }
+    if (first_seq != (pj_uint16_t)(B_SEQ + 1) ||
+	first_ts - B_TS > SPF)
+    {
+	rc = -170;
+	goto on_return;
+    }
+
+    /* The RR sent by stream A to its remote includes the loss and jitter
+     * reported by the remote of stream B.
+     */
+    tpa->rtcp_size = 0;
+    pjmedia_stream_send_rtcp_sdes(sa);
+    rr = get_report(tpa, &sr);
+    if (!rr || pj_ntohl(rr->ssrc) != IN_SSRC) {
+	rc = -180;
+	goto on_return;
+    }
+    lost = (rr->total_lost_2 << 16) + (rr->total_lost_1 << 8) +
+	   rr->total_lost_0;
+    if (lost != PEER_LOST || rr->fract_lost != PEER_FRACT ||
+	pj_ntohl(rr->jitter) < PEER_JITTER)
+    {
+	rc = -190;
+	goto on_return;
+    }
+
+    /* The SR sent by stream B follows the relayed RTP timestamps */
+    tpb->rtcp_size = 0;
+    pjmedia_stream_send_rtcp_sdes(sb);
+    get_report(tpb, &sr);
+    if (!sr || pj_ntohl(sr->rtp_ts) - last_ts > 8000 ||
+	pj_ntohl(sr->sender_pcount) != PKT_CNT)
+    {
+	rc = -200;
+	goto on_return;
+    }
+
+    /* Once the relay is stopped, stream A decodes again */
+    if (pjmedia_stream_set_relay(sa, NULL) != PJ_SUCCESS) {
+	rc = -210;
+	goto on_return;
+    }
+    rx_rtp(tpa, PKT_CNT);
+    if (tpb->rtp_cnt != PKT_CNT) {
+	rc = -220;
+	goto on_return;
+    }
+
+    /* Destroying the peer stops the relay as well */
+    if (pjmedia_stream_set_relay(sa, sb) != PJ_SUCCESS) {
+	rc = -222;
+	goto on_return;
+    }
+    pjmedia_stream_destroy(sb);
+    sb = NULL;
+    rx_rtp(tpa, PKT_CNT + 1);
+    if (tpb->rtp_cnt != PKT_CNT) {
+	rc = -224;
+	goto on_return;
+    }
+
+    /* Streams with different codec parameters can't be relayed */
+    if (pjmedia_codec_mgr_get_default_param(
+		pjmedia_endpt_get_codec_mgr(endpt), ci[0],
+		&param) != PJ_SUCCESS)
+    {
+	rc = -230;
+	goto on_return;
+    }
+    {
+	pjmedia_stream_info si;
+
+	pj_bzero(&si, sizeof(si));
+	si.type = PJMEDIA_TYPE_AUDIO;
+	si.proto = PJMEDIA_TP_PROTO_RTP_AVP;
+	si.dir = PJMEDIA_DIR_ENCODING_DECODING;
+	pj_sockaddr_in_init(&si.rem_addr.ipv4, NULL, 4000);
+	pj_sockaddr_in_init(&si.rem_rtcp.ipv4, NULL, 4001);
+	pj_memcpy(&si.fmt, ci[0], sizeof(pjmedia_codec_info));
+	si.tx_pt = ci[0]->pt;
+	si.ssrc = B_SSRC;
+	si.jb_init = si.jb_min_pre = si.jb_max_pre = si.jb_max = -1;
+	param.setting.enc_fmtp.cnt = 1;
+	param.setting.enc_fmtp.param[0].name = pj_str("mode");
+	param.setting.enc_fmtp.param[0].val = pj_str("20");
+	si.param = &param;
+
+	if (pjmedia_stream_create(endpt, pool, &si, &tpb->base, NULL,
+				  &sb) != PJ_SUCCESS)
+	{
+	    rc = -240;
+	    goto on_return;
+	}
+    }
+    if (pjmedia_stream_set_relay(sa, sb) != PJMEDIA_ENOTCOMPATIBLE) {
+	rc = -250;
+	goto on_return;
+    }
+
+on_return:
+    if (sa) {
+	pjmedia_stream_set_relay(sa, NULL);
+	pjmedia_stream_destroy(sa);
+    }
+    if (sb)
+	pjmedia_stream_destroy(sb);
+    if (endpt)
+	pjmedia_endpt_destroy(endpt);
+    return rc;
+}
+
+int relay_test(void)
+{
+    pj_pool_t *pool;
+    int rc;
+
+    pool = pj_pool_create(mem, "relaytest", 4000, 4000, NULL);
+
+    PJ_LOG(3,(THIS_FILE, "  RTP relay test"));
+    rc = relay_test_imp(pool);
+
+    pj_pool_release(pool);
+    return rc;
+}
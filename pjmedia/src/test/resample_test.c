@@ -0,0 +1,274 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2011 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "test.h"
+#include <math.h>
+
+/*
+ * Compare the accuracy and speed of the built-in polyphase resampler
+ * against the resample backend the library is built with.
+ *
+ * The polyphase backend is compiled into this file (see the end of the
+ * file) under different function names, so both can be run side by side
+ * regardless of PJMEDIA_RESAMPLE_IMP. Each resampler converts a 1 kHz
+ * tone, and its accuracy is the SNR of the output against the best
+ * fitting 1 kHz sine, which doesn't depend on the filter delay.
+ */
+#define THIS_FILE	"resample_test.c"
+
+#define PTIME		20	/* Frame length, in msec		    */
+#define TONE_FREQ	1000
+#define TONE_AMPL	10000
+#define SNR_FRAMES	50	/* Frames to measure the SNR over	    */
+#define SKIP_FRAMES	5	/* Frames to skip for the filter delay	    */
+#define BENCH_FRAMES	2000	/* Frames to run for timing		    */
+
+/* Minimum SNR of the polyphase resampler, and how far below the
+ * library's backend it may be.
+ */
+#define MIN_SNR		60.0
+#define MAX_SNR_DROP	6.0
+
+#define HAS_LIB_RESAMPLE    (PJMEDIA_RESAMPLE_IMP != PJMEDIA_RESAMPLE_NONE)
+
+/* The polyphase backend, see the end of the file */
+static pj_status_t poly_resample_create(pj_pool_t *pool,
+					pj_bool_t high_quality,
+					pj_bool_t large_filter,
+					unsigned channel_count,
+					unsigned rate_in,
+					unsigned rate_out,
+					unsigned samples_per_frame,
+					pjmedia_resample **p_resample);
+static void poly_resample_run(pjmedia_resample *resample,
+			      const pj_int16_t *input,
+			      pj_int16_t *output);
+static unsigned poly_resample_get_input_size(pjmedia_resample *resample);
+static void poly_resample_destroy(pjmedia_resample *resample);
+
+typedef struct resampler
+{
+    const char	*name;
+    pj_status_t (*create)(pj_pool_t*, pj_bool_t, pj_bool_t, unsigned,
+			  unsigned, unsigned, unsigned, pjmedia_resample**);
+    void	(*run)(pjmedia_resample*, const pj_int16_t*, pj_int16_t*);
+    unsigned	(*get_input_size)(pjmedia_resample*);
+    void	(*destroy)(pjmedia_resample*);
+} resampler;
+
+static const resampler poly_resampler =
+{
+    "polyphase", &poly_resample_create, &poly_resample_run,
+    &poly_resample_get_input_size, &poly_resample_destroy
+};
+
+#if HAS_LIB_RESAMPLE
+static const resampler lib_resampler =
+{
+    "library", &pjmedia_resample_create, &pjmedia_resample_run,
+    &pjmedia_resample_get_input_size, &pjmedia_resample_destroy
+};
+#endif
+
+
+/* Generate the frame_idx'th frame of the test tone */
+static void gen_tone(pj_int16_t *frame, unsigned rate, unsigned spf,
+		     unsigned frame_idx)
+{
+    unsigned i;
+
+    for (i = 0; i < spf; ++i) {
+	double t = (double)(frame_idx * spf + i) / rate;
+	frame[i] = (pj_int16_t)(TONE_AMPL * sin(2 * PJ_PI * TONE_FREQ * t));
+    }
+}
+
+/* SNR of the signal against the best fitting tone, in dB */
+static double tone_snr(const pj_int16_t *sig, unsigned count, unsigned rate)
+{
+    double ss = 0, sc = 0, cc = 0, ys = 0, yc = 0;
+    double a, b, det, sig_pow = 0, err_pow = 0;
+    unsigned i;
+
+    /* Least squares fit of a*sin + b*cos */
+    for (i = 0; i < count; ++i) {
+	double w = 2 * PJ_PI * TONE_FREQ * i / rate;
+	double s = sin(w), c = cos(w);
+
+	ss += s * s;
+	sc += s * c;
+	cc += c * c;
+	ys += sig[i] * s;
+	yc += sig[i] * c;
+    }
+    det = ss * cc - sc * sc;
+    a = (ys * cc - yc * sc) / det;
+    b = (yc * ss - ys * sc) / det;
+
+    for (i = 0; i < count; ++i) {
+	double w = 2 * PJ_PI * TONE_FREQ * i / rate;
+	double fit = a * sin(w) + b * cos(w);
+
+	sig_pow += fit * fit;
+	err_pow += (sig[i] - fit) * (sig[i] - fit);
+    }
+
+    if (err_pow < 1e-9)
+	err_pow = 1e-9;
+    return 10 * log10(sig_pow / err_pow);
+}
+
+/* Convert the tone with the resampler, and return its SNR and the time
+ * to convert a frame in usec.
+ */
+static int measure(pj_pool_t *pool, const resampler *rs, pj_bool_t large,
+		   unsigned rate_in, unsigned rate_out,
+		   double *snr, double *usec)
+{
+    unsigned spf_in = rate_in * PTIME / 1000;
+    unsigned spf_out = rate_out * PTIME / 1000;
+    pjmedia_resample *resample;
+    pj_int16_t *in, *out;
+    pj_timestamp t0, t1;
+    unsigned i;
+    pj_status_t status;
+
+    status = (*rs->create)(pool, PJ_TRUE, large, 1, rate_in, rate_out,
+			   spf_in, &resample);
+    if (status != PJ_SUCCESS) {
+	app_perror(status, "   error creating resample");
+	return -10;
+    }
+    if ((*rs->get_input_size)(resample) != spf_in) {
+	(*rs->destroy)(resample);
+	return -11;
+    }
+
+    in = (pj_int16_t*) pj_pool_alloc(pool, spf_in * sizeof(pj_int16_t));
+    out = (pj_int16_t*) pj_pool_alloc(pool, spf_out * SNR_FRAMES *
+					    sizeof(pj_int16_t));
+
+    /* Accuracy */
+    for (i = 0; i < SKIP_FRAMES + SNR_FRAMES; ++i) {
+	gen_tone(in, rate_in, spf_in, i);
+	(*rs->run)(resample, in,
+		   out + (i < SKIP_FRAMES ? 0 : i - SKIP_FRAMES) * spf_out);
+    }
+    *snr = tone_snr(out, spf_out * SNR_FRAMES, rate_out);
+
+    /* Speed */
+    gen_tone(in, rate_in, spf_in, 0);
+    pj_get_timestamp(&t0);
+    for (i = 0; i < BENCH_FRAMES; ++i)
+	(*rs->run)(resample, in, out);
+    pj_get_timestamp(&t1);
+    *usec = (double)pj_elapsed_usec(&t0, &t1) / BENCH_FRAMES;
+
+    (*rs->destroy)(resample);
+    return 0;
+}
+
+int resample_test(void)
+{
+    static const struct
+    {
+	unsigned rate_in, rate_out;
+    } ratios[] =
+    {
+	{ 8000, 16000 },
+	{ 16000, 8000 },
+	{ 16000, 48000 },
+	{ 48000, 8000 },
+	{ 48000, 32000 },
+	{ 44100, 48000 },
+    };
+    pj_pool_t *pool;
+    unsigned i, large;
+    int rc = 0;
+
+    PJ_LOG(3,(THIS_FILE, "Testing polyphase resampler (1 kHz tone, "
+			 "usec per %d ms frame, SNR):", PTIME));
+
+    pool = pj_pool_create(mem, "resample", 4000, 4000, NULL);
+
+    for (large = 0; large < 2 && rc == 0; ++large) {
+	for (i = 0; i < PJ_ARRAY_SIZE(ratios) && rc == 0; ++i) {
+	    unsigned rate_in = ratios[i].rate_in;
+	    unsigned rate_out = ratios[i].rate_out;
+	    double poly_snr, poly_usec;
+
+	    rc = measure(pool, &poly_resampler, large, rate_in, rate_out,
+			 &poly_snr, &poly_usec);
+	    if (rc != 0)
+		break;
+
+#if HAS_LIB_RESAMPLE
+	    {
+		double lib_snr, lib_usec;
+
+		rc = measure(pool, &lib_resampler, large, rate_in, rate_out,
+			     &lib_snr, &lib_usec);
+		if (rc != 0)
+		    break;
+
+		PJ_LOG(3,(THIS_FILE, "  %s filter %5u -> %5u: "
+			  "library %7.1f us %5.1f dB, "
+			  "polyphase %7.1f us %5.1f dB",
+			  (large ? "large" : "small"), rate_in, rate_out,
+			  lib_usec, lib_snr, poly_usec, poly_snr));
+
+		if (poly_snr < lib_snr - MAX_SNR_DROP)
+		    rc = -20;
+	    }
+#else
+	    PJ_LOG(3,(THIS_FILE, "  %s filter %5u -> %5u: "
+		      "polyphase %7.1f us %5.1f dB",
+		      (large ? "large" : "small"), rate_in, rate_out,
+		      poly_usec, poly_snr));
+#endif
+
+	    if (poly_snr < MIN_SNR)
+		rc = -30;
+	}
+    }
+
+    pj_pool_release(pool);
+
+    if (rc != 0)
+	PJ_LOG(3,(THIS_FILE, "  error: polyphase resampler is not accurate "
+			     "enough"));
+    return rc;
+}
+
+
+/*
+ * Build the polyphase backend into this file, with the names changed so
+ * that they don't clash with the library's backend.
+ */
+#undef PJMEDIA_RESAMPLE_IMP
+#define PJMEDIA_RESAMPLE_IMP		PJMEDIA_RESAMPLE_POLYPHASE
+#define pjmedia_resample_create		poly_resample_create
+#define pjmedia_resample_run		poly_resample_run
+#define pjmedia_resample_get_input_size	poly_resample_get_input_size
+#define pjmedia_resample_destroy	poly_resample_destroy
+#undef PJ_DEF
+#define PJ_DEF(type)			static type
+#undef THIS_FILE
+
+#include "../pjmedia/resample_polyphase.c"
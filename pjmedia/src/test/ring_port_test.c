@@ -0,0 +1,279 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2011 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "test.h"
+
+#define THIS_FILE	"ring_port_test.c"
+
+#define CLOCK_RATE	8000
+#define SPF		160
+#define THREAD_FRAMES	20000
+
+/* Maximum difference between the channels of the stereo drift test */
+#define MAX_CH_DIFF	200
+
+
+static void fill_frame(pjmedia_frame *frame, pj_int16_t *buf, pj_int16_t val)
+{
+    unsigned i;
+
+    for (i = 0; i < SPF; ++i)
+	buf[i] = val;
+
+    frame->type = PJMEDIA_FRAME_TYPE_AUDIO;
+    frame->buf = buf;
+    frame->size = SPF * 2;
+}
+
+/* Basic FIFO, overflow and underflow behavior without drift compensation */
+static int fifo_test(pj_pool_t *pool)
+{
+    pjmedia_port *ring;
+    pjmedia_frame frame;
+    pjmedia_ring_port_stat stat;
+    pj_int16_t buf[SPF];
+    unsigned i;
+    pj_status_t status;
+
+    status = pjmedia_ring_port_create(pool, NULL, CLOCK_RATE, 1, SPF, 16, 3,
+				      PJMEDIA_RING_PORT_NO_DRIFT_COMP,
+				      &ring);
+    if (status != PJ_SUCCESS)
+	return -10;
+
+    for (i = 1; i <= 4; ++i) {
+	fill_frame(&frame, buf, (pj_int16_t)i);
+	pjmedia_port_put_frame(ring, &frame);
+    }
+    if (pjmedia_ring_port_get_level(ring) != 3)
+	return -20;
+
+    for (i = 1; i <= 4; ++i) {
+	fill_frame(&frame, buf, -1);
+	pjmedia_port_get_frame(ring, &frame);
+	if (frame.type != PJMEDIA_FRAME_TYPE_AUDIO || frame.size != SPF*2)
+	    return -30;
+	/* The fourth frame was dropped and the last get is silence */
+	if (buf[0] != (i < 4 ? (pj_int16_t)i : 0) || buf[SPF-1] != buf[0])
+	    return -40;
+    }
+
+    pjmedia_ring_port_get_stat(ring, &stat);
+    if (stat.level != 0 || stat.put_cnt != 3 || stat.get_cnt != 4 ||
+	stat.overflow_cnt != 1 || stat.underflow_cnt != 1)
+    {
+	return -50;
+    }
+
+    pjmedia_port_destroy(ring);
+    return 0;
+}
+
+
+static int producer_thread(void *arg)
+{
+    pjmedia_port *ring = (pjmedia_port*)arg;
+    pjmedia_frame frame;
+    pj_int16_t buf[SPF];
+    unsigned seq = 0;
+
+    while (seq < THREAD_FRAMES) {
+	if (pjmedia_ring_port_get_level(ring) >= 4) {
+	    pj_thread_sleep(0);
+	    continue;
+	}
+	fill_frame(&frame, buf, (pj_int16_t)(seq & 0x7FFF));
+	pjmedia_port_put_frame(ring, &frame);
+	++seq;
+    }
+
+    return 0;
+}
+
+/* One producer thread and one consumer thread, every frame must arrive
+ * intact and in order.
+ */
+static int thread_test(pj_pool_t *pool)
+{
+    pjmedia_port *ring;
+    pj_thread_t *thread;
+    pjmedia_frame frame;
+    pj_int16_t buf[SPF];
+    unsigned seq = 0;
+    int rc = 0;
+    pj_status_t status;
+
+    status = pjmedia_ring_port_create(pool, NULL, CLOCK_RATE, 1, SPF, 16, 4,
+				      PJMEDIA_RING_PORT_NO_DRIFT_COMP,
+				      &ring);
+    if (status != PJ_SUCCESS)
+	return -110;
+
+    status = pj_thread_create(pool, "ringprod", &producer_thread, ring,
+			      0, 0, &thread);
+    if (status != PJ_SUCCESS)
+	return -120;
+
+    while (seq < THREAD_FRAMES) {
+	unsigned i;
+
+	if (pjmedia_ring_port_get_level(ring) == 0) {
+	    pj_thread_sleep(0);
+	    continue;
+	}
+
+	frame.buf = buf;
+	frame.size = sizeof(buf);
+	pjmedia_port_get_frame(ring, &frame);
+	for (i = 0; i < SPF; ++i) {
+	    if (buf[i] != (pj_int16_t)(seq & 0x7FFF)) {
+		PJ_LOG(3,(THIS_FILE, "  error: frame %u sample %u is %d",
+			  seq, i, buf[i]));
+		rc = -130;
+		break;
+	    }
+	}
+	if (rc)
+	    break;
+	++seq;
+    }
+
+    pj_thread_join(thread);
+    pj_thread_destroy(thread);
+    pjmedia_port_destroy(ring);
+
+    return rc;
+}
+
+
+/* Noise-like signal of the drift test, so that the pitch search of WSOLA
+ * may match a sample of one channel with a sample of the other.
+ */
+static pj_int16_t drift_sample(unsigned pos)
+{
+    return (pj_int16_t)(((pos * 2654435761U) >> 16) % 16000 - 8000);
+}
+
+/* The producer runs 5% faster than the consumer, drift compensation must
+ * keep the ring from overflowing. With stereo, both channels carry the
+ * same signal, which must stay in step after shrinking and expanding.
+ */
+static int drift_test(pj_pool_t *pool, unsigned channel_count)
+{
+    pjmedia_port *ring;
+    pjmedia_frame frame;
+    pjmedia_ring_port_stat stat;
+    pj_int16_t buf[SPF * 2];
+    unsigned spf = SPF * channel_count;
+    unsigned i, j, k;
+    pj_status_t status;
+
+    status = pjmedia_ring_port_create(pool, NULL, CLOCK_RATE, channel_count,
+				      spf, 16, 16, 0, &ring);
+    if (status != PJ_SUCCESS)
+	return -210;
+
+    /* Nothing buffered yet, consumer gets synthesized audio */
+    frame.buf = buf;
+    frame.size = spf * 2;
+    pjmedia_port_get_frame(ring, &frame);
+    if (frame.type != PJMEDIA_FRAME_TYPE_AUDIO || frame.size != spf * 2)
+	return -220;
+
+    for (i = 0; i < 2000; ++i) {
+	unsigned put_cnt = (i % 20 == 0) ? 2 : 1;
+
+	for (j = 0; j < put_cnt; ++j) {
+	    for (k = 0; k < spf; ++k) {
+		unsigned pos = (i * spf + k) / channel_count;
+		buf[k] = drift_sample(pos);
+	    }
+	    frame.type = PJMEDIA_FRAME_TYPE_AUDIO;
+	    frame.buf = buf;
+	    frame.size = spf * 2;
+	    pjmedia_port_put_frame(ring, &frame);
+	}
+
+	frame.buf = buf;
+	frame.size = spf * 2;
+	pjmedia_port_get_frame(ring, &frame);
+
+	/* Fading changes the gain on every sample, which is far less than
+	 * the difference between two sampling instants.
+	 */
+	for (k = 0; k + 1 < spf && channel_count == 2; k += 2) {
+	    int diff = buf[k] - buf[k+1];
+
+	    if (diff < -MAX_CH_DIFF || diff > MAX_CH_DIFF) {
+		PJ_LOG(3,(THIS_FILE, "  channels differ in frame %u", i));
+		pjmedia_port_destroy(ring);
+		return -260;
+	    }
+	}
+    }
+
+    pjmedia_ring_port_get_stat(ring, &stat);
+    PJ_LOG(3,(THIS_FILE, "  drift: level=%u overflow=%u underflow=%u "
+			 "shrink=%u samples expand=%u frames",
+	      stat.level, stat.overflow_cnt, stat.underflow_cnt,
+	      stat.shrink_samples, stat.expand_frames));
+
+    if (stat.overflow_cnt != 0 || stat.underflow_cnt != 0)
+	return -230;
+    if (stat.shrink_samples == 0 || stat.expand_frames == 0)
+	return -240;
+    if (stat.level > 12)
+	return -250;
+
+    pjmedia_port_destroy(ring);
+    return 0;
+}
+
+
+int ring_port_test(void)
+{
+    pj_pool_t *pool;
+    int rc;
+
+    pool = pj_pool_create(mem, "ringtest", 4000, 4000, NULL);
+
+    PJ_LOG(3,(THIS_FILE, "  fifo test"));
+    rc = fifo_test(pool);
+    if (rc != 0)
+	goto on_return;
+
+    PJ_LOG(3,(THIS_FILE, "  producer/consumer thread test"));
+    rc = thread_test(pool);
+    if (rc != 0)
+	goto on_return;
+
+    PJ_LOG(3,(THIS_FILE, "  drift compensation test"));
+    rc = drift_test(pool, 1);
+    if (rc != 0)
+	goto on_return;
+
+    PJ_LOG(3,(THIS_FILE, "  stereo drift compensation test"));
+    rc = drift_test(pool, 2);
+    if (rc != 0)
+	rc -= 100;
+
+on_return:
+    pj_pool_release(pool);
+    return rc;
+}
@@ -0,0 +1,194 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2011 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "test.h"
+
+#define THIS_FILE	"signal_test.c"
+
+#define MAX_COUNT	80
+#define ROUNDS		200
+#define BENCH_SPF	160
+#define BENCH_LOOP	20000
+
+
+/* Straightforward implementations, as the loops used to be */
+static pj_uint32_t ref_sum_abs(const pj_int16_t *s, unsigned count)
+{
+    pj_uint32_t sum = 0;
+    unsigned i;
+
+    for (i=0; i<count; ++i)
+	sum += (s[i] < 0) ? -s[i] : s[i];
+    return sum;
+}
+
+static pj_uint32_t ref_gain(pj_int16_t *dst, const pj_int32_t *src,
+			    unsigned count, unsigned gain)
+{
+    unsigned i;
+
+    for (i=0; i<count; ++i) {
+	pj_int64_t val = ((pj_int64_t)src[i] * gain) >> 12;
+
+	if (val > 32767) val = 32767;
+	else if (val < -32768) val = -32768;
+	dst[i] = (pj_int16_t)val;
+    }
+    return ref_sum_abs(dst, count);
+}
+
+static pj_int16_t rand_sample(void)
+{
+    switch (pj_rand() % 8) {
+    case 0:
+	return -32768;
+    case 1:
+	return 32767;
+    default:
+	return (pj_int16_t)(pj_rand() & 0xFFFF);
+    }
+}
+
+/* Compare the functions with the reference, for all block lengths up to
+ * MAX_COUNT at every alignment, random signals and a range of gains.
+ */
+static int compare_test(void)
+{
+    static const unsigned gains[] = { 0, 1, 2048, PJMEDIA_SIGNAL_GAIN_UNITY,
+				      8160, 0x7FFF, 0x8000, 40000 };
+    pj_int16_t in[MAX_COUNT+1], out[MAX_COUNT+1], ref[MAX_COUNT+1];
+    pj_int32_t in32[MAX_COUNT+1], buf32[MAX_COUNT+1];
+    unsigned r;
+
+    for (r=0; r<ROUNDS; ++r) {
+	unsigned count = r % (MAX_COUNT + 1);
+	unsigned off = (r / (MAX_COUNT + 1)) & 1;
+	unsigned g, i;
+
+	for (i=0; i<count+off; ++i) {
+	    in[i] = rand_sample();
+	    in32[i] = (pj_int32_t)(pj_rand() % (1 << 24)) - (1 << 23);
+	    if (pj_rand() % 4 == 0)
+		in32[i] = in[i];
+	}
+
+	if (pjmedia_signal_sum_abs(in+off, count) !=
+	    ref_sum_abs(in+off, count))
+	{
+	    PJ_LOG(3,(THIS_FILE, "  error: sum_abs mismatch, count=%u",
+		      count));
+	    return -10;
+	}
+
+	for (g=0; g<PJ_ARRAY_SIZE(gains); ++g) {
+	    pj_uint32_t sum, ref_sum;
+
+	    /* 16-bit samples, in place */
+	    for (i=0; i<count+off; ++i)
+		buf32[i] = out[i] = in[i];
+	    ref_sum = ref_gain(ref, buf32+off, count, gains[g]);
+	    sum = pjmedia_signal_apply_gain(out+off, count, gains[g]);
+	    if (sum != ref_sum ||
+		pj_memcmp(out+off, ref, count*sizeof(ref[0])) != 0)
+	    {
+		PJ_LOG(3,(THIS_FILE, "  error: apply_gain mismatch, count=%u "
+			  "gain=%u", count, gains[g]));
+		return -20;
+	    }
+
+	    /* 32-bit samples, into a separate buffer */
+	    ref_sum = ref_gain(ref, in32+off, count, gains[g]);
+	    sum = pjmedia_signal_apply_gain32(out+off, in32+off, count,
+					      gains[g]);
+	    if (sum != ref_sum ||
+		pj_memcmp(out+off, ref, count*sizeof(ref[0])) != 0)
+	    {
+		PJ_LOG(3,(THIS_FILE, "  error: apply_gain32 mismatch, "
+			  "count=%u gain=%u", count, gains[g]));
+		return -30;
+	    }
+
+	    /* 32-bit samples, converted in place as the conference does */
+	    pj_memcpy(buf32, in32, sizeof(buf32));
+	    sum = pjmedia_signal_apply_gain32((pj_int16_t*)(buf32+off),
+					      buf32+off, count, gains[g]);
+	    if (sum != ref_sum ||
+		pj_memcmp(buf32+off, ref, count*sizeof(ref[0])) != 0)
+	    {
+		PJ_LOG(3,(THIS_FILE, "  error: in place apply_gain32 "
+			  "mismatch, count=%u gain=%u", count, gains[g]));
+		return -40;
+	    }
+	}
+    }
+
+    return 0;
+}
+
+/* Compare the speed of level metering and gain with the plain loops */
+static int bench_test(void)
+{
+    pj_int16_t frm[BENCH_SPF], out[BENCH_SPF];
+    pj_int32_t frm32[BENCH_SPF];
+    pj_timestamp t0, t1, t2;
+    pj_uint32_t chk0 = 0, chk1 = 0, usec0, usec1;
+    unsigned i, j;
+
+    for (i=0; i<BENCH_SPF; ++i) {
+	frm[i] = (pj_int16_t)((pj_rand() % 20000) - 10000);
+	frm32[i] = frm[i] * 3;
+    }
+
+    pj_get_timestamp(&t0);
+    for (j=0; j<BENCH_LOOP; ++j) {
+	chk0 += ref_sum_abs(frm, BENCH_SPF);
+	chk0 += ref_gain(out, frm32, BENCH_SPF, 3000);
+    }
+    pj_get_timestamp(&t1);
+    for (j=0; j<BENCH_LOOP; ++j) {
+	chk1 += pjmedia_signal_sum_abs(frm, BENCH_SPF);
+	chk1 += pjmedia_signal_apply_gain32(out, frm32, BENCH_SPF, 3000);
+    }
+    pj_get_timestamp(&t2);
+
+    if (chk0 != chk1) {
+	PJ_LOG(3,(THIS_FILE, "  error: benchmark checksum mismatch"));
+	return -50;
+    }
+
+    usec0 = pj_elapsed_usec(&t0, &t1);
+    usec1 = pj_elapsed_usec(&t1, &t2);
+    PJ_LOG(3,(THIS_FILE, "  level+gain of %u frames: plain %u usec, "
+	      "pjmedia_signal %u usec", BENCH_LOOP, usec0, usec1));
+
+    return 0;
+}
+
+int signal_test(void)
+{
+    int rc;
+
+    PJ_LOG(3,(THIS_FILE, "Testing signal level and gain functions.."));
+
+    rc = compare_test();
+    if (rc != 0)
+	return rc;
+
+    return bench_test();
+}
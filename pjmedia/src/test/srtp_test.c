@@ -0,0 +1,430 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2011 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "test.h"
+
+#define THIS_FILE	"srtp_test.c"
+
+#define PKT_CNT		20000
+#define PAYLOAD_LEN	160	/* 20 ms of G.711 */
+#define MAX_PKT_LEN	(sizeof(pjmedia_rtp_hdr) + PAYLOAD_LEN + 32)
+#define SESSION_CNT	8
+#define BATCH_PKT_CNT	16	/* Packets of a session in a batch */
+#define RTCP_LEN	8
+
+#if PJMEDIA_SRTP_HAS_OPENSSL
+#   define BACKEND	"OpenSSL"
+#else
+#   define BACKEND	"built-in"
+#endif
+
+
+/* The SRTP packets sent to the loop transport */
+typedef struct capture
+{
+    char	    (*pkt)[MAX_PKT_LEN];
+    int		     *len;
+    unsigned	      cnt;
+} capture;
+
+
+static void capture_rtp(void *user_data, void *pkt, pj_ssize_t size)
+{
+    capture *cap = (capture*) user_data;
+
+    if (cap->cnt < PKT_CNT && size <= (pj_ssize_t)MAX_PKT_LEN) {
+	pj_memcpy(cap->pkt[cap->cnt], pkt, size);
+	cap->len[cap->cnt] = (int)size;
+	++cap->cnt;
+    }
+}
+
+static void capture_rtcp(void *user_data, void *pkt, pj_ssize_t size)
+{
+    PJ_UNUSED_ARG(user_data);
+    PJ_UNUSED_ARG(pkt);
+    PJ_UNUSED_ARG(size);
+}
+
+static void srtp_rx_rtp(void *user_data, void *pkt, pj_ssize_t size)
+{
+    PJ_UNUSED_ARG(user_data);
+    PJ_UNUSED_ARG(pkt);
+    PJ_UNUSED_ARG(size);
+}
+
+/* Send one RTP packet with the payload */
+static void send_rtp(pjmedia_transport *tp, pjmedia_rtp_session *rtp,
+		     const pj_uint8_t *payload)
+{
+    char pkt[MAX_PKT_LEN];
+    const void *hdr;
+    int hdr_len;
+
+    pjmedia_rtp_encode_rtp(rtp, 0, 0, PAYLOAD_LEN, PAYLOAD_LEN, &hdr,
+			   &hdr_len);
+    pj_memcpy(pkt, hdr, hdr_len);
+    pj_memcpy(pkt + hdr_len, payload, PAYLOAD_LEN);
+    pjmedia_transport_send_rtp(tp, pkt, hdr_len + PAYLOAD_LEN);
+}
+
+static unsigned get_pps(unsigned cnt, const pj_timestamp *t1,
+			const pj_timestamp *t2)
+{
+    pj_uint32_t usec = pj_elapsed_usec(t1, t2);
+
+    if (usec == 0)
+	usec = 1;
+    return (unsigned)((pj_uint64_t)cnt * 1000000 / usec);
+}
+
+
+/* Protect packets with the SRTP transport, then unprotect them with the
+ * same transport, and report the packet rates of both.
+ */
+static int perf_test(pj_pool_t *pool, pjmedia_endpt *endpt,
+		     const char *crypto_name)
+{
+    pjmedia_transport *loop = NULL, *srtp = NULL;
+    pjmedia_srtp_setting opt;
+    pjmedia_srtp_crypto crypto;
+    pjmedia_rtp_session rtp;
+    pj_sockaddr_in addr;
+    capture cap;
+    pj_uint8_t payload[PAYLOAD_LEN];
+    pj_timestamp t1, t2;
+    unsigned i, protect_pps, unprotect_pps;
+    int rc = 0;
+    pj_status_t status;
+
+    cap.pkt = (char(*)[MAX_PKT_LEN]) pj_pool_alloc(pool,
+						    PKT_CNT * MAX_PKT_LEN);
+    cap.len = (int*) pj_pool_calloc(pool, PKT_CNT, sizeof(int));
+    cap.cnt = 0;
+
+    for (i = 0; i < PAYLOAD_LEN; ++i)
+	payload[i] = (pj_uint8_t)(i * 7 + 1);
+
+    status = pjmedia_transport_loop_create(endpt, &loop);
+    if (status != PJ_SUCCESS)
+	return -10;
+
+    pjmedia_srtp_setting_default(&opt);
+    opt.close_member_tp = PJ_TRUE;
+    opt.use = PJMEDIA_SRTP_MANDATORY;
+    status = pjmedia_transport_srtp_create(endpt, loop, &opt, &srtp);
+    if (status != PJ_SUCCESS) {
+	rc = -20;
+	goto on_return;
+    }
+
+    /* Encrypt and decrypt with the same key */
+    pj_bzero(&crypto, sizeof(crypto));
+    crypto.key = pj_str("123456789012345678901234567890");
+    crypto.name = pj_str((char*)crypto_name);
+    status = pjmedia_transport_srtp_start(srtp, &crypto, &crypto);
+    if (status != PJ_SUCCESS) {
+	rc = -30;
+	goto on_return;
+    }
+
+    pj_sockaddr_in_init(&addr, NULL, 4000);
+    status = pjmedia_transport_attach(srtp, NULL, &addr, &addr, sizeof(addr),
+				      &srtp_rx_rtp, &capture_rtcp);
+    if (status == PJ_SUCCESS) {
+	status = pjmedia_transport_attach(loop, &cap, &addr, &addr,
+					  sizeof(addr), &capture_rtp,
+					  &capture_rtcp);
+    }
+    if (status != PJ_SUCCESS) {
+	rc = -40;
+	goto on_return;
+    }
+
+    /* The packets are unprotected below, not by the loop */
+    pjmedia_transport_loop_disable_rx(loop, srtp, PJ_TRUE);
+
+    pjmedia_rtp_session_init(&rtp, 0, 0x1234);
+
+    /* Protect */
+    pj_get_timestamp(&t1);
+    for (i = 0; i < PKT_CNT; ++i)
+	send_rtp(srtp, &rtp, payload);
+    pj_get_timestamp(&t2);
+    protect_pps = get_pps(PKT_CNT, &t1, &t2);
+
+    if (cap.cnt != PKT_CNT ||
+	pj_memcmp(cap.pkt[0] + sizeof(pjmedia_rtp_hdr), payload,
+		  PAYLOAD_LEN) == 0)
+    {
+	rc = -50;
+	goto on_return;
+    }
+
+    /* Unprotect */
+    pj_get_timestamp(&t1);
+    for (i = 0; i < PKT_CNT; ++i) {
+	status = pjmedia_transport_srtp_decrypt_pkt(srtp, PJ_TRUE,
+						    cap.pkt[i], &cap.len[i]);
+	if (status != PJ_SUCCESS)
+	    break;
+    }
+    pj_get_timestamp(&t2);
+    unprotect_pps = get_pps(PKT_CNT, &t1, &t2);
+
+    if (status != PJ_SUCCESS) {
+	app_perror(status, "    unprotect error");
+	rc = -60;
+	goto on_return;
+    }
+
+    for (i = 0; i < PKT_CNT; ++i) {
+	if (cap.len[i] != (int)(sizeof(pjmedia_rtp_hdr) + PAYLOAD_LEN) ||
+	    pj_memcmp(cap.pkt[i] + sizeof(pjmedia_rtp_hdr), payload,
+		      PAYLOAD_LEN) != 0)
+	{
+	    rc = -70;
+	    goto on_return;
+	}
+    }
+
+    PJ_LOG(3,(THIS_FILE, "    %s (%s): protect %u pkt/s, unprotect %u pkt/s",
+	      crypto_name, BACKEND, protect_pps, unprotect_pps));
+
+    /* A modified packet must fail the authentication */
+    if (pj_ansi_strstr(crypto_name, "HMAC")) {
+	int len;
+
+	cap.cnt = 0;
+	send_rtp(srtp, &rtp, payload);
+	if (cap.cnt != 1) {
+	    rc = -80;
+	    goto on_return;
+	}
+	cap.pkt[0][sizeof(pjmedia_rtp_hdr)] ^= 0x01;
+	len = cap.len[0];
+	status = pjmedia_transport_srtp_decrypt_pkt(srtp, PJ_TRUE,
+						    cap.pkt[0], &len);
+	if (status == PJ_SUCCESS) {
+	    rc = -90;
+	    goto on_return;
+	}
+    }
+
+on_return:
+    if (srtp)
+	pjmedia_transport_close(srtp);
+    else if (loop)
+	pjmedia_transport_close(loop);
+    return rc;
+}
+
+
+/* Protect and unprotect packets of many sessions with the vector API */
+static int batch_test(pj_pool_t *pool, pjmedia_endpt *endpt)
+{
+    enum { BATCH = SESSION_CNT * (BATCH_PKT_CNT + 1) };
+    pjmedia_transport *srtp[SESSION_CNT];
+    pjmedia_rtp_session rtp[SESSION_CNT];
+    pjmedia_srtp_pkt *pkts;
+    char (*buf)[MAX_PKT_LEN];
+    pj_uint8_t payload[PAYLOAD_LEN];
+    pj_timestamp protect_time, unprotect_time, zero, t1, t2;
+    unsigned i, j, n, total = 0;
+    int rc = 0;
+    pj_status_t status;
+
+    pj_bzero(srtp, sizeof(srtp));
+    pkts = (pjmedia_srtp_pkt*) pj_pool_calloc(pool, BATCH, sizeof(*pkts));
+    buf = (char(*)[MAX_PKT_LEN]) pj_pool_alloc(pool, BATCH * MAX_PKT_LEN);
+    protect_time.u64 = unprotect_time.u64 = zero.u64 = 0;
+
+    for (i = 0; i < PAYLOAD_LEN; ++i)
+	payload[i] = (pj_uint8_t)(i * 3 + 5);
+
+    for (i = 0; i < SESSION_CNT; ++i) {
+	pjmedia_transport *loop;
+	pjmedia_srtp_setting opt;
+	pjmedia_srtp_crypto crypto;
+	char key[31];
+
+	status = pjmedia_transport_loop_create(endpt, &loop);
+	if (status != PJ_SUCCESS) {
+	    rc = -200;
+	    goto on_return;
+	}
+
+	pjmedia_srtp_setting_default(&opt);
+	opt.close_member_tp = PJ_TRUE;
+	opt.use = PJMEDIA_SRTP_MANDATORY;
+	status = pjmedia_transport_srtp_create(endpt, loop, &opt, &srtp[i]);
+	if (status != PJ_SUCCESS) {
+	    pjmedia_transport_close(loop);
+	    rc = -210;
+	    goto on_return;
+	}
+
+	/* Each session has its own key */
+	pj_ansi_snprintf(key, sizeof(key), "%030u", i * 1234567 + 1);
+	pj_bzero(&crypto, sizeof(crypto));
+	crypto.key = pj_str(key);
+	crypto.name = pj_str("AES_CM_128_HMAC_SHA1_80");
+	status = pjmedia_transport_srtp_start(srtp[i], &crypto, &crypto);
+	if (status != PJ_SUCCESS) {
+	    rc = -220;
+	    goto on_return;
+	}
+
+	pjmedia_rtp_session_init(&rtp[i], 0, 0x1000 + i);
+    }
+
+    while (total < PKT_CNT) {
+	/* Build the batch: the RTP packets of each session, then an RTCP
+	 * packet, so each session is a single run.
+	 */
+	for (i = 0, n = 0; i < SESSION_CNT; ++i) {
+	    for (j = 0; j <= BATCH_PKT_CNT; ++j, ++n) {
+		pjmedia_srtp_pkt *p = &pkts[n];
+
+		p->tp = srtp[i];
+		p->pkt = buf[n];
+		p->status = -1;
+
+		if (j < BATCH_PKT_CNT) {
+		    const void *hdr;
+		    int hdr_len;
+
+		    pjmedia_rtp_encode_rtp(&rtp[i], 0, 0, PAYLOAD_LEN,
+					   PAYLOAD_LEN, &hdr, &hdr_len);
+		    pj_memcpy(buf[n], hdr, hdr_len);
+		    pj_memcpy(buf[n] + hdr_len, payload, PAYLOAD_LEN);
+		    p->is_rtp = PJ_TRUE;
+		    p->pkt_len = hdr_len + PAYLOAD_LEN;
+		} else {
+		    /* Empty receiver report */
+		    pj_uint32_t ssrc = pj_htonl(0x1000 + i);
+
+		    buf[n][0] = (char)0x80;
+		    buf[n][1] = (char)201;
+		    buf[n][2] = 0;
+		    buf[n][3] = 1;
+		    pj_memcpy(buf[n] + 4, &ssrc, 4);
+		    p->is_rtp = PJ_FALSE;
+		    p->pkt_len = RTCP_LEN;
+		}
+	    }
+	}
+
+	pj_get_timestamp(&t1);
+	status = pjmedia_transport_srtp_protect_pkts(pkts, n);
+	pj_get_timestamp(&t2);
+	pj_add_timestamp(&protect_time, &t2);
+	pj_sub_timestamp(&protect_time, &t1);
+
+	if (status != PJ_SUCCESS) {
+	    app_perror(status, "    protect error");
+	    rc = -230;
+	    goto on_return;
+	}
+
+	for (i = 0; i < n; ++i) {
+	    if (pkts[i].status != PJ_SUCCESS ||
+		(pkts[i].is_rtp &&
+		 (pkts[i].pkt_len <= (int)(sizeof(pjmedia_rtp_hdr) +
+					   PAYLOAD_LEN) ||
+		  pj_memcmp(buf[i] + sizeof(pjmedia_rtp_hdr), payload,
+			    PAYLOAD_LEN) == 0)) ||
+		(!pkts[i].is_rtp && pkts[i].pkt_len <= RTCP_LEN))
+	    {
+		rc = -240;
+		goto on_return;
+	    }
+	    pkts[i].status = -1;
+	}
+
+	pj_get_timestamp(&t1);
+	status = pjmedia_transport_srtp_unprotect_pkts(pkts, n);
+	pj_get_timestamp(&t2);
+	pj_add_timestamp(&unprotect_time, &t2);
+	pj_sub_timestamp(&unprotect_time, &t1);
+
+	if (status != PJ_SUCCESS) {
+	    app_perror(status, "    unprotect error");
+	    rc = -250;
+	    goto on_return;
+	}
+
+	for (i = 0; i < n; ++i) {
+	    if (pkts[i].status != PJ_SUCCESS ||
+		(pkts[i].is_rtp &&
+		 (pkts[i].pkt_len != (int)(sizeof(pjmedia_rtp_hdr) +
+					   PAYLOAD_LEN) ||
+		  pj_memcmp(buf[i] + sizeof(pjmedia_rtp_hdr), payload,
+			    PAYLOAD_LEN) != 0)) ||
+		(!pkts[i].is_rtp && pkts[i].pkt_len != RTCP_LEN))
+	    {
+		rc = -260;
+		goto on_return;
+	    }
+	}
+
+	total += n;
+    }
+
+    PJ_LOG(3,(THIS_FILE, "    %u sessions, batch of %u (%s): protect %u "
+	      "pkt/s, unprotect %u pkt/s", SESSION_CNT, BATCH, BACKEND,
+	      get_pps(total, &zero, &protect_time),
+	      get_pps(total, &zero, &unprotect_time)));
+
+on_return:
+    for (i = 0; i < SESSION_CNT; ++i) {
+	if (srtp[i])
+	    pjmedia_transport_close(srtp[i]);
+    }
+    return rc;
+}
+
+
+int srtp_test(void)
+{
+    pj_pool_t *pool;
+    pjmedia_endpt *endpt;
+    int rc;
+
+    pool = pj_pool_create(mem, "srtptest", 4000, 4000, NULL);
+
+    if (pjmedia_endpt_create(mem, NULL, 0, &endpt) != PJ_SUCCESS) {
+	pj_pool_release(pool);
+	return -1;
+    }
+
+    PJ_LOG(3,(THIS_FILE, "  SRTP performance test"));
+    rc = perf_test(pool, endpt, "AES_CM_128_HMAC_SHA1_80");
+    if (rc == 0)
+	rc = perf_test(pool, endpt, "AES_CM_128_HMAC_SHA1_32");
+
+    if (rc == 0) {
+	PJ_LOG(3,(THIS_FILE, "  SRTP batch test"));
+	rc = batch_test(pool, endpt);
+    }
+
+    pjmedia_endpt_destroy(endpt);
+    pj_pool_release(pool);
+    return rc;
+}
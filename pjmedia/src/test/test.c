@@ -72,6 +72,8 @@ int test_main(void)
 #if defined(PJMEDIA_HAS_VIDEO) && (PJMEDIA_HAS_VIDEO != 0)
     pjmedia_video_format_mgr_create(pool, 64, 0, NULL);
     pjmedia_converter_mgr_create(pool, NULL);
+    pjmedia_vid_frame_pool_create(mem, NULL, PJMEDIA_VID_FRAME_POOL_MAX_IDLE,
+				  NULL);
     pjmedia_event_mgr_create(pool, 0, NULL);
     pjmedia_vid_codec_mgr_create(pool, NULL);
 #endif
@@ -103,6 +105,42 @@ int test_main(void)
 #if HAS_CODEC_VECTOR_TEST
     DO_TEST(codec_test_vectors());
 #endif
+#if HAS_RING_PORT_TEST
+    DO_TEST(ring_port_test());
+#endif
+#if HAS_CLOCK_SCHED_TEST
+    DO_TEST(clock_sched_test());
+#endif
+#if HAS_WAV_CACHE_TEST
+    DO_TEST(wav_cache_test());
+#endif
+#if HAS_WAV_WRITER_TEST
+    DO_TEST(wav_writer_test());
+#endif
+#if HAS_SRTP_TEST
+    DO_TEST(srtp_test());
+#endif
+#if HAS_SIGNAL_TEST
+    DO_TEST(signal_test());
+#endif
+#if HAS_VID_FRAME_POOL_TEST
+    DO_TEST(vid_frame_pool_test());
+#endif
+#if HAS_RESAMPLE_TEST
+    DO_TEST(resample_test());
+#endif
+#if HAS_RELAY_TEST
+    DO_TEST(relay_test());
+#endif
+#if HAS_CONF_VAD_TEST
+    DO_TEST(conf_vad_test());
+#endif
+#if HAS_PLC_TEST
+    DO_TEST(plc_test());
+#endif
+#if HAS_LIBYUV_TEST
+    DO_TEST(libyuv_test());
+#endif
 
     PJ_LOG(3,(THIS_FILE," "));
 
@@ -116,6 +154,7 @@ on_return:
 #if defined(PJMEDIA_HAS_VIDEO) && (PJMEDIA_HAS_VIDEO != 0)
     pjmedia_video_format_mgr_destroy(pjmedia_video_format_mgr_instance());
     pjmedia_converter_mgr_destroy(pjmedia_converter_mgr_instance());
+    pjmedia_vid_frame_pool_destroy(NULL);
     pjmedia_event_mgr_destroy(pjmedia_event_mgr_instance());
     pjmedia_vid_codec_mgr_destroy(pjmedia_vid_codec_mgr_instance());
 #endif
@@ -30,6 +30,18 @@
 #define HAS_JBUF_TEST		1
 #define HAS_MIPS_TEST		1
 #define HAS_CODEC_VECTOR_TEST	1
+#define HAS_RING_PORT_TEST	1
+#define HAS_CLOCK_SCHED_TEST	1
+#define HAS_WAV_CACHE_TEST	1
+#define HAS_WAV_WRITER_TEST	1
+#define HAS_SRTP_TEST		PJMEDIA_HAS_SRTP
+#define HAS_SIGNAL_TEST		1
+#define HAS_VID_FRAME_POOL_TEST	1
+#define HAS_RESAMPLE_TEST	1
+#define HAS_RELAY_TEST		1
+#define HAS_CONF_VAD_TEST	1
+#define HAS_PLC_TEST		1
+#define HAS_LIBYUV_TEST		(PJMEDIA_HAS_VIDEO && PJMEDIA_HAS_LIBYUV)
 
 int session_test(void);
 int rtp_test(void);
@@ -41,6 +53,18 @@ int codec_test_vectors(void);
 int vid_codec_test(void);
 int vid_dev_test(void);
 int vid_port_test(void);
+int ring_port_test(void);
+int clock_sched_test(void);
+int wav_cache_test(void);
+int wav_writer_test(void);
+int srtp_test(void);
+int signal_test(void);
+int vid_frame_pool_test(void);
+int resample_test(void);
+int relay_test(void);
+int conf_vad_test(void);
+int plc_test(void);
+int libyuv_test(void);
 
 extern pj_pool_factory *mem;
 void app_perror(pj_status_t status, const char *title);
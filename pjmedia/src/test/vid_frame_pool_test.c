@@ -0,0 +1,192 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2010-2011 Teluu Inc. (http://www.teluu.com)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "test.h"
+
+#define THIS_FILE	"vid_frame_pool_test.c"
+
+#define SMALL_SIZE	(176*144*3/2)
+#define LARGE_SIZE	(176*144*4)
+
+
+/* A producer hands its picture to a consumer (as the video stream does to
+ * the video port), which gives it to a second consumer by reference (as
+ * the video tee does), then both write new pictures.
+ */
+static int share_test(pjmedia_vid_frame_pool *fp)
+{
+    pjmedia_vid_frame_buf *fb;
+    pjmedia_frame prod, cons, cons2;
+    void *prod_buf;
+    pj_status_t status;
+
+    pj_bzero(&prod, sizeof(prod));
+    pj_bzero(&cons, sizeof(cons));
+    pj_bzero(&cons2, sizeof(cons2));
+
+    fb = pjmedia_vid_frame_pool_alloc(fp, LARGE_SIZE);
+    if (!fb || ((pj_size_t)fb->buf & 31) != 0 || fb->size < LARGE_SIZE)
+	return -10;
+    prod.buf = fb->buf;
+
+    fb = pjmedia_vid_frame_pool_alloc(fp, SMALL_SIZE);
+    if (!fb)
+	return -11;
+    cons.buf = fb->buf;
+
+    if (pjmedia_vid_frame_pool_find(fp, prod.buf) == NULL ||
+	pjmedia_vid_frame_pool_find(fp, (char*)prod.buf + 1) != NULL)
+    {
+	return -12;
+    }
+
+    /* Exchange: the consumer gets the picture, the producer keeps a
+     * buffer as large as before.
+     */
+    pj_memset(prod.buf, 0x55, SMALL_SIZE);
+    prod.type = PJMEDIA_FRAME_TYPE_VIDEO;
+    prod.size = SMALL_SIZE;
+    prod.timestamp.u64 = 3000;
+    prod_buf = prod.buf;
+    status = pjmedia_vid_frame_pool_exchange(fp, &cons, &prod);
+    if (status != PJ_SUCCESS)
+	return -20;
+    if (cons.buf != prod_buf || cons.size != SMALL_SIZE ||
+	cons.timestamp.u64 != 3000 || prod.size != 0 ||
+	((pj_uint8_t*)cons.buf)[SMALL_SIZE-1] != 0x55)
+    {
+	return -21;
+    }
+    fb = pjmedia_vid_frame_pool_find(fp, prod.buf);
+    if (!fb || fb->size < LARGE_SIZE || fb->ref_cnt != 1)
+	return -22;
+
+    /* Share with a second consumer, then nobody may exchange it */
+    if (pjmedia_vid_frame_pool_share(fp, &cons2, &cons) != PJ_SUCCESS ||
+	cons2.buf != cons.buf || cons2.size != cons.size)
+    {
+	return -30;
+    }
+    if (pjmedia_vid_frame_pool_find(fp, cons.buf)->ref_cnt != 2)
+	return -31;
+    if (pjmedia_vid_frame_pool_exchange(fp, &prod, &cons) == PJ_SUCCESS)
+	return -32;
+
+    /* Writing a new picture replaces the shared buffer */
+    status = pjmedia_vid_frame_pool_make_writable(fp, &cons, SMALL_SIZE);
+    if (status != PJ_SUCCESS || cons.buf == cons2.buf)
+	return -40;
+    if (pjmedia_vid_frame_pool_find(fp, cons2.buf)->ref_cnt != 1 ||
+	((pj_uint8_t*)cons2.buf)[0] != 0x55)
+    {
+	return -41;
+    }
+    prod_buf = cons.buf;
+    status = pjmedia_vid_frame_pool_make_writable(fp, &cons, SMALL_SIZE);
+    if (status != PJ_SUCCESS || cons.buf != prod_buf)
+	return -42;
+
+    /* Buffers outside of the pool are copied by the caller */
+    {
+	char priv[16];
+	pjmedia_frame f;
+
+	pj_bzero(&f, sizeof(f));
+	f.buf = priv;
+	if (pjmedia_vid_frame_pool_share(fp, &cons2, &f) == PJ_SUCCESS ||
+	    pjmedia_vid_frame_pool_exchange(fp, &f, &prod) == PJ_SUCCESS ||
+	    pjmedia_vid_frame_pool_make_writable(fp, &f, 64) != PJ_SUCCESS ||
+	    f.buf != priv)
+	{
+	    return -50;
+	}
+	pjmedia_vid_frame_pool_release(fp, &f);
+	if (f.buf != priv)
+	    return -51;
+    }
+
+    pjmedia_vid_frame_pool_release(fp, &prod);
+    pjmedia_vid_frame_pool_release(fp, &cons);
+    pjmedia_vid_frame_pool_release(fp, &cons2);
+    if (prod.buf || cons.buf || cons2.buf)
+	return -60;
+
+    return 0;
+}
+
+/* Released buffers are reused, up to the idle limit */
+static int reuse_test(pjmedia_vid_frame_pool *fp)
+{
+    pjmedia_vid_frame_buf *fb[4];
+    void *buf[4];
+    unsigned i;
+
+    for (i = 0; i < PJ_ARRAY_SIZE(fb); ++i) {
+	fb[i] = pjmedia_vid_frame_pool_alloc(fp, SMALL_SIZE);
+	if (!fb[i])
+	    return -100;
+	buf[i] = fb[i]->buf;
+    }
+    for (i = 0; i < PJ_ARRAY_SIZE(fb); ++i)
+	pjmedia_vid_frame_buf_dec_ref(fb[i]);
+
+    /* The pool was created with two idle buffers, the others are freed */
+    if (pjmedia_vid_frame_pool_find(fp, buf[0]) == NULL ||
+	pjmedia_vid_frame_pool_find(fp, buf[1]) == NULL)
+    {
+	return -101;
+    }
+    if (pjmedia_vid_frame_pool_find(fp, buf[2]) != NULL ||
+	pjmedia_vid_frame_pool_find(fp, buf[3]) != NULL)
+    {
+	return -102;
+    }
+
+    fb[0] = pjmedia_vid_frame_pool_alloc(fp, SMALL_SIZE);
+    if (!fb[0] || (fb[0]->buf != buf[0] && fb[0]->buf != buf[1]))
+	return -103;
+    pjmedia_vid_frame_buf_add_ref(fb[0]);
+    pjmedia_vid_frame_buf_dec_ref(fb[0]);
+    if (fb[0]->ref_cnt != 1)
+	return -104;
+    pjmedia_vid_frame_buf_dec_ref(fb[0]);
+
+    return 0;
+}
+
+int vid_frame_pool_test(void)
+{
+    pjmedia_vid_frame_pool *fp, *old_inst;
+    int rc;
+
+    PJ_LOG(3,(THIS_FILE, "Testing video frame pool.."));
+
+    old_inst = pjmedia_vid_frame_pool_instance();
+    if (pjmedia_vid_frame_pool_create(mem, NULL, 2, &fp) != PJ_SUCCESS)
+	return -1;
+
+    rc = share_test(fp);
+    if (rc == 0)
+	rc = reuse_test(fp);
+
+    pjmedia_vid_frame_pool_destroy(fp);
+    if (pjmedia_vid_frame_pool_instance() != old_inst && rc == 0)
+	rc = -2;
+
+    return rc;
+}
@@ -0,0 +1,606 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2011 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "test.h"
+#include <pjmedia-codec.h>
+
+#define THIS_FILE	"wav_cache_test.c"
+
+#define CLOCK_RATE	8000
+#define SPF		160
+#define FILE_FRAMES	10
+#define PCM_FILE	"wavcache-pcm.wav"
+#define ULAW_FILE	"wavcache-ulaw.wav"
+
+
+static pj_int16_t test_sample(unsigned i)
+{
+    return (pj_int16_t)((i * 997) % 20000 - 10000);
+}
+
+/* Write the test file with the WAV writer */
+static pj_status_t write_file(pj_pool_t *pool, const char *filename,
+			      unsigned flags)
+{
+    pjmedia_port *writer;
+    pjmedia_frame frame;
+    pj_int16_t buf[SPF];
+    unsigned i, j;
+    pj_status_t status;
+
+    status = pjmedia_wav_writer_port_create(pool, filename, CLOCK_RATE, 1,
+					    SPF, 16, flags, 0, &writer);
+    if (status != PJ_SUCCESS)
+	return status;
+
+    for (i = 0; i < FILE_FRAMES; ++i) {
+	for (j = 0; j < SPF; ++j)
+	    buf[j] = test_sample(i * SPF + j);
+
+	frame.type = PJMEDIA_FRAME_TYPE_AUDIO;
+	frame.buf = buf;
+	frame.size = sizeof(buf);
+	pjmedia_port_put_frame(writer, &frame);
+    }
+
+    return pjmedia_port_destroy(writer);
+}
+
+static pj_status_t get_frame(pjmedia_port *port, pj_int16_t *buf)
+{
+    pjmedia_frame frame;
+
+    frame.buf = buf;
+    frame.size = SPF * 2;
+    return pjmedia_port_get_frame(port, &frame);
+}
+
+/* The cached player must play exactly like the file player */
+static int compare_players(pj_pool_t *pool, pjmedia_wav_cache *cache,
+			   const char *filename)
+{
+    pjmedia_port *file_port, *cache_port;
+    pj_int16_t buf1[SPF], buf2[SPF];
+    unsigned i;
+    int rc = 0;
+
+    if (pjmedia_wav_player_port_create(pool, filename, 0, 0, 0,
+				       &file_port) != PJ_SUCCESS)
+	return -100;
+
+    if (pjmedia_wav_player_port_create_cached(pool, cache, filename, 0, 0,
+					      &cache_port) != PJ_SUCCESS)
+    {
+	pjmedia_port_destroy(file_port);
+	return -110;
+    }
+
+    /* Play the file more than twice, to include the loop */
+    for (i = 0; i < FILE_FRAMES * 2 + 5; ++i) {
+	get_frame(file_port, buf1);
+	get_frame(cache_port, buf2);
+	if (pj_memcmp(buf1, buf2, sizeof(buf1)) != 0) {
+	    PJ_LOG(3,(THIS_FILE, "    %s: frame %u differs", filename, i));
+	    rc = -120;
+	    break;
+	}
+    }
+
+    if (rc == 0 && pjmedia_wav_player_get_len(cache_port) !=
+		   pjmedia_wav_player_get_len(file_port))
+    {
+	rc = -130;
+    }
+
+    pjmedia_port_destroy(file_port);
+    pjmedia_port_destroy(cache_port);
+    return rc;
+}
+
+static pj_status_t eof_cb(pjmedia_port *port, void *user_data)
+{
+    PJ_UNUSED_ARG(port);
+    ++*(unsigned*)user_data;
+    return PJ_SUCCESS;
+}
+
+/* NO_LOOP playback, and sharing of the cache entry */
+static int no_loop_test(pj_pool_t *pool, pjmedia_wav_cache *cache)
+{
+    pjmedia_port *port1, *port2;
+    pjmedia_wav_cache_entry *e1, *e2;
+    pjmedia_wav_cache_info info;
+    pj_int16_t buf[SPF];
+    const void *ulaw;
+    pj_size_t size;
+    unsigned i, eof_cnt = 0;
+    int rc = 0;
+
+    if (pjmedia_wav_player_port_create_cached(pool, cache, PCM_FILE, 0,
+					      PJMEDIA_FILE_NO_LOOP,
+					      &port1) != PJ_SUCCESS)
+	return -200;
+    pjmedia_wav_player_set_eof_cb(port1, &eof_cnt, &eof_cb);
+
+    if (pjmedia_wav_player_port_create_cached(pool, cache, PCM_FILE, 0, 0,
+					      &port2) != PJ_SUCCESS)
+    {
+	pjmedia_port_destroy(port1);
+	return -210;
+    }
+
+    for (i = 0; i < FILE_FRAMES; ++i) {
+	if (get_frame(port1, buf) != PJ_SUCCESS ||
+	    buf[0] != test_sample(i * SPF))
+	{
+	    rc = -220;
+	    goto on_return;
+	}
+    }
+    if (get_frame(port1, buf) != PJ_EEOF || eof_cnt != 1) {
+	rc = -230;
+	goto on_return;
+    }
+
+    /* The second player has its own position */
+    get_frame(port2, buf);
+    if (buf[0] != test_sample(0)) {
+	rc = -240;
+	goto on_return;
+    }
+
+    /* Both players use the same entry */
+    pjmedia_wav_cache_get(cache, PCM_FILE, &e1);
+    pjmedia_wav_cache_get(cache, PCM_FILE, &e2);
+    if (e1 != e2)
+	rc = -250;
+
+    pjmedia_wav_cache_entry_get_info(e1, &info);
+    if (info.fmt_id != PJMEDIA_FORMAT_PCM ||
+	info.clock_rate != CLOCK_RATE || info.channel_count != 1 ||
+	info.size_samples != FILE_FRAMES * SPF)
+    {
+	rc = -260;
+    }
+
+    /* U-Law data of PCM file is encoded in the cache */
+    if (pjmedia_wav_cache_entry_get_data(e1, PJMEDIA_FORMAT_ULAW, &ulaw,
+					 &size) != PJ_SUCCESS ||
+	size != FILE_FRAMES * SPF)
+    {
+	rc = -270;
+    } else {
+	for (i = 0; i < size; ++i) {
+	    if (((const pj_uint8_t*)ulaw)[i] !=
+		pjmedia_linear2ulaw(test_sample(i)))
+	    {
+		rc = -280;
+		break;
+	    }
+	}
+    }
+
+    pjmedia_wav_cache_release(e1);
+    pjmedia_wav_cache_release(e2);
+
+    /* Only the U-Law file is unused, the PCM entry is in use */
+    if (rc == 0 && pjmedia_wav_cache_flush(cache) != 1)
+	rc = -290;
+
+on_return:
+    pjmedia_port_destroy(port1);
+    pjmedia_port_destroy(port2);
+    return rc;
+}
+
+/* Playlist of PCM and U-Law file */
+static int playlist_test(pj_pool_t *pool, pjmedia_wav_cache *cache)
+{
+    pj_str_t files[2];
+    pjmedia_port *list, *ulaw_port;
+    pj_int16_t buf1[SPF], buf2[SPF];
+    unsigned i;
+    int rc = 0;
+
+    files[0] = pj_str(PCM_FILE);
+    files[1] = pj_str(ULAW_FILE);
+
+    if (pjmedia_wav_playlist_create_cached(pool, cache, NULL, files, 2, 0,
+					   0, &list) != PJ_SUCCESS)
+	return -300;
+
+    if (pjmedia_wav_player_port_create(pool, ULAW_FILE, 0, 0, 0,
+				       &ulaw_port) != PJ_SUCCESS)
+    {
+	pjmedia_port_destroy(list);
+	return -310;
+    }
+
+    for (i = 0; i < FILE_FRAMES * 2 + 1; ++i) {
+	get_frame(list, buf1);
+
+	if (i < FILE_FRAMES || i == FILE_FRAMES * 2) {
+	    if (buf1[0] != test_sample((i % FILE_FRAMES) * SPF) ||
+		buf1[SPF-1] != test_sample((i % FILE_FRAMES) * SPF + SPF-1))
+	    {
+		rc = -320;
+		break;
+	    }
+	} else {
+	    get_frame(ulaw_port, buf2);
+	    if (pj_memcmp(buf1, buf2, sizeof(buf1)) != 0) {
+		rc = -330;
+		break;
+	    }
+	}
+    }
+
+    pjmedia_port_destroy(ulaw_port);
+    pjmedia_port_destroy(list);
+    return rc;
+}
+
+/* Encoded player gives the U-Law payload of the file */
+static int encoded_player_test(pj_pool_t *pool, pjmedia_wav_cache *cache)
+{
+    pjmedia_port *port;
+    pjmedia_frame_ext *f;
+    pj_uint8_t payload[SPF];
+    unsigned i, j;
+    int rc = 0;
+
+    if (pjmedia_wav_player_port_create_encoded(pool, cache, PCM_FILE,
+					       PJMEDIA_FORMAT_PCMU, 0,
+					       PJMEDIA_FILE_NO_LOOP,
+					       &port) != PJ_SUCCESS)
+	return -400;
+
+    if (port->info.fmt.id != PJMEDIA_FORMAT_PCMU ||
+	PJMEDIA_PIA_SPF(&port->info) != SPF)
+    {
+	pjmedia_port_destroy(port);
+	return -410;
+    }
+
+    f = (pjmedia_frame_ext*) pj_pool_alloc(pool, sizeof(*f) + SPF + 16);
+
+    for (i = 0; i < FILE_FRAMES && rc == 0; ++i) {
+	if (pjmedia_port_get_frame(port, &f->base) != PJ_SUCCESS ||
+	    f->base.type != PJMEDIA_FRAME_TYPE_EXTENDED ||
+	    f->samples_cnt != SPF ||
+	    pjmedia_frame_ext_copy_payload(f, payload, SPF) != SPF)
+	{
+	    rc = -420;
+	    break;
+	}
+
+	for (j = 0; j < SPF; ++j) {
+	    if (payload[j] != pjmedia_linear2ulaw(test_sample(i * SPF + j))) {
+		rc = -430;
+		break;
+	    }
+	}
+    }
+
+    if (rc == 0 && pjmedia_port_get_frame(port, &f->base) != PJ_EEOF)
+	rc = -440;
+
+    pjmedia_port_destroy(port);
+    return rc;
+}
+
+/* Create a started stream with the G.711 codec, over loop transport */
+static pj_status_t create_g711_stream(pj_pool_t *pool,
+				      pjmedia_endpt *endpt,
+				      const char *codec,
+				      pjmedia_transport **p_tp,
+				      pjmedia_stream **p_stream)
+{
+    const pjmedia_codec_info *ci[1];
+    pjmedia_stream_info si;
+    pj_str_t codec_id = pj_str((char*)codec);
+    unsigned count = 1;
+    pj_status_t status;
+
+    status = pjmedia_codec_mgr_find_codecs_by_id(
+		pjmedia_endpt_get_codec_mgr(endpt), &codec_id, &count,
+		ci, NULL);
+    if (status != PJ_SUCCESS)
+	return status;
+
+    pj_bzero(&si, sizeof(si));
+    si.type = PJMEDIA_TYPE_AUDIO;
+    si.proto = PJMEDIA_TP_PROTO_RTP_AVP;
+    si.dir = PJMEDIA_DIR_ENCODING_DECODING;
+    pj_sockaddr_in_init(&si.rem_addr.ipv4, NULL, 4000);
+    pj_sockaddr_in_init(&si.rem_rtcp.ipv4, NULL, 4001);
+    pj_memcpy(&si.fmt, ci[0], sizeof(pjmedia_codec_info));
+    si.tx_pt = ci[0]->pt;
+    si.tx_event_pt = 101;
+    si.rx_event_pt = 101;
+    si.ssrc = pj_rand();
+    si.jb_init = si.jb_min_pre = si.jb_max_pre = si.jb_max = -1;
+
+    status = pjmedia_transport_loop_create(endpt, p_tp);
+    if (status != PJ_SUCCESS)
+	return status;
+
+    status = pjmedia_stream_create(endpt, pool, &si, *p_tp, NULL, p_stream);
+    if (status == PJ_SUCCESS)
+	status = pjmedia_stream_start(*p_stream);
+
+    return status;
+}
+
+/* Stream sends the frames of encoded player without encoding them */
+static int encoded_stream_test(pj_pool_t *pool, pjmedia_wav_cache *cache)
+{
+    pjmedia_endpt *endpt = NULL;
+    pjmedia_transport *tp = NULL;
+    pjmedia_stream *stream = NULL;
+    pjmedia_port *stream_port, *player = NULL;
+    pjmedia_master_port *mp = NULL;
+    pjmedia_rtcp_stat stat;
+    pjmedia_frame_ext *f;
+    pjmedia_frame frame;
+    pj_int16_t pcm[SPF];
+    unsigned i, j, count, matched = 0;
+    int rc = 0;
+
+    if (pjmedia_endpt_create(mem, NULL, 0, &endpt) != PJ_SUCCESS)
+	return -500;
+
+    if (pjmedia_codec_g711_init(endpt) != PJ_SUCCESS) {
+	rc = -510;
+	goto on_return;
+    }
+
+    if (create_g711_stream(pool, endpt, "pcmu", &tp,
+			   &stream) != PJ_SUCCESS)
+    {
+	rc = -520;
+	goto on_return;
+    }
+    pjmedia_stream_get_port(stream, &stream_port);
+
+    if (pjmedia_wav_player_port_create_encoded(pool, cache, PCM_FILE,
+					       PJMEDIA_FORMAT_PCMU, 0, 0,
+					       &player) != PJ_SUCCESS)
+    {
+	rc = -530;
+	goto on_return;
+    }
+
+    /* The looped back audio is the G.711 decoded file */
+    f = (pjmedia_frame_ext*) pj_pool_alloc(pool, sizeof(*f) + SPF + 16);
+    for (i = 0; i < FILE_FRAMES * 3; ++i) {
+	pjmedia_port_get_frame(player, &f->base);
+	pjmedia_port_put_frame(stream_port, &f->base);
+
+	frame.buf = pcm;
+	frame.size = sizeof(pcm);
+	if (pjmedia_port_get_frame(stream_port, &frame) != PJ_SUCCESS ||
+	    frame.type != PJMEDIA_FRAME_TYPE_AUDIO)
+	{
+	    continue;
+	}
+
+	/* Find the frame in the file. The stream's playout may shift the
+	 * audio, so the frame needs not start at a frame boundary.
+	 */
+	for (j = 0; j < FILE_FRAMES * SPF; ++j) {
+	    unsigned k;
+
+	    for (k = 0; k < SPF; ++k) {
+		pj_int16_t s = test_sample((j + k) % (FILE_FRAMES * SPF));
+		if (pcm[k] != pjmedia_ulaw2linear(pjmedia_linear2ulaw(s)))
+		    break;
+	    }
+	    if (k == SPF) {
+		++matched;
+		break;
+	    }
+	}
+    }
+
+    if (matched < FILE_FRAMES) {
+	PJ_LOG(3,(THIS_FILE, "    only %u frames received intact", matched));
+	pjmedia_stream_get_stat(stream, &stat);
+	rc = -540;
+	goto on_return;
+    }
+
+    /* The master port carries the encoded frames to the stream too */
+    pjmedia_stream_get_stat(stream, &stat);
+    count = stat.tx.pkt;
+
+    if (pjmedia_master_port_create(pool, player, stream_port, 0,
+				   &mp) != PJ_SUCCESS ||
+	pjmedia_master_port_start(mp) != PJ_SUCCESS)
+    {
+	rc = -550;
+	goto on_return;
+    }
+    pj_thread_sleep(200);
+    pjmedia_master_port_stop(mp);
+
+    pjmedia_stream_get_stat(stream, &stat);
+    if (stat.tx.pkt <= count || stat.tx.bytes != stat.tx.pkt * SPF)
+	rc = -560;
+
+on_return:
+    if (mp)
+	pjmedia_master_port_destroy(mp, PJ_FALSE);
+    if (player)
+	pjmedia_port_destroy(player);
+    if (stream)
+	pjmedia_stream_destroy(stream);
+    if (tp)
+	pjmedia_transport_close(tp);
+    pjmedia_endpt_destroy(endpt);
+    return rc;
+}
+
+/* Stream drops encoded frames of the other G.711 law */
+static int encoded_mismatch_test(pj_pool_t *pool, pjmedia_wav_cache *cache)
+{
+    pjmedia_endpt *endpt = NULL;
+    pjmedia_transport *tp = NULL;
+    pjmedia_stream *stream = NULL;
+    pjmedia_port *stream_port, *player = NULL;
+    pjmedia_rtcp_stat stat;
+    pjmedia_frame_ext *f;
+    unsigned i;
+    int rc = 0;
+
+    if (pjmedia_endpt_create(mem, NULL, 0, &endpt) != PJ_SUCCESS)
+	return -600;
+
+    if (pjmedia_codec_g711_init(endpt) != PJ_SUCCESS ||
+	create_g711_stream(pool, endpt, "pcma", &tp, &stream) != PJ_SUCCESS)
+    {
+	rc = -610;
+	goto on_return;
+    }
+    pjmedia_stream_get_port(stream, &stream_port);
+
+    if (pjmedia_wav_player_port_create_encoded(pool, cache, PCM_FILE,
+					       PJMEDIA_FORMAT_PCMU, 0, 0,
+					       &player) != PJ_SUCCESS)
+    {
+	rc = -620;
+	goto on_return;
+    }
+
+    /* U-Law frames to an A-Law stream are rejected and not sent */
+    f = (pjmedia_frame_ext*) pj_pool_alloc(pool, sizeof(*f) + SPF + 16);
+    for (i = 0; i < 3; ++i) {
+	pjmedia_port_get_frame(player, &f->base);
+	if (pjmedia_port_put_frame(stream_port,
+				   &f->base) != PJMEDIA_EINVALIDPT)
+	{
+	    rc = -630;
+	    goto on_return;
+	}
+    }
+
+    pjmedia_stream_get_stat(stream, &stat);
+    if (stat.tx.pkt != 0) {
+	rc = -640;
+	goto on_return;
+    }
+
+    /* A-Law frames are sent */
+    pjmedia_port_destroy(player);
+    player = NULL;
+    if (pjmedia_wav_player_port_create_encoded(pool, cache, PCM_FILE,
+					       PJMEDIA_FORMAT_PCMA, 0, 0,
+					       &player) != PJ_SUCCESS)
+    {
+	rc = -650;
+	goto on_return;
+    }
+
+    pjmedia_port_get_frame(player, &f->base);
+    if (pjmedia_port_put_frame(stream_port, &f->base) != PJ_SUCCESS) {
+	rc = -660;
+	goto on_return;
+    }
+
+    pjmedia_stream_get_stat(stream, &stat);
+    if (stat.tx.pkt != 1 || stat.tx.bytes != SPF)
+	rc = -670;
+
+on_return:
+    if (player)
+	pjmedia_port_destroy(player);
+    if (stream)
+	pjmedia_stream_destroy(stream);
+    if (tp)
+	pjmedia_transport_close(tp);
+    pjmedia_endpt_destroy(endpt);
+    return rc;
+}
+
+int wav_cache_test(void)
+{
+    pj_pool_t *pool;
+    pjmedia_wav_cache *cache = NULL;
+    int rc;
+
+    pool = pj_pool_create(mem, "wavcachetest", 4000, 4000, NULL);
+
+    if (write_file(pool, PCM_FILE, PJMEDIA_FILE_WRITE_PCM) != PJ_SUCCESS ||
+	write_file(pool, ULAW_FILE, PJMEDIA_FILE_WRITE_ULAW) != PJ_SUCCESS)
+    {
+	rc = -10;
+	goto on_return;
+    }
+
+    if (pjmedia_wav_cache_create(mem, &cache) != PJ_SUCCESS) {
+	rc = -20;
+	goto on_return;
+    }
+
+    PJ_LOG(3,(THIS_FILE, "  cached player test"));
+    rc = compare_players(pool, cache, PCM_FILE);
+    if (rc == 0)
+	rc = compare_players(pool, cache, ULAW_FILE);
+    if (rc != 0)
+	goto on_return;
+
+    PJ_LOG(3,(THIS_FILE, "  no loop and sharing test"));
+    rc = no_loop_test(pool, cache);
+    if (rc != 0)
+	goto on_return;
+
+    PJ_LOG(3,(THIS_FILE, "  cached playlist test"));
+    rc = playlist_test(pool, cache);
+    if (rc != 0)
+	goto on_return;
+
+    PJ_LOG(3,(THIS_FILE, "  encoded player test"));
+    rc = encoded_player_test(pool, cache);
+    if (rc != 0)
+	goto on_return;
+
+#if PJMEDIA_HAS_G711_CODEC
+    PJ_LOG(3,(THIS_FILE, "  encoded player stream test"));
+    rc = encoded_stream_test(pool, cache);
+    if (rc != 0)
+	goto on_return;
+
+    PJ_LOG(3,(THIS_FILE, "  encoded frames of other codec test"));
+    rc = encoded_mismatch_test(pool, cache);
+    if (rc != 0)
+	goto on_return;
+#endif
+
+    /* Nothing is in use anymore */
+    if (pjmedia_wav_cache_flush(cache) != 2)
+	rc = -30;
+
+on_return:
+    if (cache)
+	pjmedia_wav_cache_destroy(cache);
+    pj_file_delete(PCM_FILE);
+    pj_file_delete(ULAW_FILE);
+    pj_pool_release(pool);
+    return rc;
+}
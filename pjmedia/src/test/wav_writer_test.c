@@ -0,0 +1,211 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2011 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "test.h"
+
+#define THIS_FILE	"wav_writer_test.c"
+
+#define CLOCK_RATE	8000
+#define SPF		160
+#define FRAME_CNT	250	/* 5 seconds, several buffers */
+#define WRITER_CNT	8
+#define SYNC_FILE	"wavwriter-sync.wav"
+
+
+static pj_int16_t test_sample(unsigned writer, unsigned i)
+{
+    return (pj_int16_t)((i * 997 + writer * 131) % 20000 - 10000);
+}
+
+/* Read the whole file */
+static char *read_file(pj_pool_t *pool, const char *filename,
+		       pj_ssize_t *size)
+{
+    pj_oshandle_t fd;
+    char *buf;
+
+    *size = (pj_ssize_t)pj_file_size(filename);
+    if (*size <= 0)
+	return NULL;
+
+    if (pj_file_open(pool, filename, PJ_O_RDONLY, &fd) != PJ_SUCCESS)
+	return NULL;
+
+    buf = (char*) pj_pool_alloc(pool, *size);
+    if (pj_file_read(fd, buf, size) != PJ_SUCCESS)
+	buf = NULL;
+
+    pj_file_close(fd);
+    return buf;
+}
+
+/* Record with several async writers at once, and compare each file with
+ * the file recorded by the normal writer.
+ */
+static int compare_test(pj_pool_t *pool, pjmedia_wav_writer_io *io,
+			unsigned flags)
+{
+    pjmedia_port *sync_port, *port[WRITER_CNT];
+    char filename[WRITER_CNT][32];
+    pjmedia_wav_writer_io_stat stat;
+    pj_int16_t buf[SPF];
+    pj_size_t total = 0;
+    unsigned i, j, k;
+    int rc = 0;
+
+    pj_bzero(port, sizeof(port));
+
+    for (i = 0; i < WRITER_CNT; ++i) {
+	pj_ansi_snprintf(filename[i], sizeof(filename[i]),
+			 "wavwriter-async%u.wav", i);
+	if (pjmedia_wav_writer_port_create_async(pool, io, filename[i],
+						 CLOCK_RATE, 1, SPF, 16,
+						 flags, 0,
+						 &port[i]) != PJ_SUCCESS)
+	{
+	    rc = -100;
+	    goto on_return;
+	}
+    }
+
+    if (pjmedia_wav_writer_io_get_stat(io, &stat) != PJ_SUCCESS ||
+	stat.writer_cnt != WRITER_CNT)
+    {
+	rc = -110;
+	goto on_return;
+    }
+
+    for (i = 0; i < FRAME_CNT; ++i) {
+	for (k = 0; k < WRITER_CNT; ++k) {
+	    pjmedia_frame frame;
+
+	    for (j = 0; j < SPF; ++j)
+		buf[j] = test_sample(k, i * SPF + j);
+
+	    frame.type = PJMEDIA_FRAME_TYPE_AUDIO;
+	    frame.buf = buf;
+	    frame.size = sizeof(buf);
+	    pjmedia_port_put_frame(port[k], &frame);
+	}
+
+	/* Give the I/O thread time now and then, as the clock would */
+	if (i % 50 == 0)
+	    pj_thread_sleep(10);
+    }
+
+    if (pjmedia_wav_writer_port_get_pos(port[0]) !=
+	(pj_ssize_t)(FRAME_CNT * SPF * (flags == 0 ? 2 : 1)))
+    {
+	rc = -120;
+	goto on_return;
+    }
+
+    for (k = 0; k < WRITER_CNT; ++k) {
+	pjmedia_port_destroy(port[k]);
+	port[k] = NULL;
+    }
+
+    /* Compare with the normal writer */
+    for (k = 0; k < WRITER_CNT && rc == 0; ++k) {
+	char *data1, *data2;
+	pj_ssize_t size1, size2;
+
+	if (pjmedia_wav_writer_port_create(pool, SYNC_FILE, CLOCK_RATE, 1,
+					   SPF, 16, flags, 0,
+					   &sync_port) != PJ_SUCCESS)
+	{
+	    rc = -130;
+	    break;
+	}
+	for (i = 0; i < FRAME_CNT; ++i) {
+	    pjmedia_frame frame;
+
+	    for (j = 0; j < SPF; ++j)
+		buf[j] = test_sample(k, i * SPF + j);
+
+	    frame.type = PJMEDIA_FRAME_TYPE_AUDIO;
+	    frame.buf = buf;
+	    frame.size = sizeof(buf);
+	    pjmedia_port_put_frame(sync_port, &frame);
+	}
+	pjmedia_port_destroy(sync_port);
+
+	data1 = read_file(pool, SYNC_FILE, &size1);
+	data2 = read_file(pool, filename[k], &size2);
+	if (!data1 || !data2 || size1 != size2 ||
+	    pj_memcmp(data1, data2, size1) != 0)
+	{
+	    PJ_LOG(3,(THIS_FILE, "    %s differs", filename[k]));
+	    rc = -140;
+	}
+	total += size2;
+	pj_file_delete(SYNC_FILE);
+    }
+
+    if (rc == 0) {
+	pjmedia_wav_writer_io_get_stat(io, &stat);
+	if (stat.writer_cnt != 0 || stat.drop_cnt != 0 ||
+	    stat.bytes_written != total)
+	{
+	    rc = -150;
+	}
+	PJ_LOG(3,(THIS_FILE, "    %u writes, %u bytes",
+		  stat.write_cnt, (unsigned)stat.bytes_written));
+    }
+
+on_return:
+    for (k = 0; k < WRITER_CNT; ++k) {
+	if (port[k])
+	    pjmedia_port_destroy(port[k]);
+	pj_file_delete(filename[k]);
+    }
+    return rc;
+}
+
+int wav_writer_test(void)
+{
+    pj_pool_t *pool;
+    pjmedia_wav_writer_io *io;
+    int rc;
+
+    pool = pj_pool_create(mem, "wavwritertest", 4000, 4000, NULL);
+
+    /* Each test uses a new I/O thread, to check its statistics */
+    PJ_LOG(3,(THIS_FILE, "  async PCM writer test"));
+    if (pjmedia_wav_writer_io_create(mem, &io) != PJ_SUCCESS) {
+	rc = -10;
+	goto on_return;
+    }
+    rc = compare_test(pool, io, PJMEDIA_FILE_WRITE_PCM);
+    pjmedia_wav_writer_io_destroy(io);
+    if (rc != 0)
+	goto on_return;
+
+    PJ_LOG(3,(THIS_FILE, "  async U-Law writer test"));
+    if (pjmedia_wav_writer_io_create(mem, &io) != PJ_SUCCESS) {
+	rc = -20;
+	goto on_return;
+    }
+    rc = compare_test(pool, io, PJMEDIA_FILE_WRITE_ULAW);
+    pjmedia_wav_writer_io_destroy(io);
+
+on_return:
+    pj_pool_release(pool);
+    return rc;
+}
@@ -1414,6 +1414,393 @@ PJ_DECL(pj_status_t) pj_stun_msg_decode(pj_pool_t *pool,
 					pj_size_t *p_parsed_len,
 				        pj_stun_msg **p_response);
 
+/**
+ * This describes the location of an attribute inside a STUN packet that
+ * has been indexed by #pj_stun_msg_view_parse().
+ */
+typedef struct pj_stun_attr_view
+{
+    /**
+     * Attribute type, in host byte order.
+     */
+    pj_uint16_t		type;
+
+    /**
+     * Length of the attribute value as specified in the packet, in host
+     * byte order. This does not include the padding.
+     */
+    pj_uint16_t		length;
+
+    /**
+     * Offset of the attribute header from the beginning of the packet.
+     */
+    unsigned		offset;
+
+} pj_stun_attr_view;
+
+
+/**
+ * This is a read-only, zero-allocation view of a STUN packet. Unlike
+ * #pj_stun_msg_decode(), parsing a packet into a view does not allocate
+ * any memory: the attributes are only validated for framing and indexed,
+ * and the attribute values are read directly from the packet buffer with
+ * the pj_stun_msg_view_get_xxx() functions. The packet buffer therefore
+ * must remain valid for as long as the view is used.
+ *
+ * The view is suitable for high volume traffic such as ICE connectivity
+ * checks and keep-alives, where the message only needs to be inspected
+ * briefly and then discarded.
+ */
+typedef struct pj_stun_msg_view
+{
+    /**
+     * STUN message header, in host byte order.
+     */
+    pj_stun_msg_hdr	hdr;
+
+    /**
+     * The packet buffer.
+     */
+    const pj_uint8_t   *pdu;
+
+    /**
+     * Length of the STUN message in the packet buffer, including the
+     * 20 bytes message header.
+     */
+    unsigned		pdu_len;
+
+    /**
+     * Number of attributes in the message.
+     */
+    unsigned		attr_count;
+
+    /**
+     * Index of the attributes in the packet.
+     */
+    pj_stun_attr_view	attr[PJ_STUN_MAX_ATTR];
+
+} pj_stun_msg_view;
+
+
+/**
+ * Parse and index a STUN packet without allocating memory. The message
+ * framing, the position and size of MESSAGE-INTEGRITY and FINGERPRINT,
+ * and the presence of unknown comprehension-required attributes are
+ * validated here, while the attribute values are validated when they
+ * are retrieved.
+ *
+ * @param view		The view to be initialized.
+ * @param pdu		The incoming packet to be parsed. The buffer must
+ *			remain valid while the view is in use.
+ * @param pdu_len	The length of the incoming packet.
+ * @param options	Parsing flags, according to pj_stun_decode_options.
+ * @param p_parsed_len	Optional pointer to receive how many bytes have
+ *			been parsed for the STUN message.
+ *
+ * @return		PJ_SUCCESS if the packet has been successfully
+ *			parsed.
+ */
+PJ_DECL(pj_status_t) pj_stun_msg_view_parse(pj_stun_msg_view *view,
+					    const pj_uint8_t *pdu,
+					    pj_size_t pdu_len,
+					    unsigned options,
+					    pj_size_t *p_parsed_len);
+
+/**
+ * Find STUN attribute in the message view, starting from the specified
+ * index.
+ *
+ * @param view		The STUN message view.
+ * @param attr_type	The attribute type to be found, from pj_stun_attr_type.
+ * @param start_index	The start index of the attribute in the message.
+ *
+ * @return		The attribute index entry, or NULL if it cannot be
+ *			found.
+ */
+PJ_DECL(const pj_stun_attr_view*)
+pj_stun_msg_view_find_attr(const pj_stun_msg_view *view,
+			   int attr_type,
+			   unsigned start_index);
+
+/**
+ * Get the socket address from an IP address attribute (such as
+ * MAPPED-ADDRESS or XOR-MAPPED-ADDRESS) in the message view. The XOR
+ * operation is applied automatically according to the attribute type.
+ *
+ * @param view		The STUN message view.
+ * @param attr		The attribute, which must belong to the view.
+ * @param addr		Socket address to receive the value.
+ *
+ * @return		PJ_SUCCESS on success or the appropriate error code.
+ */
+PJ_DECL(pj_status_t) pj_stun_msg_view_get_sockaddr(
+					    const pj_stun_msg_view *view,
+					    const pj_stun_attr_view *attr,
+					    pj_sockaddr *addr);
+
+/**
+ * Get the value of a 32bit integer attribute in the message view.
+ *
+ * @param view		The STUN message view.
+ * @param attr		The attribute, which must belong to the view.
+ * @param value		Pointer to receive the value, in host byte order.
+ *
+ * @return		PJ_SUCCESS on success or the appropriate error code.
+ */
+PJ_DECL(pj_status_t) pj_stun_msg_view_get_uint(const pj_stun_msg_view *view,
+					       const pj_stun_attr_view *attr,
+					       pj_uint32_t *value);
+
+/**
+ * Get the value of a 64bit integer attribute (such as ICE-CONTROLLED or
+ * ICE-CONTROLLING) in the message view.
+ *
+ * @param view		The STUN message view.
+ * @param attr		The attribute, which must belong to the view.
+ * @param value		Pointer to receive the value, in host byte order.
+ *
+ * @return		PJ_SUCCESS on success or the appropriate error code.
+ */
+PJ_DECL(pj_status_t) pj_stun_msg_view_get_uint64(
+					    const pj_stun_msg_view *view,
+					    const pj_stun_attr_view *attr,
+					    pj_timestamp *value);
+
+/**
+ * Get the value of a string or binary attribute in the message view. The
+ * returned string points directly to the packet buffer and therefore is
+ * not NULL terminated.
+ *
+ * @param view		The STUN message view.
+ * @param attr		The attribute, which must belong to the view.
+ * @param value		Pointer to receive the value.
+ *
+ * @return		PJ_SUCCESS on success or the appropriate error code.
+ */
+PJ_DECL(pj_status_t) pj_stun_msg_view_get_str(const pj_stun_msg_view *view,
+					      const pj_stun_attr_view *attr,
+					      pj_str_t *value);
+
+/**
+ * Get the value of ERROR-CODE attribute in the message view.
+ *
+ * @param view		The STUN message view.
+ * @param attr		The attribute, which must belong to the view.
+ * @param err_code	Pointer to receive the STUN error code.
+ * @param reason	Optional pointer to receive the reason phrase, which
+ *			points directly to the packet buffer.
+ *
+ * @return		PJ_SUCCESS on success or the appropriate error code.
+ */
+PJ_DECL(pj_status_t) pj_stun_msg_view_get_errcode(
+					    const pj_stun_msg_view *view,
+					    const pj_stun_attr_view *attr,
+					    int *err_code,
+					    pj_str_t *reason);
+
+/**
+ * Verify the MESSAGE-INTEGRITY attribute of the message view against
+ * the specified key, by calculating the HMAC-SHA1 digest directly over
+ * the packet buffer.
+ *
+ * @param view		The STUN message view.
+ * @param key		Authentication key, as created by
+ *			#pj_stun_create_key().
+ *
+ * @return		PJ_SUCCESS if the message integrity is valid,
+ *			or PJ_STATUS_FROM_STUN_CODE(PJ_STUN_SC_UNAUTHORIZED)
+ *			if the attribute is missing or the digest does not
+ *			match.
+ */
+PJ_DECL(pj_status_t) pj_stun_msg_view_check_msgint(
+					    const pj_stun_msg_view *view,
+					    const pj_str_t *key);
+
+
+/**
+ * This is a reusable STUN message writer, which encodes a STUN message
+ * directly into a buffer supplied by the caller, without creating
+ * #pj_stun_msg or any attribute instances. The writer is typically used
+ * to send Binding requests and responses, e.g. for ICE connectivity
+ * checks, without allocating memory.
+ *
+ * The writer may be declared on the stack and re-initialized with
+ * #pj_stun_msg_writer_init() for each message.
+ */
+typedef struct pj_stun_msg_writer
+{
+    /**
+     * The message header, in host byte order.
+     */
+    pj_stun_msg_hdr	hdr;
+
+    /**
+     * The output buffer.
+     */
+    pj_uint8_t	       *buf;
+
+    /**
+     * Size of the output buffer.
+     */
+    unsigned		buf_size;
+
+    /**
+     * Current length of the message in the buffer, including the
+     * message header.
+     */
+    unsigned		len;
+
+} pj_stun_msg_writer;
+
+
+/**
+ * Initialize the STUN message writer and write the message header into
+ * the buffer.
+ *
+ * @param w		The writer.
+ * @param buf		The output buffer.
+ * @param buf_size	Size of the output buffer.
+ * @param msg_type	Type of the message to be written.
+ * @param magic		Magic value to be put in the message header.
+ * @param tsx_id	Optional transaction ID, or NULL to let the
+ *			function generates a random transaction ID.
+ *
+ * @return		PJ_SUCCESS on success or the appropriate error code.
+ */
+PJ_DECL(pj_status_t) pj_stun_msg_writer_init(pj_stun_msg_writer *w,
+					     pj_uint8_t *buf,
+					     unsigned buf_size,
+					     unsigned msg_type,
+					     pj_uint32_t magic,
+					     const pj_uint8_t tsx_id[12]);
+
+/**
+ * Initialize the STUN message writer to write a success or error
+ * response for the specified request. If \a err_code is non-zero, the
+ * ERROR-CODE attribute will be written as well.
+ *
+ * @param w		The writer.
+ * @param buf		The output buffer.
+ * @param buf_size	Size of the output buffer.
+ * @param req		The request, which must be a request message.
+ * @param err_code	Error code, or zero for success response.
+ * @param err_msg	Optional error reason. If NULL, the default reason
+ *			for the error code will be used.
+ *
+ * @return		PJ_SUCCESS on success or the appropriate error code.
+ */
+PJ_DECL(pj_status_t) pj_stun_msg_writer_init_response(
+					    pj_stun_msg_writer *w,
+					    pj_uint8_t *buf,
+					    unsigned buf_size,
+					    const pj_stun_msg_view *req,
+					    unsigned err_code,
+					    const pj_str_t *err_msg);
+
+/**
+ * Write an IP address attribute.
+ *
+ * @param w		The writer.
+ * @param attr_type	Attribute type, from #pj_stun_attr_type.
+ * @param xor_ed	If non-zero, the port and address will be XOR-ed
+ *			with the magic, to make the XOR-MAPPED-ADDRESS
+ *			attribute.
+ * @param addr		The socket address.
+ * @param addr_len	Length of the address.
+ *
+ * @return		PJ_SUCCESS on success or the appropriate error code.
+ */
+PJ_DECL(pj_status_t) pj_stun_msg_writer_add_sockaddr(pj_stun_msg_writer *w,
+						     int attr_type,
+						     pj_bool_t xor_ed,
+						     const pj_sockaddr_t *addr,
+						     unsigned addr_len);
+
+/**
+ * Write a 32bit integer attribute.
+ *
+ * @param w		The writer.
+ * @param attr_type	Attribute type, from #pj_stun_attr_type.
+ * @param value		The 32bit value, in host byte order.
+ *
+ * @return		PJ_SUCCESS on success or the appropriate error code.
+ */
+PJ_DECL(pj_status_t) pj_stun_msg_writer_add_uint(pj_stun_msg_writer *w,
+						 int attr_type,
+						 pj_uint32_t value);
+
+/**
+ * Write a 64bit integer attribute.
+ *
+ * @param w		The writer.
+ * @param attr_type	Attribute type, from #pj_stun_attr_type.
+ * @param value		The 64bit value, in host byte order.
+ *
+ * @return		PJ_SUCCESS on success or the appropriate error code.
+ */
+PJ_DECL(pj_status_t) pj_stun_msg_writer_add_uint64(pj_stun_msg_writer *w,
+						   int attr_type,
+						   const pj_timestamp *value);
+
+/**
+ * Write a string attribute.
+ *
+ * @param w		The writer.
+ * @param attr_type	Attribute type, from #pj_stun_attr_type.
+ * @param value		The string value.
+ *
+ * @return		PJ_SUCCESS on success or the appropriate error code.
+ */
+PJ_DECL(pj_status_t) pj_stun_msg_writer_add_string(pj_stun_msg_writer *w,
+						   int attr_type,
+						   const pj_str_t *value);
+
+/**
+ * Write an attribute with no value, such as USE-CANDIDATE.
+ *
+ * @param w		The writer.
+ * @param attr_type	Attribute type, from #pj_stun_attr_type.
+ *
+ * @return		PJ_SUCCESS on success or the appropriate error code.
+ */
+PJ_DECL(pj_status_t) pj_stun_msg_writer_add_empty(pj_stun_msg_writer *w,
+						  int attr_type);
+
+/**
+ * Write ERROR-CODE attribute.
+ *
+ * @param w		The writer.
+ * @param err_code	STUN error code.
+ * @param err_reason	Optional error reason. If NULL, the default reason
+ *			for the error code will be used.
+ *
+ * @return		PJ_SUCCESS on success or the appropriate error code.
+ */
+PJ_DECL(pj_status_t) pj_stun_msg_writer_add_errcode(pj_stun_msg_writer *w,
+						    int err_code,
+						    const pj_str_t *err_reason);
+
+/**
+ * Finish writing the message. If \a key is specified, MESSAGE-INTEGRITY
+ * will be calculated over the buffer and appended, and if \a fingerprint
+ * is set, FINGERPRINT will be appended as the last attribute. No other
+ * attributes may be added after this function is called.
+ *
+ * @param w		The writer.
+ * @param key		Optional authentication key to calculate
+ *			MESSAGE-INTEGRITY.
+ * @param fingerprint	Specify whether FINGERPRINT should be added.
+ * @param p_msg_len	Optional pointer to receive the total length of
+ *			the message in the buffer.
+ *
+ * @return		PJ_SUCCESS on success or the appropriate error code.
+ */
+PJ_DECL(pj_status_t) pj_stun_msg_writer_finish(pj_stun_msg_writer *w,
+					       const pj_str_t *key,
+					       pj_bool_t fingerprint,
+					       pj_size_t *p_msg_len);
+
+
 /**
  * Dump STUN message to a printable string output.
  *
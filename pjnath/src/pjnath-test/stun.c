@@ -956,6 +956,215 @@ static int handle_unknown_non_mandatory(void)
 }
 
 
+/* Encode and decode with the zero-allocation message writer and view */
+static int view_writer_test(void)
+{
+    pj_pool_t *pool = pj_pool_create(mem, NULL, 1000, 1000, NULL);
+    pj_uint8_t tsx_id[12] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12 };
+    const pj_str_t WRONG_PASSWORD = {"wrong", 5};
+    pj_stun_msg *msg0, *msg1;
+    pj_stun_msg_writer w;
+    pj_stun_msg_view view;
+    const pj_stun_attr_view *attr;
+    pj_stun_sockaddr_attr *amapped;
+    pj_uint8_t packet0[500], packet1[500];
+    pj_sockaddr addr0, addr1;
+    pj_timestamp u64, u64_1;
+    pj_uint32_t u32;
+    pj_str_t s, reason;
+    pj_size_t len0, len1;
+    int err_code;
+    pj_status_t rc;
+
+    PJ_LOG(3,(THIS_FILE, "  zero-allocation view and writer"));
+
+    u64.u32.hi = 0x932ff9b1;
+    u64.u32.lo = 0x51263b36;
+
+    /* Encode Binding request with the regular API as the reference */
+    rc = pj_stun_msg_create(pool, PJ_STUN_BINDING_REQUEST, PJ_STUN_MAGIC,
+			    tsx_id, &msg0);
+    rc += pj_stun_msg_add_string_attr(pool, msg0, PJ_STUN_ATTR_USERNAME,
+				      &USERNAME);
+    rc += pj_stun_msg_add_uint_attr(pool, msg0, PJ_STUN_ATTR_PRIORITY,
+				    0x6e0001ff);
+    rc += pj_stun_msg_add_uint64_attr(pool, msg0,
+				      PJ_STUN_ATTR_ICE_CONTROLLING, &u64);
+    rc += pj_stun_msg_add_empty_attr(pool, msg0, PJ_STUN_ATTR_USE_CANDIDATE);
+    rc += pj_stun_msg_add_msgint_attr(pool, msg0);
+    rc += pj_stun_msg_add_uint_attr(pool, msg0, PJ_STUN_ATTR_FINGERPRINT, 0);
+    rc += pj_stun_msg_encode(msg0, packet0, sizeof(packet0), 0, &PASSWORD,
+			     &len0);
+    if (rc != 0) {
+	rc = -4500;
+	goto on_return;
+    }
+
+    PJ_LOG(3,(THIS_FILE, "    writing request"));
+    rc = pj_stun_msg_writer_init(&w, packet1, sizeof(packet1),
+				 PJ_STUN_BINDING_REQUEST, PJ_STUN_MAGIC,
+				 tsx_id);
+    rc += pj_stun_msg_writer_add_string(&w, PJ_STUN_ATTR_USERNAME, &USERNAME);
+    rc += pj_stun_msg_writer_add_uint(&w, PJ_STUN_ATTR_PRIORITY, 0x6e0001ff);
+    rc += pj_stun_msg_writer_add_uint64(&w, PJ_STUN_ATTR_ICE_CONTROLLING,
+					&u64);
+    rc += pj_stun_msg_writer_add_empty(&w, PJ_STUN_ATTR_USE_CANDIDATE);
+    rc += pj_stun_msg_writer_finish(&w, &PASSWORD, PJ_TRUE, &len1);
+    if (rc != 0) {
+	rc = -4510;
+	goto on_return;
+    }
+
+    if (len0 != len1 || cmp_buf(packet0, packet1, (unsigned)len0) != -1) {
+	PJ_LOG(1,(THIS_FILE, "    writer output mismatch"));
+	rc = -4520;
+	goto on_return;
+    }
+
+    /* The writer must not overflow a small buffer */
+    rc = pj_stun_msg_writer_init(&w, packet1, 24, PJ_STUN_BINDING_REQUEST,
+				 PJ_STUN_MAGIC, tsx_id);
+    if (rc != PJ_SUCCESS ||
+	pj_stun_msg_writer_add_string(&w, PJ_STUN_ATTR_USERNAME,
+				      &USERNAME) != PJ_ETOOSMALL ||
+	pj_stun_msg_writer_finish(&w, &PASSWORD, PJ_FALSE, NULL) !=
+	    PJ_ETOOSMALL)
+    {
+	rc = -4525;
+	goto on_return;
+    }
+
+    PJ_LOG(3,(THIS_FILE, "    parsing request"));
+    rc = pj_stun_msg_view_parse(&view, packet0, len0,
+				PJ_STUN_IS_DATAGRAM | PJ_STUN_CHECK_PACKET,
+				&len1);
+    if (rc != PJ_SUCCESS || len1 != len0 ||
+	view.hdr.type != PJ_STUN_BINDING_REQUEST ||
+	view.attr_count != msg0->attr_count ||
+	pj_memcmp(view.hdr.tsx_id, tsx_id, sizeof(tsx_id)))
+    {
+	rc = -4530;
+	goto on_return;
+    }
+
+    attr = pj_stun_msg_view_find_attr(&view, PJ_STUN_ATTR_USERNAME, 0);
+    if (!attr || pj_stun_msg_view_get_str(&view, attr, &s) != PJ_SUCCESS ||
+	pj_strcmp(&s, &USERNAME))
+    {
+	rc = -4540;
+	goto on_return;
+    }
+
+    attr = pj_stun_msg_view_find_attr(&view, PJ_STUN_ATTR_PRIORITY, 0);
+    if (!attr || pj_stun_msg_view_get_uint(&view, attr, &u32) != PJ_SUCCESS ||
+	u32 != 0x6e0001ff)
+    {
+	rc = -4550;
+	goto on_return;
+    }
+
+    attr = pj_stun_msg_view_find_attr(&view, PJ_STUN_ATTR_ICE_CONTROLLING, 0);
+    if (!attr ||
+	pj_stun_msg_view_get_uint64(&view, attr, &u64_1) != PJ_SUCCESS ||
+	u64_1.u64 != u64.u64)
+    {
+	rc = -4560;
+	goto on_return;
+    }
+
+    if (pj_stun_msg_view_find_attr(&view, PJ_STUN_ATTR_USE_CANDIDATE, 0) ==
+	    NULL ||
+	pj_stun_msg_view_find_attr(&view, PJ_STUN_ATTR_REALM, 0) != NULL)
+    {
+	rc = -4570;
+	goto on_return;
+    }
+
+    if (pj_stun_msg_view_check_msgint(&view, &PASSWORD) != PJ_SUCCESS ||
+	pj_stun_msg_view_check_msgint(&view, &WRONG_PASSWORD) == PJ_SUCCESS)
+    {
+	rc = -4580;
+	goto on_return;
+    }
+
+    PJ_LOG(3,(THIS_FILE, "    writing response"));
+    pj_sockaddr_init(pj_AF_INET(), &addr0, pj_cstr(&s, "192.0.2.1"), 32853);
+    rc = pj_stun_msg_writer_init_response(&w, packet1, sizeof(packet1),
+					  &view, 0, NULL);
+    rc += pj_stun_msg_writer_add_sockaddr(&w, PJ_STUN_ATTR_XOR_MAPPED_ADDR,
+					  PJ_TRUE, &addr0,
+					  pj_sockaddr_get_len(&addr0));
+    rc += pj_stun_msg_writer_finish(&w, &PASSWORD, PJ_TRUE, &len1);
+    if (rc != 0) {
+	rc = -4590;
+	goto on_return;
+    }
+
+    /* The response must be readable with the regular API */
+    rc = pj_stun_msg_decode(pool, packet1, len1,
+			    PJ_STUN_IS_DATAGRAM | PJ_STUN_CHECK_PACKET,
+			    &msg1, NULL, NULL);
+    if (rc != PJ_SUCCESS || 
+	msg1->hdr.type != PJ_STUN_BINDING_RESPONSE ||
+	pj_memcmp(msg1->hdr.tsx_id, tsx_id, sizeof(tsx_id)) ||
+	pj_stun_authenticate_response(packet1, (unsigned)len1, msg1,
+				      &PASSWORD) != PJ_SUCCESS)
+    {
+	rc = -4600;
+	goto on_return;
+    }
+
+    amapped = (pj_stun_sockaddr_attr*)
+	      pj_stun_msg_find_attr(msg1, PJ_STUN_ATTR_XOR_MAPPED_ADDR, 0);
+    if (!amapped || pj_sockaddr_cmp(&amapped->sockaddr, &addr0)) {
+	rc = -4610;
+	goto on_return;
+    }
+
+    PJ_LOG(3,(THIS_FILE, "    parsing response"));
+    rc = pj_stun_msg_view_parse(&view, packet1, len1,
+				PJ_STUN_IS_DATAGRAM | PJ_STUN_CHECK_PACKET,
+				NULL);
+    attr = pj_stun_msg_view_find_attr(&view, PJ_STUN_ATTR_XOR_MAPPED_ADDR, 0);
+    if (rc != PJ_SUCCESS || !attr ||
+	pj_stun_msg_view_get_sockaddr(&view, attr, &addr1) != PJ_SUCCESS ||
+	pj_sockaddr_cmp(&addr0, &addr1) ||
+	pj_stun_msg_view_check_msgint(&view, &PASSWORD) != PJ_SUCCESS)
+    {
+	rc = -4620;
+	goto on_return;
+    }
+
+    PJ_LOG(3,(THIS_FILE, "    error response"));
+    rc = pj_stun_msg_writer_init(&w, packet1, sizeof(packet1),
+				 PJ_STUN_BINDING_ERROR_RESPONSE,
+				 PJ_STUN_MAGIC, tsx_id);
+    rc += pj_stun_msg_writer_add_errcode(&w, PJ_STUN_SC_ROLE_CONFLICT, NULL);
+    rc += pj_stun_msg_writer_finish(&w, NULL, PJ_TRUE, &len1);
+    rc += pj_stun_msg_view_parse(&view, packet1, len1,
+				 PJ_STUN_IS_DATAGRAM | PJ_STUN_CHECK_PACKET,
+				 NULL);
+    attr = pj_stun_msg_view_find_attr(&view, PJ_STUN_ATTR_ERROR_CODE, 0);
+    s = pj_stun_get_err_reason(PJ_STUN_SC_ROLE_CONFLICT);
+    if (rc != 0 || !attr ||
+	pj_stun_msg_view_get_errcode(&view, attr, &err_code,
+				     &reason) != PJ_SUCCESS ||
+	err_code != PJ_STUN_SC_ROLE_CONFLICT ||
+	pj_strcmp(&reason, &s) ||
+	pj_stun_msg_view_check_msgint(&view, &PASSWORD) == PJ_SUCCESS)
+    {
+	rc = -4630;
+	goto on_return;
+    }
+
+    rc = 0;
+
+on_return:
+    pj_pool_release(pool);
+    return rc;
+}
+
+
 int stun_test(void)
 {
     int pad, rc;
@@ -978,6 +1187,10 @@ int stun_test(void)
     if (rc != 0)
 	goto on_return;
 
+    rc = view_writer_test();
+    if (rc != 0)
+	goto on_return;
+
 on_return:
     pj_stun_set_padding_char(pad);
     return rc;
@@ -876,22 +876,17 @@ PJ_DEF(pj_status_t) pj_stun_msg_add_sockaddr_attr(pj_pool_t *pool,
     return pj_stun_msg_add_attr(msg, &attr->hdr);
 }
 
-static pj_status_t decode_sockaddr_attr(pj_pool_t *pool, 
-				        const pj_uint8_t *buf, 
-					const pj_stun_msg_hdr *msghdr, 
-				        void **p_attr)
+/*
+ * Parse the generic IP address attribute in the buffer into the attribute
+ * structure, without applying any XOR operation.
+ */
+static pj_status_t parse_sockaddr_attr(const pj_uint8_t *buf,
+				       pj_stun_sockaddr_attr *attr)
 {
-    pj_stun_sockaddr_attr *attr;
     int af;
     unsigned addr_len;
     pj_uint32_t val;
 
-    PJ_CHECK_STACK();
-    
-    PJ_UNUSED_ARG(msghdr);
-
-    /* Create the attribute */
-    attr = PJ_POOL_ZALLOC_T(pool, pj_stun_sockaddr_attr);
     GETATTRHDR(buf, &attr->hdr);
 
     /* Check that the attribute length is valid */
@@ -928,27 +923,17 @@ static pj_status_t decode_sockaddr_attr(pj_pool_t *pool,
 	      buf+ATTR_HDR_LEN+4,
 	      addr_len);
 
-    /* Done */
-    *p_attr = (void*)attr;
-
     return PJ_SUCCESS;
 }
 
 
-static pj_status_t decode_xored_sockaddr_attr(pj_pool_t *pool, 
-					      const pj_uint8_t *buf, 
-					      const pj_stun_msg_hdr *msghdr, 
-					      void **p_attr)
+/*
+ * Apply the XOR operation of XOR-MAPPED-ADDRESS and friends to the
+ * parsed address.
+ */
+static pj_status_t xor_sockaddr_attr(pj_stun_sockaddr_attr *attr,
+				     const pj_stun_msg_hdr *msghdr)
 {
-    pj_stun_sockaddr_attr *attr;
-    pj_status_t status;
-
-    status = decode_sockaddr_attr(pool, buf, msghdr, p_attr);
-    if (status != PJ_SUCCESS)
-	return status;
-
-    attr = *(pj_stun_sockaddr_attr**)p_attr;
-
     attr->xor_ed = PJ_TRUE;
 
     if (attr->sockaddr.addr.sa_family == pj_AF_INET()) {
@@ -979,6 +964,54 @@ static pj_status_t decode_xored_sockaddr_attr(pj_pool_t *pool,
 	return PJNATH_EINVAF;
     }
 
+    return PJ_SUCCESS;
+}
+
+
+static pj_status_t decode_sockaddr_attr(pj_pool_t *pool, 
+				        const pj_uint8_t *buf, 
+					const pj_stun_msg_hdr *msghdr, 
+				        void **p_attr)
+{
+    pj_stun_sockaddr_attr *attr;
+    pj_status_t status;
+
+    PJ_CHECK_STACK();
+    
+    PJ_UNUSED_ARG(msghdr);
+
+    /* Create the attribute */
+    attr = PJ_POOL_ZALLOC_T(pool, pj_stun_sockaddr_attr);
+
+    status = parse_sockaddr_attr(buf, attr);
+    if (status != PJ_SUCCESS)
+	return status;
+
+    /* Done */
+    *p_attr = (void*)attr;
+
+    return PJ_SUCCESS;
+}
+
+
+static pj_status_t decode_xored_sockaddr_attr(pj_pool_t *pool, 
+					      const pj_uint8_t *buf, 
+					      const pj_stun_msg_hdr *msghdr, 
+					      void **p_attr)
+{
+    pj_stun_sockaddr_attr *attr;
+    pj_status_t status;
+
+    status = decode_sockaddr_attr(pool, buf, msghdr, p_attr);
+    if (status != PJ_SUCCESS)
+	return status;
+
+    attr = *(pj_stun_sockaddr_attr**)p_attr;
+
+    status = xor_sockaddr_attr(attr, msghdr);
+    if (status != PJ_SUCCESS)
+	return status;
+
     /* Done */
     *p_attr = attr;
 
@@ -2088,6 +2121,30 @@ static void* clone_binary_attr(pj_pool_t *pool, const void *src)
 
 //////////////////////////////////////////////////////////////////////////////
 
+/*
+ * Generate a new transaction ID.
+ */
+static void generate_tsx_id(pj_uint8_t tsx_id[12])
+{
+    struct transaction_id
+    {
+	pj_uint32_t	    proc_id;
+	pj_uint32_t	    random;
+	pj_uint32_t	    counter;
+    } id;
+    static pj_uint32_t pj_stun_tsx_id_counter;
+
+    if (!pj_stun_tsx_id_counter)
+	pj_stun_tsx_id_counter = pj_rand();
+
+    id.proc_id = pj_getpid();
+    id.random = pj_rand();
+    id.counter = pj_stun_tsx_id_counter++;
+
+    pj_memcpy(tsx_id, &id, 12);
+}
+
+
 /*
  * Initialize a generic STUN message.
  */
@@ -2106,22 +2163,7 @@ PJ_DEF(pj_status_t) pj_stun_msg_init( pj_stun_msg *msg,
     if (tsx_id) {
 	pj_memcpy(&msg->hdr.tsx_id, tsx_id, sizeof(msg->hdr.tsx_id));
     } else {
-	struct transaction_id
-	{
-	    pj_uint32_t	    proc_id;
-	    pj_uint32_t	    random;
-	    pj_uint32_t	    counter;
-	} id;
-	static pj_uint32_t pj_stun_tsx_id_counter;
-
-	if (!pj_stun_tsx_id_counter)
-	    pj_stun_tsx_id_counter = pj_rand();
-
-	id.proc_id = pj_getpid();
-	id.random = pj_rand();
-	id.counter = pj_stun_tsx_id_counter++;
-
-	pj_memcpy(&msg->hdr.tsx_id, &id, sizeof(msg->hdr.tsx_id));
+	generate_tsx_id(msg->hdr.tsx_id);
     }
 
     return PJ_SUCCESS;
@@ -2783,6 +2825,631 @@ PJ_DEF(pj_status_t) pj_stun_msg_encode(pj_stun_msg *msg,
 }
 
 
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * Zero-allocation STUN message view and writer.
+ */
+
+/*
+ * Parse and index STUN packet without allocating memory.
+ */
+PJ_DEF(pj_status_t) pj_stun_msg_view_parse(pj_stun_msg_view *view,
+					   const pj_uint8_t *pdu,
+					   pj_size_t pdu_len,
+					   unsigned options,
+					   pj_size_t *p_parsed_len)
+{
+    pj_bool_t has_msg_int = PJ_FALSE;
+    pj_bool_t has_fingerprint = PJ_FALSE;
+    unsigned pos, end;
+    pj_status_t status;
+
+    PJ_ASSERT_RETURN(view && pdu && pdu_len, PJ_EINVAL);
+
+    if (p_parsed_len)
+	*p_parsed_len = 0;
+
+    /* Check if this is a STUN message, if necessary */
+    if (options & PJ_STUN_CHECK_PACKET) {
+	status = pj_stun_msg_check(pdu, pdu_len, options);
+	if (status != PJ_SUCCESS)
+	    return status;
+    }
+
+    if (pdu_len < sizeof(pj_stun_msg_hdr))
+	return PJNATH_EINSTUNMSGLEN;
+
+    /* Get the header in host byte order */
+    view->hdr.type = GETVAL16H(pdu, 0);
+    view->hdr.length = GETVAL16H(pdu, 2);
+    view->hdr.magic = GETVAL32H(pdu, 4);
+    pj_memcpy(view->hdr.tsx_id, pdu+8, sizeof(view->hdr.tsx_id));
+
+    end = sizeof(pj_stun_msg_hdr) + view->hdr.length;
+    if (end > pdu_len)
+	return PJNATH_EINSTUNMSGLEN;
+
+    view->pdu = pdu;
+    view->pdu_len = end;
+    view->attr_count = 0;
+
+    /* Index the attributes */
+    pos = sizeof(pj_stun_msg_hdr);
+    while (end - pos >= ATTR_HDR_LEN) {
+	unsigned attr_type, attr_len;
+	pj_stun_attr_view *attr;
+
+	attr_type = GETVAL16H(pdu, pos);
+	attr_len = GETVAL16H(pdu, pos+2);
+
+	/* Check length */
+	if (attr_len > end - pos - ATTR_HDR_LEN) {
+	    PJ_LOG(4,(THIS_FILE, "Error parsing STUN message: attribute %s "
+		      "has invalid length",
+		      pj_stun_get_attr_name(attr_type)));
+	    return PJNATH_ESTUNINATTRLEN;
+	}
+
+	/* We must reject the message if it contains a comprehension-required
+	 * attribute which we don't understand.
+	 */
+	if (find_attr_desc(attr_type) == NULL && attr_type <= 0x7FFF) {
+	    PJ_LOG(5,(THIS_FILE, "Unrecognized attribute type 0x%x", 
+		      attr_type));
+	    return PJ_STATUS_FROM_STUN_CODE(PJ_STUN_SC_UNKNOWN_ATTRIBUTE);
+	}
+
+	/* Check the position of MESSAGE-INTEGRITY and FINGERPRINT, and
+	 * their length since they will be read directly from the packet.
+	 */
+	if (attr_type == PJ_STUN_ATTR_MESSAGE_INTEGRITY && !has_fingerprint) {
+	    if (has_msg_int)
+		return PJNATH_ESTUNDUPATTR;
+	    if (attr_len != 20)
+		return PJNATH_ESTUNINATTRLEN;
+	    has_msg_int = PJ_TRUE;
+
+	} else if (attr_type == PJ_STUN_ATTR_FINGERPRINT) {
+	    if (has_fingerprint)
+		return PJNATH_ESTUNDUPATTR;
+	    if (attr_len != 4)
+		return PJNATH_ESTUNINATTRLEN;
+	    has_fingerprint = PJ_TRUE;
+
+	} else if (has_fingerprint) {
+	    /* Only FINGERPRINT may appear after FINGERPRINT */
+	    return PJNATH_ESTUNFINGERPOS;
+	}
+
+	/* Make sure we have rooms for the new attribute */
+	if (view->attr_count >= PJ_STUN_MAX_ATTR)
+	    return PJNATH_ESTUNTOOMANYATTR;
+
+	attr = &view->attr[view->attr_count++];
+	attr->type = (pj_uint16_t)attr_type;
+	attr->length = (pj_uint16_t)attr_len;
+	attr->offset = pos;
+
+	/* Next attribute. Padding of the last attribute may be missing. */
+	pos += ATTR_HDR_LEN + ((attr_len + 3) & (~3));
+	if (pos > end)
+	    pos = end;
+    }
+
+    if (pos != end) {
+	/* Stray trailing bytes */
+	PJ_LOG(4,(THIS_FILE, 
+		  "Error parsing STUN message: unparsed trailing %d bytes",
+		  end - pos));
+	return PJNATH_EINSTUNMSGLEN;
+    }
+
+    if (p_parsed_len)
+	*p_parsed_len = end;
+
+    return PJ_SUCCESS;
+}
+
+
+/*
+ * Find attribute in the message view.
+ */
+PJ_DEF(const pj_stun_attr_view*)
+pj_stun_msg_view_find_attr(const pj_stun_msg_view *view,
+			   int attr_type,
+			   unsigned index)
+{
+    PJ_ASSERT_RETURN(view, NULL);
+
+    for (; index < view->attr_count; ++index) {
+	if (view->attr[index].type == attr_type)
+	    return &view->attr[index];
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Get IP address attribute value from the message view.
+ */
+PJ_DEF(pj_status_t) pj_stun_msg_view_get_sockaddr(
+					    const pj_stun_msg_view *view,
+					    const pj_stun_attr_view *attr,
+					    pj_sockaddr *addr)
+{
+    const struct attr_desc *adesc;
+    pj_stun_sockaddr_attr sa;
+    pj_status_t status;
+
+    PJ_ASSERT_RETURN(view && attr && addr, PJ_EINVAL);
+
+    adesc = find_attr_desc(attr->type);
+    if (adesc == NULL ||
+	(adesc->decode_attr != &decode_sockaddr_attr &&
+	 adesc->decode_attr != &decode_xored_sockaddr_attr))
+    {
+	return PJ_EINVALIDOP;
+    }
+
+    pj_bzero(&sa, sizeof(sa));
+    status = parse_sockaddr_attr(view->pdu + attr->offset, &sa);
+    if (status != PJ_SUCCESS)
+	return status;
+
+    if (adesc->decode_attr == &decode_xored_sockaddr_attr) {
+	status = xor_sockaddr_attr(&sa, &view->hdr);
+	if (status != PJ_SUCCESS)
+	    return status;
+    }
+
+    pj_sockaddr_cp(addr, &sa.sockaddr);
+
+    return PJ_SUCCESS;
+}
+
+
+/*
+ * Get 32bit integer attribute value from the message view.
+ */
+PJ_DEF(pj_status_t) pj_stun_msg_view_get_uint(const pj_stun_msg_view *view,
+					      const pj_stun_attr_view *attr,
+					      pj_uint32_t *value)
+{
+    PJ_ASSERT_RETURN(view && attr && value, PJ_EINVAL);
+
+    if (attr->length != 4)
+	return PJNATH_ESTUNINATTRLEN;
+
+    *value = GETVAL32H(view->pdu, attr->offset + ATTR_HDR_LEN);
+
+    return PJ_SUCCESS;
+}
+
+
+/*
+ * Get 64bit integer attribute value from the message view.
+ */
+PJ_DEF(pj_status_t) pj_stun_msg_view_get_uint64(
+					    const pj_stun_msg_view *view,
+					    const pj_stun_attr_view *attr,
+					    pj_timestamp *value)
+{
+    PJ_ASSERT_RETURN(view && attr && value, PJ_EINVAL);
+
+    if (attr->length != 8)
+	return PJNATH_ESTUNINATTRLEN;
+
+    GETVAL64H(view->pdu, attr->offset + ATTR_HDR_LEN, value);
+
+    return PJ_SUCCESS;
+}
+
+
+/*
+ * Get string attribute value from the message view.
+ */
+PJ_DEF(pj_status_t) pj_stun_msg_view_get_str(const pj_stun_msg_view *view,
+					     const pj_stun_attr_view *attr,
+					     pj_str_t *value)
+{
+    PJ_ASSERT_RETURN(view && attr && value, PJ_EINVAL);
+
+    value->ptr = (char*)view->pdu + attr->offset + ATTR_HDR_LEN;
+    value->slen = attr->length;
+
+    return PJ_SUCCESS;
+}
+
+
+/*
+ * Get ERROR-CODE attribute value from the message view.
+ */
+PJ_DEF(pj_status_t) pj_stun_msg_view_get_errcode(
+					    const pj_stun_msg_view *view,
+					    const pj_stun_attr_view *attr,
+					    int *err_code,
+					    pj_str_t *reason)
+{
+    const pj_uint8_t *buf;
+
+    PJ_ASSERT_RETURN(view && attr && err_code, PJ_EINVAL);
+
+    if (attr->length < 4)
+	return PJNATH_ESTUNINATTRLEN;
+
+    buf = view->pdu + attr->offset;
+    *err_code = buf[6] * 100 + buf[7];
+
+    if (reason) {
+	reason->ptr = (char*)buf + ATTR_HDR_LEN + 4;
+	reason->slen = attr->length - 4;
+    }
+
+    return PJ_SUCCESS;
+}
+
+
+/*
+ * Verify MESSAGE-INTEGRITY directly over the packet.
+ */
+PJ_DEF(pj_status_t) pj_stun_msg_view_check_msgint(
+					    const pj_stun_msg_view *view,
+					    const pj_str_t *key)
+{
+    const pj_stun_attr_view *amsgi;
+    unsigned amsgi_pos;
+    pj_hmac_sha1_context ctx;
+    pj_uint8_t digest[PJ_SHA1_DIGEST_SIZE];
+
+    PJ_ASSERT_RETURN(view && key, PJ_EINVAL);
+
+    amsgi = pj_stun_msg_view_find_attr(view, PJ_STUN_ATTR_MESSAGE_INTEGRITY,
+				       0);
+    if (amsgi == NULL)
+	return PJ_STATUS_FROM_STUN_CODE(PJ_STUN_SC_UNAUTHORIZED);
+
+    /* Length of the message body before MESSAGE-INTEGRITY */
+    amsgi_pos = amsgi->offset - sizeof(pj_stun_msg_hdr);
+
+    pj_hmac_sha1_init(&ctx, (const pj_uint8_t*)key->ptr, 
+		      (unsigned)key->slen);
+
+#if PJ_STUN_OLD_STYLE_MI_FINGERPRINT
+    pj_hmac_sha1_update(&ctx, view->pdu, 20);
+#else
+    /* The message length used in the calculation covers the message up to
+     * and including MESSAGE-INTEGRITY, regardless of what follows it.
+     */
+    {
+	pj_uint8_t hdr_copy[20];
+	pj_memcpy(hdr_copy, view->pdu, 20);
+	PUTVAL16H(hdr_copy, 2, (pj_uint16_t)(amsgi_pos + 24));
+	pj_hmac_sha1_update(&ctx, hdr_copy, 20);
+    }
+#endif	/* PJ_STUN_OLD_STYLE_MI_FINGERPRINT */
+
+    pj_hmac_sha1_update(&ctx, view->pdu + 20, amsgi_pos);
+#if PJ_STUN_OLD_STYLE_MI_FINGERPRINT
+    if ((amsgi_pos+20) & 0x3F) {
+	pj_uint8_t zeroes[64];
+	pj_bzero(zeroes, sizeof(zeroes));
+	pj_hmac_sha1_update(&ctx, zeroes, 64-((amsgi_pos+20) & 0x3F));
+    }
+#endif
+    pj_hmac_sha1_final(&ctx, digest);
+
+    if (pj_memcmp(view->pdu + amsgi->offset + ATTR_HDR_LEN, digest, 20))
+	return PJ_STATUS_FROM_STUN_CODE(PJ_STUN_SC_UNAUTHORIZED);
+
+    return PJ_SUCCESS;
+}
+
+
+/*
+ * Initialize STUN message writer.
+ */
+PJ_DEF(pj_status_t) pj_stun_msg_writer_init(pj_stun_msg_writer *w,
+					    pj_uint8_t *buf,
+					    unsigned buf_size,
+					    unsigned msg_type,
+					    pj_uint32_t magic,
+					    const pj_uint8_t tsx_id[12])
+{
+    PJ_ASSERT_RETURN(w && buf && msg_type, PJ_EINVAL);
+
+    if (buf_size < sizeof(pj_stun_msg_hdr))
+	return PJ_ETOOSMALL;
+
+    w->hdr.type = (pj_uint16_t) msg_type;
+    w->hdr.length = 0;
+    w->hdr.magic = magic;
+    if (tsx_id) {
+	pj_memcpy(w->hdr.tsx_id, tsx_id, sizeof(w->hdr.tsx_id));
+    } else {
+	generate_tsx_id(w->hdr.tsx_id);
+    }
+
+    w->buf = buf;
+    w->buf_size = buf_size;
+
+    PUTVAL16H(buf, 0, w->hdr.type);
+    PUTVAL16H(buf, 2, 0);   /* length will be calculated later */
+    PUTVAL32H(buf, 4, w->hdr.magic);
+    pj_memcpy(buf+8, w->hdr.tsx_id, sizeof(w->hdr.tsx_id));
+
+    w->len = sizeof(pj_stun_msg_hdr);
+
+    return PJ_SUCCESS;
+}
+
+
+/*
+ * Initialize STUN message writer for writing a response.
+ */
+PJ_DEF(pj_status_t) pj_stun_msg_writer_init_response(
+					    pj_stun_msg_writer *w,
+					    pj_uint8_t *buf,
+					    unsigned buf_size,
+					    const pj_stun_msg_view *req,
+					    unsigned err_code,
+					    const pj_str_t *err_msg)
+{
+    unsigned msg_type;
+    pj_status_t status;
+
+    PJ_ASSERT_RETURN(w && buf && req, PJ_EINVAL);
+    PJ_ASSERT_RETURN(PJ_STUN_IS_REQUEST(req->hdr.type), 
+		     PJNATH_EINSTUNMSGTYPE);
+
+    msg_type = req->hdr.type;
+    if (err_code)
+	msg_type |= PJ_STUN_ERROR_RESPONSE_BIT;
+    else
+	msg_type |= PJ_STUN_SUCCESS_RESPONSE_BIT;
+
+    status = pj_stun_msg_writer_init(w, buf, buf_size, msg_type,
+				     req->hdr.magic, req->hdr.tsx_id);
+    if (status != PJ_SUCCESS)
+	return status;
+
+    if (err_code) {
+	status = pj_stun_msg_writer_add_errcode(w, err_code, err_msg);
+	if (status != PJ_SUCCESS)
+	    return status;
+    }
+
+    return PJ_SUCCESS;
+}
+
+
+/*
+ * Append an attribute to the writer using the attribute's encoder.
+ */
+static pj_status_t writer_put_attr(pj_stun_msg_writer *w,
+				   const pj_stun_attr_hdr *attr_hdr,
+				   pj_status_t (*encode_attr)(const void *a,
+							      pj_uint8_t *buf,
+							      unsigned len,
+						const pj_stun_msg_hdr *msghdr,
+							      unsigned *printed))
+{
+    unsigned printed = 0;
+    pj_status_t status;
+
+    PJ_ASSERT_RETURN(w && w->buf, PJ_EINVAL);
+
+    /* MESSAGE-INTEGRITY and FINGERPRINT are written by 
+     * pj_stun_msg_writer_finish()
+     */
+    PJ_ASSERT_RETURN(attr_hdr->type != PJ_STUN_ATTR_MESSAGE_INTEGRITY &&
+		     attr_hdr->type != PJ_STUN_ATTR_FINGERPRINT,
+		     PJ_EINVALIDOP);
+
+    status = (*encode_attr)(attr_hdr, w->buf + w->len, w->buf_size - w->len,
+			    &w->hdr, &printed);
+    if (status != PJ_SUCCESS)
+	return status;
+
+    w->len += printed;
+
+    return PJ_SUCCESS;
+}
+
+
+/*
+ * Write IP address attribute.
+ */
+PJ_DEF(pj_status_t) pj_stun_msg_writer_add_sockaddr(pj_stun_msg_writer *w,
+						    int attr_type,
+						    pj_bool_t xor_ed,
+						    const pj_sockaddr_t *addr,
+						    unsigned addr_len)
+{
+    pj_stun_sockaddr_attr attr;
+    pj_status_t status;
+
+    status = pj_stun_sockaddr_attr_init(&attr, attr_type, xor_ed,
+					addr, addr_len);
+    if (status != PJ_SUCCESS)
+	return status;
+
+    return writer_put_attr(w, &attr.hdr, &encode_sockaddr_attr);
+}
+
+
+/*
+ * Write 32bit integer attribute.
+ */
+PJ_DEF(pj_status_t) pj_stun_msg_writer_add_uint(pj_stun_msg_writer *w,
+						int attr_type,
+						pj_uint32_t value)
+{
+    pj_stun_uint_attr attr;
+
+    INIT_ATTR(&attr, attr_type, 4);
+    attr.value = value;
+
+    return writer_put_attr(w, &attr.hdr, &encode_uint_attr);
+}
+
+
+/*
+ * Write 64bit integer attribute.
+ */
+PJ_DEF(pj_status_t) pj_stun_msg_writer_add_uint64(pj_stun_msg_writer *w,
+						  int attr_type,
+						  const pj_timestamp *value)
+{
+    pj_stun_uint64_attr attr;
+
+    PJ_ASSERT_RETURN(value, PJ_EINVAL);
+
+    INIT_ATTR(&attr, attr_type, 8);
+    attr.value.u64 = value->u64;
+
+    return writer_put_attr(w, &attr.hdr, &encode_uint64_attr);
+}
+
+
+/*
+ * Write string attribute.
+ */
+PJ_DEF(pj_status_t) pj_stun_msg_writer_add_string(pj_stun_msg_writer *w,
+						  int attr_type,
+						  const pj_str_t *value)
+{
+    pj_stun_string_attr attr;
+
+    PJ_ASSERT_RETURN(value, PJ_EINVAL);
+
+    /* The value is not copied, the encoder reads it directly */
+    INIT_ATTR(&attr, attr_type, value->slen);
+    attr.value = *value;
+
+    return writer_put_attr(w, &attr.hdr, &encode_string_attr);
+}
+
+
+/*
+ * Write empty attribute.
+ */
+PJ_DEF(pj_status_t) pj_stun_msg_writer_add_empty(pj_stun_msg_writer *w,
+						 int attr_type)
+{
+    pj_stun_empty_attr attr;
+
+    INIT_ATTR(&attr, attr_type, 0);
+
+    return writer_put_attr(w, &attr.hdr, &encode_empty_attr);
+}
+
+
+/*
+ * Write ERROR-CODE attribute.
+ */
+PJ_DEF(pj_status_t) pj_stun_msg_writer_add_errcode(pj_stun_msg_writer *w,
+						   int err_code,
+						   const pj_str_t *err_reason)
+{
+    pj_stun_errcode_attr attr;
+    char err_buf[80];
+    pj_str_t str;
+
+    PJ_ASSERT_RETURN(err_code, PJ_EINVAL);
+
+    if (err_reason == NULL) {
+	str = pj_stun_get_err_reason(err_code);
+	if (str.slen == 0) {
+	    str.slen = pj_ansi_snprintf(err_buf, sizeof(err_buf),
+				        "Unknown error %d", err_code);
+	    str.ptr = err_buf;
+	}
+	err_reason = &str;
+    }
+
+    INIT_ATTR(&attr, PJ_STUN_ATTR_ERROR_CODE, 4+err_reason->slen);
+    attr.err_code = err_code;
+    attr.reason = *err_reason;
+
+    return writer_put_attr(w, &attr.hdr, &encode_errcode_attr);
+}
+
+
+/*
+ * Append MESSAGE-INTEGRITY and FINGERPRINT, and finalize the length.
+ */
+PJ_DEF(pj_status_t) pj_stun_msg_writer_finish(pj_stun_msg_writer *w,
+					      const pj_str_t *key,
+					      pj_bool_t fingerprint,
+					      pj_size_t *p_msg_len)
+{
+    unsigned trailer_len;
+
+    PJ_ASSERT_RETURN(w && w->buf, PJ_EINVAL);
+
+    /* Make sure both attributes fit before touching the buffer */
+    trailer_len = (key ? 24 : 0) + (fingerprint ? 8 : 0);
+    if (w->buf_size - w->len < trailer_len)
+	return PJ_ETOOSMALL;
+
+    /* The message length must be updated before calculating
+     * MESSAGE-INTEGRITY and FINGERPRINT. See pj_stun_msg_encode().
+     */
+#if PJ_STUN_OLD_STYLE_MI_FINGERPRINT
+    PUTVAL16H(w->buf, 2, (pj_uint16_t)(w->len - 20 + trailer_len));
+#else
+    PUTVAL16H(w->buf, 2, (pj_uint16_t)(w->len - 20 + (key ? 24 : 0)));
+#endif
+
+    if (key) {
+	pj_hmac_sha1_context ctx;
+
+	pj_hmac_sha1_init(&ctx, (const pj_uint8_t*)key->ptr, 
+			  (unsigned)key->slen);
+	pj_hmac_sha1_update(&ctx, w->buf, w->len);
+#if PJ_STUN_OLD_STYLE_MI_FINGERPRINT
+	if (w->len & 0x3F) {
+	    pj_uint8_t zeroes[64];
+	    pj_bzero(zeroes, sizeof(zeroes));
+	    pj_hmac_sha1_update(&ctx, zeroes, 64-(w->len & 0x3F));
+	}
+#endif
+	/* Write the digest directly into the attribute value */
+	PUTVAL16H(w->buf, w->len, PJ_STUN_ATTR_MESSAGE_INTEGRITY);
+	PUTVAL16H(w->buf, w->len+2, 20);
+	pj_hmac_sha1_final(&ctx, w->buf + w->len + ATTR_HDR_LEN);
+
+	w->len += 24;
+    }
+
+    if (fingerprint) {
+	pj_uint32_t crc;
+
+#if !PJ_STUN_OLD_STYLE_MI_FINGERPRINT
+	PUTVAL16H(w->buf, 2, (pj_uint16_t)(w->len - 20 + 8));
+#endif
+	crc = pj_crc32_calc(w->buf, w->len);
+	crc ^= STUN_XOR_FINGERPRINT;
+
+	PUTVAL16H(w->buf, w->len, PJ_STUN_ATTR_FINGERPRINT);
+	PUTVAL16H(w->buf, w->len+2, 4);
+	PUTVAL32H(w->buf, w->len+4, crc);
+
+	w->len += 8;
+    }
+
+    /* Final message length */
+    w->hdr.length = (pj_uint16_t)(w->len - 20);
+    PUTVAL16H(w->buf, 2, w->hdr.length);
+
+    if (p_msg_len)
+	*p_msg_len = w->len;
+
+    return PJ_SUCCESS;
+}
+
+
 /*
  * Find STUN attribute in the STUN message, starting from the specified
  * index.
@@ -101,7 +101,8 @@ int main(int argc, char *argv[])
     unsigned opt = 0;
     unsigned latency_ms = 25;
     unsigned tail_ms = TAIL_LENGTH;
-    pj_timestamp t0, t1;
+    pj_timestamp t0, t1, e0, e1, ec_time;
+    pj_uint32_t ec_usec;
     int i, repeat=1, interactive=0, c;
 
     pj_optind = 0;
@@ -235,6 +236,7 @@ int main(int argc, char *argv[])
     /* Processing loop */
     play_frame.buf = pj_pool_alloc(pool, PJMEDIA_PIA_SPF(&wav_play->info)<<1);
     rec_frame.buf = pj_pool_alloc(pool, PJMEDIA_PIA_SPF(&wav_play->info)<<1);
+    pj_bzero(&ec_time, sizeof(ec_time));
     pj_get_timestamp(&t0);
     for (i=0; i < repeat; ++i) {
 	for (;;) {
@@ -243,14 +245,22 @@ int main(int argc, char *argv[])
 	    if (status != PJ_SUCCESS)
 		break;
 
+	    pj_get_timestamp(&e0);
 	    status = pjmedia_echo_playback(ec, (short*)play_frame.buf);
+	    pj_get_timestamp(&e1);
+	    pj_sub_timestamp(&e1, &e0);
+	    pj_add_timestamp(&ec_time, &e1);
 
 	    rec_frame.size = PJMEDIA_PIA_SPF(&wav_play->info) << 1;
 	    status = pjmedia_port_get_frame(wav_rec, &rec_frame);
 	    if (status != PJ_SUCCESS)
 		break;
 
+	    pj_get_timestamp(&e0);
 	    status = pjmedia_echo_capture(ec, (short*)rec_frame.buf, 0);
+	    pj_get_timestamp(&e1);
+	    pj_sub_timestamp(&e1, &e0);
+	    pj_add_timestamp(&ec_time, &e1);
 
 	    //status = pjmedia_echo_cancel(ec, (short*)rec_frame.buf, 
 	    //			     (short*)play_frame.buf, 0, NULL);
@@ -267,7 +277,20 @@ int main(int argc, char *argv[])
 	 (PJMEDIA_PIA_SRATE(&wav_out->info) * PJMEDIA_PIA_CCNT(&wav_out->info));
     PJ_LOG(3,(THIS_FILE, "Processed %3d.%03ds audio",
 	      i / 1000, i % 1000));
-    PJ_LOG(3,(THIS_FILE, "Completed in %u msec\n", pj_elapsed_msec(&t0, &t1)));
+    PJ_LOG(3,(THIS_FILE, "Completed in %u msec", pj_elapsed_msec(&t0, &t1)));
+
+    /* CPU used by the echo canceller alone, excluding the WAV file I/O,
+     * as the percentage of one CPU core needed by a single stream.
+     */
+    pj_bzero(&e0, sizeof(e0));
+    ec_usec = pj_elapsed_usec(&e0, &ec_time);
+    if (i > 0) {
+	unsigned pct = (unsigned)((pj_uint64_t)ec_usec * 100 / i);
+	PJ_LOG(3,(THIS_FILE, "EC processing %u usec, CPU per stream %u.%03u%%"
+			     ", %u streams per core\n",
+		  ec_usec, pct / 1000, pct % 1000,
+		  ec_usec ? (unsigned)((pj_uint64_t)i * 1000 / ec_usec) : 0));
+    }
 
     /* Destroy file port(s) */
     status = pjmedia_port_destroy( wav_play );
@@ -149,6 +149,7 @@ struct test_cfg
     int		     rx_jb_min_pre;	/* JB minimum prefetch (ms) */
     int		     rx_jb_max_pre;	/* JB maximum prefetch (ms) */
     int		     rx_jb_max;		/* JB maximum size (ms)	    */
+    pjmedia_jb_engine rx_jb_engine;	/* JB delay estimation engine */
 };
 
 /*
@@ -333,6 +334,7 @@ static pj_status_t stream_init(const struct stream_cfg *cfg, struct stream **p_s
 	si.jb_min_pre = g_app.cfg.rx_jb_min_pre;
 	si.jb_max_pre = g_app.cfg.rx_jb_max_pre;
 	si.jb_max = g_app.cfg.rx_jb_max;
+	si.jb_engine = g_app.cfg.rx_jb_engine;
     }
 
     /* Get the codec info and param */
@@ -857,6 +859,7 @@ enum {
     OPT_MIN_LOST_BURST = 1,
     OPT_MAX_LOST_BURST,
     OPT_LOSS_CORR,
+    OPT_JB_ENGINE,
 };
 
 
@@ -910,6 +913,8 @@ static void usage(void)
     printf("  --jb-max-pre, -%c MSEC  Jitter buffer maximum prefetch delay in msec\n", OPT_JB_MAX_PRE);
     printf("  --jb-max, -%c MSEC      Set maximum delay that can be accomodated by the\n", OPT_JB_MAX);
     printf("                         jitter buffer msec.\n");
+    printf("  --jb-engine NAME       Jitter buffer engine, 'burst' or 'percentile'.\n");
+    printf("                         Default: burst\n");
 }
 
 
@@ -936,6 +941,7 @@ static int init_options(int argc, char *argv[])
 	{ "jb-min-pre",     1, 0, OPT_JB_MIN_PRE },
 	{ "jb-max-pre",     1, 0, OPT_JB_MAX_PRE },
 	{ "jb-max",	    1, 0, OPT_JB_MAX },
+	{ "jb-engine",	    1, 0, OPT_JB_ENGINE },
 	{ "help",	    0, 0, OPT_HELP},
 	{ NULL, 0, 0, 0 },
     };
@@ -966,6 +972,7 @@ static int init_options(int argc, char *argv[])
     g_app.cfg.rx_jb_min_pre = -1;
     g_app.cfg.rx_jb_max_pre = -1;
     g_app.cfg.rx_jb_max = -1;
+    g_app.cfg.rx_jb_engine = PJMEDIA_JB_ENGINE_BURST;
 
     /* Build format */
     format[0] = '\0';
@@ -1058,6 +1065,16 @@ static int init_options(int argc, char *argv[])
 	case OPT_JB_MAX:
 	    g_app.cfg.rx_jb_max = atoi(pj_optarg);
 	    break;
+	case OPT_JB_ENGINE:
+	    if (pj_ansi_stricmp(pj_optarg, "burst") == 0) {
+		g_app.cfg.rx_jb_engine = PJMEDIA_JB_ENGINE_BURST;
+	    } else if (pj_ansi_stricmp(pj_optarg, "percentile") == 0) {
+		g_app.cfg.rx_jb_engine = PJMEDIA_JB_ENGINE_PERCENTILE;
+	    } else {
+		puts("Error: Invalid jitter buffer engine?");
+		return 1;
+	    }
+	    break;
 	case OPT_HELP:
 	    usage();
 	    return 1;
@@ -1119,6 +1136,9 @@ int main(int argc, char *argv[])
 	      g_app.cfg.rx_jb_min_pre,
 	      g_app.cfg.rx_jb_max_pre,
 	      g_app.cfg.rx_jb_max));
+    PJ_LOG(3,(THIS_FILE, " RX jb engine:%s",
+	      (g_app.cfg.rx_jb_engine == PJMEDIA_JB_ENGINE_PERCENTILE ?
+	       "percentile" : "burst")));
     PJ_LOG(3,(THIS_FILE, " RX sound burst:%d frames",
 	      g_app.cfg.rx_snd_burst));
     PJ_LOG(3,(THIS_FILE, " DTX=%d, PLC=%d",
@@ -1133,6 +1153,17 @@ int main(int argc, char *argv[])
 	      g_app.tx->state.tx.total_tx,
 	      g_app.tx->state.tx.total_lost,
 	      (float)(g_app.tx->state.tx.total_lost * 100.0 / g_app.tx->state.tx.total_tx)));
+    {
+	pjmedia_jb_state jstate;
+
+	pjmedia_stream_get_stat_jbuf(g_app.rx->strm, &jstate);
+	PJ_LOG(3,(THIS_FILE, " RX jb delay min/avg/max=%u/%u/%ums, "
+			     "dev=%ums",
+		  jstate.min_delay, jstate.avg_delay, jstate.max_delay,
+		  jstate.dev_delay));
+	PJ_LOG(3,(THIS_FILE, " RX jb lost=%u, discard=%u, empty=%u",
+		  jstate.lost, jstate.discard, jstate.empty));
+    }
 
     /* Done */
     test_destroy();
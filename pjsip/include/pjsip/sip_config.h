@@ -798,6 +798,47 @@ PJ_INLINE(pjsip_cfg_t*) pjsip_cfg(void)
 #endif
 
 
+/**
+ * Specify whether #pjsip_resolve() should resolve both DNS A and AAAA
+ * records of the SIP server, regardless of the IP version of the target
+ * transport type. The DNS A and AAAA queries are run concurrently, and the
+ * resolved addresses of each server are interleaved between the address
+ * families starting with IPv6, as recommended by RFC 8305 section 4, so
+ * that failing over to the next address also switches the address family.
+ *
+ * Note that the IPv6 addresses can only be used when an IPv6 SIP transport
+ * has been created, otherwise they will be skipped by the failover.
+ *
+ * This is disabled by default since the IPv6 address is tried first: the
+ * failover only happens on transport error, so a request sent over UDP to
+ * an unreachable IPv6 address waits for the transaction timeout instead
+ * of moving on to the IPv4 address.
+ *
+ * Default: 0 (only resolve the address family of the transport type)
+ *
+ * @see PJSIP_HAS_RESOLVER
+ */
+#ifndef PJSIP_RESOLVE_DUAL_STACK
+#   define PJSIP_RESOLVE_DUAL_STACK	    0
+#endif
+
+
+/**
+ * Specify whether #pjsip_resolve() should start the fallback DNS A (or
+ * AAAA) query of the target domain together with its DNS SRV query,
+ * instead of only after the DNS SRV query has failed. This saves a round
+ * of DNS timeouts for domains without SRV records, at the cost of an
+ * extra DNS query for domains that do have them.
+ *
+ * Default: 1
+ *
+ * @see PJSIP_HAS_RESOLVER
+ */
+#ifndef PJSIP_RESOLVE_SRV_FALLBACK_PARALLEL
+#   define PJSIP_RESOLVE_SRV_FALLBACK_PARALLEL  1
+#endif
+
+
 /**
  * Enable TLS SIP transport support. For most systems this means that
  * OpenSSL must be installed.
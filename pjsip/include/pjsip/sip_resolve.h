@@ -61,19 +61,21 @@ PJ_BEGIN_DECL
  *    is specified. If the transport is not specified, UDP with port number
  *    5060 will be used.
  *  - if target name is not an IP address but it contains port number,
- *    then the target name is resolved with DNS A (or AAAA, when IPv6 is
- *    supported in the future) query, and the port is taken from the
+ *    then the target name is resolved with DNS A (or AAAA, for IPv6
+ *    transport type) query, and the port is taken from the
  *    port number argument. The callback will be called once the DNS A
  *    resolution completes. If the DNS A resolution returns multiple IP
  *    addresses, these IP addresses will be returned to the caller.
  *  - if target name is not an IP address and port number is not specified,
  *    DNS SRV resolution will be performed for the specified name and
  *    transport type (or UDP when transport is not specified), 
- *    then followed by DNS A (or AAAA, when IPv6 is supported)
+ *    then followed by DNS A (or AAAA, for IPv6 transport type)
  *    resolution for each target in the SRV record. If DNS SRV
  *    resolution returns error, DNS A (or AAAA) resolution will be
  *    performed for the original target (it is assumed that the target domain
- *    does not support SRV records). Upon successful completion, 
+ *    does not support SRV records). With
+ *    #PJSIP_RESOLVE_SRV_FALLBACK_PARALLEL, this query is started together
+ *    with the DNS SRV query instead. Upon successful completion, 
  *    application callback will be called with each IP address of the
  *    target selected based on the load-balancing and fail-over criteria
  *    below.
@@ -115,6 +117,11 @@ PJ_BEGIN_DECL
  *    of the servers with DNS A (or AAAA) resolution.
  *  - When multiple DNS SRV records are returned, parallel DNS A (or AAAA)
  *    queries will be issued simultaneously.
+ *  - With #PJSIP_RESOLVE_DUAL_STACK, both DNS A and AAAA records are
+ *    resolved concurrently, and the addresses of each server are
+ *    interleaved between IPv6 and IPv4 (RFC 8305), so that failover to
+ *    the next address also switches the address family. The AAAA answer
+ *    is only waited for #PJ_DNS_RESOLUTION_DELAY msec after the A answer.
  *  - The PJLIB-UTIL DNS resolver provides additional functionality such as
  *    response caching, query aggregation, parallel nameservers, fallback
  *    nameserver, etc., which will be described below.
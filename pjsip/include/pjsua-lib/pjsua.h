@@ -4993,6 +4993,29 @@ pjsua_call_get_med_transport_info(pjsua_call_id call_id,
                                   unsigned med_idx,
                                   pjmedia_transport_info *t);
 
+/**
+ * Pair two calls for audio media relay. Whenever both calls have an
+ * active bidirectional audio stream and the negotiated codecs of both
+ * calls match, the RTP packets received on one call are forwarded to
+ * the other call without being decoded, re-encoded or passing through
+ * the conference bridge (see #pjmedia_stream_set_relay()). The relay is
+ * re-evaluated after every SDP negotiation of either call, so it starts
+ * automatically once the SDP answers match, and audio falls back to the
+ * conference bridge when they no longer do (for example when a call is
+ * put on hold or renegotiates to a different codec).
+ *
+ * The pairing is removed automatically when either call is
+ * disconnected.
+ *
+ * @param call_id	The call identification.
+ * @param peer_call_id	The call to relay audio with, or PJSUA_INVALID_ID
+ *			to remove the existing pairing.
+ *
+ * @return		PJ_SUCCESS on success or the appropriate error.
+ */
+PJ_DECL(pj_status_t) pjsua_call_set_media_relay(pjsua_call_id call_id,
+						pjsua_call_id peer_call_id);
+
 
 
 /**
@@ -5657,6 +5680,46 @@ struct pjsua_media_config
      */
     unsigned		thread_cnt;
 
+    /**
+     * Specify the number of media workers. Each media worker has its own
+     * ioqueue and thread, and the RTP/RTCP sockets of a media transport
+     * are all assigned to one worker, so that the packets of a stream are
+     * always handled by the same thread. When zero, the RTP/RTCP sockets
+     * use the ioqueue polled by the \a thread_cnt threads.
+     *
+     * Media workers are only used by UDP media transports.
+     *
+     * Default: 0
+     */
+    unsigned		worker_cnt;
+
+    /**
+     * Bind each media worker thread to its own CPU, see \a worker_cnt.
+     *
+     * Default: PJ_FALSE
+     */
+    pj_bool_t		worker_cpu_affinity;
+
+    /**
+     * Play the files of file players and playlists from a shared WAV
+     * cache, so that players which play the same file share one copy of
+     * its data. See @ref PJMEDIA_WAV_CACHE. Files which are modified while
+     * pjsua is running are not reloaded.
+     *
+     * Default: PJ_FALSE
+     */
+    pj_bool_t		use_wav_cache;
+
+    /**
+     * Write the files of WAV recorders from a background I/O thread, so
+     * that the conference bridge never waits for the disk. See
+     * #pjmedia_wav_writer_port_create_async(). If the disk cannot keep
+     * up, the recorders drop audio instead of delaying the bridge.
+     *
+     * Default: PJ_FALSE
+     */
+    pj_bool_t		async_recorder;
+
     /**
      * Media quality, 0-10, according to this table:
      *   5-10: resampling use large filter,
@@ -5683,6 +5746,17 @@ struct pjsua_media_config
      */
     pj_bool_t		no_vad;
 
+    /**
+     * Run silence detection in the conference bridge, so that silent
+     * participants are not mixed and audio that would only carry silence
+     * to a participant is not resampled and encoded. This is most useful
+     * for servers hosting many calls, together with codec VAD. See
+     * #PJMEDIA_CONF_VAD.
+     *
+     * Default: 0 (no)
+     */
+    pj_bool_t		conf_vad;
+
     /**
      * iLBC mode (20 or 30).
      *
@@ -5764,6 +5838,16 @@ struct pjsua_media_config
      */
     int			jb_max;
 
+    /**
+     * Jitter buffer delay estimation engine. With the percentile engine,
+     * the jitter buffer targets a high percentile of the packet delay
+     * variation and the stream time-stretches the playout towards it,
+     * instead of discarding frames.
+     *
+     * Default: PJMEDIA_JB_ENGINE_BURST
+     */
+    pjmedia_jb_engine	jb_engine;
+
     /**
      * Enable ICE
      */
@@ -147,6 +147,8 @@ struct pjsua_call
     pj_bool_t		 hanging_up;/**< Is call in the process of hangup?  */
 
     int			 audio_idx; /**< First active audio media.	    */
+    pjsua_call_id	 relay_call_id;/**< Call to relay audio RTP with,
+					 or PJSUA_INVALID_ID.		    */
     pj_mutex_t          *med_ch_mutex;/**< Media channel callback's mutex.  */
     pjsua_med_tp_state_cb   med_ch_cb;/**< Media channel callback.	    */
     pjsua_med_tp_state_info med_ch_info;/**< Media channel info.            */
@@ -492,10 +494,12 @@ struct pjsua_data
     /* File players: */
     unsigned		 player_cnt;/**< Number of file players.	*/
     pjsua_file_data	 player[PJSUA_MAX_PLAYERS];/**< Array of players.*/
+    pjmedia_wav_cache	*wav_cache; /**< Shared WAV cache, if enabled.	*/
 
     /* File recorders: */
     unsigned		 rec_cnt;   /**< Number of file recorders.	*/
     pjsua_file_data	 recorder[PJSUA_MAX_RECORDERS];/**< Array of recs.*/
+    pjmedia_wav_writer_io *rec_io;  /**< Recorder I/O thread, if enabled.*/
 
     /* Video windows */
 #if PJSUA_HAS_VIDEO
@@ -814,6 +818,7 @@ pj_status_t pjsua_aud_subsys_init(void);
 pj_status_t pjsua_aud_subsys_start(void);
 pj_status_t pjsua_aud_subsys_destroy(void);
 void pjsua_aud_stop_stream(pjsua_call_media *call_med);
+void pjsua_aud_update_relay(pjsua_call *call);
 pj_status_t pjsua_aud_channel_update(pjsua_call_media *call_med,
                                      pj_pool_t *tmp_pool,
                                      pjmedia_stream_info *si,
@@ -30,6 +30,7 @@
 #include <pj/pool.h>
 #include <pj/rand.h>
 #include <pj/string.h>
+#include <pj/timer.h>
 
 
 #define THIS_FILE   "sip_resolve.c"
@@ -50,9 +51,11 @@ struct query
     char		    *objname;
 
     pj_dns_type		     query_type;
+    pj_dns_resolver	    *resolver;
     void		    *token;
     pjsip_resolver_callback *cb;
     pj_dns_async_query	    *object;
+    pj_dns_async_query	    *object6;
     pj_status_t		     last_error;
 
     /* Original request: */
@@ -64,6 +67,18 @@ struct query
     /* NAPTR records: */
     unsigned		     naptr_cnt;
     struct naptr_target	     naptr[8];
+
+    /* Outstanding DNS A/AAAA queries and their results: */
+    unsigned		     pending;
+    unsigned		     addr_cnt;
+    pj_in_addr		     addr[ADDR_MAX_COUNT];
+    unsigned		     addr6_cnt;
+    pj_in6_addr		     addr6[ADDR_MAX_COUNT];
+
+    /* Resolution delay timer, to stop waiting for the DNS AAAA answer
+     * once the DNS A answer has arrived.
+     */
+    pj_timer_entry	     timer;
 };
 
 
@@ -80,6 +95,10 @@ static void srv_resolver_cb(void *user_data,
 static void dns_a_callback(void *user_data,
 			   pj_status_t status,
 			   pj_dns_parsed_packet *response);
+static void dns_aaaa_callback(void *user_data,
+			      pj_status_t status,
+			      pj_dns_parsed_packet *response);
+static void dns_addr_done(struct query *query);
 
 
 /*
@@ -195,6 +214,7 @@ PJ_DEF(void) pjsip_resolve( pjsip_resolver_t *resolver,
     int ip_addr_ver;
     struct query *query;
     pjsip_transport_type_e type = target->type;
+    pj_bool_t want_a, want_aaaa;
 
     /* If an external implementation has been provided use it instead */
     if (resolver->ext_res) {
@@ -339,9 +359,18 @@ PJ_DEF(void) pjsip_resolve( pjsip_resolver_t *resolver,
     /* Target is not an IP address so we need to resolve it. */
 #if PJSIP_HAS_RESOLVER
 
+    /* Select the address families to resolve. The transport type of the
+     * query is kept as IPv4 type, the IPv6 flag is added to the type of
+     * IPv6 entries in the result.
+     */
+    want_aaaa = PJSIP_RESOLVE_DUAL_STACK || (type & PJSIP_TRANSPORT_IPV6);
+    want_a = PJSIP_RESOLVE_DUAL_STACK || !(type & PJSIP_TRANSPORT_IPV6);
+    type = (pjsip_transport_type_e)((int)type & ~PJSIP_TRANSPORT_IPV6);
+
     /* Build the query state */
     query = PJ_POOL_ZALLOC_T(pool, struct query);
     query->objname = THIS_FILE;
+    query->resolver = resolver->res;
     query->token = token;
     query->cb = cb;
     query->req.target = *target;
@@ -401,19 +430,63 @@ PJ_DEF(void) pjsip_resolve( pjsip_resolver_t *resolver,
 	       target->addr.port));
 
     if (query->query_type == PJ_DNS_TYPE_SRV) {
+	unsigned option = 0;
+
+#if PJSIP_RESOLVE_SRV_FALLBACK_PARALLEL
+	option |= PJ_DNS_SRV_FALLBACK_PARALLEL;
+#endif
+
+	if (want_a)
+	    option |= PJ_DNS_SRV_FALLBACK_A;
+	if (want_aaaa) {
+	    option |= PJ_DNS_SRV_FALLBACK_AAAA;
+	    option |= (want_a ? PJ_DNS_SRV_RESOLVE_AAAA :
+				PJ_DNS_SRV_RESOLVE_AAAA_ONLY);
+	}
 
 	status = pj_dns_srv_resolve(&query->naptr[0].name,
 				    &query->naptr[0].res_type,
 				    query->req.def_port, pool, resolver->res,
-				    PJ_TRUE, query, &srv_resolver_cb, NULL);
+				    option, query, &srv_resolver_cb, NULL);
 
     } else if (query->query_type == PJ_DNS_TYPE_A) {
 
-	status = pj_dns_resolver_start_query(resolver->res, 
-					     &query->naptr[0].name,
-					     PJ_DNS_TYPE_A, 0, 
-					     &dns_a_callback,
-    					     query, &query->object);
+	/* Start DNS A and AAAA queries concurrently. One extra pending
+	 * count is held while the queries are being started, since the
+	 * callback will be called synchronously when the answer is
+	 * available in the cache.
+	 */
+	query->pending = 1;
+
+	if (want_aaaa) {
+	    ++query->pending;
+	    status = pj_dns_resolver_start_query(resolver->res, 
+						 &query->naptr[0].name,
+						 PJ_DNS_TYPE_AAAA, 0, 
+						 &dns_aaaa_callback,
+						 query, &query->object6);
+	    if (status != PJ_SUCCESS) {
+		query->last_error = status;
+		--query->pending;
+	    }
+	}
+
+	if (want_a) {
+	    ++query->pending;
+	    status = pj_dns_resolver_start_query(resolver->res, 
+						 &query->naptr[0].name,
+						 PJ_DNS_TYPE_A, 0, 
+						 &dns_a_callback,
+						 query, &query->object);
+	    if (status != PJ_SUCCESS) {
+		query->last_error = status;
+		--query->pending;
+	    }
+	}
+
+	/* Callback may be called here (also with failure status) */
+	dns_addr_done(query);
+	return;
 
     } else {
 	pj_assert(!"Unexpected");
@@ -429,6 +502,8 @@ PJ_DEF(void) pjsip_resolve( pjsip_resolver_t *resolver,
     PJ_UNUSED_ARG(pool);
     PJ_UNUSED_ARG(query);
     PJ_UNUSED_ARG(srv_name);
+    PJ_UNUSED_ARG(want_a);
+    PJ_UNUSED_ARG(want_aaaa);
 #endif /* PJSIP_HAS_RESOLVER */
 
 on_error:
@@ -446,23 +521,154 @@ on_error:
 
 #if PJSIP_HAS_RESOLVER
 
-/* 
- * This callback is called when target is resolved with DNS A query.
+/*
+ * Append the addresses of a server to the server list, interleaving the
+ * address families starting with IPv6 as recommended by RFC 8305
+ * section 4.
  */
-static void dns_a_callback(void *user_data,
-			   pj_status_t status,
-			   pj_dns_parsed_packet *pkt)
+static void add_server_addresses(pjsip_server_addresses *srv,
+				 pjsip_transport_type_e type,
+				 unsigned priority,
+				 unsigned weight,
+				 pj_uint16_t port,
+				 unsigned addr_cnt,
+				 const pj_in_addr addr[],
+				 unsigned addr6_cnt,
+				 const pj_in6_addr addr6[])
+{
+    unsigned i = 0, j = 0;
+
+    while ((i < addr6_cnt || j < addr_cnt) &&
+	   srv->count < PJSIP_MAX_RESOLVED_ADDRESSES)
+    {
+	pj_bool_t use_ipv6;
+
+	/* Prefer IPv6 first, then alternate the address family */
+	if (i == addr6_cnt)
+	    use_ipv6 = PJ_FALSE;
+	else if (j == addr_cnt)
+	    use_ipv6 = PJ_TRUE;
+	else
+	    use_ipv6 = (i <= j);
+
+	srv->entry[srv->count].priority = priority;
+	srv->entry[srv->count].weight = weight;
+
+	if (use_ipv6) {
+	    srv->entry[srv->count].type = (pjsip_transport_type_e)
+					  ((int)type + PJSIP_TRANSPORT_IPV6);
+	    srv->entry[srv->count].addr_len = sizeof(pj_sockaddr_in6);
+	    pj_sockaddr_init(pj_AF_INET6(), &srv->entry[srv->count].addr,
+			     NULL, port);
+	    srv->entry[srv->count].addr.ipv6.sin6_addr = addr6[i++];
+	} else {
+	    srv->entry[srv->count].type = type;
+	    srv->entry[srv->count].addr_len = sizeof(pj_sockaddr_in);
+	    pj_sockaddr_in_init(&srv->entry[srv->count].addr.ipv4,
+				0, port);
+	    srv->entry[srv->count].addr.ipv4.sin_addr.s_addr =
+		addr[j++].s_addr;
+	}
+
+	++srv->count;
+    }
+}
+
+
+/* Resolution delay has elapsed, complete without the DNS AAAA answer */
+static void on_resolution_delay(pj_timer_heap_t *timer_heap,
+				pj_timer_entry *entry)
+{
+    struct query *query = (struct query*) entry->user_data;
+
+    PJ_UNUSED_ARG(timer_heap);
+
+    entry->id = 0;
+    if (query->object6 == NULL)
+	return;
+
+    PJ_LOG(5,(query->objname, 
+	      "Resolution delay elapsed, not waiting for DNS AAAA answer"));
+
+    pj_dns_resolver_cancel_query(query->object6, PJ_FALSE);
+    query->object6 = NULL;
+    dns_addr_done(query);
+}
+
+
+/* Called when one of the DNS A/AAAA queries has completed */
+static void dns_addr_done(struct query *query)
 {
-    struct query *query = (struct query*) user_data;
     pjsip_server_addresses srv;
-    pj_dns_a_record rec;
+    pj_status_t status;
+
+    pj_assert(query->pending > 0);
+    if (--query->pending != 0) {
+	/* Only wait a little longer for the AAAA answer once the A answer
+	 * has arrived (RFC 8305 section 3).
+	 */
+	if (PJ_DNS_RESOLUTION_DELAY > 0 && query->pending == 1 &&
+	    query->object6 && query->addr_cnt != 0 && !query->timer.id)
+	{
+	    pj_time_val delay;
+
+	    delay.sec = 0;
+	    delay.msec = PJ_DNS_RESOLUTION_DELAY;
+	    pj_time_val_normalize(&delay);
+
+	    pj_timer_entry_init(&query->timer, 1, query, &on_resolution_delay);
+	    if (pj_timer_heap_schedule(pj_dns_resolver_get_timer(
+					   query->resolver),
+				       &query->timer, &delay) != PJ_SUCCESS)
+	    {
+		query->timer.id = 0;
+	    }
+	}
+	return;
+    }
+
+    if (query->timer.id) {
+	pj_timer_heap_cancel(pj_dns_resolver_get_timer(query->resolver),
+			     &query->timer);
+	query->timer.id = 0;
+    }
+
+    if (query->addr_cnt == 0 && query->addr6_cnt == 0) {
+	status = query->last_error;
+	if (status == PJ_SUCCESS)
+	    status = PJLIB_UTIL_EDNSNOANSWERREC;
+
+	/* Call the callback */
+	(*query->cb)(status, query->token, NULL);
+	return;
+    }
+
+    /* Build server addresses and call callback */
+    srv.count = 0;
+    add_server_addresses(&srv, query->naptr[0].type, 0, 0,
+			 (pj_uint16_t)query->req.def_port,
+			 query->addr_cnt, query->addr,
+			 query->addr6_cnt, query->addr6);
+
+    /* Call the callback */
+    (*query->cb)(PJ_SUCCESS, query->token, &srv);
+}
+
+
+/* Save the addresses of DNS A/AAAA response */
+static void dns_addr_response(struct query *query,
+			      pj_dns_type type,
+			      pj_status_t status,
+			      pj_dns_parsed_packet *pkt)
+{
+    pj_dns_addr_record rec;
     unsigned i;
 
     rec.addr_count = 0;
 
     /* Parse the response */
     if (status == PJ_SUCCESS) {
-	status = pj_dns_parse_a_response(pkt, &rec);
+	status = pj_dns_parse_addr_response(pkt, &rec);
     }
 
     if (status != PJ_SUCCESS) {
@@ -470,33 +676,53 @@ static void dns_a_callback(void *user_data,
 
 	/* Log error */
 	pj_strerror(status, errmsg, sizeof(errmsg));
-	PJ_LOG(4,(query->objname, "DNS A record resolution failed: %s", 
-		  errmsg));
+	PJ_LOG(4,(query->objname, "DNS %s record resolution failed: %s", 
+		  pj_dns_get_type_name(type), errmsg));
 
-	/* Call the callback */
-	(*query->cb)(status, query->token, NULL);
+	query->last_error = status;
+	dns_addr_done(query);
 	return;
     }
 
-    /* Build server addresses and call callback */
-    srv.count = 0;
-    for (i = 0; i < rec.addr_count &&
-		srv.count < PJSIP_MAX_RESOLVED_ADDRESSES; ++i)
-    {
-	srv.entry[srv.count].type = query->naptr[0].type;
-	srv.entry[srv.count].priority = 0;
-	srv.entry[srv.count].weight = 0;
-	srv.entry[srv.count].addr_len = sizeof(pj_sockaddr_in);
-	pj_sockaddr_in_init(&srv.entry[srv.count].addr.ipv4,
-			    0, (pj_uint16_t)query->req.def_port);
-	srv.entry[srv.count].addr.ipv4.sin_addr.s_addr =
-	    rec.addr[i].s_addr;
-
-	++srv.count;
+    for (i = 0; i < rec.addr_count; ++i) {
+	if (rec.addr[i].af == pj_AF_INET()) {
+	    if (query->addr_cnt < ADDR_MAX_COUNT)
+		query->addr[query->addr_cnt++] = rec.addr[i].ip.v4;
+	} else {
+	    if (query->addr6_cnt < ADDR_MAX_COUNT)
+		query->addr6[query->addr6_cnt++] = rec.addr[i].ip.v6;
+	}
     }
 
-    /* Call the callback */
-    (*query->cb)(PJ_SUCCESS, query->token, &srv);
+    dns_addr_done(query);
+}
+
+
+/* 
+ * This callback is called when target is resolved with DNS A query.
+ */
+static void dns_a_callback(void *user_data,
+			   pj_status_t status,
+			   pj_dns_parsed_packet *pkt)
+{
+    struct query *query = (struct query*) user_data;
+
+    query->object = NULL;
+    dns_addr_response(query, PJ_DNS_TYPE_A, status, pkt);
+}
+
+
+/* 
+ * This callback is called when target is resolved with DNS AAAA query.
+ */
+static void dns_aaaa_callback(void *user_data,
+			      pj_status_t status,
+			      pj_dns_parsed_packet *pkt)
+{
+    struct query *query = (struct query*) user_data;
+
+    query->object6 = NULL;
+    dns_addr_response(query, PJ_DNS_TYPE_AAAA, status, pkt);
 }
 
 
@@ -525,22 +751,13 @@ static void srv_resolver_cb(void *user_data,
     /* Build server addresses and call callback */
     srv.count = 0;
     for (i=0; i<rec->count; ++i) {
-	unsigned j;
-
-	for (j = 0; j < rec->entry[i].server.addr_count &&
-		    srv.count < PJSIP_MAX_RESOLVED_ADDRESSES; ++j)
-	{
-	    srv.entry[srv.count].type = query->naptr[0].type;
-	    srv.entry[srv.count].priority = rec->entry[i].priority;
-	    srv.entry[srv.count].weight = rec->entry[i].weight;
-	    srv.entry[srv.count].addr_len = sizeof(pj_sockaddr_in);
-	    pj_sockaddr_in_init(&srv.entry[srv.count].addr.ipv4,
-				0, (pj_uint16_t)rec->entry[i].port);
-	    srv.entry[srv.count].addr.ipv4.sin_addr.s_addr =
-		rec->entry[i].server.addr[j].s_addr;
-
-	    ++srv.count;
-	}
+	add_server_addresses(&srv, query->naptr[0].type,
+			     rec->entry[i].priority, rec->entry[i].weight,
+			     rec->entry[i].port,
+			     rec->entry[i].server.addr_count,
+			     rec->entry[i].server.addr,
+			     rec->entry[i].addr6_count,
+			     rec->entry[i].addr6);
     }
 
     /* Call the callback */
@@ -185,6 +185,136 @@ PJ_DEF(pj_status_t) pjsua_call_get_stream_stat( pjsua_call_id call_id,
     return status;
 }
 
+/* Get the first audio media of the call which has a stream */
+static pjsua_call_media *get_relay_media(pjsua_call *call)
+{
+    unsigned i;
+
+    for (i=0; i<call->med_cnt; ++i) {
+	pjsua_call_media *call_med = &call->media[i];
+
+	if (call_med->type == PJMEDIA_TYPE_AUDIO && call_med->strm.a.stream)
+	    return call_med;
+    }
+    return NULL;
+}
+
+/* Stop relaying RTP between the call and its relay partner. Must be
+ * called with PJSUA_LOCK held.
+ */
+static void stop_relay(pjsua_call *call)
+{
+    pjsua_call_media *call_med;
+
+    if (call->relay_call_id == PJSUA_INVALID_ID)
+	return;
+
+    call_med = get_relay_media(call);
+    if (call_med)
+	pjmedia_stream_set_relay(call_med->strm.a.stream, NULL);
+
+    call_med = get_relay_media(&pjsua_var.calls[call->relay_call_id]);
+    if (call_med)
+	pjmedia_stream_set_relay(call_med->strm.a.stream, NULL);
+}
+
+/* Internal function: start or stop relaying RTP between the call and its
+ * relay partner, according to the current audio streams of both calls.
+ */
+void pjsua_aud_update_relay(pjsua_call *call)
+{
+    pjsua_call *peer;
+    pjsua_call_media *med1, *med2;
+    pj_status_t status;
+
+    PJSUA_LOCK();
+
+    if (call->relay_call_id == PJSUA_INVALID_ID) {
+	PJSUA_UNLOCK();
+	return;
+    }
+
+    peer = &pjsua_var.calls[call->relay_call_id];
+    med1 = get_relay_media(call);
+    med2 = get_relay_media(peer);
+
+    if (!med1 || !med2) {
+	/* Nothing to relay yet */
+	stop_relay(call);
+	PJSUA_UNLOCK();
+	return;
+    }
+
+    if (med1->dir != PJMEDIA_DIR_ENCODING_DECODING ||
+	med2->dir != PJMEDIA_DIR_ENCODING_DECODING)
+    {
+	status = PJ_EINVALIDOP;
+    } else {
+	status = pjmedia_stream_set_relay(med1->strm.a.stream,
+					  med2->strm.a.stream);
+	if (status == PJ_SUCCESS) {
+	    status = pjmedia_stream_set_relay(med2->strm.a.stream,
+					      med1->strm.a.stream);
+	}
+    }
+
+    if (status == PJ_SUCCESS) {
+	PJ_LOG(4,(THIS_FILE, "Relaying audio RTP between call %d and %d",
+		  call->index, peer->index));
+    } else {
+	stop_relay(call);
+	PJ_PERROR(4,(THIS_FILE, status,
+		     "Not relaying audio RTP between call %d and %d, "
+		     "using conference bridge", call->index, peer->index));
+    }
+
+    PJSUA_UNLOCK();
+}
+
+/*
+ * Pair two calls for audio media relay.
+ */
+PJ_DEF(pj_status_t) pjsua_call_set_media_relay(pjsua_call_id call_id,
+					       pjsua_call_id peer_call_id)
+{
+    pjsua_call *call;
+
+    PJ_ASSERT_RETURN(call_id>=0 && call_id<(int)pjsua_var.ua_cfg.max_calls,
+		     PJ_EINVAL);
+    PJ_ASSERT_RETURN(peer_call_id==PJSUA_INVALID_ID ||
+		     (peer_call_id>=0 &&
+		      peer_call_id<(int)pjsua_var.ua_cfg.max_calls &&
+		      peer_call_id!=call_id), PJ_EINVAL);
+
+    PJSUA_LOCK();
+
+    call = &pjsua_var.calls[call_id];
+
+    /* Remove existing pairings */
+    if (call->relay_call_id != PJSUA_INVALID_ID) {
+	stop_relay(call);
+	pjsua_var.calls[call->relay_call_id].relay_call_id = PJSUA_INVALID_ID;
+	call->relay_call_id = PJSUA_INVALID_ID;
+    }
+
+    if (peer_call_id != PJSUA_INVALID_ID) {
+	pjsua_call *peer = &pjsua_var.calls[peer_call_id];
+
+	if (peer->relay_call_id != PJSUA_INVALID_ID) {
+	    stop_relay(peer);
+	    pjsua_var.calls[peer->relay_call_id].relay_call_id =
+		PJSUA_INVALID_ID;
+	}
+
+	call->relay_call_id = peer_call_id;
+	peer->relay_call_id = call_id;
+	pjsua_aud_update_relay(call);
+    }
+
+    PJSUA_UNLOCK();
+    return PJ_SUCCESS;
+}
+
 /*
  * Send DTMF digits to remote using RFC 2833 payload formats.
  */
@@ -343,6 +473,8 @@ pj_status_t pjsua_aud_subsys_init()
     else if (pjsua_var.media_cfg.quality < 3) {
 	opt |= PJMEDIA_CONF_USE_LINEAR;
     }
+    if (pjsua_var.media_cfg.conf_vad)
+	opt |= PJMEDIA_CONF_VAD;
 
     /* Init conference bridge. */
     status = pjmedia_conf_create(pjsua_var.pool,
@@ -371,6 +503,27 @@ pj_status_t pjsua_aud_subsys_init()
 				      &pjsua_var.null_port);
     PJ_ASSERT_RETURN(status == PJ_SUCCESS, status);
 
+    /* Create WAV cache for the file players */
+    if (pjsua_var.media_cfg.use_wav_cache) {
+	status = pjmedia_wav_cache_create(&pjsua_var.cp.factory,
+					  &pjsua_var.wav_cache);
+	if (status != PJ_SUCCESS) {
+	    pjsua_perror(THIS_FILE, "Error creating WAV cache", status);
+	    goto on_error;
+	}
+    }
+
+    /* Create I/O thread for the file recorders */
+    if (pjsua_var.media_cfg.async_recorder) {
+	status = pjmedia_wav_writer_io_create(&pjsua_var.cp.factory,
+					      &pjsua_var.rec_io);
+	if (status != PJ_SUCCESS) {
+	    pjsua_perror(THIS_FILE, "Error creating recorder I/O thread",
+			 status);
+	    goto on_error;
+	}
+    }
+
     return status;
 
 on_error:
@@ -485,6 +638,11 @@ pj_status_t pjsua_aud_subsys_destroy()
 	}
     }
 
+    if (pjsua_var.wav_cache) {
+	pjmedia_wav_cache_destroy(pjsua_var.wav_cache);
+	pjsua_var.wav_cache = NULL;
+    }
+
     /* Destroy file recorders */
     for (i=0; i<PJ_ARRAY_SIZE(pjsua_var.recorder); ++i) {
 	if (pjsua_var.recorder[i].port) {
@@ -493,6 +651,11 @@ pj_status_t pjsua_aud_subsys_destroy()
 	}
     }
 
+    if (pjsua_var.rec_io) {
+	pjmedia_wav_writer_io_destroy(pjsua_var.rec_io);
+	pjsua_var.rec_io = NULL;
+    }
+
     return PJ_SUCCESS;
 }
 
@@ -502,6 +665,15 @@ void pjsua_aud_stop_stream(pjsua_call_media *call_med)
     pjmedia_rtcp_stat stat;
 
     if (strm) {
+	/* The relay partner must stop sending to this stream. The partner
+	 * may be tearing down its own media, hold the lock as
+	 * pjsua_aud_update_relay() does.
+	 */
+	PJSUA_LOCK();
+	if (call_med->call->relay_call_id != PJSUA_INVALID_ID)
+	    stop_relay(call_med->call);
+	PJSUA_UNLOCK();
+
 	pjmedia_stream_send_rtcp_bye(strm);
 
 	if (call_med->strm.a.conf_slot != PJSUA_INVALID_ID) {
@@ -597,6 +769,7 @@ pj_status_t pjsua_aud_channel_update(pjsua_call_media *call_med,
 	si->jb_min_pre = pjsua_var.media_cfg.jb_min_pre;
 	si->jb_max_pre = pjsua_var.media_cfg.jb_max_pre;
 	si->jb_max = pjsua_var.media_cfg.jb_max;
+	si->jb_engine = pjsua_var.media_cfg.jb_engine;
 
 	/* Set SSRC */
 	si->ssrc = call_med->ssrc;
@@ -680,6 +853,9 @@ pj_status_t pjsua_aud_channel_update(pjsua_call_media *call_med,
 		goto on_return;
 	    }
 	}
+
+	/* Relay RTP with the partner call, if the codecs match */
+	pjsua_aud_update_relay(call);
     }
 
 on_return:
@@ -1056,12 +1232,21 @@ PJ_DEF(pj_status_t) pjsua_player_create( const pj_str_t *filename,
 	goto on_error;
     }
 
-    status = pjmedia_wav_player_port_create(
+    if (pjsua_var.wav_cache) {
+	status = pjmedia_wav_player_port_create_cached(
+				    pool, pjsua_var.wav_cache, path,
+				    pjsua_var.mconf_cfg.samples_per_frame *
+				    1000 / pjsua_var.media_cfg.channel_count /
+				    pjsua_var.media_cfg.clock_rate,
+				    options, &port);
+    } else {
+	status = pjmedia_wav_player_port_create(
 				    pool, path,
 				    pjsua_var.mconf_cfg.samples_per_frame *
 				    1000 / pjsua_var.media_cfg.channel_count /
 				    pjsua_var.media_cfg.clock_rate,
 				    options, 0, &port);
+    }
     if (status != PJ_SUCCESS) {
 	pjsua_perror(THIS_FILE, "Unable to open file for playback", status);
 	goto on_error;
@@ -1145,9 +1330,16 @@ PJ_DEF(pj_status_t) pjsua_playlist_create( const pj_str_t file_names[],
 	goto on_error;
     }
 
-    status = pjmedia_wav_playlist_create(pool, label,
-					 file_names, file_count,
-					 ptime, options, 0, &port);
+    if (pjsua_var.wav_cache) {
+	status = pjmedia_wav_playlist_create_cached(pool, pjsua_var.wav_cache,
+						    label, file_names,
+						    file_count, ptime,
+						    options, &port);
+    } else {
+	status = pjmedia_wav_playlist_create(pool, label,
+					     file_names, file_count,
+					     ptime, options, 0, &port);
+    }
     if (status != PJ_SUCCESS) {
 	pjsua_perror(THIS_FILE, "Unable to create playlist", status);
 	goto on_error;
@@ -1394,7 +1586,15 @@ PJ_DEF(pj_status_t) pjsua_recorder_create( const pj_str_t *filename,
 	goto on_return;
     }
 
-    if (file_format == FMT_WAV) {
+    if (file_format == FMT_WAV && pjsua_var.rec_io) {
+	status = pjmedia_wav_writer_port_create_async(
+					pool, pjsua_var.rec_io, path,
+					pjsua_var.media_cfg.clock_rate,
+					pjsua_var.mconf_cfg.channel_count,
+					pjsua_var.mconf_cfg.samples_per_frame,
+					pjsua_var.mconf_cfg.bits_per_sample,
+					options, 0, &port);
+    } else if (file_format == FMT_WAV) {
 	status = pjmedia_wav_writer_port_create(pool, path,
 						pjsua_var.media_cfg.clock_rate,
 						pjsua_var.mconf_cfg.channel_count,
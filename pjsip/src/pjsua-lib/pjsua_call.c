@@ -130,8 +130,18 @@ static void reset_call(pjsua_call_id id)
     pjsua_call *call = &pjsua_var.calls[id];
     unsigned i;
 
+    /* Unpair from the media relay partner */
+    if (call->relay_call_id != PJSUA_INVALID_ID &&
+	call->relay_call_id != (pjsua_call_id)id &&
+	pjsua_var.calls[call->relay_call_id].relay_call_id ==
+	    (pjsua_call_id)id)
+    {
+	pjsua_var.calls[call->relay_call_id].relay_call_id = PJSUA_INVALID_ID;
+    }
+
     pj_bzero(call, sizeof(*call));
     call->index = id;
+    call->relay_call_id = PJSUA_INVALID_ID;
     call->last_text.ptr = call->last_text_buf_;
     for (i=0; i<PJ_ARRAY_SIZE(call->media); ++i) {
 	pjsua_call_media *call_med = &call->media[i];
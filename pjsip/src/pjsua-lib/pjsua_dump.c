@@ -68,6 +68,7 @@ static unsigned dump_media_stat(const char *indent,
 	   "%s     RX %s last update:%s\n"
 	   "%s        total %spkt %sB (%sB +IP hdr) @avg=%sbps/%sbps\n"
 	   "%s        pkt loss=%d (%3.1f%%), discrd=%d (%3.1f%%), dup=%d (%2.1f%%), reord=%d (%3.1f%%)\n"
+	   "%s        concealed=%d frm (%d interpolated) in %d events\n"
 	   "%s              (msec)    min     avg     max     last    dev\n"
 	   "%s        loss period: %7.3f %7.3f %7.3f %7.3f %7.3f\n"
 	   "%s        jitter     : %7.3f %7.3f %7.3f %7.3f %7.3f\n"
@@ -97,6 +98,10 @@ static unsigned dump_media_stat(const char *indent,
 	   (stat->rx.dup? stat->rx.dup * 100.0 / (stat->rx.pkt + stat->rx.loss) : 0),
 	   stat->rx.reorder,
 	   (stat->rx.reorder? stat->rx.reorder * 100.0 / (stat->rx.pkt + stat->rx.loss) : 0),
+	   indent,
+	   stat->rx_plc.frames,
+	   stat->rx_plc.interp,
+	   stat->rx_plc.events,
 	   indent, indent,
 	   stat->rx.loss_period.min / 1000.0,
 	   stat->rx.loss_period.mean / 1000.0,
@@ -91,6 +91,18 @@ pj_status_t pjsua_media_subsys_init(const pjsua_media_config *cfg)
 	goto on_error;
     }
 
+    /* Create media workers */
+    if (pjsua_var.media_cfg.worker_cnt) {
+	status = pjmedia_endpt_create_workers(
+				pjsua_var.med_endpt,
+				pjsua_var.media_cfg.worker_cnt,
+				pjsua_var.media_cfg.worker_cpu_affinity);
+	if (status != PJ_SUCCESS) {
+	    pjsua_perror(THIS_FILE, "Error creating media workers", status);
+	    goto on_error;
+	}
+    }
+
     status = pjsua_aud_subsys_init();
     if (status != PJ_SUCCESS)
 	goto on_error;
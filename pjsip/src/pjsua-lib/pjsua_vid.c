@@ -61,6 +61,15 @@ pj_status_t pjsua_vid_subsys_init(void)
 	goto on_error;
     }
 
+    status = pjmedia_vid_frame_pool_create(&pjsua_var.cp.factory, "vidfrm",
+					   PJMEDIA_VID_FRAME_POOL_MAX_IDLE,
+					   NULL);
+    if (status != PJ_SUCCESS) {
+	PJ_PERROR(1,(THIS_FILE, status,
+		     "Error creating PJMEDIA video frame pool"));
+	goto on_error;
+    }
+
     status = pjmedia_event_mgr_create(pjsua_var.pool, 0, NULL);
     if (status != PJ_SUCCESS) {
 	PJ_PERROR(1,(THIS_FILE, status,
@@ -151,6 +160,9 @@ pj_status_t pjsua_vid_subsys_destroy(void)
     if (pjmedia_vid_codec_mgr_instance())
 	pjmedia_vid_codec_mgr_destroy(NULL);
 
+    if (pjmedia_vid_frame_pool_instance())
+	pjmedia_vid_frame_pool_destroy(NULL);
+
     if (pjmedia_converter_mgr_instance())
 	pjmedia_converter_mgr_destroy(NULL);
 
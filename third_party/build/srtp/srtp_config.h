@@ -36,6 +36,20 @@
 #   define CPU_CISC	    1
 #endif
 
+/* Use OpenSSL EVP for AES-ICM and HMAC-SHA1 (aes_icm_ossl.c and
+ * hmac_ossl.c) instead of the portable table-based code. EVP uses the
+ * AES-NI instructions when the CPU has them. This follows
+ * PJMEDIA_SRTP_HAS_OPENSSL, which is enabled when pjlib is built with
+ * OpenSSL.
+ */
+#ifndef PJMEDIA_SRTP_HAS_OPENSSL
+#   define PJMEDIA_SRTP_HAS_OPENSSL	PJ_HAS_SSL_SOCK
+#endif
+
+#if PJMEDIA_SRTP_HAS_OPENSSL
+#   define OPENSSL	    1
+#endif
+
 /* Define to compile in dynamic debugging system. */
 #define ENABLE_DEBUGGING    PJ_DEBUG
 
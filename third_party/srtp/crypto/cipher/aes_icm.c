@@ -49,6 +49,9 @@
 #include "aes_icm.h"
 #include "alloc.h"
 
+/* see aes_icm_ossl.c for the OpenSSL backend */
+#ifndef OPENSSL
+
 
 debug_module_t mod_aes_icm = {
   0,                 /* debugging is off by default */
@@ -509,3 +512,4 @@ cipher_type_t aes_icm = {
   (debug_module_t *)            &mod_aes_icm
 };
 
+#endif /* OPENSSL */
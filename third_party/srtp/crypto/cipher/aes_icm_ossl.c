@@ -0,0 +1,296 @@
+/*
+ * aes_icm_ossl.c
+ *
+ * AES Integer Counter Mode, using the OpenSSL EVP AES-128-CTR cipher
+ *
+ * This is a drop-in replacement of aes_icm.c, compiled in when OPENSSL
+ * is defined (see srtp_config.h). EVP uses the AES-NI instructions when
+ * the CPU has them, instead of the table-based aes.c.
+ */
+
+/*
+ *
+ * Copyright (c) 2001-2006, Cisco Systems, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following
+ *   disclaimer in the documentation and/or other materials provided
+ *   with the distribution.
+ *
+ *   Neither the name of the Cisco Systems, Inc. nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#include "aes_icm.h"
+#include "alloc.h"
+
+#ifdef OPENSSL
+
+debug_module_t mod_aes_icm = {
+  0,                 /* debugging is off by default */
+  "aes icm ossl"     /* printable module name       */
+};
+
+/*
+ * the counter block is laid out as in aes_icm.c: the salt exored with
+ * the packet index, and a 16-bit block counter in the last two octets.
+ * AES-128-CTR increments the whole block as a 128-bit big-endian
+ * integer, which gives the same keystream as long as the block counter
+ * does not wrap, i.e. for less than 2^16 blocks per packet
+ */
+
+err_status_t
+aes_icm_alloc_ismacryp(cipher_t **c, int key_len, int forIsmacryp) {
+  extern cipher_type_t aes_icm;
+  uint8_t *pointer;
+  int tmp;
+
+  debug_print(mod_aes_icm,
+            "allocating cipher with key length %d", key_len);
+
+  if (!forIsmacryp && key_len != 30)
+    return err_status_bad_param;
+
+  /* allocate memory a cipher of type aes_icm */
+  tmp = (sizeof(aes_icm_ctx_t) + sizeof(cipher_t));
+  pointer = (uint8_t*)crypto_alloc(tmp);
+  if (pointer == NULL)
+    return err_status_alloc_fail;
+
+  /* the EVP context is created by aes_icm_context_init() */
+  octet_string_set_to_zero(pointer, tmp);
+
+  /* set pointers */
+  *c = (cipher_t *)pointer;
+  (*c)->type = &aes_icm;
+  (*c)->state = pointer + sizeof(cipher_t);
+
+  /* increment ref_count */
+  aes_icm.ref_count++;
+
+  /* set key size        */
+  (*c)->key_len = key_len;
+
+  return err_status_ok;
+}
+
+err_status_t aes_icm_alloc(cipher_t **c, int key_len, int forIsmacryp) {
+  return aes_icm_alloc_ismacryp(c, key_len, 0);
+}
+
+err_status_t
+aes_icm_dealloc(cipher_t *c) {
+  extern cipher_type_t aes_icm;
+
+  /* free the EVP context and zeroize entire state */
+  aes_icm_context_clear((aes_icm_ctx_t *)c->state);
+  octet_string_set_to_zero((uint8_t *)c,
+			   sizeof(aes_icm_ctx_t) + sizeof(cipher_t));
+
+  /* free memory */
+  crypto_free(c);
+
+  /* decrement ref_count */
+  aes_icm.ref_count--;
+
+  return err_status_ok;
+}
+
+/*
+ * aes_icm_context_clear(c) frees the EVP context and zeroizes c; it
+ * must be called for contexts which are not allocated with
+ * aes_icm_alloc(), such as the srtp key derivation context
+ */
+
+err_status_t
+aes_icm_context_clear(aes_icm_ctx_t *c) {
+  if (c->ctx)
+    EVP_CIPHER_CTX_free(c->ctx);
+
+  octet_string_set_to_zero((uint8_t *)c, sizeof(aes_icm_ctx_t));
+
+  return err_status_ok;
+}
+
+/*
+ * aes_icm_context_init(...) initializes the aes_icm_context
+ * using the value in key[], see aes_icm.c
+ *
+ * c must be zeroized or previously initialized, so that the EVP context
+ * is created once and reused when the key changes
+ */
+
+err_status_t
+aes_icm_context_init(aes_icm_ctx_t *c, const uint8_t *key) {
+
+  /* set counter and initial values to 'offset' value */
+  v128_copy_octet_string(&c->counter, key + 16);
+  v128_copy_octet_string(&c->offset, key + 16);
+
+  /* force last two octets of the offset to zero (for srtp compatibility) */
+  c->offset.v8[14] = c->offset.v8[15] = 0;
+  c->counter.v8[14] = c->counter.v8[15] = 0;
+
+  debug_print(mod_aes_icm,
+	      "offset: %s", v128_hex_string(&c->offset));
+
+  if (c->ctx == NULL) {
+    c->ctx = EVP_CIPHER_CTX_new();
+    if (c->ctx == NULL)
+      return err_status_alloc_fail;
+  }
+
+  /* expand key */
+  if (!EVP_EncryptInit_ex(c->ctx, EVP_aes_128_ctr(), NULL, key,
+			  c->counter.v8))
+    return err_status_init_fail;
+
+  return err_status_ok;
+}
+
+/*
+ * aes_icm_set_iv(c, iv) sets the counter value to the exor of iv with
+ * the offset, and restarts the keystream
+ */
+
+err_status_t
+aes_icm_set_iv(aes_icm_ctx_t *c, void *iv) {
+  v128_t *nonce = (v128_t *) iv;
+
+  debug_print(mod_aes_icm,
+	      "setting iv: %s", v128_hex_string(nonce));
+
+  v128_xor(&c->counter, &c->offset, nonce);
+
+  debug_print(mod_aes_icm,
+	      "set_counter: %s", v128_hex_string(&c->counter));
+
+  /* keep the key schedule, only reset the counter */
+  if (!EVP_EncryptInit_ex(c->ctx, NULL, NULL, NULL, c->counter.v8))
+    return err_status_cipher_fail;
+
+  return err_status_ok;
+}
+
+/*
+ * aes_icm_encrypt_ismacryp(...) exors the keystream into buf; the EVP
+ * context keeps the position in the keystream across calls, so both
+ * the srtp and the ismacryp counter layouts are handled by CTR mode
+ */
+
+err_status_t
+aes_icm_encrypt_ismacryp(aes_icm_ctx_t *c,
+              unsigned char *buf, unsigned int *enc_len,
+              int forIsmacryp) {
+  int len;
+
+  /* check that the block counter will not wrap, but not for ismacryp */
+  if (!forIsmacryp && *enc_len > 0xffff)
+    return err_status_terminus;
+
+  if (!EVP_EncryptUpdate(c->ctx, buf, &len, buf, (int)*enc_len))
+    return err_status_cipher_fail;
+
+  return err_status_ok;
+}
+
+err_status_t
+aes_icm_encrypt(aes_icm_ctx_t *c, unsigned char *buf, unsigned int *enc_len) {
+  return aes_icm_encrypt_ismacryp(c, buf, enc_len, 0);
+}
+
+err_status_t
+aes_icm_output(aes_icm_ctx_t *c, uint8_t *buffer, int num_octets_to_output) {
+  unsigned int len = num_octets_to_output;
+
+  /* zeroize the buffer */
+  octet_string_set_to_zero(buffer, num_octets_to_output);
+
+  /* exor keystream into buffer */
+  return aes_icm_encrypt(c, buffer, &len);
+}
+
+
+char
+aes_icm_description[] = "aes integer counter mode (openssl)";
+
+uint8_t aes_icm_test_case_0_key[30] = {
+  0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+  0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c,
+  0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7,
+  0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd
+};
+
+uint8_t aes_icm_test_case_0_nonce[16] = {
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+uint8_t aes_icm_test_case_0_plaintext[32] =  {
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
+uint8_t aes_icm_test_case_0_ciphertext[32] = {
+  0xe0, 0x3e, 0xad, 0x09, 0x35, 0xc9, 0x5e, 0x80,
+  0xe1, 0x66, 0xb1, 0x6d, 0xd9, 0x2b, 0x4e, 0xb4,
+  0xd2, 0x35, 0x13, 0x16, 0x2b, 0x02, 0xd0, 0xf7,
+  0x2a, 0x43, 0xa2, 0xfe, 0x4a, 0x5f, 0x97, 0xab
+};
+
+cipher_test_case_t aes_icm_test_case_0 = {
+  30,                                    /* octets in key            */
+  aes_icm_test_case_0_key,               /* key                      */
+  aes_icm_test_case_0_nonce,             /* packet index             */
+  32,                                    /* octets in plaintext      */
+  aes_icm_test_case_0_plaintext,         /* plaintext                */
+  32,                                    /* octets in ciphertext     */
+  aes_icm_test_case_0_ciphertext,        /* ciphertext               */
+  NULL                                   /* pointer to next testcase */
+};
+
+
+/*
+ * note: the encrypt function is identical to the decrypt function
+ */
+
+cipher_type_t aes_icm = {
+  (cipher_alloc_func_t)          aes_icm_alloc,
+  (cipher_dealloc_func_t)        aes_icm_dealloc,
+  (cipher_init_func_t)           aes_icm_context_init,
+  (cipher_encrypt_func_t)        aes_icm_encrypt,
+  (cipher_decrypt_func_t)        aes_icm_encrypt,
+  (cipher_set_iv_func_t)         aes_icm_set_iv,
+  (char *)                       aes_icm_description,
+  (int)                          0,   /* instance count */
+  (cipher_test_case_t *)        &aes_icm_test_case_0,
+  (debug_module_t *)            &mod_aes_icm
+};
+
+#endif /* OPENSSL */
@@ -45,6 +45,9 @@
 #include "hmac.h" 
 #include "alloc.h"
 
+/* see hmac_ossl.c for the OpenSSL backend */
+#ifndef OPENSSL
+
 /* the debug module for authentiation */
 
 debug_module_t mod_hmac = {
@@ -265,3 +268,4 @@ hmac  = {
   (debug_module_t *)    &mod_hmac
 };
 
+#endif /* OPENSSL */
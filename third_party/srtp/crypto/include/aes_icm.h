@@ -14,6 +14,27 @@
 #include "aes.h"
 #include "cipher.h"
 
+#ifdef OPENSSL
+
+#include <openssl/evp.h>
+
+/*
+ * with the OpenSSL backend, the keystream is generated by the EVP
+ * AES-128-CTR cipher (AES-NI accelerated where available); the EVP
+ * context is allocated on the first aes_icm_context_init() and freed
+ * by aes_icm_context_clear()
+ */
+typedef struct {
+  v128_t   counter;                /* holds the counter value          */
+  v128_t   offset;                 /* initial offset value             */
+  EVP_CIPHER_CTX *ctx;             /* EVP cipher context               */
+} aes_icm_ctx_t;
+
+err_status_t
+aes_icm_context_clear(aes_icm_ctx_t *c);
+
+#else
+
 typedef struct {
   v128_t   counter;                /* holds the counter value          */
   v128_t   offset;                 /* initial offset value             */
@@ -22,6 +43,8 @@ typedef struct {
   int      bytes_in_buffer;        /* number of unused bytes in buffer */
 } aes_icm_ctx_t;
 
+#endif /* OPENSSL */
+
 
 err_status_t
 aes_icm_context_init(aes_icm_ctx_t *c,
@@ -49,12 +49,31 @@
 #include "auth.h"
 #include "sha1.h"
 
+#ifdef OPENSSL
+
+#include <openssl/evp.h>
+
+/*
+ * with the OpenSSL backend, SHA-1 is computed by EVP; the inner and
+ * outer contexts are keyed once by hmac_init() and copied for every
+ * message
+ */
+typedef struct {
+  EVP_MD_CTX *ctx;
+  EVP_MD_CTX *init_ctx;
+  EVP_MD_CTX *opad_ctx;
+} hmac_ctx_t;
+
+#else
+
 typedef struct {
   uint8_t    opad[64];
   sha1_ctx_t ctx;
   sha1_ctx_t init_ctx;
 } hmac_ctx_t;
 
+#endif /* OPENSSL */
+
 err_status_t
 hmac_alloc(auth_t **a, int key_len, int out_len);
 
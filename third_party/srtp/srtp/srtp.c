@@ -315,6 +315,8 @@ typedef struct {
 err_status_t
 srtp_kdf_init(srtp_kdf_t *kdf, const uint8_t key[30]) {
 
+  /* kdf is on the stack, the OpenSSL backend needs a zeroized context */
+  octet_string_set_to_zero((uint8_t *)kdf, sizeof(srtp_kdf_t));
   aes_icm_context_init(&kdf->c, key);
 
   return err_status_ok;
@@ -341,6 +343,11 @@ srtp_kdf_generate(srtp_kdf_t *kdf, srtp_prf_label label,
 err_status_t
 srtp_kdf_clear(srtp_kdf_t *kdf) {
   
+#ifdef OPENSSL
+  /* free the EVP context */
+  aes_icm_context_clear(&kdf->c);
+#endif
+
   /* zeroize aes context */
   octet_string_set_to_zero((uint8_t *)kdf, sizeof(srtp_kdf_t));
 